@@ -15,6 +15,7 @@
 #include "../network/network.h"
 #include "../window_func.h"
 #include "../framerate_type.h"
+#include "../trace_zone.h"
 #include "ai_scanner.hpp"
 #include "ai_instance.hpp"
 #include "ai_config.hpp"
@@ -66,24 +67,39 @@
 
 /* static */ void AI::GameLoop()
 {
+	/* The AIs and the game script of this tick share what they do not use */
+	ScriptInstance::ResetSpareOps();
+
 	/* If we are in networking, only servers run this function, and that only if it is allowed */
 	if (_networking && (!_network_server || !_settings_game.ai.ai_in_multiplayer)) return;
 
-	/* The speed with which AIs go, is limited by the 'competitor_speed' */
+	/* The speed with which AIs go, is limited by the 'competitor_speed'.
+	 * Each AI gets its own tick within that interval, so slower speeds spread
+	 * the AIs over the ticks instead of running all of them in the same tick. */
 	AI::frame_counter++;
 	assert(_settings_game.difficulty.competitor_speed <= 4);
-	if ((AI::frame_counter & ((1 << (4 - _settings_game.difficulty.competitor_speed)) - 1)) != 0) return;
+	uint interval_mask = (1 << (4 - _settings_game.difficulty.competitor_speed)) - 1;
 
 	Backup<CompanyID> cur_company(_current_company, FILE_LINE);
 	for (const Company *c : Company::Iterate()) {
 		if (c->is_ai) {
+			if (((AI::frame_counter + c->index) & interval_mask) != 0) continue;
 			PerformanceMeasurer framerate((PerformanceElement)(PFE_AI0 + c->index));
+			TraceZone zone("AI", c->index);
 			cur_company.Change(c->index);
 			c->ai_instance->GameLoop();
 		} else {
 			PerformanceMeasurer::SetInactive((PerformanceElement)(PFE_AI0 + c->index));
 		}
 	}
+
+	/* Hand the opcodes of idle AIs to the AIs that ran out of theirs, in company order. */
+	for (const Company *c : Company::Iterate()) {
+		if (!c->is_ai || ((AI::frame_counter + c->index) & interval_mask) != 0) continue;
+		TraceZone zone("AI spare ops", c->index);
+		cur_company.Change(c->index);
+		c->ai_instance->ContinueWithSpareOps();
+	}
 	cur_company.Restore();
 
 	/* Occasionally collect garbage; every 255 ticks do one company.
@@ -1774,53 +1774,33 @@ static bool AirportMove(Aircraft *v, const AirportFTAClass *apc)
 
 	v->previous_pos = v->pos; // save previous location
 
-	/* there is only one choice to move to */
-	if (current->next == nullptr) {
-		if (AirportSetBlocks(v, current, apc)) {
-			v->pos = current->next_position;
-			UpdateAircraftCache(v);
-		} // move to next position
-		return false;
+	/* take the only choice, or the one that matches our heading */
+	current = apc->GetTransition(v->pos, v->state);
+	if (current == nullptr) {
+		DEBUG(misc, 0, "[Ap] cannot move further on Airport! (pos %d state %d) for vehicle %d", v->pos, v->state, v->index);
+		NOT_REACHED();
 	}
 
-	/* there are more choices to choose from, choose the one that
-	 * matches our heading */
-	do {
-		if (v->state == current->heading || current->heading == TO_ALL) {
-			if (AirportSetBlocks(v, current, apc)) {
-				v->pos = current->next_position;
-				UpdateAircraftCache(v);
-			} // move to next position
-			return false;
-		}
-		current = current->next;
-	} while (current != nullptr);
-
-	DEBUG(misc, 0, "[Ap] cannot move further on Airport! (pos %d state %d) for vehicle %d", v->pos, v->state, v->index);
-	NOT_REACHED();
+	if (AirportSetBlocks(v, current, apc)) {
+		v->pos = current->next_position;
+		UpdateAircraftCache(v);
+	} // move to next position
+	return false;
 }
 
 /** returns true if the road ahead is busy, eg. you must wait before proceeding. */
 static bool AirportHasBlock(Aircraft *v, const AirportFTA *current_pos, const AirportFTAClass *apc)
 {
-	const AirportFTA *reference = &apc->layout[v->pos];
-	const AirportFTA *next = &apc->layout[current_pos->next_position];
+	assert(current_pos->position == v->pos);
 
 	/* same block, then of course we can move */
-	if (apc->layout[current_pos->position].block != next->block) {
-		const Station *st = Station::Get(v->targetairport);
-		uint64 airport_flags = next->block;
-
-		/* check additional possible extra blocks */
-		if (current_pos != reference && current_pos->block != NOTHING_block) {
-			airport_flags |= current_pos->block;
-		}
+	if (current_pos->wait_blocks == 0) return false;
 
-		if (st->airport.flags & airport_flags) {
-			v->cur_speed = 0;
-			v->subspeed = 0;
-			return true;
-		}
+	const Station *st = Station::Get(v->targetairport);
+	if (st->airport.flags & current_pos->wait_blocks) {
+		v->cur_speed = 0;
+		v->subspeed = 0;
+		return true;
 	}
 	return false;
 }
@@ -1834,37 +1814,20 @@ static bool AirportHasBlock(Aircraft *v, const AirportFTA *current_pos, const Ai
  */
 static bool AirportSetBlocks(Aircraft *v, const AirportFTA *current_pos, const AirportFTAClass *apc)
 {
-	const AirportFTA *next = &apc->layout[current_pos->next_position];
-	const AirportFTA *reference = &apc->layout[v->pos];
-
-	/* if the next position is in another block, check it and wait until it is free */
-	if ((apc->layout[current_pos->position].block & next->block) != next->block) {
-		uint64 airport_flags = next->block;
-		/* search for all all elements in the list with the same state, and blocks != N
-		 * this means more blocks should be checked/set */
-		const AirportFTA *current = current_pos;
-		if (current == reference) current = current->next;
-		while (current != nullptr) {
-			if (current->heading == current_pos->heading && current->block != 0) {
-				airport_flags |= current->block;
-				break;
-			}
-			current = current->next;
-		}
-
-		/* if the block to be checked is in the next position, then exclude that from
-		 * checking, because it has been set by the airplane before */
-		if (current_pos->block == next->block) airport_flags ^= next->block;
+	assert(current_pos->position == v->pos);
 
+	/* if the next position is in another block, check it and wait until it is free;
+	 * the blocks to check and set were determined when the airport was built */
+	if (current_pos->move_blocks != 0) {
 		Station *st = Station::Get(v->targetairport);
-		if (st->airport.flags & airport_flags) {
+		if (st->airport.flags & current_pos->move_blocks) {
 			v->cur_speed = 0;
 			v->subspeed = 0;
 			return false;
 		}
 
-		if (next->block != NOTHING_block) {
-			SETBITS(st->airport.flags, airport_flags); // occupy next block
+		if (apc->layout[current_pos->next_position].block != NOTHING_block) {
+			SETBITS(st->airport.flags, current_pos->move_blocks); // occupy next block
 		}
 	}
 	return true;
@@ -2068,7 +2031,7 @@ bool Aircraft::Tick()
 {
 	if (!this->IsNormalAircraft()) return true;
 
-	PerformanceAccumulator framerate(PFE_GL_AIRCRAFT);
+	PerformanceAccumulator framerate(PFE_GL_AIRCRAFT, this->index);
 
 	this->tick_counter++;
 
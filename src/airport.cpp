@@ -67,6 +67,7 @@ AIRPORT_GENERIC(dummy, nullptr, 0, AirportFTAClass::ALL, 0)
 
 static uint16 AirportGetNofElements(const AirportFTAbuildup *apFA);
 static AirportFTA *AirportBuildAutomata(uint nofelements, const AirportFTAbuildup *apFA);
+static const AirportFTA **AirportCompileAutomata(uint nofelements, AirportFTA *layout);
 
 
 /**
@@ -127,19 +128,13 @@ AirportFTAClass::AirportFTAClass(
 {
 	/* Build the state machine itself */
 	this->layout = AirportBuildAutomata(this->nofelements, apFA);
+	this->transitions = AirportCompileAutomata(this->nofelements, this->layout);
 }
 
 AirportFTAClass::~AirportFTAClass()
 {
-	for (uint i = 0; i < nofelements; i++) {
-		AirportFTA *current = layout[i].next;
-		while (current != nullptr) {
-			AirportFTA *next = current->next;
-			free(current);
-			current = next;
-		}
-	}
-	free(layout);
+	free(this->transitions);
+	free(this->layout);
 }
 
 /**
@@ -170,7 +165,12 @@ static uint16 AirportGetNofElements(const AirportFTAbuildup *apFA)
  */
 static AirportFTA *AirportBuildAutomata(uint nofelements, const AirportFTAbuildup *apFA)
 {
-	AirportFTA *FAutomata = MallocT<AirportFTA>(nofelements);
+	uint16 num_elements = 0;
+	while (apFA[num_elements].position != MAX_ELEMENTS) num_elements++;
+
+	/* The first element of each position is at the index of the position, the other choices follow after all of those. */
+	AirportFTA *FAutomata = MallocT<AirportFTA>(num_elements);
+	uint16 num_choices = nofelements;
 	uint16 internalcounter = 0;
 
 	for (uint i = 0; i < nofelements; i++) {
@@ -182,7 +182,7 @@ static AirportFTA *AirportBuildAutomata(uint nofelements, const AirportFTAbuildu
 
 		/* outgoing nodes from the same position, create linked list */
 		while (current->position == apFA[internalcounter + 1].position) {
-			AirportFTA *newNode = MallocT<AirportFTA>(1);
+			AirportFTA *newNode = &FAutomata[num_choices++];
 
 			newNode->position      = apFA[internalcounter + 1].position;
 			newNode->heading       = apFA[internalcounter + 1].heading;
@@ -196,9 +196,69 @@ static AirportFTA *AirportBuildAutomata(uint nofelements, const AirportFTAbuildu
 		current->next = nullptr;
 		internalcounter++;
 	}
+	assert(num_choices == num_elements);
 	return FAutomata;
 }
 
+/**
+ * Determine everything about moving through the FTA that does not depend on
+ * the state of the airport, so moving an aircraft only has to look it up.
+ * This sets the blocks of the elements, and builds the table of transitions.
+ * @param nofelements The number of positions in the FTA.
+ * @param layout The FTA.
+ * @return The element to take for each position and state; see #AirportFTAClass::GetTransition.
+ */
+static const AirportFTA **AirportCompileAutomata(uint nofelements, AirportFTA *layout)
+{
+	const AirportFTA **transitions = CallocT<const AirportFTA *>(nofelements * (MAX_HEADINGS + 1));
+
+	for (uint i = 0; i < nofelements; i++) {
+		const AirportFTA *first = &layout[i];
+
+		for (AirportFTA *current = &layout[i]; current != nullptr; current = current->next) {
+			const uint64 block = layout[current->position].block;
+			const uint64 next_block = layout[current->next_position].block;
+
+			/* Same block, then of course we can move. Otherwise the next block has to be free,
+			 * and for the other choices also the block of the choice itself. */
+			current->wait_blocks = 0;
+			if (block != next_block) {
+				current->wait_blocks = next_block;
+				if (current != first && current->block != NOTHING_block) current->wait_blocks |= current->block;
+			}
+
+			/* When taking the choice into another block, also the block of the first
+			 * other choice with the same heading is occupied, if it has any. */
+			current->move_blocks = 0;
+			if ((block & next_block) != next_block) {
+				uint64 airport_flags = next_block;
+				for (const AirportFTA *other = (current == first) ? current->next : current; other != nullptr; other = other->next) {
+					if (other->heading == current->heading && other->block != 0) {
+						airport_flags |= other->block;
+						break;
+					}
+				}
+
+				/* If the block to be checked is in the next position, then exclude that from
+				 * checking, because it has been set by the airplane before. */
+				if (current->block == next_block) airport_flags ^= next_block;
+				current->move_blocks = airport_flags;
+			}
+		}
+
+		/* With only one choice it is taken for every state; otherwise the first one for the state, or for all states. */
+		for (uint state = 0; state <= MAX_HEADINGS; state++) {
+			const AirportFTA *current = first;
+			if (first->next != nullptr) {
+				while (current != nullptr && current->heading != state && current->heading != TO_ALL) current = current->next;
+			}
+			transitions[i * (MAX_HEADINGS + 1) + state] = current;
+		}
+	}
+
+	return transitions;
+}
+
 /**
  * Get the finite state machine of an airport type.
  * @param airport_type %Airport type to query FTA from. @see AirportTypes
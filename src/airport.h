@@ -173,8 +173,21 @@ public:
 		return &moving_data[position];
 	}
 
+	/**
+	 * Get the element of the state machine an aircraft takes from a position when heading for a state.
+	 * @param position Position of the aircraft.
+	 * @param state State the aircraft is heading for.
+	 * @return The element to take, or \c nullptr when the aircraft cannot move further.
+	 */
+	const struct AirportFTA *GetTransition(byte position, byte state) const
+	{
+		assert(position < nofelements && state <= MAX_HEADINGS);
+		return this->transitions[position * (MAX_HEADINGS + 1) + state];
+	}
+
 	const AirportMovingData *moving_data; ///< Movement data.
-	struct AirportFTA *layout;            ///< state machine for airport
+	struct AirportFTA *layout;            ///< state machine for airport; the elements of each position are consecutive, the first one being at the index of the position
+	const struct AirportFTA **transitions; ///< Element to take for each position and state that is headed for; see #GetTransition.
 	const byte *terminals;                ///< %Array with the number of terminal groups, followed by the number of terminals in each group.
 	const byte num_helipads;              ///< Number of helipads on this airport. When 0 helicopters will go to normal terminals.
 	Flags flags;                          ///< Flags for this airport type.
@@ -190,6 +203,8 @@ DECLARE_ENUM_AS_BIT_SET(AirportFTAClass::Flags)
 struct AirportFTA {
 	AirportFTA *next;        ///< possible extra movement choices from this position
 	uint64 block;            ///< 64 bit blocks (st->airport.flags), should be enough for the most complex airports
+	uint64 wait_blocks;      ///< Blocks that must be free before moving to the next position from the current one; 0 when staying in the same block.
+	uint64 move_blocks;      ///< Blocks that must be free and are occupied when taking this element; 0 when staying in the same block.
 	byte position;           ///< the position that an airplane is at
 	byte next_position;      ///< next position from this position
 	byte heading;            ///< heading (current orders), guiding an airplane to its target on an airport
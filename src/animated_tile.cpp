@@ -11,24 +11,82 @@
 #include "core/alloc_func.hpp"
 #include "core/smallvec_type.hpp"
 #include "tile_cmd.h"
+#include "map_func.h"
 #include "viewport_func.h"
+#include "date_func.h"
 #include "framerate_type.h"
 
 #include "safeguards.h"
 
+/** State of a tile with respect to the animated tile table. */
+enum AnimatedTileState : byte {
+	ATS_NONE,     ///< The tile is not in the table.
+	ATS_ANIMATED, ///< The tile is in the table and animated.
+	ATS_DELETED,  ///< The tile is still in the table, but is removed from it by the next animation loop.
+	ATS_READDED,  ///< The tile was deleted and added again before the animation loop removed it; its hint is outdated.
+};
+
+/**
+ * Knowledge about when an animated tile has its next frame, so the animation
+ * loop does not need to call its AnimateTile proc on the other ticks.
+ * The hint is only used as long as the tile itself did not change.
+ */
+struct AnimatedTileHint {
+	uint16 period_mask;   ///< The tile only animates in ticks where none of these bits of the tick counter are set; 0 to animate it at every tick.
+	TileTypeHeight mth;   ///< Type and height of the tile when the hint was made.
+	Tile m;               ///< Map contents of the tile when the hint was made.
+	TileExtended me;      ///< Extended map contents of the tile when the hint was made.
+
+	/**
+	 * Check whether the AnimateTile proc of the tile would not do anything at the current tick.
+	 * @param tile The tile of the hint.
+	 * @return True if the tile can be skipped.
+	 */
+	inline bool CanSkip(TileIndex tile) const
+	{
+		return (_tick_counter & this->period_mask) != 0 &&
+				memcmp(&this->mth, &_mth[tile], sizeof(this->mth)) == 0 &&
+				memcmp(&this->m, &_m[tile], sizeof(this->m)) == 0 &&
+				memcmp(&this->me, &_me[tile], sizeof(this->me)) == 0;
+	}
+
+	/**
+	 * Remember when the tile animates next.
+	 * @param tile The tile of the hint.
+	 * @param period_mask The mask set by SetAnimatedTileSpeed() while animating the tile.
+	 */
+	inline void Update(TileIndex tile, uint16 period_mask)
+	{
+		this->period_mask = period_mask;
+		if (period_mask == 0) return;
+		this->mth = _mth[tile];
+		this->m = _m[tile];
+		this->me = _me[tile];
+	}
+};
+
 /** The table/list with animated tiles. */
 std::vector<TileIndex> _animated_tiles;
 
+/** The hints of the tiles of #_animated_tiles, at the same positions. */
+static std::vector<AnimatedTileHint> _animated_tile_hints;
+
+/** The #AnimatedTileState of each tile of the map, so tiles can be added and deleted without searching the table. */
+static std::vector<AnimatedTileState> _animated_tile_state;
+
+static TileIndex _animating_tile = INVALID_TILE; ///< The tile the animation loop is calling AnimateTile for.
+static uint16 _animating_tile_period_mask;       ///< The period mask of #_animating_tile, as set by SetAnimatedTileSpeed().
+
 /**
  * Removes the given tile from the animated tile table.
+ * The tile is only marked as deleted; the animation loop removes it
+ * from the table, so the order of the remaining tiles stays the same.
  * @param tile the tile to remove
  */
 void DeleteAnimatedTile(TileIndex tile)
 {
-	auto to_remove = std::find(_animated_tiles.begin(), _animated_tiles.end(), tile);
-	if (to_remove != _animated_tiles.end()) {
-		/* The order of the remaining elements must stay the same, otherwise the animation loop may miss a tile. */
-		_animated_tiles.erase(to_remove);
+	if (_animated_tile_state[tile] == ATS_ANIMATED || _animated_tile_state[tile] == ATS_READDED) {
+		_animated_tile_state[tile] = ATS_DELETED;
 		MarkTileDirtyByTile(tile);
 	}
 }
@@ -41,31 +99,133 @@ void DeleteAnimatedTile(TileIndex tile)
 void AddAnimatedTile(TileIndex tile)
 {
 	MarkTileDirtyByTile(tile);
-	include(_animated_tiles, tile);
+	switch (_animated_tile_state[tile]) {
+		case ATS_NONE:
+			_animated_tiles.push_back(tile);
+			_animated_tile_hints.emplace_back();
+			_animated_tile_state[tile] = ATS_ANIMATED;
+			break;
+
+		case ATS_DELETED:
+			/* Still in the table at its old position. */
+			_animated_tile_state[tile] = ATS_READDED;
+			break;
+
+		default:
+			break;
+	}
+}
+
+/**
+ * Tell the animation loop that the tile being animated has a fixed animation
+ * speed, i.e. that its AnimateTile proc does nothing but on the ticks where
+ * the tick counter is a multiple of 2 to the power of that speed. The hint
+ * stays valid until the contents of the tile change.
+ * @param tile The tile being animated.
+ * @param animation_speed The animation speed of the tile.
+ */
+void SetAnimatedTileSpeed(TileIndex tile, uint8 animation_speed)
+{
+	if (tile == _animating_tile) _animating_tile_period_mask = (uint16)((1U << animation_speed) - 1);
 }
 
 /**
  * Animate all tiles in the animated tile list, i.e.\ call AnimateTile on them.
+ * Tiles that are not due for their next frame according to their hint are
+ * skipped, and deleted tiles are removed from the list at the same time.
  */
 void AnimateAnimatedTiles()
 {
 	PerformanceAccumulator framerate(PFE_GL_LANDSCAPE);
 
-	const TileIndex *ti = _animated_tiles.data();
-	while (ti < _animated_tiles.data() + _animated_tiles.size()) {
-		const TileIndex curr = *ti;
-		AnimateTile(curr);
-		/* During the AnimateTile call, DeleteAnimatedTile could have been called,
-		 * deleting an element we've already processed and pushing the rest one
-		 * slot to the left. We can detect this by checking whether the index
-		 * in the current slot has changed - if it has, an element has been deleted,
-		 * and we should process the current slot again instead of going forward.
-		 * NOTE: this will still break if more than one animated tile is being
-		 *       deleted during the same AnimateTile call, but no code seems to
-		 *       be doing this anyway.
-		 */
-		if (*ti == curr) ++ti;
+	/* AnimateTile may add tiles to the end of the table, which are then animated
+	 * in this loop too, so the table is indexed instead of using iterators. */
+	size_t kept = 0;
+	for (size_t i = 0; i < _animated_tiles.size(); i++) {
+		const TileIndex curr = _animated_tiles[i];
+		AnimatedTileHint hint = _animated_tile_hints[i];
+		AnimatedTileState &state = _animated_tile_state[curr];
+
+		if (state == ATS_READDED) {
+			state = ATS_ANIMATED;
+			hint.period_mask = 0;
+		}
+		if (state == ATS_ANIMATED && !hint.CanSkip(curr)) {
+			_animating_tile = curr;
+			_animating_tile_period_mask = 0;
+			AnimateTile(curr);
+			_animating_tile = INVALID_TILE;
+			hint.Update(curr, _animating_tile_period_mask);
+
+			/* The tile may have been deleted, or deleted and added again, during its own AnimateTile call. */
+			if (state == ATS_READDED) {
+				state = ATS_ANIMATED;
+				hint.period_mask = 0;
+			}
+		}
+		if (state == ATS_DELETED) {
+			state = ATS_NONE;
+			continue;
+		}
+		_animated_tiles[kept] = curr;
+		_animated_tile_hints[kept] = hint;
+		kept++;
+	}
+	_animated_tiles.resize(kept);
+	_animated_tile_hints.resize(kept);
+}
+
+/**
+ * Remove the deleted tiles from the animated tile table without animating
+ * anything, e.g. before the table is saved.
+ */
+void RemoveDeletedAnimatedTiles()
+{
+	size_t kept = 0;
+	for (size_t i = 0; i < _animated_tiles.size(); i++) {
+		const TileIndex tile = _animated_tiles[i];
+		AnimatedTileHint hint = _animated_tile_hints[i];
+		AnimatedTileState &state = _animated_tile_state[tile];
+
+		if (state == ATS_DELETED) {
+			state = ATS_NONE;
+			continue;
+		}
+		if (state == ATS_READDED) {
+			state = ATS_ANIMATED;
+			hint.period_mask = 0;
+		}
+		_animated_tiles[kept] = tile;
+		_animated_tile_hints[kept] = hint;
+		kept++;
 	}
+	_animated_tiles.resize(kept);
+	_animated_tile_hints.resize(kept);
+}
+
+/**
+ * Forget when the animated tiles have their next frame, e.g. because the
+ * NewGRFs were reloaded and the animation speeds may have changed.
+ */
+void ResetAnimatedTileHints()
+{
+	for (AnimatedTileHint &hint : _animated_tile_hints) hint.period_mask = 0;
+}
+
+/**
+ * Rebuild the state of the tiles after the animated tile table has been
+ * loaded. Duplicate entries of old savegames are removed.
+ */
+void AfterLoadAnimatedTiles()
+{
+	_animated_tile_state.assign(MapSize(), ATS_NONE);
+	auto last = std::remove_if(_animated_tiles.begin(), _animated_tiles.end(), [](TileIndex tile) {
+		if (_animated_tile_state[tile] != ATS_NONE) return true;
+		_animated_tile_state[tile] = ATS_ANIMATED;
+		return false;
+	});
+	_animated_tiles.erase(last, _animated_tiles.end());
+	_animated_tile_hints.assign(_animated_tiles.size(), AnimatedTileHint());
 }
 
 /**
@@ -74,4 +234,6 @@ void AnimateAnimatedTiles()
 void InitializeAnimatedTiles()
 {
 	_animated_tiles.clear();
+	_animated_tile_hints.clear();
+	_animated_tile_state.assign(MapSize(), ATS_NONE);
 }
@@ -14,7 +14,11 @@
 
 void AddAnimatedTile(TileIndex tile);
 void DeleteAnimatedTile(TileIndex tile);
+void SetAnimatedTileSpeed(TileIndex tile, uint8 animation_speed);
 void AnimateAnimatedTiles();
 void InitializeAnimatedTiles();
+void RemoveDeletedAnimatedTiles();
+void ResetAnimatedTileHints();
+void AfterLoadAnimatedTiles();
 
 #endif /* ANIMATED_TILE_FUNC_H */
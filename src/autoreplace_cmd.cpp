@@ -20,6 +20,7 @@
 #include "vehiclelist.h"
 #include "road.h"
 #include "ai/ai.hpp"
+#include <map>
 
 #include "table/strings.h"
 
@@ -235,6 +236,61 @@ static CargoID GetNewCargoTypeForReplace(Vehicle *v, EngineID engine_type, bool
 	}
 }
 
+/** The engine replacement settings of a company for an engine in a group. */
+struct AutoreplaceDecision {
+	EngineID replacement;       ///< The engine to replace with, or INVALID_ENGINE.
+	bool replace_when_old;      ///< Whether to only replace vehicles that are old.
+	bool replacement_buildable; ///< Whether the company can build the replacement engine.
+	bool engine_buildable;      ///< Whether the company can build the engine itself, for autorenew.
+};
+
+static CompanyID _autoreplace_batch_company = INVALID_COMPANY; ///< Company of the current batch of autoreplaces, or INVALID_COMPANY.
+static std::map<std::pair<EngineID, GroupID>, AutoreplaceDecision> _autoreplace_decisions; ///< Cached decisions of the current batch.
+
+/**
+ * Start a batch of autoreplaces of a company. Until the batch ends, the replacement
+ * settings and engine availability are looked up once per engine and group.
+ * Neither may change during the batch, so only autoreplace commands may be executed.
+ * @param company The company whose vehicles are autoreplaced.
+ */
+void StartAutoreplaceBatch(CompanyID company)
+{
+	_autoreplace_batch_company = company;
+	_autoreplace_decisions.clear();
+}
+
+/** End the batch of autoreplaces, and forget its cached decisions. */
+void EndAutoreplaceBatch()
+{
+	_autoreplace_batch_company = INVALID_COMPANY;
+	_autoreplace_decisions.clear();
+}
+
+/**
+ * Get the engine replacement settings of a company for an engine, from the cache of the current batch if possible.
+ * @param c The company.
+ * @param type The type of the engine.
+ * @param engine The engine to replace.
+ * @param group The group of the vehicle.
+ * @return The decision.
+ */
+static AutoreplaceDecision GetAutoreplaceDecision(const Company *c, VehicleType type, EngineID engine, GroupID group)
+{
+	bool cache = c->index == _autoreplace_batch_company;
+	if (cache) {
+		auto it = _autoreplace_decisions.find(std::make_pair(engine, group));
+		if (it != _autoreplace_decisions.end()) return it->second;
+	}
+
+	AutoreplaceDecision d;
+	d.replacement = EngineReplacementForCompany(c, engine, group, &d.replace_when_old);
+	d.replacement_buildable = d.replacement != INVALID_ENGINE && IsEngineBuildable(d.replacement, type, c->index);
+	d.engine_buildable = IsEngineBuildable(engine, type, c->index);
+
+	if (cache) _autoreplace_decisions[std::make_pair(engine, group)] = d;
+	return d;
+}
+
 /**
  * Get the EngineID of the replacement for a vehicle
  * @param v The vehicle to find a replacement for
@@ -254,12 +310,13 @@ static CommandCost GetNewEngineType(const Vehicle *v, const Company *c, bool alw
 		return CommandCost();
 	}
 
-	bool replace_when_old;
-	e = EngineReplacementForCompany(c, v->engine_type, v->group_id, &replace_when_old);
-	if (!always_replace && replace_when_old && !v->NeedsAutorenewing(c, false)) e = INVALID_ENGINE;
+	assert(c->index == _current_company);
+	AutoreplaceDecision d = GetAutoreplaceDecision(c, v->type, v->engine_type, v->group_id);
+	e = d.replacement;
+	if (!always_replace && d.replace_when_old && !v->NeedsAutorenewing(c, false)) e = INVALID_ENGINE;
 
 	/* Autoreplace, if engine is available */
-	if (e != INVALID_ENGINE && IsEngineBuildable(e, v->type, _current_company)) {
+	if (e != INVALID_ENGINE && d.replacement_buildable) {
 		return CommandCost();
 	}
 
@@ -267,7 +324,8 @@ static CommandCost GetNewEngineType(const Vehicle *v, const Company *c, bool alw
 	if (v->NeedsAutorenewing(c)) e = v->engine_type;
 
 	/* Nothing to do or all is fine? */
-	if (e == INVALID_ENGINE || IsEngineBuildable(e, v->type, _current_company)) return CommandCost();
+	if (e == INVALID_ENGINE) return CommandCost();
+	if (e == v->engine_type ? d.engine_buildable : d.replacement_buildable) return CommandCost();
 
 	/* The engine we need is not available. Report error to user */
 	return CommandCost(STR_ERROR_RAIL_VEHICLE_NOT_AVAILABLE + v->type);
@@ -663,6 +721,41 @@ static CommandCost ReplaceChain(Vehicle **chain, DoCommandFlag flags, bool wagon
 	return cost;
 }
 
+/**
+ * Test whether any part of a vehicle is to be replaced or renewed.
+ * @param v The vehicle.
+ * @param c The vehicle's owner.
+ * @param free_wagon Whether \a v is a free wagon, which is replaced on its own.
+ * @param[out] any_replacements Set to true if any part is to be replaced or renewed.
+ * @return Error if the engine to build for a part is not available.
+ */
+static CommandCost CheckAnyReplacements(const Vehicle *v, const Company *c, bool free_wagon, bool *any_replacements)
+{
+	*any_replacements = false;
+	for (const Vehicle *w = v; w != nullptr; w = (!free_wagon && w->type == VEH_TRAIN ? Train::From(w)->GetNextUnit() : nullptr)) {
+		EngineID e;
+		CommandCost cost = GetNewEngineType(w, c, false, e);
+		if (cost.Failed()) return cost;
+		*any_replacements |= (e != INVALID_ENGINE);
+	}
+	return CommandCost();
+}
+
+/**
+ * Test cheaply whether executing #CMD_AUTOREPLACE_VEHICLE for a primary vehicle may do
+ * anything, i.e. whether it may replace something or report an error.
+ * @param v The primary vehicle; its owner has to be the current company.
+ * @return False if the command would certainly end with nothing to do.
+ */
+bool AutoreplaceMayHaveWork(const Vehicle *v)
+{
+	assert(v->IsPrimaryVehicle() && v->owner == _current_company);
+
+	bool any_replacements;
+	CommandCost ret = CheckAnyReplacements(v, Company::Get(_current_company), false, &any_replacements);
+	return ret.Failed() || any_replacements;
+}
+
 /**
  * Autoreplaces a vehicle
  * Trains are replaced as a whole chain, free wagons in depot are replaced on their own
@@ -698,15 +791,9 @@ CommandCost CmdAutoreplaceVehicle(TileIndex tile, DoCommandFlag flags, uint32 p1
 	bool wagon_removal = c->settings.renew_keep_length;
 
 	/* Test whether any replacement is set, before issuing a whole lot of commands that would end in nothing changed */
-	Vehicle *w = v;
 	bool any_replacements = false;
-	while (w != nullptr) {
-		EngineID e;
-		CommandCost cost = GetNewEngineType(w, c, false, e);
-		if (cost.Failed()) return cost;
-		any_replacements |= (e != INVALID_ENGINE);
-		w = (!free_wagon && w->type == VEH_TRAIN ? Train::From(w)->GetNextUnit() : nullptr);
-	}
+	CommandCost ret_check = CheckAnyReplacements(v, c, free_wagon, &any_replacements);
+	if (ret_check.Failed()) return ret_check;
 
 	CommandCost cost = CommandCost(EXPENSES_NEW_VEHICLES, 0);
 	bool nothing_to_do = true;
@@ -97,4 +97,8 @@ static inline CommandCost RemoveEngineReplacementForCompany(Company *c, EngineID
 
 bool CheckAutoreplaceValidity(EngineID from, EngineID to, CompanyID company);
 
+void StartAutoreplaceBatch(CompanyID company);
+void EndAutoreplaceBatch();
+bool AutoreplaceMayHaveWork(const Vehicle *v);
+
 #endif /* AUTOREPLACE_FUNC_H */
@@ -20,6 +20,8 @@
 struct IniFile;
 struct ContentInfo;
 
+void SaveBaseSetMD5Cache();
+
 /** Structure holding filename and MD5 information about a single file */
 struct MD5File {
 	/** The result of a checksum check */
@@ -198,7 +200,9 @@ public:
 		BaseMedia<Tbase_set> fs;
 		/* Searching in tars is only done in the old "data" directories basesets. */
 		uint num = fs.Scan(GetExtension(), Tbase_set::SEARCH_IN_TARS ? OLD_DATA_DIR : OLD_GM_DIR, Tbase_set::SEARCH_IN_TARS);
-		return num + fs.Scan(GetExtension(), BASESET_DIR, Tbase_set::SEARCH_IN_TARS);
+		num += fs.Scan(GetExtension(), BASESET_DIR, Tbase_set::SEARCH_IN_TARS);
+		SaveBaseSetMD5Cache();
+		return num;
 	}
 
 	static Tbase_set *GetAvailableSets();
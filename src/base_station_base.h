@@ -169,6 +169,7 @@ struct BaseStation : StationPool::PoolItem<&_station_pool> {
 	}
 
 	static void PostDestructor(size_t index);
+	static size_t GetPoolSlotSize();
 
 private:
 	void FillCachedName() const;
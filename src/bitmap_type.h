@@ -14,11 +14,13 @@
 
 /** Represents a tile area containing containing individually set tiles.
  * Each tile must be contained within the preallocated area.
- * A std::vector<bool> is used to mark which tiles are contained.
+ * A std::vector<bool> is used to mark which tiles are contained,
+ * unless all tiles of the area are contained.
  */
 class BitmapTileArea : public TileArea {
 protected:
 	std::vector<bool> data;
+	bool full; ///< All tiles of the area are contained, and #data is not used.
 
 	inline uint Index(uint x, uint y) const { return y * this->w + x; }
 
@@ -30,6 +32,7 @@ public:
 		this->tile = INVALID_TILE;
 		this->w = 0;
 		this->h = 0;
+		this->full = false;
 	}
 
 	BitmapTileArea(const TileArea &ta)
@@ -37,6 +40,7 @@ public:
 		this->tile = ta.tile;
 		this->w = ta.w;
 		this->h = ta.h;
+		this->full = false;
 		this->data.resize(Index(this->w, this->h));
 	}
 
@@ -48,6 +52,7 @@ public:
 		this->tile = INVALID_TILE;
 		this->w = 0;
 		this->h = 0;
+		this->full = false;
 		this->data.clear();
 	}
 
@@ -60,15 +65,32 @@ public:
 		this->tile = TileXY(r.left, r.top);
 		this->w = r.right - r.left + 1;
 		this->h = r.bottom - r.top + 1;
+		this->full = false;
 		this->data.clear();
 		this->data.resize(Index(w, h));
 	}
 
+	/**
+	 * Initialize the BitmapTileArea with the specified Rect, with all its tiles set.
+	 * No bitmap is stored until a tile is cleared.
+	 * @param rect Rect to use.
+	 */
+	void InitializeFull(const Rect &r)
+	{
+		this->tile = TileXY(r.left, r.top);
+		this->w = r.right - r.left + 1;
+		this->h = r.bottom - r.top + 1;
+		this->full = true;
+		this->data.clear();
+		this->data.shrink_to_fit();
+	}
+
 	void Initialize(const TileArea &ta)
 	{
 		this->tile = ta.tile;
 		this->w = ta.w;
 		this->h = ta.h;
+		this->full = false;
 		this->data.clear();
 		this->data.resize(Index(w, h));
 	}
@@ -80,6 +102,7 @@ public:
 	inline void SetTile(TileIndex tile)
 	{
 		assert(this->Contains(tile));
+		if (this->full) return;
 		this->data[Index(tile)] = true;
 	}
 
@@ -90,6 +113,10 @@ public:
 	inline void ClrTile(TileIndex tile)
 	{
 		assert(this->Contains(tile));
+		if (this->full) {
+			this->full = false;
+			this->data.assign(Index(this->w, this->h), true);
+		}
 		this->data[Index(tile)] = false;
 	}
 
@@ -99,7 +126,7 @@ public:
 	 */
 	inline bool HasTile(TileIndex tile) const
 	{
-		return this->Contains(tile) && this->data[Index(tile)];
+		return this->Contains(tile) && (this->full || this->data[Index(tile)]);
 	}
 };
 
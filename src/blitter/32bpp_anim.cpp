@@ -259,6 +259,8 @@ void Blitter_32bppAnim::Draw(Blitter::BlitterParams *bp, BlitterMode mode, ZoomL
 		return;
 	}
 
+	this->MarkAnimated(bp->dst, bp->left, bp->top, bp->width, bp->height);
+
 	switch (mode) {
 		default: NOT_REACHED();
 		case BM_NORMAL:       Draw<BM_NORMAL>      (bp, zoom); return;
@@ -277,6 +279,8 @@ void Blitter_32bppAnim::DrawColourMappingRect(void *dst, int width, int height,
 		return;
 	}
 
+	this->MarkAnimated(dst, 0, 0, width, height);
+
 	Colour *udst = (Colour *)dst;
 	uint16 *anim = this->anim_buf + this->ScreenToAnimOffset((uint32 *)dst);
 
@@ -317,6 +321,7 @@ void Blitter_32bppAnim::SetPixel(void *video, int x, int y, uint8 colour)
 	/* Set the colour in the anim-buffer too, if we are rendering to the screen */
 	if (_screen_disable_anim) return;
 
+	if (colour >= PALETTE_ANIM_START) this->MarkAnimated(video, x, y, 1, 1);
 	this->anim_buf[this->ScreenToAnimOffset((uint32 *)video) + x + y * this->anim_buf_pitch] = colour | (DEFAULT_BRIGHTNESS << 8);
 }
 
@@ -329,6 +334,8 @@ void Blitter_32bppAnim::DrawLine(void *video, int x, int y, int x2, int y2, int
 			*((Colour *)video + x + y * _screen.pitch) = c;
 		});
 	} else {
+		if (colour >= PALETTE_ANIM_START) this->MarkAnimated(video, 0, 0, screen_width, screen_height);
+
 		uint16 * const offset_anim_buf = this->anim_buf + this->ScreenToAnimOffset((uint32 *)video);
 		const uint16 anim_colour = colour | (DEFAULT_BRIGHTNESS << 8);
 		this->DrawLineGeneric(x, y, x2, y2, screen_width, screen_height, width, dash, [&](int x, int y) {
@@ -346,9 +353,17 @@ void Blitter_32bppAnim::DrawRect(void *video, int width, int height, uint8 colou
 		return;
 	}
 
+	if (colour >= PALETTE_ANIM_START) this->MarkAnimated(video, 0, 0, width, height);
+
 	Colour colour32 = LookupColourInPalette(colour);
 	uint16 *anim_line = this->ScreenToAnimOffset((uint32 *)video) + this->anim_buf;
 
+	/* Rectangles spanning the whole pitch of both buffers are one contiguous block. */
+	if (width == _screen.pitch && width == this->anim_buf_pitch) {
+		width *= height;
+		height = 1;
+	}
+
 	do {
 		Colour *dst = (Colour *)video;
 		uint16 *anim = anim_line;
@@ -369,6 +384,8 @@ void Blitter_32bppAnim::CopyFromBuffer(void *video, const void *src, int width,
 {
 	assert(!_screen_disable_anim);
 	assert(video >= _screen.dst_ptr && video <= (uint32 *)_screen.dst_ptr + _screen.width + _screen.height * _screen.pitch);
+	this->MarkAnimated(video, 0, 0, width, height);
+
 	Colour *dst = (Colour *)video;
 	const uint32 *usrc = (const uint32 *)src;
 	uint16 *anim_line = this->ScreenToAnimOffset((uint32 *)video) + this->anim_buf;
@@ -433,6 +450,9 @@ void Blitter_32bppAnim::ScrollBuffer(void *video, int &left, int &top, int &widt
 	assert(video >= _screen.dst_ptr && video <= (uint32 *)_screen.dst_ptr + _screen.width + _screen.height * _screen.pitch);
 	uint16 *dst, *src;
 
+	/* Animated pixels may be scrolled anywhere into the area. */
+	this->MarkAnimated(video, left, top, width, height);
+
 	/* We need to scroll the anim-buffer too */
 	if (scroll_y > 0) {
 		dst = this->anim_buf + left + (top + height - 1) * this->anim_buf_pitch;
@@ -483,30 +503,51 @@ int Blitter_32bppAnim::BufferSize(int width, int height)
 	return width * height * (sizeof(uint32) + sizeof(uint16));
 }
 
-void Blitter_32bppAnim::PaletteAnimate(const Palette &palette)
+/**
+ * Remember that a part of the screen may contain palette animated pixels.
+ * @param video Pointer into the screen the part is relative to.
+ * @param left The left of the part, relative to \a video.
+ * @param top The top of the part, relative to \a video.
+ * @param width The width of the part.
+ * @param height The height of the part.
+ */
+void Blitter_32bppAnim::MarkAnimated(const void *video, int left, int top, int width, int height)
 {
-	assert(!_screen_disable_anim);
+	if (this->anim_cells_pitch == 0) return;
 
-	this->palette = palette;
-	/* If first_dirty is 0, it is for 8bpp indication to send the new
-	 *  palette. However, only the animation colours might possibly change.
-	 *  Especially when going between toyland and non-toyland. */
-	assert(this->palette.first_dirty == PALETTE_ANIM_START || this->palette.first_dirty == 0);
+	const int offset = this->ScreenToAnimOffset((const uint32 *)video);
+	left += offset % this->anim_buf_pitch;
+	top += offset / this->anim_buf_pitch;
 
-	const uint16 *anim = this->anim_buf;
-	Colour *dst = (Colour *)_screen.dst_ptr;
+	const int right = min(left + width, this->anim_buf_width);
+	const int bottom = min(top + height, this->anim_buf_height);
+	left = max(left, 0);
+	top = max(top, 0);
+	if (left >= right || top >= bottom) return;
+
+	for (int y = top / ANIM_CELL_HEIGHT; y <= (bottom - 1) / ANIM_CELL_HEIGHT; y++) {
+		for (int x = left / ANIM_CELL_WIDTH; x <= (right - 1) / ANIM_CELL_WIDTH; x++) {
+			this->anim_cells[y * this->anim_cells_pitch + x] = true;
+		}
+	}
+}
+
+bool Blitter_32bppAnim::PaletteAnimateRect(int left, int top, int width, int height)
+{
+	const uint16 *anim = this->anim_buf + top * this->anim_buf_pitch + left;
+	Colour *dst = (Colour *)_screen.dst_ptr + top * _screen.pitch + left;
+	bool animated = false;
 
-	/* Let's walk the anim buffer and try to find the pixels */
-	const int width = this->anim_buf_width;
 	const int pitch_offset = _screen.pitch - width;
 	const int anim_pitch_offset = this->anim_buf_pitch - width;
-	for (int y = this->anim_buf_height; y != 0 ; y--) {
+	for (int y = height; y != 0 ; y--) {
 		for (int x = width; x != 0 ; x--) {
 			uint16 value = *anim;
 			uint8 colour = GB(value, 0, 8);
 			if (colour >= PALETTE_ANIM_START) {
 				/* Update this pixel */
 				*dst = this->AdjustBrightness(LookupColourInPalette(colour), GB(value, 8, 8));
+				animated = true;
 			}
 			dst++;
 			anim++;
@@ -515,8 +556,48 @@ void Blitter_32bppAnim::PaletteAnimate(const Palette &palette)
 		anim += anim_pitch_offset;
 	}
 
-	/* Make sure the backend redraws the whole screen */
-	VideoDriver::GetInstance()->MakeDirty(0, 0, _screen.width, _screen.height);
+	return animated;
+}
+
+void Blitter_32bppAnim::PaletteAnimate(const Palette &palette)
+{
+	assert(!_screen_disable_anim);
+
+	this->palette = palette;
+	/* If first_dirty is 0, it is for 8bpp indication to send the new
+	 *  palette. However, only the animation colours might possibly change.
+	 *  Especially when going between toyland and non-toyland. */
+	assert(this->palette.first_dirty == PALETTE_ANIM_START || this->palette.first_dirty == 0);
+
+	/* Only walk the cells that may contain animated pixels. Cells that turn out
+	 * not to contain any are skipped until something is drawn in them again. */
+	int dirty_left = this->anim_buf_width;
+	int dirty_top = this->anim_buf_height;
+	int dirty_right = 0;
+	int dirty_bottom = 0;
+	const int rows = (this->anim_buf_height + ANIM_CELL_HEIGHT - 1) / ANIM_CELL_HEIGHT;
+	for (int cy = 0; cy < rows; cy++) {
+		for (int cx = 0; cx < this->anim_cells_pitch; cx++) {
+			if (!this->anim_cells[cy * this->anim_cells_pitch + cx]) continue;
+
+			const int left = cx * ANIM_CELL_WIDTH;
+			const int top = cy * ANIM_CELL_HEIGHT;
+			const int width = min(ANIM_CELL_WIDTH, this->anim_buf_width - left);
+			const int height = min(ANIM_CELL_HEIGHT, this->anim_buf_height - top);
+			if (!this->PaletteAnimateRect(left, top, width, height)) {
+				this->anim_cells[cy * this->anim_cells_pitch + cx] = false;
+				continue;
+			}
+
+			dirty_left = min(dirty_left, left);
+			dirty_top = min(dirty_top, top);
+			dirty_right = max(dirty_right, left + width);
+			dirty_bottom = max(dirty_bottom, top + height);
+		}
+	}
+
+	/* Make sure the backend redraws the animated part of the screen */
+	if (dirty_left < dirty_right) VideoDriver::GetInstance()->MakeDirty(dirty_left, dirty_top, dirty_right - dirty_left, dirty_bottom - dirty_top);
 }
 
 Blitter::PaletteAnimation Blitter_32bppAnim::UsePaletteAnimation()
@@ -537,5 +618,9 @@ void Blitter_32bppAnim::PostResize()
 
 		/* align buffer to next 16 byte boundary */
 		this->anim_buf = reinterpret_cast<uint16 *>((reinterpret_cast<uintptr_t>(this->anim_alloc) + 0xF) & (~0xF));
+
+		/* The new buffer is empty, so nothing is animated yet. */
+		this->anim_cells_pitch = (this->anim_buf_width + ANIM_CELL_WIDTH - 1) / ANIM_CELL_WIDTH;
+		this->anim_cells.assign(this->anim_cells_pitch * ((this->anim_buf_height + ANIM_CELL_HEIGHT - 1) / ANIM_CELL_HEIGHT), false);
 	}
 }
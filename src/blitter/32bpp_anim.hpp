@@ -11,6 +11,7 @@
 #define BLITTER_32BPP_ANIM_HPP
 
 #include "32bpp_optimized.hpp"
+#include <vector>
 
 /** The optimised 32 bpp blitter with palette animation. */
 class Blitter_32bppAnim : public Blitter_32bppOptimized {
@@ -22,13 +23,31 @@ protected:
 	int anim_buf_pitch;  ///< The pitch of the animation buffer (width rounded up to 16 byte boundary).
 	Palette palette;     ///< The current palette.
 
+	static const int ANIM_CELL_WIDTH = 64; ///< Width of a cell of #anim_cells, in pixels; a multiple of the SIMD width.
+	static const int ANIM_CELL_HEIGHT = 8; ///< Height of a cell of #anim_cells, in pixels.
+	std::vector<bool> anim_cells;          ///< For each cell of the screen, whether it may contain palette animated pixels.
+	int anim_cells_pitch;                  ///< Number of cells in a row of #anim_cells.
+
+	void MarkAnimated(const void *video, int left, int top, int width, int height);
+
+	/**
+	 * Redraw the palette animated pixels of a part of the screen with the current palette.
+	 * @param left The left of the part, a multiple of #ANIM_CELL_WIDTH.
+	 * @param top The top of the part.
+	 * @param width The width of the part.
+	 * @param height The height of the part.
+	 * @return True if the part contains palette animated pixels.
+	 */
+	virtual bool PaletteAnimateRect(int left, int top, int width, int height);
+
 public:
 	Blitter_32bppAnim() :
 		anim_buf(nullptr),
 		anim_alloc(nullptr),
 		anim_buf_width(0),
 		anim_buf_height(0),
-		anim_buf_pitch(0)
+		anim_buf_pitch(0),
+		anim_cells_pitch(0)
 	{
 		this->palette = _cur_palette;
 	}
@@ -46,6 +65,13 @@ public:
 	int BufferSize(int width, int height) override;
 	void PaletteAnimate(const Palette &palette) override;
 	Blitter::PaletteAnimation UsePaletteAnimation() override;
+	void UpdatePalette(const Palette &palette) override { this->palette = palette; }
+
+	const uint16 *GetAnimationBuffer(int *pitch) override
+	{
+		*pitch = this->anim_buf_pitch;
+		return this->anim_buf;
+	}
 
 	const char *GetName() override { return "32bpp-anim"; }
 	int GetBytesPerPixel() override { return 6; }
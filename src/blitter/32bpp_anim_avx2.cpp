@@ -0,0 +1,304 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file 32bpp_anim_avx2.cpp Implementation of the AVX2 32 bpp blitter with animation support. */
+
+#ifdef WITH_SSE
+
+#include "../stdafx.h"
+#include "../video/video_driver.hpp"
+#include "../table/sprites.h"
+#include "32bpp_anim_avx2.hpp"
+#include "32bpp_avx2_func.hpp"
+
+#include "../safeguards.h"
+
+/** Instantiation of the AVX2 32bpp blitter factory. */
+static FBlitter_32bppAVX2_Anim iFBlitter_32bppAVX2_Anim;
+
+/**
+ * Update the animation buffer for eight drawn pixels.
+ * @param anim  First value of the animation buffer to update.
+ * @param value The new values for opaque pixels; translucent pixels get 0 and transparent pixels are left alone.
+ * @param alpha The alpha of the drawn pixels.
+ * @param count The number of pixels to update.
+ */
+static inline void UpdateAnimationBuffer(uint16 *anim, __m128i value, __m128i alpha, uint count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	value = _mm_and_si128(value, _mm_cmpeq_epi16(alpha, _mm_set1_epi16(255)));
+	const __m128i transparent = _mm_cmpeq_epi16(alpha, zero);
+	const __m128i old = LoadUint16sAVX2(anim, count);
+	StoreUint16sAVX2(anim, _mm_blendv_epi8(value, old, transparent), count);
+}
+
+/**
+ * Draws a sprite to a (screen) buffer. It is templated to allow faster operation.
+ * Pixels are handled in blocks of eight; the last block of a line is masked.
+ *
+ * @tparam mode blitter mode
+ * @param bp further blitting parameters
+ * @param zoom zoom level at which we are drawing
+ */
+IGNORE_UNINITIALIZED_WARNING_START
+template <BlitterMode mode, Blitter_32bppSSE_Base::ReadMode read_mode, bool translucent, bool animated>
+inline void Blitter_32bppAVX2_Anim::Draw(const Blitter::BlitterParams *bp, ZoomLevel zoom)
+{
+	const byte * const remap = bp->remap;
+	Colour *dst_line = (Colour *) bp->dst + bp->top * bp->pitch + bp->left;
+	uint16 *anim_line = this->anim_buf + this->ScreenToAnimOffset((uint32 *)bp->dst) + bp->top * this->anim_buf_pitch + bp->left;
+	int effective_width = bp->width;
+
+	/* Find where to start reading in the source sprite. */
+	const Blitter_32bppSSE_Base::SpriteData * const sd = (const Blitter_32bppSSE_Base::SpriteData *) bp->sprite;
+	const SpriteInfo * const si = &sd->infos[zoom];
+	const MapValue *src_mv_line = (const MapValue *) &sd->data[si->mv_offset] + bp->skip_top * si->sprite_width;
+	const Colour *src_rgba_line = (const Colour *) ((const byte *) &sd->data[si->sprite_offset] + bp->skip_top * si->sprite_line_size);
+
+	if (read_mode != RM_WITH_MARGIN) {
+		src_rgba_line += bp->skip_left;
+		src_mv_line += bp->skip_left;
+	}
+	const MapValue *src_mv = src_mv_line;
+
+	/* Load these variables into register before loop. */
+	const __m256i a_cm        = ALPHA_CONTROL_MASK_AVX2;
+	const __m256i tr_nom_base = TRANSPARENT_NOM_BASE_AVX2;
+	const __m128i m_mask      = _mm_set1_epi16(0xFF);
+	const __m128i zero        = _mm_setzero_si128();
+
+	for (int y = bp->height; y != 0; y--) {
+		Colour *dst = dst_line;
+		const Colour *src = src_rgba_line + META_LENGTH;
+		if (mode != BM_TRANSPARENT) src_mv = src_mv_line;
+		uint16 *anim = anim_line;
+
+		if (read_mode == RM_WITH_MARGIN) {
+			anim += src_rgba_line[0].data;
+			src += src_rgba_line[0].data;
+			dst += src_rgba_line[0].data;
+			if (mode != BM_TRANSPARENT) src_mv += src_rgba_line[0].data;
+			const int width_diff = si->sprite_width - bp->width;
+			effective_width = bp->width - (int) src_rgba_line[0].data;
+			const int delta_diff = (int) src_rgba_line[1].data - width_diff;
+			const int new_width = effective_width - delta_diff;
+			effective_width = delta_diff > 0 ? new_width : effective_width;
+			if (effective_width <= 0) goto next_line;
+		}
+
+		switch (mode) {
+			default:
+				for (int x = effective_width; x > 0; x -= 8, src_mv += 8, src += 8, anim += 8, dst += 8) {
+					const uint count = min(x, 8);
+					__m256i srcs = LoadPixelsAVX2(src, count);
+					const __m128i alpha = AlphaOfEightPixels(srcs);
+					if (_mm_testz_si128(alpha, alpha)) continue;
+
+					__m128i anim_value = zero;
+					if (animated) {
+						anim_value = LoadUint16sAVX2((const uint16 *) src_mv, count);
+
+						/* Remap colours. */
+						const __m256i m = RemapChannelOfEightPixels(anim_value);
+						const __m256i anim_mask = _mm256_cmpgt_epi32(m, _mm256_set1_epi32(PALETTE_ANIM_START - 1));
+						if (!_mm256_testz_si256(anim_mask, anim_mask)) {
+							srcs = LookupColoursInPalette(srcs, m, anim_mask, this->palette.palette);
+
+							/* Only the animated colours still need their brightness; the others got it when encoding. */
+							const __m128i anim_mask16 = _mm_packs_epi32(_mm256_castsi256_si128(anim_mask), _mm256_extracti128_si256(anim_mask, 1));
+							const __m128i bri = _mm_blendv_epi8(_mm_set1_epi16(Blitter_32bppBase::DEFAULT_BRIGHTNESS << 8), anim_value, anim_mask16);
+							srcs = AdjustBrightnessOfEightPixels(srcs, bri);
+						}
+					}
+
+					/* Update anim buffer. */
+					UpdateAnimationBuffer(anim, anim_value, alpha, count);
+
+					/* Blend colours. */
+					if (translucent) {
+						StorePixelsAVX2(dst, AlphaBlendEightPixels(srcs, LoadPixelsAVX2(dst, count), a_cm), count);
+					} else {
+						StoreOpaquePixelsAVX2(dst, srcs, count);
+					}
+				}
+				break;
+
+			case BM_COLOUR_REMAP:
+				for (int x = effective_width; x > 0; x -= 8, src_mv += 8, src += 8, anim += 8, dst += 8) {
+					const uint count = min(x, 8);
+					__m256i srcs = LoadPixelsAVX2(src, count);
+					const __m128i alpha = AlphaOfEightPixels(srcs);
+					if (_mm_testz_si128(alpha, alpha)) continue;
+
+					const __m256i dsts = LoadPixelsAVX2(dst, count);
+					const __m128i mvs = LoadUint16sAVX2((const uint16 *) src_mv, count);
+					__m128i anim_value = zero;
+
+					/* Remap colours. */
+					if (!_mm_testz_si128(mvs, m_mask)) {
+						const __m256i m = RemapChannelOfEightPixels(mvs);
+						const __m256i r = RemapIndicesOfEightPixels(mvs, remap);
+						srcs = RemapEightPixels(srcs, m, r, this->palette.palette);
+
+						if (animated) {
+							/* Opaque remapped pixels get the remapped index with their brightness. */
+							const __m128i r16 = _mm_packus_epi32(_mm256_castsi256_si128(r), _mm256_extracti128_si256(r, 1));
+							const __m128i v16 = _mm_and_si128(mvs, _mm_set1_epi16((short) 0xFF00));
+							const __m128i remapped = _mm_xor_si128(_mm_cmpeq_epi16(_mm_and_si128(mvs, m_mask), zero), _mm_set1_epi16(-1));
+							anim_value = _mm_and_si128(_mm_or_si128(r16, v16), remapped);
+						}
+
+						if (!HasDefaultBrightness(mvs)) srcs = AdjustBrightnessOfEightPixels(srcs, mvs);
+					}
+
+					/* Update anim buffer. */
+					UpdateAnimationBuffer(anim, anim_value, alpha, count);
+
+					/* Blend colours. */
+					StorePixelsAVX2(dst, AlphaBlendEightPixels(srcs, dsts, a_cm), count);
+				}
+				break;
+
+			case BM_TRANSPARENT:
+				/* Make the current colour a bit more black, so it looks like this image is transparent. */
+				for (int x = bp->width; x > 0; x -= 8, src += 8, anim += 8, dst += 8) {
+					const uint count = min(x, 8);
+					const __m256i srcs = LoadPixelsAVX2(src, count);
+					const __m256i dsts = LoadPixelsAVX2(dst, count);
+					StorePixelsAVX2(dst, DarkenEightPixels(srcs, dsts, a_cm, tr_nom_base), count);
+					UpdateAnimationBuffer(anim, zero, AlphaOfEightPixels(srcs), count);
+				}
+				break;
+
+			case BM_CRASH_REMAP:
+				for (uint x = (uint) bp->width; x > 0; x--) {
+					if (src_mv->m == 0) {
+						if (src->a != 0) {
+							uint8 g = MakeDark(src->r, src->g, src->b);
+							*dst = ComposeColourRGBA(g, g, g, src->a, *dst);
+							*anim = 0;
+						}
+					} else {
+						uint r = remap[src_mv->m];
+						if (r != 0) *dst = ComposeColourPANoCheck(this->AdjustBrightness(this->LookupColourInPalette(r), src_mv->v), src->a, *dst);
+					}
+					src_mv++;
+					dst++;
+					src++;
+					anim++;
+				}
+				break;
+
+			case BM_BLACK_REMAP:
+				for (uint x = (uint) bp->width; x > 0; x--) {
+					if (src->a != 0) {
+						*dst = Colour(0, 0, 0);
+						*anim = 0;
+					}
+					src_mv++;
+					dst++;
+					src++;
+					anim++;
+				}
+				break;
+		}
+
+next_line:
+		if (mode != BM_TRANSPARENT) src_mv_line += si->sprite_width;
+		src_rgba_line = (const Colour*) ((const byte*) src_rgba_line + si->sprite_line_size);
+		dst_line += bp->pitch;
+		anim_line += this->anim_buf_pitch;
+	}
+}
+IGNORE_UNINITIALIZED_WARNING_STOP
+
+/**
+ * Draws a sprite to a (screen) buffer. Calls adequate templated function.
+ *
+ * @param bp further blitting parameters
+ * @param mode blitter mode
+ * @param zoom zoom level at which we are drawing
+ */
+void Blitter_32bppAVX2_Anim::Draw(Blitter::BlitterParams *bp, BlitterMode mode, ZoomLevel zoom)
+{
+	const Blitter_32bppSSE_Base::SpriteFlags sprite_flags = ((const Blitter_32bppSSE_Base::SpriteData *) bp->sprite)->flags;
+	/* Sprites without palette animated pixels only clear the animation buffer when drawn normally. */
+	if (!(sprite_flags & SF_NO_ANIM) || (mode != BM_NORMAL && mode != BM_COLOUR_REMAP)) {
+		this->MarkAnimated(bp->dst, bp->left, bp->top, bp->width, bp->height);
+	}
+	switch (mode) {
+		default: {
+bm_normal:
+			if (bp->skip_left != 0 || bp->width <= MARGIN_NORMAL_THRESHOLD) {
+				if (sprite_flags & SF_NO_ANIM) Draw<BM_NORMAL, RM_WITH_SKIP, true, false>(bp, zoom);
+				else                           Draw<BM_NORMAL, RM_WITH_SKIP, true, true>(bp, zoom);
+			} else if (sprite_flags & SF_TRANSLUCENT) {
+				if (sprite_flags & SF_NO_ANIM) Draw<BM_NORMAL, RM_WITH_MARGIN, true, false>(bp, zoom);
+				else                           Draw<BM_NORMAL, RM_WITH_MARGIN, true, true>(bp, zoom);
+			} else {
+				if (sprite_flags & SF_NO_ANIM) Draw<BM_NORMAL, RM_WITH_MARGIN, false, false>(bp, zoom);
+				else                           Draw<BM_NORMAL, RM_WITH_MARGIN, false, true>(bp, zoom);
+			}
+			break;
+		}
+		case BM_COLOUR_REMAP:
+			if (sprite_flags & SF_NO_REMAP) goto bm_normal;
+			if (bp->skip_left != 0 || bp->width <= MARGIN_REMAP_THRESHOLD) {
+				if (sprite_flags & SF_NO_ANIM) Draw<BM_COLOUR_REMAP, RM_WITH_SKIP, true, false>(bp, zoom);
+				else                           Draw<BM_COLOUR_REMAP, RM_WITH_SKIP, true, true>(bp, zoom);
+			} else {
+				if (sprite_flags & SF_NO_ANIM) Draw<BM_COLOUR_REMAP, RM_WITH_MARGIN, true, false>(bp, zoom);
+				else                           Draw<BM_COLOUR_REMAP, RM_WITH_MARGIN, true, true>(bp, zoom);
+			}
+			break;
+		case BM_TRANSPARENT:  Draw<BM_TRANSPARENT, RM_NONE, true, true>(bp, zoom); return;
+		case BM_CRASH_REMAP:  Draw<BM_CRASH_REMAP, RM_NONE, true, true>(bp, zoom); return;
+		case BM_BLACK_REMAP:  Draw<BM_BLACK_REMAP, RM_NONE, true, true>(bp, zoom); return;
+	}
+}
+
+bool Blitter_32bppAVX2_Anim::PaletteAnimateRect(int left, int top, int width, int height)
+{
+	const __m128i anim_cmp = _mm_set1_epi16(PALETTE_ANIM_START - 1);
+	const __m128i colour_mask = _mm_set1_epi16(0xFF);
+	bool animated = false;
+
+	for (int y = top; y < top + height; y++) {
+		const uint16 *anim = this->anim_buf + y * this->anim_buf_pitch + left;
+		Colour *dst = (Colour *)_screen.dst_ptr + y * _screen.pitch + left;
+
+		for (int x = width; x > 0; x -= 8, anim += 8, dst += 8) {
+			const uint count = min(x, 8);
+			const __m128i mvs = LoadUint16sAVX2(anim, count);
+
+			/* The lanes past the end of the line are loaded as 0, which is not animated. */
+			const __m128i anim_mask = _mm_cmpgt_epi16(_mm_and_si128(mvs, colour_mask), anim_cmp);
+			if (_mm_movemask_epi8(anim_mask) == 0) continue;
+			animated = true;
+
+			/* Gather the palette colours of the animated pixels, keeping the other pixels. */
+			const __m256i mask = _mm256_cvtepi16_epi32(anim_mask);
+			const __m256i pixels = LoadPixelsAVX2(dst, count);
+			__m256i colours = _mm256_mask_i32gather_epi32(pixels, (const int *)this->palette.palette, RemapChannelOfEightPixels(mvs), mask, sizeof(Colour));
+			const __m128i brightness = _mm_blendv_epi8(_mm_set1_epi16(Blitter_32bppBase::DEFAULT_BRIGHTNESS << 8), mvs, anim_mask);
+			if (!HasDefaultBrightness(brightness)) {
+				colours = _mm256_blendv_epi8(pixels, AdjustBrightnessOfEightPixels(colours, mvs), mask);
+			}
+			StorePixelsAVX2(dst, colours, count);
+		}
+	}
+
+	return animated;
+}
+
+void Blitter_32bppAVX2_Anim::DrawBatch(Blitter::BlitterParams *bps, uint count, BlitterMode mode, ZoomLevel zoom)
+{
+	/* Call our own Draw directly, so the batch does not go through the vtable for every image. */
+	for (uint i = 0; i < count; i++) Blitter_32bppAVX2_Anim::Draw(&bps[i], mode, zoom);
+}
+
+#endif /* WITH_SSE */
@@ -10,38 +10,30 @@
 #ifdef WITH_SSE
 
 #include "../stdafx.h"
-#include "../video/video_driver.hpp"
 #include "32bpp_anim_sse2.hpp"
 #include "32bpp_sse_func.hpp"
 
+#include "../table/sprites.h"
+
 #include "../safeguards.h"
 
 /** Instantiation of the partially SSSE2 32bpp with animation blitter factory. */
 static FBlitter_32bppSSE2_Anim iFBlitter_32bppSSE2_Anim;
 
-void Blitter_32bppSSE2_Anim::PaletteAnimate(const Palette &palette)
+bool Blitter_32bppSSE2_Anim::PaletteAnimateRect(int left, int top, int width, int height)
 {
-	assert(!_screen_disable_anim);
-
-	this->palette = palette;
-	/* If first_dirty is 0, it is for 8bpp indication to send the new
-	 *  palette. However, only the animation colours might possibly change.
-	 *  Especially when going between toyland and non-toyland. */
-	assert(this->palette.first_dirty == PALETTE_ANIM_START || this->palette.first_dirty == 0);
-
-	const uint16 *anim = this->anim_buf;
-	Colour *dst = (Colour *)_screen.dst_ptr;
+	const uint16 *anim = this->anim_buf + top * this->anim_buf_pitch + left;
+	Colour *dst = (Colour *)_screen.dst_ptr + top * _screen.pitch + left;
 
-	bool screen_dirty = false;
+	bool animated = false;
 
 	/* Let's walk the anim buffer and try to find the pixels */
-	const int width = this->anim_buf_width;
 	const int screen_pitch = _screen.pitch;
 	const int anim_pitch = this->anim_buf_pitch;
 	__m128i anim_cmp = _mm_set1_epi16(PALETTE_ANIM_START - 1);
 	__m128i brightness_cmp = _mm_set1_epi16(Blitter_32bppBase::DEFAULT_BRIGHTNESS);
 	__m128i colour_mask = _mm_set1_epi16(0xFF);
-	for (int y = this->anim_buf_height; y != 0 ; y--) {
+	for (int y = height; y != 0 ; y--) {
 		Colour *next_dst_ln = dst + screen_pitch;
 		const uint16 *next_anim_ln = anim + anim_pitch;
 		int x = width;
@@ -64,7 +56,7 @@ void Blitter_32bppSSE2_Anim::PaletteAnimate(const Palette &palette)
 						if (colour >= PALETTE_ANIM_START) {
 							/* Update this pixel */
 							*dst = AdjustBrightneSSE(LookupColourInPalette(colour), GB(value, 8, 8));
-							screen_dirty = true;
+							animated = true;
 						}
 						data = _mm_srli_si128(data, 2);
 						dst++;
@@ -76,7 +68,7 @@ void Blitter_32bppSSE2_Anim::PaletteAnimate(const Palette &palette)
 						colour_data = _mm_srli_si128(colour_data, 2);
 						dst++;
 					}
-					screen_dirty = true;
+					animated = true;
 				}
 			} else {
 				/* fast path, no animation */
@@ -89,10 +81,39 @@ void Blitter_32bppSSE2_Anim::PaletteAnimate(const Palette &palette)
 		anim = next_anim_ln;
 	}
 
-	if (screen_dirty) {
-		/* Make sure the backend redraws the whole screen */
-		VideoDriver::GetInstance()->MakeDirty(0, 0, _screen.width, _screen.height);
+	return animated;
+}
+
+void Blitter_32bppSSE2_Anim::DrawColourMappingRect(void *dst, int width, int height, PaletteID pal)
+{
+	if (_screen_disable_anim || pal != PALETTE_TO_TRANSPARENT) {
+		Blitter_32bppAnim::DrawColourMappingRect(dst, width, height, pal);
+		return;
 	}
+
+	this->MarkAnimated(dst, 0, 0, width, height);
+
+	Colour *udst = (Colour *)dst;
+	uint16 *anim = this->anim_buf + this->ScreenToAnimOffset((uint32 *)dst);
+
+	/* Same as MakeTransparent(colour, 154) for 4 pixels at once. */
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i nom = _mm_set1_epi16(154);
+	const __m128i alpha = _mm_set1_epi32(0xFF000000);
+	do {
+		int x = 0;
+		for (; x + 4 <= width; x += 4) {
+			__m128i data = _mm_loadu_si128((const __m128i *)(udst + x));
+			__m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(data, zero), nom), 8);
+			__m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(data, zero), nom), 8);
+			_mm_storeu_si128((__m128i *)(udst + x), _mm_or_si128(_mm_packus_epi16(lo, hi), alpha));
+		}
+		for (; x < width; x++) udst[x] = MakeTransparent(udst[x], 154);
+
+		memset(anim, 0, width * sizeof(uint16));
+		udst += _screen.pitch;
+		anim += this->anim_buf_pitch;
+	} while (--height);
 }
 
 #endif /* WITH_SSE */
@@ -25,8 +25,11 @@
 
 /** A partially 32 bpp blitter with palette animation. */
 class Blitter_32bppSSE2_Anim : public Blitter_32bppAnim {
+protected:
+	bool PaletteAnimateRect(int left, int top, int width, int height) override;
+
 public:
-	void PaletteAnimate(const Palette &palette) override;
+	void DrawColourMappingRect(void *dst, int width, int height, PaletteID pal) override;
 	const char *GetName() override { return "32bpp-sse2-anim"; }
 };
 
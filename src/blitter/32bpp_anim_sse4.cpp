@@ -366,6 +366,10 @@ IGNORE_UNINITIALIZED_WARNING_STOP
 void Blitter_32bppSSE4_Anim::Draw(Blitter::BlitterParams *bp, BlitterMode mode, ZoomLevel zoom)
 {
 	const Blitter_32bppSSE_Base::SpriteFlags sprite_flags = ((const Blitter_32bppSSE_Base::SpriteData *) bp->sprite)->flags;
+	/* Sprites without palette animated pixels only clear the animation buffer when drawn normally. */
+	if (!(sprite_flags & SF_NO_ANIM) || (mode != BM_NORMAL && mode != BM_COLOUR_REMAP)) {
+		this->MarkAnimated(bp->dst, bp->left, bp->top, bp->width, bp->height);
+	}
 	switch (mode) {
 		default: {
 bm_normal:
@@ -410,4 +414,10 @@ bm_normal:
 	}
 }
 
+void Blitter_32bppSSE4_Anim::DrawBatch(Blitter::BlitterParams *bps, uint count, BlitterMode mode, ZoomLevel zoom)
+{
+	/* Call our own Draw directly, so the batch does not go through the vtable for every image. */
+	for (uint i = 0; i < count; i++) Blitter_32bppSSE4_Anim::Draw(&bps[i], mode, zoom);
+}
+
 #endif /* WITH_SSE */
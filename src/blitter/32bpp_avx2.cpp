@@ -0,0 +1,171 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file 32bpp_avx2.cpp Implementation of the AVX2 32 bpp blitter. */
+
+#ifdef WITH_SSE
+
+#include "../stdafx.h"
+#include "../zoom_func.h"
+#include "../settings_type.h"
+#include "32bpp_avx2.hpp"
+#include "32bpp_avx2_func.hpp"
+
+#include "../safeguards.h"
+
+/** Instantiation of the AVX2 32bpp blitter factory. */
+static FBlitter_32bppAVX2 iFBlitter_32bppAVX2;
+
+/**
+ * Draws a sprite to a (screen) buffer. It is templated to allow faster operation.
+ * Pixels are handled in blocks of eight; the last block of a line is masked.
+ *
+ * @tparam mode blitter mode
+ * @param bp further blitting parameters
+ * @param zoom zoom level at which we are drawing
+ */
+IGNORE_UNINITIALIZED_WARNING_START
+template <BlitterMode mode, Blitter_32bppSSE_Base::ReadMode read_mode, bool translucent>
+inline void Blitter_32bppAVX2::Draw(const Blitter::BlitterParams *bp, ZoomLevel zoom)
+{
+	const byte * const remap = bp->remap;
+	Colour *dst_line = (Colour *) bp->dst + bp->top * bp->pitch + bp->left;
+	int effective_width = bp->width;
+
+	/* Find where to start reading in the source sprite. */
+	const SpriteData * const sd = (const SpriteData *) bp->sprite;
+	const SpriteInfo * const si = &sd->infos[zoom];
+	const MapValue *src_mv_line = (const MapValue *) &sd->data[si->mv_offset] + bp->skip_top * si->sprite_width;
+	const Colour *src_rgba_line = (const Colour *) ((const byte *) &sd->data[si->sprite_offset] + bp->skip_top * si->sprite_line_size);
+
+	if (read_mode != RM_WITH_MARGIN) {
+		src_rgba_line += bp->skip_left;
+		src_mv_line += bp->skip_left;
+	}
+	const MapValue *src_mv = src_mv_line;
+
+	/* Load these variables into register before loop. */
+	const __m256i a_cm        = ALPHA_CONTROL_MASK_AVX2;
+	const __m256i tr_nom_base = TRANSPARENT_NOM_BASE_AVX2;
+	const __m128i m_mask      = _mm_set1_epi16(0xFF);
+
+	for (int y = bp->height; y != 0; y--) {
+		Colour *dst = dst_line;
+		const Colour *src = src_rgba_line + META_LENGTH;
+		if (mode == BM_COLOUR_REMAP) src_mv = src_mv_line;
+
+		if (read_mode == RM_WITH_MARGIN) {
+			src += src_rgba_line[0].data;
+			dst += src_rgba_line[0].data;
+			if (mode == BM_COLOUR_REMAP) src_mv += src_rgba_line[0].data;
+			const int width_diff = si->sprite_width - bp->width;
+			effective_width = bp->width - (int) src_rgba_line[0].data;
+			const int delta_diff = (int) src_rgba_line[1].data - width_diff;
+			const int new_width = effective_width - delta_diff;
+			effective_width = delta_diff > 0 ? new_width : effective_width;
+			if (effective_width <= 0) goto next_line;
+		}
+
+		switch (mode) {
+			default:
+				for (int x = effective_width; x > 0; x -= 8) {
+					const uint count = min(x, 8);
+					const __m256i srcs = LoadPixelsAVX2(src, count);
+					if (translucent) {
+						StorePixelsAVX2(dst, AlphaBlendEightPixels(srcs, LoadPixelsAVX2(dst, count), a_cm), count);
+					} else {
+						StoreOpaquePixelsAVX2(dst, srcs, count);
+					}
+					src += 8;
+					dst += 8;
+				}
+				break;
+
+			case BM_COLOUR_REMAP:
+				for (int x = effective_width; x > 0; x -= 8) {
+					const uint count = min(x, 8);
+					__m256i srcs = LoadPixelsAVX2(src, count);
+					const __m256i dsts = LoadPixelsAVX2(dst, count);
+					const __m128i mvs = LoadUint16sAVX2((const uint16 *) src_mv, count);
+
+					/* Remap colours. */
+					if (!_mm_testz_si128(mvs, m_mask)) {
+						srcs = RemapEightPixels(srcs, RemapChannelOfEightPixels(mvs), RemapIndicesOfEightPixels(mvs, remap), _cur_palette.palette);
+						if (!HasDefaultBrightness(mvs)) srcs = AdjustBrightnessOfEightPixels(srcs, mvs);
+					}
+
+					/* Blend colours. */
+					StorePixelsAVX2(dst, AlphaBlendEightPixels(srcs, dsts, a_cm), count);
+					src_mv += 8;
+					src += 8;
+					dst += 8;
+				}
+				break;
+
+			case BM_TRANSPARENT:
+				/* Make the current colour a bit more black, so it looks like this image is transparent. */
+				for (int x = bp->width; x > 0; x -= 8) {
+					const uint count = min(x, 8);
+					const __m256i srcs = LoadPixelsAVX2(src, count);
+					const __m256i dsts = LoadPixelsAVX2(dst, count);
+					StorePixelsAVX2(dst, DarkenEightPixels(srcs, dsts, a_cm, tr_nom_base), count);
+					src += 8;
+					dst += 8;
+				}
+				break;
+		}
+
+next_line:
+		if (mode == BM_COLOUR_REMAP) src_mv_line += si->sprite_width;
+		src_rgba_line = (const Colour*) ((const byte*) src_rgba_line + si->sprite_line_size);
+		dst_line += bp->pitch;
+	}
+}
+IGNORE_UNINITIALIZED_WARNING_STOP
+
+/**
+ * Draws a sprite to a (screen) buffer. Calls adequate templated function.
+ *
+ * @param bp further blitting parameters
+ * @param mode blitter mode
+ * @param zoom zoom level at which we are drawing
+ */
+void Blitter_32bppAVX2::Draw(Blitter::BlitterParams *bp, BlitterMode mode, ZoomLevel zoom)
+{
+	switch (mode) {
+		default: {
+			if (bp->skip_left != 0 || bp->width <= MARGIN_NORMAL_THRESHOLD) {
+bm_normal:
+				Draw<BM_NORMAL, RM_WITH_SKIP, true>(bp, zoom); return;
+			} else {
+				if (((const Blitter_32bppSSE_Base::SpriteData *) bp->sprite)->flags & SF_TRANSLUCENT) {
+					Draw<BM_NORMAL, RM_WITH_MARGIN, true>(bp, zoom);
+				} else {
+					Draw<BM_NORMAL, RM_WITH_MARGIN, false>(bp, zoom);
+				}
+				return;
+			}
+			break;
+		}
+		case BM_COLOUR_REMAP:
+			if (((const Blitter_32bppSSE_Base::SpriteData *) bp->sprite)->flags & SF_NO_REMAP) goto bm_normal;
+			if (bp->skip_left != 0 || bp->width <= MARGIN_REMAP_THRESHOLD) {
+				Draw<BM_COLOUR_REMAP, RM_WITH_SKIP, true>(bp, zoom); return;
+			} else {
+				Draw<BM_COLOUR_REMAP, RM_WITH_MARGIN, true>(bp, zoom); return;
+			}
+		case BM_TRANSPARENT: Draw<BM_TRANSPARENT, RM_NONE, true>(bp, zoom); return;
+
+		/* These modes are rare and not worth the wider registers. */
+		case BM_CRASH_REMAP:
+		case BM_BLACK_REMAP:
+			Blitter_32bppSSE4::Draw(bp, mode, zoom);
+			return;
+	}
+}
+
+#endif /* WITH_SSE */
@@ -0,0 +1,294 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file 32bpp_avx2_func.hpp Functions related to AVX2 32 bpp blitter. */
+
+#ifndef BLITTER_32BPP_AVX2_FUNC_HPP
+#define BLITTER_32BPP_AVX2_FUNC_HPP
+
+#ifdef WITH_SSE
+
+#include <immintrin.h>
+
+/* The AVX2 variants of the masks of 32bpp_sse_type.h; both 128 bits lanes are handled alike. */
+#define ALPHA_CONTROL_MASK_AVX2          _mm256_broadcastsi128_si256(ALPHA_CONTROL_MASK)
+#define BRIGHTNESS_DIV_CLEANER_AVX2      _mm256_broadcastsi128_si256(BRIGHTNESS_DIV_CLEANER)
+#define OVERBRIGHT_PRESENCE_MASK_AVX2    _mm256_broadcastsi128_si256(OVERBRIGHT_PRESENCE_MASK)
+#define OVERBRIGHT_VALUE_MASK_AVX2       _mm256_broadcastsi128_si256(OVERBRIGHT_VALUE_MASK)
+#define OVERBRIGHT_CONTROL_MASK_AVX2     _mm256_broadcastsi128_si256(OVERBRIGHT_CONTROL_MASK)
+#define TRANSPARENT_NOM_BASE_AVX2        _mm256_set1_epi16(256)
+/* Put the brightness of pixels 0, 1 (low lane) and 4, 5 (high lane) of eight map values in the rgb words of four pixels. */
+#define BRIGHTNESS_LOW_CONTROL_MASK_AVX2  _mm256_setr_epi8( 1, -1,  1, -1,  1, -1, -1, -1,  3, -1,  3, -1,  3, -1, -1, -1,  9, -1,  9, -1,  9, -1, -1, -1, 11, -1, 11, -1, 11, -1, -1, -1)
+/* Put the brightness of pixels 2, 3 (low lane) and 6, 7 (high lane) of eight map values in the rgb words of four pixels. */
+#define BRIGHTNESS_HIGH_CONTROL_MASK_AVX2 _mm256_setr_epi8( 5, -1,  5, -1,  5, -1, -1, -1,  7, -1,  7, -1,  7, -1, -1, -1, 13, -1, 13, -1, 13, -1, -1, -1, 15, -1, 15, -1, 15, -1, -1, -1)
+/* Brightness for the alpha words, so alpha is kept when adjusting the brightness. */
+#define BRIGHTNESS_ALPHA_AVX2             _mm256_setr_epi16(0, 0, 0, Blitter_32bppBase::DEFAULT_BRIGHTNESS, 0, 0, 0, Blitter_32bppBase::DEFAULT_BRIGHTNESS, 0, 0, 0, Blitter_32bppBase::DEFAULT_BRIGHTNESS, 0, 0, 0, Blitter_32bppBase::DEFAULT_BRIGHTNESS)
+
+/**
+ * Get the mask to select the first pixels of a block of eight pixels.
+ * @param count Number of pixels to select.
+ * @return Mask with all bits of the first \a count uint32 set.
+ */
+static inline __m256i TailMaskAVX2(uint count)
+{
+	return _mm256_cmpgt_epi32(_mm256_set1_epi32(count), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+/**
+ * Load a block of at most eight pixels.
+ * @param from  First pixel to load.
+ * @param count Number of pixels to load; pixels past the last one are zero.
+ * @return The pixels.
+ */
+static inline __m256i LoadPixelsAVX2(const Colour *from, uint count)
+{
+	if (count >= 8) return _mm256_loadu_si256((const __m256i *) from);
+	return _mm256_maskload_epi32((const int *) from, TailMaskAVX2(count));
+}
+
+/**
+ * Store a block of at most eight pixels.
+ * @param to     First pixel to store.
+ * @param pixels The pixels.
+ * @param count  Number of pixels to store.
+ */
+static inline void StorePixelsAVX2(Colour *to, __m256i pixels, uint count)
+{
+	if (count >= 8) {
+		_mm256_storeu_si256((__m256i *) to, pixels);
+	} else {
+		_mm256_maskstore_epi32((int *) to, TailMaskAVX2(count), pixels);
+	}
+}
+
+/**
+ * Store the opaque pixels of a block of at most eight pixels that has no translucent pixels.
+ * @param to     First pixel to store.
+ * @param pixels The pixels; their alpha is either 0 or 255.
+ * @param count  Number of pixels to store.
+ */
+static inline void StoreOpaquePixelsAVX2(Colour *to, __m256i pixels, uint count)
+{
+	/* The highest bit of a pixel is the highest bit of its alpha, which is what the store looks at. */
+	__m256i mask = pixels;
+	if (count < 8) mask = _mm256_and_si256(mask, TailMaskAVX2(count));
+	_mm256_maskstore_epi32((int *) to, mask, pixels);
+}
+
+/**
+ * Load at most eight uint16, like map values or values of the animation buffer.
+ * @param from  First value to load.
+ * @param count Number of values to load; values past the last one are zero.
+ * @return The values.
+ */
+static inline __m128i LoadUint16sAVX2(const uint16 *from, uint count)
+{
+	if (count >= 8) return _mm_loadu_si128((const __m128i *) from);
+	um128i values;
+	values.m128i = _mm_setzero_si128();
+	memcpy(values.m128i_u16, from, count * sizeof(uint16));
+	return values.m128i;
+}
+
+/**
+ * Store at most eight uint16.
+ * @param to     First value to store.
+ * @param values The values.
+ * @param count  Number of values to store.
+ */
+static inline void StoreUint16sAVX2(uint16 *to, __m128i values, uint count)
+{
+	if (count >= 8) {
+		_mm_storeu_si128((__m128i *) to, values);
+	} else {
+		um128i v;
+		v.m128i = values;
+		memcpy(to, v.m128i_u16, count * sizeof(uint16));
+	}
+}
+
+/**
+ * Get the alpha of eight pixels.
+ * @param pixels The pixels.
+ * @return The alpha of each pixel in a uint16.
+ */
+static inline __m128i AlphaOfEightPixels(__m256i pixels)
+{
+	const __m256i alpha = _mm256_srli_epi32(pixels, 24);
+	return _mm_packus_epi32(_mm256_castsi256_si128(alpha), _mm256_extracti128_si256(alpha, 1));
+}
+
+/**
+ * Check whether none of eight map values has to be adjusted in brightness.
+ * @param mv The map values.
+ * @return True when all brightness values are the default.
+ */
+static inline bool HasDefaultBrightness(__m128i mv)
+{
+	const __m128i v = _mm_and_si128(mv, _mm_set1_epi16((short) 0xFF00));
+	return _mm_movemask_epi8(_mm_cmpeq_epi16(v, _mm_set1_epi16(Blitter_32bppBase::DEFAULT_BRIGHTNESS << 8))) == 0xFFFF;
+}
+
+/**
+ * Get the remap channel of eight map values.
+ * @param mv The map values.
+ * @return The remap channel of each map value in a uint32.
+ */
+static inline __m256i RemapChannelOfEightPixels(__m128i mv)
+{
+	return _mm256_cvtepu16_epi32(_mm_and_si128(mv, _mm_set1_epi16(0xFF)));
+}
+
+/**
+ * Look up the remapped palette indices of eight pixels.
+ * @param mv    The map values of the pixels.
+ * @param remap The remap table.
+ * @return The remapped index of each pixel in a uint32.
+ */
+static inline __m256i RemapIndicesOfEightPixels(__m128i mv, const byte *remap)
+{
+	um128i m;
+	m.m128i = mv;
+	return _mm256_setr_epi32(remap[m.m128i_u8[0]], remap[m.m128i_u8[2]], remap[m.m128i_u8[4]], remap[m.m128i_u8[6]],
+			remap[m.m128i_u8[8]], remap[m.m128i_u8[10]], remap[m.m128i_u8[12]], remap[m.m128i_u8[14]]);
+}
+
+/**
+ * Replace the colours of eight pixels by colours of the palette, keeping their alpha.
+ * @param pixels  The pixels.
+ * @param index   The palette index of each pixel.
+ * @param mask    The pixels to replace.
+ * @param palette The palette.
+ * @return The pixels with the replaced colours.
+ */
+static inline __m256i LookupColoursInPalette(__m256i pixels, __m256i index, __m256i mask, const Colour *palette)
+{
+	const __m256i alpha_mask = _mm256_set1_epi32(0xFF000000);
+	/* The gather keeps the pixels that are not masked. */
+	const __m256i colours = _mm256_mask_i32gather_epi32(pixels, (const int *) palette, index, mask, sizeof(Colour));
+	return _mm256_blendv_epi8(colours, pixels, alpha_mask);
+}
+
+/**
+ * Remap the colours of eight pixels. Pixels with a remap channel of 0 are kept
+ * as they are, pixels that are remapped to index 0 become transparent.
+ * @param pixels  The pixels.
+ * @param m       The remap channel of the map values of the pixels.
+ * @param r       The remapped index of each pixel.
+ * @param palette The palette.
+ * @return The remapped pixels.
+ */
+static inline __m256i RemapEightPixels(__m256i pixels, __m256i m, __m256i r, const Colour *palette)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i remapped = _mm256_xor_si256(_mm256_cmpeq_epi32(m, zero), _mm256_set1_epi32(-1));
+	pixels = LookupColoursInPalette(pixels, r, remapped, palette);
+	return _mm256_andnot_si256(_mm256_and_si256(remapped, _mm256_cmpeq_epi32(r, zero)), pixels);
+}
+
+/** Alpha blend four pixels whose components have been expanded to uint16; see AlphaBlendTwoPixels(). */
+static inline __m256i AlphaBlendFourPixels(__m256i src, __m256i dst, const __m256i &distribution_mask)
+{
+	__m256i alpha = _mm256_cmpgt_epi16(src, _mm256_setzero_si256()); // if (alpha > 0) a++;
+	alpha = _mm256_srli_epi16(alpha, 15);
+	alpha = _mm256_add_epi16(alpha, src);
+	alpha = _mm256_shuffle_epi8(alpha, distribution_mask);
+
+	src = _mm256_sub_epi16(src, dst);     //    (r - Cr)
+	src = _mm256_mullo_epi16(src, alpha); //  a*(r - Cr)
+	src = _mm256_srli_epi16(src, 8);      //  a*(r - Cr)/256
+	src = _mm256_add_epi16(src, dst);     //  a*(r - Cr)/256 + Cr
+	return _mm256_and_si256(src, _mm256_set1_epi16(0xFF)); // Only the low byte is valid, see PackUnsaturated().
+}
+
+/**
+ * Alpha blend eight pixels.
+ * @param src               The pixels to draw.
+ * @param dst               The pixels to draw on.
+ * @param distribution_mask #ALPHA_CONTROL_MASK_AVX2.
+ * @return The blended pixels.
+ */
+static inline __m256i AlphaBlendEightPixels(__m256i src, __m256i dst, const __m256i &distribution_mask)
+{
+	/* Unpacking and packing work per 128 bits lane, so the order of the pixels is kept. */
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i lo = AlphaBlendFourPixels(_mm256_unpacklo_epi8(src, zero), _mm256_unpacklo_epi8(dst, zero), distribution_mask);
+	const __m256i hi = AlphaBlendFourPixels(_mm256_unpackhi_epi8(src, zero), _mm256_unpackhi_epi8(dst, zero), distribution_mask);
+	return _mm256_packus_epi16(lo, hi);
+}
+
+/** Darken four pixels whose components have been expanded to uint16; see DarkenTwoPixels(). */
+static inline __m256i DarkenFourPixels(__m256i src, __m256i dst, const __m256i &distribution_mask, const __m256i &tr_nom_base)
+{
+	__m256i alpha = _mm256_shuffle_epi8(src, distribution_mask);
+	alpha = _mm256_srli_epi16(alpha, 2); // Reduce to 64 levels of shades so the max value fits in 16 bits.
+	const __m256i nom = _mm256_sub_epi16(tr_nom_base, alpha);
+	dst = _mm256_mullo_epi16(dst, nom);
+	return _mm256_srli_epi16(dst, 8);
+}
+
+/**
+ * Darken eight pixels, so the pixels drawn on look like they are behind a transparent image.
+ * @param src               The pixels of the transparent image.
+ * @param dst               The pixels to darken.
+ * @param distribution_mask #ALPHA_CONTROL_MASK_AVX2.
+ * @param tr_nom_base       #TRANSPARENT_NOM_BASE_AVX2.
+ * @return The darkened pixels.
+ */
+static inline __m256i DarkenEightPixels(__m256i src, __m256i dst, const __m256i &distribution_mask, const __m256i &tr_nom_base)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i lo = DarkenFourPixels(_mm256_unpacklo_epi8(src, zero), _mm256_unpacklo_epi8(dst, zero), distribution_mask, tr_nom_base);
+	const __m256i hi = DarkenFourPixels(_mm256_unpackhi_epi8(src, zero), _mm256_unpackhi_epi8(dst, zero), distribution_mask, tr_nom_base);
+	return _mm256_packus_epi16(lo, hi);
+}
+
+/** Adjust the brightness of four pixels whose components have been expanded to uint16; see AdjustBrightnessOfTwoPixels(). */
+static inline __m256i AdjustBrightnessOfFourPixels(__m256i col, __m256i bri)
+{
+	col = _mm256_mullo_epi16(col, bri);
+	__m256i col_ob = _mm256_srli_epi16(col, 8 + 7);
+	col = _mm256_srli_epi16(col, 7);
+
+	/* Sum overbright.
+	 * Maximum for each rgb is 508 => 9 bits. The highest bit tells if there is overbright.
+	 * -255 is changed in -256 so we just have to take the 8 lower bits into account.
+	 */
+	col = _mm256_and_si256(col, BRIGHTNESS_DIV_CLEANER_AVX2);
+	col_ob = _mm256_and_si256(col_ob, OVERBRIGHT_PRESENCE_MASK_AVX2);
+	col_ob = _mm256_mullo_epi16(col_ob, OVERBRIGHT_VALUE_MASK_AVX2);
+	col_ob = _mm256_and_si256(col_ob, col);
+	__m256i ob = _mm256_hadd_epi16(_mm256_hadd_epi16(col_ob, _mm256_setzero_si256()), _mm256_setzero_si256());
+
+	ob = _mm256_srli_epi16(ob, 1);               // Reduce overbright strength.
+	ob = _mm256_shuffle_epi8(ob, OVERBRIGHT_CONTROL_MASK_AVX2);
+	__m256i ret = OVERBRIGHT_VALUE_MASK_AVX2;    // ob_mask is equal to white.
+	ret = _mm256_subs_epu16(ret, col);           //    (255 - rgb)
+	ret = _mm256_mullo_epi16(ret, ob);           // ob*(255 - rgb)
+	ret = _mm256_srli_epi16(ret, 8);             // ob*(255 - rgb)/256
+	return _mm256_add_epi16(ret, col);           // ob*(255 - rgb)/256 + rgb
+}
+
+/**
+ * Adjust the brightness of eight pixels.
+ * @param from The pixels.
+ * @param mv   The map values of the pixels; their high bytes are the brightness.
+ * @return The adjusted pixels.
+ */
+static inline __m256i AdjustBrightnessOfEightPixels(__m256i from, __m128i mv)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i mv8 = _mm256_broadcastsi128_si256(mv);
+	const __m256i bri_lo = _mm256_or_si256(_mm256_shuffle_epi8(mv8, BRIGHTNESS_LOW_CONTROL_MASK_AVX2), BRIGHTNESS_ALPHA_AVX2);
+	const __m256i bri_hi = _mm256_or_si256(_mm256_shuffle_epi8(mv8, BRIGHTNESS_HIGH_CONTROL_MASK_AVX2), BRIGHTNESS_ALPHA_AVX2);
+	const __m256i lo = AdjustBrightnessOfFourPixels(_mm256_unpacklo_epi8(from, zero), bri_lo);
+	const __m256i hi = AdjustBrightnessOfFourPixels(_mm256_unpackhi_epi8(from, zero), bri_hi);
+	return _mm256_packus_epi16(lo, hi);
+}
+
+#endif /* WITH_SSE */
+#endif /* BLITTER_32BPP_AVX2_FUNC_HPP */
@@ -35,6 +35,12 @@ void Blitter_32bppBase::DrawRect(void *video, int width, int height, uint8 colou
 {
 	Colour colour32 = LookupColourInPalette(colour);
 
+	/* Rectangles spanning the whole pitch are one contiguous block. */
+	if (width == _screen.pitch) {
+		width *= height;
+		height = 1;
+	}
+
 	do {
 		Colour *dst = (Colour *)video;
 		for (int i = width; i > 0; i--) {
@@ -9,7 +9,6 @@
 
 #include "../stdafx.h"
 #include "../zoom_func.h"
-#include "../settings_type.h"
 #include "32bpp_optimized.hpp"
 
 #include "../safeguards.h"
@@ -272,15 +271,7 @@ Sprite *Blitter_32bppOptimized::Encode(const SpriteLoader::Sprite *sprite, Alloc
 
 	ZoomLevel zoom_min;
 	ZoomLevel zoom_max;
-
-	if (sprite->type == ST_FONT) {
-		zoom_min = ZOOM_LVL_NORMAL;
-		zoom_max = ZOOM_LVL_NORMAL;
-	} else {
-		zoom_min = _settings_client.gui.zoom_min;
-		zoom_max = _settings_client.gui.zoom_max;
-		if (zoom_max == zoom_min) zoom_max = ZOOM_LVL_MAX;
-	}
+	GetSpriteEncodeZoomLevels(sprite->type, &zoom_min, &zoom_max);
 
 	for (ZoomLevel z = zoom_min; z <= zoom_max; z++) {
 		const SpriteLoader::Sprite *src_orig = &sprite[z];
@@ -27,6 +27,7 @@ public:
 	void Draw(Blitter::BlitterParams *bp, BlitterMode mode, ZoomLevel zoom) override;
 	void DrawColourMappingRect(void *dst, int width, int height, PaletteID pal) override;
 	Sprite *Encode(const SpriteLoader::Sprite *sprite, AllocatorProc *allocator) override;
+	bool DrawsFromNormalZoom() override { return true; }
 
 	const char *GetName() override { return "32bpp-simple"; }
 };
@@ -11,7 +11,6 @@
 
 #include "../stdafx.h"
 #include "../zoom_func.h"
-#include "../settings_type.h"
 #include "32bpp_sse2.hpp"
 #include "32bpp_sse_func.hpp"
 
@@ -26,13 +25,9 @@ Sprite *Blitter_32bppSSE_Base::Encode(const SpriteLoader::Sprite *sprite, Alloca
 	 * Second uint32 of a line = the number of transparent pixels from the right.
 	 * Then all RGBA then all MV.
 	 */
-	ZoomLevel zoom_min = ZOOM_LVL_NORMAL;
-	ZoomLevel zoom_max = ZOOM_LVL_NORMAL;
-	if (sprite->type != ST_FONT) {
-		zoom_min = _settings_client.gui.zoom_min;
-		zoom_max = _settings_client.gui.zoom_max;
-		if (zoom_max == zoom_min) zoom_max = ZOOM_LVL_MAX;
-	}
+	ZoomLevel zoom_min;
+	ZoomLevel zoom_max;
+	GetSpriteEncodeZoomLevels(sprite->type, &zoom_min, &zoom_max);
 
 	/* Calculate sizes and allocate. */
 	SpriteData sd;
@@ -43,6 +43,12 @@ void Blitter_8bppBase::DrawLine(void *video, int x, int y, int x2, int y2, int s
 
 void Blitter_8bppBase::DrawRect(void *video, int width, int height, uint8 colour)
 {
+	/* Rectangles spanning the whole pitch are one contiguous block. */
+	if (width == _screen.pitch) {
+		width *= height;
+		height = 1;
+	}
+
 	do {
 		memset(video, colour, width);
 		video = (uint8 *)video + _screen.pitch;
@@ -9,7 +9,6 @@
 
 #include "../stdafx.h"
 #include "../zoom_func.h"
-#include "../settings_type.h"
 #include "../core/math_func.hpp"
 #include "../core/mem_func.hpp"
 #include "8bpp_optimized.hpp"
@@ -119,6 +118,12 @@ void Blitter_8bppOptimized::Draw(Blitter::BlitterParams *bp, BlitterMode mode, Z
 	}
 }
 
+void Blitter_8bppOptimized::DrawBatch(Blitter::BlitterParams *bps, uint count, BlitterMode mode, ZoomLevel zoom)
+{
+	/* Call our own Draw directly, so the batch does not go through the vtable for every image. */
+	for (uint i = 0; i < count; i++) Blitter_8bppOptimized::Draw(&bps[i], mode, zoom);
+}
+
 Sprite *Blitter_8bppOptimized::Encode(const SpriteLoader::Sprite *sprite, AllocatorProc *allocator)
 {
 	/* Make memory for all zoom-levels */
@@ -126,15 +131,7 @@ Sprite *Blitter_8bppOptimized::Encode(const SpriteLoader::Sprite *sprite, Alloca
 
 	ZoomLevel zoom_min;
 	ZoomLevel zoom_max;
-
-	if (sprite->type == ST_FONT) {
-		zoom_min = ZOOM_LVL_NORMAL;
-		zoom_max = ZOOM_LVL_NORMAL;
-	} else {
-		zoom_min = _settings_client.gui.zoom_min;
-		zoom_max = _settings_client.gui.zoom_max;
-		if (zoom_max == zoom_min) zoom_max = ZOOM_LVL_MAX;
-	}
+	GetSpriteEncodeZoomLevels(sprite->type, &zoom_min, &zoom_max);
 
 	for (ZoomLevel i = zoom_min; i <= zoom_max; i++) {
 		memory += sprite[i].width * sprite[i].height;
@@ -146,7 +143,7 @@ Sprite *Blitter_8bppOptimized::Encode(const SpriteLoader::Sprite *sprite, Alloca
 	/* Don't allocate memory each time, but just keep some
 	 * memory around as this function is called quite often
 	 * and the memory usage is quite low. */
-	static ReusableBuffer<byte> temp_buffer;
+	static thread_local ReusableBuffer<byte> temp_buffer;
 	SpriteData *temp_dst = (SpriteData *)temp_buffer.Allocate(memory);
 	memset(temp_dst, 0, sizeof(*temp_dst));
 	byte *dst = temp_dst->data;
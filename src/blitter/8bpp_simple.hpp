@@ -18,6 +18,7 @@ class Blitter_8bppSimple FINAL : public Blitter_8bppBase {
 public:
 	void Draw(Blitter::BlitterParams *bp, BlitterMode mode, ZoomLevel zoom) override;
 	Sprite *Encode(const SpriteLoader::Sprite *sprite, AllocatorProc *allocator) override;
+	bool DrawsFromNormalZoom() override { return true; }
 
 	const char *GetName() override { return "8bpp-simple"; }
 };
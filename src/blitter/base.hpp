@@ -63,6 +63,18 @@ public:
 	 */
 	virtual void Draw(Blitter::BlitterParams *bp, BlitterMode mode, ZoomLevel zoom) = 0;
 
+	/**
+	 * Draw a number of images to the screen with the same mode and zoom level, e.g. the glyphs of a line of text.
+	 * @param bps The params of the images; these are already clipped.
+	 * @param count The number of images.
+	 * @param mode The blitter mode of all images.
+	 * @param zoom The zoom level of all images.
+	 */
+	virtual void DrawBatch(Blitter::BlitterParams *bps, uint count, BlitterMode mode, ZoomLevel zoom)
+	{
+		for (uint i = 0; i < count; i++) this->Draw(&bps[i], mode, zoom);
+	}
+
 	/**
 	 * Draw a colourtable to the screen. This is: the colour of the screen is read
 	 *  and is looked-up in the palette to match a new colour, which then is put
@@ -79,6 +91,13 @@ public:
 	 */
 	virtual Sprite *Encode(const SpriteLoader::Sprite *sprite, AllocatorProc *allocator) = 0;
 
+	/**
+	 * Does the blitter draw all zoom levels from the fully zoomed in image of a sprite?
+	 * Otherwise #Encode only encodes the zoom levels of #GetSpriteEncodeZoomLevels.
+	 * @return True when only ZOOM_LVL_NORMAL is encoded.
+	 */
+	virtual bool DrawsFromNormalZoom() { return false; }
+
 	/**
 	 * Move the destination pointer the requested amount x and y, keeping in mind
 	 *  any pitch and bpp of the renderer.
@@ -185,6 +204,21 @@ public:
 	 */
 	virtual Blitter::PaletteAnimation UsePaletteAnimation() = 0;
 
+	/**
+	 * Get the buffer with the palette index and brightness of every pixel of the screen,
+	 *  for video drivers that do the palette animation themselves.
+	 * @param[out] pitch The pitch of the buffer, in pixels.
+	 * @return The buffer, or \c nullptr when the blitter does not keep one.
+	 */
+	virtual const uint16 *GetAnimationBuffer(int *pitch) { return nullptr; }
+
+	/**
+	 * Called instead of #PaletteAnimate when the video driver does the palette
+	 *  animation itself; the blitter only has to use the new palette for drawing.
+	 * @param palette The new palette.
+	 */
+	virtual void UpdatePalette(const Palette &palette) { }
+
 	/**
 	 * Get the name of the blitter, the same as the Factory-instance returns.
 	 */
@@ -172,6 +172,16 @@ static bool EngineReliabilitySorter(const EngineID &a, const EngineID &b)
 	return _engine_sort_direction ? r > 0 : r < 0;
 }
 
+/**
+ * Sort key of #EngineCostSorter.
+ * @param engine Engine to get the key of.
+ * @return The purchase cost.
+ */
+static EngineSortKey EngineCostSortKey(EngineID engine)
+{
+	return {Engine::Get(engine)->GetCost(), 0};
+}
+
 /**
  * Determines order of engines by purchase cost
  * @param a first engine to compare
@@ -180,8 +190,8 @@ static bool EngineReliabilitySorter(const EngineID &a, const EngineID &b)
  */
 static bool EngineCostSorter(const EngineID &a, const EngineID &b)
 {
-	Money va = Engine::Get(a)->GetCost();
-	Money vb = Engine::Get(b)->GetCost();
+	Money va = GetEngineSortKey(a, EngineCostSortKey).primary;
+	Money vb = GetEngineSortKey(b, EngineCostSortKey).primary;
 	int r = ClampToI32(va - vb);
 
 	/* Use EngineID to sort instead since we want consistent sorting */
@@ -189,6 +199,16 @@ static bool EngineCostSorter(const EngineID &a, const EngineID &b)
 	return _engine_sort_direction ? r > 0 : r < 0;
 }
 
+/**
+ * Sort key of #EngineSpeedSorter.
+ * @param engine Engine to get the key of.
+ * @return The displayed maximum speed.
+ */
+static EngineSortKey EngineSpeedSortKey(EngineID engine)
+{
+	return {Engine::Get(engine)->GetDisplayMaxSpeed(), 0};
+}
+
 /**
  * Determines order of engines by speed
  * @param a first engine to compare
@@ -197,8 +217,8 @@ static bool EngineCostSorter(const EngineID &a, const EngineID &b)
  */
 static bool EngineSpeedSorter(const EngineID &a, const EngineID &b)
 {
-	int va = Engine::Get(a)->GetDisplayMaxSpeed();
-	int vb = Engine::Get(b)->GetDisplayMaxSpeed();
+	int va = (int)GetEngineSortKey(a, EngineSpeedSortKey).primary;
+	int vb = (int)GetEngineSortKey(b, EngineSpeedSortKey).primary;
 	int r = va - vb;
 
 	/* Use EngineID to sort instead since we want consistent sorting */
@@ -206,6 +226,16 @@ static bool EngineSpeedSorter(const EngineID &a, const EngineID &b)
 	return _engine_sort_direction ? r > 0 : r < 0;
 }
 
+/**
+ * Sort key of #EnginePowerSorter.
+ * @param engine Engine to get the key of.
+ * @return The power.
+ */
+static EngineSortKey EnginePowerSortKey(EngineID engine)
+{
+	return {Engine::Get(engine)->GetPower(), 0};
+}
+
 /**
  * Determines order of engines by power
  * @param a first engine to compare
@@ -214,8 +244,8 @@ static bool EngineSpeedSorter(const EngineID &a, const EngineID &b)
  */
 static bool EnginePowerSorter(const EngineID &a, const EngineID &b)
 {
-	int va = Engine::Get(a)->GetPower();
-	int vb = Engine::Get(b)->GetPower();
+	int va = (int)GetEngineSortKey(a, EnginePowerSortKey).primary;
+	int vb = (int)GetEngineSortKey(b, EnginePowerSortKey).primary;
 	int r = va - vb;
 
 	/* Use EngineID to sort instead since we want consistent sorting */
@@ -223,6 +253,16 @@ static bool EnginePowerSorter(const EngineID &a, const EngineID &b)
 	return _engine_sort_direction ? r > 0 : r < 0;
 }
 
+/**
+ * Sort key of #EngineTractiveEffortSorter.
+ * @param engine Engine to get the key of.
+ * @return The displayed maximum tractive effort.
+ */
+static EngineSortKey EngineTractiveEffortSortKey(EngineID engine)
+{
+	return {Engine::Get(engine)->GetDisplayMaxTractiveEffort(), 0};
+}
+
 /**
  * Determines order of engines by tractive effort
  * @param a first engine to compare
@@ -231,8 +271,8 @@ static bool EnginePowerSorter(const EngineID &a, const EngineID &b)
  */
 static bool EngineTractiveEffortSorter(const EngineID &a, const EngineID &b)
 {
-	int va = Engine::Get(a)->GetDisplayMaxTractiveEffort();
-	int vb = Engine::Get(b)->GetDisplayMaxTractiveEffort();
+	int va = (int)GetEngineSortKey(a, EngineTractiveEffortSortKey).primary;
+	int vb = (int)GetEngineSortKey(b, EngineTractiveEffortSortKey).primary;
 	int r = va - vb;
 
 	/* Use EngineID to sort instead since we want consistent sorting */
@@ -240,6 +280,16 @@ static bool EngineTractiveEffortSorter(const EngineID &a, const EngineID &b)
 	return _engine_sort_direction ? r > 0 : r < 0;
 }
 
+/**
+ * Sort key of #EngineRunningCostSorter.
+ * @param engine Engine to get the key of.
+ * @return The running cost.
+ */
+static EngineSortKey EngineRunningCostSortKey(EngineID engine)
+{
+	return {Engine::Get(engine)->GetRunningCost(), 0};
+}
+
 /**
  * Determines order of engines by running costs
  * @param a first engine to compare
@@ -248,8 +298,8 @@ static bool EngineTractiveEffortSorter(const EngineID &a, const EngineID &b)
  */
 static bool EngineRunningCostSorter(const EngineID &a, const EngineID &b)
 {
-	Money va = Engine::Get(a)->GetRunningCost();
-	Money vb = Engine::Get(b)->GetRunningCost();
+	Money va = GetEngineSortKey(a, EngineRunningCostSortKey).primary;
+	Money vb = GetEngineSortKey(b, EngineRunningCostSortKey).primary;
 	int r = ClampToI32(va - vb);
 
 	/* Use EngineID to sort instead since we want consistent sorting */
@@ -257,6 +307,17 @@ static bool EngineRunningCostSorter(const EngineID &a, const EngineID &b)
 	return _engine_sort_direction ? r > 0 : r < 0;
 }
 
+/**
+ * Sort key of #EnginePowerVsRunningCostSorter.
+ * @param engine Engine to get the key of.
+ * @return The power and the running cost.
+ */
+static EngineSortKey EnginePowerVsRunningCostSortKey(EngineID engine)
+{
+	const Engine *e = Engine::Get(engine);
+	return {e->GetPower(), e->GetRunningCost()};
+}
+
 /**
  * Determines order of engines by running costs
  * @param a first engine to compare
@@ -265,12 +326,12 @@ static bool EngineRunningCostSorter(const EngineID &a, const EngineID &b)
  */
 static bool EnginePowerVsRunningCostSorter(const EngineID &a, const EngineID &b)
 {
-	const Engine *e_a = Engine::Get(a);
-	const Engine *e_b = Engine::Get(b);
-	uint p_a = e_a->GetPower();
-	uint p_b = e_b->GetPower();
-	Money r_a = e_a->GetRunningCost();
-	Money r_b = e_b->GetRunningCost();
+	const EngineSortKey &k_a = GetEngineSortKey(a, EnginePowerVsRunningCostSortKey);
+	const EngineSortKey &k_b = GetEngineSortKey(b, EnginePowerVsRunningCostSortKey);
+	uint p_a = (uint)k_a.primary;
+	uint p_b = (uint)k_b.primary;
+	Money r_a = k_a.secondary;
+	Money r_b = k_b.secondary;
 	/* Check if running cost is zero in one or both engines.
 	 * If only one of them is zero then that one has higher value,
 	 * else if both have zero cost then compare powers. */
@@ -299,6 +360,16 @@ static bool EnginePowerVsRunningCostSorter(const EngineID &a, const EngineID &b)
 
 /* Train sorting functions */
 
+/**
+ * Sort key of #TrainEngineCapacitySorter.
+ * @param engine Engine to get the key of.
+ * @return The total capacity.
+ */
+static EngineSortKey TrainEngineCapacitySortKey(EngineID engine)
+{
+	return {GetTotalCapacityOfArticulatedParts(engine) * (RailVehInfo(engine)->railveh_type == RAILVEH_MULTIHEAD ? 2 : 1), 0};
+}
+
 /**
  * Determines order of train engines by capacity
  * @param a first engine to compare
@@ -307,11 +378,8 @@ static bool EnginePowerVsRunningCostSorter(const EngineID &a, const EngineID &b)
  */
 static bool TrainEngineCapacitySorter(const EngineID &a, const EngineID &b)
 {
-	const RailVehicleInfo *rvi_a = RailVehInfo(a);
-	const RailVehicleInfo *rvi_b = RailVehInfo(b);
-
-	int va = GetTotalCapacityOfArticulatedParts(a) * (rvi_a->railveh_type == RAILVEH_MULTIHEAD ? 2 : 1);
-	int vb = GetTotalCapacityOfArticulatedParts(b) * (rvi_b->railveh_type == RAILVEH_MULTIHEAD ? 2 : 1);
+	int va = (int)GetEngineSortKey(a, TrainEngineCapacitySortKey).primary;
+	int vb = (int)GetEngineSortKey(b, TrainEngineCapacitySortKey).primary;
 	int r = va - vb;
 
 	/* Use EngineID to sort instead since we want consistent sorting */
@@ -338,6 +406,16 @@ static bool TrainEnginesThenWagonsSorter(const EngineID &a, const EngineID &b)
 
 /* Road vehicle sorting functions */
 
+/**
+ * Sort key of #RoadVehEngineCapacitySorter.
+ * @param engine Engine to get the key of.
+ * @return The total capacity.
+ */
+static EngineSortKey RoadVehEngineCapacitySortKey(EngineID engine)
+{
+	return {GetTotalCapacityOfArticulatedParts(engine), 0};
+}
+
 /**
  * Determines order of road vehicles by capacity
  * @param a first engine to compare
@@ -346,8 +424,8 @@ static bool TrainEnginesThenWagonsSorter(const EngineID &a, const EngineID &b)
  */
 static bool RoadVehEngineCapacitySorter(const EngineID &a, const EngineID &b)
 {
-	int va = GetTotalCapacityOfArticulatedParts(a);
-	int vb = GetTotalCapacityOfArticulatedParts(b);
+	int va = (int)GetEngineSortKey(a, RoadVehEngineCapacitySortKey).primary;
+	int vb = (int)GetEngineSortKey(b, RoadVehEngineCapacitySortKey).primary;
 	int r = va - vb;
 
 	/* Use EngineID to sort instead since we want consistent sorting */
@@ -357,6 +435,16 @@ static bool RoadVehEngineCapacitySorter(const EngineID &a, const EngineID &b)
 
 /* Ship vehicle sorting functions */
 
+/**
+ * Sort key of #ShipEngineCapacitySorter.
+ * @param engine Engine to get the key of.
+ * @return The displayed default capacity.
+ */
+static EngineSortKey ShipEngineCapacitySortKey(EngineID engine)
+{
+	return {Engine::Get(engine)->GetDisplayDefaultCapacity(), 0};
+}
+
 /**
  * Determines order of ships by capacity
  * @param a first engine to compare
@@ -365,11 +453,8 @@ static bool RoadVehEngineCapacitySorter(const EngineID &a, const EngineID &b)
  */
 static bool ShipEngineCapacitySorter(const EngineID &a, const EngineID &b)
 {
-	const Engine *e_a = Engine::Get(a);
-	const Engine *e_b = Engine::Get(b);
-
-	int va = e_a->GetDisplayDefaultCapacity();
-	int vb = e_b->GetDisplayDefaultCapacity();
+	int va = (int)GetEngineSortKey(a, ShipEngineCapacitySortKey).primary;
+	int vb = (int)GetEngineSortKey(b, ShipEngineCapacitySortKey).primary;
 	int r = va - vb;
 
 	/* Use EngineID to sort instead since we want consistent sorting */
@@ -379,6 +464,18 @@ static bool ShipEngineCapacitySorter(const EngineID &a, const EngineID &b)
 
 /* Aircraft sorting functions */
 
+/**
+ * Sort key of #AircraftEngineCargoSorter.
+ * @param engine Engine to get the key of.
+ * @return The displayed default passenger and mail capacity.
+ */
+static EngineSortKey AircraftEngineCargoSortKey(EngineID engine)
+{
+	uint16 mail;
+	int capacity = Engine::Get(engine)->GetDisplayDefaultCapacity(&mail);
+	return {capacity, mail};
+}
+
 /**
  * Determines order of aircraft by cargo
  * @param a first engine to compare
@@ -387,12 +484,13 @@ static bool ShipEngineCapacitySorter(const EngineID &a, const EngineID &b)
  */
 static bool AircraftEngineCargoSorter(const EngineID &a, const EngineID &b)
 {
-	const Engine *e_a = Engine::Get(a);
-	const Engine *e_b = Engine::Get(b);
+	const EngineSortKey &k_a = GetEngineSortKey(a, AircraftEngineCargoSortKey);
+	const EngineSortKey &k_b = GetEngineSortKey(b, AircraftEngineCargoSortKey);
 
-	uint16 mail_a, mail_b;
-	int va = e_a->GetDisplayDefaultCapacity(&mail_a);
-	int vb = e_b->GetDisplayDefaultCapacity(&mail_b);
+	uint16 mail_a = (uint16)k_a.secondary;
+	uint16 mail_b = (uint16)k_b.secondary;
+	int va = (int)k_a.primary;
+	int vb = (int)k_b.primary;
 	int r = va - vb;
 
 	if (r == 0) {
@@ -407,6 +505,16 @@ static bool AircraftEngineCargoSorter(const EngineID &a, const EngineID &b)
 	return _engine_sort_direction ? r > 0 : r < 0;
 }
 
+/**
+ * Sort key of #AircraftRangeSorter.
+ * @param engine Engine to get the key of.
+ * @return The range.
+ */
+static EngineSortKey AircraftRangeSortKey(EngineID engine)
+{
+	return {Engine::Get(engine)->GetRange(), 0};
+}
+
 /**
  * Determines order of aircraft by range.
  * @param a first engine to compare
@@ -415,8 +523,8 @@ static bool AircraftEngineCargoSorter(const EngineID &a, const EngineID &b)
  */
 static bool AircraftRangeSorter(const EngineID &a, const EngineID &b)
 {
-	uint16 r_a = Engine::Get(a)->GetRange();
-	uint16 r_b = Engine::Get(b)->GetRange();
+	uint16 r_a = (uint16)GetEngineSortKey(a, AircraftRangeSortKey).primary;
+	uint16 r_b = (uint16)GetEngineSortKey(b, AircraftRangeSortKey).primary;
 
 	int r = r_a - r_b;
 
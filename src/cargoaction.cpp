@@ -227,8 +227,9 @@ bool VehicleCargoReroute::operator()(CargoPacket *cp)
 		this->destination->AddToMeta(cp_new, VehicleCargoList::MTA_TRANSFER);
 	}
 
-	/* Legal, as front pushing doesn't invalidate iterators in std::list. */
-	this->destination->packets.push_front(cp_new);
+	/* The source list may be the destination, so the packet can't be put
+	 * into place yet. VehicleCargoList::Reroute() does that afterwards. */
+	this->rerouted->push_back(cp_new);
 	return cp_new == cp;
 }
 
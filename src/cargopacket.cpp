@@ -14,6 +14,7 @@
 #include "economy_base.h"
 #include "cargoaction.h"
 #include "order_type.h"
+#include "settings_type.h"
 
 #include "safeguards.h"
 
@@ -28,6 +29,7 @@ CargoPacket::CargoPacket()
 {
 	this->source_type = ST_INDUSTRY;
 	this->source_id   = INVALID_SOURCE;
+	this->aging_epoch = 0;
 }
 
 /**
@@ -45,6 +47,7 @@ CargoPacket::CargoPacket(StationID source, TileIndex source_xy, uint16 count, So
 	feeder_share(0),
 	count(count),
 	days_in_transit(0),
+	aging_epoch(0),
 	source_id(source_id),
 	source(source),
 	source_xy(source_xy),
@@ -72,6 +75,7 @@ CargoPacket::CargoPacket(uint16 count, byte days_in_transit, StationID source, T
 		feeder_share(feeder_share),
 		count(count),
 		days_in_transit(days_in_transit),
+		aging_epoch(0),
 		source_id(source_id),
 		source(source),
 		source_xy(source_xy),
@@ -92,18 +96,22 @@ CargoPacket *CargoPacket::Split(uint new_size)
 
 	Money fs = this->FeederShare(new_size);
 	CargoPacket *cp_new = new CargoPacket(new_size, this->days_in_transit, this->source, this->source_xy, this->loaded_at_xy, fs, this->source_type, this->source_id);
+	cp_new->aging_epoch = this->aging_epoch;
 	this->feeder_share -= fs;
 	this->count -= new_size;
 	return cp_new;
 }
 
 /**
- * Merge another packet into this one.
+ * Merge another packet into this one. The merged packet gets the average days
+ * in transit of both packets, weighted by their amounts of cargo.
  * @param cp Packet to be merged in.
  */
 void CargoPacket::Merge(CargoPacket *cp)
 {
-	this->count += cp->count;
+	uint count = this->count + cp->count;
+	this->days_in_transit = (this->days_in_transit * this->count + cp->days_in_transit * cp->count + count / 2) / count;
+	this->count = count;
 	this->feeder_share += cp->feeder_share;
 	delete cp;
 }
@@ -209,17 +217,24 @@ void CargoList<Tinst, Tcont>::InvalidateCache()
 
 /**
  * Tries to merge the second packet into the first and return if that was
- * successful.
+ * successful. Packets are merged if they are mergable in the context of the
+ * list and their days in transit differ by at most the
+ * economy.cargo_packet_merge_days setting.
  * @param icp Packet to be merged into.
  * @param cp Packet to be eliminated.
  * @return If the packets could be merged.
+ * @pre Both packets have already been added to the cache.
  */
 template <class Tinst, class Tcont>
-/* static */ bool CargoList<Tinst, Tcont>::TryMerge(CargoPacket *icp, CargoPacket *cp)
+bool CargoList<Tinst, Tcont>::TryMerge(CargoPacket *icp, CargoPacket *cp)
 {
 	if (Tinst::AreMergable(icp, cp) &&
+			Delta(icp->days_in_transit, cp->days_in_transit) <= _settings_game.economy.cargo_packet_merge_days &&
 			icp->count + cp->count <= CargoPacket::MAX_COUNT) {
+		/* The merged packet gets averaged days in transit; update the cache accordingly. */
+		uint days_in_transit = icp->days_in_transit * icp->count + cp->days_in_transit * cp->count;
 		icp->Merge(cp);
+		this->cargo_days_in_transit += icp->days_in_transit * icp->count - days_in_transit;
 		return true;
 	} else {
 		return false;
@@ -262,7 +277,8 @@ void VehicleCargoList::Append(CargoPacket *cp, MoveToAction action)
 	uint sum = cp->count;
 	for (ReverseIterator it(this->packets.rbegin()); it != this->packets.rend(); it++) {
 		CargoPacket *icp = *it;
-		if (VehicleCargoList::TryMerge(icp, cp)) return;
+		this->UpdateAge(icp);
+		if (this->TryMerge(icp, cp)) return;
 		sum += icp->count;
 		if (sum >= this->action_counts[action]) {
 			this->packets.push_back(cp);
@@ -288,11 +304,13 @@ void VehicleCargoList::ShiftCargo(Taction action)
 	while (it != this->packets.end() && action.MaxMove() > 0) {
 		CargoPacket *cp = *it;
 		if (action(cp)) {
-			it = this->packets.erase(it);
+			++it;
 		} else {
 			break;
 		}
 	}
+	/* Remove all the handled packets at once. */
+	this->packets.erase(this->packets.begin(), it);
 }
 
 /**
@@ -306,44 +324,44 @@ void VehicleCargoList::ShiftCargo(Taction action)
 template<class Taction>
 void VehicleCargoList::PopCargo(Taction action)
 {
-	if (this->packets.empty()) return;
-	Iterator it(--(this->packets.end()));
-	Iterator begin(this->packets.begin());
-	while (action.MaxMove() > 0) {
-		CargoPacket *cp = *it;
+	Iterator it(this->packets.end());
+	while (it != this->packets.begin() && action.MaxMove() > 0) {
+		CargoPacket *cp = *(it - 1);
 		if (action(cp)) {
-			if (it != begin) {
-				this->packets.erase(it--);
-			} else {
-				this->packets.erase(it);
-				break;
-			}
+			--it;
 		} else {
 			break;
 		}
 	}
+	/* Remove all the handled packets at once. */
+	this->packets.erase(it, this->packets.end());
 }
 
 /**
  * Update the cached values to reflect the removal of this packet or part of it.
- * Decreases count, feeder share and days_in_transit.
+ * Decreases count, feeder share and days_in_transit. The days in transit of
+ * the packet are brought up to date, as it is likely to leave the list.
  * @param cp Packet to be removed from cache.
  * @param count Amount of cargo from the given packet to be removed.
  */
-void VehicleCargoList::RemoveFromCache(const CargoPacket *cp, uint count)
+void VehicleCargoList::RemoveFromCache(CargoPacket *cp, uint count)
 {
+	this->UpdateAge(cp);
 	this->feeder_share -= cp->FeederShare(count);
 	this->Parent::RemoveFromCache(cp, count);
+	if (this->count == 0) this->max_days_in_transit = 0;
 }
 
 /**
  * Update the cache to reflect adding of this packet.
  * Increases count, feeder share and days_in_transit.
- * @param cp New packet to be inserted.
+ * @param cp Packet in this list to be added to the cache.
  */
-void VehicleCargoList::AddToCache(const CargoPacket *cp)
+void VehicleCargoList::AddToCache(CargoPacket *cp)
 {
+	this->UpdateAge(cp);
 	this->feeder_share += cp->feeder_share;
+	this->max_days_in_transit = max(this->max_days_in_transit, cp->days_in_transit);
 	this->Parent::AddToCache(cp);
 }
 
@@ -353,7 +371,7 @@ void VehicleCargoList::AddToCache(const CargoPacket *cp)
  * @param action MoveToAction of the packet (for updating the counts).
  * @param count Amount of cargo to be removed.
  */
-void VehicleCargoList::RemoveFromMeta(const CargoPacket *cp, MoveToAction action, uint count)
+void VehicleCargoList::RemoveFromMeta(CargoPacket *cp, MoveToAction action, uint count)
 {
 	assert(count <= this->action_counts[action]);
 	this->AssertCountConsistency();
@@ -364,29 +382,54 @@ void VehicleCargoList::RemoveFromMeta(const CargoPacket *cp, MoveToAction action
 
 /**
  * Adds a packet to the metadata.
- * @param cp Packet to be added.
+ * @param cp Packet to be added; its days in transit have to be up to date.
  * @param action MoveToAction of the packet.
  */
-void VehicleCargoList::AddToMeta(const CargoPacket *cp, MoveToAction action)
+void VehicleCargoList::AddToMeta(CargoPacket *cp, MoveToAction action)
 {
 	this->AssertCountConsistency();
+	/* From now on the packet ages with this list. */
+	cp->aging_epoch = this->aging_epoch;
 	this->AddToCache(cp);
 	this->action_counts[action] += cp->count;
 	this->AssertCountConsistency();
 }
 
 /**
- * Ages the all cargo in this list.
+ * Ages the all cargo in this list. As long as none of the packets can be at
+ * the maximum age, this only advances the aging epoch of the list; the
+ * packets catch up when their days in transit are needed.
  */
 void VehicleCargoList::AgeCargo()
 {
+	if (this->max_days_in_transit < 0xFF) {
+		this->aging_epoch++;
+		this->max_days_in_transit++;
+		this->cargo_days_in_transit += this->count;
+		return;
+	}
+
+	this->max_days_in_transit = 0;
 	for (ConstIterator it(this->packets.begin()); it != this->packets.end(); it++) {
 		CargoPacket *cp = *it;
+		this->UpdateAge(cp);
 		/* If we're at the maximum, then we can't increase no more. */
-		if (cp->days_in_transit == 0xFF) continue;
+		if (cp->days_in_transit != 0xFF) {
+			cp->days_in_transit++;
+			this->cargo_days_in_transit += cp->count;
+		}
+		this->max_days_in_transit = max(this->max_days_in_transit, cp->days_in_transit);
+	}
+}
 
-		cp->days_in_transit++;
-		this->cargo_days_in_transit += cp->count;
+/**
+ * Bring the days in transit of all packets in this list up to date, e.g.
+ * before they are saved.
+ */
+void VehicleCargoList::UpdateAges()
+{
+	for (ConstIterator it(this->packets.begin()); it != this->packets.end(); it++) {
+		this->UpdateAge(*it);
 	}
 }
 
@@ -434,7 +477,8 @@ void VehicleCargoList::SetTransferLoadPlace(TileIndex xy)
  * Stages cargo for unloading. The cargo is sorted so that packets to be
  * transferred, delivered or kept are in consecutive chunks in the list. At the
  * same time the designation_counts are updated to reflect the size of those
- * chunks.
+ * chunks. Packets to be delivered are compacted in place, the others are
+ * collected separately and put around them afterwards.
  * @param accepted If the cargo will be accepted at the station.
  * @param current_station ID of the station.
  * @param next_station ID of the station the vehicle will go to next.
@@ -448,18 +492,18 @@ bool VehicleCargoList::Stage(bool accepted, StationID current_station, StationID
 	this->AssertCountConsistency();
 	assert(this->action_counts[MTA_LOAD] == 0);
 	this->action_counts[MTA_TRANSFER] = this->action_counts[MTA_DELIVER] = this->action_counts[MTA_KEEP] = 0;
-	Iterator deliver = this->packets.end();
-	Iterator it = this->packets.begin();
-	uint sum = 0;
+	static CargoPacketList transfer;
+	static CargoPacketList keep;
+	transfer.clear();
+	keep.clear();
+	Iterator deliver = this->packets.begin();
 
 	bool force_keep = (order_flags & OUFB_NO_UNLOAD) != 0;
 	bool force_unload = (order_flags & OUFB_UNLOAD) != 0;
 	bool force_transfer = (order_flags & (OUFB_TRANSFER | OUFB_UNLOAD)) != 0;
-	assert(this->count > 0 || it == this->packets.end());
-	while (sum < this->count) {
+	for (Iterator it = this->packets.begin(); it != this->packets.end(); ++it) {
 		CargoPacket *cp = *it;
 
-		this->packets.erase(it++);
 		StationID cargo_next = INVALID_STATION;
 		MoveToAction action = MTA_LOAD;
 		if (force_keep) {
@@ -510,14 +554,15 @@ bool VehicleCargoList::Stage(bool accepted, StationID current_station, StationID
 		Money share;
 		switch (action) {
 			case MTA_KEEP:
-				this->packets.push_back(cp);
-				if (deliver == this->packets.end()) --deliver;
+				keep.push_back(cp);
 				break;
 			case MTA_DELIVER:
-				this->packets.insert(deliver, cp);
+				*deliver++ = cp;
 				break;
 			case MTA_TRANSFER:
-				this->packets.push_front(cp);
+				transfer.push_back(cp);
+				/* The transfer payment depends on the days in transit. */
+				this->UpdateAge(cp);
 				/* Add feeder share here to allow reusing field for next station. */
 				share = payment->PayTransfer(cp, cp->count);
 				cp->AddFeederShare(share);
@@ -528,8 +573,12 @@ bool VehicleCargoList::Stage(bool accepted, StationID current_station, StationID
 				NOT_REACHED();
 		}
 		this->action_counts[action] += cp->count;
-		sum += cp->count;
 	}
+
+	/* Transferred cargo goes in front, the latest staged packet first. */
+	this->packets.erase(deliver, this->packets.end());
+	this->packets.insert(this->packets.begin(), transfer.rbegin(), transfer.rend());
+	this->packets.insert(this->packets.end(), keep.begin(), keep.end());
 	this->AssertCountConsistency();
 	return this->action_counts[MTA_DELIVER] > 0 || this->action_counts[MTA_TRANSFER] > 0;
 }
@@ -584,7 +633,7 @@ uint VehicleCargoList::Reassign<VehicleCargoList::MTA_DELIVER, VehicleCargoList:
 		if (sum > this->action_counts[MTA_TRANSFER] + max_move) {
 			CargoPacket *cp_split = cp->Split(sum - this->action_counts[MTA_TRANSFER] + max_move);
 			sum -= cp_split->Count();
-			this->packets.insert(it, cp_split);
+			it = this->packets.insert(it, cp_split) + 1;
 		}
 		cp->next_station = next_station;
 	}
@@ -669,7 +718,10 @@ uint VehicleCargoList::Truncate(uint max_move)
 uint VehicleCargoList::Reroute(uint max_move, VehicleCargoList *dest, StationID avoid, StationID avoid2, const GoodsEntry *ge)
 {
 	max_move = min(this->action_counts[MTA_TRANSFER], max_move);
-	this->ShiftCargo(VehicleCargoReroute(this, dest, max_move, avoid, avoid2, ge));
+	CargoPacketList rerouted;
+	this->ShiftCargo(VehicleCargoReroute(this, dest, max_move, avoid, avoid2, ge, &rerouted));
+	/* Prepend the rerouted cargo to the destination, the last rerouted packet first. */
+	dest->packets.insert(dest->packets.begin(), rerouted.rbegin(), rerouted.rend());
 	return max_move;
 }
 
@@ -695,7 +747,7 @@ void StationCargoList::Append(CargoPacket *cp, StationID next)
 	StationCargoPacketMap::List &list = this->packets[next];
 	for (StationCargoPacketMap::List::reverse_iterator it(list.rbegin());
 			it != list.rend(); it++) {
-		if (StationCargoList::TryMerge(*it, cp)) return;
+		if (this->TryMerge(*it, cp)) return;
 	}
 
 	/* The packet could not be merged with another one */
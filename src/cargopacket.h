@@ -17,7 +17,7 @@
 #include "cargo_type.h"
 #include "vehicle_type.h"
 #include "core/multimap.hpp"
-#include <list>
+#include <vector>
 
 /** Unique identifier for a single cargo packet. */
 typedef uint32 CargoPacketID;
@@ -43,7 +43,8 @@ struct CargoPacket : CargoPacketPool::PoolItem<&_cargopacket_pool> {
 private:
 	Money feeder_share;     ///< Value of feeder pickup to be paid for on delivery of cargo.
 	uint16 count;           ///< The amount of cargo in this packet.
-	byte days_in_transit;   ///< Amount of days this packet has been in transit.
+	byte days_in_transit;   ///< Amount of days this packet has been in transit; in a vehicle only up to the aging epoch.
+	byte aging_epoch;       ///< Aging epoch of the vehicle cargo list up to which #days_in_transit is up to date.
 	SourceType source_type; ///< Type of \c source_id.
 	SourceID source_id;     ///< Index of source, INVALID_SOURCE if unknown/invalid.
 	StationID source;       ///< The station where the cargo came from first.
@@ -125,7 +126,8 @@ public:
 	/**
 	 * Gets the number of days this cargo has been in transit.
 	 * This number isn't really in days, but in 2.5 days (CARGO_AGING_TICKS = 185 ticks) and
-	 * it is capped at 255.
+	 * it is capped at 255. For packets in a vehicle it is only up to date after
+	 * VehicleCargoList::UpdateAge().
 	 * @return Length this cargo has been in transit.
 	 */
 	inline byte DaysInTransit() const
@@ -229,7 +231,7 @@ protected:
 
 	void RemoveFromCache(const CargoPacket *cp, uint count);
 
-	static bool TryMerge(CargoPacket *cp, CargoPacket *icp);
+	bool TryMerge(CargoPacket *cp, CargoPacket *icp);
 
 public:
 	/** Create the cargo list. */
@@ -260,7 +262,7 @@ public:
 	void InvalidateCache();
 };
 
-typedef std::list<CargoPacket *> CargoPacketList;
+typedef std::vector<CargoPacket *> CargoPacketList;
 
 /**
  * CargoList that is used for vehicles.
@@ -272,6 +274,8 @@ protected:
 
 	Money feeder_share;                     ///< Cache for the feeder share.
 	uint action_counts[NUM_MOVE_TO_ACTION]; ///< Counts of cargo to be transferred, delivered, kept and loaded.
+	byte aging_epoch;                       ///< Number of times the cargo has been aged, wrapping around; packets are aged lazily relative to it.
+	byte max_days_in_transit;               ///< Upper bound of the days in transit of the packets, to know when aging may hit the cap.
 
 	template<class Taction>
 	void ShiftCargo(Taction action);
@@ -290,11 +294,23 @@ protected:
 				this->action_counts[MTA_LOAD] == this->count);
 	}
 
-	void AddToCache(const CargoPacket *cp);
-	void RemoveFromCache(const CargoPacket *cp, uint count);
+	void AddToCache(CargoPacket *cp);
+	void RemoveFromCache(CargoPacket *cp, uint count);
 
-	void AddToMeta(const CargoPacket *cp, MoveToAction action);
-	void RemoveFromMeta(const CargoPacket *cp, MoveToAction action, uint count);
+	void AddToMeta(CargoPacket *cp, MoveToAction action);
+	void RemoveFromMeta(CargoPacket *cp, MoveToAction action, uint count);
+
+	/**
+	 * Bring the days in transit of a packet in this list up to date with the
+	 * aging of the list. The packets are not aged one by one, but have the
+	 * aging since their epoch added when needed.
+	 * @param cp Packet in this list.
+	 */
+	inline void UpdateAge(CargoPacket *cp) const
+	{
+		cp->days_in_transit += (byte)(this->aging_epoch - cp->aging_epoch);
+		cp->aging_epoch = this->aging_epoch;
+	}
 
 	static MoveToAction ChooseAction(const CargoPacket *cp, StationID cargo_next,
 			StationID current_station, bool accepted, StationIDStack next_station);
@@ -393,6 +409,8 @@ public:
 
 	void AgeCargo();
 
+	void UpdateAges();
+
 	void InvalidateCache();
 
 	void SetTransferLoadPlace(TileIndex xy);
@@ -424,7 +442,8 @@ public:
 
 	/**
 	 * Are two the two CargoPackets mergeable in the context of
-	 * a list of CargoPackets for a Vehicle?
+	 * a list of CargoPackets for a Vehicle? The days in transit are checked
+	 * separately by TryMerge().
 	 * @param cp1 First CargoPacket.
 	 * @param cp2 Second CargoPacket.
 	 * @return True if they are mergeable.
@@ -432,7 +451,6 @@ public:
 	static bool AreMergable(const CargoPacket *cp1, const CargoPacket *cp2)
 	{
 		return cp1->source_xy    == cp2->source_xy &&
-				cp1->days_in_transit == cp2->days_in_transit &&
 				cp1->source_type     == cp2->source_type &&
 				cp1->source_id       == cp2->source_id &&
 				cp1->loaded_at_xy    == cp2->loaded_at_xy;
@@ -539,7 +557,8 @@ public:
 
 	/**
 	 * Are two the two CargoPackets mergeable in the context of
-	 * a list of CargoPackets for a Vehicle?
+	 * a list of CargoPackets for a Vehicle? The days in transit are checked
+	 * separately by TryMerge().
 	 * @param cp1 First CargoPacket.
 	 * @param cp2 Second CargoPacket.
 	 * @return True if they are mergeable.
@@ -547,7 +566,6 @@ public:
 	static bool AreMergable(const CargoPacket *cp1, const CargoPacket *cp2)
 	{
 		return cp1->source_xy    == cp2->source_xy &&
-				cp1->days_in_transit == cp2->days_in_transit &&
 				cp1->source_type     == cp2->source_type &&
 				cp1->source_id       == cp2->source_id;
 	}
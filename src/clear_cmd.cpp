@@ -9,6 +9,7 @@
 
 #include "stdafx.h"
 #include "clear_map.h"
+#include "clear_func.h"
 #include "command_func.h"
 #include "landscape.h"
 #include "genworld.h"
@@ -173,20 +174,23 @@ static void UpdateFences(TileIndex tile)
 }
 
 
-/** Convert to or from snowy tiles. */
-static void TileLoopClearAlps(TileIndex tile)
+/**
+ * Convert to or from snowy tiles.
+ * @param tile The tile to update.
+ * @return Whether the tile has changed.
+ */
+static bool TileLoopClearAlps(TileIndex tile)
 {
 	int k = GetTileZ(tile) - GetSnowLine() + 1;
 
 	if (k < 0) {
 		/* Below the snow line, do nothing if no snow. */
-		if (!IsSnowTile(tile)) return;
+		if (!IsSnowTile(tile)) return false;
 	} else {
 		/* At or above the snow line, make snow tile if needed. */
 		if (!IsSnowTile(tile)) {
 			MakeSnow(tile);
-			MarkTileDirtyByTile(tile);
-			return;
+			return true;
 		}
 	}
 	/* Update snow density. */
@@ -199,10 +203,10 @@ static void TileLoopClearAlps(TileIndex tile)
 		AddClearDensity(tile, -1);
 	} else {
 		/* Density at the required level. */
-		if (k >= 0) return;
+		if (k >= 0) return false;
 		ClearSnow(tile);
 	}
-	MarkTileDirtyByTile(tile);
+	return true;
 }
 
 /**
@@ -221,7 +225,12 @@ static inline bool NeighbourIsNormal(TileIndex tile)
 	return false;
 }
 
-static void TileLoopClearDesert(TileIndex tile)
+/**
+ * Convert to or from desert tiles.
+ * @param tile The tile to update.
+ * @return Whether the tile has changed.
+ */
+static bool TileLoopClearDesert(TileIndex tile)
 {
 	/* Current desert level - 0 if it is not desert */
 	uint current = 0;
@@ -233,7 +242,7 @@ static void TileLoopClearDesert(TileIndex tile)
 		expected = NeighbourIsNormal(tile) ? 1 : 3;
 	}
 
-	if (current == expected) return;
+	if (current == expected) return false;
 
 	if (expected == 0) {
 		SetClearGroundDensity(tile, CLEAR_GRASS, 3);
@@ -242,35 +251,30 @@ static void TileLoopClearDesert(TileIndex tile)
 		SetClearGroundDensity(tile, CLEAR_DESERT, expected);
 	}
 
-	MarkTileDirtyByTile(tile);
+	return true;
 }
 
-static void TileLoop_Clear(TileIndex tile)
+/**
+ * Update the ground of a clear tile: snow, desert, grass growth and fields.
+ * @param tile The tile to update.
+ * @return Whether the tile has to be redrawn.
+ */
+static bool TileLoopClearGround(TileIndex tile)
 {
-	/* If the tile is at any edge flood it to prevent maps without water. */
-	if (_settings_game.construction.freeform_edges && DistanceFromEdge(tile) == 1) {
-		int z;
-		if (IsTileFlat(tile, &z) && z == 0) {
-			DoFloodTile(tile);
-			MarkTileDirtyByTile(tile);
-			return;
-		}
-	}
-	AmbientSoundEffect(tile);
-
+	bool dirty = false;
 	switch (_settings_game.game_creation.landscape) {
-		case LT_TROPIC: TileLoopClearDesert(tile); break;
-		case LT_ARCTIC: TileLoopClearAlps(tile);   break;
+		case LT_TROPIC: dirty = TileLoopClearDesert(tile); break;
+		case LT_ARCTIC: dirty = TileLoopClearAlps(tile);   break;
 	}
 
 	switch (GetClearGround(tile)) {
 		case CLEAR_GRASS:
-			if (GetClearDensity(tile) == 3) return;
+			if (GetClearDensity(tile) == 3) return dirty;
 
 			if (_game_mode != GM_EDITOR) {
 				if (GetClearCounter(tile) < 7) {
 					AddClearCounter(tile, 1);
-					return;
+					return dirty;
 				} else {
 					SetClearCounter(tile, 0);
 					AddClearDensity(tile, 1);
@@ -283,11 +287,11 @@ static void TileLoop_Clear(TileIndex tile)
 		case CLEAR_FIELDS:
 			UpdateFences(tile);
 
-			if (_game_mode == GM_EDITOR) return;
+			if (_game_mode == GM_EDITOR) return dirty;
 
 			if (GetClearCounter(tile) < 7) {
 				AddClearCounter(tile, 1);
-				return;
+				return dirty;
 			} else {
 				SetClearCounter(tile, 0);
 			}
@@ -303,10 +307,36 @@ static void TileLoop_Clear(TileIndex tile)
 			break;
 
 		default:
+			return dirty;
+	}
+
+	return true;
+}
+
+static void TileLoop_Clear(TileIndex tile)
+{
+	/* If the tile is at any edge flood it to prevent maps without water. */
+	if (_settings_game.construction.freeform_edges && DistanceFromEdge(tile) == 1) {
+		int z;
+		if (IsTileFlat(tile, &z) && z == 0) {
+			DoFloodTile(tile);
+			MarkTileDirtyByTile(tile);
 			return;
+		}
 	}
+	AmbientSoundEffect(tile);
+
+	if (TileLoopClearGround(tile)) MarkTileDirtyByTile(tile);
+}
+
+TileLoopLocalResult TileLoopLocal_Clear(TileIndex tile)
+{
+	/* Randomness, sound callbacks, flooding and the fences of fields affect more than this tile. */
+	if (_game_mode == GM_EDITOR || HasGrfMiscBit(GMB_AMBIENT_SOUND_CALLBACK)) return TLLR_SERIAL;
+	if (_settings_game.construction.freeform_edges && DistanceFromEdge(tile) == 1) return TLLR_SERIAL;
+	if (IsClearGround(tile, CLEAR_FIELDS)) return TLLR_SERIAL;
 
-	MarkTileDirtyByTile(tile);
+	return TileLoopClearGround(tile) ? TLLR_DIRTY : TLLR_DONE;
 }
 
 void GenerateClearTile()
@@ -398,4 +428,5 @@ extern const TileTypeProcs _tile_type_clear_procs = {
 	nullptr,                     ///< vehicle_enter_tile_proc
 	GetFoundation_Clear,      ///< get_foundation_proc
 	TerraformTile_Clear,      ///< terraform_tile_proc
+	TileLoopLocal_Clear,      ///< tile_loop_local_proc
 };
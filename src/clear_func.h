@@ -14,5 +14,6 @@
 
 void DrawHillyLandTile(const TileInfo *ti);
 void DrawClearLandTile(const TileInfo *ti, byte set);
+TileLoopLocalResult TileLoopLocal_Clear(TileIndex tile);
 
 #endif /* CLEAR_FUNC_H */
@@ -24,6 +24,9 @@
 #include "signal_func.h"
 #include "core/backup_type.hpp"
 #include "object_base.h"
+#include "newgrf_spritegroup.h"
+#include "settings_type.h"
+#include <deque>
 
 #include "table/strings.h"
 
@@ -234,7 +237,7 @@ static const Command _command_proc_table[] = {
 	DEF_CMD(CmdBuildRoadStop,            CMD_NO_WATER | CMD_AUTO, CMDT_LANDSCAPE_CONSTRUCTION), // CMD_BUILD_ROAD_STOP
 	DEF_CMD(CmdRemoveRoadStop,                                 0, CMDT_LANDSCAPE_CONSTRUCTION), // CMD_REMOVE_ROAD_STOP
 	DEF_CMD(CmdBuildLongRoad,CMD_DEITY | CMD_NO_WATER | CMD_AUTO, CMDT_LANDSCAPE_CONSTRUCTION), // CMD_BUILD_LONG_ROAD
-	DEF_CMD(CmdRemoveLongRoad,            CMD_NO_TEST | CMD_AUTO, CMDT_LANDSCAPE_CONSTRUCTION), // CMD_REMOVE_LONG_ROAD; towns may disallow removing road bits (as they are connected) in test, but in exec they're removed and thus removing is allowed.
+	DEF_CMD(CmdRemoveLongRoad, CMD_NO_TEST | CMD_EXEC_TESTS | CMD_AUTO, CMDT_LANDSCAPE_CONSTRUCTION), // CMD_REMOVE_LONG_ROAD; towns may disallow removing road bits (as they are connected) in test, but in exec they're removed and thus removing is allowed.
 	DEF_CMD(CmdBuildRoad,    CMD_DEITY | CMD_NO_WATER | CMD_AUTO, CMDT_LANDSCAPE_CONSTRUCTION), // CMD_BUILD_ROAD
 	DEF_CMD(CmdBuildRoadDepot,           CMD_NO_WATER | CMD_AUTO, CMDT_LANDSCAPE_CONSTRUCTION), // CMD_BUILD_ROAD_DEPOT
 	DEF_CMD(CmdConvertRoad,                                    0, CMDT_LANDSCAPE_CONSTRUCTION), // CMD_CONVERT_ROAD
@@ -306,7 +309,7 @@ static const Command _command_proc_table[] = {
 	DEF_CMD(CmdOrderRefit,                                     0, CMDT_ROUTE_MANAGEMENT      ), // CMD_ORDER_REFIT
 	DEF_CMD(CmdCloneOrder,                                     0, CMDT_ROUTE_MANAGEMENT      ), // CMD_CLONE_ORDER
 
-	DEF_CMD(CmdClearArea,                            CMD_NO_TEST, CMDT_LANDSCAPE_CONSTRUCTION), // CMD_CLEAR_AREA; destroying multi-tile houses makes town rating differ between test and execution
+	DEF_CMD(CmdClearArea,           CMD_NO_TEST | CMD_EXEC_TESTS, CMDT_LANDSCAPE_CONSTRUCTION), // CMD_CLEAR_AREA; destroying multi-tile houses makes town rating differ between test and execution
 
 	DEF_CMD(CmdMoneyCheat,                           CMD_OFFLINE, CMDT_CHEAT                 ), // CMD_MONEY_CHEAT
 	DEF_CMD(CmdChangeBankBalance,                      CMD_DEITY, CMDT_MONEY_MANAGEMENT      ), // CMD_CHANGE_BANK_BALANCE
@@ -331,7 +334,7 @@ static const Command _command_proc_table[] = {
 	DEF_CMD(CmdRemoveStoryPageElement,                 CMD_DEITY, CMDT_OTHER_MANAGEMENT      ), // CMD_REMOVE_STORY_ELEMENT_PAGE
 	DEF_CMD(CmdScrollViewport,                         CMD_DEITY, CMDT_OTHER_MANAGEMENT      ), // CMD_SCROLL_VIEWPORT
 
-	DEF_CMD(CmdLevelLand, CMD_ALL_TILES | CMD_NO_TEST | CMD_AUTO, CMDT_LANDSCAPE_CONSTRUCTION), // CMD_LEVEL_LAND; test run might clear tiles multiple times, in execution that only happens once
+	DEF_CMD(CmdLevelLand, CMD_ALL_TILES | CMD_NO_TEST | CMD_EXEC_TESTS | CMD_AUTO, CMDT_LANDSCAPE_CONSTRUCTION), // CMD_LEVEL_LAND; test run might clear tiles multiple times, in execution that only happens once
 
 	DEF_CMD(CmdBuildLock,                               CMD_AUTO, CMDT_LANDSCAPE_CONSTRUCTION), // CMD_BUILD_LOCK
 
@@ -434,6 +437,42 @@ bool IsCommandAllowedWhilePaused(uint32 cmd)
 
 static int _docommand_recursive = 0;
 
+/** A command sent to the server whose estimated cost was already shown to the local company. */
+struct PredictedCommand {
+	TileIndex tile; ///< Tile of the command.
+	uint32 p1;      ///< Parameter p1 of the command.
+	uint32 p2;      ///< Parameter p2 of the command.
+	uint32 cmd;     ///< Command ID, without flags.
+	Money cost;     ///< Estimated cost that was shown.
+};
+
+/** Number of predictions remembered; older ones are dropped, e.g. when the server refused the command. */
+static const uint MAX_PREDICTED_COMMANDS = 64;
+
+/** Predictions waiting for their command to be executed, oldest first. */
+static std::deque<PredictedCommand> _predicted_commands;
+
+/**
+ * Find and forget the prediction made when a command was sent to the server.
+ * @param tile The tile of the executed command.
+ * @param p1 Parameter p1 of the executed command.
+ * @param p2 Parameter p2 of the executed command.
+ * @param cmd The executed command.
+ * @param[out] cost The predicted cost, when a prediction was found.
+ * @return Whether a prediction was made for this command.
+ */
+static bool TakePredictedCommand(TileIndex tile, uint32 p1, uint32 p2, uint32 cmd, Money *cost)
+{
+	for (auto it = _predicted_commands.begin(); it != _predicted_commands.end(); ++it) {
+		if (it->tile == tile && it->p1 == p1 && it->p2 == p2 && it->cmd == (cmd & CMD_ID_MASK)) {
+			*cost = it->cost;
+			_predicted_commands.erase(it);
+			return true;
+		}
+	}
+	return false;
+}
+
 /**
  * Shorthand for calling the long DoCommand with a container.
  *
@@ -582,6 +621,11 @@ bool DoCommandP(TileIndex tile, uint32 p1, uint32 p2, uint32 cmd, CommandCallbac
 	if (!(cmd & CMD_NETWORK_COMMAND) && GetCommandFlags(cmd) & CMD_CLIENT_ID && p2 == 0) p2 = CLIENT_ID_SERVER;
 
 	CommandCost res = DoCommandPInternal(tile, p1, p2, cmd, callback, text, my_cmd, estimate_only);
+
+	/* When the estimate was shown while sending, only show the actual cost if it differs. */
+	Money predicted_cost;
+	bool predicted = (cmd & CMD_NETWORK_COMMAND) && my_cmd && !_predicted_commands.empty() && TakePredictedCommand(tile, p1, p2, cmd, &predicted_cost);
+
 	if (res.Failed()) {
 		/* Only show the error when it's for us. */
 		StringID error_part1 = GB(cmd, 16, 16);
@@ -590,7 +634,8 @@ bool DoCommandP(TileIndex tile, uint32 p1, uint32 p2, uint32 cmd, CommandCallbac
 		}
 	} else if (estimate_only) {
 		ShowEstimatedCostOrIncome(res.GetCost(), x, y);
-	} else if (!only_sending && res.GetCost() != 0 && tile != 0 && IsLocalCompany() && _game_mode != GM_EDITOR) {
+	} else if (!only_sending && res.GetCost() != 0 && tile != 0 && IsLocalCompany() && _game_mode != GM_EDITOR &&
+			!(predicted && predicted_cost == res.GetCost())) {
 		/* Only show the cost animation when we did actually
 		 * execute the command, i.e. we're not sending it to
 		 * the server, when it has cost the local company
@@ -669,14 +714,26 @@ CommandCost DoCommandPInternal(TileIndex tile, uint32 p1, uint32 p2, uint32 cmd,
 	if (exec_as_spectator) cur_company.Change(COMPANY_SPECTATOR);
 
 	bool test_and_exec_can_differ = (cmd_flags & CMD_NO_TEST) != 0;
+	assert(test_and_exec_can_differ || (cmd_flags & CMD_EXEC_TESTS) == 0);
+
+	/* Area commands test every tile right before executing it, and only fail
+	 * as a whole when none of the tiles can be done. For these commands the
+	 * test only tells whether the command fails, which the execution finds
+	 * out just as well without changing anything. So when the command is
+	 * executed right away, don't sweep over the whole area twice. */
+	bool execute_now = !_networking || _generating_world || (cmd & CMD_NETWORK_COMMAND) != 0;
+	bool skip_test = (cmd_flags & CMD_EXEC_TESTS) != 0 && !estimate_only && execute_now;
 
 	/* Test the command. */
-	_cleared_object_areas.clear();
-	SetTownRatingTestMode(true);
-	BasePersistentStorageArray::SwitchMode(PSM_ENTER_TESTMODE);
-	CommandCost res = proc(tile, flags, p1, p2, text);
-	BasePersistentStorageArray::SwitchMode(PSM_LEAVE_TESTMODE);
-	SetTownRatingTestMode(false);
+	CommandCost res;
+	if (!skip_test) {
+		_cleared_object_areas.clear();
+		SetTownRatingTestMode(true);
+		BasePersistentStorageArray::SwitchMode(PSM_ENTER_TESTMODE);
+		res = proc(tile, flags, p1, p2, text);
+		BasePersistentStorageArray::SwitchMode(PSM_LEAVE_TESTMODE);
+		SetTownRatingTestMode(false);
+	}
 
 	/* Make sure we're not messing things up here. */
 	assert(exec_as_spectator ? _current_company == COMPANY_SPECTATOR : cur_company.Verify());
@@ -688,7 +745,7 @@ CommandCost DoCommandPInternal(TileIndex tile, uint32 p1, uint32 p2, uint32 cmd,
 	 * we bail out here. */
 	if (res.Failed() || estimate_only ||
 			(!test_and_exec_can_differ && !CheckCompanyHasMoney(res))) {
-		if (!_networking || _generating_world || (cmd & CMD_NETWORK_COMMAND) != 0) {
+		if (execute_now) {
 			/* Log the failed command as well. Just to be able to be find
 			 * causes of desyncs due to bad command test implementations. */
 			DEBUG(desync, 1, "cmdf: %08x; %02x; %02x; %06x; %08x; %08x; %08x; \"%s\" (%s)", _date, _date_fract, (int)_current_company, tile, p1, p2, cmd & ~CMD_NETWORK_COMMAND, text, GetCommandName(cmd));
@@ -703,6 +760,19 @@ CommandCost DoCommandPInternal(TileIndex tile, uint32 p1, uint32 p2, uint32 cmd,
 	 */
 	if (_networking && !_generating_world && !(cmd & CMD_NETWORK_COMMAND)) {
 		NetworkSendCommand(tile, p1, p2, cmd & ~CMD_FLAGS_MASK, callback, text, _current_company);
+
+		if (my_cmd && _settings_client.gui.predict_command_cost && res.GetCost() != 0 && tile != 0 && IsLocalCompany() && _game_mode != GM_EDITOR) {
+			/* Show the cost of the test run right away, instead of after the
+			 * round trip to the server. DoCommandP reconciles it with the
+			 * actual cost once the command is executed. */
+			if (_predicted_commands.size() >= MAX_PREDICTED_COMMANDS) _predicted_commands.pop_front();
+			_predicted_commands.push_back({tile, p1, p2, cmd & CMD_ID_MASK, res.GetCost()});
+
+			int x = TileX(tile) * TILE_SIZE;
+			int y = TileY(tile) * TILE_SIZE;
+			ShowCostOrIncomeAnimation(x, y, GetSlopePixelZ(x, y), res.GetCost());
+		}
+
 		cur_company.Restore();
 
 		/* Don't return anything special here; no error, no costs.
@@ -719,6 +789,8 @@ CommandCost DoCommandPInternal(TileIndex tile, uint32 p1, uint32 p2, uint32 cmd,
 	BasePersistentStorageArray::SwitchMode(PSM_ENTER_COMMAND);
 	CommandCost res2 = proc(tile, flags | DC_EXEC, p1, p2, text);
 	BasePersistentStorageArray::SwitchMode(PSM_LEAVE_COMMAND);
+	/* Commands can change the settings and date that callbacks may depend on. */
+	InvalidateNewGRFCallbackCache();
 
 	if (cmd_id == CMD_COMPANY_CTRL) {
 		cur_company.Trash();
@@ -397,6 +397,7 @@ enum CommandFlags {
 	CMD_DEITY     = 0x100, ///< the command may be executed by COMPANY_DEITY
 	CMD_STR_CTRL  = 0x200, ///< the command's string may contain control strings
 	CMD_NO_EST    = 0x400, ///< the command is never estimated.
+	CMD_EXEC_TESTS = 0x800, ///< the command tests each of its steps while executing, so it is only tested as a whole for estimates and before sending it; implies #CMD_NO_TEST semantics.
 };
 DECLARE_ENUM_AS_BIT_SET(CommandFlags)
 
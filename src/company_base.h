@@ -46,6 +46,15 @@ struct CompanyInfrastructure {
 	uint32 GetTramTotal() const;
 };
 
+/** Totals of the company owned assets that make up the company value. */
+struct CompanyAssets {
+	Money vehicle_value;       ///< Value of the company's vehicles for the company value, see #GetVehicleAssetValue.
+	uint32 station_facilities; ///< Count of the facilities of the company's stations.
+
+	bool operator==(const CompanyAssets &other) const { return this->vehicle_value == other.vehicle_value && this->station_facilities == other.station_facilities; }
+	bool operator!=(const CompanyAssets &other) const { return !(*this == other); }
+};
+
 typedef Pool<Company, CompanyID, 1, MAX_COMPANIES> CompanyPool;
 extern CompanyPool _company_pool;
 
@@ -129,6 +138,7 @@ struct Company : CompanyPool::PoolItem<&_company_pool>, CompanyProperties {
 	GroupStatistics group_default[VEH_COMPANY_END];  ///< NOSAVE: Statistics for the DEFAULT_GROUP group.
 
 	CompanyInfrastructure infrastructure; ///< NOSAVE: Counts of company owned infrastructure.
+	CompanyAssets assets;                 ///< NOSAVE: Totals of company owned assets, kept up to date as they change.
 
 	/**
 	 * Is this company a valid company, controlled by the computer (a NoAI program)?
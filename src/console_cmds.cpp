@@ -34,6 +34,8 @@
 #include "ai/ai_config.hpp"
 #include "newgrf.h"
 #include "newgrf_profiling.h"
+#include "pathfinder/pf_trace.h"
+#include "trace_zone.h"
 #include "console_func.h"
 #include "engine_base.h"
 #include "game/game.hpp"
@@ -1370,14 +1372,22 @@ DEF_CONSOLE_CMD(ConAlias)
 DEF_CONSOLE_CMD(ConScreenShot)
 {
 	if (argc == 0) {
-		IConsoleHelp("Create a screenshot of the game. Usage: 'screenshot [big | giant | no_con | minimap] [file name]'");
+		IConsoleHelp("Create a screenshot of the game. Usage: 'screenshot [big | giant | no_con | minimap | smallmap <type>] [file name]'");
 		IConsoleHelp("'big' makes a zoomed-in screenshot of the visible area, 'giant' makes a screenshot of the "
 				"whole map, 'no_con' hides the console to create the screenshot. 'big' or 'giant' "
 				"screenshots are always drawn without console. "
-				"'minimap' makes a top-viewed minimap screenshot of whole world which represents one tile by one pixel.");
+				"'minimap' makes a top-viewed minimap screenshot of whole world which represents one tile by one pixel. "
+				"'smallmap' does the same with the colours of the smallmap; <type> is one of 'contours', 'vehicles', "
+				"'industries', 'routes', 'vegetation' or 'owners'. It is written in the background, and also works on dedicated servers.");
 		return true;
 	}
 
+	if (argc > 1 && strcmp(argv[1], "smallmap") == 0) {
+		/* screenshot smallmap <type> [filename] */
+		if (argc < 3 || argc > 4) return false;
+		return MakeSmallMapScreenshot(argv[2], argc > 3 ? argv[3] : nullptr);
+	}
+
 	if (argc > 3) return false;
 
 	ScreenshotType type = SC_VIEWPORT;
@@ -1910,8 +1920,12 @@ DEF_CONSOLE_CMD(ConNewGRFProfile)
 		IConsoleHelp("  Unselect one or more GRFs from profiling. Use the keyword \"all\" instead of a GRF number to unselect all. Removing an active profiler aborts data collection.");
 		IConsoleHelp("Usage: newgrf_profile start [<num-days>]");
 		IConsoleHelp("  Begin profiling all selected GRFs. If a number of days is provided, profiling stops after that many in-game days.");
+		IConsoleHelp("Usage: newgrf_profile aggregate [<num-days>]");
+		IConsoleHelp("  Like start, but only keep the totals per sprite group, which are printed to the console instead of written to CSV files.");
+		IConsoleHelp("Usage: newgrf_profile report [<count>]");
+		IConsoleHelp("  Print the sprite groups that took the most time so far in the aggregated profiles, 10 unless a count is given.");
 		IConsoleHelp("Usage: newgrf_profile stop");
-		IConsoleHelp("  End profiling and write the collected data to CSV files.");
+		IConsoleHelp("  End profiling and write the collected data to CSV files, or print the totals of aggregated profiles.");
 		IConsoleHelp("Usage: newgrf_profile abort");
 		IConsoleHelp("  End profiling and discard all collected data.");
 		return true;
@@ -1973,13 +1987,14 @@ DEF_CONSOLE_CMD(ConNewGRFProfile)
 		return true;
 	}
 
-	/* "start" sub-command */
-	if (strncasecmp(argv[1], "sta", 3) == 0) {
+	/* "start" and "aggregate" sub-commands */
+	if (strncasecmp(argv[1], "sta", 3) == 0 || strncasecmp(argv[1], "agg", 3) == 0) {
+		bool aggregate = strncasecmp(argv[1], "agg", 3) == 0;
 		std::string grfids;
 		size_t started = 0;
 		for (NewGRFProfiler &pr : _newgrf_profilers) {
 			if (!pr.active) {
-				pr.Start();
+				pr.Start(aggregate);
 				started++;
 
 				if (!grfids.empty()) grfids += ", ";
@@ -2009,6 +2024,19 @@ DEF_CONSOLE_CMD(ConNewGRFProfile)
 		return true;
 	}
 
+	/* "report" sub-command */
+	if (strncasecmp(argv[1], "rep", 3) == 0) {
+		uint count = argc >= 3 ? max(atoi(argv[2]), 1) : 10;
+		bool reported = false;
+		for (const NewGRFProfiler &pr : _newgrf_profilers) {
+			if (!pr.active || !pr.aggregate) continue;
+			pr.PrintAggregates(count);
+			reported = true;
+		}
+		if (!reported) IConsolePrintF(CC_WARNING, "No aggregated profiles are running.");
+		return true;
+	}
+
 	/* "stop" sub-command */
 	if (strncasecmp(argv[1], "sto", 3) == 0) {
 		NewGRFProfiler::FinishAll();
@@ -2053,6 +2081,19 @@ DEF_CONSOLE_CMD(ConFramerate)
 	return true;
 }
 
+DEF_CONSOLE_CMD(ConFramePercentiles)
+{
+	extern void ConPrintFramePercentiles(); // framerate_gui.cpp
+
+	if (argc == 0) {
+		IConsoleHelp("Show the distribution of the recent durations of the measured game loop, drawing and script elements");
+		return true;
+	}
+
+	ConPrintFramePercentiles();
+	return true;
+}
+
 DEF_CONSOLE_CMD(ConFramerateWindow)
 {
 	extern void ShowFramerateWindow();
@@ -2071,6 +2112,56 @@ DEF_CONSOLE_CMD(ConFramerateWindow)
 	return true;
 }
 
+DEF_CONSOLE_CMD(ConPathfinderTrace)
+{
+	if (argc == 0) {
+		IConsoleHelp("Record the pathfinder requests of all vehicles, or compare them with a recorded trace. Usage: 'pf_trace record|replay <file>' or 'pf_trace stop'");
+		IConsoleHelp("Start a replay in the same state of the game as the recording, e.g. directly after loading the same savegame.");
+		IConsoleHelp("Stopping a replay prints the nodes expanded, cache hits and time of the recorded and replayed requests.");
+		return true;
+	}
+
+	if (argc == 2 && strcasecmp(argv[1], "stop") == 0) {
+		if (!PfTraceStop()) IConsoleWarning("pathfinder tracing is not active");
+		return true;
+	}
+
+	if (argc != 3) return false;
+
+	if (strcasecmp(argv[1], "record") == 0) {
+		if (!PfTraceStartRecording(argv[2])) IConsoleError("could not open trace file");
+		return true;
+	}
+
+	if (strcasecmp(argv[1], "replay") == 0) {
+		if (!PfTraceStartReplay(argv[2])) IConsoleError("could not read trace file");
+		return true;
+	}
+
+	return false;
+}
+
+DEF_CONSOLE_CMD(ConTraceZones)
+{
+	if (argc == 0) {
+		IConsoleHelp("Record how long the parts of the game loop take, per vehicle, station, town, industry and company, to a trace file. Usage: 'trace_zones start <file>' or 'trace_zones stop'");
+		IConsoleHelp("The trace is in the Chrome trace event format; open it with chrome://tracing or Perfetto, or import it into Tracy.");
+		return true;
+	}
+
+	if (argc == 2 && strcasecmp(argv[1], "stop") == 0) {
+		if (!TraceZonesStop()) IConsoleWarning("no trace is being recorded");
+		return true;
+	}
+
+	if (argc == 3 && strcasecmp(argv[1], "start") == 0) {
+		if (!TraceZonesStart(argv[2])) IConsoleError("could not open trace file");
+		return true;
+	}
+
+	return false;
+}
+
 /*******************************
  * console command registration
  *******************************/
@@ -2202,7 +2293,10 @@ void IConsoleStdLibRegister()
 	IConsoleDebugLibRegister();
 #endif
 	IConsoleCmdRegister("fps",     ConFramerate);
+	IConsoleCmdRegister("fps_percentiles", ConFramePercentiles);
 	IConsoleCmdRegister("fps_wnd", ConFramerateWindow);
+	IConsoleCmdRegister("pf_trace", ConPathfinderTrace);
+	IConsoleCmdRegister("trace_zones", ConTraceZones);
 
 	/* NewGRF development stuff */
 	IConsoleCmdRegister("reload_newgrfs",  ConNewGRFReload, ConHookNewGRFDeveloperTool);
@@ -225,6 +225,22 @@ static inline uint8 FindFirstBit2x64(const int value)
 uint8 FindFirstBit(uint32 x);
 uint8 FindLastBit(uint64 x);
 
+/**
+ * Search the first set bit in a 64 bit variable, with the instruction of the processor for it when available.
+ * @param x The value to search
+ * @return The position of the first bit set
+ * @pre x != 0
+ */
+static inline uint8 FindFirstBit64(uint64 x)
+{
+#if defined(__GNUC__)
+	return (uint8)__builtin_ctzll(x);
+#else
+	if ((x & 0xFFFFFFFFULL) != 0) return FindFirstBit((uint32)x);
+	return FindFirstBit((uint32)(x >> 32)) + 32;
+#endif
+}
+
 /**
  * Clear the first bit in an integer.
  *
@@ -0,0 +1,227 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file flatmap_type.hpp Sorted mapping class for small sets of data, stored in place up to a given size. Stored data shall be POD ("Plain Old Data")! */
+
+#ifndef FLATMAP_TYPE_HPP
+#define FLATMAP_TYPE_HPP
+
+#include "smallmap_type.hpp"
+#include <algorithm>
+#include <iterator>
+
+/**
+ * Mapping class keeping its items sorted by key in one array. Up to Tinline
+ * items are stored inside the object itself, so no memory is allocated for
+ * small maps. Lookups are binary searches; iterators are plain pointers and
+ * are invalidated by insertions. Both types have to be POD ("Plain Old Data")!
+ * @tparam Tkey Key type.
+ * @tparam Tvalue Value type.
+ * @tparam Tinline Number of items stored without allocating memory.
+ */
+template <typename Tkey, typename Tvalue, uint Tinline>
+class FlatMap {
+public:
+	typedef SmallPair<Tkey, Tvalue> Pair;
+	typedef Pair value_type;
+	typedef Pair *iterator;
+	typedef const Pair *const_iterator;
+	typedef std::reverse_iterator<iterator> reverse_iterator;
+	typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+private:
+	Pair *items;                ///< Items of the map, either inline_items or allocated.
+	uint count;                 ///< Number of items in the map.
+	uint capacity;              ///< Number of items that fit in #items.
+	Pair inline_items[Tinline]; ///< Storage for small maps.
+
+	/** Comparator for looking up keys. */
+	static bool KeyLess(const Pair &pair, const Tkey &key) { return pair.first < key; }
+
+	/** Comparator for looking up keys. */
+	static bool LessKey(const Tkey &key, const Pair &pair) { return key < pair.first; }
+
+	/**
+	 * Make room for at least the given number of items.
+	 * @param min_capacity Number of items.
+	 */
+	void Reserve(uint min_capacity)
+	{
+		if (min_capacity <= this->capacity) return;
+		uint new_capacity = std::max(min_capacity, this->capacity * 2);
+		Pair *new_items = new Pair[new_capacity];
+		std::copy(this->items, this->items + this->count, new_items);
+		if (this->items != this->inline_items) delete[] this->items;
+		this->items = new_items;
+		this->capacity = new_capacity;
+	}
+
+	/** Free the allocated memory, if any, and go back to the inline storage. */
+	void Reset()
+	{
+		if (this->items != this->inline_items) delete[] this->items;
+		this->items = this->inline_items;
+		this->capacity = Tinline;
+		this->count = 0;
+	}
+
+public:
+	/** Create an empty map. */
+	FlatMap() : items(inline_items), count(0), capacity(Tinline) {}
+
+	/**
+	 * Copy a map.
+	 * @param other Map to copy.
+	 */
+	FlatMap(const FlatMap &other) : FlatMap()
+	{
+		*this = other;
+	}
+
+	/**
+	 * Move a map. Allocated memory is taken over.
+	 * @param other Map to move.
+	 */
+	FlatMap(FlatMap &&other) : FlatMap()
+	{
+		*this = std::move(other);
+	}
+
+	~FlatMap()
+	{
+		if (this->items != this->inline_items) delete[] this->items;
+	}
+
+	/**
+	 * Copy a map.
+	 * @param other Map to copy.
+	 * @return This map.
+	 */
+	FlatMap &operator=(const FlatMap &other)
+	{
+		if (this == &other) return *this;
+		this->count = 0;
+		this->Reserve(other.count);
+		std::copy(other.items, other.items + other.count, this->items);
+		this->count = other.count;
+		return *this;
+	}
+
+	/**
+	 * Move a map. Allocated memory is taken over.
+	 * @param other Map to move.
+	 * @return This map.
+	 */
+	FlatMap &operator=(FlatMap &&other)
+	{
+		if (this == &other) return *this;
+		if (other.items == other.inline_items) {
+			*this = static_cast<const FlatMap &>(other);
+		} else {
+			this->Reset();
+			this->items = other.items;
+			this->capacity = other.capacity;
+			this->count = other.count;
+			other.items = other.inline_items;
+			other.capacity = Tinline;
+		}
+		other.count = 0;
+		return *this;
+	}
+
+	/**
+	 * Exchange the contents of two maps.
+	 * @param other Map to swap with.
+	 */
+	void swap(FlatMap &other)
+	{
+		FlatMap tmp(std::move(other));
+		other = std::move(*this);
+		*this = std::move(tmp);
+	}
+
+	inline iterator begin() { return this->items; }
+	inline iterator end() { return this->items + this->count; }
+	inline const_iterator begin() const { return this->items; }
+	inline const_iterator end() const { return this->items + this->count; }
+	inline reverse_iterator rbegin() { return reverse_iterator(this->end()); }
+	inline reverse_iterator rend() { return reverse_iterator(this->begin()); }
+	inline const_reverse_iterator rbegin() const { return const_reverse_iterator(this->end()); }
+	inline const_reverse_iterator rend() const { return const_reverse_iterator(this->begin()); }
+
+	/**
+	 * Get the number of items in the map.
+	 * @return Number of items.
+	 */
+	inline size_t size() const { return this->count; }
+
+	/**
+	 * Check if the map is empty.
+	 * @return True if there are no items.
+	 */
+	inline bool empty() const { return this->count == 0; }
+
+	/**
+	 * Get the item with the largest key.
+	 * @return Last item.
+	 */
+	inline const Pair &back() const
+	{
+		assert(this->count > 0);
+		return this->items[this->count - 1];
+	}
+
+	/** Remove all items. */
+	inline void clear() { this->count = 0; }
+
+	/**
+	 * Find the first item with a key not less than the given one.
+	 * @param key Key to look for.
+	 * @return Iterator pointing to the item or end().
+	 */
+	inline const_iterator lower_bound(const Tkey &key) const { return std::lower_bound(this->begin(), this->end(), key, &FlatMap::KeyLess); }
+
+	/**
+	 * Find the first item with a key greater than the given one.
+	 * @param key Key to look for.
+	 * @return Iterator pointing to the item or end().
+	 */
+	inline const_iterator upper_bound(const Tkey &key) const { return std::upper_bound(this->begin(), this->end(), key, &FlatMap::LessKey); }
+
+	/**
+	 * Find an item.
+	 * @param key Key to look for.
+	 * @return Iterator pointing to the item or end() if there is none.
+	 */
+	inline const_iterator find(const Tkey &key) const
+	{
+		const_iterator it = this->lower_bound(key);
+		return it != this->end() && !(key < it->first) ? it : this->end();
+	}
+
+	/**
+	 * Get the value for a key, inserting a value-initialised item if it isn't
+	 * in the map yet. Inserting behind the last item is cheapest.
+	 * @param key Key to look for.
+	 * @return Value for the key.
+	 */
+	Tvalue &operator[](const Tkey &key)
+	{
+		uint pos = this->count;
+		if (this->count > 0 && !(this->items[this->count - 1].first < key)) {
+			pos = (uint)(this->lower_bound(key) - this->begin());
+			if (!(key < this->items[pos].first)) return this->items[pos].second;
+		}
+		this->Reserve(this->count + 1);
+		std::copy_backward(this->items + pos, this->items + this->count, this->items + this->count + 1);
+		this->count++;
+		this->items[pos] = Pair(key, Tvalue());
+		return this->items[pos].second;
+	}
+};
+
+#endif /* FLATMAP_TYPE_HPP */
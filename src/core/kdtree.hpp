@@ -13,6 +13,7 @@
 #include "../stdafx.h"
 #include <vector>
 #include <algorithm>
+#include <functional>
 #include <limits>
 
 /**
@@ -29,6 +30,11 @@
  *
  * The element type T must be less-than comparable for FindNearest to work.
  *
+ * The tree keeps itself balanced by rebuilding only the sub-tree below the highest node
+ * whose sides got out of proportion by an insertion or removal, like a scapegoat tree.
+ * (Re)building lays out the nodes of a sub-tree depth-first in consecutive slots of the
+ * node pool, so searches mostly walk through memory in one direction.
+ *
  * @tparam T       Type stored in the tree, should be cheap to copy.
  * @tparam TxyFunc Functor type to extract coordinate from a T value and dimension index (0 or 1).
  * @tparam CoordT  Type of coordinate values extracted via TxyFunc.
@@ -39,46 +45,58 @@ class Kdtree {
 	/** Type of a node in the tree */
 	struct node {
 		T      element;  ///< Element stored at node
-		size_t left;     ///< Index of node to the left, INVALID_NODE if none
-		size_t right;    ///< Index of node to the right, INVALID_NODE if none
+		uint32 left;     ///< Index of node to the left, INVALID_NODE if none
+		uint32 right;    ///< Index of node to the right, INVALID_NODE if none
+		uint32 count;    ///< Number of elements in the sub-tree of this node, including this one
 
-		node(T element) : element(element), left(INVALID_NODE), right(INVALID_NODE) { }
+		node(T element) : element(element), left(INVALID_NODE), right(INVALID_NODE), count(1) { }
 	};
 
-	static const size_t INVALID_NODE = SIZE_MAX; ///< Index value indicating no-such-node
+	static const uint32 INVALID_NODE = UINT32_MAX; ///< Index value indicating no-such-node
+	static const uint32 MIN_REBALANCE_COUNT = 8;   ///< Sub-trees smaller than this are not worth rebalancing
 
 	std::vector<node> nodes;       ///< Pool of all nodes in the tree
-	std::vector<size_t> free_list; ///< List of dead indices in the nodes vector
-	size_t root;                   ///< Index of root node
+	std::vector<uint32> free_list; ///< List of dead indices in the nodes vector
+	uint32 root;                   ///< Index of root node
 	TxyFunc xyfunc;                ///< Functor to extract a coordinate from an element
-	size_t unbalanced;             ///< Number approximating how unbalanced the tree might be
 
 	/** Create one new node in the tree, return its index in the pool */
-	size_t AddNode(const T &element)
+	uint32 AddNode(const T &element)
 	{
 		if (this->free_list.size() == 0) {
 			this->nodes.emplace_back(element);
-			return this->nodes.size() - 1;
+			return (uint32)(this->nodes.size() - 1);
 		} else {
-			size_t newidx = this->free_list.back();
+			uint32 newidx = this->free_list.back();
 			this->free_list.pop_back();
 			this->nodes[newidx] = node{ element };
 			return newidx;
 		}
 	}
 
-	/** Find a coordinate value to split a range of elements at */
-	template <typename It>
-	CoordT SelectSplitCoord(It begin, It end, int level)
+	/** Get the number of elements in a sub-tree */
+	uint32 SubtreeCount(uint32 node_idx) const
+	{
+		return node_idx == INVALID_NODE ? 0 : this->nodes[node_idx].count;
+	}
+
+	/**
+	 * Check whether one side of a sub-tree holds too many of its elements, so it should be rebuilt.
+	 * @param side_count Number of elements on one side of the sub-tree.
+	 * @param count      Number of elements in the whole sub-tree.
+	 */
+	static bool IsUnbalanced(uint32 side_count, uint32 count)
 	{
-		It mid = begin + (end - begin) / 2;
-		std::nth_element(begin, mid, end, [&](T a, T b) { return this->xyfunc(a, level % 2) < this->xyfunc(b, level % 2); });
-		return this->xyfunc(*mid, level % 2);
+		return count >= MIN_REBALANCE_COUNT && side_count * 4 > count * 3;
 	}
 
-	/** Construct a subtree from elements between begin and end iterators, return index of root */
+	/**
+	 * Construct a subtree from elements between begin and end iterators, return index of root.
+	 * The median is selected in place and the range partitioned around it, so all work is
+	 * done on the contiguous range of elements. Nodes are added in depth-first order.
+	 */
 	template <typename It>
-	size_t BuildSubtree(It begin, It end, int level)
+	uint32 BuildSubtree(It begin, It end, int level)
 	{
 		ptrdiff_t count = end - begin;
 
@@ -87,44 +105,66 @@ class Kdtree {
 		} else if (count == 1) {
 			return this->AddNode(*begin);
 		} else if (count > 1) {
-			CoordT split_coord = SelectSplitCoord(begin, end, level);
-			It split = std::partition(begin, end, [&](T v) { return this->xyfunc(v, level % 2) < split_coord; });
-			size_t newidx = this->AddNode(*split);
-			this->nodes[newidx].left = this->BuildSubtree(begin, split, level + 1);
-			this->nodes[newidx].right = this->BuildSubtree(split + 1, end, level + 1);
+			int dim = level % 2;
+			auto less = [&](const T &a, const T &b) { return this->xyfunc(a, dim) < this->xyfunc(b, dim); };
+
+			/* Find the median; everything before it is not greater, everything after it not smaller. */
+			It mid = begin + count / 2;
+			std::nth_element(begin, mid, end, less);
+			CoordT split_coord = this->xyfunc(*mid, dim);
+			/* Elements with the same coordinate as the median belong to the right side, with the median at its front. */
+			It split = std::partition(begin, mid, [&](const T &v) { return this->xyfunc(v, dim) < split_coord; });
+			std::iter_swap(split, mid);
+
+			uint32 newidx = this->AddNode(*split);
+			uint32 left = this->BuildSubtree(begin, split, level + 1);
+			uint32 right = this->BuildSubtree(split + 1, end, level + 1);
+			/* Vector may have been reallocated at this point */
+			node &n = this->nodes[newidx];
+			n.left = left;
+			n.right = right;
+			n.count = (uint32)count;
 			return newidx;
 		} else {
 			NOT_REACHED();
 		}
 	}
 
-	/** Rebuild the tree with all existing elements, optionally adding or removing one more */
-	bool Rebuild(const T *include_element, const T *exclude_element)
+	/**
+	 * Rebuild a sub-tree with all its elements, optionally adding or removing one more.
+	 * The nodes of the sub-tree are reused in order, so it stays laid out depth-first.
+	 * @param node_idx        Root of the sub-tree.
+	 * @param level           Depth of the sub-tree in the tree.
+	 * @param include_element Element to add to the sub-tree, or nullptr.
+	 * @param exclude_element Element to remove from the sub-tree, or nullptr.
+	 * @return New root node index of the sub-tree.
+	 */
+	uint32 RebuildSubtree(uint32 node_idx, int level, const T *include_element, const T *exclude_element)
 	{
-		size_t initial_count = this->Count();
-		if (initial_count < 8) return false; // arbitrary value for "not worth rebalancing"
-
-		T root_element = this->nodes[this->root].element;
-		std::vector<T> elements = this->FreeSubtree(this->root);
+		size_t first_free = this->free_list.size();
+		T root_element = this->nodes[node_idx].element;
+		std::vector<T> elements = this->FreeSubtree(node_idx);
 		elements.push_back(root_element);
+		this->free_list.push_back(node_idx);
+		/* Nodes are taken from the back of the free list; have those of this sub-tree come out in ascending order. */
+		std::sort(this->free_list.begin() + first_free, this->free_list.end(), std::greater<uint32>());
 
-		if (include_element != nullptr) {
-			elements.push_back(*include_element);
-			initial_count++;
-		}
+		if (include_element != nullptr) elements.push_back(*include_element);
 		if (exclude_element != nullptr) {
 			typename std::vector<T>::iterator removed = std::remove(elements.begin(), elements.end(), *exclude_element);
+			assert(removed != elements.end());
 			elements.erase(removed, elements.end());
-			initial_count--;
 		}
 
-		this->Build(elements.begin(), elements.end());
-		assert(initial_count == this->Count());
-		return true;
+		return this->BuildSubtree(elements.begin(), elements.end(), level);
 	}
 
-	/** Insert one element in the tree somewhere below node_idx */
-	void InsertRecursive(const T &element, size_t node_idx, int level)
+	/**
+	 * Insert one element in the tree somewhere below node_idx.
+	 * When the side to insert on would get too big, the sub-tree is rebuilt with the element instead.
+	 * @return New root node index of the sub-tree processed
+	 */
+	uint32 InsertRecursive(const T &element, uint32 node_idx, int level)
 	{
 		/* Dimension index of current level */
 		int dim = level % 2;
@@ -136,24 +176,26 @@ class Kdtree {
 		/* Coordinate of the new element */
 		CoordT ec = this->xyfunc(element, dim);
 		/* Which side to insert on */
-		size_t &next = (ec < nc) ? n.left : n.right;
-
-		if (next == INVALID_NODE) {
-			/* New leaf */
-			size_t newidx = this->AddNode(element);
-			/* Vector may have been reallocated at this point, n and next are invalid */
-			node &nn = this->nodes[node_idx];
-			if (ec < nc) nn.left = newidx; else nn.right = newidx;
-		} else {
-			this->InsertRecursive(element, next, level + 1);
-		}
+		bool left = ec < nc;
+		uint32 next = left ? n.left : n.right;
+
+		/* Rebalance at the highest node possible, so only one sub-tree is rebuilt for this insertion. */
+		if (IsUnbalanced(this->SubtreeCount(next) + 1, n.count + 1)) return this->RebuildSubtree(node_idx, level, &element, nullptr);
+		n.count++;
+
+		/* New leaf, or descend */
+		uint32 new_branch = (next == INVALID_NODE) ? this->AddNode(element) : this->InsertRecursive(element, next, level + 1);
+		/* Vector may have been reallocated at this point, n is invalid */
+		node &nn = this->nodes[node_idx];
+		if (left) nn.left = new_branch; else nn.right = new_branch;
+		return node_idx;
 	}
 
 	/**
 	 * Free all children of the given node
 	 * @return Collection of elements that were removed from tree.
 	 */
-	std::vector<T> FreeSubtree(size_t node_idx)
+	std::vector<T> FreeSubtree(uint32 node_idx)
 	{
 		std::vector<T> subtree_elements;
 		node &n = this->nodes[node_idx];
@@ -184,21 +226,20 @@ class Kdtree {
 	 * @param level     Current depth in the tree
 	 * @return New root node index of the sub-tree processed
 	 */
-	size_t RemoveRecursive(const T &element, size_t node_idx, int level)
+	uint32 RemoveRecursive(const T &element, uint32 node_idx, int level)
 	{
 		/* Node reference */
 		node &n = this->nodes[node_idx];
 
 		if (n.element == element) {
 			/* Remove this one */
-			this->free_list.push_back(node_idx);
 			if (n.left == INVALID_NODE && n.right == INVALID_NODE) {
 				/* Simple case, leaf, new child node for parent is "none" */
+				this->free_list.push_back(node_idx);
 				return INVALID_NODE;
 			} else {
 				/* Complex case, rebuild the sub-tree */
-				std::vector<T> subtree_elements = this->FreeSubtree(node_idx);
-				return this->BuildSubtree(subtree_elements.begin(), subtree_elements.end(), level);;
+				return this->RebuildSubtree(node_idx, level, nullptr, &element);
 			}
 		} else {
 			/* Search in a sub-tree */
@@ -209,14 +250,20 @@ class Kdtree {
 			/* Coordinate of the element being removed */
 			CoordT ec = this->xyfunc(element, dim);
 			/* Which side to remove from */
-			size_t next = (ec < nc) ? n.left : n.right;
+			bool left = ec < nc;
+			uint32 next = left ? n.left : n.right;
 			assert(next != INVALID_NODE); // node must exist somewhere and must be found before a leaf is reached
+
+			/* Rebalance at the highest node possible, when the other side would get too big. */
+			if (IsUnbalanced(this->SubtreeCount(left ? n.right : n.left), n.count - 1)) return this->RebuildSubtree(node_idx, level, nullptr, &element);
+			n.count--;
+
 			/* Descend */
-			size_t new_branch = this->RemoveRecursive(element, next, level + 1);
+			uint32 new_branch = this->RemoveRecursive(element, next, level + 1);
 			if (new_branch != next) {
 				/* Vector may have been reallocated at this point, n and next are invalid */
 				node &nn = this->nodes[node_idx];
-				if (ec < nc) nn.left = new_branch; else nn.right = new_branch;
+				if (left) nn.left = new_branch; else nn.right = new_branch;
 			}
 			return node_idx;
 		}
@@ -240,7 +287,7 @@ class Kdtree {
 		NOT_REACHED(); // a.first == b.first: same element must not be inserted twice
 	}
 	/** Search a sub-tree for the element nearest to a given point */
-	node_distance FindNearestRecursive(CoordT xy[2], size_t node_idx, int level, DistT limit = std::numeric_limits<DistT>::max()) const
+	node_distance FindNearestRecursive(CoordT xy[2], uint32 node_idx, int level, DistT limit = std::numeric_limits<DistT>::max()) const
 	{
 		/* Dimension index of current level */
 		int dim = level % 2;
@@ -255,7 +302,7 @@ class Kdtree {
 		node_distance best = std::make_pair(n.element, thisdist);
 
 		/* Next node to visit */
-		size_t next = (xy[dim] < c) ? n.left : n.right;
+		uint32 next = (xy[dim] < c) ? n.left : n.right;
 		if (next != INVALID_NODE) {
 			/* Check if there is a better node down the tree */
 			best = SelectNearestNodeDistance(best, this->FindNearestRecursive(xy, next, level + 1));
@@ -265,7 +312,7 @@ class Kdtree {
 
 		/* Check if the distance from current best is worse than distance from target to splitting line,
 		 * if it is we also need to check the other side of the split. */
-		size_t opposite = (xy[dim] >= c) ? n.left : n.right; // reverse of above
+		uint32 opposite = (xy[dim] >= c) ? n.left : n.right; // reverse of above
 		if (opposite != INVALID_NODE && limit >= abs((int)xy[dim] - (int)c)) {
 			node_distance other_candidate = this->FindNearestRecursive(xy, opposite, level + 1, limit);
 			best = SelectNearestNodeDistance(best, other_candidate);
@@ -275,7 +322,7 @@ class Kdtree {
 	}
 
 	template <typename Outputter>
-	void FindContainedRecursive(CoordT p1[2], CoordT p2[2], size_t node_idx, int level, Outputter outputter) const
+	void FindContainedRecursive(CoordT p1[2], CoordT p2[2], uint32 node_idx, int level, Outputter outputter) const
 	{
 		/* Dimension index of current level */
 		int dim = level % 2;
@@ -298,28 +345,15 @@ class Kdtree {
 	}
 
 	/** Debugging function, counts number of occurrences of an element regardless of its correct position in the tree */
-	size_t CountValue(const T &element, size_t node_idx) const
+	size_t CountValue(const T &element, uint32 node_idx) const
 	{
 		if (node_idx == INVALID_NODE) return 0;
 		const node &n = this->nodes[node_idx];
 		return CountValue(element, n.left) + CountValue(element, n.right) + ((n.element == element) ? 1 : 0);
 	}
 
-	void IncrementUnbalanced(size_t amount = 1)
-	{
-		this->unbalanced += amount;
-	}
-
-	/** Check if the entire tree is in need of rebuilding */
-	bool IsUnbalanced()
-	{
-		size_t count = this->Count();
-		if (count < 8) return false;
-		return this->unbalanced > this->Count() / 4;
-	}
-
 	/** Verify that the invariant is true for a sub-tree, assert if not */
-	void CheckInvariant(size_t node_idx, int level, CoordT min_x, CoordT max_x, CoordT min_y, CoordT max_y)
+	void CheckInvariant(uint32 node_idx, int level, CoordT min_x, CoordT max_x, CoordT min_y, CoordT max_y)
 	{
 		if (node_idx == INVALID_NODE) return;
 
@@ -331,6 +365,7 @@ class Kdtree {
 		assert(cx < max_x);
 		assert(cy >= min_y);
 		assert(cy < max_y);
+		assert(n.count == this->SubtreeCount(n.left) + this->SubtreeCount(n.right) + 1);
 
 		if (level % 2 == 0) {
 			// split in dimension 0 = x
@@ -353,7 +388,7 @@ class Kdtree {
 
 public:
 	/** Construct a new Kdtree with the given xyfunc */
-	Kdtree(TxyFunc xyfunc) : root(INVALID_NODE), xyfunc(xyfunc), unbalanced(0) { }
+	Kdtree(TxyFunc xyfunc) : root(INVALID_NODE), xyfunc(xyfunc) { }
 
 	/**
 	 * Clear and rebuild the tree from a new sequence of elements,
@@ -364,9 +399,7 @@ public:
 	template <typename It>
 	void Build(It begin, It end)
 	{
-		this->nodes.clear();
-		this->free_list.clear();
-		this->unbalanced = 0;
+		this->Clear();
 		if (begin == end) return;
 		this->nodes.reserve(end - begin);
 
@@ -381,21 +414,27 @@ public:
 	{
 		this->nodes.clear();
 		this->free_list.clear();
-		this->unbalanced = 0;
+		this->root = INVALID_NODE;
 		return;
 	}
 
 	/**
-	 * Reconstruct the tree with the same elements, letting it be fully balanced.
+	 * Reconstruct the tree with the same elements, letting it be fully balanced
+	 * and laid out in memory without gaps.
 	 */
 	void Rebuild()
 	{
-		this->Rebuild(nullptr, nullptr);
+		if (this->Count() == 0) return;
+
+		std::vector<T> elements = this->FreeSubtree(this->root);
+		elements.push_back(this->nodes[this->root].element);
+		this->Build(elements.begin(), elements.end());
 	}
 
 	/**
 	 * Insert a single element in the tree.
-	 * Repeatedly inserting single elements may cause the tree to become unbalanced.
+	 * When this makes a sub-tree unbalanced, only that sub-tree is rebuilt; so the amortised
+	 * run time is logarithmic in the number of elements.
 	 * Undefined behaviour if the element already exists in the tree.
 	 */
 	void Insert(const T &element)
@@ -403,10 +442,8 @@ public:
 		if (this->Count() == 0) {
 			this->root = this->AddNode(element);
 		} else {
-			if (!this->IsUnbalanced() || !this->Rebuild(&element, nullptr)) {
-				this->InsertRecursive(element, this->root, 0);
-				this->IncrementUnbalanced();
-			}
+			/* If the root is rebuilt, this modifies this->root */
+			this->root = this->InsertRecursive(element, this->root, 0);
 			CheckInvariant();
 		}
 	}
@@ -414,18 +451,15 @@ public:
 	/**
 	 * Remove a single element from the tree, if it exists.
 	 * Since elements are stored in interior nodes as well as leaf nodes, removing one may
-	 * require a larger sub-tree to be re-built. Because of this, worst case run time is
-	 * as bad as a full tree rebuild.
+	 * require the sub-tree below it to be re-built. When it makes a sub-tree unbalanced,
+	 * only that sub-tree is rebuilt.
 	 */
 	void Remove(const T &element)
 	{
 		size_t count = this->Count();
 		if (count == 0) return;
-		if (!this->IsUnbalanced() || !this->Rebuild(nullptr, &element)) {
-			/* If the removed element is the root node, this modifies this->root */
-			this->root = this->RemoveRecursive(element, this->root, 0);
-			this->IncrementUnbalanced();
-		}
+		/* If the removed element is the root node, this modifies this->root */
+		this->root = this->RemoveRecursive(element, this->root, 0);
 		CheckInvariant();
 	}
 
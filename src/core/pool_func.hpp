@@ -11,6 +11,7 @@
 #define POOL_FUNC_HPP
 
 #include "alloc_func.hpp"
+#include "bitmath_func.hpp"
 #include "mem_func.hpp"
 #include "pool_type.hpp"
 
@@ -38,9 +39,15 @@ DEFINE_POOL_METHOD(inline)::Pool(const char *name) :
 #endif /* OTTD_ASSERT */
 		cleaning(false),
 		data(nullptr),
+		used_bits(nullptr),
+		full_bits(nullptr),
+		slabs(nullptr),
 		alloc_cache(nullptr)
 { }
 
+/** Number of bits in each element of the bitmaps of a pool. */
+static const size_t POOL_BITMAP_BITS = 64;
+
 /**
  * Resizes the pool so 'index' can be addressed
  * @param index index we will allocate later
@@ -57,20 +64,65 @@ DEFINE_POOL_METHOD(inline void)::ResizeFor(size_t index)
 	this->data = ReallocT(this->data, new_size);
 	MemSetT(this->data + this->size, 0, new_size - this->size);
 
+	size_t words = CeilDiv(this->size, POOL_BITMAP_BITS);
+	size_t new_words = CeilDiv(new_size, POOL_BITMAP_BITS);
+	this->used_bits = ReallocT(this->used_bits, new_words);
+	MemSetT(this->used_bits + words, 0, new_words - words);
+
+	size_t full_words = CeilDiv(words, POOL_BITMAP_BITS);
+	size_t new_full_words = CeilDiv(new_words, POOL_BITMAP_BITS);
+	this->full_bits = ReallocT(this->full_bits, new_full_words);
+	MemSetT(this->full_bits + full_words, 0, new_full_words - full_words);
+
+	if (Tgrowth_step > 1) {
+		size_t slabs = CeilDiv(this->size, Tgrowth_step);
+		size_t new_slabs = CeilDiv(new_size, Tgrowth_step);
+		this->slabs = ReallocT(this->slabs, new_slabs);
+		MemSetT(this->slabs + slabs, 0, new_slabs - slabs);
+	}
+
 	this->size = new_size;
 }
 
+/**
+ * Find the lowest free index from a given index on, using the bitmaps of used items.
+ * Whole runs of 64 or 4096 used items are skipped at once.
+ * @param start The index to start searching at.
+ * @return The lowest free index not below \a start, or this->size when there is none.
+ */
+DEFINE_POOL_METHOD(inline size_t)::FindFreeIndex(size_t start) const
+{
+	size_t words = CeilDiv(this->size, POOL_BITMAP_BITS);
+	size_t word = start / POOL_BITMAP_BITS;
+	if (word >= words) return this->size;
+
+	/* Items beyond the size of the pool are never used, so those have no index either. */
+	uint64 free = ~this->used_bits[word] & (UINT64_MAX << (start % POOL_BITMAP_BITS));
+	if (free != 0) return min(this->size, word * POOL_BITMAP_BITS + FindFirstBit64(free));
+
+	/* Find the next element of the bitmap that has a free item. */
+	word++;
+	size_t full_words = CeilDiv(words, POOL_BITMAP_BITS);
+	for (size_t full_word = word / POOL_BITMAP_BITS; full_word < full_words; full_word++) {
+		uint64 not_full = ~this->full_bits[full_word];
+		if (full_word == word / POOL_BITMAP_BITS) not_full &= UINT64_MAX << (word % POOL_BITMAP_BITS);
+		if (not_full == 0) continue;
+
+		word = full_word * POOL_BITMAP_BITS + FindFirstBit64(not_full);
+		if (word >= words) break;
+		return min(this->size, word * POOL_BITMAP_BITS + FindFirstBit64(~this->used_bits[word]));
+	}
+
+	return this->size;
+}
+
 /**
  * Searches for first free index
  * @return first free index, NO_FREE_ITEM on failure
  */
 DEFINE_POOL_METHOD(inline size_t)::FindFirstFree()
 {
-	size_t index = this->first_free;
-
-	for (; index < this->first_unused; index++) {
-		if (this->data[index] == nullptr) return index;
-	}
+	size_t index = this->FindFreeIndex(this->first_free);
 
 	if (index < this->size) {
 		return index;
@@ -89,8 +141,34 @@ DEFINE_POOL_METHOD(inline size_t)::FindFirstFree()
 	return NO_FREE_ITEM;
 }
 
+/**
+ * Get the size of the slots of the slabs, aligned like the memory of malloc.
+ * @return The size of a slot.
+ */
+DEFINE_POOL_METHOD(inline size_t)::GetSlotSize() const
+{
+	return Align(Titem::GetPoolSlotSize(), 16);
+}
+
+/**
+ * Get the slot of the slabs for an index.
+ * @param index The index of the item.
+ * @return The memory for the item, or nullptr when its slab has not been allocated.
+ * @pre index < this->size
+ */
+DEFINE_POOL_METHOD(inline void *)::GetSlot(size_t index) const
+{
+	if (Tgrowth_step == 1) return nullptr;
+
+	byte *slab = this->slabs[index / Tgrowth_step];
+	return slab == nullptr ? nullptr : slab + (index % Tgrowth_step) * this->GetSlotSize();
+}
+
 /**
  * Makes given index valid
+ * Items are allocated in slabs of Tgrowth_step slots, with the items in the order of their
+ * index, so iterating the pool walks through memory; only items that do not fit a slot and
+ * the items of pools that grow one item at a time are allocated separately.
  * @param size size of item
  * @param index index of item
  * @pre index < this->size
@@ -104,7 +182,12 @@ DEFINE_POOL_METHOD(inline void *)::AllocateItem(size_t size, size_t index)
 	this->items++;
 
 	Titem *item;
-	if (Tcache && this->alloc_cache != nullptr) {
+	if (Tgrowth_step > 1 && size <= this->GetSlotSize()) {
+		byte *&slab = this->slabs[index / Tgrowth_step];
+		if (slab == nullptr) slab = MallocT<byte>(Tgrowth_step * this->GetSlotSize());
+		item = (Titem *)this->GetSlot(index);
+		if (Tzero) memset((void *)item, 0, size);
+	} else if (Tcache && this->alloc_cache != nullptr) {
 		assert(sizeof(Titem) == size);
 		item = (Titem *)this->alloc_cache;
 		this->alloc_cache = this->alloc_cache->next;
@@ -120,6 +203,10 @@ DEFINE_POOL_METHOD(inline void *)::AllocateItem(size_t size, size_t index)
 	}
 	this->data[index] = item;
 	item->index = (Tindex)(uint)index;
+
+	uint64 &used = this->used_bits[index / POOL_BITMAP_BITS];
+	SetBit(used, index % POOL_BITMAP_BITS);
+	if (used == UINT64_MAX) SetBit(this->full_bits[index / POOL_BITMAP_BITS / POOL_BITMAP_BITS], index / POOL_BITMAP_BITS % POOL_BITMAP_BITS);
 	return item;
 }
 
@@ -179,7 +266,9 @@ DEFINE_POOL_METHOD(void)::FreeItem(size_t index)
 {
 	assert(index < this->size);
 	assert(this->data[index] != nullptr);
-	if (Tcache) {
+	if (this->data[index] == this->GetSlot(index)) {
+		/* The slot stays allocated with its slab. */
+	} else if (Tcache) {
 		AllocCache *ac = (AllocCache *)this->data[index];
 		ac->next = this->alloc_cache;
 		this->alloc_cache = ac;
@@ -187,6 +276,8 @@ DEFINE_POOL_METHOD(void)::FreeItem(size_t index)
 		free(this->data[index]);
 	}
 	this->data[index] = nullptr;
+	ClrBit(this->used_bits[index / POOL_BITMAP_BITS], index % POOL_BITMAP_BITS);
+	ClrBit(this->full_bits[index / POOL_BITMAP_BITS / POOL_BITMAP_BITS], index / POOL_BITMAP_BITS % POOL_BITMAP_BITS);
 	this->first_free = min(this->first_free, index);
 	this->items--;
 	if (!this->cleaning) Titem::PostDestructor(index);
@@ -200,9 +291,18 @@ DEFINE_POOL_METHOD(void)::CleanPool()
 		delete this->Get(i); // 'delete nullptr;' is very valid
 	}
 	assert(this->items == 0);
+	if (Tgrowth_step > 1) {
+		for (size_t i = 0; i < CeilDiv(this->size, Tgrowth_step); i++) free(this->slabs[i]);
+	}
 	free(this->data);
+	free(this->used_bits);
+	free(this->full_bits);
+	free(this->slabs);
 	this->first_unused = this->first_free = this->size = 0;
 	this->data = nullptr;
+	this->used_bits = nullptr;
+	this->full_bits = nullptr;
+	this->slabs = nullptr;
 	this->cleaning = false;
 
 	if (Tcache) {
@@ -96,6 +96,9 @@ struct Pool : PoolBase {
 	bool cleaning;       ///< True if cleaning pool (deleting all items)
 
 	Titem **data;        ///< Pointer to array of pointers to Titem
+	uint64 *used_bits;   ///< Bit per index, set when the item is in use
+	uint64 *full_bits;   ///< Bit per element of #used_bits, set when all of its items are in use
+	byte **slabs;        ///< Memory for the items, per Tgrowth_step of them; nullptr for the parts not used yet
 
 	Pool(const char *name);
 	virtual void CleanPool();
@@ -370,6 +373,15 @@ struct Pool : PoolBase {
 		 */
 		static inline void PostDestructor(size_t index) { }
 
+		/**
+		 * Get the size of the slots in the memory the items are allocated in.
+		 * If the pool contains items of derived classes, override it in PoolItem's
+		 * subclass with the size of the biggest of them.
+		 * @return The size of a slot.
+		 * @note items bigger than this are allocated one by one.
+		 */
+		static inline size_t GetPoolSlotSize() { return sizeof(Titem); }
+
 		/**
 		 * Returns an iterable ensemble of all valid Titem
 		 * @param from index of the first Titem to consider
@@ -394,7 +406,10 @@ private:
 	AllocCache *alloc_cache;
 
 	void *AllocateItem(size_t size, size_t index);
+	size_t GetSlotSize() const;
+	void *GetSlot(size_t index) const;
 	void ResizeFor(size_t index);
+	size_t FindFreeIndex(size_t start) const;
 	size_t FindFirstFree();
 
 	void *GetNew(size_t size);
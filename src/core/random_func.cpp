@@ -58,6 +58,63 @@ void Randomizer::SetSeed(uint32 seed)
 	this->state[1] = seed;
 }
 
+static uint64 _random_stream_seed; ///< Seed of all #DerivedRandomizer streams of the current tick.
+
+/**
+ * Mix the bits of a value so that nearby inputs give unrelated outputs.
+ * @param x the value to mix
+ * @return the mixed value
+ */
+static inline uint64 MixRandomBits(uint64 x)
+{
+	x ^= x >> 30;
+	x *= 0xBF58476D1CE4E5B9ULL;
+	x ^= x >> 27;
+	x *= 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+/**
+ * Derive the seed of the random streams of this tick from the game state random.
+ * Must be called at the start of each tick, before any stream is created. It does
+ * not draw from #_random, so the sequence of #Random() is not affected.
+ * @param tick the tick counter, so the streams differ even if #_random did not advance
+ */
+void UpdateRandomStreamSeed(uint32 tick)
+{
+	_random_stream_seed = MixRandomBits(((uint64)_random.state[0] << 32 | _random.state[1]) ^ tick);
+}
+
+/**
+ * Create the random stream for an entity of a subsystem in the current tick.
+ * @param type the subsystem drawing the numbers
+ * @param index the index of the entity, e.g. a tile, town or industry
+ */
+DerivedRandomizer::DerivedRandomizer(RandomStreamType type, uint32 index) : counter(0)
+{
+	this->key = MixRandomBits(_random_stream_seed ^ ((uint64)type << 32 | index));
+}
+
+/**
+ * Generate the next pseudo random number of this stream.
+ * @return the random number
+ */
+uint32 DerivedRandomizer::Next()
+{
+	return (uint32)(MixRandomBits(this->key + 0x9E3779B97F4A7C15ULL * ++this->counter) >> 32);
+}
+
+/**
+ * Generate the next pseudo random number of this stream scaled to \a limit,
+ * excluding \a limit itself.
+ * @param limit Limit of the range to be generated from.
+ * @return Random number in [0,\a limit)
+ */
+uint32 DerivedRandomizer::Next(uint32 limit)
+{
+	return ((uint64)this->Next() * (uint64)limit) >> 32;
+}
+
 /**
  * (Re)set the state of the random number generators.
  * @param seed the new state
@@ -55,6 +55,31 @@ static inline void RestoreRandomSeeds(const SavedRandomSeeds &storage)
 	_interactive_random = storage.interactive_random;
 }
 
+/** Subsystems that can draw from their own #DerivedRandomizer streams; keeps the streams of different subsystems apart. */
+enum RandomStreamType {
+	RST_TILE_LOOP, ///< Tile loop, keyed on the tile index.
+	RST_TOWN,      ///< Town growth, keyed on the town index.
+	RST_INDUSTRY,  ///< Industry production, keyed on the industry index.
+};
+
+/**
+ * Pseudo random number stream for one entity of one subsystem during a single tick.
+ * The numbers only depend on the state of #_random at the start of the tick and
+ * on the stream's key, not on the order in which streams are used. So unlike
+ * #Random() they can be drawn from different threads while all clients still
+ * end up with the same game state.
+ */
+struct DerivedRandomizer {
+	uint64 key;     ///< Hash of the tick seed, the stream type and the entity index.
+	uint32 counter; ///< Number of values drawn from this stream so far.
+
+	DerivedRandomizer(RandomStreamType type, uint32 index);
+
+	uint32 Next();
+	uint32 Next(uint32 limit);
+};
+
+void UpdateRandomStreamSeed(uint32 tick);
 void SetRandomSeed(uint32 seed);
 #ifdef RANDOM_DEBUG
 	#ifdef __APPLE__
@@ -0,0 +1,374 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file corebench.cpp Tool to measure the speed of the core containers and pools. */
+
+#include "../stdafx.h"
+#include "../core/pool_func.hpp"
+#include "../core/kdtree.hpp"
+#include "../core/smallmap_type.hpp"
+#include "../core/multimap.hpp"
+#include "../core/smallvec_type.hpp"
+#include "../misc/binaryheap.hpp"
+#include "../misc/hashtable.hpp"
+#include "../misc/array.hpp"
+#include "../newgrf_storage.h"
+
+#include <stdarg.h>
+#include <chrono>
+#include <random>
+
+#include "../safeguards.h"
+
+/**
+ * Report a fatal error.
+ * @param s Format string.
+ * @note Function does not return.
+ */
+void NORETURN CDECL error(const char *s, ...)
+{
+	va_list va;
+	va_start(va, s);
+	fprintf(stderr, "FATAL: ");
+	vfprintf(stderr, s, va);
+	fprintf(stderr, "\n");
+	va_end(va);
+	exit(1);
+}
+
+/**
+ * Report a corrupt savegame; pools only do this when loading items at a given index, which never happens here.
+ * @param format Format string.
+ * @note Function does not return.
+ */
+void NORETURN SlErrorCorruptFmt(const char *format, ...)
+{
+	error("Unexpected savegame corruption error: %s", format);
+}
+
+/** Sum of all values looked up, printed at the end so the lookups cannot be optimised away. */
+static uint64 _checksum = 0;
+
+/**
+ * Time one operation of a benchmark and print the time it took.
+ * @param container The container that is measured.
+ * @param operation What is done to the container.
+ * @param count The number of items the operation handles.
+ * @param func The operation.
+ */
+template <typename F>
+static void Measure(const char *container, const char *operation, uint count, F func)
+{
+	auto start = std::chrono::steady_clock::now();
+	func();
+	auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	printf("%-14s %-10s %9u items %11.3f ms %9.1f ns/item\n", container, operation, count, time / 1000000.0, count == 0 ? 0.0 : (double)time / count);
+}
+
+/** Item of the benchmarked pool, sized like a small game object. */
+struct BenchPoolItem;
+typedef Pool<BenchPoolItem, uint32, 64, 1048576> BenchPoolItemPool;
+static BenchPoolItemPool _bench_pool_item_pool("BenchPoolItem");
+
+struct BenchPoolItem : BenchPoolItemPool::PoolItem<&_bench_pool_item_pool> {
+	uint32 value; ///< Value summed when iterating.
+	byte payload[60]; ///< Filler for a realistic item size.
+
+	BenchPoolItem(uint32 value) : value(value) { }
+};
+
+INSTANTIATE_POOL_METHODS(BenchPoolItem)
+
+/**
+ * Measure allocating, looking up, iterating and freeing pool items.
+ * @param count The number of items in the pool.
+ */
+static void BenchPool(uint count)
+{
+	std::mt19937 random(count);
+	std::vector<uint32> ids;
+
+	Measure("Pool", "insert", count, [&]() {
+		for (uint i = 0; i < count; i++) {
+			if (!BenchPoolItem::CanAllocateItem()) error("Pool is full");
+			ids.push_back((new BenchPoolItem(i))->index);
+		}
+	});
+	Measure("Pool", "lookup", count, [&]() {
+		for (uint i = 0; i < count; i++) _checksum += BenchPoolItem::Get(ids[random() % count])->value;
+	});
+	Measure("Pool", "iterate", count, [&]() {
+		for (const BenchPoolItem *item : BenchPoolItem::Iterate()) _checksum += item->value;
+	});
+	std::shuffle(ids.begin(), ids.end(), random);
+	Measure("Pool", "delete", count, [&]() {
+		for (uint32 id : ids) delete BenchPoolItem::Get(id);
+	});
+	_bench_pool_item_pool.CleanPool();
+}
+
+/** Coordinates of the points in the benchmarked k-d tree. */
+static std::vector<std::pair<uint16, uint16>> _kdtree_points;
+
+/** Get a coordinate of a point in the benchmarked k-d tree. */
+static uint16 Kdtree_BenchXYFunc(uint32 index, int dim)
+{
+	return dim == 0 ? _kdtree_points[index].first : _kdtree_points[index].second;
+}
+
+/**
+ * Measure building, searching and emptying a k-d tree of points on a 4096x4096 map.
+ * @param count The number of points in the tree.
+ */
+static void BenchKdtree(uint count)
+{
+	std::mt19937 random(count);
+	_kdtree_points.clear();
+	for (uint i = 0; i < count; i++) _kdtree_points.emplace_back(random() % 4096, random() % 4096);
+
+	Kdtree<uint32, decltype(&Kdtree_BenchXYFunc), uint16, int> tree(&Kdtree_BenchXYFunc);
+	Measure("Kdtree", "insert", count, [&]() {
+		for (uint i = 0; i < count; i++) tree.Insert(i);
+	});
+	Measure("Kdtree", "nearest", count, [&]() {
+		for (uint i = 0; i < count; i++) _checksum += tree.FindNearest(random() % 4096, random() % 4096);
+	});
+	Measure("Kdtree", "contained", count, [&]() {
+		for (uint i = 0; i < count; i++) {
+			uint16 x = random() % 4000;
+			uint16 y = random() % 4000;
+			tree.FindContained(x, y, x + 96, y + 96, [](uint32 index) { _checksum += index; });
+		}
+	});
+	Measure("Kdtree", "delete", count, [&]() {
+		for (uint i = 0; i < count; i++) tree.Remove(i);
+	});
+}
+
+/**
+ * Measure filling, searching, iterating and emptying many small maps, like the ones of cargo and station lists.
+ * @param count The total number of items in all maps.
+ * @param size The number of items in each map.
+ */
+static void BenchSmallMap(uint count, uint size)
+{
+	std::mt19937 random(count);
+	std::vector<SmallMap<uint32, uint32>> maps(count / size);
+	std::vector<uint32> keys;
+	for (uint i = 0; i < size; i++) keys.push_back(random());
+
+	Measure("SmallMap", "insert", count, [&]() {
+		for (auto &map : maps) {
+			for (uint32 key : keys) map.Insert(key, key);
+		}
+	});
+	Measure("SmallMap", "lookup", count, [&]() {
+		for (auto &map : maps) {
+			for (uint i = 0; i < size; i++) _checksum += map[keys[random() % size]];
+		}
+	});
+	Measure("SmallMap", "iterate", count, [&]() {
+		for (const auto &map : maps) {
+			for (const auto &pair : map) _checksum += pair.second;
+		}
+	});
+	Measure("SmallMap", "delete", count, [&]() {
+		for (auto &map : maps) {
+			for (uint32 key : keys) map.Erase(key);
+		}
+	});
+}
+
+/**
+ * Measure filling, searching, iterating and emptying a multimap, like the one of the cargo packets of a vehicle list.
+ * @param count The number of items in the map.
+ */
+static void BenchMultiMap(uint count)
+{
+	std::mt19937 random(count);
+	MultiMap<uint32, uint32> map;
+	uint keys = max(count / 16, 1U);
+
+	Measure("MultiMap", "insert", count, [&]() {
+		for (uint i = 0; i < count; i++) map.Insert(random() % keys, i);
+	});
+	Measure("MultiMap", "lookup", count, [&]() {
+		for (uint i = 0; i < count; i++) {
+			auto range = map.equal_range(random() % keys);
+			if (range.first != range.second) _checksum += *range.first;
+		}
+	});
+	Measure("MultiMap", "iterate", count, [&]() {
+		for (MultiMap<uint32, uint32>::iterator it(map.begin()); it != map.end(); ++it) _checksum += *it;
+	});
+	Measure("MultiMap", "delete", count, [&]() {
+		for (MultiMap<uint32, uint32>::iterator it(map.begin()); it != map.end();) it = map.erase(it);
+	});
+}
+
+/**
+ * Measure the unique inserting and searching of the vector helpers, like for the lists of stations near a tile.
+ * @param count The total number of items in all vectors.
+ * @param size The number of items in each vector.
+ */
+static void BenchSmallVector(uint count, uint size)
+{
+	std::mt19937 random(count);
+	std::vector<std::vector<uint32>> vectors(count / size);
+	std::vector<uint32> values;
+	for (uint i = 0; i < size; i++) values.push_back(random());
+
+	Measure("vector", "include", count, [&]() {
+		for (auto &vec : vectors) {
+			for (uint32 value : values) include(vec, value);
+		}
+	});
+	Measure("vector", "find_index", count, [&]() {
+		for (const auto &vec : vectors) {
+			for (uint i = 0; i < size; i++) _checksum += find_index(vec, values[random() % size]);
+		}
+	});
+}
+
+/** Item of the benchmarked binary heap and hash table, like the nodes of the pathfinders. */
+struct BenchNode {
+	/** Key of the node in the hash table. */
+	struct Key {
+		uint32 tile; ///< Key value.
+
+		inline int CalcHash() const { return this->tile; }
+		inline bool operator==(const Key &other) const { return this->tile == other.tile; }
+	};
+
+	Key key;             ///< Key of the node.
+	int cost;            ///< Cost ordering the nodes in the heap.
+	BenchNode *hash_next; ///< Next node in the same hash table slot.
+
+	inline const Key &GetKey() const { return this->key; }
+	inline BenchNode *GetHashNext() { return this->hash_next; }
+	inline void SetHashNext(BenchNode *next) { this->hash_next = next; }
+	inline bool operator<(const BenchNode &other) const { return this->cost < other.cost; }
+};
+
+/**
+ * Measure the open list of the pathfinders: including nodes in and shifting them from a binary heap.
+ * @param count The number of items in the heap.
+ */
+static void BenchBinaryHeap(uint count)
+{
+	std::mt19937 random(count);
+	std::vector<BenchNode> nodes(count);
+	for (BenchNode &node : nodes) node.cost = random() % 100000;
+
+	CBinaryHeapT<BenchNode> heap(1024);
+	Measure("BinaryHeap", "insert", count, [&]() {
+		for (BenchNode &node : nodes) heap.Include(&node);
+	});
+	Measure("BinaryHeap", "shift", count, [&]() {
+		while (!heap.IsEmpty()) _checksum += heap.Shift()->cost;
+	});
+}
+
+/**
+ * Measure the closed list of the pathfinders: pushing, finding and popping nodes in a hash table.
+ * @param count The number of items in the hash table.
+ */
+static void BenchHashTable(uint count)
+{
+	std::mt19937 random(count);
+	std::vector<BenchNode> nodes(count);
+	for (uint i = 0; i < count; i++) nodes[i].key.tile = i * 7;
+
+	std::unique_ptr<CHashTableT<BenchNode, 12>> table(new CHashTableT<BenchNode, 12>());
+	Measure("HashTable", "insert", count, [&]() {
+		for (BenchNode &node : nodes) table->Push(node);
+	});
+	Measure("HashTable", "lookup", count, [&]() {
+		for (uint i = 0; i < count; i++) {
+			BenchNode::Key key{(uint32)(random() % count) * 7};
+			_checksum += table->Find(key)->key.tile;
+		}
+	});
+	Measure("HashTable", "delete", count, [&]() {
+		for (BenchNode &node : nodes) table->Pop(node);
+	});
+}
+
+/**
+ * Measure the node storage of the pathfinders: appending to, indexing and clearing a small array.
+ * @param count The number of items in the array.
+ */
+static void BenchSmallArray(uint count)
+{
+	std::mt19937 random(count);
+	SmallArray<BenchNode, 65536, 256> array;
+	const SmallArray<BenchNode, 65536, 256> &const_array = array;
+
+	Measure("SmallArray", "insert", count, [&]() {
+		for (uint i = 0; i < count; i++) array.AppendC()->cost = i;
+	});
+	Measure("SmallArray", "lookup", count, [&]() {
+		for (uint i = 0; i < count; i++) _checksum += const_array[random() % count].cost;
+	});
+	Measure("SmallArray", "iterate", count, [&]() {
+		for (uint i = 0; i < count; i++) _checksum += const_array[i].cost;
+	});
+	Measure("SmallArray", "delete", count, [&]() {
+		array.Clear();
+	});
+}
+
+/**
+ * Measure the temporary registers of the NewGRF resolver: every resolve clears them, and only some of them use registers.
+ * @param count The number of resolves.
+ */
+static void BenchTemporaryStorage(uint count)
+{
+	std::mt19937 random(count);
+	std::vector<uint16> registers;
+	for (uint i = 0; i < count * 4; i++) registers.push_back(random() % 0x110);
+
+	std::unique_ptr<TemporaryStorageArray<int32, 0x110>> storage(new TemporaryStorageArray<int32, 0x110>());
+	Measure("TempStorage", "sparse", count, [&]() {
+		for (uint i = 0; i < count; i++) {
+			storage->ClearChanges();
+			if (i % 8 == 0) storage->StoreValue(registers[i], i);
+			_checksum += storage->GetValue(registers[i + 1]);
+		}
+	});
+	Measure("TempStorage", "store", count, [&]() {
+		for (uint i = 0; i < count; i++) {
+			storage->ClearChanges();
+			const uint16 *regs = &registers[i * 4];
+			storage->StoreValue(regs[0], i);
+			storage->StoreValue(regs[1], i);
+			for (uint j = 0; j < 4; j++) _checksum += storage->GetValue(regs[j]);
+		}
+	});
+}
+
+/** And the main program (what else?) */
+int CDECL main(int argc, char *argv[])
+{
+	/* Item counts like the number of vehicles, stations or pathfinder nodes of a large game. */
+	static const uint COUNTS[] = { 1000, 100000 };
+
+	for (uint count : COUNTS) {
+		BenchPool(count);
+		BenchKdtree(count);
+		BenchSmallMap(count, 8);
+		BenchMultiMap(count);
+		BenchSmallVector(count, 32);
+		BenchBinaryHeap(count);
+		BenchHashTable(count);
+		BenchSmallArray(count);
+		BenchTemporaryStorage(count * 100);
+	}
+
+	printf("Checksum: " OTTD_PRINTF64 "\n", _checksum);
+	return 0;
+}
@@ -88,7 +88,17 @@ uint64 ottd_rdtsc() {return 0;}
 #if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
 void ottd_cpuid(int info[4], int type)
 {
-	__cpuid(info, type);
+	__cpuidex(info, type, 0);
+}
+
+/**
+ * Get the extended control register of the CPU.
+ * @param index The register to read.
+ * @return The value of the register.
+ */
+static uint64 ottd_xgetbv(uint index)
+{
+	return _xgetbv(index);
 }
 #elif defined(__x86_64__) || defined(__i386)
 void ottd_cpuid(int info[4], int type)
@@ -108,21 +118,38 @@ void ottd_cpuid(int info[4], int type)
 			/* It is safe to write "=r" for (info[1]) as in case that PIC is enabled for i386,
 			 * the compiler will not choose EBX as target register (but something else).
 			 */
-			: "a" (type)
+			: "a" (type), "c" (0)
 	);
 #else
 	__asm__ __volatile__ (
 			"cpuid           \n\t"
 			: "=a" (info[0]), "=b" (info[1]), "=c" (info[2]), "=d" (info[3])
-			: "a" (type)
+			: "a" (type), "c" (0)
 	);
 #endif /* i386 PIC */
 }
+
+/**
+ * Get the extended control register of the CPU.
+ * @param index The register to read.
+ * @return The value of the register.
+ */
+static uint64 ottd_xgetbv(uint index)
+{
+	uint32 high, low;
+	__asm__ __volatile__ ("xgetbv" : "=a" (low), "=d" (high) : "c" (index));
+	return ((uint64)high << 32) | low;
+}
 #else
 void ottd_cpuid(int info[4], int type)
 {
 	info[0] = info[1] = info[2] = info[3] = 0;
 }
+
+static uint64 ottd_xgetbv(uint index)
+{
+	return 0;
+}
 #endif
 
 bool HasCPUIDFlag(uint type, uint index, uint bit)
@@ -135,3 +162,13 @@ bool HasCPUIDFlag(uint type, uint index, uint bit)
 	ottd_cpuid(cpu_info, type);
 	return HasBit(cpu_info[index], bit);
 }
+
+bool HasAVX2Support()
+{
+	/* The operating system has to support XSAVE (bit 27) and AVX (bit 28)... */
+	if (!HasCPUIDFlag(1, 2, 27) || !HasCPUIDFlag(1, 2, 28)) return false;
+	/* ... and has to save both the SSE and AVX registers on context switches... */
+	if ((ottd_xgetbv(0) & 0x6) != 0x6) return false;
+	/* ... before the AVX2 flag of the CPU means anything. */
+	return HasCPUIDFlag(7, 1, 5);
+}
@@ -19,7 +19,7 @@ uint64 ottd_rdtsc();
 /**
  * Get the CPUID information from the CPU.
  * @param info The retrieved info. All zeros on architectures without CPUID.
- * @param type The information this instruction should retrieve.
+ * @param type The information this instruction should retrieve; of types with sub-leaves the first sub-leaf is retrieved.
  */
 void ottd_cpuid(int info[4], int type);
 
@@ -32,4 +32,11 @@ void ottd_cpuid(int info[4], int type);
  */
 bool HasCPUIDFlag(uint type, uint index, uint bit);
 
+/**
+ * Check whether the AVX2 instructions can be used.
+ * Besides the CPU supporting them, the operating system must save the AVX registers.
+ * @return True when the AVX2 instructions are available.
+ */
+bool HasAVX2Support();
+
 #endif /* CPU_H */
@@ -26,6 +26,7 @@
 #include "language.h"
 #include "fontcache.h"
 #include "news_gui.h"
+#include "worker_pool.h"
 
 #include "ai/ai_info.hpp"
 #include "game/game.hpp"
@@ -56,6 +57,9 @@
 #ifdef WITH_LIBLZMA
 #	include <lzma.h>
 #endif
+#ifdef WITH_ZSTD
+#	include <zstd.h>
+#endif
 #ifdef WITH_LZO
 #include <lzo/lzo1x.h>
 #endif
@@ -255,6 +259,10 @@ char *CrashLog::LogLibraries(char *buffer, const char *last) const
 	buffer += seprintf(buffer, last, " LZMA:       %s\n", lzma_version_string());
 #endif
 
+#ifdef WITH_ZSTD
+	buffer += seprintf(buffer, last, " ZSTD:       %s\n", ZSTD_versionString());
+#endif
+
 #ifdef WITH_LZO
 	buffer += seprintf(buffer, last, " LZO:        %s\n", lzo_version_string());
 #endif
@@ -425,6 +433,9 @@ bool CrashLog::WriteScreenshot(char *filename, const char *filename_last) const
 	/* Don't draw when we have invalid screen size */
 	if (_screen.width < 1 || _screen.height < 1 || _screen.dst_ptr == nullptr) return false;
 
+	/* The worker threads may be in any state after a crash; do everything on this thread. */
+	DisableWorkerThreads();
+
 	bool res = MakeScreenshot(SC_CRASHLOG, "crash");
 	if (res) strecpy(filename, _full_screenshot_name, filename_last);
 	return res;
@@ -15,6 +15,7 @@
 #include "settings_type.h"
 #include "date_func.h"
 #include "string_type.h"
+#include "strings_func.h"
 
 #include "table/strings.h"
 
@@ -141,6 +142,7 @@ void CheckSwitchToEuro()
 			_currency_specs[_settings_game.locale.currency].to_euro != CF_ISEURO &&
 			_cur_year >= _currency_specs[_settings_game.locale.currency].to_euro) {
 		_settings_game.locale.currency = 2; // this is the index of euro above.
+		ClearFormattedStringCache();
 		AddNewsItem(STR_NEWS_EURO_INTRODUCTION, NT_ECONOMY, NF_NORMAL);
 	}
 }
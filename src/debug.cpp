@@ -14,12 +14,17 @@
 #include "string_func.h"
 #include "fileio_func.h"
 #include "settings_type.h"
+#include "thread.h"
 
 #if defined(_WIN32)
 #include "os/windows/win32.h"
 #endif
 
 #include <time.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
 
 #include "network/network_admin.h"
 SOCKET _debug_socket = INVALID_SOCKET;
@@ -100,6 +105,166 @@ char *DumpDebugFacilityNames(char *buf, char *last)
 	return buf;
 }
 
+/** Destination of a debug line. */
+enum DebugLogTarget {
+	DLT_STDERR, ///< The standard error output.
+	DLT_DESYNC, ///< The desync log file, commands-out.log.
+	DLT_RANDOM, ///< The random log file, random-out.log.
+	DLT_SOCKET, ///< The debug socket.
+};
+
+/** A formatted debug line waiting to be written. */
+struct DebugLogLine {
+	DebugLogTarget target; ///< Where to write the line to.
+	SOCKET socket;         ///< The debug socket, for #DLT_SOCKET.
+	std::string text;      ///< The line, including its prefix and newline.
+};
+
+static const size_t MAX_QUEUED_DEBUG_LINES = 1 << 16; ///< Number of lines queued before writing synchronously again.
+
+static std::mutex _debug_log_mutex;                   ///< Protects #_debug_log_queue and #_debug_log_async.
+static std::condition_variable _debug_log_signal;     ///< Signals the writer that there are lines to write, or that it has to stop.
+static std::vector<DebugLogLine> _debug_log_queue;    ///< Lines waiting for the writer.
+static bool _debug_log_async = false;                 ///< Whether the writer thread is running.
+static std::thread _debug_log_thread;                 ///< The writer thread.
+
+/**
+ * Get the file to write the lines for a target to.
+ * @param target The target; not #DLT_STDERR or #DLT_SOCKET.
+ * @return The file, or \c nullptr if it could not be opened.
+ */
+static FILE *GetDebugLogFile(DebugLogTarget target)
+{
+	if (target == DLT_DESYNC) {
+		static FILE *f = FioFOpenFile("commands-out.log", "wb", AUTOSAVE_DIR);
+		return f;
+	}
+	static FILE *f = FioFOpenFile("random-out.log", "wb", AUTOSAVE_DIR);
+	return f;
+}
+
+/**
+ * Write a debug line to its target.
+ * @param line The line.
+ * @param flush Whether to flush the file of the target after writing.
+ */
+static void WriteDebugLogLine(const DebugLogLine &line, bool flush)
+{
+	switch (line.target) {
+		case DLT_SOCKET:
+			/* Sending out an error when this fails would be nice, however... the error
+			 * would have to be send over this failing socket which won't work. */
+			send(line.socket, line.text.c_str(), (int)line.text.size(), 0);
+			break;
+
+		case DLT_DESYNC:
+		case DLT_RANDOM: {
+			FILE *f = GetDebugLogFile(line.target);
+			if (f == nullptr) break;
+
+			fputs(line.text.c_str(), f);
+			if (flush) fflush(f);
+			break;
+		}
+
+		case DLT_STDERR: {
+#if defined(_WIN32)
+			TCHAR system_buf[512];
+			convert_to_fs(line.text.c_str(), system_buf, lengthof(system_buf), true);
+			_fputts(system_buf, stderr);
+#else
+			fputs(line.text.c_str(), stderr);
+#endif
+			break;
+		}
+	}
+}
+
+/**
+ * Write a debug line, or queue it for the writer thread when that is running.
+ * @param line The line.
+ */
+static void OutputDebugLogLine(DebugLogLine &&line)
+{
+	{
+		std::lock_guard<std::mutex> lock(_debug_log_mutex);
+		if (_debug_log_async && _debug_log_queue.size() < MAX_QUEUED_DEBUG_LINES) {
+			_debug_log_queue.push_back(std::move(line));
+			_debug_log_signal.notify_one();
+			return;
+		}
+	}
+	WriteDebugLogLine(line, true);
+}
+
+/** Write the queued debug lines until #StopDebugLogWriter is called. */
+static void DebugLogWriterThread()
+{
+	std::vector<DebugLogLine> lines;
+	std::unique_lock<std::mutex> lock(_debug_log_mutex);
+	for (;;) {
+		_debug_log_signal.wait(lock, [] { return !_debug_log_queue.empty() || !_debug_log_async; });
+		if (_debug_log_queue.empty()) return;
+
+		lines.swap(_debug_log_queue);
+		lock.unlock();
+
+		/* The files are only flushed once per batch; that is what makes writing here cheaper. */
+		for (const DebugLogLine &line : lines) WriteDebugLogLine(line, false);
+		for (DebugLogTarget target : { DLT_DESYNC, DLT_RANDOM }) {
+			if (std::any_of(lines.begin(), lines.end(), [target](const DebugLogLine &line) { return line.target == target; })) {
+				FILE *f = GetDebugLogFile(target);
+				if (f != nullptr) fflush(f);
+			}
+		}
+		lines.clear();
+
+		lock.lock();
+	}
+}
+
+/**
+ * Start writing debug lines on a separate thread, so the threads logging them
+ * only have to format them. The lines are timestamped when they are logged.
+ * Without the writer thread, or when it cannot keep up, lines are written directly.
+ */
+void StartDebugLogWriter()
+{
+	if (_debug_log_thread.joinable()) return;
+
+	{
+		std::lock_guard<std::mutex> lock(_debug_log_mutex);
+		_debug_log_async = true;
+	}
+	if (StartNewThread(&_debug_log_thread, "ottd:debuglog", &DebugLogWriterThread)) {
+		/* Also write the lines logged right before exiting on an error. */
+		atexit(&StopDebugLogWriter);
+		return;
+	}
+
+	/* Without a thread, write what got queued in the mean time directly. */
+	std::vector<DebugLogLine> lines;
+	{
+		std::lock_guard<std::mutex> lock(_debug_log_mutex);
+		_debug_log_async = false;
+		lines.swap(_debug_log_queue);
+	}
+	for (const DebugLogLine &line : lines) WriteDebugLogLine(line, true);
+}
+
+/** Write all queued debug lines, and stop the writer thread. */
+void StopDebugLogWriter()
+{
+	if (!_debug_log_thread.joinable()) return;
+
+	{
+		std::lock_guard<std::mutex> lock(_debug_log_mutex);
+		_debug_log_async = false;
+	}
+	_debug_log_signal.notify_one();
+	_debug_log_thread.join();
+}
+
 /**
  * Internal function for outputting the debug line.
  * @param dbg Debug category.
@@ -111,35 +276,23 @@ static void debug_print(const char *dbg, const char *buf)
 		char buf2[1024 + 32];
 
 		seprintf(buf2, lastof(buf2), "%sdbg: [%s] %s\n", GetLogPrefix(), dbg, buf);
-		/* Sending out an error when this fails would be nice, however... the error
-		 * would have to be send over this failing socket which won't work. */
-		send(_debug_socket, buf2, (int)strlen(buf2), 0);
+		OutputDebugLogLine({DLT_SOCKET, _debug_socket, buf2});
 		return;
 	}
 	if (strcmp(dbg, "desync") == 0) {
-		static FILE *f = FioFOpenFile("commands-out.log", "wb", AUTOSAVE_DIR);
-		if (f == nullptr) return;
-
-		fprintf(f, "%s%s\n", GetLogPrefix(), buf);
-		fflush(f);
+		char buffer[1024 + 32];
+		seprintf(buffer, lastof(buffer), "%s%s\n", GetLogPrefix(), buf);
+		OutputDebugLogLine({DLT_DESYNC, INVALID_SOCKET, buffer});
 #ifdef RANDOM_DEBUG
 	} else if (strcmp(dbg, "random") == 0) {
-		static FILE *f = FioFOpenFile("random-out.log", "wb", AUTOSAVE_DIR);
-		if (f == nullptr) return;
-
-		fprintf(f, "%s\n", buf);
-		fflush(f);
+		char buffer[1024 + 32];
+		seprintf(buffer, lastof(buffer), "%s\n", buf);
+		OutputDebugLogLine({DLT_RANDOM, INVALID_SOCKET, buffer});
 #endif
 	} else {
 		char buffer[512];
 		seprintf(buffer, lastof(buffer), "%sdbg: [%s] %s\n", GetLogPrefix(), dbg, buf);
-#if defined(_WIN32)
-		TCHAR system_buf[512];
-		convert_to_fs(buffer, system_buf, lengthof(system_buf), true);
-		_fputts(system_buf, stderr);
-#else
-		fputs(buffer, stderr);
-#endif
+		OutputDebugLogLine({DLT_STDERR, INVALID_SOCKET, buffer});
 		NetworkAdminConsole(dbg, buf);
 		IConsoleDebug(dbg, buf);
 	}
@@ -59,6 +59,9 @@ char *DumpDebugFacilityNames(char *buf, char *last);
 void SetDebugString(const char *s);
 const char *GetDebugString();
 
+void StartDebugLogWriter();
+void StopDebugLogWriter();
+
 /* Shorter form for passing filename and linenumber */
 #define FILE_LINE __FILE__, __LINE__
 
@@ -15,6 +15,8 @@
 #include "core/pool_func.hpp"
 #include "vehicle_gui.h"
 #include "vehiclelist.h"
+#include "depot_func.h"
+#include "pathfinder/pathfinder_type.h"
 
 #include "safeguards.h"
 
@@ -22,6 +24,77 @@
 DepotPool _depot_pool("Depot");
 INSTANTIATE_POOL_METHODS(Depot)
 
+static std::vector<TileIndex> _depot_tiles[TRANSPORT_END]; ///< Tiles of the depots of each transport type, in the order of the pool.
+static bool _depot_tiles_valid = false;                    ///< Whether #_depot_tiles is up to date with the pool.
+
+/** Forget the cached depot tiles when a depot is built or removed. */
+static void InvalidateDepotTiles()
+{
+	_depot_tiles_valid = false;
+}
+
+/**
+ * Get the tiles of all depots of a transport type.
+ * The list is shared by all vehicles looking for a depot to get serviced at,
+ * and only rebuilt after depots are built or removed.
+ * @param type The transport type of the depots.
+ * @return The tiles of the depots, in the order of the depot pool.
+ */
+const std::vector<TileIndex> &GetDepotTiles(TransportType type)
+{
+	if (!_depot_tiles_valid) {
+		for (std::vector<TileIndex> &tiles : _depot_tiles) tiles.clear();
+		for (const Depot *depot : Depot::Iterate()) {
+			TileIndex tile = depot->xy;
+			if (IsRailDepotTile(tile)) {
+				_depot_tiles[TRANSPORT_RAIL].push_back(tile);
+			} else if (IsRoadDepotTile(tile)) {
+				_depot_tiles[TRANSPORT_ROAD].push_back(tile);
+			} else if (IsShipDepotTile(tile)) {
+				_depot_tiles[TRANSPORT_WATER].push_back(tile);
+			}
+		}
+		_depot_tiles_valid = true;
+	}
+	return _depot_tiles[type];
+}
+
+/**
+ * Check whether a depot search of NPF or YAPF could find any depot at all.
+ * Both pathfinders make every tile of the path cost at least a piece of track
+ * across a corner of the tile, so a depot further away than the maximum cost
+ * of the search can only be reached through tiles costing more than allowed.
+ * @param type The transport type of the depots.
+ * @param tiles The tiles the search may start at.
+ * @param num_tiles The number of tiles in \a tiles.
+ * @param max_penalty The maximum cost of the search, or 0 for no limit.
+ * @return False if the search certainly finds no depot within \a max_penalty.
+ */
+bool IsDepotWithinPenalty(TransportType type, const TileIndex *tiles, uint num_tiles, uint max_penalty)
+{
+	if (max_penalty == 0) return true;
+
+	const uint min_tile_cost = min<uint>(YAPF_TILE_CORNER_LENGTH, NPF_TILE_LENGTH * STRAIGHT_TRACK_LENGTH);
+	/* Only the depot tile itself may be entered for free. */
+	uint max_distance = max_penalty / min_tile_cost + 1;
+
+	for (TileIndex depot : GetDepotTiles(type)) {
+		for (uint i = 0; i < num_tiles; i++) {
+			if (DistanceManhattan(depot, tiles[i]) <= max_distance) return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Create a new depot.
+ * @param xy The tile of the depot.
+ */
+Depot::Depot(TileIndex xy) : xy(xy)
+{
+	InvalidateDepotTiles();
+}
+
 /**
  * Clean up a depot
  */
@@ -29,6 +102,8 @@ Depot::~Depot()
 {
 	free(this->name);
 
+	InvalidateDepotTiles();
+
 	if (CleaningPool()) return;
 
 	if (!IsDepotTile(this->xy) || GetDepotIndex(this->xy) != this->index) {
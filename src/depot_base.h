@@ -24,7 +24,7 @@ struct Depot : DepotPool::PoolItem<&_depot_pool> {
 	uint16 town_cn;    ///< The N-1th depot for this town (consecutive number)
 	Date build_date;   ///< Date of construction
 
-	Depot(TileIndex xy = INVALID_TILE) : xy(xy) {}
+	Depot(TileIndex xy = INVALID_TILE);
 	~Depot();
 
 	static inline Depot *GetByTile(TileIndex tile)
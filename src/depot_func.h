@@ -12,11 +12,16 @@
 
 #include "vehicle_type.h"
 #include "slope_func.h"
+#include "transport_type.h"
+#include <vector>
 
 void ShowDepotWindow(TileIndex tile, VehicleType type);
 
 void DeleteDepotHighlightOfVehicle(const Vehicle *v);
 
+const std::vector<TileIndex> &GetDepotTiles(TransportType type);
+bool IsDepotWithinPenalty(TransportType type, const TileIndex *tiles, uint num_tiles, uint max_penalty);
+
 /**
  * Find out if the slope of the tile is suitable to build a depot of given direction
  * @param direction The direction in which the depot's exit points
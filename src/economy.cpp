@@ -48,6 +48,7 @@
 #include "goal_base.h"
 #include "story_base.h"
 #include "linkgraph/refresh.h"
+#include "trace_zone.h"
 
 #include "table/strings.h"
 #include "table/pricebase.h"
@@ -110,32 +111,54 @@ static PriceMultipliers _price_base_multiplier;
  */
 Money CalculateCompanyValue(const Company *c, bool including_loan)
 {
-	Owner owner = c->index;
+	/* The stations and vehicles are counted as they change, see Station::UpdateOwnerAssets and CountVehicleAssetValue. */
+	Money value = c->assets.station_facilities * _price[PR_STATION_VALUE] * 25;
+	value += c->assets.vehicle_value;
 
-	uint num = 0;
+	/* Add real money value */
+	if (including_loan) value -= c->current_loan;
+	value += c->money;
 
-	for (const Station *st : Station::Iterate()) {
-		if (st->owner == owner) num += CountBits((byte)st->facilities);
-	}
+	return max(value, (Money)1);
+}
+
+/** Counts of the vehicles and stations of a company for its performance rating. */
+struct CompanyRatingCounts {
+	uint profitable_vehicles; ///< Number of vehicles that made a profit last year.
+	Money min_profit;         ///< Lowest profit last year of the vehicles older than two years.
+	bool has_min_profit;      ///< Whether any vehicle is older than two years.
+	uint serviced_facilities; ///< Count of the facilities of stations that were serviced recently.
+};
 
-	Money value = num * _price[PR_STATION_VALUE] * 25;
+/**
+ * Count the vehicles and stations of all companies for their performance ratings, in a single pass over the pools.
+ * @param[out] counts The counts per company.
+ */
+static void CountCompanyRatingParts(CompanyRatingCounts counts[MAX_COMPANIES])
+{
+	for (CompanyID c = COMPANY_FIRST; c < MAX_COMPANIES; c++) counts[c] = {};
 
 	for (const Vehicle *v : Vehicle::Iterate()) {
-		if (v->owner != owner) continue;
-
-		if (v->type == VEH_TRAIN ||
-				v->type == VEH_ROAD ||
-				(v->type == VEH_AIRCRAFT && Aircraft::From(v)->IsNormalAircraft()) ||
-				v->type == VEH_SHIP) {
-			value += v->value * 3 >> 1;
+		if (v->owner >= MAX_COMPANIES) continue;
+		if (IsCompanyBuildableVehicleType(v->type) && v->IsPrimaryVehicle()) {
+			CompanyRatingCounts &count = counts[v->owner];
+			if (v->profit_last_year > 0) count.profitable_vehicles++; // For the vehicle score only count profitable vehicles
+			if (v->age > 730) {
+				/* Find the vehicle with the lowest amount of profit */
+				if (!count.has_min_profit || count.min_profit > v->profit_last_year) {
+					count.min_profit = v->profit_last_year;
+					count.has_min_profit = true;
+				}
+			}
 		}
 	}
 
-	/* Add real money value */
-	if (including_loan) value -= c->current_loan;
-	value += c->money;
-
-	return max(value, (Money)1);
+	for (const Station *st : Station::Iterate()) {
+		/* Only count stations that are actually serviced */
+		if (st->owner < MAX_COMPANIES && (st->time_since_load <= 20 || st->time_since_unload <= 20)) {
+			counts[st->owner].serviced_facilities += CountBits((byte)st->facilities);
+		}
+	}
 }
 
 /**
@@ -143,10 +166,11 @@ Money CalculateCompanyValue(const Company *c, bool including_loan)
  *  (also the house is updated, should only be true in the on-tick event)
  * @param update the economy with calculated score
  * @param c company been evaluated
+ * @param counts the counts of the vehicles and stations of the company
  * @return actual score of this company
  *
  */
-int UpdateCompanyRatingAndValue(Company *c, bool update)
+static int UpdateCompanyRatingAndValue(Company *c, bool update, const CompanyRatingCounts &counts)
 {
 	Owner owner = c->index;
 	int score = 0;
@@ -155,27 +179,9 @@ int UpdateCompanyRatingAndValue(Company *c, bool update)
 
 	/* Count vehicles */
 	{
-		Money min_profit = 0;
-		bool min_profit_first = true;
-		uint num = 0;
-
-		for (const Vehicle *v : Vehicle::Iterate()) {
-			if (v->owner != owner) continue;
-			if (IsCompanyBuildableVehicleType(v->type) && v->IsPrimaryVehicle()) {
-				if (v->profit_last_year > 0) num++; // For the vehicle score only count profitable vehicles
-				if (v->age > 730) {
-					/* Find the vehicle with the lowest amount of profit */
-					if (min_profit_first || min_profit > v->profit_last_year) {
-						min_profit = v->profit_last_year;
-						min_profit_first = false;
-					}
-				}
-			}
-		}
-
-		min_profit >>= 8; // remove the fract part
+		Money min_profit = counts.min_profit >> 8; // remove the fract part
 
-		_score_part[owner][SCORE_VEHICLES] = num;
+		_score_part[owner][SCORE_VEHICLES] = counts.profitable_vehicles;
 		/* Don't allow negative min_profit to show */
 		if (min_profit > 0) {
 			_score_part[owner][SCORE_MIN_PROFIT] = min_profit;
@@ -184,12 +190,7 @@ int UpdateCompanyRatingAndValue(Company *c, bool update)
 
 	/* Count stations */
 	{
-		uint num = 0;
-		for (const Station *st : Station::Iterate()) {
-			/* Only count stations that are actually serviced */
-			if (st->owner == owner && (st->time_since_load <= 20 || st->time_since_unload <= 20)) num += CountBits((byte)st->facilities);
-		}
-		_score_part[owner][SCORE_STATIONS] = num;
+		_score_part[owner][SCORE_STATIONS] = counts.serviced_facilities;
 	}
 
 	/* Generate statistics depending on recent income statistics */
@@ -274,6 +275,35 @@ int UpdateCompanyRatingAndValue(Company *c, bool update)
 	return score;
 }
 
+/**
+ * if update is set to true, the economy is updated with this score
+ *  (also the house is updated, should only be true in the on-tick event)
+ * @param update the economy with calculated score
+ * @param c company been evaluated
+ * @return actual score of this company
+ * @see UpdateAllCompaniesRatingAndValue for evaluating all companies at once
+ */
+int UpdateCompanyRatingAndValue(Company *c, bool update)
+{
+	CompanyRatingCounts counts[MAX_COMPANIES];
+	CountCompanyRatingParts(counts);
+	return UpdateCompanyRatingAndValue(c, update, counts[c->index]);
+}
+
+/**
+ * Evaluate all companies, like #UpdateCompanyRatingAndValue, with a single pass
+ * over the vehicles and stations.
+ * @param update the economy with calculated score
+ */
+void UpdateAllCompaniesRatingAndValue(bool update)
+{
+	CompanyRatingCounts counts[MAX_COMPANIES];
+	CountCompanyRatingParts(counts);
+	for (Company *c : Company::Iterate()) {
+		UpdateCompanyRatingAndValue(c, update, counts[c->index]);
+	}
+}
+
 /**
  * Change the ownership of all the items of a company.
  * @param old_owner The company that gets removed.
@@ -392,6 +422,7 @@ void ChangeOwnershipOfCompanyItems(Owner old_owner, Owner new_owner)
 				} else {
 					if (v->IsEngineCountable()) GroupStatistics::CountEngine(v, -1);
 					if (v->IsPrimaryVehicle()) GroupStatistics::CountVehicle(v, -1);
+					CountVehicleAssetValue(v, -1);
 				}
 			}
 		}
@@ -447,6 +478,7 @@ void ChangeOwnershipOfCompanyItems(Owner old_owner, Owner new_owner)
 				}
 
 				v->owner = new_owner;
+				CountVehicleAssetValue(v, 1);
 
 				/* Owner changes, clear cache */
 				v->colourmap = PAL_NONE;
@@ -475,6 +507,9 @@ void ChangeOwnershipOfCompanyItems(Owner old_owner, Owner new_owner)
 			ChangeTileOwner(tile, old_owner, new_owner);
 		} while (++tile != MapSize());
 
+		/* Reservations are only followed over the tracks of the owner of the train. */
+		NotifyReservationChange();
+
 		if (new_owner != INVALID_OWNER) {
 			/* Update all signals because there can be new segment that was owned by two companies
 			 * and signals were not propagated
@@ -507,7 +542,9 @@ void ChangeOwnershipOfCompanyItems(Owner old_owner, Owner new_owner)
 		if (st->owner == old_owner) {
 			/* if a company goes bankrupt, set owner to OWNER_NONE so the sign doesn't disappear immediately
 			 * also, drawing station window would cause reading invalid company's colour */
+			st->UpdateOwnerAssets(-1);
 			st->owner = new_owner == INVALID_OWNER ? OWNER_NONE : new_owner;
+			st->UpdateOwnerAssets(1);
 		}
 	}
 
@@ -688,10 +725,11 @@ static void CompaniesGenStatistics()
 
 		if (c->num_valid_stat_ent != MAX_HISTORY_QUARTERS) c->num_valid_stat_ent++;
 
-		UpdateCompanyRatingAndValue(c, true);
 		if (c->block_preview != 0) c->block_preview--;
 	}
 
+	UpdateAllCompaniesRatingAndValue(true);
+
 	SetWindowDirty(WC_INCOME_GRAPH, 0);
 	SetWindowDirty(WC_OPERATING_PROFIT, 0);
 	SetWindowDirty(WC_DELIVERED_CARGO, 0);
@@ -955,6 +993,57 @@ Money GetPrice(Price index, uint cost_factor, const GRFFile *grf_file, int shift
 	return cost;
 }
 
+/** Cached result of the cargo profit callback. */
+struct CargoProfitCacheEntry {
+	uint32 generation; ///< Generation of the cache the entry belongs to.
+	CargoID cargo;     ///< Cargo type the callback was called for.
+	uint32 var18;      ///< Variable 18 the callback was called with.
+	uint16 result;     ///< Result of the callback.
+};
+
+static const uint CARGO_PROFIT_CACHE_SIZE = 64; ///< Number of cached cargo profit callback results.
+static CargoProfitCacheEntry _cargo_profit_cache[CARGO_PROFIT_CACHE_SIZE]; ///< Cached cargo profit callback results.
+static uint32 _cargo_profit_cache_generation = 0; ///< Current generation of the cache; entries of other generations are invalid.
+static bool _cargo_profit_cache_active = false;    ///< Whether results of the cargo profit callback are cached.
+
+/** Start caching the results of the cargo profit callback; all earlier results are dropped. */
+static void StartCargoProfitCache()
+{
+	if (++_cargo_profit_cache_generation == 0) {
+		MemSetT(_cargo_profit_cache, 0, CARGO_PROFIT_CACHE_SIZE);
+		_cargo_profit_cache_generation = 1;
+	}
+	_cargo_profit_cache_active = true;
+}
+
+/** Stop caching the results of the cargo profit callback. */
+static void StopCargoProfitCache()
+{
+	_cargo_profit_cache_active = false;
+}
+
+/**
+ * Call the cargo profit callback. While a station loads and unloads, the same
+ * cargo is usually paid for many packets of the same size, distance and days
+ * in transit during the same tick, so the results are reused then.
+ * @param cs Cargo to get the profit for.
+ * @param var18 Distance, amount of cargo and days in transit, as passed in variable 18.
+ * @return Result of the callback.
+ */
+static uint16 GetCargoProfitCallback(const CargoSpec *cs, uint32 var18)
+{
+	if (!_cargo_profit_cache_active) return GetCargoCallback(CBID_CARGO_PROFIT_CALC, 0, var18, cs);
+
+	CargoProfitCacheEntry &entry = _cargo_profit_cache[((var18 ^ cs->Index()) * 0x9E3779B1U) >> 26];
+	if (entry.generation != _cargo_profit_cache_generation || entry.cargo != cs->Index() || entry.var18 != var18) {
+		entry.generation = _cargo_profit_cache_generation;
+		entry.cargo = cs->Index();
+		entry.var18 = var18;
+		entry.result = GetCargoCallback(CBID_CARGO_PROFIT_CALC, 0, var18, cs);
+	}
+	return entry.result;
+}
+
 Money GetTransportedGoodsIncome(uint num_pieces, uint dist, byte transit_days, CargoID cargo_type)
 {
 	const CargoSpec *cs = CargoSpec::Get(cargo_type);
@@ -966,7 +1055,7 @@ Money GetTransportedGoodsIncome(uint num_pieces, uint dist, byte transit_days, C
 	/* Use callback to calculate cargo profit, if available */
 	if (HasBit(cs->callback_mask, CBM_CARGO_PROFIT_CALC)) {
 		uint32 var18 = min(dist, 0xFFFF) | (min(num_pieces, 0xFF) << 16) | (transit_days << 24);
-		uint16 callback = GetCargoCallback(CBID_CARGO_PROFIT_CALC, 0, var18, cs);
+		uint16 callback = GetCargoProfitCallback(cs, var18);
 		if (callback != CALLBACK_FAILED) {
 			int result = GB(callback, 0, 14);
 
@@ -1237,7 +1326,7 @@ Money CargoPayment::PayTransfer(const CargoPacket *cp, uint count)
 void PrepareUnload(Vehicle *front_v)
 {
 	Station *curr_station = Station::Get(front_v->last_station_visited);
-	curr_station->loading_vehicles.push_back(front_v);
+	curr_station->AddLoadingVehicle(front_v);
 
 	/* At this moment loading cannot be finished */
 	ClrBit(front_v->vehicle_flags, VF_LOADING_FINISHED);
@@ -1908,8 +1997,10 @@ void LoadUnloadStation(Station *st)
 	/* No vehicle is here... */
 	if (st->loading_vehicles.empty()) return;
 
+	TraceZone zone("LoadUnloadStation", st->index);
+
 	Vehicle *last_loading = nullptr;
-	std::list<Vehicle *>::iterator iter;
+	std::vector<Vehicle *>::iterator iter;
 
 	/* Check if anything will be loaded at all. Otherwise we don't need to reserve either. */
 	for (iter = st->loading_vehicles.begin(); iter != st->loading_vehicles.end(); ++iter) {
@@ -1930,11 +2021,14 @@ void LoadUnloadStation(Station *st)
 	 */
 	if (last_loading == nullptr) return;
 
+	/* All payments happen within this tick, so the profit callback gives the same results for the same input. */
+	StartCargoProfitCache();
 	for (iter = st->loading_vehicles.begin(); iter != st->loading_vehicles.end(); ++iter) {
 		Vehicle *v = *iter;
 		if (!(v->vehstatus & (VS_STOPPED | VS_CRASHED))) LoadUnloadVehicle(v);
 		if (v == last_loading) break;
 	}
+	StopCargoProfitCache();
 
 	/* Call the production machinery of industries */
 	for (Industry *iid : _cargo_delivery_destinations) {
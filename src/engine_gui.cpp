@@ -318,6 +318,51 @@ void DrawVehicleEngine(int left, int right, int preferred_x, int y, EngineID eng
 	}
 }
 
+/** Sort key of an engine as computed during the current sort. */
+struct CachedEngineSortKey {
+	uint32 generation;                 ///< Sort during which the key was computed.
+	EngList_SortKeyFunction *compute;  ///< Function that computed the key.
+	EngineSortKey key;                 ///< The computed key.
+};
+
+static std::vector<CachedEngineSortKey> _engine_sort_keys; ///< Sort keys of the engines, indexed by engine.
+static uint32 _engine_sort_generation = 0;                 ///< Number of the current sort.
+
+/**
+ * Forget the sort keys of the previous sort. Engine properties may come from
+ * NewGRF callbacks depending on the date, so they are only kept during one sort.
+ */
+static void StartEngineSort()
+{
+	if (++_engine_sort_generation == 0) {
+		_engine_sort_keys.clear();
+		_engine_sort_generation = 1;
+	}
+	/* Make room for all engines now, so references to keys stay valid during the sort. */
+	_engine_sort_keys.resize(Engine::GetPoolSize(), {0, nullptr, {0, 0}});
+}
+
+/**
+ * Get the sort key of an engine, computing it only once per sort. Sort
+ * functions comparing properties that are expensive to evaluate, such as
+ * NewGRF callback results, use this instead of evaluating them for every comparison.
+ * @param engine  Engine to get the key of.
+ * @param compute Function computing the key.
+ * @return The sort key.
+ * @pre Called from a sort function during #EngList_Sort or #EngList_SortPartial.
+ */
+const EngineSortKey &GetEngineSortKey(EngineID engine, EngList_SortKeyFunction *compute)
+{
+	assert(engine < _engine_sort_keys.size());
+	CachedEngineSortKey &cached = _engine_sort_keys[engine];
+	if (cached.generation != _engine_sort_generation || cached.compute != compute) {
+		cached.generation = _engine_sort_generation;
+		cached.compute = compute;
+		cached.key = compute(engine);
+	}
+	return cached.key;
+}
+
 /**
  * Sort all items using quick sort and given 'CompareItems' function
  * @param el list to be sorted
@@ -326,6 +371,7 @@ void DrawVehicleEngine(int left, int right, int preferred_x, int y, EngineID eng
 void EngList_Sort(GUIEngineList *el, EngList_SortTypeFunction compare)
 {
 	if (el->size() < 2) return;
+	StartEngineSort();
 	std::sort(el->begin(), el->end(), compare);
 }
 
@@ -341,6 +387,7 @@ void EngList_SortPartial(GUIEngineList *el, EngList_SortTypeFunction compare, ui
 	if (num_items < 2) return;
 	assert(begin < el->size());
 	assert(begin + num_items <= el->size());
+	StartEngineSort();
 	std::sort(el->begin() + begin, el->begin() + begin + num_items, compare);
 }
 
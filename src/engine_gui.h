@@ -21,6 +21,15 @@ typedef bool EngList_SortTypeFunction(const EngineID&, const EngineID&); ///< ar
 void EngList_Sort(GUIEngineList *el, EngList_SortTypeFunction compare);
 void EngList_SortPartial(GUIEngineList *el, EngList_SortTypeFunction compare, uint begin, uint num_items);
 
+/** Values of an engine that a sort function compares. */
+struct EngineSortKey {
+	int64 primary;   ///< Value to sort on.
+	int64 secondary; ///< Value to sort on when the primary values are equal.
+};
+
+typedef EngineSortKey EngList_SortKeyFunction(EngineID engine); ///< argument type for #GetEngineSortKey.
+const EngineSortKey &GetEngineSortKey(EngineID engine, EngList_SortKeyFunction *compute);
+
 StringID GetEngineCategoryName(EngineID engine);
 StringID GetEngineInfoString(EngineID engine);
 
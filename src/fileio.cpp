@@ -26,6 +26,11 @@
 #include <sys/stat.h>
 #include <algorithm>
 
+#if defined(UNIX)
+#	define WITH_MMAP_FIO
+#	include <sys/mman.h>
+#endif
+
 #ifdef WITH_XDG_BASEDIR
 #include <basedir.h>
 #endif
@@ -37,21 +42,37 @@
 
 /** Structure for keeping several open files with just one data buffer. */
 struct Fio {
-	byte *buffer, *buffer_end;             ///< position pointer in local buffer and last valid byte of buffer
-	size_t pos;                            ///< current (system) position in file
-	FILE *cur_fh;                          ///< current file handle
-	const char *filename;                  ///< current filename
 	FILE *handles[MAX_FILE_SLOTS];         ///< array of file handles we can have open
-	byte buffer_start[FIO_BUFFER_SIZE];    ///< local buffer when read from file
 	const char *filenames[MAX_FILE_SLOTS]; ///< array of filenames we (should) have open
 	char *shortnames[MAX_FILE_SLOTS];      ///< array of short names for spriteloader's use
+#ifdef WITH_MMAP_FIO
+	byte *maps[MAX_FILE_SLOTS];            ///< array of files mapped into memory, or \c nullptr
+	size_t map_sizes[MAX_FILE_SLOTS];      ///< array of the sizes of the mapped files
+#endif /* WITH_MMAP_FIO */
 #if defined(LIMITED_FDS)
 	uint open_handles;                     ///< current amount of open handles
 	uint usage_count[MAX_FILE_SLOTS];      ///< count how many times this file has been opened
 #endif /* LIMITED_FDS */
 };
 
+/**
+ * Read position in the current file of #Fio.
+ * Every thread has its own, so files that are mapped into memory can be read by multiple threads.
+ */
+struct FioReader {
+	byte *buffer, *buffer_end;             ///< position pointer in local buffer and last valid byte of buffer
+	size_t pos;                            ///< current (system) position in file
+	FILE *cur_fh;                          ///< current file handle
+	const char *filename;                  ///< current filename
+	byte buffer_start[FIO_BUFFER_SIZE];    ///< local buffer when read from file
+#ifdef WITH_MMAP_FIO
+	byte *cur_map;                         ///< the current file mapped into memory, or \c nullptr when it is read into the buffer
+	size_t cur_map_size;                   ///< size of the current mapped file
+#endif /* WITH_MMAP_FIO */
+};
+
 static Fio _fio; ///< #Fio instance.
+static thread_local FioReader _fio_reader; ///< #FioReader instance of this thread.
 
 /** Whether the working directory should be scanned. */
 static bool _do_scan_working_directory = true;
@@ -65,7 +86,7 @@ extern char *_highscore_file;
  */
 size_t FioGetPos()
 {
-	return _fio.pos + (_fio.buffer - _fio.buffer_end);
+	return _fio_reader.pos + (_fio_reader.buffer - _fio_reader.buffer_end);
 }
 
 /**
@@ -78,6 +99,20 @@ const char *FioGetFilename(uint8 slot)
 	return _fio.shortnames[slot];
 }
 
+/**
+ * Check whether a slot can be read from other threads than the main thread.
+ * @param slot Index of queried file.
+ * @return True iff the file is mapped into memory, so threads do not share a file position.
+ */
+bool FioCanReadConcurrently(uint8 slot)
+{
+#ifdef WITH_MMAP_FIO
+	return _fio.maps[slot] != nullptr;
+#else
+	return false;
+#endif /* WITH_MMAP_FIO */
+}
+
 /**
  * Seek in the current file.
  * @param pos New position.
@@ -86,10 +121,19 @@ const char *FioGetFilename(uint8 slot)
 void FioSeekTo(size_t pos, int mode)
 {
 	if (mode == SEEK_CUR) pos += FioGetPos();
-	_fio.buffer = _fio.buffer_end = _fio.buffer_start + FIO_BUFFER_SIZE;
-	_fio.pos = pos;
-	if (fseek(_fio.cur_fh, _fio.pos, SEEK_SET) < 0) {
-		DEBUG(misc, 0, "Seeking in %s failed", _fio.filename);
+#ifdef WITH_MMAP_FIO
+	if (_fio_reader.cur_map != nullptr) {
+		/* The whole file is the buffer, so seeking only moves the read position. */
+		_fio_reader.buffer = _fio_reader.cur_map + min(pos, _fio_reader.cur_map_size);
+		_fio_reader.buffer_end = _fio_reader.cur_map + _fio_reader.cur_map_size;
+		_fio_reader.pos = _fio_reader.cur_map_size;
+		return;
+	}
+#endif /* WITH_MMAP_FIO */
+	_fio_reader.buffer = _fio_reader.buffer_end = _fio_reader.buffer_start + FIO_BUFFER_SIZE;
+	_fio_reader.pos = pos;
+	if (fseek(_fio_reader.cur_fh, _fio_reader.pos, SEEK_SET) < 0) {
+		DEBUG(misc, 0, "Seeking in %s failed", _fio_reader.filename);
 	}
 }
 
@@ -119,8 +163,12 @@ void FioSeekToFile(uint8 slot, size_t pos)
 #endif /* LIMITED_FDS */
 	f = _fio.handles[slot];
 	assert(f != nullptr);
-	_fio.cur_fh = f;
-	_fio.filename = _fio.filenames[slot];
+	_fio_reader.cur_fh = f;
+	_fio_reader.filename = _fio.filenames[slot];
+#ifdef WITH_MMAP_FIO
+	_fio_reader.cur_map = _fio.maps[slot];
+	_fio_reader.cur_map_size = _fio.map_sizes[slot];
+#endif /* WITH_MMAP_FIO */
 	FioSeekTo(pos, SEEK_SET);
 }
 
@@ -130,15 +178,19 @@ void FioSeekToFile(uint8 slot, size_t pos)
  */
 byte FioReadByte()
 {
-	if (_fio.buffer == _fio.buffer_end) {
-		_fio.buffer = _fio.buffer_start;
-		size_t size = fread(_fio.buffer, 1, FIO_BUFFER_SIZE, _fio.cur_fh);
-		_fio.pos += size;
-		_fio.buffer_end = _fio.buffer_start + size;
+	if (_fio_reader.buffer == _fio_reader.buffer_end) {
+#ifdef WITH_MMAP_FIO
+		/* A mapped file is read completely. */
+		if (_fio_reader.cur_map != nullptr) return 0;
+#endif /* WITH_MMAP_FIO */
+		_fio_reader.buffer = _fio_reader.buffer_start;
+		size_t size = fread(_fio_reader.buffer, 1, FIO_BUFFER_SIZE, _fio_reader.cur_fh);
+		_fio_reader.pos += size;
+		_fio_reader.buffer_end = _fio_reader.buffer_start + size;
 
 		if (size == 0) return 0;
 	}
-	return *_fio.buffer++;
+	return *_fio_reader.buffer++;
 }
 
 /**
@@ -148,8 +200,8 @@ byte FioReadByte()
 void FioSkipBytes(int n)
 {
 	for (;;) {
-		int m = min(_fio.buffer_end - _fio.buffer, n);
-		_fio.buffer += m;
+		int m = min(_fio_reader.buffer_end - _fio_reader.buffer, n);
+		_fio_reader.buffer += m;
 		n -= m;
 		if (n == 0) break;
 		FioReadByte();
@@ -184,8 +236,22 @@ uint32 FioReadDword()
  */
 void FioReadBlock(void *ptr, size_t size)
 {
-	FioSeekTo(FioGetPos(), SEEK_SET);
-	_fio.pos += fread(ptr, 1, size, _fio.cur_fh);
+	/* Use what is left in the buffer first; for a mapped file that is the rest of the file. */
+	size_t buffered = min<size_t>(_fio_reader.buffer_end - _fio_reader.buffer, size);
+	memcpy(ptr, _fio_reader.buffer, buffered);
+	_fio_reader.buffer += buffered;
+	size -= buffered;
+	if (size == 0) return;
+#ifdef WITH_MMAP_FIO
+	if (_fio_reader.cur_map != nullptr) {
+		/* Reading beyond the end of a mapped file, like FioReadByte. */
+		memset((byte *)ptr + buffered, 0, size);
+		return;
+	}
+#endif /* WITH_MMAP_FIO */
+
+	/* The buffer is empty now, so the file is at the current position. */
+	_fio_reader.pos += fread((byte *)ptr + buffered, 1, size, _fio_reader.cur_fh);
 }
 
 /**
@@ -197,6 +263,12 @@ static inline void FioCloseFile(int slot)
 	if (_fio.handles[slot] != nullptr) {
 		fclose(_fio.handles[slot]);
 
+#ifdef WITH_MMAP_FIO
+		if (_fio.maps[slot] != nullptr) munmap(_fio.maps[slot], _fio.map_sizes[slot]);
+		if (_fio_reader.cur_map == _fio.maps[slot]) _fio_reader.cur_map = nullptr;
+		_fio.maps[slot] = nullptr;
+#endif /* WITH_MMAP_FIO */
+
 		free(_fio.shortnames[slot]);
 		_fio.shortnames[slot] = nullptr;
 
@@ -261,6 +333,20 @@ void FioOpenFile(int slot, const char *filename, Subdirectory subdir)
 	_fio.handles[slot] = f;
 	_fio.filenames[slot] = filename;
 
+#ifdef WITH_MMAP_FIO
+	/* Map the file, so reading sprites does not seek and copy through the buffer,
+	 * but reads from the page cache directly. Only with 64 bits there is enough
+	 * address space to map all NewGRFs at once. */
+	struct stat st;
+	if (sizeof(void *) >= 8 && fstat(fileno(f), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+		if (map != MAP_FAILED) {
+			_fio.maps[slot] = (byte *)map;
+			_fio.map_sizes[slot] = st.st_size;
+		}
+	}
+#endif /* WITH_MMAP_FIO */
+
 	/* Store the filename without path and extension */
 	const char *t = strrchr(filename, PATHSEPCHAR);
 	_fio.shortnames[slot] = stredup(t == nullptr ? filename : t);
@@ -1202,6 +1288,10 @@ void DeterminePaths(const char *exe)
 	_hotkeys_file = str_fmt("%shotkeys.cfg", config_dir);
 	extern char *_windows_file;
 	_windows_file = str_fmt("%swindows.cfg", config_dir);
+	extern char *_newgrf_scan_cache_file;
+	_newgrf_scan_cache_file = str_fmt("%snewgrf_scan.cfg", config_dir);
+	extern char *_baseset_md5_cache_file;
+	_baseset_md5_cache_file = str_fmt("%sbaseset_md5.cfg", config_dir);
 
 #if defined(WITH_XDG_BASEDIR) && defined(WITH_PERSONAL_DIR)
 	if (config_dir == config_home) {
@@ -1247,6 +1337,12 @@ void DeterminePaths(const char *exe)
 
 	extern char *_log_file;
 	_log_file = str_fmt("%sopenttd.log",  _personal_dir);
+
+	extern char *_sprite_disk_cache_dir;
+	_sprite_disk_cache_dir = str_fmt("%ssprite_cache" PATHSEP, _personal_dir);
+
+	extern char *_script_bytecode_cache_dir;
+	_script_bytecode_cache_dir = str_fmt("%sscript_cache" PATHSEP, _personal_dir);
 }
 
 /**
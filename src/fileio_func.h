@@ -17,6 +17,7 @@ void FioSeekTo(size_t pos, int mode);
 void FioSeekToFile(uint8 slot, size_t pos);
 size_t FioGetPos();
 const char *FioGetFilename(uint8 slot);
+bool FioCanReadConcurrently(uint8 slot);
 byte FioReadByte();
 uint16 FioReadWord();
 uint32 FioReadDword();
@@ -19,6 +19,8 @@
 #include "string_func.h"
 #include "tar_type.h"
 #include <sys/stat.h>
+#include <unordered_map>
+#include <unordered_set>
 
 #ifndef _WIN32
 # include <unistd.h>
@@ -267,6 +269,7 @@ class FiosFileScanner : public FileScanner {
 	SaveLoadOperation fop;   ///< The kind of file we are looking for.
 	fios_getlist_callback_proc *callback_proc; ///< Callback to check whether the file may be added
 	FileList &file_list;     ///< Destination of the found files.
+	std::unordered_set<std::string> names; ///< Names of the files in #file_list.
 public:
 	/**
 	 * Create the scanner
@@ -276,33 +279,37 @@ public:
 	 */
 	FiosFileScanner(SaveLoadOperation fop, fios_getlist_callback_proc *callback_proc, FileList &file_list) :
 			fop(fop), callback_proc(callback_proc), file_list(file_list)
-	{}
+	{
+		for (const FiosItem *fios = file_list.Begin(); fios != file_list.End(); fios++) this->names.insert(fios->name);
+	}
 
 	bool AddFile(const char *filename, size_t basepath_length, const char *tar_filename) override;
 };
 
 /**
- * Try to add a fios item set with the given filename.
- * @param filename        the full path to the file to read
- * @param basepath_length amount of characters to chop of before to get a relative filename
- * @return true if the file is added.
+ * Result of checking a file with a #fios_getlist_callback_proc. The callbacks
+ * may open the file, or look for a file with its title, so the result is kept
+ * for as long as the file is not modified.
  */
-bool FiosFileScanner::AddFile(const char *filename, size_t basepath_length, const char *tar_filename)
-{
-	const char *ext = strrchr(filename, '.');
-	if (ext == nullptr) return false;
-
-	char fios_title[64];
-	fios_title[0] = '\0'; // reset the title;
-
-	FiosType type = this->callback_proc(this->fop, filename, ext, fios_title, lastof(fios_title));
-	if (type == FIOS_TYPE_INVALID) return false;
+struct FiosScanCacheItem {
+	uint64 mtime;                              ///< Modification time of the file when it was checked.
+	SaveLoadOperation fop;                     ///< Purpose of the list it was checked for.
+	fios_getlist_callback_proc *callback_proc; ///< Callback that checked the file.
+	FiosType type;                             ///< Type of the file, as returned by the callback.
+	char title[64];                            ///< Title of the file, as returned by the callback.
+};
 
-	for (const FiosItem *fios = file_list.Begin(); fios != file_list.End(); fios++) {
-		if (strcmp(fios->name, filename) == 0) return false;
-	}
+/** Results of checking files, by full path of the file. */
+static std::unordered_map<std::string, FiosScanCacheItem> _fios_scan_cache;
 
-	FiosItem *fios = file_list.Append();
+/**
+ * Get the time a file was last modified.
+ * @param filename The full path to the file.
+ * @return Seconds since 01/01/1970, or 0 when unknown.
+ */
+static uint64 GetFileModificationTime(const char *filename)
+{
+	uint64 mtime = 0;
 #ifdef _WIN32
 	// Retrieve the file modified date using GetFileTime rather than stat to work around an obscure MSVC bug that affects Windows XP
 	HANDLE fh = CreateFile(OTTD2FS(filename), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr);
@@ -316,27 +323,54 @@ bool FiosFileScanner::AddFile(const char *filename, size_t basepath_length, cons
 			ft_int64.LowPart = ft.dwLowDateTime;
 
 			// Convert from hectonanoseconds since 01/01/1601 to seconds since 01/01/1970
-			fios->mtime = ft_int64.QuadPart / 10000000ULL - 11644473600ULL;
-		} else {
-			fios->mtime = 0;
+			mtime = ft_int64.QuadPart / 10000000ULL - 11644473600ULL;
 		}
 
 		CloseHandle(fh);
+	}
 #else
 	struct stat sb;
-	if (stat(filename, &sb) == 0) {
-		fios->mtime = sb.st_mtime;
+	if (stat(filename, &sb) == 0) mtime = sb.st_mtime;
 #endif
-	} else {
-		fios->mtime = 0;
+	return mtime;
+}
+
+/**
+ * Try to add a fios item set with the given filename.
+ * @param filename        the full path to the file to read
+ * @param basepath_length amount of characters to chop of before to get a relative filename
+ * @return true if the file is added.
+ */
+bool FiosFileScanner::AddFile(const char *filename, size_t basepath_length, const char *tar_filename)
+{
+	const char *ext = strrchr(filename, '.');
+	if (ext == nullptr) return false;
+
+	uint64 mtime = GetFileModificationTime(filename);
+
+	/* Reuse the result of the callback when the file did not change since it was last checked. */
+	FiosScanCacheItem &cached = _fios_scan_cache[filename];
+	if (mtime == 0 || cached.mtime != mtime || cached.fop != this->fop || cached.callback_proc != this->callback_proc) {
+		cached.mtime = mtime;
+		cached.fop = this->fop;
+		cached.callback_proc = this->callback_proc;
+		cached.title[0] = '\0'; // reset the title;
+		cached.type = this->callback_proc(this->fop, filename, ext, cached.title, lastof(cached.title));
 	}
 
+	FiosType type = cached.type;
+	if (type == FIOS_TYPE_INVALID) return false;
+
+	if (!this->names.insert(filename).second) return false;
+
+	FiosItem *fios = file_list.Append();
+	fios->mtime = mtime;
 	fios->type = type;
 	strecpy(fios->name, filename, lastof(fios->name));
 
 	/* If the file doesn't have a title, use its filename */
-	const char *t = fios_title;
-	if (StrEmpty(fios_title)) {
+	const char *t = cached.title;
+	if (StrEmpty(cached.title)) {
 		t = strrchr(filename, PATHSEPCHAR);
 		t = (t == nullptr) ? filename : (t + 1);
 	}
@@ -9,6 +9,7 @@
 
 #include "framerate_type.h"
 #include <chrono>
+#include <vector>
 #include "gfx_func.h"
 #include "window_gui.h"
 #include "window_func.h"
@@ -17,7 +18,9 @@
 #include "strings_func.h"
 #include "console_func.h"
 #include "console_type.h"
+#include "debug.h"
 #include "guitimer_func.h"
+#include "settings_type.h"
 #include "company_base.h"
 #include "ai/ai_info.hpp"
 #include "ai/ai_instance.hpp"
@@ -59,6 +62,15 @@ namespace {
 		TimingMeasurement acc_duration;
 		/** Start time for current accumulation cycle */
 		TimingMeasurement acc_timestamp;
+		/** Longest single block of the current accumulation cycle */
+		TimingMeasurement acc_slowest_duration;
+		/** What the longest single block of the current accumulation cycle was processing, see #PerformanceAccumulator */
+		uint32 acc_slowest_subject;
+
+		/** Time spent processing the element since the totals were reset, see #ResetPerformanceTotals */
+		TimingMeasurement total_duration;
+		/** Number of cycles of the element since the totals were reset */
+		uint total_count;
 
 		/**
 		 * Initialize a data element with an expected collection rate
@@ -66,7 +78,7 @@ namespace {
 		 * Expected number of cycles per second of the performance element. Use 1 if unknown or not relevant.
 		 * The rate is used for highlighting slow-running elements in the GUI.
 		 */
-		explicit PerformanceData(double expected_rate) : expected_rate(expected_rate), next_index(0), prev_index(0), num_valid(0) { }
+		explicit PerformanceData(double expected_rate) : expected_rate(expected_rate), next_index(0), prev_index(0), num_valid(0), total_duration(0), total_count(0) { }
 
 		/** Collect a complete measurement, given start and ending times for a processing block */
 		void Add(TimingMeasurement start_time, TimingMeasurement end_time)
@@ -77,6 +89,9 @@ namespace {
 			this->next_index += 1;
 			if (this->next_index >= NUM_FRAMERATE_POINTS) this->next_index = 0;
 			this->num_valid = min(NUM_FRAMERATE_POINTS, this->num_valid + 1);
+
+			this->total_duration += end_time - start_time;
+			this->total_count++;
 		}
 
 		/** Begin an accumulation of multiple measurements into a single value, from a given start time */
@@ -91,12 +106,49 @@ namespace {
 
 			this->acc_duration = 0;
 			this->acc_timestamp = start_time;
+			this->acc_slowest_duration = 0;
+			this->acc_slowest_subject = PerformanceAccumulator::NO_SUBJECT;
+			this->total_count++;
 		}
 
-		/** Accumulate a period onto the current measurement */
-		void AddAccumulate(TimingMeasurement duration)
+		/** Accumulate a period onto the current measurement, and remember the subject of the longest period */
+		void AddAccumulate(TimingMeasurement duration, uint32 subject)
 		{
 			this->acc_duration += duration;
+			this->total_duration += duration;
+			if (subject != PerformanceAccumulator::NO_SUBJECT && duration > this->acc_slowest_duration) {
+				this->acc_slowest_duration = duration;
+				this->acc_slowest_subject = subject;
+			}
+		}
+
+		/**
+		 * Get the time spent on the element during the cycle of an enclosing element, e.g. during a single game tick.
+		 * @param cycle_start Start time of the enclosing cycle, which has not finished yet.
+		 * @return The time spent on the element since the start of the enclosing cycle.
+		 */
+		TimingMeasurement GetDurationSince(TimingMeasurement cycle_start) const
+		{
+			/* Accumulations are stored when the next cycle starts, so this cycle's is still running. */
+			if (this->acc_timestamp >= cycle_start) return this->acc_duration;
+			if (this->num_valid > 0 && this->timestamps[this->prev_index] >= cycle_start && this->durations[this->prev_index] != INVALID_DURATION) {
+				return this->durations[this->prev_index];
+			}
+			return 0;
+		}
+
+		/**
+		 * Get all recorded durations, leaving out the pauses.
+		 * @param[out] durations The durations, from the most recent one backwards.
+		 */
+		void GetValidDurations(std::vector<TimingMeasurement> &durations) const
+		{
+			durations.clear();
+			durations.reserve(this->num_valid);
+			for (int i = 0; i < this->num_valid; i++) {
+				TimingMeasurement d = this->durations[(this->prev_index - i + NUM_FRAMERATE_POINTS) % NUM_FRAMERATE_POINTS];
+				if (d != INVALID_DURATION) durations.push_back(d);
+			}
 		}
 
 		/** Indicate a pause/expected discontinuity in processing the element */
@@ -185,6 +237,24 @@ namespace {
 		PerformanceData(1),                     // PFE_ACC_GL_AIRCRAFT
 		PerformanceData(1),                     // PFE_GL_LANDSCAPE
 		PerformanceData(1),                     // PFE_GL_LINKGRAPH
+		PerformanceData(1),                     // PFE_GL_DAYPROC
+		PerformanceData(1),                     // PFE_GL_YAPF_TRAINS
+		PerformanceData(1),                     // PFE_GL_YAPF_ROADVEHS
+		PerformanceData(1),                     // PFE_GL_YAPF_SHIPS
+		PerformanceData(1),                     // PFE_GL_TOWNS
+		PerformanceData(1),                     // PFE_GL_INDUSTRIES
+		PerformanceData(1),                     // PFE_GL_STATIONS
+		PerformanceData(1),                     // PFE_GL_TILELOOP_CLEAR ...
+		PerformanceData(1),
+		PerformanceData(1),
+		PerformanceData(1),
+		PerformanceData(1),
+		PerformanceData(1),
+		PerformanceData(1),
+		PerformanceData(1),
+		PerformanceData(1),
+		PerformanceData(1),
+		PerformanceData(1),                     // PFE_GL_TILELOOP_OBJECT
 		PerformanceData(GL_RATE),               // PFE_DRAWING
 		PerformanceData(1),                     // PFE_ACC_DRAWWORLD
 		PerformanceData(60.0),                  // PFE_VIDEO
@@ -223,6 +293,125 @@ static TimingMeasurement GetPerformanceTimer()
 }
 
 
+/**
+ * Check whether an element is a detailed element that is currently not measured.
+ * @param elem The element to check.
+ * @return True if the element must not be measured.
+ */
+static inline bool IsDisabledDetail(PerformanceElement elem)
+{
+	return elem >= PFE_GL_DETAIL_FIRST && elem <= PFE_GL_DETAIL_LAST && !_settings_client.gui.framerate_details;
+}
+
+/** Names of the performance elements in console output and the debug log; the indentation shows which elements are part of which. */
+static const char * const MEASUREMENT_NAMES[PFE_MAX] = {
+	"Game loop",
+	"  GL station ticks",
+	"  GL train ticks",
+	"  GL road vehicle ticks",
+	"  GL ship ticks",
+	"  GL aircraft ticks",
+	"  GL landscape ticks",
+	"  GL link graph delays",
+	"    GL vehicle daily processing",
+	"    GL train pathfinding",
+	"    GL road vehicle pathfinding",
+	"    GL ship pathfinding",
+	"    GL towns",
+	"    GL industries",
+	"    GL stations",
+	"    GL tile loop: clear",
+	"    GL tile loop: rail",
+	"    GL tile loop: road",
+	"    GL tile loop: houses",
+	"    GL tile loop: trees",
+	"    GL tile loop: stations",
+	"    GL tile loop: water",
+	"    GL tile loop: void",
+	"    GL tile loop: industries",
+	"    GL tile loop: tunnels/bridges",
+	"    GL tile loop: objects",
+	"Drawing",
+	"  Viewport drawing",
+	"Video output",
+	"Sound mixing",
+	"AI/GS scripts total",
+	"Game script",
+};
+
+/** Minimum time between two slow tick reports, so a game where every tick is slow does not flood the log. */
+static const TimingMeasurement SLOW_TICK_REPORT_INTERVAL = 10 * TIMESTAMP_PRECISION;
+static TimingMeasurement _slow_tick_last_report = 0; ///< Time of the last slow tick report.
+static uint _slow_tick_unreported = 0;               ///< Number of slow ticks since the last report that were not reported.
+
+/**
+ * Get what the subject of the blocks of an element is.
+ * @param elem The element.
+ * @return The kind of item the subject refers to, or \c nullptr if the element has no subjects.
+ */
+static const char *GetSubjectKind(PerformanceElement elem)
+{
+	switch (elem) {
+		case PFE_GL_TRAINS:
+		case PFE_GL_ROADVEHS:
+		case PFE_GL_SHIPS:
+		case PFE_GL_AIRCRAFT:
+		case PFE_GL_YAPF_TRAINS:
+		case PFE_GL_YAPF_ROADVEHS:
+		case PFE_GL_YAPF_SHIPS:   return "vehicle";
+		case PFE_GL_TOWNS:        return "town";
+		case PFE_GL_INDUSTRIES:   return "industry";
+		case PFE_GL_STATIONS:     return "station";
+		default:                  return nullptr;
+	}
+}
+
+/**
+ * Write a report of a game tick that took longer than the slow tick threshold to the debug log,
+ * which also reaches the consoles of admins. It lists the slowest parts of the tick, and for those
+ * processing individual items the item that took longest.
+ * @param start_time Start of the game tick.
+ * @param end_time End of the game tick.
+ */
+static void ReportSlowTick(TimingMeasurement start_time, TimingMeasurement end_time)
+{
+	TimingMeasurement duration = end_time - start_time;
+	if (duration < (TimingMeasurement)_settings_client.gui.slow_tick_threshold * TIMESTAMP_PRECISION / 1000) return;
+
+	if (_slow_tick_last_report != 0 && end_time - _slow_tick_last_report < SLOW_TICK_REPORT_INTERVAL) {
+		_slow_tick_unreported++;
+		return;
+	}
+	_slow_tick_last_report = end_time;
+
+	DEBUG(misc, 0, "[slowtick] Game tick took %.2f ms (%u slow ticks not reported since the last report)", duration * 1000.0 / TIMESTAMP_PRECISION, _slow_tick_unreported);
+	_slow_tick_unreported = 0;
+
+	std::vector<std::pair<TimingMeasurement, PerformanceElement>> parts;
+	for (PerformanceElement e = PFE_GL_ECONOMY; e <= PFE_GL_DETAIL_LAST; e++) {
+		TimingMeasurement d = _pf_data[e].GetDurationSince(start_time);
+		if (d > 0) parts.emplace_back(d, e);
+	}
+	std::sort(parts.begin(), parts.end(), [](const std::pair<TimingMeasurement, PerformanceElement> &a, const std::pair<TimingMeasurement, PerformanceElement> &b) {
+		return a.first > b.first;
+	});
+	if (parts.size() > 5) parts.resize(5);
+
+	for (const auto &part : parts) {
+		const PerformanceData &pf = _pf_data[part.second];
+		const char *name = MEASUREMENT_NAMES[part.second];
+		while (*name == ' ') name++;
+
+		const char *kind = GetSubjectKind(part.second);
+		if (kind != nullptr && pf.acc_timestamp >= start_time && pf.acc_slowest_subject != PerformanceAccumulator::NO_SUBJECT) {
+			DEBUG(misc, 0, "[slowtick]   %s: %.2f ms, slowest %s %u: %.2f ms", name, part.first * 1000.0 / TIMESTAMP_PRECISION,
+					kind, pf.acc_slowest_subject, pf.acc_slowest_duration * 1000.0 / TIMESTAMP_PRECISION);
+		} else {
+			DEBUG(misc, 0, "[slowtick]   %s: %.2f ms", name, part.first * 1000.0 / TIMESTAMP_PRECISION);
+		}
+	}
+}
+
 /**
  * Begin a cycle of a measured element.
  * @param elem The element to be measured
@@ -247,7 +436,10 @@ PerformanceMeasurer::~PerformanceMeasurer()
 			return;
 		}
 	}
-	_pf_data[this->elem].Add(this->start_time, GetPerformanceTimer());
+	TimingMeasurement end_time = GetPerformanceTimer();
+	_pf_data[this->elem].Add(this->start_time, end_time);
+
+	if (this->elem == PFE_GAMELOOP && _settings_client.gui.slow_tick_threshold != 0) ReportSlowTick(this->start_time, end_time);
 }
 
 /** Set the rate of expected cycles per second of a performance element. */
@@ -270,6 +462,7 @@ void PerformanceMeasurer::SetExpectedRate(double rate)
  */
 /* static */ void PerformanceMeasurer::Paused(PerformanceElement elem)
 {
+	if (IsDisabledDetail(elem)) return;
 	_pf_data[elem].AddPause(GetPerformanceTimer());
 }
 
@@ -277,11 +470,18 @@ void PerformanceMeasurer::SetExpectedRate(double rate)
 /**
  * Begin measuring one block of the accumulating value.
  * @param elem The element to be measured
+ * @param subject What the block processes, like the index of a vehicle or town. The subject of the
+ *                longest block of a tick is mentioned in slow tick reports; #NO_SUBJECT when not relevant.
  */
-PerformanceAccumulator::PerformanceAccumulator(PerformanceElement elem)
+PerformanceAccumulator::PerformanceAccumulator(PerformanceElement elem, uint32 subject) : subject(subject)
 {
 	assert(elem < PFE_MAX);
 
+	if (IsDisabledDetail(elem)) {
+		this->elem = PFE_MAX;
+		return;
+	}
+
 	this->elem = elem;
 	this->start_time = GetPerformanceTimer();
 }
@@ -289,7 +489,9 @@ PerformanceAccumulator::PerformanceAccumulator(PerformanceElement elem)
 /** Finish and add one block of the accumulating value. */
 PerformanceAccumulator::~PerformanceAccumulator()
 {
-	_pf_data[this->elem].AddAccumulate(GetPerformanceTimer() - this->start_time);
+	if (this->elem == PFE_MAX) return;
+
+	_pf_data[this->elem].AddAccumulate(GetPerformanceTimer() - this->start_time, this->subject);
 }
 
 /**
@@ -299,21 +501,79 @@ PerformanceAccumulator::~PerformanceAccumulator()
  */
 void PerformanceAccumulator::Reset(PerformanceElement elem)
 {
+	if (IsDisabledDetail(elem)) {
+		/* Hide the element once measuring it has been disabled. */
+		if (_pf_data[elem].num_valid > 0) PerformanceMeasurer::SetInactive(elem);
+		return;
+	}
+
 	_pf_data[elem].BeginAccumulate(GetPerformanceTimer());
 }
 
+/** Reset all detailed game loop elements for a new cycle of accumulating measurements. */
+/* static */ void PerformanceAccumulator::ResetDetails()
+{
+	for (PerformanceElement e = PFE_GL_DETAIL_FIRST; e <= PFE_GL_DETAIL_LAST; e++) {
+		PerformanceAccumulator::Reset(e);
+	}
+}
+
+/**
+ * Get the distribution of the recently measured durations of a performance element.
+ * @param elem The element to get the durations of.
+ * @param[out] average The average duration, in microseconds.
+ * @param[out] p99 The duration 99% of the measurements did not exceed, in microseconds.
+ * @return False if the element has not been measured recently.
+ */
+bool GetPerformanceDurations(PerformanceElement elem, uint64 *average, uint64 *p99)
+{
+	assert(elem < PFE_MAX);
+	const PerformanceData &pf = _pf_data[elem];
+
+	std::vector<TimingMeasurement> durations;
+	pf.GetValidDurations(durations);
+	if (durations.empty()) return false;
+
+	TimingMeasurement sum = 0;
+	for (TimingMeasurement d : durations) sum += d;
+	*average = sum * 1000000 / TIMESTAMP_PRECISION / durations.size();
+
+	auto nth = durations.begin() + (durations.size() * 99 + 99) / 100 - 1;
+	std::nth_element(durations.begin(), nth, durations.end());
+	*p99 = *nth * 1000000 / TIMESTAMP_PRECISION;
+	return true;
+}
+
 
 void ShowFrametimeGraphWindow(PerformanceElement elem);
 
 
 static const PerformanceElement DISPLAY_ORDER_PFE[PFE_MAX] = {
 	PFE_GAMELOOP,
+	PFE_GL_DAYPROC,
 	PFE_GL_ECONOMY,
 	PFE_GL_TRAINS,
+	PFE_GL_YAPF_TRAINS,
 	PFE_GL_ROADVEHS,
+	PFE_GL_YAPF_ROADVEHS,
 	PFE_GL_SHIPS,
+	PFE_GL_YAPF_SHIPS,
 	PFE_GL_AIRCRAFT,
 	PFE_GL_LANDSCAPE,
+	PFE_GL_TOWNS,
+	PFE_GL_INDUSTRIES,
+	PFE_GL_STATIONS,
+	PFE_GL_TILELOOP_CLEAR,
+	PFE_GL_TILELOOP_RAILWAY,
+	PFE_GL_TILELOOP_ROAD,
+	PFE_GL_TILELOOP_HOUSE,
+	PFE_GL_TILELOOP_TREES,
+	PFE_GL_TILELOOP_STATION,
+	PFE_GL_TILELOOP_WATER,
+	PFE_GL_TILELOOP_VOID,
+	PFE_GL_TILELOOP_INDUSTRY,
+	PFE_GL_TILELOOP_TUNNELBRIDGE,
+	PFE_GL_TILELOOP_OBJECT,
 	PFE_ALLSCRIPTS,
 	PFE_GAMESCRIPT,
 	PFE_AI0,
@@ -1022,22 +1282,6 @@ void ConPrintFramerate()
 
 	IConsolePrintF(TC_SILVER, "Based on num. data points: %d %d %d", count1, count2, count3);
 
-	static const char *MEASUREMENT_NAMES[PFE_MAX] = {
-		"Game loop",
-		"  GL station ticks",
-		"  GL train ticks",
-		"  GL road vehicle ticks",
-		"  GL ship ticks",
-		"  GL aircraft ticks",
-		"  GL landscape ticks",
-		"  GL link graph delays",
-		"Drawing",
-		"  Viewport drawing",
-		"Video output",
-		"Sound mixing",
-		"AI/GS scripts total",
-		"Game script",
-	};
 	char ai_name_buf[128];
 
 	static const PerformanceElement rate_elements[] = { PFE_GAMELOOP, PFE_DRAWING, PFE_VIDEO };
@@ -1076,3 +1320,85 @@ void ConPrintFramerate()
 		IConsoleWarning("No performance measurements have been taken yet");
 	}
 }
+
+/** Print the distribution of the recent durations of all performance elements to the game console. */
+void ConPrintFramePercentiles()
+{
+	static const uint PERCENTILES[] = { 50, 90, 99 };
+
+	IConsolePrintF(TC_SILVER, "Durations of the last %d measurements:        p50       p90       p99       max", NUM_FRAMERATE_POINTS);
+
+	std::vector<TimingMeasurement> durations;
+	char ai_name_buf[128];
+	bool printed_anything = false;
+
+	for (PerformanceElement e = PFE_FIRST; e < PFE_MAX; e++) {
+		_pf_data[e].GetValidDurations(durations);
+		if (durations.empty()) continue;
+		std::sort(durations.begin(), durations.end());
+
+		const char *name;
+		if (e < PFE_AI0) {
+			name = MEASUREMENT_NAMES[e];
+		} else {
+			seprintf(ai_name_buf, lastof(ai_name_buf), "AI %d %s", e - PFE_AI0 + 1, GetAIName(e - PFE_AI0));
+			name = ai_name_buf;
+		}
+
+		char buf[128];
+		char *p = buf;
+		for (uint percentile : PERCENTILES) {
+			TimingMeasurement d = durations[(durations.size() * percentile + 99) / 100 - 1];
+			p += seprintf(p, lastof(buf), "  %6.2fms", d * 1000.0 / TIMESTAMP_PRECISION);
+		}
+		seprintf(p, lastof(buf), "  %6.2fms", durations.back() * 1000.0 / TIMESTAMP_PRECISION);
+
+		IConsolePrintF(TC_LIGHT_BLUE, "%-44s%s", name, buf);
+		printed_anything = true;
+	}
+
+	if (!printed_anything) {
+		IConsoleWarning("No performance measurements have been taken yet");
+	}
+}
+
+/** Start counting the totals of all performance elements from zero, e.g. at the start of a benchmark. */
+void ResetPerformanceTotals()
+{
+	for (PerformanceData &pf : _pf_data) {
+		pf.total_duration = 0;
+		pf.total_count = 0;
+	}
+}
+
+/**
+ * Write the time spent on each performance element since the totals were reset.
+ * @param p Where to write.
+ * @param last The last character of the buffer.
+ * @param ticks The number of game ticks that ran since the totals were reset, to report the time per tick.
+ * @return The end of the written text.
+ */
+char *WritePerformanceTotals(char *p, const char *last, uint ticks)
+{
+	char ai_name_buf[128];
+
+	p += seprintf(p, last, "%-44s %12s %10s %12s\n", "Element", "total", "per tick", "cycles");
+	for (PerformanceElement e = PFE_FIRST; e < PFE_MAX; e++) {
+		const PerformanceData &pf = _pf_data[e];
+		if (pf.total_count == 0) continue;
+
+		const char *name;
+		if (e < PFE_AI0) {
+			name = MEASUREMENT_NAMES[e];
+		} else {
+			seprintf(ai_name_buf, lastof(ai_name_buf), "AI %d %s", e - PFE_AI0 + 1, GetAIName(e - PFE_AI0));
+			name = ai_name_buf;
+		}
+
+		p += seprintf(p, last, "%-44s %10.2fms %8.3fms %12u\n", name,
+				pf.total_duration * 1000.0 / TIMESTAMP_PRECISION,
+				ticks == 0 ? 0.0 : pf.total_duration * 1000.0 / TIMESTAMP_PRECISION / ticks,
+				pf.total_count);
+	}
+	return p;
+}
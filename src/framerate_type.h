@@ -18,7 +18,7 @@
  * Second is adding a member to the \link anonymous_namespace{framerate_gui.cpp}::_pf_data _pf_data \endlink array, in the same position as the new #PerformanceElement member.
  *
  * @par
- * Third is adding strings for the new element. There is an array in #ConPrintFramerate with strings used for the console command.
+ * Third is adding strings for the new element. There is an array \c MEASUREMENT_NAMES in framerate_gui.cpp with strings used for the console commands and the debug log.
  * Additionally, there are two sets of strings in \c english.txt for two GUI uses, also in the #PerformanceElement order.
  * Search for \c STR_FRAMERATE_GAMELOOP and \c STR_FRAMETIME_CAPTION_GAMELOOP in \c english.txt to find those.
  *
@@ -29,6 +29,10 @@
  * Either class is used by instantiating an object of it at the beginning of the block to be measured, so it auto-destructs at the end of the block.
  * For PerformanceAccumulator, make sure to also call PerformanceAccumulator::Reset once at the beginning of a new frame. Usually the StateGameLoop function is appropriate for this.
  *
+ * @par
+ * Elements between \c PFE_GL_DETAIL_FIRST and \c PFE_GL_DETAIL_LAST are only measured when the \c framerate_details setting is enabled,
+ * as they are measured often enough for the measuring itself to cost noticeable time.
+ *
  * @see framerate_gui.cpp for implementation
  */
 
@@ -54,6 +58,26 @@ enum PerformanceElement {
 	PFE_GL_AIRCRAFT,   ///< Time spent processing aircraft
 	PFE_GL_LANDSCAPE,  ///< Time spent processing other world features
 	PFE_GL_LINKGRAPH,  ///< Time spent waiting for link graph background jobs
+	PFE_GL_DETAIL_FIRST,                        ///< First of the detailed game loop elements, only measured when enabled.
+	PFE_GL_DAYPROC = PFE_GL_DETAIL_FIRST,       ///< Time spent in the daily processing of vehicles
+	PFE_GL_YAPF_TRAINS,                         ///< Time spent finding paths for trains
+	PFE_GL_YAPF_ROADVEHS,                       ///< Time spent finding paths for road vehicles
+	PFE_GL_YAPF_SHIPS,                          ///< Time spent finding paths for ships
+	PFE_GL_TOWNS,                               ///< Time spent in the periodic processing of towns
+	PFE_GL_INDUSTRIES,                          ///< Time spent in the periodic processing of industries
+	PFE_GL_STATIONS,                            ///< Time spent in the periodic processing of stations
+	PFE_GL_TILELOOP_CLEAR,                      ///< Time spent in the tile loop of clear tiles; the other tile types follow in #TileType order
+	PFE_GL_TILELOOP_RAILWAY,                    ///< Time spent in the tile loop of rail tiles
+	PFE_GL_TILELOOP_ROAD,                       ///< Time spent in the tile loop of road tiles
+	PFE_GL_TILELOOP_HOUSE,                      ///< Time spent in the tile loop of houses
+	PFE_GL_TILELOOP_TREES,                      ///< Time spent in the tile loop of trees
+	PFE_GL_TILELOOP_STATION,                    ///< Time spent in the tile loop of station tiles
+	PFE_GL_TILELOOP_WATER,                      ///< Time spent in the tile loop of water tiles
+	PFE_GL_TILELOOP_VOID,                       ///< Time spent in the tile loop of void tiles
+	PFE_GL_TILELOOP_INDUSTRY,                   ///< Time spent in the tile loop of industry tiles
+	PFE_GL_TILELOOP_TUNNELBRIDGE,               ///< Time spent in the tile loop of tunnels and bridges
+	PFE_GL_TILELOOP_OBJECT,                     ///< Time spent in the tile loop of objects
+	PFE_GL_DETAIL_LAST = PFE_GL_TILELOOP_OBJECT, ///< Last of the detailed game loop elements.
 	PFE_DRAWING,       ///< Speed of drawing world and GUI.
 	PFE_DRAWWORLD,     ///< Time spent drawing world viewports in GUI
 	PFE_VIDEO,         ///< Speed of painting drawn video buffer.
@@ -114,12 +138,19 @@ public:
 class PerformanceAccumulator {
 	PerformanceElement elem;
 	TimingMeasurement start_time;
+	uint32 subject;
 public:
-	PerformanceAccumulator(PerformanceElement elem);
+	static const uint32 NO_SUBJECT = UINT32_MAX; ///< Subject of blocks that do not process a specific item.
+
+	PerformanceAccumulator(PerformanceElement elem, uint32 subject = NO_SUBJECT);
 	~PerformanceAccumulator();
 	static void Reset(PerformanceElement elem);
+	static void ResetDetails();
 };
 
 void ShowFramerateWindow();
+bool GetPerformanceDurations(PerformanceElement elem, uint64 *average, uint64 *p99);
+void ResetPerformanceTotals();
+char *WritePerformanceTotals(char *p, const char *last, uint ticks);
 
 #endif /* FRAMERATE_TYPE_H */
@@ -14,6 +14,7 @@
 #include "../network/network.h"
 #include "../window_func.h"
 #include "../framerate_type.h"
+#include "../trace_zone.h"
 #include "game.hpp"
 #include "game_scanner.hpp"
 #include "game_config.hpp"
@@ -40,12 +41,16 @@
 	}
 
 	PerformanceMeasurer framerate(PFE_GAMESCRIPT);
+	TraceZone zone("Game script");
 
 	Game::frame_counter++;
 
 	Backup<CompanyID> cur_company(_current_company, FILE_LINE);
 	cur_company.Change(OWNER_DEITY);
 	Game::instance->GameLoop();
+	/* Whatever the AIs left unused this tick can go to the game script. */
+	Game::instance->ContinueWithSpareOps();
+	ScriptInstance::ResetSpareOps();
 	cur_company.Restore();
 
 	/* Occasionally collect garbage */
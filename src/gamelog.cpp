@@ -404,6 +404,10 @@ void GamelogEmergency()
 {
 	/* Terminate any active action */
 	if (_gamelog_action_type != GLAT_NONE) GamelogStopAction();
+
+	/* Nothing happened since the previous emergency savegame, so one entry suffices. */
+	if (_gamelog_actions > 0 && _gamelog_action[_gamelog_actions - 1].at == GLAT_EMERGENCY) return;
+
 	GamelogStartAction(GLAT_EMERGENCY);
 	GamelogChange(GLCT_EMERGENCY);
 	GamelogStopAction();
@@ -482,6 +486,26 @@ void GamelogSetting(const char *name, int32 oldval, int32 newval)
 {
 	assert(_gamelog_action_type == GLAT_SETTING);
 
+	/* When the previous action changed the same setting to the value that is
+	 * now changed again, e.g. when toggling a setting on a server, merge both
+	 * changes into one; or drop it when the setting is back at its old value. */
+	if (_current_action == nullptr && _gamelog_actions > 0) {
+		LoggedAction *la = &_gamelog_action[_gamelog_actions - 1];
+		LoggedChange *prev = la->change;
+		if (la->at == GLAT_SETTING && la->changes == 1 && prev->ct == GLCT_SETTING &&
+				prev->setting.newval == oldval && strcmp(prev->setting.name, name) == 0) {
+			if (prev->setting.oldval == newval) {
+				free(prev->setting.name);
+				free(la->change);
+				_gamelog_actions--;
+				return;
+			}
+			prev->setting.newval = newval;
+			la->tick = _tick_counter;
+			return;
+		}
+	}
+
 	LoggedChange *lc = GamelogChange(GLCT_SETTING);
 	if (lc == nullptr) return;
 
@@ -33,6 +33,7 @@
 #include "game/game_instance.hpp"
 #include "string_func.h"
 #include "thread.h"
+#include <chrono>
 
 #include "safeguards.h"
 
@@ -59,6 +60,52 @@ GenWorldInfo _gw;
 /** Whether we are generating the map or not. */
 bool _generating_world;
 
+static uint64 _gw_stage_time[GWP_CLASS_COUNT];         ///< Time spent in each stage of the last world generation, in microseconds.
+static GenWorldProgress _gw_stage = GWP_CLASS_COUNT;   ///< Stage of the world generation that is being timed, if any.
+static uint64 _gw_stage_start;                         ///< Time the stage that is being timed started, in microseconds.
+
+/** Get the current time in microseconds, for timing the stages of the world generation. */
+static uint64 GetGeneratingWorldTime()
+{
+	using namespace std::chrono;
+	return (uint64)time_point_cast<microseconds>(steady_clock::now()).time_since_epoch().count();
+}
+
+/**
+ * Note that the world generation enters a stage, and stop the timing of the previous stage.
+ * @param cls The stage that starts, or #GWP_CLASS_COUNT when the generation is done.
+ */
+void StartGeneratingWorldStage(GenWorldProgress cls)
+{
+	uint64 now = GetGeneratingWorldTime();
+	if (_gw_stage != GWP_CLASS_COUNT) _gw_stage_time[_gw_stage] += now - _gw_stage_start;
+	_gw_stage = cls;
+	_gw_stage_start = now;
+}
+
+/**
+ * Write the time spent in each stage of the last world generation.
+ * @param p The buffer to write to.
+ * @param last The last element of the buffer.
+ * @return The end of the written text.
+ */
+char *WriteGeneratingWorldTimings(char *p, const char *last)
+{
+	static const char * const stage_names[] = {
+		"map init", "landscape", "rivers", "rough/rocky", "towns", "industries",
+		"objects", "trees", "game init", "tile loop", "game script", "game start",
+	};
+	assert_compile(lengthof(stage_names) == GWP_CLASS_COUNT);
+
+	uint64 total = 0;
+	for (uint i = 0; i < GWP_CLASS_COUNT; i++) {
+		p += seprintf(p, last, "  %-12s %10.2f ms\n", stage_names[i], _gw_stage_time[i] / 1000.0);
+		total += _gw_stage_time[i];
+	}
+	p += seprintf(p, last, "  %-12s %10.2f ms\n", "total", total / 1000.0);
+	return p;
+}
+
 /**
  * Tells if the world generation is done in a thread or not.
  * @return the 'threaded' status
@@ -198,6 +245,7 @@ static void _GenerateWorld()
 		/* Call any callback */
 		if (_gw.proc != nullptr) _gw.proc();
 		IncreaseGeneratingWorldProgress(GWP_GAME_START);
+		StartGeneratingWorldStage(GWP_CLASS_COUNT);
 
 		CleanupGeneration();
 		lock.unlock();
@@ -301,6 +349,14 @@ void HandleGeneratingWorldAbortion()
 void GenerateWorld(GenWorldMode mode, uint size_x, uint size_y, bool reset_settings)
 {
 	if (HasModalProgress()) return;
+	/* Both axes may be at their maximum in the settings, but not at the same time. */
+	while (FindFirstBit(size_x) + FindFirstBit(size_y) > MAX_MAP_TILES_BITS) {
+		if (size_x > size_y) {
+			size_x >>= 1;
+		} else {
+			size_y >>= 1;
+		}
+	}
 	_gw.mode   = mode;
 	_gw.size_x = size_x;
 	_gw.size_y = size_y;
@@ -311,6 +367,9 @@ void GenerateWorld(GenWorldMode mode, uint size_x, uint size_y, bool reset_setti
 	_gw.quit_thread   = false;
 	_gw.threaded      = true;
 
+	MemSetT(_gw_stage_time, 0, lengthof(_gw_stage_time));
+	_gw_stage = GWP_CLASS_COUNT;
+
 	/* This disables some commands and stuff */
 	SetLocalCompany(COMPANY_SPECTATOR);
 
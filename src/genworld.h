@@ -89,6 +89,8 @@ void GenerateWorld(GenWorldMode mode, uint size_x, uint size_y, bool reset_setti
 void AbortGeneratingWorld();
 bool IsGeneratingWorldAborted();
 void HandleGeneratingWorldAbortion();
+void StartGeneratingWorldStage(GenWorldProgress cls);
+char *WriteGeneratingWorldTimings(char *p, const char *last);
 
 /* genworld_gui.cpp */
 void SetNewLandscapeType(byte landscape);
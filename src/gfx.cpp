@@ -18,8 +18,10 @@
 #include "network/network.h"
 #include "network/network_func.h"
 #include "window_func.h"
+#include "viewport_func.h"
 #include "newgrf_debug.h"
 #include "thread.h"
+#include <vector>
 
 #include "table/palettes.h"
 #include "table/string_colours.h"
@@ -48,11 +50,12 @@ PauseMode _pause_mode;
 Palette _cur_palette;
 
 static byte _stringwidth_table[FS_END][224]; ///< Cache containing width of often used characters. @see GetCharacterWidth()
-DrawPixelInfo *_cur_dpi;
+thread_local DrawPixelInfo *_cur_dpi; ///< Current drawing area; per thread, as viewports can be drawn by multiple threads.
 byte _colour_gradient[COLOUR_END][8];
 
 static void GfxMainBlitterViewport(const Sprite *sprite, int x, int y, BlitterMode mode, const SubSprite *sub = nullptr, SpriteID sprite_id = SPR_CURSOR_MOUSE);
 static void GfxMainBlitter(const Sprite *sprite, int x, int y, BlitterMode mode, const SubSprite *sub = nullptr, SpriteID sprite_id = SPR_CURSOR_MOUSE, ZoomLevel zoom = ZOOM_LVL_NORMAL);
+static bool GfxMainBlitterParams(Blitter::BlitterParams *bp, const Sprite *sprite, int x, int y);
 
 static ReusableBuffer<uint8> _cursor_backup;
 
@@ -67,22 +70,125 @@ ZoomLevel _font_zoom; ///< Font Zoom level
  * @ingroup dirty
  */
 static Rect _invalid_rect;
-static const byte *_colour_remap_ptr;
-static byte _string_colourremap[3]; ///< Recoloursprite for stringdrawing. The grf loader ensures that #ST_FONT sprites only use colours 0 to 2.
+static thread_local const byte *_colour_remap_ptr;
+static thread_local byte _string_colourremap[3]; ///< Recoloursprite for stringdrawing. The grf loader ensures that #ST_FONT sprites only use colours 0 to 2.
 
 static const uint DIRTY_BLOCK_HEIGHT   = 8;
 static const uint DIRTY_BLOCK_WIDTH    = 64;
 
-static uint _dirty_bytes_per_line = 0;
-static byte *_dirty_blocks = nullptr;
+static const uint DIRTY_BLOCKS_PER_WORD = 32; ///< Number of dirty blocks stored in a single word of #_dirty_blocks.
+
+static uint _dirty_blocks_per_line = 0; ///< Number of dirty blocks in a line of dirty blocks.
+static uint _dirty_words_per_line = 0;  ///< Number of words of #_dirty_blocks used for a line of dirty blocks.
+static uint32 *_dirty_blocks = nullptr; ///< Bitmap of the dirty blocks, one line of dirty blocks after the other.
 extern uint _dirty_block_colour;
 
+/**
+ * Get the bits of a word of a line of dirty blocks that are within a span of dirty blocks.
+ * @param word The index of the word within the line.
+ * @param first The first dirty block of the span.
+ * @param last The dirty block just after the span.
+ * @return The mask of the bits of the span within the word.
+ */
+static inline uint32 GetDirtyBlockSpanMask(uint word, uint first, uint last)
+{
+	uint32 mask = UINT32_MAX;
+	if (first > word * DIRTY_BLOCKS_PER_WORD) mask &= UINT32_MAX << (first % DIRTY_BLOCKS_PER_WORD);
+	if (last < (word + 1) * DIRTY_BLOCKS_PER_WORD) mask &= ~(UINT32_MAX << (last % DIRTY_BLOCKS_PER_WORD));
+	return mask;
+}
+
+/**
+ * Check whether all dirty blocks of a span within a line are dirty.
+ * @param line The line of dirty blocks.
+ * @param first The first dirty block of the span.
+ * @param last The dirty block just after the span.
+ * @return True iff every block of the span is dirty.
+ */
+static bool IsDirtyBlockSpanSet(const uint32 *line, uint first, uint last)
+{
+	for (uint word = first / DIRTY_BLOCKS_PER_WORD; word <= (last - 1) / DIRTY_BLOCKS_PER_WORD; word++) {
+		uint32 mask = GetDirtyBlockSpanMask(word, first, last);
+		if ((line[word] & mask) != mask) return false;
+	}
+	return true;
+}
+
+/**
+ * Mark all dirty blocks of a span within a line as dirty.
+ * @param line The line of dirty blocks.
+ * @param first The first dirty block of the span.
+ * @param last The dirty block just after the span.
+ */
+static void SetDirtyBlockSpan(uint32 *line, uint first, uint last)
+{
+	for (uint word = first / DIRTY_BLOCKS_PER_WORD; word <= (last - 1) / DIRTY_BLOCKS_PER_WORD; word++) {
+		line[word] |= GetDirtyBlockSpanMask(word, first, last);
+	}
+}
+
+/**
+ * Mark all dirty blocks of a span within a line as clean.
+ * @param line The line of dirty blocks.
+ * @param first The first dirty block of the span.
+ * @param last The dirty block just after the span.
+ */
+static void ClearDirtyBlockSpan(uint32 *line, uint first, uint last)
+{
+	for (uint word = first / DIRTY_BLOCKS_PER_WORD; word <= (last - 1) / DIRTY_BLOCKS_PER_WORD; word++) {
+		line[word] &= ~GetDirtyBlockSpanMask(word, first, last);
+	}
+}
+
+/**
+ * Find the end of the run of dirty blocks within a line that starts at a dirty block.
+ * @param line The line of dirty blocks.
+ * @param first The first dirty block of the run.
+ * @return The first block after \a first that is not dirty.
+ */
+static uint FindDirtyBlockSpanEnd(const uint32 *line, uint first)
+{
+	uint word = first / DIRTY_BLOCKS_PER_WORD;
+	uint32 clean = ~line[word] & (UINT32_MAX << (first % DIRTY_BLOCKS_PER_WORD));
+	while (clean == 0) {
+		/* Blocks beyond the end of the line are never dirty, so only a line that fills its last word completely ends up here. */
+		if (++word == _dirty_words_per_line) return _dirty_blocks_per_line;
+		clean = ~line[word];
+	}
+	return min<uint>(word * DIRTY_BLOCKS_PER_WORD + FindFirstBit(clean), _dirty_blocks_per_line);
+}
+
+/**
+ * Check whether a part of the screen is going to be redrawn completely by the next #DrawDirtyBlocks.
+ * @param left The left edge of the part.
+ * @param top The top edge of the part.
+ * @param right The right edge of the part.
+ * @param bottom The bottom edge of the part.
+ * @return True iff all of the part is dirty.
+ */
+static bool IsScreenAreaDirty(int left, int top, int right, int bottom)
+{
+	if (left >= right || top >= bottom) return false;
+	/* Dirty blocks are only redrawn as far as they are within the invalid rectangle. */
+	if (left < _invalid_rect.left || top < _invalid_rect.top || right > _invalid_rect.right || bottom > _invalid_rect.bottom) return false;
+
+	uint first = left / DIRTY_BLOCK_WIDTH;
+	uint last = (right - 1) / DIRTY_BLOCK_WIDTH + 1;
+	for (uint y = top / DIRTY_BLOCK_HEIGHT; y <= (uint)(bottom - 1) / DIRTY_BLOCK_HEIGHT; y++) {
+		if (!IsDirtyBlockSpanSet(_dirty_blocks + y * _dirty_words_per_line, first, last)) return false;
+	}
+	return true;
+}
+
 void GfxScroll(int left, int top, int width, int height, int xo, int yo)
 {
 	Blitter *blitter = BlitterFactory::GetCurrentBlitter();
 
 	if (xo == 0 && yo == 0) return;
 
+	/* Moving what is on the screen is of no use when all of it gets redrawn anyway. */
+	if (IsScreenAreaDirty(left, top, left + width, top + height)) return;
+
 	if (_cursor.visible) UndrawMouseCursor();
 
 	if (_networking) NetworkUndrawChatMessage();
@@ -461,6 +567,45 @@ static void SetColourRemap(TextColour colour)
 	_colour_remap_ptr = _string_colourremap;
 }
 
+/** Glyphs of a run of text waiting to be drawn in one go. */
+struct GlyphBatch {
+	std::vector<Blitter::BlitterParams> shadows; ///< The shadows of the glyphs.
+	std::vector<Blitter::BlitterParams> glyphs;  ///< The glyphs themselves.
+
+	/**
+	 * Queue a glyph for drawing.
+	 * @param sprite The sprite of the glyph.
+	 * @param x The X location to draw.
+	 * @param y The Y location to draw.
+	 * @param draw_shadow Whether to draw a shadow below the glyph.
+	 */
+	void Add(const Sprite *sprite, int x, int y, bool draw_shadow)
+	{
+		Blitter::BlitterParams bp;
+		if (draw_shadow && GfxMainBlitterParams(&bp, sprite, x + 1, y + 1)) this->shadows.push_back(bp);
+		if (GfxMainBlitterParams(&bp, sprite, x, y)) this->glyphs.push_back(bp);
+	}
+
+	/**
+	 * Draw all queued glyphs, first all shadows and then the glyphs on top of them.
+	 * The colour remap only has to be switched once per batch instead of twice per glyph.
+	 * @param colour The colour of the glyphs; it is the current colour remap on return.
+	 */
+	void Draw(TextColour colour)
+	{
+		Blitter *blitter = BlitterFactory::GetCurrentBlitter();
+		if (!this->shadows.empty()) {
+			SetColourRemap(TC_BLACK);
+			blitter->DrawBatch(this->shadows.data(), (uint)this->shadows.size(), BM_COLOUR_REMAP, ZOOM_LVL_NORMAL);
+			SetColourRemap(colour);
+		}
+		if (!this->glyphs.empty()) blitter->DrawBatch(this->glyphs.data(), (uint)this->glyphs.size(), BM_COLOUR_REMAP, ZOOM_LVL_NORMAL);
+
+		this->shadows.clear();
+		this->glyphs.clear();
+	}
+};
+
 /**
  * Drawing routine for drawing a laid out line of text.
  * @param line      String to draw.
@@ -555,6 +700,9 @@ static int DrawLayoutLine(const ParagraphLayouter::Line &line, int y, int left,
 			NOT_REACHED();
 	}
 
+	/* Reused between lines, so drawing text does not allocate. */
+	static thread_local GlyphBatch batch;
+
 	TextColour colour = TC_BLACK;
 	bool draw_shadow = false;
 	for (int run_index = 0; run_index < line.CountRuns(); run_index++) {
@@ -588,25 +736,17 @@ static int DrawLayoutLine(const ParagraphLayouter::Line &line, int y, int left,
 			/* Check clipping (the "+ 1" is for the shadow). */
 			if (begin_x + sprite->x_offs > dpi_right || begin_x + sprite->x_offs + sprite->width /* - 1 + 1 */ < dpi_left) continue;
 
-			if (draw_shadow && (glyph & SPRITE_GLYPH) == 0) {
-				SetColourRemap(TC_BLACK);
-				GfxMainBlitter(sprite, begin_x + 1, top + 1, BM_COLOUR_REMAP);
-				SetColourRemap(colour);
-			}
-			GfxMainBlitter(sprite, begin_x, top, BM_COLOUR_REMAP);
+			batch.Add(sprite, begin_x, top, draw_shadow && (glyph & SPRITE_GLYPH) == 0);
 		}
+		batch.Draw(colour);
 	}
 
 	if (truncation) {
 		int x = (_current_text_dir == TD_RTL) ? left : (right - 3 * dot_width);
 		for (int i = 0; i < 3; i++, x += dot_width) {
-			if (draw_shadow) {
-				SetColourRemap(TC_BLACK);
-				GfxMainBlitter(dot_sprite, x + 1, y + 1, BM_COLOUR_REMAP);
-				SetColourRemap(colour);
-			}
-			GfxMainBlitter(dot_sprite, x, y, BM_COLOUR_REMAP);
+			batch.Add(dot_sprite, x, y, draw_shadow);
 		}
+		batch.Draw(colour);
 	}
 
 	if (underline) {
@@ -948,16 +1088,16 @@ void DrawSpriteViewport(SpriteID img, PaletteID pal, int x, int y, const SubSpri
 	SpriteID real_sprite = GB(img, 0, SPRITE_WIDTH);
 	if (HasBit(img, PALETTE_MODIFIER_TRANSPARENT)) {
 		_colour_remap_ptr = GetNonSprite(GB(pal, 0, PALETTE_WIDTH), ST_RECOLOUR) + 1;
-		GfxMainBlitterViewport(GetSprite(real_sprite, ST_NORMAL), x, y, BM_TRANSPARENT, sub, real_sprite);
+		GfxMainBlitterViewport(GetSprite(real_sprite, ST_NORMAL, _cur_dpi->zoom), x, y, BM_TRANSPARENT, sub, real_sprite);
 	} else if (pal != PAL_NONE) {
 		if (HasBit(pal, PALETTE_TEXT_RECOLOUR)) {
 			SetColourRemap((TextColour)GB(pal, 0, PALETTE_WIDTH));
 		} else {
 			_colour_remap_ptr = GetNonSprite(GB(pal, 0, PALETTE_WIDTH), ST_RECOLOUR) + 1;
 		}
-		GfxMainBlitterViewport(GetSprite(real_sprite, ST_NORMAL), x, y, GetBlitterMode(pal), sub, real_sprite);
+		GfxMainBlitterViewport(GetSprite(real_sprite, ST_NORMAL, _cur_dpi->zoom), x, y, GetBlitterMode(pal), sub, real_sprite);
 	} else {
-		GfxMainBlitterViewport(GetSprite(real_sprite, ST_NORMAL), x, y, BM_NORMAL, sub, real_sprite);
+		GfxMainBlitterViewport(GetSprite(real_sprite, ST_NORMAL, _cur_dpi->zoom), x, y, BM_NORMAL, sub, real_sprite);
 	}
 }
 
@@ -975,35 +1115,35 @@ void DrawSprite(SpriteID img, PaletteID pal, int x, int y, const SubSprite *sub,
 	SpriteID real_sprite = GB(img, 0, SPRITE_WIDTH);
 	if (HasBit(img, PALETTE_MODIFIER_TRANSPARENT)) {
 		_colour_remap_ptr = GetNonSprite(GB(pal, 0, PALETTE_WIDTH), ST_RECOLOUR) + 1;
-		GfxMainBlitter(GetSprite(real_sprite, ST_NORMAL), x, y, BM_TRANSPARENT, sub, real_sprite, zoom);
+		GfxMainBlitter(GetSprite(real_sprite, ST_NORMAL, zoom), x, y, BM_TRANSPARENT, sub, real_sprite, zoom);
 	} else if (pal != PAL_NONE) {
 		if (HasBit(pal, PALETTE_TEXT_RECOLOUR)) {
 			SetColourRemap((TextColour)GB(pal, 0, PALETTE_WIDTH));
 		} else {
 			_colour_remap_ptr = GetNonSprite(GB(pal, 0, PALETTE_WIDTH), ST_RECOLOUR) + 1;
 		}
-		GfxMainBlitter(GetSprite(real_sprite, ST_NORMAL), x, y, GetBlitterMode(pal), sub, real_sprite, zoom);
+		GfxMainBlitter(GetSprite(real_sprite, ST_NORMAL, zoom), x, y, GetBlitterMode(pal), sub, real_sprite, zoom);
 	} else {
-		GfxMainBlitter(GetSprite(real_sprite, ST_NORMAL), x, y, BM_NORMAL, sub, real_sprite, zoom);
+		GfxMainBlitter(GetSprite(real_sprite, ST_NORMAL, zoom), x, y, BM_NORMAL, sub, real_sprite, zoom);
 	}
 }
 
 /**
- * The code for setting up the blitter mode and sprite information before finally drawing the sprite.
+ * Set up the blitter params for drawing a sprite, clipped to the current drawing area.
+ * @param[out] bp The params to fill.
  * @param sprite The sprite to draw.
  * @param x      The X location to draw.
  * @param y      The Y location to draw.
- * @param mode   The settings for the blitter to pass.
  * @param sub    Whether to only draw a sub set of the sprite.
  * @param zoom   The zoom level at which to draw the sprites.
  * @tparam ZOOM_BASE The factor required to get the sub sprite information into the right size.
  * @tparam SCALED_XY Whether the X and Y are scaled or unscaled.
+ * @return False if nothing of the sprite is visible, so there is nothing to draw.
  */
 template <int ZOOM_BASE, bool SCALED_XY>
-static void GfxBlitter(const Sprite * const sprite, int x, int y, BlitterMode mode, const SubSprite * const sub, SpriteID sprite_id, ZoomLevel zoom)
+static bool SetupBlitterParams(Blitter::BlitterParams *bp, const Sprite * const sprite, int x, int y, const SubSprite * const sub, ZoomLevel zoom)
 {
 	const DrawPixelInfo *dpi = _cur_dpi;
-	Blitter::BlitterParams bp;
 
 	if (SCALED_XY) {
 		/* Scale it */
@@ -1017,10 +1157,10 @@ static void GfxBlitter(const Sprite * const sprite, int x, int y, BlitterMode mo
 
 	if (sub == nullptr) {
 		/* No clipping. */
-		bp.skip_left = 0;
-		bp.skip_top = 0;
-		bp.width = UnScaleByZoom(sprite->width, zoom);
-		bp.height = UnScaleByZoom(sprite->height, zoom);
+		bp->skip_left = 0;
+		bp->skip_top = 0;
+		bp->width = UnScaleByZoom(sprite->width, zoom);
+		bp->height = UnScaleByZoom(sprite->height, zoom);
 	} else {
 		/* Amount of pixels to clip from the source sprite */
 		int clip_left   = max(0,                   -sprite->x_offs +  sub->left        * ZOOM_BASE );
@@ -1028,75 +1168,94 @@ static void GfxBlitter(const Sprite * const sprite, int x, int y, BlitterMode mo
 		int clip_right  = max(0, sprite->width  - (-sprite->x_offs + (sub->right + 1)  * ZOOM_BASE));
 		int clip_bottom = max(0, sprite->height - (-sprite->y_offs + (sub->bottom + 1) * ZOOM_BASE));
 
-		if (clip_left + clip_right >= sprite->width) return;
-		if (clip_top + clip_bottom >= sprite->height) return;
+		if (clip_left + clip_right >= sprite->width) return false;
+		if (clip_top + clip_bottom >= sprite->height) return false;
 
-		bp.skip_left = UnScaleByZoomLower(clip_left, zoom);
-		bp.skip_top = UnScaleByZoomLower(clip_top, zoom);
-		bp.width = UnScaleByZoom(sprite->width - clip_left - clip_right, zoom);
-		bp.height = UnScaleByZoom(sprite->height - clip_top - clip_bottom, zoom);
+		bp->skip_left = UnScaleByZoomLower(clip_left, zoom);
+		bp->skip_top = UnScaleByZoomLower(clip_top, zoom);
+		bp->width = UnScaleByZoom(sprite->width - clip_left - clip_right, zoom);
+		bp->height = UnScaleByZoom(sprite->height - clip_top - clip_bottom, zoom);
 
-		x += ScaleByZoom(bp.skip_left, zoom);
-		y += ScaleByZoom(bp.skip_top, zoom);
+		x += ScaleByZoom(bp->skip_left, zoom);
+		y += ScaleByZoom(bp->skip_top, zoom);
 	}
 
 	/* Copy the main data directly from the sprite */
-	bp.sprite = sprite->data;
-	bp.sprite_width = sprite->width;
-	bp.sprite_height = sprite->height;
-	bp.top = 0;
-	bp.left = 0;
+	bp->sprite = sprite->data;
+	bp->sprite_width = sprite->width;
+	bp->sprite_height = sprite->height;
+	bp->top = 0;
+	bp->left = 0;
 
-	bp.dst = dpi->dst_ptr;
-	bp.pitch = dpi->pitch;
-	bp.remap = _colour_remap_ptr;
+	bp->dst = dpi->dst_ptr;
+	bp->pitch = dpi->pitch;
+	bp->remap = _colour_remap_ptr;
 
 	assert(sprite->width > 0);
 	assert(sprite->height > 0);
 
-	if (bp.width <= 0) return;
-	if (bp.height <= 0) return;
+	if (bp->width <= 0) return false;
+	if (bp->height <= 0) return false;
 
 	y -= SCALED_XY ? ScaleByZoom(dpi->top, zoom) : dpi->top;
 	int y_unscaled = UnScaleByZoom(y, zoom);
 	/* Check for top overflow */
 	if (y < 0) {
-		bp.height -= -y_unscaled;
-		if (bp.height <= 0) return;
-		bp.skip_top += -y_unscaled;
+		bp->height -= -y_unscaled;
+		if (bp->height <= 0) return false;
+		bp->skip_top += -y_unscaled;
 		y = 0;
 	} else {
-		bp.top = y_unscaled;
+		bp->top = y_unscaled;
 	}
 
 	/* Check for bottom overflow */
-	y += SCALED_XY ? ScaleByZoom(bp.height - dpi->height, zoom) : ScaleByZoom(bp.height, zoom) - dpi->height;
+	y += SCALED_XY ? ScaleByZoom(bp->height - dpi->height, zoom) : ScaleByZoom(bp->height, zoom) - dpi->height;
 	if (y > 0) {
-		bp.height -= UnScaleByZoom(y, zoom);
-		if (bp.height <= 0) return;
+		bp->height -= UnScaleByZoom(y, zoom);
+		if (bp->height <= 0) return false;
 	}
 
 	x -= SCALED_XY ? ScaleByZoom(dpi->left, zoom) : dpi->left;
 	int x_unscaled = UnScaleByZoom(x, zoom);
 	/* Check for left overflow */
 	if (x < 0) {
-		bp.width -= -x_unscaled;
-		if (bp.width <= 0) return;
-		bp.skip_left += -x_unscaled;
+		bp->width -= -x_unscaled;
+		if (bp->width <= 0) return false;
+		bp->skip_left += -x_unscaled;
 		x = 0;
 	} else {
-		bp.left = x_unscaled;
+		bp->left = x_unscaled;
 	}
 
 	/* Check for right overflow */
-	x += SCALED_XY ? ScaleByZoom(bp.width - dpi->width, zoom) : ScaleByZoom(bp.width, zoom) - dpi->width;
+	x += SCALED_XY ? ScaleByZoom(bp->width - dpi->width, zoom) : ScaleByZoom(bp->width, zoom) - dpi->width;
 	if (x > 0) {
-		bp.width -= UnScaleByZoom(x, zoom);
-		if (bp.width <= 0) return;
+		bp->width -= UnScaleByZoom(x, zoom);
+		if (bp->width <= 0) return false;
 	}
 
-	assert(bp.skip_left + bp.width <= UnScaleByZoom(sprite->width, zoom));
-	assert(bp.skip_top + bp.height <= UnScaleByZoom(sprite->height, zoom));
+	assert(bp->skip_left + bp->width <= UnScaleByZoom(sprite->width, zoom));
+	assert(bp->skip_top + bp->height <= UnScaleByZoom(sprite->height, zoom));
+	return true;
+}
+
+/**
+ * The code for setting up the blitter mode and sprite information before finally drawing the sprite.
+ * @param sprite The sprite to draw.
+ * @param x      The X location to draw.
+ * @param y      The Y location to draw.
+ * @param mode   The settings for the blitter to pass.
+ * @param sub    Whether to only draw a sub set of the sprite.
+ * @param zoom   The zoom level at which to draw the sprites.
+ * @tparam ZOOM_BASE The factor required to get the sub sprite information into the right size.
+ * @tparam SCALED_XY Whether the X and Y are scaled or unscaled.
+ */
+template <int ZOOM_BASE, bool SCALED_XY>
+static void GfxBlitter(const Sprite * const sprite, int x, int y, BlitterMode mode, const SubSprite * const sub, SpriteID sprite_id, ZoomLevel zoom)
+{
+	Blitter::BlitterParams bp;
+	if (!SetupBlitterParams<ZOOM_BASE, SCALED_XY>(&bp, sprite, x, y, sub, zoom)) return;
 
 	/* We do not want to catch the mouse. However we also use that spritenumber for unknown (text) sprites. */
 	if (_newgrf_debug_sprite_picker.mode == SPM_REDRAW && sprite_id != SPR_CURSOR_MOUSE) {
@@ -1127,6 +1286,19 @@ static void GfxMainBlitter(const Sprite *sprite, int x, int y, BlitterMode mode,
 	GfxBlitter<1, true>(sprite, x, y, mode, sub, sprite_id, zoom);
 }
 
+/**
+ * Set up the blitter params for drawing a whole sprite at normal zoom, like #GfxMainBlitter does, without drawing it yet.
+ * @param[out] bp The params to fill.
+ * @param sprite The sprite to draw.
+ * @param x The X location to draw.
+ * @param y The Y location to draw.
+ * @return False if nothing of the sprite is visible, so there is nothing to draw.
+ */
+static bool GfxMainBlitterParams(Blitter::BlitterParams *bp, const Sprite *sprite, int x, int y)
+{
+	return SetupBlitterParams<1, true>(bp, sprite, x, y, nullptr, ZOOM_LVL_NORMAL);
+}
+
 void DoPaletteAnimations();
 
 void GfxInitPalettes()
@@ -1330,8 +1502,11 @@ void GetBroadestDigit(uint *front, uint *next, FontSize size)
 
 void ScreenSizeChanged()
 {
-	_dirty_bytes_per_line = CeilDiv(_screen.width, DIRTY_BLOCK_WIDTH);
-	_dirty_blocks = ReallocT<byte>(_dirty_blocks, _dirty_bytes_per_line * CeilDiv(_screen.height, DIRTY_BLOCK_HEIGHT));
+	_dirty_blocks_per_line = CeilDiv(_screen.width, DIRTY_BLOCK_WIDTH);
+	_dirty_words_per_line = CeilDiv(_dirty_blocks_per_line, DIRTY_BLOCKS_PER_WORD);
+	uint dirty_words = _dirty_words_per_line * CeilDiv(_screen.height, DIRTY_BLOCK_HEIGHT);
+	_dirty_blocks = ReallocT<uint32>(_dirty_blocks, dirty_words);
+	MemSetT(_dirty_blocks, 0, dirty_words);
 
 	/* check the dirty rect */
 	if (_invalid_rect.right >= _screen.width) _invalid_rect.right = _screen.width;
@@ -1441,11 +1616,8 @@ void RedrawScreenRect(int left, int top, int right, int bottom)
  */
 void DrawDirtyBlocks()
 {
-	byte *b = _dirty_blocks;
 	const int w = Align(_screen.width,  DIRTY_BLOCK_WIDTH);
 	const int h = Align(_screen.height, DIRTY_BLOCK_HEIGHT);
-	int x;
-	int y;
 
 	if (HasModalProgress()) {
 		/* We are generating the world, so release our rights to the map and
@@ -1470,67 +1642,41 @@ void DrawDirtyBlocks()
 		if (_switch_mode != SM_NONE && !HasModalProgress()) return;
 	}
 
-	y = 0;
-	do {
-		x = 0;
-		do {
-			if (*b != 0) {
-				int left;
-				int top;
-				int right = x + DIRTY_BLOCK_WIDTH;
-				int bottom = y;
-				byte *p = b;
-				int h2;
-
-				/* First try coalescing downwards */
-				do {
-					*p = 0;
-					p += _dirty_bytes_per_line;
-					bottom += DIRTY_BLOCK_HEIGHT;
-				} while (bottom != h && *p != 0);
-
-				/* Try coalescing to the right too. */
-				h2 = (bottom - y) / DIRTY_BLOCK_HEIGHT;
-				assert(h2 > 0);
-				p = b;
-
-				while (right != w) {
-					byte *p2 = ++p;
-					int h = h2;
-					/* Check if a full line of dirty flags is set. */
-					do {
-						if (!*p2) goto no_more_coalesc;
-						p2 += _dirty_bytes_per_line;
-					} while (--h != 0);
-
-					/* Wohoo, can combine it one step to the right!
-					 * Do that, and clear the bits. */
-					right += DIRTY_BLOCK_WIDTH;
-
-					h = h2;
-					p2 = p;
-					do {
-						*p2 = 0;
-						p2 += _dirty_bytes_per_line;
-					} while (--h != 0);
-				}
-				no_more_coalesc:
-
-				left = x;
-				top = y;
+	/* Only the lines and words of dirty blocks touching the invalid rectangle can contain dirty blocks. */
+	if (_invalid_rect.left < _invalid_rect.right && _invalid_rect.top < _invalid_rect.bottom) {
+		const uint lines = h / DIRTY_BLOCK_HEIGHT;
+		const uint first_word = _invalid_rect.left / DIRTY_BLOCK_WIDTH / DIRTY_BLOCKS_PER_WORD;
+		const uint last_word = (_invalid_rect.right - 1) / DIRTY_BLOCK_WIDTH / DIRTY_BLOCKS_PER_WORD;
+
+		for (uint y = _invalid_rect.top / DIRTY_BLOCK_HEIGHT; y <= (uint)(_invalid_rect.bottom - 1) / DIRTY_BLOCK_HEIGHT; y++) {
+			uint32 *line = _dirty_blocks + y * _dirty_words_per_line;
+			for (uint word = first_word; word <= last_word; word++) {
+				while (line[word] != 0) {
+					/* Take the run of dirty blocks to the right of the first dirty block,
+					 * and extend it downwards for as long as the same span is dirty. */
+					uint first = word * DIRTY_BLOCKS_PER_WORD + FindFirstBit(line[word]);
+					uint last = FindDirtyBlockSpanEnd(line, first);
+					ClearDirtyBlockSpan(line, first, last);
+
+					uint y2 = y + 1;
+					for (; y2 < lines; y2++) {
+						uint32 *line2 = _dirty_blocks + y2 * _dirty_words_per_line;
+						if (!IsDirtyBlockSpanSet(line2, first, last)) break;
+						ClearDirtyBlockSpan(line2, first, last);
+					}
 
-				if (left   < _invalid_rect.left  ) left   = _invalid_rect.left;
-				if (top    < _invalid_rect.top   ) top    = _invalid_rect.top;
-				if (right  > _invalid_rect.right ) right  = _invalid_rect.right;
-				if (bottom > _invalid_rect.bottom) bottom = _invalid_rect.bottom;
+					int left   = max<int>(first * DIRTY_BLOCK_WIDTH, _invalid_rect.left);
+					int top    = max<int>(y * DIRTY_BLOCK_HEIGHT, _invalid_rect.top);
+					int right  = min<int>(last * DIRTY_BLOCK_WIDTH, _invalid_rect.right);
+					int bottom = min<int>(y2 * DIRTY_BLOCK_HEIGHT, _invalid_rect.bottom);
 
-				if (left < right && top < bottom) {
-					RedrawScreenRect(left, top, right, bottom);
+					if (left < right && top < bottom) {
+						RedrawScreenRect(left, top, right, bottom);
+					}
 				}
-
 			}
-		} while (b++, (x += DIRTY_BLOCK_WIDTH) != w);
-	} while (b += -(int)(w / DIRTY_BLOCK_WIDTH) + _dirty_bytes_per_line, (y += DIRTY_BLOCK_HEIGHT) != h);
+		}
+	}
 
 	++_dirty_block_colour;
 	_invalid_rect.left = w;
@@ -1556,10 +1702,6 @@ void DrawDirtyBlocks()
  */
 void SetDirtyBlocks(int left, int top, int right, int bottom)
 {
-	byte *b;
-	int width;
-	int height;
-
 	if (left < 0) left = 0;
 	if (top < 0) top = 0;
 	if (right > _screen.width) right = _screen.width;
@@ -1572,33 +1714,25 @@ void SetDirtyBlocks(int left, int top, int right, int bottom)
 	if (right  > _invalid_rect.right ) _invalid_rect.right  = right;
 	if (bottom > _invalid_rect.bottom) _invalid_rect.bottom = bottom;
 
-	left /= DIRTY_BLOCK_WIDTH;
-	top  /= DIRTY_BLOCK_HEIGHT;
-
-	b = _dirty_blocks + top * _dirty_bytes_per_line + left;
-
-	width  = ((right  - 1) / DIRTY_BLOCK_WIDTH)  - left + 1;
-	height = ((bottom - 1) / DIRTY_BLOCK_HEIGHT) - top  + 1;
-
-	assert(width > 0 && height > 0);
-
-	do {
-		int i = width;
-
-		do b[--i] = 0xFF; while (i != 0);
-
-		b += _dirty_bytes_per_line;
-	} while (--height != 0);
+	uint first = left / DIRTY_BLOCK_WIDTH;
+	uint last = (right - 1) / DIRTY_BLOCK_WIDTH + 1;
+	for (uint y = top / DIRTY_BLOCK_HEIGHT; y <= (uint)(bottom - 1) / DIRTY_BLOCK_HEIGHT; y++) {
+		SetDirtyBlockSpan(_dirty_blocks + y * _dirty_words_per_line, first, last);
+	}
 }
 
 /**
  * This function mark the whole screen as dirty. This results in repainting
  * the whole screen. Use this with care as this function will break the
  * idea about marking only parts of the screen as 'dirty'.
+ * As anything may have changed, the cached sprites of the tiles are dropped too.
  * @ingroup dirty
  */
 void MarkWholeScreenDirty()
 {
+	InvalidateAllTileSpriteCache();
+	/* Whatever changed might also affect how strings are formatted. */
+	ClearFormattedStringCache();
 	SetDirtyBlocks(0, 0, _screen.width, _screen.height);
 }
 
@@ -33,6 +33,12 @@
 /** Cache of ParagraphLayout lines. */
 Layouter::LineCache *Layouter::linecache;
 
+/** Keys of the items in the linecache, the most recently used first. */
+Layouter::LineCacheLRU *Layouter::linecache_lru;
+
+/** Number of lines the linecache is reduced to. */
+static const size_t MAX_LINE_CACHE_SIZE = 4096;
+
 /** Cache of Font instances. */
 Layouter::FontColourMap Layouter::fonts[FS_END];
 
@@ -886,12 +892,22 @@ Layouter::LineCacheItem &Layouter::GetCachedParagraphLayout(const char *str, siz
 	if (linecache == nullptr) {
 		/* Create linecache on first access to avoid trouble with initialisation order of static variables. */
 		linecache = new LineCache();
+		linecache_lru = new LineCacheLRU();
 	}
 
 	LineCacheKey key;
 	key.state_before = state;
 	key.str.assign(str, len);
-	return (*linecache)[key];
+
+	auto it = linecache->find(key);
+	if (it != linecache->end()) {
+		/* Move the line to the front of the recently used lines. */
+		linecache_lru->splice(linecache_lru->begin(), *linecache_lru, it->second.lru);
+	} else {
+		it = linecache->emplace(std::piecewise_construct, std::forward_as_tuple(std::move(key)), std::forward_as_tuple()).first;
+		it->second.lru = linecache_lru->insert(linecache_lru->begin(), &it->first);
+	}
+	return it->second;
 }
 
 /**
@@ -899,16 +915,23 @@ Layouter::LineCacheItem &Layouter::GetCachedParagraphLayout(const char *str, siz
  */
 void Layouter::ResetLineCache()
 {
-	if (linecache != nullptr) linecache->clear();
+	if (linecache != nullptr) {
+		linecache->clear();
+		linecache_lru->clear();
+	}
 }
 
 /**
  * Reduce the size of linecache if necessary to prevent infinite growth.
+ * The lines that were not used for the longest time are removed.
+ * @note The removed items may not be referenced by any Layouter anymore.
  */
 void Layouter::ReduceLineCache()
 {
-	if (linecache != nullptr) {
-		/* TODO LRU cache would be fancy, but not exactly necessary */
-		if (linecache->size() > 4096) ResetLineCache();
+	if (linecache == nullptr) return;
+
+	while (linecache->size() > MAX_LINE_CACHE_SIZE) {
+		linecache->erase(linecache->find(*linecache_lru->back()));
+		linecache_lru->pop_back();
 	}
 }
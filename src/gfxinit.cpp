@@ -17,6 +17,13 @@
 #include "blitter/factory.hpp"
 #include "video/video_driver.hpp"
 #include "window_func.h"
+#include "fileio_func.h"
+
+#include <map>
+#include <sys/stat.h>
+#if defined(_WIN32)
+#	include <tchar.h>
+#endif
 
 /* The type of set we're replacing */
 #define SET_TYPE "graphics"
@@ -38,19 +45,31 @@ static const SpriteID * const _landscape_spriteindexes[] = {
 	_landscape_spriteindexes_toyland,
 };
 
+/**
+ * Get the MD5 sum of a file of the base set, if the file has the MD5 sum it should have.
+ * @param file The file.
+ * @return The MD5 sum, or \c nullptr if it is not known.
+ */
+static const uint8 *GetVerifiedMD5(const MD5File &file)
+{
+	return file.check_result == MD5File::CR_MATCH ? file.hash : nullptr;
+}
+
 /**
  * Load an old fashioned GRF file.
  * @param filename   The name of the file to open.
  * @param load_index The offset of the first sprite.
  * @param file_index The Fio offset to load the file in.
+ * @param md5sum     The MD5 sum of the file, or \c nullptr if it is not known.
  * @return The number of loaded sprites.
  */
-static uint LoadGrfFile(const char *filename, uint load_index, int file_index)
+static uint LoadGrfFile(const char *filename, uint load_index, int file_index, const uint8 *md5sum)
 {
 	uint load_index_org = load_index;
 	uint sprite_id = 0;
 
 	FioOpenFile(file_index, filename, BASESET_DIR);
+	SetSpriteDiskCacheKey(file_index, md5sum);
 
 	DEBUG(sprite, 2, "Reading grf-file '%s'", filename);
 
@@ -80,14 +99,16 @@ static uint LoadGrfFile(const char *filename, uint load_index, int file_index)
  * @param filename   The name of the file to open.
  * @param index_tbl  The offsets of each of the sprites.
  * @param file_index The Fio offset to load the file in.
+ * @param md5sum     The MD5 sum of the file, or \c nullptr if it is not known.
  * @return The number of loaded sprites.
  */
-static void LoadGrfFileIndexed(const char *filename, const SpriteID *index_tbl, int file_index)
+static void LoadGrfFileIndexed(const char *filename, const SpriteID *index_tbl, int file_index, const uint8 *md5sum)
 {
 	uint start;
 	uint sprite_id = 0;
 
 	FioOpenFile(file_index, filename, BASESET_DIR);
+	SetSpriteDiskCacheKey(file_index, md5sum);
 
 	DEBUG(sprite, 2, "Reading indexed grf-file '%s'", filename);
 
@@ -166,7 +187,7 @@ static void LoadSpriteTables()
 	const GraphicsSet *used_set = BaseGraphics::GetUsedSet();
 
 	_palette_remap_grf[i] = (PAL_DOS != used_set->palette);
-	LoadGrfFile(used_set->files[GFT_BASE].filename, 0, i++);
+	LoadGrfFile(used_set->files[GFT_BASE].filename, 0, i++, GetVerifiedMD5(used_set->files[GFT_BASE]));
 
 	/*
 	 * The second basic file always starts at the given location and does
@@ -175,7 +196,7 @@ static void LoadSpriteTables()
 	 * sprites as they are not shown anyway (logos in intro game).
 	 */
 	_palette_remap_grf[i] = (PAL_DOS != used_set->palette);
-	LoadGrfFile(used_set->files[GFT_LOGOS].filename, 4793, i++);
+	LoadGrfFile(used_set->files[GFT_LOGOS].filename, 4793, i++, GetVerifiedMD5(used_set->files[GFT_LOGOS]));
 
 	/*
 	 * Load additional sprites for climates other than temperate.
@@ -184,10 +205,12 @@ static void LoadSpriteTables()
 	 */
 	if (_settings_game.game_creation.landscape != LT_TEMPERATE) {
 		_palette_remap_grf[i] = (PAL_DOS != used_set->palette);
+		const MD5File &file = used_set->files[GFT_ARCTIC + _settings_game.game_creation.landscape - 1];
 		LoadGrfFileIndexed(
-			used_set->files[GFT_ARCTIC + _settings_game.game_creation.landscape - 1].filename,
+			file.filename,
 			_landscape_spriteindexes[_settings_game.game_creation.landscape - 1],
-			i++
+			i++,
+			GetVerifiedMD5(file)
 		);
 	}
 
@@ -275,9 +298,11 @@ static bool SwitchNewGRFBlitter()
 		uint min_base_depth, max_base_depth, min_grf_depth, max_grf_depth;
 	} replacement_blitters[] = {
 #ifdef WITH_SSE
+		{ "32bpp-avx2",      0, 32, 32,  8, 32 },
 		{ "32bpp-sse4",      0, 32, 32,  8, 32 },
 		{ "32bpp-ssse3",     0, 32, 32,  8, 32 },
 		{ "32bpp-sse2",      0, 32, 32,  8, 32 },
+		{ "32bpp-avx2-anim", 1, 32, 32,  8, 32 },
 		{ "32bpp-sse4-anim", 1, 32, 32,  8, 32 },
 #endif
 		{ "8bpp-optimized",  2,  8,  8,  8,  8 },
@@ -388,6 +413,76 @@ bool GraphicsSet::FillSetDetails(IniFile *ini, const char *path, const char *ful
 }
 
 
+char *_baseset_md5_cache_file; ///< Path of the file with the md5sums of the base set files checked before.
+
+/** The md5sum of a base set file, as stored in the md5sum cache. */
+struct BaseSetMD5CacheEntry {
+	uint64 size;      ///< Size of the file when the md5sum was calculated.
+	int64 mtime;      ///< Modification time of the file when the md5sum was calculated.
+	uint64 max_size;  ///< Number of bytes from the file start the md5sum was calculated for.
+	uint8 md5sum[16]; ///< MD5 checksum of the file.
+};
+
+/** The md5sum cache, by full path of the file. */
+static std::map<std::string, BaseSetMD5CacheEntry> _baseset_md5_cache;
+static bool _baseset_md5_cache_loaded = false;  ///< Whether #_baseset_md5_cache has been read from disk.
+static bool _baseset_md5_cache_changed = false; ///< Whether #_baseset_md5_cache differs from the file on disk.
+
+/** Read the md5sums of the base set files checked before, if not done yet. */
+static void LoadBaseSetMD5Cache()
+{
+	if (_baseset_md5_cache_loaded) return;
+	_baseset_md5_cache_loaded = true;
+	if (_baseset_md5_cache_file == nullptr) return;
+
+	IniFile ini;
+	ini.LoadFromDisk(_baseset_md5_cache_file, NO_DIRECTORY);
+	IniGroup *group = ini.GetGroup("md5sums", 0, false);
+	if (group == nullptr) return;
+
+	for (const IniItem *item = group->item; item != nullptr; item = item->next) {
+		if (item->value == nullptr) continue;
+
+		/* The value is "<size> <mtime> <max size> <md5sum>", all in hexadecimal. */
+		BaseSetMD5CacheEntry entry;
+		char *p = item->value;
+		entry.size = strtoull(p, &p, 16);
+		entry.mtime = (int64)strtoull(p, &p, 16);
+		entry.max_size = strtoull(p, &p, 16);
+		while (*p == ' ') p++;
+
+		uint i;
+		for (i = 0; i < lengthof(entry.md5sum) && isxdigit(p[0]) && isxdigit(p[1]); i++, p += 2) {
+			char byte[3] = { p[0], p[1], '\0' };
+			entry.md5sum[i] = (uint8)strtoul(byte, nullptr, 16);
+		}
+		if (i == lengthof(entry.md5sum) && *p == '\0') _baseset_md5_cache[item->name] = entry;
+	}
+}
+
+/**
+ * Write the md5sums of the checked base set files to disk, if any were calculated since the last time.
+ */
+void SaveBaseSetMD5Cache()
+{
+	if (!_baseset_md5_cache_changed || _baseset_md5_cache_file == nullptr) return;
+	_baseset_md5_cache_changed = false;
+
+	IniFile ini;
+	IniGroup *group = ini.GetGroup("md5sums");
+	for (const auto &it : _baseset_md5_cache) {
+		const BaseSetMD5CacheEntry &entry = it.second;
+		char md5sum[33];
+		md5sumToString(md5sum, lastof(md5sum), entry.md5sum);
+
+		char value[128];
+		seprintf(value, lastof(value), OTTD_PRINTFHEX64 " " OTTD_PRINTFHEX64 " " OTTD_PRINTFHEX64 " %s", (unsigned long long)entry.size, (unsigned long long)entry.mtime, (unsigned long long)entry.max_size, md5sum);
+		IniItem *item = new IniItem(group, it.first.c_str());
+		item->SetValue(value);
+	}
+	ini.SaveToDisk(_baseset_md5_cache_file);
+}
+
 /**
  * Calculate and check the MD5 hash of the supplied filename.
  * @param subdir The sub directory to get the files from
@@ -404,6 +499,25 @@ MD5File::ChecksumResult MD5File::CheckMD5(Subdirectory subdir, size_t max_size)
 
 	if (f == nullptr) return CR_NO_FILE;
 
+	/* Files that did not change since they were checked before are not read again.
+	 * Files in tars cannot be found on their own, so they are always read. */
+	char path[MAX_PATH];
+	BaseSetMD5CacheEntry *cached = nullptr;
+#if defined(_WIN32)
+	struct _stat64 sb;
+	if (FioFindFullPath(path, lastof(path), subdir, this->filename) != nullptr && _tstat64(OTTD2FS(path), &sb) == 0) {
+#else
+	struct stat sb;
+	if (FioFindFullPath(path, lastof(path), subdir, this->filename) != nullptr && stat(OTTD2FS(path), &sb) == 0) {
+#endif
+		LoadBaseSetMD5Cache();
+		cached = &_baseset_md5_cache[path];
+		if (cached->size == (uint64)sb.st_size && cached->mtime == (int64)sb.st_mtime && cached->max_size == (uint64)max_size) {
+			FioFCloseFile(f);
+			return memcmp(this->hash, cached->md5sum, sizeof(this->hash)) == 0 ? CR_MATCH : CR_MISMATCH;
+		}
+	}
+
 	size = min(size, max_size);
 
 	Md5 checksum;
@@ -419,6 +533,15 @@ MD5File::ChecksumResult MD5File::CheckMD5(Subdirectory subdir, size_t max_size)
 	FioFCloseFile(f);
 
 	checksum.Finish(digest);
+
+	if (cached != nullptr) {
+		cached->size = sb.st_size;
+		cached->mtime = sb.st_mtime;
+		cached->max_size = max_size;
+		memcpy(cached->md5sum, digest, sizeof(cached->md5sum));
+		_baseset_md5_cache_changed = true;
+	}
+
 	return memcmp(this->hash, digest, sizeof(this->hash)) == 0 ? CR_MATCH : CR_MISMATCH;
 }
 
@@ -30,6 +30,7 @@ struct GroundVehicleCache {
 	/* Cached acceleration values, recalculated when the cargo on a vehicle changes (in addition to the conditions below) */
 	uint32 cached_weight;           ///< Total weight of the consist (valid only for the first engine).
 	uint32 cached_slope_resistance; ///< Resistance caused by weight when this vehicle part is at a slope.
+	int64 cached_total_slope_resistance; ///< Sum of the slope resistance of all parts that are on a slope, negative when going down (valid only for the first engine).
 	uint32 cached_max_te;           ///< Maximum tractive effort of consist (valid only for the first engine).
 	uint16 cached_axle_resistance;  ///< Resistance caused by the axles of the vehicle (valid only for the first engine).
 
@@ -54,6 +55,21 @@ enum GroundVehicleFlags {
 	GVF_SUPPRESS_IMPLICIT_ORDERS = 2,  ///< Disable insertion and removal of automatic orders until the vehicle completes the real order.
 };
 
+/** Mask of the ground vehicle flags describing whether the vehicle is on a slope. */
+static const uint16 GVF_INCLINATION_MASK = (1 << GVF_GOINGUP_BIT) | (1 << GVF_GOINGDOWN_BIT);
+
+/**
+ * Get the direction in which the slope resistance of a vehicle part works.
+ * @param gv_flags The ground vehicle flags of the part.
+ * @return 1 when going up, -1 when going down and 0 otherwise.
+ */
+static inline int GetInclinationFactor(uint16 gv_flags)
+{
+	if (HasBit(gv_flags, GVF_GOINGUP_BIT)) return 1;
+	if (HasBit(gv_flags, GVF_GOINGDOWN_BIT)) return -1;
+	return 0;
+}
+
 /**
  * Base class for all vehicles that move through ground.
  *
@@ -101,29 +117,30 @@ struct GroundVehicle : public SpecializedVehicle<T, Type> {
 	{
 		/* Crashed vehicles aren't going up or down */
 		for (T *v = T::From(this); v != nullptr; v = v->Next()) {
-			ClrBit(v->gv_flags, GVF_GOINGUP_BIT);
-			ClrBit(v->gv_flags, GVF_GOINGDOWN_BIT);
+			v->SetInclinationFlags(0);
 		}
 		return this->Vehicle::Crash(flooded);
 	}
 
 	/**
-	 * Calculates the total slope resistance for this vehicle.
+	 * Gets the total slope resistance for this vehicle.
 	 * @return Slope resistance.
 	 */
 	inline int64 GetSlopeResistance() const
 	{
-		int64 incl = 0;
-
-		for (const T *u = T::From(this); u != nullptr; u = u->Next()) {
-			if (HasBit(u->gv_flags, GVF_GOINGUP_BIT)) {
-				incl += u->gcache.cached_slope_resistance;
-			} else if (HasBit(u->gv_flags, GVF_GOINGDOWN_BIT)) {
-				incl -= u->gcache.cached_slope_resistance;
-			}
-		}
+		return this->gcache.cached_total_slope_resistance;
+	}
 
-		return incl;
+	/**
+	 * Sets whether this vehicle part is going up or down, and updates the
+	 * total slope resistance cached at the front of the consist accordingly.
+	 * @param flags The new inclination; only the bits of #GVF_INCLINATION_MASK are used.
+	 */
+	inline void SetInclinationFlags(uint16 flags)
+	{
+		int delta = GetInclinationFactor(flags) - GetInclinationFactor(this->gv_flags);
+		this->gv_flags = (this->gv_flags & ~GVF_INCLINATION_MASK) | (flags & GVF_INCLINATION_MASK);
+		if (delta != 0) this->First()->gcache.cached_total_slope_resistance += delta * (int64)this->gcache.cached_slope_resistance;
 	}
 
 	/**
@@ -135,8 +152,7 @@ struct GroundVehicle : public SpecializedVehicle<T, Type> {
 	inline void UpdateZPositionAndInclination()
 	{
 		this->z_pos = GetSlopePixelZ(this->x_pos, this->y_pos);
-		ClrBit(this->gv_flags, GVF_GOINGUP_BIT);
-		ClrBit(this->gv_flags, GVF_GOINGDOWN_BIT);
+		uint16 flags = 0;
 
 		if (T::From(this)->TileMayHaveSlopedTrack()) {
 			/* To check whether the current tile is sloped, and in which
@@ -146,9 +162,11 @@ struct GroundVehicle : public SpecializedVehicle<T, Type> {
 			int middle_z = GetSlopePixelZ((this->x_pos & ~TILE_UNIT_MASK) | (TILE_SIZE / 2), (this->y_pos & ~TILE_UNIT_MASK) | (TILE_SIZE / 2));
 
 			if (middle_z != this->z_pos) {
-				SetBit(this->gv_flags, (middle_z > this->z_pos) ? GVF_GOINGUP_BIT : GVF_GOINGDOWN_BIT);
+				SetBit(flags, (middle_z > this->z_pos) ? GVF_GOINGUP_BIT : GVF_GOINGDOWN_BIT);
 			}
 		}
+
+		this->SetInclinationFlags(flags);
 	}
 
 	/**
@@ -56,9 +56,10 @@ struct GroupStatistics {
 	static void CountEngine(const Vehicle *v, int delta);
 	static void VehicleReachedProfitAge(const Vehicle *v);
 
-	static void UpdateProfits();
+	static void ClearAllProfits();
 	static void UpdateAfterLoad();
 	static void UpdateAutoreplace(CompanyID company);
+	static void UpdateAutoreplace(CompanyID company, EngineID engine);
 };
 
 /** Group data. */
@@ -175,11 +175,11 @@ void GroupStatistics::Clear()
 }
 
 /**
- * Recompute the profits for all groups.
+ * Clear the profits of all groups, without recounting them.
+ * The caller re-adds the vehicles with #VehicleReachedProfitAge.
  */
-/* static */ void GroupStatistics::UpdateProfits()
+/* static */ void GroupStatistics::ClearAllProfits()
 {
-	/* Set up the engine count for all companies */
 	for (Company *c : Company::Iterate()) {
 		for (VehicleType type = VEH_BEGIN; type < VEH_COMPANY_END; type++) {
 			c->group_all[type].ClearProfits();
@@ -187,14 +187,9 @@ void GroupStatistics::Clear()
 		}
 	}
 
-	/* Recalculate */
 	for (Group *g : Group::Iterate()) {
 		g->statistics.ClearProfits();
 	}
-
-	for (const Vehicle *v : Vehicle::Iterate()) {
-		if (v->IsPrimaryVehicle() && v->age > VEHICLE_PROFIT_MIN_AGE) GroupStatistics::VehicleReachedProfitAge(v);
-	}
 }
 
 /**
@@ -227,6 +222,23 @@ void GroupStatistics::Clear()
 	}
 }
 
+/**
+ * Update autoreplace_defined and autoreplace_finished after the number of engines
+ * of a single type changed. Only replacement rules for that engine can change
+ * their state, so nothing is recomputed when the company has none.
+ * @param company Company to update statistics for.
+ * @param engine Engine type whose count changed.
+ */
+/* static */ void GroupStatistics::UpdateAutoreplace(CompanyID company, EngineID engine)
+{
+	for (EngineRenewList erl = Company::Get(company)->engine_renew_list; erl != nullptr; erl = erl->next) {
+		if (erl->from == engine) {
+			GroupStatistics::UpdateAutoreplace(company);
+			return;
+		}
+	}
+}
+
 /**
  * Update the num engines of a groupID. Decrease the old one and increase the new one
  * @note called in SetTrainGroupID and UpdateTrainGroupID
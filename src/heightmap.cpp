@@ -17,6 +17,8 @@
 #include "gfx_func.h"
 #include "fios.h"
 #include "fileio_func.h"
+#include "worker_pool.h"
+#include <vector>
 
 #include "table/strings.h"
 
@@ -38,14 +40,41 @@ static inline byte RGBToGrayscale(byte red, byte green, byte blue)
 
 #include <png.h>
 
+/**
+ * Convert a row of decoded PNG pixels to 8-bit grayscale.
+ * @param pixel Destination of the grayscale pixels.
+ * @param row The decoded pixels.
+ * @param width Number of pixels in the row.
+ * @param channels Number of samples per pixel.
+ * @param gray_palette The palette converted to grayscale, or \c nullptr when the image has no palette.
+ */
+static void ReadHeightmapPNGRow(byte *pixel, const png_byte *row, uint width, uint channels, const byte *gray_palette)
+{
+	for (uint x = 0; x < width; x++) {
+		uint x_offset = x * channels;
+
+		if (gray_palette != nullptr) {
+			pixel[x] = gray_palette[row[x_offset]];
+		} else if (channels == 3) {
+			pixel[x] = RGBToGrayscale(row[x_offset + 0], row[x_offset + 1], row[x_offset + 2]);
+		} else {
+			pixel[x] = row[x_offset];
+		}
+	}
+}
+
 /**
  * The PNG Heightmap loader.
+ * Non-interlaced images are decoded row by row, so only one decoded row is
+ * kept in memory besides the grayscale map.
+ * @param map Destination of the grayscale pixels.
+ * @param png_ptr The PNG being read, after reading its info.
+ * @param info_ptr The info of the PNG.
+ * @param passes Number of passes needed to decode the image.
  */
-static void ReadHeightmapPNGImageData(byte *map, png_structp png_ptr, png_infop info_ptr)
+static void ReadHeightmapPNGImageData(byte *map, png_structp png_ptr, png_infop info_ptr, int passes)
 {
-	uint x, y;
 	byte gray_palette[256];
-	png_bytep *row_pointers = nullptr;
 	bool has_palette = png_get_color_type(png_ptr, info_ptr) == PNG_COLOR_TYPE_PALETTE;
 	uint channels = png_get_channels(png_ptr, info_ptr);
 
@@ -75,24 +104,33 @@ static void ReadHeightmapPNGImageData(byte *map, png_structp png_ptr, png_infop
 		}
 	}
 
-	row_pointers = png_get_rows(png_ptr, info_ptr);
+	uint width = png_get_image_width(png_ptr, info_ptr);
+	uint height = png_get_image_height(png_ptr, info_ptr);
+	size_t row_bytes = png_get_rowbytes(png_ptr, info_ptr);
+	const byte *palette = has_palette ? gray_palette : nullptr;
 
 	/* Read the raw image data and convert in 8-bit grayscale */
-	for (x = 0; x < png_get_image_width(png_ptr, info_ptr); x++) {
-		for (y = 0; y < png_get_image_height(png_ptr, info_ptr); y++) {
-			byte *pixel = &map[y * png_get_image_width(png_ptr, info_ptr) + x];
-			uint x_offset = x * channels;
-
-			if (has_palette) {
-				*pixel = gray_palette[row_pointers[y][x_offset]];
-			} else if (channels == 3) {
-				*pixel = RGBToGrayscale(row_pointers[y][x_offset + 0],
-						row_pointers[y][x_offset + 1], row_pointers[y][x_offset + 2]);
-			} else {
-				*pixel = row_pointers[y][x_offset];
-			}
+	if (passes == 1) {
+		png_bytep row = MallocT<png_byte>(row_bytes);
+		for (uint y = 0; y < height; y++) {
+			png_read_row(png_ptr, row, nullptr);
+			ReadHeightmapPNGRow(&map[(size_t)y * width], row, width, channels, palette);
 		}
+		free(row);
+	} else {
+		/* An interlaced image is only complete after the last pass, so decode all of it. */
+		png_bytep image = MallocT<png_byte>(row_bytes * height);
+		png_bytep *rows = MallocT<png_bytep>(height);
+		for (uint y = 0; y < height; y++) rows[y] = &image[row_bytes * y];
+		png_read_image(png_ptr, rows);
+		for (uint y = 0; y < height; y++) {
+			ReadHeightmapPNGRow(&map[(size_t)y * width], rows[y], width, channels, palette);
+		}
+		free(rows);
+		free(image);
 	}
+
+	png_read_end(png_ptr, nullptr);
 }
 
 /**
@@ -129,10 +167,14 @@ static bool ReadHeightmapPNG(const char *filename, uint *x, uint *y, byte **map)
 
 	png_init_io(png_ptr, fp);
 
-	/* Allocate memory and read image, without alpha or 16-bit samples
+	/* Read the header, and decode the image without alpha or 16-bit samples
 	 * (result is either 8-bit indexed/grayscale or 24-bit RGB) */
+	png_read_info(png_ptr, info_ptr);
 	png_set_packing(png_ptr);
-	png_read_png(png_ptr, info_ptr, PNG_TRANSFORM_PACKING | PNG_TRANSFORM_STRIP_ALPHA | PNG_TRANSFORM_STRIP_16, nullptr);
+	png_set_strip_alpha(png_ptr);
+	png_set_strip_16(png_ptr);
+	int passes = png_set_interlace_handling(png_ptr);
+	png_read_update_info(png_ptr, info_ptr);
 
 	/* Maps of wrong colour-depth are not used.
 	 * (this should have been taken care of by stripping alpha and 16-bit samples on load) */
@@ -156,7 +198,7 @@ static bool ReadHeightmapPNG(const char *filename, uint *x, uint *y, byte **map)
 
 	if (map != nullptr) {
 		*map = MallocT<byte>(width * height);
-		ReadHeightmapPNGImageData(*map, png_ptr, info_ptr);
+		ReadHeightmapPNGImageData(*map, png_ptr, info_ptr, passes);
 	}
 
 	*x = width;
@@ -297,11 +339,8 @@ static void GrayscaleToMapHeights(uint img_width, uint img_height, byte *map)
 	const uint num_div = 16384;
 
 	uint width, height;
-	uint row, col;
 	uint row_pad = 0, col_pad = 0;
 	uint img_scale;
-	uint img_row, img_col;
-	TileIndex tile;
 
 	/* Get map size and calculate scale and padding values */
 	switch (_settings_game.game_creation.heightmap_rotation) {
@@ -331,54 +370,61 @@ static void GrayscaleToMapHeights(uint img_width, uint img_height, byte *map)
 		for (uint y = 0; y < MapSizeY(); y++) MakeVoid(TileXY(0, y));
 	}
 
-	/* Form the landscape */
-	for (row = 0; row < height; row++) {
-		for (col = 0; col < width; col++) {
-			switch (_settings_game.game_creation.heightmap_rotation) {
-				default: NOT_REACHED();
-				case HM_COUNTER_CLOCKWISE: tile = TileXY(col, row); break;
-				case HM_CLOCKWISE:         tile = TileXY(row, col); break;
-			}
+	/* Neither the image column of a map column nor the height of a grey scale depend on the row, so determine them once. */
+	uint edge = _settings_game.construction.freeform_edges ? 0 : 1;
+	std::vector<uint> img_cols(width);
+	for (uint col = col_pad; col < width - col_pad - edge; col++) {
+		/* Use nearest neighbour resizing to scale map data.
+		 *  We rotate the map 45 degrees (counter)clockwise */
+		switch (_settings_game.game_creation.heightmap_rotation) {
+			default: NOT_REACHED();
+			case HM_COUNTER_CLOCKWISE:
+				img_cols[col] = (((width - 1 - col - col_pad) * num_div) / img_scale);
+				break;
+			case HM_CLOCKWISE:
+				img_cols[col] = (((col - col_pad) * num_div) / img_scale);
+				break;
+		}
+		assert(img_cols[col] < img_width);
+	}
 
-			/* Check if current tile is within the 1-pixel map edge or padding regions */
-			if ((!_settings_game.construction.freeform_edges && DistanceFromEdge(tile) <= 1) ||
-					(row < row_pad) || (row >= (height - row_pad - (_settings_game.construction.freeform_edges ? 0 : 1))) ||
-					(col < col_pad) || (col >= (width  - col_pad - (_settings_game.construction.freeform_edges ? 0 : 1)))) {
-				SetTileHeight(tile, 0);
-			} else {
-				/* Use nearest neighbour resizing to scale map data.
-				 *  We rotate the map 45 degrees (counter)clockwise */
-				img_row = (((row - row_pad) * num_div) / img_scale);
+	byte heights[256];
+	for (uint i = 0; i < lengthof(heights); i++) {
+		/* 0 is sea level.
+		 * Other grey scales are scaled evenly to the available height levels > 0.
+		 * (The coastline is independent from the number of height levels) */
+		heights[i] = i == 0 ? 0 : 1 + (i - 1) * _settings_game.construction.max_heightlevel / 255;
+	}
+
+	/* Form the landscape; every tile is set on its own, so the rows can be done in parallel. */
+	RunParallelFor(height, 16, [&](uint begin, uint end) {
+		for (uint row = begin; row < end; row++) {
+			for (uint col = 0; col < width; col++) {
+				TileIndex tile;
 				switch (_settings_game.game_creation.heightmap_rotation) {
 					default: NOT_REACHED();
-					case HM_COUNTER_CLOCKWISE:
-						img_col = (((width - 1 - col - col_pad) * num_div) / img_scale);
-						break;
-					case HM_CLOCKWISE:
-						img_col = (((col - col_pad) * num_div) / img_scale);
-						break;
+					case HM_COUNTER_CLOCKWISE: tile = TileXY(col, row); break;
+					case HM_CLOCKWISE:         tile = TileXY(row, col); break;
 				}
 
-				assert(img_row < img_height);
-				assert(img_col < img_width);
+				/* Check if current tile is within the 1-pixel map edge or padding regions */
+				if ((edge != 0 && DistanceFromEdge(tile) <= 1) ||
+						(row < row_pad) || (row >= (height - row_pad - edge)) ||
+						(col < col_pad) || (col >= (width  - col_pad - edge))) {
+					SetTileHeight(tile, 0);
+				} else {
+					uint img_row = (((row - row_pad) * num_div) / img_scale);
+					assert(img_row < img_height);
 
-				uint heightmap_height = map[img_row * img_width + img_col];
-
-				if (heightmap_height > 0) {
-					/* 0 is sea level.
-					 * Other grey scales are scaled evenly to the available height levels > 0.
-					 * (The coastline is independent from the number of height levels) */
-					heightmap_height = 1 + (heightmap_height - 1) * _settings_game.construction.max_heightlevel / 255;
+					SetTileHeight(tile, heights[map[(size_t)img_row * img_width + img_cols[col]]]);
+				}
+				/* Only clear the tiles within the map area. */
+				if (IsInnerTile(tile)) {
+					MakeClear(tile, CLEAR_GRASS, 3);
 				}
-
-				SetTileHeight(tile, heightmap_height);
-			}
-			/* Only clear the tiles within the map area. */
-			if (IsInnerTile(tile)) {
-				MakeClear(tile, CLEAR_GRASS, 3);
 			}
 		}
-	}
+	});
 }
 
 /**
@@ -11,6 +11,7 @@
 #define INDUSTRY_H
 
 #include <algorithm>
+#include <set>
 #include "newgrf_storage.h"
 #include "subsidy_type.h"
 #include "industry_map.h"
@@ -22,6 +23,8 @@
 typedef Pool<Industry, IndustryID, 64, 64000> IndustryPool;
 extern IndustryPool _industry_pool;
 
+static const uint INDUSTRY_COUNTER_PHASES = 0x40; ///< Number of ticks between two moments the counter of an industry may trigger something, see ProduceIndustryGoods().
+
 /**
  * Production level maximum, minimum and default values.
  * It is not a value been really used in order to change, but rather an indicator
@@ -52,7 +55,7 @@ struct Industry : IndustryPool::PoolItem<&_industry_pool> {
 	byte last_month_pct_transported[INDUSTRY_NUM_OUTPUTS]; ///< percentage transported per cargo in the last full month
 	uint16 last_month_production[INDUSTRY_NUM_OUTPUTS];    ///< total units produced per cargo in the last full month
 	uint16 last_month_transported[INDUSTRY_NUM_OUTPUTS];   ///< total units transported per cargo in the last full month
-	uint16 counter;                                        ///< used for animation and/or production (if available cargo)
+	uint16 counter;                                        ///< used for animation and/or production (if available cargo); only up to date when #counter_ticks is 0, see GetCounter()
 
 	IndustryType type;             ///< type of industry.
 	Owner owner;                   ///< owner of the industry.  Which SHOULD always be (imho) OWNER_NONE
@@ -119,6 +122,32 @@ struct Industry : IndustryPool::PoolItem<&_industry_pool> {
 	static Industry *GetRandom();
 	static void PostDestructor(size_t index);
 
+	/**
+	 * Get the counter of the industry, which counts down every tick.
+	 * @return The counter.
+	 */
+	inline uint16 GetCounter() const
+	{
+		return this->counter - Industry::counter_ticks;
+	}
+
+	/**
+	 * Set the counter of the industry and file the industry under its phase.
+	 * @param counter The new value of the counter.
+	 */
+	inline void SetCounter(uint16 counter)
+	{
+		Industry::counter_phases[this->counter % INDUSTRY_COUNTER_PHASES].erase(this->index);
+		this->counter = counter + Industry::counter_ticks;
+		Industry::counter_phases[this->counter % INDUSTRY_COUNTER_PHASES].insert(this->index);
+	}
+
+	static void UpdateCounters();
+	static void RebuildCounterPhases();
+
+	static uint16 counter_ticks; ///< NOSAVE: Number of ticks the counters of all industries have been counted down since #counter was last updated.
+	static std::set<IndustryID> counter_phases[INDUSTRY_COUNTER_PHASES]; ///< NOSAVE: Industries by #counter modulo #INDUSTRY_COUNTER_PHASES, in index order.
+
 	/**
 	 * Increment the count of industries for this type.
 	 * @param type IndustryType to increment
@@ -39,6 +39,8 @@
 #include "object_base.h"
 #include "game/game.hpp"
 #include "error.h"
+#include "framerate_type.h"
+#include "trace_zone.h"
 
 #include "table/strings.h"
 #include "table/industry_land.h"
@@ -56,6 +58,8 @@ static byte _industry_sound_ctr;
 static TileIndex _industry_sound_tile;
 
 uint16 Industry::counts[NUM_INDUSTRYTYPES];
+uint16 Industry::counter_ticks;
+std::set<IndustryID> Industry::counter_phases[INDUSTRY_COUNTER_PHASES];
 
 IndustrySpec _industry_specs[NUM_INDUSTRYTYPES];
 IndustryTileSpec _industry_tile_specs[NUM_INDUSTRYTILES];
@@ -137,6 +141,8 @@ const IndustryTileSpec *GetIndustryTileSpec(IndustryGfx gfx)
 
 Industry::~Industry()
 {
+	Industry::counter_phases[this->counter % INDUSTRY_COUNTER_PHASES].erase(this->index);
+
 	if (CleaningPool()) return;
 
 	/* Industry can also be destroyed when not fully initialized.
@@ -1080,10 +1086,9 @@ void PlantRandomFarmField(const Industry *i)
 /**
  * Search callback function for ChopLumberMillTrees
  * @param tile to test
- * @param user_data that is passed by the caller.  In this case, nothing
  * @return the result of the test
  */
-static bool SearchLumberMillTrees(TileIndex tile, void *user_data)
+static bool SearchLumberMillTrees(TileIndex tile)
 {
 	if (IsTileType(tile, MP_TREES) && GetTreeGrowth(tile) > 2) { ///< 3 and up means all fully grown trees
 		/* found a tree */
@@ -1116,7 +1121,7 @@ static void ChopLumberMillTrees(Industry *i)
 	}
 
 	TileIndex tile = i->location.tile;
-	if (CircularTileSearch(&tile, 40, SearchLumberMillTrees, nullptr)) { // 40x40 tiles  to search.
+	if (CircularTileSearch(&tile, 40, SearchLumberMillTrees)) { // 40x40 tiles  to search.
 		i->produced_cargo_waiting[0] = min(0xffff, i->produced_cargo_waiting[0] + 45); // Found a tree, add according value to waiting cargo.
 	}
 }
@@ -1125,8 +1130,8 @@ static void ProduceIndustryGoods(Industry *i)
 {
 	const IndustrySpec *indsp = GetIndustrySpec(i->type);
 
-	/* play a sound? */
-	if ((i->counter & 0x3F) == 0) {
+	/* play a sound? The counter has already been counted down for this tick. */
+	if (((i->GetCounter() + 1) & 0x3F) == 0) {
 		uint32 r;
 		if (Chance16R(1, 14, r) && indsp->number_of_sounds != 0 && _settings_client.sound.ambient) {
 			for (size_t j = 0; j < lengthof(i->last_month_production); j++) {
@@ -1141,10 +1146,8 @@ static void ProduceIndustryGoods(Industry *i)
 		}
 	}
 
-	i->counter--;
-
 	/* produce some cargo */
-	if ((i->counter % INDUSTRY_PRODUCE_TICKS) == 0) {
+	if ((i->GetCounter() % INDUSTRY_PRODUCE_TICKS) == 0) {
 		if (HasBit(indsp->callback_mask, CBM_IND_PRODUCTION_256_TICKS)) IndustryProductionCallback(i, 1);
 
 		IndustryBehaviour indbehav = indsp->behaviour;
@@ -1177,7 +1180,7 @@ static void ProduceIndustryGoods(Industry *i)
 			if (cb_res != CALLBACK_FAILED) {
 				cut = ConvertBooleanCallback(indsp->grf_prop.grffile, CBID_INDUSTRY_SPECIAL_EFFECT, cb_res);
 			} else {
-				cut = ((i->counter % INDUSTRY_CUT_TREE_TICKS) == 0);
+				cut = ((i->GetCounter() % INDUSTRY_CUT_TREE_TICKS) == 0);
 			}
 
 			if (cut) ChopLumberMillTrees(i);
@@ -1203,8 +1206,49 @@ void OnTick_Industry()
 
 	if (_game_mode == GM_EDITOR) return;
 
-	for (Industry *i : Industry::Iterate()) {
-		ProduceIndustryGoods(i);
+	/* Count down the counters of all industries at once. Only the industries
+	 * in the phase for playing sounds or for producing cargo have something
+	 * to do in this tick; handle those in index order. */
+	Industry::counter_ticks++;
+	const std::set<IndustryID> &sound = Industry::counter_phases[(Industry::counter_ticks - 1) % INDUSTRY_COUNTER_PHASES];
+	const std::set<IndustryID> &produce = Industry::counter_phases[Industry::counter_ticks % INDUSTRY_COUNTER_PHASES];
+	auto sound_it = sound.begin();
+	auto produce_it = produce.begin();
+	while (sound_it != sound.end() || produce_it != produce.end()) {
+		IndustryID index;
+		if (produce_it == produce.end() || (sound_it != sound.end() && *sound_it < *produce_it)) {
+			index = *sound_it++;
+		} else {
+			index = *produce_it++;
+		}
+		PerformanceAccumulator framerate(PFE_GL_INDUSTRIES, index);
+		TraceZone zone("Industry production", index);
+		ProduceIndustryGoods(Industry::Get(index));
+	}
+}
+
+/**
+ * Bring the counters of all industries up to date, e.g. before saving them.
+ */
+/* static */ void Industry::UpdateCounters()
+{
+	if (Industry::counter_ticks == 0) return;
+
+	for (Industry *i : Industry::Iterate()) i->counter -= Industry::counter_ticks;
+
+	/* All counters moved by the same amount, so the phases move along as a whole. */
+	std::rotate(std::begin(Industry::counter_phases), std::begin(Industry::counter_phases) + Industry::counter_ticks % INDUSTRY_COUNTER_PHASES, std::end(Industry::counter_phases));
+	Industry::counter_ticks = 0;
+}
+
+/**
+ * File all industries under the phase of their counter, e.g. after loading a game.
+ */
+/* static */ void Industry::RebuildCounterPhases()
+{
+	for (std::set<IndustryID> &phase : Industry::counter_phases) phase.clear();
+	for (const Industry *i : Industry::Iterate()) {
+		Industry::counter_phases[i->counter % INDUSTRY_COUNTER_PHASES].insert(i->index);
 	}
 }
 
@@ -1417,6 +1461,40 @@ bool IsSlopeRefused(Slope current, Slope refused)
 	return false;
 }
 
+/**
+ * Quick check whether the tiles of the industry could be free. This only does the
+ * checks of #CheckIfIndustryTilesAreFree that need neither commands nor callbacks,
+ * so a site that fails here always fails there too.
+ * @param tile   Position to check.
+ * @param layout Industry tiles table.
+ * @param type   Type of the industry.
+ * @return False if the site is certainly unsuitable.
+ */
+static bool CouldIndustryTilesBeFree(TileIndex tile, const IndustryTileLayout &layout, int type)
+{
+	IndustryBehaviour ind_behav = GetIndustrySpec(type)->behaviour;
+
+	for (const IndustryTileLayoutTile &it : layout) {
+		IndustryGfx gfx = GetTranslatedIndustryTileID(it.gfx);
+		TileIndex cur_tile = TileAddWrap(tile, it.ti.x, it.ti.y);
+
+		if (!IsValidTile(cur_tile)) return false;
+
+		if (gfx == GFX_WATERTILE_SPECIALCHECK) {
+			if (!IsWaterTile(cur_tile) || !IsTileFlat(cur_tile)) return false;
+		} else {
+			if (IsBridgeAbove(cur_tile)) return false;
+
+			const IndustryTileSpec *its = GetIndustryTileSpec(gfx);
+			if (!HasBit(its->slopes_refused, 5) && ((HasTileWaterClass(cur_tile) && IsTileOnWater(cur_tile)) == !(ind_behav & INDUSTRYBEH_BUILT_ONWATER))) return false;
+
+			if ((ind_behav & (INDUSTRYBEH_ONLY_INTOWN | INDUSTRYBEH_TOWN1200_MORE)) && !IsTileType(cur_tile, MP_HOUSE)) return false;
+		}
+	}
+
+	return true;
+}
+
 /**
  * Are the tiles of the industry free?
  * @param tile                    Position to check.
@@ -1756,7 +1834,7 @@ static void DoCreateNewIndustry(Industry *i, TileIndex tile, IndustryType type,
 
 	uint16 r = Random();
 	i->random_colour = GB(r, 0, 4);
-	i->counter = GB(r, 4, 12);
+	i->SetCounter(GB(r, 4, 12));
 	i->random = initial_random_bits;
 	i->was_cargo_delivered = false;
 	i->last_prod_year = _cur_year;
@@ -2073,6 +2151,11 @@ static Industry *CreateNewIndustry(TileIndex tile, IndustryType type, IndustryAv
 	uint32 seed2 = Random();
 	Industry *i = nullptr;
 	size_t layout_index = RandomRange((uint32)indspec->layouts.size());
+
+	/* Most random locations are rejected for their terrain alone; do not
+	 * clear their tiles and run the callbacks only to find that out. */
+	if (!CouldIndustryTilesBeFree(tile, indspec->layouts[layout_index], type)) return nullptr;
+
 	CommandCost ret = CreateNewIndustryHelper(tile, type, DC_EXEC, indspec, layout_index, seed, GB(seed2, 0, 16), OWNER_NONE, creation_type, &i);
 	assert(i != nullptr || ret.Failed());
 	return i;
@@ -2873,6 +2956,7 @@ void IndustryMonthlyLoop()
 void InitializeIndustries()
 {
 	Industry::ResetIndustryCounts();
+	Industry::counter_ticks = 0;
 	_industry_sound_tile = 0;
 
 	_industry_builder.Reset();
@@ -3002,6 +3086,7 @@ extern const TileTypeProcs _tile_type_industry_procs = {
 	nullptr,                        // vehicle_enter_tile_proc
 	GetFoundation_Industry,      // get_foundation_proc
 	TerraformTile_Industry,      // terraform_tile_proc
+	nullptr,                     // tile_loop_local_proc
 };
 
 bool IndustryCompare::operator() (const Industry *lhs, const Industry *rhs) const
@@ -12,6 +12,7 @@
 #include "stdafx.h"
 #include "heightmap.h"
 #include "clear_map.h"
+#include "clear_func.h"
 #include "spritecache.h"
 #include "viewport_func.h"
 #include "command_func.h"
@@ -31,8 +32,11 @@
 #include "pathfinder/npf/aystar.h"
 #include "saveload/saveload.h"
 #include "framerate_type.h"
+#include "trace_zone.h"
+#include "worker_pool.h"
 #include <list>
 #include <set>
+#include <vector>
 
 #include "table/strings.h"
 #include "table/sprites.h"
@@ -576,21 +580,6 @@ void DoClearSquare(TileIndex tile)
 	MarkTileDirtyByTile(tile);
 }
 
-/**
- * Returns information about trackdirs and signal states.
- * If there is any trackbit at 'side', return all trackdirbits.
- * For TRANSPORT_ROAD, return no trackbits if there is no roadbit (of given subtype) at given side.
- * @param tile tile to get info about
- * @param mode transport type
- * @param sub_mode for TRANSPORT_ROAD, roadtypes to check
- * @param side side we are entering from, INVALID_DIAGDIR to return all trackbits
- * @return trackdirbits and other info depending on 'mode'
- */
-TrackStatus GetTileTrackStatus(TileIndex tile, TransportType mode, uint sub_mode, DiagDirection side)
-{
-	return _tile_type_procs[GetTileType(tile)]->get_tile_track_status_proc(tile, mode, sub_mode, side);
-}
-
 /**
  * Change the owner of a tile
  * @param tile      Tile to change
@@ -751,8 +740,10 @@ CommandCost CmdClearArea(TileIndex tile, DoCommandFlag flags, uint32 p1, uint32
 	const Company *c = (flags & (DC_AUTO | DC_BANKRUPT)) ? nullptr : Company::GetIfValid(_current_company);
 	int limit = (c == nullptr ? INT32_MAX : GB(c->clear_limit, 16, 16));
 
-	TileIterator *iter = HasBit(p2, 0) ? (TileIterator *)new DiagonalTileIterator(tile, p1) : new OrthogonalTileIterator(tile, p1);
-	for (; *iter != INVALID_TILE; ++(*iter)) {
+	OrthogonalTileIterator orthogonal_iter(tile, p1);
+	DiagonalTileIterator diagonal_iter(tile, p1);
+	TileIterator &iter = HasBit(p2, 0) ? (TileIterator &)diagonal_iter : orthogonal_iter;
+	for (; *iter != INVALID_TILE; ++iter) {
 		TileIndex t = *iter;
 		CommandCost ret = DoCommand(t, 0, 0, flags & ~DC_EXEC, CMD_LANDSCAPE_CLEAR);
 		if (ret.Failed()) {
@@ -768,7 +759,6 @@ CommandCost CmdClearArea(TileIndex tile, DoCommandFlag flags, uint32 p1, uint32
 			money -= ret.GetCost();
 			if (ret.GetCost() > 0 && money < 0) {
 				_additional_cash_required = ret.GetCost();
-				delete iter;
 				return cost;
 			}
 			DoCommand(t, 0, 0, flags, CMD_LANDSCAPE_CLEAR);
@@ -788,7 +778,6 @@ CommandCost CmdClearArea(TileIndex tile, DoCommandFlag flags, uint32 p1, uint32
 		cost.AddCost(ret);
 	}
 
-	delete iter;
 	return had_success ? cost : last_error;
 }
 
@@ -801,40 +790,81 @@ TileIndex _cur_tileloop_tile;
 void RunTileLoop()
 {
 	PerformanceAccumulator framerate(PFE_GL_LANDSCAPE);
+	TraceZone zone("RunTileLoop");
 
 	/* The pseudorandom sequence of tiles is generated using a Galois linear feedback
 	 * shift register (LFSR). This allows a deterministic pseudorandom ordering, but
 	 * still with minimal state and fast iteration. */
 
-	/* Maximal length LFSR feedback terms, from 12-bit (for 64x64 maps) to 24-bit (for 4096x4096 maps).
+	/* Maximal length LFSR feedback terms, from 12-bit (for 64x64 maps) to 26-bit (for 8192x8192 maps).
 	 * Extracted from http://www.ece.cmu.edu/~koopman/lfsr/ */
 	static const uint32 feedbacks[] = {
-		0xD8F, 0x1296, 0x2496, 0x4357, 0x8679, 0x1030E, 0x206CD, 0x403FE, 0x807B8, 0x1004B2, 0x2006A8, 0x4004B2, 0x800B87
+		0xD8F, 0x1296, 0x2496, 0x4357, 0x8679, 0x1030E, 0x206CD, 0x403FE, 0x807B8, 0x1004B2, 0x2006A8, 0x4004B2, 0x800B87, 0x1200000, 0x2000023
 	};
-	assert_compile(lengthof(feedbacks) == 2 * MAX_MAP_SIZE_BITS - 2 * MIN_MAP_SIZE_BITS + 1);
+	assert_compile(lengthof(feedbacks) == MAX_MAP_TILES_BITS - 2 * MIN_MAP_SIZE_BITS + 1);
 	const uint32 feedback = feedbacks[MapLogX() + MapLogY() - 2 * MIN_MAP_SIZE_BITS];
 
 	/* We update every tile every 256 ticks, so divide the map size by 2^8 = 256 */
 	uint count = 1 << (MapLogX() + MapLogY() - 8);
 
+	/* The tiles to update this tick, in the order of the sequence. */
+	static std::vector<TileIndex> tiles;
+	static std::vector<byte> results;
+	tiles.clear();
+
 	TileIndex tile = _cur_tileloop_tile;
 	/* The LFSR cannot have a zeroed state. */
 	assert(tile != 0);
 
 	/* Manually update tile 0 every 256 ticks - the LFSR never iterates over it itself.  */
 	if (_tick_counter % 256 == 0) {
-		_tile_type_procs[GetTileType(0)]->tile_loop_proc(0);
+		tiles.push_back(0);
 		count--;
 	}
 
 	while (count--) {
-		_tile_type_procs[GetTileType(tile)]->tile_loop_proc(tile);
+		tiles.push_back(tile);
 
 		/* Get the next tile in sequence using a Galois LFSR. */
 		tile = (tile >> 1) ^ (-(int32)(tile & 1) & feedback);
 	}
 
 	_cur_tileloop_tile = tile;
+
+	/* First run the tile loops that only affect the tile itself; they can run
+	 * at the same time. Then run the others in the order of the sequence. The
+	 * split is the same regardless of the number of threads, so all clients
+	 * still end up with the same map. */
+	results.resize(tiles.size());
+	{
+		/* Only clear tiles have a local tile loop, so account all of it to them. */
+		PerformanceAccumulator framerate_local(PFE_GL_TILELOOP_CLEAR);
+		RunParallelFor((uint)tiles.size(), 256, [](uint begin, uint end) {
+			for (uint i = begin; i < end; i++) {
+				/* Clear tiles are the bulk of most maps; call their tile loop directly. */
+				if (IsTileType(tiles[i], MP_CLEAR)) {
+					results[i] = TileLoopLocal_Clear(tiles[i]);
+					continue;
+				}
+				TileLoopLocalProc *proc = _tile_type_procs[GetTileType(tiles[i])]->tile_loop_local_proc;
+				results[i] = proc == nullptr ? TLLR_SERIAL : proc(tiles[i]);
+			}
+		});
+	}
+
+	for (uint i = 0; i < tiles.size(); i++) {
+		switch (results[i]) {
+			case TLLR_SERIAL: {
+				TileType type = GetTileType(tiles[i]);
+				PerformanceAccumulator framerate_type((PerformanceElement)(PFE_GL_TILELOOP_CLEAR + type));
+				_tile_type_procs[type]->tile_loop_proc(tiles[i]);
+				break;
+			}
+
+			case TLLR_DIRTY:  MarkTileDirtyByTile(tiles[i]); break;
+			case TLLR_DONE:   break;
+		}
+	}
 }
 
 void InitializeLandscape()
@@ -966,26 +996,44 @@ static void GenerateTerrain(int type, uint flag)
 
 #include "table/genland.h"
 
-static void CreateDesertOrRainForest()
+/**
+ * Set the tropic zone of all valid tiles that have no tile matching a condition around them.
+ * The surroundings of the tiles are checked in parallel, and the zones are only set
+ * once all tiles are checked, so the outcome does not depend on the number of threads.
+ * @param zone The tropic zone to set.
+ * @param blocks Whether a tile around the tile prevents setting the zone.
+ */
+static void SetTropicZoneAwayFrom(TropicZone zone, bool (*blocks)(TileIndex t))
 {
 	TileIndex update_freq = MapSize() / 4;
-	const TileIndexDiffC *data;
-	uint max_desert_height = CeilDiv(_settings_game.construction.max_heightlevel, 4);
+	std::vector<byte> set_zone(MapSize());
+
+	RunParallelFor(MapSizeY(), 16, [&set_zone, blocks](uint begin, uint end) {
+		for (TileIndex tile = TileXY(0, begin); tile != TileXY(0, end); ++tile) {
+			if (!IsValidTile(tile)) continue;
+
+			const TileIndexDiffC *data;
+			for (data = _make_desert_or_rainforest_data;
+					data != endof(_make_desert_or_rainforest_data); ++data) {
+				TileIndex t = AddTileIndexDiffCWrap(tile, *data);
+				if (t != INVALID_TILE && blocks(t)) break;
+			}
+			set_zone[tile] = data == endof(_make_desert_or_rainforest_data);
+		}
+	});
 
 	for (TileIndex tile = 0; tile != MapSize(); ++tile) {
 		if ((tile % update_freq) == 0) IncreaseGeneratingWorldProgress(GWP_LANDSCAPE);
 
-		if (!IsValidTile(tile)) continue;
-
-		for (data = _make_desert_or_rainforest_data;
-				data != endof(_make_desert_or_rainforest_data); ++data) {
-			TileIndex t = AddTileIndexDiffCWrap(tile, *data);
-			if (t != INVALID_TILE && (TileHeight(t) >= max_desert_height || IsTileType(t, MP_WATER))) break;
-		}
-		if (data == endof(_make_desert_or_rainforest_data)) {
-			SetTropicZone(tile, TROPICZONE_DESERT);
-		}
+		if (set_zone[tile]) SetTropicZone(tile, zone);
 	}
+}
+
+static void CreateDesertOrRainForest()
+{
+	SetTropicZoneAwayFrom(TROPICZONE_DESERT, [](TileIndex t) {
+		return TileHeight(t) >= CeilDiv(_settings_game.construction.max_heightlevel, 4) || IsTileType(t, MP_WATER);
+	});
 
 	for (uint i = 0; i != 256; i++) {
 		if ((i % 64) == 0) IncreaseGeneratingWorldProgress(GWP_LANDSCAPE);
@@ -993,20 +1041,9 @@ static void CreateDesertOrRainForest()
 		RunTileLoop();
 	}
 
-	for (TileIndex tile = 0; tile != MapSize(); ++tile) {
-		if ((tile % update_freq) == 0) IncreaseGeneratingWorldProgress(GWP_LANDSCAPE);
-
-		if (!IsValidTile(tile)) continue;
-
-		for (data = _make_desert_or_rainforest_data;
-				data != endof(_make_desert_or_rainforest_data); ++data) {
-			TileIndex t = AddTileIndexDiffCWrap(tile, *data);
-			if (t != INVALID_TILE && IsTileType(t, MP_CLEAR) && IsClearGround(t, CLEAR_DESERT)) break;
-		}
-		if (data == endof(_make_desert_or_rainforest_data)) {
-			SetTropicZone(tile, TROPICZONE_RAINFOREST);
-		}
-	}
+	SetTropicZoneAwayFrom(TROPICZONE_RAINFOREST, [](TileIndex t) {
+		return IsTileType(t, MP_CLEAR) && IsClearGround(t, CLEAR_DESERT);
+	});
 }
 
 /**
@@ -1153,6 +1190,8 @@ static uint River_Hash(uint tile, uint dir)
 	return GB(TileHash(TileX(tile), TileY(tile)), 0, RIVER_HASH_SIZE);
 }
 
+static AyStar _river_finder; ///< AyStar for building the rivers; its memory is reused by all rivers of a map.
+
 /**
  * Actually build the river between the begin and end tiles using AyStar.
  * @param begin The begin of the river.
@@ -1160,22 +1199,13 @@ static uint River_Hash(uint tile, uint dir)
  */
 static void BuildRiver(TileIndex begin, TileIndex end)
 {
-	AyStar finder = {};
-	finder.CalculateG = River_CalculateG;
-	finder.CalculateH = River_CalculateH;
-	finder.GetNeighbours = River_GetNeighbours;
-	finder.EndNodeCheck = River_EndNodeCheck;
-	finder.FoundEndNode = River_FoundEndNode;
-	finder.user_target = &end;
-
-	finder.Init(River_Hash, 1 << RIVER_HASH_SIZE);
+	_river_finder.user_target = &end;
 
 	AyStarNode start;
 	start.tile = begin;
 	start.direction = INVALID_TRACKDIR;
-	finder.AddStartNode(&start, 0);
-	finder.Main();
-	finder.Free();
+	_river_finder.AddStartNode(&start, 0);
+	_river_finder.Main();
 }
 
 /**
@@ -1274,6 +1304,20 @@ static void CreateRivers()
 	uint wells = ScaleByMapSize(4 << _settings_game.game_creation.amount_of_rivers);
 	SetGeneratingWorldProgress(GWP_RIVER, wells + 256 / 64); // Include the tile loop calls below.
 
+	/* Set up the river finder, and free its memory again when done, also when the generation gets aborted. */
+	struct RiverFinderScope {
+		RiverFinderScope()
+		{
+			_river_finder.CalculateG = River_CalculateG;
+			_river_finder.CalculateH = River_CalculateH;
+			_river_finder.GetNeighbours = River_GetNeighbours;
+			_river_finder.EndNodeCheck = River_EndNodeCheck;
+			_river_finder.FoundEndNode = River_FoundEndNode;
+			_river_finder.Init(River_Hash, 1 << RIVER_HASH_SIZE);
+		}
+		~RiverFinderScope() { _river_finder.Free(); }
+	} river_finder_scope;
+
 	for (; wells != 0; wells--) {
 		IncreaseGeneratingWorldProgress(GWP_RIVER);
 		for (int tries = 0; tries < 128; tries++) {
@@ -1386,9 +1430,12 @@ void OnTick_LinkGraph();
 
 void CallLandscapeTick()
 {
+	TraceZone zone("CallLandscapeTick");
+
 	{
 		PerformanceAccumulator framerate(PFE_GL_LANDSCAPE);
 
+		/* Towns, stations and industries measure each of their items themselves. */
 		OnTick_Town();
 		OnTick_Trees();
 		OnTick_Station();
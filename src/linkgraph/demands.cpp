@@ -192,7 +192,9 @@ void DemandCalculator::CalcDemand(LinkGraphJob &job, Tscaler scaler)
 		NodeID from_id = supplies.front();
 		supplies.pop();
 
-		for (uint i = 0; i < num_demands; ++i) {
+		/* In approximate mode only the next few destinations in the queue are
+		 * looked at; the queue rotates, so each round gets different ones. */
+		for (uint i = 0; i < min(num_demands, this->sample_size); ++i) {
 			assert(!demands.empty());
 			NodeID to_id = demands.front();
 			demands.pop();
@@ -207,6 +209,11 @@ void DemandCalculator::CalcDemand(LinkGraphJob &job, Tscaler scaler)
 			int32 supply = scaler.EffectiveSupply(job[from_id], job[to_id]);
 			assert(supply > 0);
 
+			/* Let each destination in the sample stand in for the ones not looked at. */
+			if (num_demands > this->sample_size) {
+				supply = (int32)min<int64>((int64)supply * num_demands / this->sample_size, INT32_MAX);
+			}
+
 			/* Scale the distance by mod_dist around max_distance */
 			int32 distance = this->max_distance - (this->max_distance -
 					(int32)DistanceMaxPlusManhattan(job[from_id].XY(), job[to_id].XY())) *
@@ -224,7 +231,7 @@ void DemandCalculator::CalcDemand(LinkGraphJob &job, Tscaler scaler)
 				 * effective supply / accuracy divisor >= 1
 				 * Others are too small or too far away to be considered. */
 				demand_forw = supply / divisor;
-			} else if (++chance > this->accuracy * num_demands * num_supplies) {
+			} else if (++chance > this->accuracy * min(num_demands, this->sample_size) * num_supplies) {
 				/* After some trying, if there is still supply left, distribute
 				 * demand also to other nodes. */
 				demand_forw = 1;
@@ -262,6 +269,11 @@ DemandCalculator::DemandCalculator(LinkGraphJob &job) :
 	CargoID cargo = job.Cargo();
 
 	this->accuracy = settings.accuracy;
+	this->sample_size = UINT_MAX;
+	if (settings.demand_approximation != 0 && job.Size() > settings.demand_approximation) {
+		/* Large component; trade exactness for a running time linear in its size. */
+		this->sample_size = settings.demand_approximation;
+	}
 	this->mod_dist = settings.demand_distance;
 	if (this->mod_dist > 100) {
 		/* Increase effect of mod_dist > 100 */
@@ -17,6 +17,7 @@ private:
 	int32 max_distance; ///< Maximum distance possible on the map.
 	int32 mod_dist;     ///< Distance modifier, determines how much demands decrease with distance.
 	int32 accuracy;     ///< Accuracy of the calculation.
+	uint sample_size;   ///< Number of destinations looked at each time a node's supply is distributed; UINT_MAX to look at all.
 
 	template<class Tscaler>
 	void CalcDemand(LinkGraphJob &job, Tscaler scaler);
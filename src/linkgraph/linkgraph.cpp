@@ -17,6 +17,8 @@
 LinkGraphPool _link_graph_pool("LinkGraph");
 INSTANTIATE_POOL_METHODS(LinkGraph)
 
+/* static */ uint32 LinkGraph::changes = 0;
+
 /**
  * Create a node or clear it.
  * @param xy Location of the associated station.
@@ -32,16 +34,23 @@ inline void LinkGraph::BaseNode::Init(TileIndex xy, StationID st, uint demand)
 	this->last_update = INVALID_DATE;
 }
 
+/* An edge that does not exist. */
+const LinkGraph::BaseEdge LinkGraph::empty_edge = { 0, 0, INVALID_DATE, INVALID_DATE, INVALID_NODE };
+
+/* The edges of a node that is not connected. */
+const LinkGraph::EdgeList LinkGraph::empty_edge_list;
+
 /**
  * Create an edge.
+ * @param dest Destination of the edge.
  */
-inline void LinkGraph::BaseEdge::Init()
+void LinkGraph::BaseEdge::Init(NodeID dest)
 {
 	this->capacity = 0;
 	this->usage = 0;
 	this->last_unrestricted_update = INVALID_DATE;
 	this->last_restricted_update = INVALID_DATE;
-	this->next_edge = INVALID_NODE;
+	this->dest = dest;
 }
 
 /**
@@ -51,12 +60,13 @@ inline void LinkGraph::BaseEdge::Init()
  */
 void LinkGraph::ShiftDates(int interval)
 {
+	LinkGraph::changes++;
 	this->last_compression += interval;
 	for (NodeID node1 = 0; node1 < this->Size(); ++node1) {
 		BaseNode &source = this->nodes[node1];
 		if (source.last_update != INVALID_DATE) source.last_update += interval;
-		for (NodeID node2 = 0; node2 < this->Size(); ++node2) {
-			BaseEdge &edge = this->edges[node1][node2];
+		if (this->edges[node1]->empty()) continue;
+		for (BaseEdge &edge : this->edges[node1].Mutable()) {
 			if (edge.last_unrestricted_update != INVALID_DATE) edge.last_unrestricted_update += interval;
 			if (edge.last_restricted_update != INVALID_DATE) edge.last_restricted_update += interval;
 		}
@@ -65,11 +75,12 @@ void LinkGraph::ShiftDates(int interval)
 
 void LinkGraph::Compress()
 {
+	LinkGraph::changes++;
 	this->last_compression = (_date + this->last_compression) / 2;
 	for (NodeID node1 = 0; node1 < this->Size(); ++node1) {
 		this->nodes[node1].supply /= 2;
-		for (NodeID node2 = 0; node2 < this->Size(); ++node2) {
-			BaseEdge &edge = this->edges[node1][node2];
+		if (this->edges[node1]->empty()) continue;
+		for (BaseEdge &edge : this->edges[node1].Mutable()) {
 			if (edge.capacity > 0) {
 				edge.capacity = max(1U, edge.capacity / 2);
 				edge.usage /= 2;
@@ -84,6 +95,7 @@ void LinkGraph::Compress()
  */
 void LinkGraph::Merge(LinkGraph *other)
 {
+	LinkGraph::changes++;
 	Date age = _date - this->last_compression + 1;
 	Date other_age = _date - other->last_compression + 1;
 	NodeID first = this->Size();
@@ -93,21 +105,15 @@ void LinkGraph::Merge(LinkGraph *other)
 		this->nodes[new_node].supply = LinkGraph::Scale(other->nodes[node1].supply, age, other_age);
 		st->goods[this->cargo].link_graph = this->index;
 		st->goods[this->cargo].node = new_node;
-		for (NodeID node2 = 0; node2 < node1; ++node2) {
-			BaseEdge &forward = this->edges[new_node][first + node2];
-			BaseEdge &backward = this->edges[first + node2][new_node];
-			forward = other->edges[node1][node2];
-			backward = other->edges[node2][node1];
-			forward.capacity = LinkGraph::Scale(forward.capacity, age, other_age);
-			forward.usage = LinkGraph::Scale(forward.usage, age, other_age);
-			if (forward.next_edge != INVALID_NODE) forward.next_edge += first;
-			backward.capacity = LinkGraph::Scale(backward.capacity, age, other_age);
-			backward.usage = LinkGraph::Scale(backward.usage, age, other_age);
-			if (backward.next_edge != INVALID_NODE) backward.next_edge += first;
+
+		/* All nodes of the other graph are moved by the same offset, so the edges stay sorted. */
+		this->edges[new_node] = std::move(other->edges[node1]);
+		if (this->edges[new_node]->empty()) continue;
+		for (BaseEdge &edge : this->edges[new_node].Mutable()) {
+			edge.capacity = LinkGraph::Scale(edge.capacity, age, other_age);
+			edge.usage = LinkGraph::Scale(edge.usage, age, other_age);
+			edge.dest += first;
 		}
-		BaseEdge &new_start = this->edges[new_node][new_node];
-		new_start = other->edges[node1][node1];
-		if (new_start.next_edge != INVALID_NODE) new_start.next_edge += first;
 	}
 	delete other;
 }
@@ -119,39 +125,40 @@ void LinkGraph::Merge(LinkGraph *other)
 void LinkGraph::RemoveNode(NodeID id)
 {
 	assert(id < this->Size());
+	LinkGraph::changes++;
 
 	NodeID last_node = this->Size() - 1;
 	for (NodeID i = 0; i <= last_node; ++i) {
+		/* Leave edge lists that don't change shared with link graph jobs. */
+		const EdgeList &const_edges = *this->edges[i];
+		if (FindEntry(const_edges.data(), const_edges.data() + const_edges.size(), id) == nullptr &&
+				FindEntry(const_edges.data(), const_edges.data() + const_edges.size(), last_node) == nullptr) {
+			continue;
+		}
+
 		(*this)[i].RemoveEdge(id);
-		BaseEdge *node_edges = this->edges[i];
-		NodeID prev = i;
-		NodeID next = node_edges[i].next_edge;
-		while (next != INVALID_NODE) {
-			if (next == last_node) {
-				node_edges[prev].next_edge = id;
-				break;
-			}
-			prev = next;
-			next = node_edges[prev].next_edge;
+
+		/* The edge to the last node becomes the edge to the removed one; move it to its new place in the order. */
+		EdgeList &node_edges = this->edges[i].Mutable();
+		BaseEdge *last = FindEntry(node_edges.data(), node_edges.data() + node_edges.size(), last_node);
+		if (last != nullptr) {
+			last->dest = id;
+			BaseEdge *pos = std::lower_bound(node_edges.data(), last, id, [](const BaseEdge &edge, NodeID to) { return edge.dest < to; });
+			std::rotate(pos, last, last + 1);
 		}
-		node_edges[id] = node_edges[last_node];
 	}
 	Station::Get(this->nodes[last_node].station)->goods[this->cargo].node = id;
 	/* Erase node by swapping with the last element. Node index is referenced
 	 * directly from station goods entries so the order and position must remain. */
 	this->nodes[id] = this->nodes.back();
 	this->nodes.pop_back();
-	this->edges.EraseColumn(id);
-	/* Not doing EraseRow here, as having the extra invalid row doesn't hurt
-	 * and removing it would trigger a lot of memmove. The data has already
-	 * been copied around in the loop above. */
+	this->edges[id] = std::move(this->edges.back());
+	this->edges.pop_back();
 }
 
 /**
- * Add a node to the component and create empty edges associated with it. Set
- * the station's last_component to this component. Calculate the distances to all
- * other nodes. The distances to _all_ nodes are important as the demand
- * calculator relies on their availability.
+ * Add a node to the component and create an empty edge list for it. Set
+ * the station's last_component to this component.
  * @param st New node's station.
  * @return New node's ID.
  */
@@ -161,23 +168,11 @@ NodeID LinkGraph::AddNode(const Station *st)
 
 	NodeID new_node = this->Size();
 	this->nodes.emplace_back();
-	/* Avoid reducing the height of the matrix as that is expensive and we
-	 * most likely will increase it again later which is again expensive. */
-	this->edges.Resize(new_node + 1U,
-			max(new_node + 1U, this->edges.Height()));
+	this->edges.emplace_back();
 
 	this->nodes[new_node].Init(st->xy, st->index,
 			HasBit(good.status, GoodsEntry::GES_ACCEPTANCE));
 
-	BaseEdge *new_edges = this->edges[new_node];
-
-	/* Reset the first edge starting at the new node */
-	new_edges[new_node].next_edge = INVALID_NODE;
-
-	for (NodeID i = 0; i <= new_node; ++i) {
-		new_edges[i].Init();
-		this->edges[i][new_node].Init();
-	}
 	return new_node;
 }
 
@@ -192,12 +187,13 @@ NodeID LinkGraph::AddNode(const Station *st)
 void LinkGraph::Node::AddEdge(NodeID to, uint capacity, uint usage, EdgeUpdateMode mode)
 {
 	assert(this->index != to);
-	BaseEdge &edge = this->edges[to];
-	BaseEdge &first = this->edges[this->index];
+	EdgeList &edges = this->MutableEdges();
+	EdgeList::iterator pos = std::lower_bound(edges.begin(), edges.end(), to, [](const BaseEdge &edge, NodeID to) { return edge.dest < to; });
+	assert(pos == edges.end() || pos->dest != to);
+	BaseEdge &edge = *edges.emplace(pos);
+	edge.Init(to);
 	edge.capacity = capacity;
 	edge.usage = usage;
-	edge.next_edge = first.next_edge;
-	first.next_edge = to;
 	if (mode & EUM_UNRESTRICTED)  edge.last_unrestricted_update = _date;
 	if (mode & EUM_RESTRICTED) edge.last_restricted_update = _date;
 }
@@ -213,7 +209,7 @@ void LinkGraph::Node::UpdateEdge(NodeID to, uint capacity, uint usage, EdgeUpdat
 {
 	assert(capacity > 0);
 	assert(usage <= capacity);
-	if (this->edges[to].capacity == 0) {
+	if (!this->HasEdgeTo(to)) {
 		this->AddEdge(to, capacity, usage, mode);
 	} else {
 		(*this)[to].Update(capacity, usage, mode);
@@ -226,26 +222,12 @@ void LinkGraph::Node::UpdateEdge(NodeID to, uint capacity, uint usage, EdgeUpdat
  */
 void LinkGraph::Node::RemoveEdge(NodeID to)
 {
-	if (this->index == to) return;
-	BaseEdge &edge = this->edges[to];
-	edge.capacity = 0;
-	edge.last_unrestricted_update = INVALID_DATE;
-	edge.last_restricted_update = INVALID_DATE;
-	edge.usage = 0;
-
-	NodeID prev = this->index;
-	NodeID next = this->edges[this->index].next_edge;
-	while (next != INVALID_NODE) {
-		if (next == to) {
-			/* Will be removed, skip it. */
-			this->edges[prev].next_edge = edge.next_edge;
-			edge.next_edge = INVALID_NODE;
-			break;
-		} else {
-			prev = next;
-			next = this->edges[next].next_edge;
-		}
-	}
+	const BaseEdge *edge = this->FindEdge(to);
+	if (edge == nullptr) return;
+	ptrdiff_t pos = edge - this->edges->data();
+	EdgeList &edges = this->MutableEdges();
+	edges.erase(edges.begin() + pos);
+	LinkGraph::changes++;
 }
 
 /**
@@ -274,19 +256,18 @@ void LinkGraph::Edge::Update(uint capacity, uint usage, EdgeUpdateMode mode)
 }
 
 /**
- * Resize the component and fill it with empty nodes and edges. Used when
+ * Resize the component and fill it with empty nodes without edges. Used when
  * loading from save games. The component is expected to be empty before.
  * @param size New size of the component.
  */
 void LinkGraph::Init(uint size)
 {
 	assert(this->Size() == 0);
-	this->edges.Resize(size, size);
+	LinkGraph::changes++;
+	this->edges.resize(size);
 	this->nodes.resize(size);
 
 	for (uint i = 0; i < size; ++i) {
 		this->nodes[i].Init();
-		BaseEdge *column = this->edges[i];
-		for (uint j = 0; j < size; ++j) column[j].Init();
 	}
 }
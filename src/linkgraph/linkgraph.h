@@ -12,11 +12,13 @@
 
 #include "../core/pool_type.hpp"
 #include "../core/smallmap_type.hpp"
-#include "../core/smallmatrix_type.hpp"
 #include "../station_base.h"
 #include "../cargotype.h"
 #include "../date_func.h"
 #include "linkgraph_type.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 struct SaveLoad;
 class LinkGraph;
@@ -53,18 +55,79 @@ public:
 	};
 
 	/**
-	 * An edge in the link graph. Corresponds to a link between two stations or at
-	 * least the distance between them. Edges from one node to itself contain the
-	 * ID of the opposite Node of the first active edge (i.e. not just distance) in
-	 * the column as next_edge.
+	 * An edge in the link graph. Corresponds to a link between two stations.
+	 * Only the edges that exist are stored, in a list per source node that is
+	 * sorted by destination.
 	 */
 	struct BaseEdge {
 		uint capacity;                 ///< Capacity of the link.
 		uint usage;                    ///< Usage of the link.
 		Date last_unrestricted_update; ///< When the unrestricted part of the link was last updated.
 		Date last_restricted_update;   ///< When the restricted part of the link was last updated.
-		NodeID next_edge;              ///< Destination of next valid edge starting at the same source node.
-		void Init();
+		NodeID dest;                   ///< Destination of the edge.
+		void Init(NodeID dest = INVALID_NODE);
+	};
+
+	/** Outgoing edges of a node, sorted by destination. */
+	typedef std::vector<BaseEdge> EdgeList;
+
+	/**
+	 * Find the entry for a destination in a range of edges, or of anything else
+	 * that is sorted by its destination.
+	 * @tparam Tentry Type of the entries, e.g. "BaseEdge" or "const BaseEdge".
+	 * @param first First entry of the range.
+	 * @param last End of the range.
+	 * @param to Destination to look for.
+	 * @return The entry for the destination, or nullptr if there is none.
+	 */
+	template <class Tentry>
+	static Tentry *FindEntry(Tentry *first, Tentry *last, NodeID to)
+	{
+		Tentry *entry = std::lower_bound(first, last, to, [](const Tentry &entry, NodeID to) { return entry.dest < to; });
+		return entry != last && entry->dest == to ? entry : nullptr;
+	}
+
+	/** Edge returned for nodes that are not connected. */
+	static const BaseEdge empty_edge;
+
+	/** Edge list of nodes without edges. */
+	static const EdgeList empty_edge_list;
+
+	/**
+	 * Outgoing edges of a node, shared by copies of the link graph until one of
+	 * them changes them. A link graph job copies the link graph when it is
+	 * spawned; like this only the edges the game changes while the job runs are
+	 * actually copied.
+	 */
+	class SharedEdgeList {
+		std::shared_ptr<EdgeList> list; ///< The edges, or nullptr if there are none yet.
+
+	public:
+		/**
+		 * Get the edges for reading.
+		 * @return The edges.
+		 */
+		const EdgeList &operator*() const { return this->list != nullptr ? *this->list : LinkGraph::empty_edge_list; }
+
+		/**
+		 * Get the edges for reading.
+		 * @return The edges.
+		 */
+		const EdgeList *operator->() const { return &**this; }
+
+		/**
+		 * Get the edges for changing them, copying them first if another link graph shares them.
+		 * @return The edges, only used by this link graph.
+		 */
+		EdgeList &Mutable()
+		{
+			if (this->list == nullptr) {
+				this->list = std::make_shared<EdgeList>();
+			} else if (this->list.use_count() > 1) {
+				this->list = std::make_shared<EdgeList>(*this->list);
+			}
+			return *this->list;
+		}
 	};
 
 	/**
@@ -117,15 +180,25 @@ public:
 
 	/**
 	 * Wrapper for a node (const or not) allowing retrieval, but no modification.
-	 * @tparam Tedge Actual node class, may be "const BaseNode" or just "BaseNode".
-	 * @tparam Tedge Actual edge class, may be "const BaseEdge" or just "BaseEdge".
+	 * @tparam Tnode Actual node class, may be "const BaseNode" or just "BaseNode".
+	 * @tparam Tedge_list Actual edge list class, may be "const EdgeList" or just "EdgeList".
 	 */
-	template<typename Tnode, typename Tedge>
+	template<typename Tnode, typename Tedge_list>
 	class NodeWrapper {
 	protected:
-		Tnode &node;  ///< Node being wrapped.
-		Tedge *edges; ///< Outgoing edges for wrapped node.
-		NodeID index; ///< ID of wrapped node.
+		Tnode &node;       ///< Node being wrapped.
+		Tedge_list *edges; ///< Outgoing edges for wrapped node.
+		NodeID index;      ///< ID of wrapped node.
+
+		/**
+		 * Find the edge to another node.
+		 * @param to ID of the other node.
+		 * @return The edge, or nullptr if the nodes are not connected.
+		 */
+		auto FindEdge(NodeID to) const -> decltype(edges->data())
+		{
+			return LinkGraph::FindEntry(this->edges->data(), this->edges->data() + this->edges->size(), to);
+		}
 
 	public:
 
@@ -135,8 +208,15 @@ public:
 		 * @param edges Outgoing edges for node to be wrapped.
 		 * @param index ID of node to be wrapped.
 		 */
-		NodeWrapper(Tnode &node, Tedge *edges, NodeID index) : node(node),
-			edges(edges), index(index) {}
+		NodeWrapper(Tnode &node, Tedge_list &edges, NodeID index) : node(node),
+			edges(&edges), index(index) {}
+
+		/**
+		 * Check whether there is an edge to another node.
+		 * @param to ID of the other node.
+		 * @return True if the nodes are connected.
+		 */
+		bool HasEdgeTo(NodeID to) const { return this->FindEdge(to) != nullptr; }
 
 		/**
 		 * Get supply of wrapped node.
@@ -170,17 +250,15 @@ public:
 	};
 
 	/**
-	 * Base class for iterating across outgoing edges of a node. Only the real
-	 * edges (those with capacity) are iterated. The ones with only distance
-	 * information are skipped.
+	 * Base class for iterating across outgoing edges of a node, in the order
+	 * of their destinations.
 	 * @tparam Tedge Actual edge class. May be "BaseEdge" or "const BaseEdge".
 	 * @tparam Titer Actual iterator class.
 	 */
 	template <class Tedge, class Tedge_wrapper, class Titer>
 	class BaseEdgeIterator {
 	protected:
-		Tedge *base;    ///< Array of edges being iterated.
-		NodeID current; ///< Current offset in edges array.
+		Tedge *current; ///< Current edge.
 
 		/**
 		 * A "fake" pointer to enable operator-> on temporaries. As the objects
@@ -207,13 +285,9 @@ public:
 	public:
 		/**
 		 * Constructor.
-		 * @param base Array of edges to be iterated.
-		 * @param current ID of current node (to locate the first edge).
+		 * @param current Edge to start at.
 		 */
-		BaseEdgeIterator (Tedge *base, NodeID current) :
-			base(base),
-			current(current == INVALID_NODE ? current : base[current].next_edge)
-		{}
+		BaseEdgeIterator (Tedge *current) : current(current) {}
 
 		/**
 		 * Prefix-increment.
@@ -221,7 +295,7 @@ public:
 		 */
 		Titer &operator++()
 		{
-			this->current = this->base[this->current].next_edge;
+			this->current++;
 			return static_cast<Titer &>(*this);
 		}
 
@@ -232,7 +306,7 @@ public:
 		Titer operator++(int)
 		{
 			Titer ret(static_cast<Titer &>(*this));
-			this->current = this->base[this->current].next_edge;
+			this->current++;
 			return ret;
 		}
 
@@ -241,12 +315,12 @@ public:
 		 * child class.
 		 * @tparam Tother Class of other iterator.
 		 * @param other Instance of other iterator.
-		 * @return If the iterators have the same edge array and current node.
+		 * @return If the iterators point to the same edge.
 		 */
 		template<class Tother>
 		bool operator==(const Tother &other)
 		{
-			return this->base == other.base && this->current == other.current;
+			return this->current == other.current;
 		}
 
 		/**
@@ -254,12 +328,12 @@ public:
 		 * may be of a child class.
 		 * @tparam Tother Class of other iterator.
 		 * @param other Instance of other iterator.
-		 * @return If either the edge arrays or the current nodes differ.
+		 * @return If the iterators point to different edges.
 		 */
 		template<class Tother>
 		bool operator!=(const Tother &other)
 		{
-			return this->base != other.base || this->current != other.current;
+			return this->current != other.current;
 		}
 
 		/**
@@ -268,7 +342,7 @@ public:
 		 */
 		SmallPair<NodeID, Tedge_wrapper> operator*() const
 		{
-			return SmallPair<NodeID, Tedge_wrapper>(this->current, Tedge_wrapper(this->base[this->current]));
+			return SmallPair<NodeID, Tedge_wrapper>(this->current->dest, Tedge_wrapper(*this->current));
 		}
 
 		/**
@@ -296,8 +370,8 @@ public:
 		 */
 		Edge(BaseEdge &edge) : EdgeWrapper<BaseEdge>(edge) {}
 		void Update(uint capacity, uint usage, EdgeUpdateMode mode);
-		void Restrict() { this->edge.last_unrestricted_update = INVALID_DATE; }
-		void Release() { this->edge.last_restricted_update = INVALID_DATE; }
+		void Restrict() { this->edge.last_unrestricted_update = INVALID_DATE; LinkGraph::changes++; }
+		void Release() { this->edge.last_restricted_update = INVALID_DATE; LinkGraph::changes++; }
 	};
 
 	/**
@@ -308,11 +382,10 @@ public:
 	public:
 		/**
 		 * Constructor.
-		 * @param edges Array of edges to be iterated over.
-		 * @param current ID of current edge's end node.
+		 * @param current Edge to start at.
 		 */
-		ConstEdgeIterator(const BaseEdge *edges, NodeID current) :
-			BaseEdgeIterator<const BaseEdge, ConstEdge, ConstEdgeIterator>(edges, current) {}
+		ConstEdgeIterator(const BaseEdge *current) :
+			BaseEdgeIterator<const BaseEdge, ConstEdge, ConstEdgeIterator>(current) {}
 	};
 
 	/**
@@ -323,18 +396,17 @@ public:
 	public:
 		/**
 		 * Constructor.
-		 * @param edges Array of edges to be iterated over.
-		 * @param current ID of current edge's end node.
+		 * @param current Edge to start at.
 		 */
-		EdgeIterator(BaseEdge *edges, NodeID current) :
-			BaseEdgeIterator<BaseEdge, Edge, EdgeIterator>(edges, current) {}
+		EdgeIterator(BaseEdge *current) :
+			BaseEdgeIterator<BaseEdge, Edge, EdgeIterator>(current) {}
 	};
 
 	/**
 	 * Constant node class. Only retrieval operations are allowed on both the
 	 * node itself and its edges.
 	 */
-	class ConstNode : public NodeWrapper<const BaseNode, const BaseEdge> {
+	class ConstNode : public NodeWrapper<const BaseNode, const EdgeList> {
 	public:
 		/**
 		 * Constructor.
@@ -342,34 +414,54 @@ public:
 		 * @param node ID of the node.
 		 */
 		ConstNode(const LinkGraph *lg, NodeID node) :
-			NodeWrapper<const BaseNode, const BaseEdge>(lg->nodes[node], lg->edges[node], node)
+			NodeWrapper<const BaseNode, const EdgeList>(lg->nodes[node], *lg->edges[node], node)
 		{}
 
 		/**
 		 * Get a ConstEdge. This is not a reference as the wrapper objects are
-		 * not actually persistent.
+		 * not actually persistent. If the nodes are not connected, the edge is
+		 * empty.
 		 * @param to ID of end node of edge.
 		 * @return Constant edge wrapper.
 		 */
-		ConstEdge operator[](NodeID to) const { return ConstEdge(this->edges[to]); }
+		ConstEdge operator[](NodeID to) const
+		{
+			const BaseEdge *edge = this->FindEdge(to);
+			return ConstEdge(edge != nullptr ? *edge : LinkGraph::empty_edge);
+		}
 
 		/**
 		 * Get an iterator pointing to the start of the edges array.
 		 * @return Constant edge iterator.
 		 */
-		ConstEdgeIterator Begin() const { return ConstEdgeIterator(this->edges, this->index); }
+		ConstEdgeIterator Begin() const { return ConstEdgeIterator(this->edges->data()); }
 
 		/**
 		 * Get an iterator pointing beyond the end of the edges array.
 		 * @return Constant edge iterator.
 		 */
-		ConstEdgeIterator End() const { return ConstEdgeIterator(this->edges, INVALID_NODE); }
+		ConstEdgeIterator End() const { return ConstEdgeIterator(this->edges->data() + this->edges->size()); }
 	};
 
 	/**
 	 * Updatable node class. The node itself as well as its edges can be modified.
+	 * The edges are only copied away from link graph jobs sharing them once
+	 * they are accessed for changing them.
 	 */
-	class Node : public NodeWrapper<BaseNode, BaseEdge> {
+	class Node : public NodeWrapper<BaseNode, const EdgeList> {
+		SharedEdgeList &shared_edges; ///< Outgoing edges, possibly shared with link graph jobs.
+
+		/**
+		 * Get the edges for changing them and point the wrapper at them.
+		 * @return The edges, only used by this link graph.
+		 */
+		EdgeList &MutableEdges()
+		{
+			EdgeList &edges = this->shared_edges.Mutable();
+			this->edges = &edges;
+			return edges;
+		}
+
 	public:
 		/**
 		 * Constructor.
@@ -377,28 +469,40 @@ public:
 		 * @param node ID of the node.
 		 */
 		Node(LinkGraph *lg, NodeID node) :
-			NodeWrapper<BaseNode, BaseEdge>(lg->nodes[node], lg->edges[node], node)
+			NodeWrapper<BaseNode, const EdgeList>(lg->nodes[node], *lg->edges[node], node),
+			shared_edges(lg->edges[node])
 		{}
 
 		/**
 		 * Get an Edge. This is not a reference as the wrapper objects are not
-		 * actually persistent.
+		 * actually persistent. The edge has to exist.
 		 * @param to ID of end node of edge.
 		 * @return Edge wrapper.
 		 */
-		Edge operator[](NodeID to) { return Edge(this->edges[to]); }
+		Edge operator[](NodeID to)
+		{
+			EdgeList &edges = this->MutableEdges();
+			BaseEdge *edge = LinkGraph::FindEntry(edges.data(), edges.data() + edges.size(), to);
+			assert(edge != nullptr);
+			return Edge(*edge);
+		}
 
 		/**
-		 * Get an iterator pointing to the start of the edges array.
+		 * Get an iterator pointing to the start of the edges array. Adding
+		 * or removing edges of the node invalidates it.
 		 * @return Edge iterator.
 		 */
-		EdgeIterator Begin() { return EdgeIterator(this->edges, this->index); }
+		EdgeIterator Begin() { return EdgeIterator(this->MutableEdges().data()); }
 
 		/**
 		 * Get an iterator pointing beyond the end of the edges array.
 		 * @return Constant edge iterator.
 		 */
-		EdgeIterator End() { return EdgeIterator(this->edges, INVALID_NODE); }
+		EdgeIterator End()
+		{
+			EdgeList &edges = this->MutableEdges();
+			return EdgeIterator(edges.data() + edges.size());
+		}
 
 		/**
 		 * Update the node's supply and set last_update to the current date.
@@ -434,7 +538,7 @@ public:
 	};
 
 	typedef std::vector<BaseNode> NodeVector;
-	typedef SmallMatrix<BaseEdge> EdgeMatrix;
+	typedef std::vector<SharedEdgeList> EdgeListVector;
 
 	/** Minimum effective distance for timeout calculation. */
 	static const uint MIN_TIMEOUT_DISTANCE = 32;
@@ -442,6 +546,14 @@ public:
 	/** Minimum number of days between subsequent compressions of a LG. */
 	static const uint COMPRESSION_INTERVAL = 256;
 
+	/**
+	 * Number of changes to any link graph after which refreshing the same links
+	 * again could change them. Refreshing links only raises capacities and sets
+	 * the update dates to today, so until then a repeated refresh of the same
+	 * day is a no-op; see LinkRefresher.
+	 */
+	static uint32 changes;
+
 	/**
 	 * Scale a value from a link graph of age orig_age for usage in one of age
 	 * target_age. Make sure that the value stays > 0 if it was > 0 before.
@@ -526,12 +638,13 @@ protected:
 	friend class LinkGraph::Node;
 	friend const SaveLoad *GetLinkGraphDesc();
 	friend const SaveLoad *GetLinkGraphJobDesc();
-	friend void SaveLoad_LinkGraph(LinkGraph &lg);
+	friend void Save_LinkGraph(LinkGraph &lg);
+	friend void Load_LinkGraph(LinkGraph &lg);
 
 	CargoID cargo;         ///< Cargo of this component's link graph.
 	Date last_compression; ///< Last time the capacities and supplies were compressed.
 	NodeVector nodes;      ///< Nodes in the component.
-	EdgeMatrix edges;      ///< Edges in the component.
+	EdgeListVector edges;  ///< Outgoing edges of each node in the component.
 };
 
 #endif /* LINKGRAPH_H */
@@ -45,24 +45,23 @@ void LinkGraphOverlay::GetWidgetDpi(DrawPixelInfo *dpi) const
 }
 
 /**
- * Rebuild the cache and recalculate which links and stations to be shown.
+ * Rebuild the cache of all links and stations of the shown cargoes and
+ * companies. This is only needed when the link graph or the selection
+ * changed; scrolling only needs #RebuildVisibleCache.
  */
 void LinkGraphOverlay::RebuildCache()
 {
-	this->cached_links.clear();
-	this->cached_stations.clear();
+	this->links.clear();
+	this->stations.clear();
+	this->view_dirty = true;
 	if (this->company_mask == 0) return;
 
-	DrawPixelInfo dpi;
-	this->GetWidgetDpi(&dpi);
-
+	StationLinkMap seen_links;
 	for (const Station *sta : Station::Iterate()) {
 		if (sta->rect.IsEmpty()) continue;
 
-		Point pta = this->GetStationMiddle(sta);
-
 		StationID from = sta->index;
-		StationLinkMap &seen_links = this->cached_links[from];
+		seen_links.clear();
 
 		uint supply = 0;
 		CargoID c;
@@ -86,15 +85,39 @@ void LinkGraphOverlay::RebuildCache()
 				if (stb->owner != OWNER_NONE && sta->owner != OWNER_NONE && !HasBit(this->company_mask, stb->owner)) continue;
 				if (stb->rect.IsEmpty()) continue;
 
-				if (!this->IsLinkVisible(pta, this->GetStationMiddle(stb), &dpi)) continue;
-
-				this->AddLinks(sta, stb);
-				seen_links[to]; // make sure it is created and marked as seen
+				this->AddLinks(sta, stb, seen_links[to]);
 			}
 		}
-		if (this->IsPointVisible(pta, &dpi)) {
-			this->cached_stations.push_back(std::make_pair(from, supply));
+		for (StationLinkMap::const_iterator i(seen_links.begin()); i != seen_links.end(); ++i) {
+			this->links.push_back({from, i->first, i->second});
 		}
+		this->stations.push_back(std::make_pair(from, supply));
+	}
+}
+
+/**
+ * Select the cached links and stations that are in or near the visible area.
+ */
+void LinkGraphOverlay::RebuildVisibleCache()
+{
+	this->cached_links.clear();
+	this->cached_stations.clear();
+
+	DrawPixelInfo dpi;
+	this->GetWidgetDpi(&dpi);
+
+	for (const Link &link : this->links) {
+		const Station *sta = Station::GetIfValid(link.from);
+		const Station *stb = Station::GetIfValid(link.to);
+		if (sta == nullptr || stb == nullptr) continue;
+		if (!this->IsLinkVisible(this->GetStationMiddle(sta), this->GetStationMiddle(stb), &dpi)) continue;
+		this->cached_links.push_back(link);
+	}
+
+	for (const auto &station : this->stations) {
+		const Station *st = Station::GetIfValid(station.first);
+		if (st == nullptr || !this->IsPointVisible(this->GetStationMiddle(st), &dpi)) continue;
+		this->cached_stations.push_back(station);
 	}
 }
 
@@ -186,11 +209,12 @@ inline bool LinkGraphOverlay::IsLinkVisible(Point pta, Point ptb, const DrawPixe
 }
 
 /**
- * Add all "interesting" links between the given stations to the cache.
+ * Add all "interesting" links between the given stations to the given link properties.
  * @param from The source station.
  * @param to The destination station.
+ * @param link The properties of the link from \a from to \a to.
  */
-void LinkGraphOverlay::AddLinks(const Station *from, const Station *to)
+void LinkGraphOverlay::AddLinks(const Station *from, const Station *to, LinkProperties &link)
 {
 	CargoID c;
 	FOR_EACH_SET_CARGO_ID(c, this->cargo_mask) {
@@ -205,7 +229,7 @@ void LinkGraphOverlay::AddLinks(const Station *from, const Station *to)
 		if (edge.Capacity() > 0) {
 			this->AddStats(lg.Monthly(edge.Capacity()), lg.Monthly(edge.Usage()),
 					ge.flows.GetFlowVia(to->index), from->owner == OWNER_NONE || to->owner == OWNER_NONE,
-					this->cached_links[from->index][to->index]);
+					link);
 		}
 	}
 }
@@ -242,6 +266,10 @@ void LinkGraphOverlay::Draw(const DrawPixelInfo *dpi)
 		this->RebuildCache();
 		this->dirty = false;
 	}
+	if (this->view_dirty) {
+		this->RebuildVisibleCache();
+		this->view_dirty = false;
+	}
 	this->DrawLinks(dpi);
 	this->DrawStationDots(dpi);
 }
@@ -252,15 +280,12 @@ void LinkGraphOverlay::Draw(const DrawPixelInfo *dpi)
  */
 void LinkGraphOverlay::DrawLinks(const DrawPixelInfo *dpi) const
 {
-	for (LinkMap::const_iterator i(this->cached_links.begin()); i != this->cached_links.end(); ++i) {
-		if (!Station::IsValidID(i->first)) continue;
-		Point pta = this->GetStationMiddle(Station::Get(i->first));
-		for (StationLinkMap::const_iterator j(i->second.begin()); j != i->second.end(); ++j) {
-			if (!Station::IsValidID(j->first)) continue;
-			Point ptb = this->GetStationMiddle(Station::Get(j->first));
-			if (!this->IsLinkVisible(pta, ptb, dpi, this->scale + 2)) continue;
-			this->DrawContent(pta, ptb, j->second);
-		}
+	for (const Link &link : this->cached_links) {
+		if (!Station::IsValidID(link.from) || !Station::IsValidID(link.to)) continue;
+		Point pta = this->GetStationMiddle(Station::Get(link.from));
+		Point ptb = this->GetStationMiddle(Station::Get(link.to));
+		if (!this->IsLinkVisible(pta, ptb, dpi, this->scale + 2)) continue;
+		this->DrawContent(pta, ptb, link.prop);
 	}
 }
 
@@ -36,8 +36,15 @@ struct LinkProperties {
  */
 class LinkGraphOverlay {
 public:
+	/** A link between two stations as shown in the overlay. */
+	struct Link {
+		StationID from;      ///< Station the link starts at.
+		StationID to;        ///< Station the link ends at.
+		LinkProperties prop; ///< Properties of the link.
+	};
+
 	typedef std::map<StationID, LinkProperties> StationLinkMap;
-	typedef std::map<StationID, StationLinkMap> LinkMap;
+	typedef std::vector<Link> LinkList;
 	typedef std::vector<std::pair<StationID, uint> > StationSupplyList;
 
 	static const uint8 LINK_COLOURS[];
@@ -51,7 +58,7 @@ public:
 	 * @param scale Desired thickness of lines and size of station dots.
 	 */
 	LinkGraphOverlay(const Window *w, uint wid, CargoTypes cargo_mask, uint32 company_mask, uint scale) :
-			window(w), widget_id(wid), cargo_mask(cargo_mask), company_mask(company_mask), scale(scale)
+			window(w), widget_id(wid), cargo_mask(cargo_mask), company_mask(company_mask), scale(scale), dirty(true), view_dirty(true)
 	{}
 
 	void Draw(const DrawPixelInfo *dpi);
@@ -61,6 +68,9 @@ public:
 	/** Mark the linkgraph dirty to be rebuilt next time Draw() is called. */
 	void SetDirty() { this->dirty = true; }
 
+	/** Mark the visible area dirty, e.g. after scrolling, to select the visible links again next time Draw() is called. */
+	void SetViewDirty() { this->view_dirty = true; }
+
 	/** Get a bitmask of the currently shown cargoes. */
 	CargoTypes GetCargoMask() { return this->cargo_mask; }
 
@@ -72,14 +82,17 @@ protected:
 	const uint widget_id;              ///< ID of Widget in Window to be drawn to.
 	CargoTypes cargo_mask;             ///< Bitmask of cargos to be displayed.
 	uint32 company_mask;               ///< Bitmask of companies to be displayed.
-	LinkMap cached_links;              ///< Cache for links to reduce recalculation.
-	StationSupplyList cached_stations; ///< Cache for stations to be drawn.
+	LinkList links;                    ///< All links of the shown cargoes and companies.
+	StationSupplyList stations;        ///< All stations of the shown cargoes and companies.
+	LinkList cached_links;             ///< Links in or near the visible area.
+	StationSupplyList cached_stations; ///< Stations in or near the visible area.
 	uint scale;                        ///< Width of link lines.
 	bool dirty;                        ///< Set if overlay should be rebuilt.
+	bool view_dirty;                   ///< Set if the visible links and stations should be selected again.
 
 	Point GetStationMiddle(const Station *st) const;
 
-	void AddLinks(const Station *sta, const Station *stb);
+	void AddLinks(const Station *sta, const Station *stb, LinkProperties &link);
 	void DrawLinks(const DrawPixelInfo *dpi) const;
 	void DrawStationDots(const DrawPixelInfo *dpi) const;
 	void DrawContent(Point pta, Point ptb, const LinkProperties &cargo) const;
@@ -87,6 +100,7 @@ protected:
 	bool IsPointVisible(Point pt, const DrawPixelInfo *dpi, int padding = 0) const;
 	void GetWidgetDpi(DrawPixelInfo *dpi) const;
 	void RebuildCache();
+	void RebuildVisibleCache();
 
 	static void AddStats(uint new_cap, uint new_usg, uint new_flow, bool new_shared, LinkProperties &cargo);
 	static void DrawVertex(int x, int y, int size, int colour, int border_colour);
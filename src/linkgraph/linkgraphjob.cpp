@@ -26,6 +26,12 @@ INSTANTIATE_POOL_METHODS(LinkGraphJob)
  */
 /* static */ Path *Path::invalid_path = new Path(INVALID_NODE, true);
 
+/**
+ * Static instance of an empty edge annotation, returned for pairs of nodes
+ * that have neither an edge nor demand between them.
+ */
+/* static */ LinkGraphJob::EdgeAnnotation LinkGraphJob::empty_annotation = {0, 0, 0, INVALID_NODE};
+
 /**
  * Create a link graph job from a link graph. The link graph will be copied so
  * that the calculations don't interfer with the normal operations on the
@@ -34,11 +40,59 @@ INSTANTIATE_POOL_METHODS(LinkGraphJob)
  */
 LinkGraphJob::LinkGraphJob(const LinkGraph &orig) :
 		/* Copying the link graph here also copies its index member.
-		 * This is on purpose. */
+		 * This is on purpose. The edges are not copied, but shared
+		 * until the game changes them. */
 		link_graph(orig),
 		settings(_settings_game.linkgraph),
 		join_date(_date + _settings_game.linkgraph.recalc_time)
 {
+	if (this->settings.incremental) this->CollectPreviousRoutes();
+}
+
+/**
+ * Collect the routes the current flows of the stations in the component take,
+ * so that the calculation can start from them. Only unrestricted flows between
+ * nodes of the component are considered. The links are sorted by origin and
+ * start node; for each start node the ones carrying more flow come first.
+ */
+void LinkGraphJob::CollectPreviousRoutes()
+{
+	CargoID cargo = this->Cargo();
+	LinkGraphID index = this->link_graph.index;
+
+	/* Find the node of a station in this component. */
+	auto get_node = [cargo, index](StationID id) -> NodeID {
+		const Station *st = Station::GetIfValid(id);
+		if (st == nullptr || st->goods[cargo].link_graph != index) return INVALID_NODE;
+		return st->goods[cargo].node;
+	};
+
+	std::vector<std::pair<uint, NodeID>> vias;
+	for (NodeID from = 0; from < this->Size(); ++from) {
+		const FlowStatMap &flows = Station::Get(this->link_graph[from].Station())->goods[cargo].flows;
+		for (FlowStatMap::const_iterator it = flows.begin(); it != flows.end(); ++it) {
+			NodeID origin = get_node(it->first);
+			if (origin == INVALID_NODE) continue;
+
+			vias.clear();
+			uint prev = 0;
+			const FlowStat::SharesMap *shares = it->second.GetShares();
+			for (FlowStat::SharesMap::const_iterator share = shares->begin(); share != shares->end(); ++share) {
+				if (share->first > it->second.GetUnrestricted()) break;
+				NodeID to = get_node(share->second);
+				if (to != INVALID_NODE && to != from && to != origin) vias.emplace_back(share->first - prev, to);
+				prev = share->first;
+			}
+			std::sort(vias.begin(), vias.end(), [](const std::pair<uint, NodeID> &a, const std::pair<uint, NodeID> &b) {
+				return a.first != b.first ? a.first > b.first : a.second < b.second;
+			});
+			for (const auto &via : vias) this->previous_routes.push_back({origin, from, via.second});
+		}
+	}
+
+	std::stable_sort(this->previous_routes.begin(), this->previous_routes.end(), [](const RouteLink &a, const RouteLink &b) {
+		return a.origin != b.origin ? a.origin < b.origin : a.from < b.from;
+	});
 }
 
 /**
@@ -113,7 +167,8 @@ LinkGraphJob::~LinkGraphJob()
 			continue;
 		}
 
-		LinkGraph *lg = LinkGraph::Get(ge.link_graph);
+		/* Edges may have been removed since the job was spawned; those read as empty. */
+		const LinkGraph *lg = LinkGraph::Get(ge.link_graph);
 		FlowStatMap &flows = from.Flows();
 
 		for (EdgeIterator it(from.Begin()); it != from.End(); ++it) {
@@ -174,24 +229,46 @@ void LinkGraphJob::Init()
 {
 	uint size = this->Size();
 	this->nodes.resize(size);
-	this->edges.Resize(size, size);
+	this->edges.resize(size);
 	for (uint i = 0; i < size; ++i) {
-		this->nodes[i].Init(this->link_graph[i].Supply());
-		EdgeAnnotation *node_edges = this->edges[i];
-		for (uint j = 0; j < size; ++j) {
-			node_edges[j].Init();
+		LinkGraph::ConstNode node = this->link_graph[i];
+		this->nodes[i].Init(node.Supply());
+		EdgeAnnotationList &node_edges = this->edges[i];
+		for (LinkGraph::ConstEdgeIterator it = node.Begin(); it != node.End(); ++it) {
+			node_edges.emplace_back();
+			node_edges.back().Init(it->first);
 		}
 	}
 }
 
 /**
  * Initialize a linkgraph job edge.
+ * @param dest Destination of the edge.
  */
-void LinkGraphJob::EdgeAnnotation::Init()
+void LinkGraphJob::EdgeAnnotation::Init(NodeID dest)
 {
 	this->demand = 0;
 	this->flow = 0;
 	this->unsatisfied_demand = 0;
+	this->dest = dest;
+}
+
+/**
+ * Get the annotation for a destination, adding an empty one in sorted
+ * position if there is none yet.
+ * @param annos Annotations of the source node.
+ * @param to The destination.
+ * @return The annotation.
+ */
+/* static */ LinkGraphJob::EdgeAnnotation &LinkGraphJob::AddAnnotation(EdgeAnnotationList &annos, NodeID to)
+{
+	EdgeAnnotationList::iterator it = std::lower_bound(annos.begin(), annos.end(), to,
+			[](const EdgeAnnotation &anno, NodeID dest) { return anno.dest < dest; });
+	if (it == annos.end() || it->dest != to) {
+		it = annos.emplace(it);
+		it->Init(to);
+	}
+	return *it;
 }
 
 /**
@@ -29,13 +29,15 @@ extern LinkGraphJobPool _link_graph_job_pool;
 class LinkGraphJob : public LinkGraphJobPool::PoolItem<&_link_graph_job_pool>{
 private:
 	/**
-	 * Annotation for a link graph edge.
+	 * Annotation for a link graph edge, or for a pair of nodes with demand
+	 * between them but without an edge.
 	 */
 	struct EdgeAnnotation {
 		uint demand;             ///< Transport demand between the nodes.
 		uint unsatisfied_demand; ///< Demand over this edge that hasn't been satisfied yet.
 		uint flow;               ///< Planned flow over this edge.
-		void Init();
+		NodeID dest;             ///< Destination of the edge.
+		void Init(NodeID dest);
 	};
 
 	/**
@@ -49,10 +51,29 @@ private:
 	};
 
 	typedef std::vector<NodeAnnotation> NodeAnnotationVector;
-	typedef SmallMatrix<EdgeAnnotation> EdgeAnnotationMatrix;
+	/** Annotations of the edges and demands starting at a node, sorted by destination. */
+	typedef std::vector<EdgeAnnotation> EdgeAnnotationList;
+	typedef std::vector<EdgeAnnotationList> EdgeAnnotationListVector;
+
+	/** Annotation returned for nodes that have neither an edge nor demand between them. */
+	static EdgeAnnotation empty_annotation;
 
 	friend const SaveLoad *GetLinkGraphJobDesc();
 	friend class LinkGraphSchedule;
+	friend void Save_LinkGraphJobRoutes(LinkGraphJob &lgj);
+	friend void Load_LinkGraphJobRoutes(LinkGraphJob &lgj);
+
+public:
+	/**
+	 * Link along which cargo from an origin was routed when the job was spawned.
+	 */
+	struct RouteLink {
+		NodeID origin; ///< Node the cargo originates from.
+		NodeID from;   ///< Node the link starts at.
+		NodeID to;     ///< Node the link leads to.
+	};
+
+	typedef std::vector<RouteLink> RouteLinkVector;
 
 protected:
 	const LinkGraph link_graph;       ///< Link graph to by analyzed. Is copied when job is started and mustn't be modified later.
@@ -60,12 +81,28 @@ protected:
 	std::thread thread;               ///< Thread the job is running in or a default-constructed thread if it's running in the main thread.
 	Date join_date;                   ///< Date when the job is to be joined.
 	NodeAnnotationVector nodes;       ///< Extra node data necessary for link graph calculation.
-	EdgeAnnotationMatrix edges;       ///< Extra edge data necessary for link graph calculation.
+	EdgeAnnotationListVector edges;   ///< Extra edge data necessary for link graph calculation.
+	RouteLinkVector previous_routes;  ///< Routes of the flows at spawn time, sorted by origin, for warm starting the calculation.
 
 	void EraseFlows(NodeID from);
+	void CollectPreviousRoutes();
 	void JoinThread();
 	void SpawnThread();
 
+	/**
+	 * Get the annotation for a destination.
+	 * @param annos Annotations of the source node.
+	 * @param to The destination.
+	 * @return The annotation, or #empty_annotation if there is none.
+	 */
+	static EdgeAnnotation &GetAnnotation(EdgeAnnotationList &annos, NodeID to)
+	{
+		EdgeAnnotation *anno = LinkGraph::FindEntry(annos.data(), annos.data() + annos.size(), to);
+		return anno != nullptr ? *anno : empty_annotation;
+	}
+
+	static EdgeAnnotation &AddAnnotation(EdgeAnnotationList &annos, NodeID to);
+
 public:
 
 	/**
@@ -106,7 +143,11 @@ public:
 		 * Add some flow.
 		 * @param flow Flow to be added.
 		 */
-		void AddFlow(uint flow) { this->anno.flow += flow; }
+		void AddFlow(uint flow)
+		{
+			assert(&this->anno != &LinkGraphJob::empty_annotation);
+			this->anno.flow += flow;
+		}
 
 		/**
 		 * Remove some flow.
@@ -124,6 +165,7 @@ public:
 		 */
 		void AddDemand(uint demand)
 		{
+			assert(&this->anno != &LinkGraphJob::empty_annotation);
 			this->anno.demand += demand;
 			this->anno.unsatisfied_demand += demand;
 		}
@@ -143,17 +185,16 @@ public:
 	 * Iterator for job edges.
 	 */
 	class EdgeIterator : public LinkGraph::BaseEdgeIterator<const LinkGraph::BaseEdge, Edge, EdgeIterator> {
-		EdgeAnnotation *base_anno; ///< Array of annotations to be (indirectly) iterated.
+		EdgeAnnotationList *annos; ///< Annotations of the edges being iterated.
 	public:
 		/**
 		 * Constructor.
-		 * @param base Array of edges to be iterated.
-		 * @param base_anno Array of annotations to be iterated.
-		 * @param current Start offset of iteration.
+		 * @param current Edge to start at.
+		 * @param annos Annotations of the edges being iterated.
 		 */
-		EdgeIterator(const LinkGraph::BaseEdge *base, EdgeAnnotation *base_anno, NodeID current) :
-				LinkGraph::BaseEdgeIterator<const LinkGraph::BaseEdge, Edge, EdgeIterator>(base, current),
-				base_anno(base_anno) {}
+		EdgeIterator(const LinkGraph::BaseEdge *current, EdgeAnnotationList *annos) :
+				LinkGraph::BaseEdgeIterator<const LinkGraph::BaseEdge, Edge, EdgeIterator>(current),
+				annos(annos) {}
 
 		/**
 		 * Dereference.
@@ -162,7 +203,8 @@ public:
 		 */
 		SmallPair<NodeID, Edge> operator*() const
 		{
-			return SmallPair<NodeID, Edge>(this->current, Edge(this->base[this->current], this->base_anno[this->current]));
+			NodeID to = this->current->dest;
+			return SmallPair<NodeID, Edge>(to, Edge(*this->current, LinkGraphJob::GetAnnotation(*this->annos, to)));
 		}
 
 		/**
@@ -181,8 +223,8 @@ public:
 	 */
 	class Node : public LinkGraph::ConstNode {
 	private:
-		NodeAnnotation &node_anno;  ///< Annotation being wrapped.
-		EdgeAnnotation *edge_annos; ///< Edge annotations belonging to this node.
+		NodeAnnotation &node_anno;      ///< Annotation being wrapped.
+		EdgeAnnotationList &edge_annos; ///< Edge annotations belonging to this node.
 	public:
 
 		/**
@@ -197,25 +239,28 @@ public:
 
 		/**
 		 * Retrieve an edge starting at this node. Mind that this returns an
-		 * object, not a reference.
+		 * object, not a reference. If there is neither an edge nor demand
+		 * between the nodes, the edge is empty and must not be modified.
 		 * @param to Remote end of the edge.
 		 * @return Edge between this node and "to".
 		 */
-		Edge operator[](NodeID to) const { return Edge(this->edges[to], this->edge_annos[to]); }
+		Edge operator[](NodeID to) const
+		{
+			const LinkGraph::BaseEdge *edge = this->FindEdge(to);
+			return Edge(edge != nullptr ? *edge : LinkGraph::empty_edge, LinkGraphJob::GetAnnotation(this->edge_annos, to));
+		}
 
 		/**
-		 * Iterator for the "begin" of the edge array. Only edges with capacity
-		 * are iterated. The others are skipped.
+		 * Iterator for the "begin" of the edge array.
 		 * @return Iterator pointing to the first edge.
 		 */
-		EdgeIterator Begin() const { return EdgeIterator(this->edges, this->edge_annos, index); }
+		EdgeIterator Begin() const { return EdgeIterator(this->edges->data(), &this->edge_annos); }
 
 		/**
-		 * Iterator for the "end" of the edge array. Only edges with capacity
-		 * are iterated. The others are skipped.
+		 * Iterator for the "end" of the edge array.
 		 * @return Iterator pointing beyond the last edge.
 		 */
-		EdgeIterator End() const { return EdgeIterator(this->edges, this->edge_annos, INVALID_NODE); }
+		EdgeIterator End() const { return EdgeIterator(this->edges->data() + this->edges->size(), &this->edge_annos); }
 
 		/**
 		 * Get amount of supply that hasn't been delivered, yet.
@@ -248,6 +293,18 @@ public:
 		 */
 		const PathList &Paths() const { return this->node_anno.paths; }
 
+		/**
+		 * Check if there is demand starting at this node that hasn't been satisfied yet.
+		 * @return True if there is unsatisfied demand.
+		 */
+		bool HasUnsatisfiedDemand() const
+		{
+			for (const EdgeAnnotation &anno : this->edge_annos) {
+				if (anno.unsatisfied_demand > 0) return true;
+			}
+			return false;
+		}
+
 		/**
 		 * Deliver some supply, adding demand to the respective edge.
 		 * @param to Destination for supply.
@@ -256,7 +313,8 @@ public:
 		void DeliverSupply(NodeID to, uint amount)
 		{
 			this->node_anno.undelivered_supply -= amount;
-			(*this)[to].AddDemand(amount);
+			const LinkGraph::BaseEdge *edge = this->FindEdge(to);
+			Edge(edge != nullptr ? *edge : LinkGraph::empty_edge, LinkGraphJob::AddAnnotation(this->edge_annos, to)).AddDemand(amount);
 		}
 	};
 
@@ -296,6 +354,13 @@ public:
 	 */
 	inline const LinkGraphSettings &Settings() const { return this->settings; }
 
+	/**
+	 * Get the routes the flows took when the job was spawned. They are only
+	 * collected if the calculation is to be warm started.
+	 * @return Links of the previous routes, sorted by origin.
+	 */
+	inline const RouteLinkVector &PreviousRoutes() const { return this->previous_routes; }
+
 	/**
 	 * Get a node abstraction with the specified id.
 	 * @param num ID of the node.
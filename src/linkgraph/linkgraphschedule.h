@@ -59,6 +59,18 @@ public:
 	void SpawnAll();
 	void ShiftDates(int interval);
 
+	/**
+	 * Get the number of link graph jobs running in the background.
+	 * @return The number of jobs.
+	 */
+	uint GetRunningJobCount() const { return (uint)this->running.size(); }
+
+	/**
+	 * Get the number of link graphs waiting for a job to be spawned.
+	 * @return The number of link graphs.
+	 */
+	uint GetQueuedGraphCount() const { return (uint)this->schedule.size(); }
+
 	/**
 	 * Queue a link graph for execution.
 	 * @param lg Link graph to be queued.
@@ -2,13 +2,22 @@
 
 #include "../stdafx.h"
 #include "../core/math_func.hpp"
+#include "../worker_pool.h"
 #include "mcf.h"
-#include <set>
 
 #include "../safeguards.h"
 
 typedef std::map<NodeID, Path *> PathViaMap;
 
+/**
+ * Number of sources whose paths are searched at the same time. The searches of
+ * one batch all see the flows as they were before the batch, so this must not
+ * depend on the number of threads or the results would differ between clients.
+ */
+static const uint MCF_SOURCE_BATCH = 8;
+
+static const uint HEAP_NOT_QUEUED = UINT_MAX; ///< Heap position of nodes that are not queued.
+
 /**
  * Distance-based annotation for use in the Dijkstra algorithm. This is close
  * to the original meaning of "annotation" in this context. Paths are rated
@@ -38,7 +47,7 @@ public:
 	inline void UpdateAnnotation() { }
 
 	/**
-	 * Comparator for std containers.
+	 * Comparator for the Dijkstra queue.
 	 */
 	struct Comparator {
 		bool operator()(const DistanceAnnotation *x, const DistanceAnnotation *y) const;
@@ -80,7 +89,7 @@ public:
 	}
 
 	/**
-	 * Comparator for std containers.
+	 * Comparator for the Dijkstra queue.
 	 */
 	struct Comparator {
 		bool operator()(const CapacityAnnotation *x, const CapacityAnnotation *y) const;
@@ -88,8 +97,8 @@ public:
 };
 
 /**
- * Iterator class for getting the edges in the order of their next_edge
- * members.
+ * Iterator class for getting the edges of a node in the order they are
+ * stored in, which is by destination.
  */
 class GraphEdgeIterator {
 private:
@@ -104,7 +113,7 @@ public:
 	 * @param job Job to iterate on.
 	 */
 	GraphEdgeIterator(LinkGraphJob &job) : job(job),
-		i(nullptr, nullptr, INVALID_NODE), end(nullptr, nullptr, INVALID_NODE)
+		i(nullptr, nullptr), end(nullptr, nullptr)
 	{}
 
 	/**
@@ -189,6 +198,120 @@ public:
 	}
 };
 
+/**
+ * Priority queue of annotations for the Dijkstra algorithm. It is a binary
+ * heap which remembers the position of each node, so an annotation can be
+ * moved to its new place when it changes without searching for it.
+ * @tparam Tannotation Annotation to be queued.
+ */
+template <class Tannotation>
+class AnnotationHeap {
+private:
+	std::vector<Tannotation *> heap; ///< Queued annotations, the best one first.
+	std::vector<uint> positions;     ///< Position of each node in the heap.
+	typename Tannotation::Comparator better; ///< Comparator telling if one annotation is better than another.
+
+	/**
+	 * Put an annotation at a position in the heap.
+	 * @param pos Position.
+	 * @param anno Annotation.
+	 */
+	inline void Place(uint pos, Tannotation *anno)
+	{
+		this->heap[pos] = anno;
+		this->positions[anno->GetNode()] = pos;
+	}
+
+	/**
+	 * Move the annotation at a position towards the top until the heap is valid again.
+	 * @param pos Position of the annotation.
+	 * @return New position of the annotation.
+	 */
+	uint SiftUp(uint pos)
+	{
+		Tannotation *anno = this->heap[pos];
+		while (pos > 0) {
+			uint parent = (pos - 1) / 2;
+			if (!this->better(anno, this->heap[parent])) break;
+			this->Place(pos, this->heap[parent]);
+			pos = parent;
+		}
+		this->Place(pos, anno);
+		return pos;
+	}
+
+	/**
+	 * Move the annotation at a position towards the bottom until the heap is valid again.
+	 * @param pos Position of the annotation.
+	 */
+	void SiftDown(uint pos)
+	{
+		Tannotation *anno = this->heap[pos];
+		uint size = (uint)this->heap.size();
+		for (;;) {
+			uint child = 2 * pos + 1;
+			if (child >= size) break;
+			if (child + 1 < size && this->better(this->heap[child + 1], this->heap[child])) ++child;
+			if (!this->better(this->heap[child], anno)) break;
+			this->Place(pos, this->heap[child]);
+			pos = child;
+		}
+		this->Place(pos, anno);
+	}
+
+public:
+	/**
+	 * Empty the heap and prepare it for the given number of nodes. The memory
+	 * of earlier searches is reused.
+	 * @param size Number of nodes.
+	 */
+	void Reset(uint size)
+	{
+		this->heap.clear();
+		this->heap.reserve(size);
+		this->positions.assign(size, HEAP_NOT_QUEUED);
+	}
+
+	/**
+	 * Check if there are no more annotations in the heap.
+	 * @return True if the heap is empty.
+	 */
+	inline bool IsEmpty() const { return this->heap.empty(); }
+
+	/**
+	 * Add an annotation to the heap or, if it is queued already, move it to
+	 * the right place after it has changed.
+	 * @param anno Annotation.
+	 */
+	void Update(Tannotation *anno)
+	{
+		uint pos = this->positions[anno->GetNode()];
+		if (pos == HEAP_NOT_QUEUED) {
+			this->heap.push_back(anno);
+			this->SiftUp((uint)this->heap.size() - 1);
+		} else if (this->SiftUp(pos) == pos) {
+			this->SiftDown(pos);
+		}
+	}
+
+	/**
+	 * Remove the best annotation from the heap.
+	 * @return The best annotation.
+	 */
+	Tannotation *Pop()
+	{
+		Tannotation *best = this->heap.front();
+		this->positions[best->GetNode()] = HEAP_NOT_QUEUED;
+		Tannotation *last = this->heap.back();
+		this->heap.pop_back();
+		if (!this->heap.empty()) {
+			this->heap.front() = last;
+			this->SiftDown(0);
+		}
+		return best;
+	}
+};
+
 /**
  * Determines if an extension to the given Path with the given parameters is
  * better than this path.
@@ -258,45 +381,85 @@ bool CapacityAnnotation::IsBetter(const CapacityAnnotation *base, uint cap,
 template<class Tannotation, class Tedge_iterator>
 void MultiCommodityFlow::Dijkstra(NodeID source_node, PathVector &paths)
 {
-	typedef std::set<Tannotation *, typename Tannotation::Comparator> AnnoSet;
+	/* The heap is kept per thread so that its memory is reused for all sources. */
+	static thread_local AnnotationHeap<Tannotation> annos;
 	Tedge_iterator iter(this->job);
 	uint size = this->job.Size();
-	AnnoSet annos;
+	annos.Reset(size);
 	paths.resize(size, nullptr);
 	for (NodeID node = 0; node < size; ++node) {
 		Tannotation *anno = new Tannotation(node, node == source_node);
 		anno->UpdateAnnotation();
-		annos.insert(anno);
+		annos.Update(anno);
 		paths[node] = anno;
 	}
-	while (!annos.empty()) {
-		typename AnnoSet::iterator i = annos.begin();
-		Tannotation *source = *i;
-		annos.erase(i);
+	while (!annos.IsEmpty()) {
+		Tannotation *source = annos.Pop();
 		NodeID from = source->GetNode();
 		iter.SetNode(source_node, from);
 		for (NodeID to = iter.Next(); to != INVALID_NODE; to = iter.Next()) {
 			if (to == from) continue; // Not a real edge but a consumption sign.
 			Edge edge = this->job[from][to];
-			uint capacity = edge.Capacity();
-			if (this->max_saturation != UINT_MAX) {
-				capacity *= this->max_saturation;
-				capacity /= 100;
-				if (capacity == 0) capacity = 1;
-			}
+			uint capacity = this->GetPathCapacity(edge.Capacity());
 			/* punish in-between stops a little */
 			uint distance = DistanceMaxPlusManhattan(this->job[from].XY(), this->job[to].XY()) + 1;
 			Tannotation *dest = static_cast<Tannotation *>(paths[to]);
 			if (dest->IsBetter(source, capacity, capacity - edge.Flow(), distance)) {
-				annos.erase(dest);
+				/* A node that has been settled already is queued again. */
 				dest->Fork(source, capacity, capacity - edge.Flow(), distance);
 				dest->UpdateAnnotation();
-				annos.insert(dest);
+				annos.Update(dest);
 			}
 		}
 	}
 }
 
+/**
+ * Run the Dijkstra algorithm for a batch of sources, spreading the searches
+ * over the worker threads. The searches only read the link graph job, so they
+ * can run at the same time; the flow has to be pushed afterwards.
+ * @tparam Tannotation Annotation to be used.
+ * @tparam Tedge_iterator Iterator to be used for getting outgoing edges.
+ * @param sources Nodes where the searches start.
+ * @param paths Containers for the paths to be calculated, one for each source.
+ */
+template<class Tannotation, class Tedge_iterator>
+void MultiCommodityFlow::Dijkstra(const std::vector<NodeID> &sources, std::vector<PathVector> &paths)
+{
+	RunParallelFor((uint)sources.size(), 1, [&](uint begin, uint end) {
+		for (uint i = begin; i < end; ++i) {
+			this->Dijkstra<Tannotation, Tedge_iterator>(sources[i], paths[i]);
+		}
+	});
+}
+
+/**
+ * Collect the next batch of unfinished sources.
+ * @param first First node to consider.
+ * @param finished_sources Sources which don't have any demand left.
+ * @param sources Container for the sources of the batch.
+ */
+void MultiCommodityFlow::GetSourceBatch(NodeID first, const std::vector<bool> &finished_sources, std::vector<NodeID> &sources)
+{
+	sources.clear();
+	NodeID last = (NodeID)min<uint>(this->job.Size(), first + MCF_SOURCE_BATCH);
+	for (NodeID source = first; source < last; ++source) {
+		if (!finished_sources[source]) sources.push_back(source);
+	}
+}
+
+/**
+ * Mark the sources which don't have any unsatisfied demand as finished.
+ * Searching paths for them wouldn't change anything.
+ * @param finished_sources Sources which don't have any demand left.
+ */
+void MultiCommodityFlow::InitFinishedSources(std::vector<bool> &finished_sources)
+{
+	for (NodeID source = 0; source < this->job.Size(); ++source) {
+		finished_sources[source] = !this->job[source].HasUnsatisfiedDemand();
+	}
+}
+
 /**
  * Clean up paths that lead nowhere and the root path.
  * @param source_id ID of the root node.
@@ -465,6 +628,68 @@ bool MCF1stPass::EliminateCycles(PathVector &path, NodeID origin_id, NodeID next
 	return false;
 }
 
+/**
+ * Route as much demand as possible along the routes the flows took when the
+ * job was spawned, so that only sources whose demand doesn't fit on them
+ * anymore are searched for paths. The routes of each source are rebuilt as a
+ * tree, breadth first and preferring the links which carried more flow. Links
+ * which don't exist anymore are skipped.
+ * @param finished_sources Sources which don't have any demand left.
+ */
+void MCF1stPass::WarmStart(std::vector<bool> &finished_sources)
+{
+	typedef LinkGraphJob::RouteLinkVector::const_iterator RouteIterator;
+	const LinkGraphJob::RouteLinkVector &routes = this->job.PreviousRoutes();
+	uint size = this->job.Size();
+	PathVector paths;
+	std::vector<NodeID> queue;
+
+	for (RouteIterator begin = routes.begin(); begin != routes.end();) {
+		NodeID source = begin->origin;
+		RouteIterator end = begin;
+		while (end != routes.end() && end->origin == source) ++end;
+		if (source >= size || finished_sources[source]) {
+			begin = end;
+			continue;
+		}
+
+		paths.assign(size, nullptr);
+		paths[source] = new Path(source, true);
+		queue.assign(1, source);
+		for (uint i = 0; i < queue.size(); ++i) {
+			NodeID from = queue[i];
+			RouteIterator link = std::lower_bound(begin, end, from,
+					[](const LinkGraphJob::RouteLink &link, NodeID from) { return link.from < from; });
+			for (; link != end && link->from == from; ++link) {
+				NodeID to = link->to;
+				if (to >= size || paths[to] != nullptr) continue;
+				Edge edge = this->job[from][to];
+				if (edge.Capacity() == 0) continue;
+				uint capacity = this->GetPathCapacity(edge.Capacity());
+				uint distance = DistanceMaxPlusManhattan(this->job[from].XY(), this->job[to].XY()) + 1;
+				paths[to] = new Path(to);
+				paths[to]->Fork(paths[from], capacity, capacity - edge.Flow(), distance);
+				queue.push_back(to);
+			}
+		}
+
+		/* Whatever doesn't fit on the old routes is left to the regular search. */
+		bool source_demand_left = false;
+		for (NodeID dest = 0; dest < size; ++dest) {
+			Edge edge = this->job[source][dest];
+			if (edge.UnsatisfiedDemand() == 0) continue;
+			Path *path = paths[dest];
+			if (path != nullptr && dest != source) {
+				edge.SatisfyDemand(path->AddFlow(edge.UnsatisfiedDemand(), this->job, this->max_saturation));
+			}
+			if (edge.UnsatisfiedDemand() > 0) source_demand_left = true;
+		}
+		finished_sources[source] = !source_demand_left;
+		this->CleanupPaths(source, paths);
+		begin = end;
+	}
+}
+
 /**
  * Eliminate all cycles in the graph. Check paths starting at each node for
  * potential cycles.
@@ -490,43 +715,50 @@ bool MCF1stPass::EliminateCycles()
  */
 MCF1stPass::MCF1stPass(LinkGraphJob &job) : MultiCommodityFlow(job)
 {
-	PathVector paths;
+	std::vector<PathVector> batch_paths(MCF_SOURCE_BATCH);
+	std::vector<NodeID> sources;
 	uint size = job.Size();
 	uint accuracy = job.Settings().accuracy;
 	bool more_loops;
 	std::vector<bool> finished_sources(size);
+	this->InitFinishedSources(finished_sources);
+	if (job.Settings().incremental) this->WarmStart(finished_sources);
 
 	do {
 		more_loops = false;
-		for (NodeID source = 0; source < size; ++source) {
-			if (finished_sources[source]) continue;
+		for (NodeID first = 0; first < size; first += MCF_SOURCE_BATCH) {
+			this->GetSourceBatch(first, finished_sources, sources);
 
 			/* First saturate the shortest paths. */
-			this->Dijkstra<DistanceAnnotation, GraphEdgeIterator>(source, paths);
-
-			bool source_demand_left = false;
-			for (NodeID dest = 0; dest < size; ++dest) {
-				Edge edge = job[source][dest];
-				if (edge.UnsatisfiedDemand() > 0) {
-					Path *path = paths[dest];
-					assert(path != nullptr);
-					/* Generally only allow paths that don't exceed the
-					 * available capacity. But if no demand has been assigned
-					 * yet, make an exception and allow any valid path *once*. */
-					if (path->GetFreeCapacity() > 0 && this->PushFlow(edge, path,
-							accuracy, this->max_saturation) > 0) {
-						/* If a path has been found there is a chance we can
-						 * find more. */
-						more_loops = more_loops || (edge.UnsatisfiedDemand() > 0);
-					} else if (edge.UnsatisfiedDemand() == edge.Demand() &&
-							path->GetFreeCapacity() > INT_MIN) {
-						this->PushFlow(edge, path, accuracy, UINT_MAX);
+			this->Dijkstra<DistanceAnnotation, GraphEdgeIterator>(sources, batch_paths);
+
+			for (uint i = 0; i < sources.size(); ++i) {
+				NodeID source = sources[i];
+				PathVector &paths = batch_paths[i];
+				bool source_demand_left = false;
+				for (NodeID dest = 0; dest < size; ++dest) {
+					Edge edge = job[source][dest];
+					if (edge.UnsatisfiedDemand() > 0) {
+						Path *path = paths[dest];
+						assert(path != nullptr);
+						/* Generally only allow paths that don't exceed the
+						 * available capacity. But if no demand has been assigned
+						 * yet, make an exception and allow any valid path *once*. */
+						if (path->GetFreeCapacity() > 0 && this->PushFlow(edge, path,
+								accuracy, this->max_saturation) > 0) {
+							/* If a path has been found there is a chance we can
+							 * find more. */
+							more_loops = more_loops || (edge.UnsatisfiedDemand() > 0);
+						} else if (edge.UnsatisfiedDemand() == edge.Demand() &&
+								path->GetFreeCapacity() > INT_MIN) {
+							this->PushFlow(edge, path, accuracy, UINT_MAX);
+						}
+						if (edge.UnsatisfiedDemand() > 0) source_demand_left = true;
 					}
-					if (edge.UnsatisfiedDemand() > 0) source_demand_left = true;
 				}
+				finished_sources[source] = !source_demand_left;
+				this->CleanupPaths(source, paths);
 			}
-			finished_sources[source] = !source_demand_left;
-			this->CleanupPaths(source, paths);
 		}
 	} while (more_loops || this->EliminateCycles());
 }
@@ -539,41 +771,47 @@ MCF1stPass::MCF1stPass(LinkGraphJob &job) : MultiCommodityFlow(job)
 MCF2ndPass::MCF2ndPass(LinkGraphJob &job) : MultiCommodityFlow(job)
 {
 	this->max_saturation = UINT_MAX; // disable artificial cap on saturation
-	PathVector paths;
+	std::vector<PathVector> batch_paths(MCF_SOURCE_BATCH);
+	std::vector<NodeID> sources;
 	uint size = job.Size();
 	uint accuracy = job.Settings().accuracy;
 	bool demand_left = true;
 	std::vector<bool> finished_sources(size);
+	this->InitFinishedSources(finished_sources);
 	while (demand_left) {
 		demand_left = false;
-		for (NodeID source = 0; source < size; ++source) {
-			if (finished_sources[source]) continue;
+		for (NodeID first = 0; first < size; first += MCF_SOURCE_BATCH) {
+			this->GetSourceBatch(first, finished_sources, sources);
 
-			this->Dijkstra<CapacityAnnotation, FlowEdgeIterator>(source, paths);
+			this->Dijkstra<CapacityAnnotation, FlowEdgeIterator>(sources, batch_paths);
 
-			bool source_demand_left = false;
-			for (NodeID dest = 0; dest < size; ++dest) {
-				Edge edge = this->job[source][dest];
-				Path *path = paths[dest];
-				if (edge.UnsatisfiedDemand() > 0 && path->GetFreeCapacity() > INT_MIN) {
-					this->PushFlow(edge, path, accuracy, UINT_MAX);
-					if (edge.UnsatisfiedDemand() > 0) {
-						demand_left = true;
-						source_demand_left = true;
+			for (uint i = 0; i < sources.size(); ++i) {
+				NodeID source = sources[i];
+				PathVector &paths = batch_paths[i];
+				bool source_demand_left = false;
+				for (NodeID dest = 0; dest < size; ++dest) {
+					Edge edge = this->job[source][dest];
+					Path *path = paths[dest];
+					if (edge.UnsatisfiedDemand() > 0 && path->GetFreeCapacity() > INT_MIN) {
+						this->PushFlow(edge, path, accuracy, UINT_MAX);
+						if (edge.UnsatisfiedDemand() > 0) {
+							demand_left = true;
+							source_demand_left = true;
+						}
 					}
 				}
+				finished_sources[source] = !source_demand_left;
+				this->CleanupPaths(source, paths);
 			}
-			finished_sources[source] = !source_demand_left;
-			this->CleanupPaths(source, paths);
 		}
 	}
 }
 
 /**
  * Relation that creates a weak order without duplicates.
- * Avoid accidentally deleting different paths of the same capacity/distance in
- * a set. When the annotation is the same node IDs are compared, so there are
- * no equal ranges.
+ * When the annotation is the same node IDs are compared, so there are no
+ * equal ranges and the order in which the Dijkstra algorithm settles nodes
+ * doesn't depend on how the queue is implemented.
  * @tparam T Type to be compared on.
  * @param x_anno First value.
  * @param y_anno Second value.
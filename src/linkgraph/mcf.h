@@ -24,6 +24,25 @@ protected:
 	template<class Tannotation, class Tedge_iterator>
 	void Dijkstra(NodeID from, PathVector &paths);
 
+	template<class Tannotation, class Tedge_iterator>
+	void Dijkstra(const std::vector<NodeID> &sources, std::vector<PathVector> &paths);
+
+	void GetSourceBatch(NodeID first, const std::vector<bool> &finished_sources, std::vector<NodeID> &sources);
+	void InitFinishedSources(std::vector<bool> &finished_sources);
+
+	/**
+	 * Get the capacity of an edge as seen by the path search, which is
+	 * reduced according to max_saturation.
+	 * @param capacity Capacity of the edge.
+	 * @return Capacity available to paths.
+	 */
+	inline uint GetPathCapacity(uint capacity) const
+	{
+		if (this->max_saturation == UINT_MAX) return capacity;
+		capacity = capacity * this->max_saturation / 100;
+		return capacity == 0 ? 1 : capacity;
+	}
+
 	uint PushFlow(Edge &edge, Path *path, uint accuracy, uint max_saturation);
 
 	void CleanupPaths(NodeID source, PathVector &paths);
@@ -53,6 +72,7 @@ private:
 	bool EliminateCycles(PathVector &path, NodeID origin_id, NodeID next_id);
 	void EliminateCycle(PathVector &path, Path *cycle_begin, uint flow);
 	uint FindCycleFlow(const PathVector &path, const Path *cycle_begin);
+	void WarmStart(std::vector<bool> &finished_sources);
 public:
 	MCF1stPass(LinkGraphJob &job);
 };
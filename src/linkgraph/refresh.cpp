@@ -12,11 +12,17 @@
 #include "../station_func.h"
 #include "../engine_base.h"
 #include "../vehicle_func.h"
+#include "../date_func.h"
+#include "../newgrf_callbacks.h"
 #include "refresh.h"
 #include "linkgraph.h"
 
 #include "../safeguards.h"
 
+/* static */ LinkRefresher::RefreshCache LinkRefresher::done_refreshes;
+/* static */ Date LinkRefresher::done_refreshes_date = INVALID_DATE;
+/* static */ uint32 LinkRefresher::done_refreshes_changes = 0;
+
 /**
  * Refresh all links the given vehicle will visit.
  * @param v Vehicle to refresh links for.
@@ -32,10 +38,70 @@
 	const Order *first = v->orders.list->GetNextDecisionNode(v->GetOrder(v->cur_implicit_order_index), 0);
 	if (first == nullptr) return;
 
+	bool has_cargo = v->last_loading_station != INVALID_STATION;
+
+	/* Vehicles sharing orders mostly repeat the refresh another one did
+	 * already. Refreshing only raises capacities to at least the given ones
+	 * and sets the update dates to today, so doing the same refresh twice on
+	 * the same day only changes something when the link graph was changed in
+	 * between, e.g. compressed. Refreshes of full loading vehicles add to the
+	 * capacities, and are always done. */
+	if (!is_full_loading) {
+		if (_date != LinkRefresher::done_refreshes_date || LinkGraph::changes != LinkRefresher::done_refreshes_changes) {
+			LinkRefresher::done_refreshes.clear();
+			LinkRefresher::done_refreshes_date = _date;
+			LinkRefresher::done_refreshes_changes = LinkGraph::changes;
+		}
+
+		std::vector<uint32> signature;
+		if (LinkRefresher::GetSignature(v, signature)) {
+			std::vector<uint32> &done = LinkRefresher::done_refreshes[{ v->orders.list->index, first->index, has_cargo, allow_merge }];
+			if (done == signature) return;
+			done = std::move(signature);
+		}
+	}
+
 	HopSet seen_hops;
 	LinkRefresher refresher(v, &seen_hops, allow_merge, is_full_loading);
 
-	refresher.RefreshLinks(first, first, v->last_loading_station != INVALID_STATION ? 1 << HAS_CARGO : 0);
+	refresher.RefreshLinks(first, first, has_cargo ? 1 << HAS_CARGO : 0);
+}
+
+/**
+ * Get everything the refresh of the links of a vehicle depends on besides its #RefreshKey.
+ * @param v Vehicle to refresh links for.
+ * @param[out] signature The orders of the vehicle, and the cargoes and capacities of its parts.
+ * @return False if the refresh also depends on NewGRF callbacks about the vehicle itself,
+ *         so it cannot be compared with the refreshes of other vehicles.
+ */
+/* static */ bool LinkRefresher::GetSignature(const Vehicle *v, std::vector<uint32> &signature)
+{
+	for (const Order *o = v->orders.list->GetFirstOrder(); o != nullptr; o = o->next) {
+		signature.push_back(o->index);
+		signature.push_back(o->Pack());
+		signature.push_back(o->GetRefitCargo());
+	}
+	for (const Vehicle *u = v; u != nullptr; u = u->Next()) {
+		/* The capacities of refits are determined for the vehicle itself. */
+		if (HasBit(u->GetEngine()->info.callback_mask, CBM_VEHICLE_REFIT_CAPACITY)) return false;
+
+		signature.push_back(u->engine_type | u->cargo_type << 16 | u->cargo_subtype << 24);
+		signature.push_back(u->cargo_cap | u->refit_cap << 16);
+	}
+	return true;
+}
+
+/**
+ * Comparison operator to allow refresh keys to be used in a std::map.
+ * @param other Other key to be compared with.
+ * @return If this key is "smaller" than the other.
+ */
+bool LinkRefresher::RefreshKey::operator<(const RefreshKey &other) const
+{
+	if (this->list != other.list) return this->list < other.list;
+	if (this->first != other.first) return this->first < other.first;
+	if (this->has_cargo != other.has_cargo) return this->has_cargo < other.has_cargo;
+	return this->allow_merge < other.allow_merge;
 }
 
 /**
@@ -80,6 +80,27 @@ protected:
 	typedef std::vector<RefitDesc> RefitList;
 	typedef std::set<Hop> HopSet;
 
+	/**
+	 * Which refresh a vehicle would do. The rest of what the refresh depends
+	 * on is in the signature of the refresh; see #GetSignature.
+	 */
+	struct RefreshKey {
+		OrderListID list;  ///< Order list simulated.
+		OrderID first;     ///< First order of the simulation.
+		bool has_cargo;    ///< Whether the vehicle is carrying cargo at the start.
+		bool allow_merge;  ///< If the refresher is allowed to merge or extend link graphs.
+
+		bool operator<(const RefreshKey &other) const;
+	};
+
+	typedef std::map<RefreshKey, std::vector<uint32>> RefreshCache;
+
+	static RefreshCache done_refreshes;  ///< Signatures of the refreshes done today and since the last change of link graphs.
+	static Date done_refreshes_date;     ///< The date of #done_refreshes.
+	static uint32 done_refreshes_changes; ///< The LinkGraph::changes of #done_refreshes.
+
+	static bool GetSignature(const Vehicle *v, std::vector<uint32> &signature);
+
 	Vehicle *vehicle;           ///< Vehicle for which the links should be refreshed.
 	uint capacities[NUM_CARGO]; ///< Current added capacities per cargo ID in the consist.
 	RefitList refit_capacities; ///< Current state of capacity remaining from previous refits versus overall capacity per vehicle in the consist.
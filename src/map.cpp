@@ -12,6 +12,15 @@
 #include "core/alloc_func.hpp"
 #include "water_map.h"
 #include "string_func.h"
+#include "vehicle_func.h"
+#include "map_snapshot.h"
+
+#if defined(UNIX) && !defined(__EMSCRIPTEN__)
+#	include <sys/mman.h>
+#	define WITH_MMAP_MAP
+#elif defined(_WIN32)
+#	include <windows.h>
+#endif
 
 #include "safeguards.h"
 
@@ -27,9 +36,68 @@ uint _map_size_y;    ///< Size of the map along the Y
 uint _map_size;      ///< The number of tiles on the map
 uint _map_tile_mask; ///< _map_size - 1 (to mask the mapsize)
 
+TileTypeHeight *_mth = nullptr; ///< Types and heights of the tiles of the map
 Tile *_m = nullptr;          ///< Tiles of the map
 TileExtended *_me = nullptr; ///< Extended Tiles of the map
+byte *_flood_stable_tiles = nullptr; ///< Tiles that cannot flood any of their neighbours
+
+static const size_t MAP_ARRAY_ALIGNMENT = 2 * 1024 * 1024; ///< Size of the huge pages the map arrays are allocated in, when possible.
 
+/**
+ * Allocate zeroed memory for one of the map arrays. The map arrays are big
+ * and accessed all over the place, so they are placed in huge pages when the
+ * operating system lets us; that saves a lot of TLB misses. Otherwise normal
+ * pages are used.
+ * @param size The number of bytes to allocate.
+ * @return The allocated memory, free it with FreeMapArray().
+ */
+static void *AllocateMapArray(size_t size)
+{
+	size = Align(size, MAP_ARRAY_ALIGNMENT);
+#if defined(WITH_MMAP_MAP)
+	void *mem = MAP_FAILED;
+#	if defined(MAP_HUGETLB)
+	/* Explicit huge pages only work when the administrator reserved them. */
+	mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#	endif
+	if (mem == MAP_FAILED) {
+		mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mem == MAP_FAILED) MallocError(size);
+#	if defined(MADV_HUGEPAGE)
+		/* Otherwise ask for transparent huge pages. */
+		madvise(mem, size, MADV_HUGEPAGE);
+#	endif
+	}
+	return mem;
+#elif defined(_WIN32)
+	/* Large pages need the 'lock pages in memory' privilege, so they often can't be had. */
+	void *mem = nullptr;
+	SIZE_T large_page = GetLargePageMinimum();
+	if (large_page != 0 && size % large_page == 0) mem = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+	if (mem == nullptr) mem = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	if (mem == nullptr) MallocError(size);
+	return mem;
+#else
+	return CallocT<byte>(size);
+#endif
+}
+
+/**
+ * Free memory allocated by AllocateMapArray().
+ * @param mem The memory to free, may be nullptr.
+ * @param size The number of bytes that were allocated.
+ */
+static void FreeMapArray(void *mem, size_t size)
+{
+	if (mem == nullptr) return;
+#if defined(WITH_MMAP_MAP)
+	munmap(mem, Align(size, MAP_ARRAY_ALIGNMENT));
+#elif defined(_WIN32)
+	VirtualFree(mem, 0, MEM_RELEASE);
+#else
+	free(mem);
+#endif
+}
 
 /**
  * (Re)allocates a map with the given dimension
@@ -43,12 +111,20 @@ void AllocateMap(uint size_x, uint size_y)
 	if (!IsInsideMM(size_x, MIN_MAP_SIZE, MAX_MAP_SIZE + 1) ||
 			!IsInsideMM(size_y, MIN_MAP_SIZE, MAX_MAP_SIZE + 1) ||
 			(size_x & (size_x - 1)) != 0 ||
-			(size_y & (size_y - 1)) != 0) {
+			(size_y & (size_y - 1)) != 0 ||
+			FindFirstBit(size_x) + FindFirstBit(size_y) > MAX_MAP_TILES_BITS) {
 		error("Invalid map size");
 	}
 
 	DEBUG(map, 1, "Allocating map of size %dx%d", size_x, size_y);
 
+	ResetMapSnapshot();
+
+	FreeMapArray(_mth, _map_size * sizeof(TileTypeHeight));
+	FreeMapArray(_m, _map_size * sizeof(Tile));
+	FreeMapArray(_me, _map_size * sizeof(TileExtended));
+	free(_flood_stable_tiles);
+
 	_map_log_x = FindFirstBit(size_x);
 	_map_log_y = FindFirstBit(size_y);
 	_map_size_x = size_x;
@@ -56,11 +132,13 @@ void AllocateMap(uint size_x, uint size_y)
 	_map_size = size_x * size_y;
 	_map_tile_mask = _map_size - 1;
 
-	free(_m);
-	free(_me);
+	_mth = (TileTypeHeight *)AllocateMapArray(_map_size * sizeof(TileTypeHeight));
+	_m = (Tile *)AllocateMapArray(_map_size * sizeof(Tile));
+	_me = (TileExtended *)AllocateMapArray(_map_size * sizeof(TileExtended));
+	_flood_stable_tiles = CallocT<byte>(_map_size / 8);
 
-	_m = CallocT<Tile>(_map_size);
-	_me = CallocT<TileExtended>(_map_size);
+	AllocateWaterRegions();
+	AllocateVehicleTileHash();
 }
 
 
@@ -244,91 +322,35 @@ uint DistanceFromEdgeDir(TileIndex tile, DiagDirection dir)
 
 /**
  * Function performing a search around a center tile and going outward, thus in circle.
- * Although it really is a square search...
- * Every tile will be tested by means of the callback function proc,
- * which will determine if yes or no the given tile meets criteria of search.
  * @param tile to start the search from. Upon completion, it will return the tile matching the search
  * @param size: number of tiles per side of the desired search area
  * @param proc: callback testing function pointer.
  * @param user_data to be passed to the callback function. Depends on the implementation
  * @return result of the search
- * @pre proc != nullptr
- * @pre size > 0
+ * @see CircularTileSearch(TileIndex *, uint, Tproc)
  */
 bool CircularTileSearch(TileIndex *tile, uint size, TestTileOnSearchProc proc, void *user_data)
 {
 	assert(proc != nullptr);
-	assert(size > 0);
-
-	if (size % 2 == 1) {
-		/* If the length of the side is uneven, the center has to be checked
-		 * separately, as the pattern of uneven sides requires to go around the center */
-		if (proc(*tile, user_data)) return true;
-
-		/* If tile test is not successful, get one tile up,
-		 * ready for a test in first circle around center tile */
-		*tile = TileAddByDir(*tile, DIR_N);
-		return CircularTileSearch(tile, size / 2, 1, 1, proc, user_data);
-	} else {
-		return CircularTileSearch(tile, size / 2, 0, 0, proc, user_data);
-	}
+	return CircularTileSearch(tile, size, [&](TileIndex t) { return proc(t, user_data); });
 }
 
 /**
  * Generalized circular search allowing for rectangles and a hole.
- * Function performing a search around a center rectangle and going outward.
- * The center rectangle is left out from the search. To do a rectangular search
- * without a hole, set either h or w to zero.
- * Every tile will be tested by means of the callback function proc,
- * which will determine if yes or no the given tile meets criteria of search.
  * @param tile to start the search from. Upon completion, it will return the tile matching the search.
  *  This tile should be directly north of the hole (if any).
- * @param radius How many tiles to search outwards. Note: This is a radius and thus different
- *                from the size parameter of the other CircularTileSearch function, which is a diameter.
+ * @param radius How many tiles to search outwards.
  * @param w the width of the inner rectangle
  * @param h the height of the inner rectangle
  * @param proc callback testing function pointer.
  * @param user_data to be passed to the callback function. Depends on the implementation
  * @return result of the search
- * @pre proc != nullptr
- * @pre radius > 0
+ * @see CircularTileSearch(TileIndex *, uint, uint, uint, Tproc)
  */
 bool CircularTileSearch(TileIndex *tile, uint radius, uint w, uint h, TestTileOnSearchProc proc, void *user_data)
 {
 	assert(proc != nullptr);
-	assert(radius > 0);
-
-	uint x = TileX(*tile) + w + 1;
-	uint y = TileY(*tile);
-
-	const uint extent[DIAGDIR_END] = { w, h, w, h };
-
-	for (uint n = 0; n < radius; n++) {
-		for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
-			/* Is the tile within the map? */
-			for (uint j = extent[dir] + n * 2 + 1; j != 0; j--) {
-				if (x < MapSizeX() && y < MapSizeY()) {
-					TileIndex t = TileXY(x, y);
-					/* Is the callback successful? */
-					if (proc(t, user_data)) {
-						/* Stop the search */
-						*tile = t;
-						return true;
-					}
-				}
-
-				/* Step to the next 'neighbour' in the circular line */
-				x += _tileoffs_by_diagdir[dir].x;
-				y += _tileoffs_by_diagdir[dir].y;
-			}
-		}
-		/* Jump to next circle to test */
-		x += _tileoffs_by_dir[DIR_W].x;
-		y += _tileoffs_by_dir[DIR_W].y;
-	}
-
-	*tile = INVALID_TILE;
-	return false;
+	return CircularTileSearch(tile, radius, w, h, [&](TileIndex t) { return proc(t, user_data); });
 }
 
 /**
@@ -25,6 +25,14 @@ extern uint _map_tile_mask;
 
 #define TILE_MASK(x) ((x) & _map_tile_mask)
 
+/**
+ * Pointer to the tile type and height array.
+ *
+ * This variable points to the array which contains the type and height
+ * of the tiles of the map.
+ */
+extern TileTypeHeight *_mth;
+
 /**
  * Pointer to the tile-array.
  *
@@ -41,6 +49,14 @@ extern Tile *_m;
  */
 extern TileExtended *_me;
 
+/**
+ * Bitmap of the tiles from which flooding cannot reach any other tile,
+ * because all their neighbours are water. A bit is set by the water tile
+ * loop once it found out, and is cleared whenever the type of the tile or
+ * of one of its neighbours changes.
+ */
+extern byte *_flood_stable_tiles;
+
 void AllocateMap(uint size_x, uint size_y);
 
 /**
@@ -416,6 +432,101 @@ typedef bool TestTileOnSearchProc(TileIndex tile, void *user_data);
 bool CircularTileSearch(TileIndex *tile, uint size, TestTileOnSearchProc proc, void *user_data);
 bool CircularTileSearch(TileIndex *tile, uint radius, uint w, uint h, TestTileOnSearchProc proc, void *user_data);
 
+/**
+ * Generalized circular search allowing for rectangles and a hole.
+ * Function performing a search around a center rectangle and going outward.
+ * The center rectangle is left out from the search. To do a rectangular search
+ * without a hole, set either h or w to zero.
+ * Every tile will be tested by means of the callback function proc,
+ * which will determine if yes or no the given tile meets criteria of search.
+ * @param tile to start the search from. Upon completion, it will return the tile matching the search.
+ *  This tile should be directly north of the hole (if any).
+ * @param radius How many tiles to search outwards. Note: This is a radius and thus different
+ *                from the size parameter of the other CircularTileSearch function, which is a diameter.
+ * @param w the width of the inner rectangle
+ * @param h the height of the inner rectangle
+ * @param proc callback testing a tile, called as bool proc(TileIndex tile).
+ * @return result of the search
+ * @pre radius > 0
+ */
+template <typename Tproc>
+bool CircularTileSearch(TileIndex *tile, uint radius, uint w, uint h, Tproc proc)
+{
+	assert(radius > 0);
+
+	uint x = TileX(*tile) + w + 1;
+	uint y = TileY(*tile);
+
+	const uint extent[DIAGDIR_END] = { w, h, w, h };
+
+	for (uint n = 0; n < radius; n++) {
+		for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+			const TileIndexDiffC step = TileIndexDiffCByDiagDir(dir);
+			uint length = extent[dir] + n * 2 + 1;
+
+			/* Along a side only one of the coordinates changes; when the other is outside of the map, so is the whole side. */
+			if (step.x == 0 ? x >= MapSizeX() : y >= MapSizeY()) {
+				x += step.x * length;
+				y += step.y * length;
+				continue;
+			}
+
+			for (; length != 0; length--) {
+				/* Is the tile within the map? */
+				if (x < MapSizeX() && y < MapSizeY()) {
+					TileIndex t = TileXY(x, y);
+					/* Is the callback successful? */
+					if (proc(t)) {
+						/* Stop the search */
+						*tile = t;
+						return true;
+					}
+				}
+
+				/* Step to the next 'neighbour' in the circular line */
+				x += step.x;
+				y += step.y;
+			}
+		}
+		/* Jump to next circle to test */
+		x += TileIndexDiffCByDir(DIR_W).x;
+		y += TileIndexDiffCByDir(DIR_W).y;
+	}
+
+	*tile = INVALID_TILE;
+	return false;
+}
+
+/**
+ * Function performing a search around a center tile and going outward, thus in circle.
+ * Although it really is a square search...
+ * Every tile will be tested by means of the callback function proc,
+ * which will determine if yes or no the given tile meets criteria of search.
+ * @param tile to start the search from. Upon completion, it will return the tile matching the search
+ * @param size: number of tiles per side of the desired search area
+ * @param proc: callback testing a tile, called as bool proc(TileIndex tile).
+ * @return result of the search
+ * @pre size > 0
+ */
+template <typename Tproc>
+bool CircularTileSearch(TileIndex *tile, uint size, Tproc proc)
+{
+	assert(size > 0);
+
+	if (size % 2 == 1) {
+		/* If the length of the side is uneven, the center has to be checked
+		 * separately, as the pattern of uneven sides requires to go around the center */
+		if (proc(*tile)) return true;
+
+		/* If tile test is not successful, get one tile up,
+		 * ready for a test in first circle around center tile */
+		*tile = TileAddByDir(*tile, DIR_N);
+		return CircularTileSearch(tile, size / 2, 1, 1, proc);
+	} else {
+		return CircularTileSearch(tile, size / 2, 0, 0, proc);
+	}
+}
+
 /**
  * Get a random tile out of a given seed.
  * @param r the random 'seed'
@@ -0,0 +1,78 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file map_snapshot.cpp Read-only copies of the map for code running outside of the game loop thread. */
+
+#include "stdafx.h"
+#include "map_func.h"
+#include "map_snapshot.h"
+#include <atomic>
+#include <mutex>
+
+#include "safeguards.h"
+
+static std::mutex _map_snapshot_mutex;                   ///< Protects #_map_snapshot.
+static std::shared_ptr<MapSnapshot> _map_snapshot;       ///< The latest snapshot, if any.
+static std::shared_ptr<MapSnapshot> _map_snapshot_spare; ///< The snapshot before that; its arrays are reused once nobody uses it anymore.
+static std::atomic<bool> _map_snapshot_wanted;           ///< Whether a snapshot has been asked for since the last update.
+static uint64 _map_snapshot_epoch = 0;                   ///< Epoch of the last snapshot that was taken.
+
+/**
+ * Get the latest snapshot of the map. It can be called from any thread and the
+ * snapshot stays valid for as long as the caller holds on to it.
+ * Asking for a snapshot makes sure one is taken at the end of the current tick,
+ * so the first time, or after not asking for a tick, there might not be one yet.
+ * @return The latest snapshot, or nullptr when there is none yet.
+ */
+std::shared_ptr<const MapSnapshot> GetMapSnapshot()
+{
+	_map_snapshot_wanted = true;
+
+	std::lock_guard<std::mutex> lock(_map_snapshot_mutex);
+	return _map_snapshot;
+}
+
+/**
+ * Take a new snapshot of the map, if one has been asked for since the last update.
+ * Otherwise the snapshot is dropped, so nobody gets a map that is more than a tick old.
+ * Must be called from the game loop thread at the end of each tick.
+ */
+void UpdateMapSnapshot()
+{
+	if (!_map_snapshot_wanted.exchange(false)) {
+		ResetMapSnapshot();
+		return;
+	}
+
+	/* The spare snapshot is not handed out anymore, so once only we hold it nobody else will. */
+	std::shared_ptr<MapSnapshot> snapshot;
+	if (_map_snapshot_spare.use_count() == 1) snapshot = std::move(_map_snapshot_spare);
+	_map_snapshot_spare.reset();
+	if (snapshot == nullptr) snapshot = std::make_shared<MapSnapshot>();
+
+	snapshot->epoch = ++_map_snapshot_epoch;
+	snapshot->size_x = MapSizeX();
+	snapshot->size_y = MapSizeY();
+	snapshot->mth.assign(_mth, _mth + MapSize());
+	snapshot->m.assign(_m, _m + MapSize());
+	snapshot->me.assign(_me, _me + MapSize());
+
+	std::lock_guard<std::mutex> lock(_map_snapshot_mutex);
+	_map_snapshot_spare = std::move(_map_snapshot);
+	_map_snapshot = std::move(snapshot);
+}
+
+/**
+ * Drop the latest snapshot, e.g. because the map is about to be replaced.
+ * Those still holding on to it can keep using it.
+ */
+void ResetMapSnapshot()
+{
+	std::lock_guard<std::mutex> lock(_map_snapshot_mutex);
+	_map_snapshot.reset();
+	_map_snapshot_spare.reset();
+}
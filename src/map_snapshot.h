@@ -0,0 +1,97 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file map_snapshot.h
+ * Read-only copies of the map for code running outside of the game loop thread.
+ *
+ * The map arrays are changed in place all over the game loop, so other threads cannot
+ * read them safely. Instead they can ask for a #MapSnapshot: a copy of the arrays as
+ * they were at the end of a tick. A snapshot is only kept up to date while it is being
+ * asked for, so the map is not copied every tick when nobody needs it.
+ */
+
+#ifndef MAP_SNAPSHOT_H
+#define MAP_SNAPSHOT_H
+
+#include "map_type.h"
+#include "tile_type.h"
+#include "company_type.h"
+#include "core/bitmath_func.hpp"
+#include <memory>
+#include <vector>
+
+/** Copy of the map arrays at the end of a tick. */
+struct MapSnapshot {
+	uint64 epoch;                      ///< Number of the snapshot; increases by one every time the map is copied.
+	uint size_x;                       ///< Size of the map along the X.
+	uint size_y;                       ///< Size of the map along the Y.
+	std::vector<TileTypeHeight> mth;   ///< Copy of #_mth.
+	std::vector<Tile> m;               ///< Copy of #_m.
+	std::vector<TileExtended> me;      ///< Copy of #_me.
+
+	/**
+	 * Get the number of tiles of the map.
+	 * @return The number of tiles.
+	 */
+	inline uint Size() const
+	{
+		return this->size_x * this->size_y;
+	}
+
+	/**
+	 * Get the tile at the given coordinates.
+	 * @param x The X coordinate.
+	 * @param y The Y coordinate.
+	 * @return The tile index.
+	 */
+	inline TileIndex TileXY(uint x, uint y) const
+	{
+		return y * this->size_x + x;
+	}
+
+	/**
+	 * Get the type of a tile.
+	 * @param tile The tile to get the type of.
+	 * @return The type of the tile.
+	 * @see GetTileType
+	 */
+	inline TileType GetTileType(TileIndex tile) const
+	{
+		assert(tile < this->Size());
+		return (TileType)GB(this->mth[tile].type, 4, 4);
+	}
+
+	/**
+	 * Get the height of the northern corner of a tile.
+	 * @param tile The tile to get the height of.
+	 * @return The height of the tile.
+	 * @see TileHeight
+	 */
+	inline uint TileHeight(TileIndex tile) const
+	{
+		assert(tile < this->Size());
+		return this->mth[tile].height;
+	}
+
+	/**
+	 * Get the owner of a tile, as stored in m1.
+	 * Like #GetTileOwner this must not be used for tiles without owner, like houses and industries.
+	 * @param tile The tile to get the owner of.
+	 * @return The owner of the tile.
+	 */
+	inline Owner GetTileOwner(TileIndex tile) const
+	{
+		assert(tile < this->Size());
+		return (Owner)GB(this->m[tile].m1, 0, 5);
+	}
+};
+
+std::shared_ptr<const MapSnapshot> GetMapSnapshot();
+void UpdateMapSnapshot();
+void ResetMapSnapshot();
+
+#endif /* MAP_SNAPSHOT_H */
@@ -11,12 +11,22 @@
 #define MAP_TYPE_H
 
 /**
- * Data that is stored per tile. Also used TileExtended for this.
+ * Type and height of a tile. These are kept apart from the other data
+ * of the tiles, as many scans over the map only need these.
  * Look at docs/landscape.html for the exact meaning of the members.
  */
-struct Tile {
+struct TileTypeHeight {
 	byte   type;        ///< The type (bits 4..7), bridges (2..3), rainforest/desert (0..1)
 	byte   height;      ///< The height of the northern corner.
+};
+
+assert_compile(sizeof(TileTypeHeight) == 2);
+
+/**
+ * Data that is stored per tile. Also used TileTypeHeight and TileExtended for this.
+ * Look at docs/landscape.html for the exact meaning of the members.
+ */
+struct Tile {
 	uint16 m2;          ///< Primarily used for indices to towns, industries and stations
 	byte   m1;          ///< Primarily used for ownership information
 	byte   m3;          ///< General purpose
@@ -24,10 +34,10 @@ struct Tile {
 	byte   m5;          ///< General purpose
 };
 
-assert_compile(sizeof(Tile) == 8);
+assert_compile(sizeof(Tile) == 6);
 
 /**
- * Data that is stored per tile. Also used Tile for this.
+ * Data that is stored per tile. Also used TileTypeHeight and Tile for this.
  * Look at docs/landscape.html for the exact meaning of the members.
  */
 struct TileExtended {
@@ -61,9 +71,10 @@ struct TileIndexDiffC {
 
 /** Minimal and maximal map width and height */
 static const uint MIN_MAP_SIZE_BITS = 6;                      ///< Minimal size of map is equal to 2 ^ MIN_MAP_SIZE_BITS
-static const uint MAX_MAP_SIZE_BITS = 12;                     ///< Maximal size of map is equal to 2 ^ MAX_MAP_SIZE_BITS
+static const uint MAX_MAP_SIZE_BITS = 14;                     ///< Maximal size of map is equal to 2 ^ MAX_MAP_SIZE_BITS
+static const uint MAX_MAP_TILES_BITS = 26;                    ///< Maximal number of tiles in a map is equal to 2 ^ MAX_MAP_TILES_BITS
 static const uint MIN_MAP_SIZE      = 1 << MIN_MAP_SIZE_BITS; ///< Minimal map size = 64
-static const uint MAX_MAP_SIZE      = 1 << MAX_MAP_SIZE_BITS; ///< Maximal map size = 4096
+static const uint MAX_MAP_SIZE      = 1 << MAX_MAP_SIZE_BITS; ///< Maximal map size = 16384
 
 /**
  * Approximation of the length of a straight track, relative to a diagonal
@@ -30,6 +30,7 @@
 #include "town_kdtree.h"
 #include "viewport_kdtree.h"
 #include "newgrf_profiling.h"
+#include "state_hash.h"
 
 #include "safeguards.h"
 
@@ -67,6 +68,7 @@ void InitializeGame(uint size_x, uint size_y, bool reset_date, bool reset_settin
 	_fast_forward = 0;
 	_tick_counter = 0;
 	_cur_tileloop_tile = 1;
+	ResetStateHash();
 	_thd.redsq = INVALID_TILE;
 	if (reset_settings) MakeNewgameSettingsLive();
 
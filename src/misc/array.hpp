@@ -50,6 +50,16 @@ public:
 		data.Clear();
 	}
 
+	/** Destroy all items, but keep the memory of the first sub-array for reuse */
+	inline void Reset()
+	{
+		if (data.Length() == 1) {
+			data[0].Clear();
+		} else {
+			data.Clear();
+		}
+	}
+
 	/** Return actual number of items */
 	inline uint Length() const
 	{
@@ -61,7 +71,7 @@ public:
 	/** return true if array is empty */
 	inline bool IsEmpty()
 	{
-		return data.IsEmpty();
+		return Length() == 0;
 	}
 
 	/** return true if array is full */
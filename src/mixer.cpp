@@ -9,35 +9,41 @@
 
 #include "stdafx.h"
 #include <math.h>
+#include <vector>
 #include "core/math_func.hpp"
 #include "framerate_type.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define MIXER_SSE2
+#	include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#	define MIXER_NEON
+#	include <arm_neon.h>
+#endif
+
 #include "safeguards.h"
 #include "mixer.h"
 
 struct MixerChannel {
 	bool active;
 
-	/* pointer to allocated buffer memory */
-	int8 *memory;
+	/* the sound, already converted to the rate of the mixer */
+	std::vector<float> samples;
 
-	/* current position in memory */
+	/* current position in samples */
 	uint32 pos;
-	uint32 frac_pos;
-	uint32 frac_speed;
 	uint32 samples_left;
 
-	/* Mixing volume */
-	int volume_left;
-	int volume_right;
-
-	bool is16bit;
+	/* Mixing volume, as factor of the samples */
+	float volume_left;
+	float volume_right;
 };
 
 static MixerChannel _channels[8];
 static uint32 _play_rate = 11025;
 static uint32 _max_size = UINT_MAX;
 static MxStreamCallback _music_stream = nullptr;
+static std::vector<float> _mix_buffer; ///< Buffer the channels are mixed in, interleaved left and right.
 
 /**
  * The theoretical maximum volume for a single sound sample. Multiple sound
@@ -55,81 +61,115 @@ static const int MAX_VOLUME = 128 * 128;
  * @return the converted value.
  */
 template <typename T>
-static int RateConversion(T *b, int frac_pos)
+static int RateConversion(const T *b, int frac_pos)
 {
 	return ((b[0] * ((1 << 16) - frac_pos)) + (b[1] * frac_pos)) >> 16;
 }
 
-static void mix_int16(MixerChannel *sc, int16 *buffer, uint samples)
+/**
+ * Convert the sound of a channel to the rate of the mixer, so mixing it does not need to.
+ * @param mc The channel, with the number of samples at the rate of the mixer set.
+ * @param b The sound.
+ * @param frac_speed Step in the sound per sample of the mixer, in 1/65536th.
+ * @param scale Factor to bring the samples to 16 bits.
+ * @tparam T the size of the samples of the sound (8 or 16 bits)
+ */
+template <typename T>
+static void ResampleChannel(MixerChannel *mc, const T *b, uint32 frac_speed, float scale)
+{
+	mc->samples.resize(mc->samples_left);
+	float *out = mc->samples.data();
+
+	uint32 frac_pos = 0;
+	for (uint i = 0; i != mc->samples_left; i++) {
+		out[i] = RateConversion(b, frac_pos) * scale;
+		frac_pos += frac_speed;
+		b += frac_pos >> 16;
+		frac_pos &= 0xffff;
+	}
+}
+
+/**
+ * Add the next samples of a channel to the mix.
+ * @param mc The channel.
+ * @param buffer The mix, interleaved left and right.
+ * @param samples The number of samples to mix.
+ */
+static void MixChannel(MixerChannel *mc, float *buffer, uint samples)
 {
-	if (samples > sc->samples_left) samples = sc->samples_left;
-	sc->samples_left -= samples;
+	if (samples > mc->samples_left) samples = mc->samples_left;
+	mc->samples_left -= samples;
 	assert(samples > 0);
 
-	const int16 *b = (const int16 *)sc->memory + sc->pos;
-	uint32 frac_pos = sc->frac_pos;
-	uint32 frac_speed = sc->frac_speed;
-	int volume_left = sc->volume_left;
-	int volume_right = sc->volume_right;
-
-	if (frac_speed == 0x10000) {
-		/* Special case when frac_speed is 0x10000 */
-		do {
-			buffer[0] = Clamp(buffer[0] + (*b * volume_left  >> 16), -MAX_VOLUME, MAX_VOLUME);
-			buffer[1] = Clamp(buffer[1] + (*b * volume_right >> 16), -MAX_VOLUME, MAX_VOLUME);
-			b++;
-			buffer += 2;
-		} while (--samples > 0);
-	} else {
-		do {
-			int data = RateConversion(b, frac_pos);
-			buffer[0] = Clamp(buffer[0] + (data * volume_left  >> 16), -MAX_VOLUME, MAX_VOLUME);
-			buffer[1] = Clamp(buffer[1] + (data * volume_right >> 16), -MAX_VOLUME, MAX_VOLUME);
-			buffer += 2;
-			frac_pos += frac_speed;
-			b += frac_pos >> 16;
-			frac_pos &= 0xffff;
-		} while (--samples > 0);
+	const float *b = mc->samples.data() + mc->pos;
+	mc->pos += samples;
+	uint i = 0;
+
+#if defined(MIXER_SSE2)
+	const __m128 volume = _mm_setr_ps(mc->volume_left, mc->volume_right, mc->volume_left, mc->volume_right);
+	for (; i + 4 <= samples; i += 4) {
+		const __m128 data = _mm_loadu_ps(b + i);
+		float *out = buffer + i * 2;
+		_mm_storeu_ps(out,     _mm_add_ps(_mm_loadu_ps(out),     _mm_mul_ps(_mm_unpacklo_ps(data, data), volume)));
+		_mm_storeu_ps(out + 4, _mm_add_ps(_mm_loadu_ps(out + 4), _mm_mul_ps(_mm_unpackhi_ps(data, data), volume)));
+	}
+#elif defined(MIXER_NEON)
+	const float32x4_t volume = { mc->volume_left, mc->volume_right, mc->volume_left, mc->volume_right };
+	for (; i + 4 <= samples; i += 4) {
+		const float32x4_t data = vld1q_f32(b + i);
+		const float32x4x2_t stereo = vzipq_f32(data, data);
+		float *out = buffer + i * 2;
+		vst1q_f32(out,     vmlaq_f32(vld1q_f32(out),     stereo.val[0], volume));
+		vst1q_f32(out + 4, vmlaq_f32(vld1q_f32(out + 4), stereo.val[1], volume));
 	}
+#endif
 
-	sc->frac_pos = frac_pos;
-	sc->pos = b - (const int16 *)sc->memory;
+	for (; i != samples; i++) {
+		buffer[i * 2]     += b[i] * mc->volume_left;
+		buffer[i * 2 + 1] += b[i] * mc->volume_right;
+	}
 }
 
-static void mix_int8_to_int16(MixerChannel *sc, int16 *buffer, uint samples)
+/**
+ * Add the mixed channels to the music, limiting the result to the maximum volume.
+ * @param mix The mixed channels.
+ * @param buffer The music, and the result.
+ * @param count The number of values, i.e. twice the number of samples.
+ */
+static void ClampMix(const float *mix, int16 *buffer, uint count)
 {
-	if (samples > sc->samples_left) samples = sc->samples_left;
-	sc->samples_left -= samples;
-	assert(samples > 0);
-
-	const int8 *b = sc->memory + sc->pos;
-	uint32 frac_pos = sc->frac_pos;
-	uint32 frac_speed = sc->frac_speed;
-	int volume_left = sc->volume_left;
-	int volume_right = sc->volume_right;
-
-	if (frac_speed == 0x10000) {
-		/* Special case when frac_speed is 0x10000 */
-		do {
-			buffer[0] = Clamp(buffer[0] + (*b * volume_left  >> 8), -MAX_VOLUME, MAX_VOLUME);
-			buffer[1] = Clamp(buffer[1] + (*b * volume_right >> 8), -MAX_VOLUME, MAX_VOLUME);
-			b++;
-			buffer += 2;
-		} while (--samples > 0);
-	} else {
-		do {
-			int data = RateConversion(b, frac_pos);
-			buffer[0] = Clamp(buffer[0] + (data * volume_left  >> 8), -MAX_VOLUME, MAX_VOLUME);
-			buffer[1] = Clamp(buffer[1] + (data * volume_right >> 8), -MAX_VOLUME, MAX_VOLUME);
-			buffer += 2;
-			frac_pos += frac_speed;
-			b += frac_pos >> 16;
-			frac_pos &= 0xffff;
-		} while (--samples > 0);
+	uint i = 0;
+
+#if defined(MIXER_SSE2)
+	const __m128 max_volume = _mm_set1_ps(MAX_VOLUME);
+	const __m128 min_volume = _mm_set1_ps(-MAX_VOLUME);
+	for (; i + 8 <= count; i += 8) {
+		const __m128i music = _mm_loadu_si128((const __m128i *)(buffer + i));
+		/* Sign extend the music to 32 bits. */
+		const __m128i music_lo = _mm_srai_epi32(_mm_unpacklo_epi16(music, music), 16);
+		const __m128i music_hi = _mm_srai_epi32(_mm_unpackhi_epi16(music, music), 16);
+		__m128 lo = _mm_add_ps(_mm_cvtepi32_ps(music_lo), _mm_loadu_ps(mix + i));
+		__m128 hi = _mm_add_ps(_mm_cvtepi32_ps(music_hi), _mm_loadu_ps(mix + i + 4));
+		lo = _mm_min_ps(_mm_max_ps(lo, min_volume), max_volume);
+		hi = _mm_min_ps(_mm_max_ps(hi, min_volume), max_volume);
+		_mm_storeu_si128((__m128i *)(buffer + i), _mm_packs_epi32(_mm_cvttps_epi32(lo), _mm_cvttps_epi32(hi)));
+	}
+#elif defined(MIXER_NEON)
+	const float32x4_t max_volume = vdupq_n_f32(MAX_VOLUME);
+	const float32x4_t min_volume = vdupq_n_f32(-MAX_VOLUME);
+	for (; i + 8 <= count; i += 8) {
+		const int16x8_t music = vld1q_s16(buffer + i);
+		float32x4_t lo = vaddq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(music))), vld1q_f32(mix + i));
+		float32x4_t hi = vaddq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(music))), vld1q_f32(mix + i + 4));
+		lo = vminq_f32(vmaxq_f32(lo, min_volume), max_volume);
+		hi = vminq_f32(vmaxq_f32(hi, min_volume), max_volume);
+		vst1q_s16(buffer + i, vcombine_s16(vmovn_s32(vcvtq_s32_f32(lo)), vmovn_s32(vcvtq_s32_f32(hi))));
 	}
+#endif
 
-	sc->frac_pos = frac_pos;
-	sc->pos = b - sc->memory;
+	for (; i != count; i++) {
+		buffer[i] = Clamp((int)(buffer[i] + mix[i]), -MAX_VOLUME, MAX_VOLUME);
+	}
 }
 
 static void MxCloseChannel(MixerChannel *mc)
@@ -154,39 +194,44 @@ void MxMixSamples(void *buffer, uint samples)
 	/* Fetch music if a sampled stream is available */
 	if (_music_stream) _music_stream((int16*)buffer, samples);
 
-	/* Mix each channel */
+	/* Mix each channel; only the total is limited to the maximum volume */
+	bool mixed = false;
 	for (mc = _channels; mc != endof(_channels); mc++) {
 		if (mc->active) {
-			if (mc->is16bit) {
-				mix_int16(mc, (int16*)buffer, samples);
-			} else {
-				mix_int8_to_int16(mc, (int16*)buffer, samples);
+			if (!mixed) {
+				_mix_buffer.assign(2 * samples, 0.0f);
+				mixed = true;
 			}
+			MixChannel(mc, _mix_buffer.data(), samples);
 			if (mc->samples_left == 0) MxCloseChannel(mc);
 		}
 	}
+
+	if (mixed) ClampMix(_mix_buffer.data(), (int16*)buffer, 2 * samples);
 }
 
 MixerChannel *MxAllocateChannel()
 {
 	MixerChannel *mc;
 	for (mc = _channels; mc != endof(_channels); mc++) {
-		if (!mc->active) {
-			free(mc->memory);
-			mc->memory = nullptr;
-			return mc;
-		}
+		if (!mc->active) return mc;
 	}
 	return nullptr;
 }
 
+/**
+ * Set the sound of a channel.
+ * @param mc The channel.
+ * @param mem The sound, allocated with two extra bytes of zeroes at the end; the mixer frees it.
+ * @param size The size of the sound in bytes, without the extra bytes.
+ * @param rate The sample rate of the sound.
+ * @param is16bit Whether the samples are 16 bits, otherwise they are 8 bits.
+ */
 void MxSetChannelRawSrc(MixerChannel *mc, int8 *mem, size_t size, uint rate, bool is16bit)
 {
-	mc->memory = mem;
-	mc->frac_pos = 0;
 	mc->pos = 0;
 
-	mc->frac_speed = (rate << 16) / _play_rate;
+	uint32 frac_speed = (rate << 16) / _play_rate;
 
 	if (is16bit) size /= 2;
 
@@ -197,7 +242,13 @@ void MxSetChannelRawSrc(MixerChannel *mc, int8 *mem, size_t size, uint rate, boo
 	}
 
 	mc->samples_left = (uint)size * _play_rate / rate;
-	mc->is16bit = is16bit;
+
+	if (is16bit) {
+		ResampleChannel(mc, (const int16 *)mem, frac_speed, 1.0f);
+	} else {
+		ResampleChannel(mc, mem, frac_speed, 256.0f);
+	}
+	free(mem);
 }
 
 /**
@@ -210,8 +261,8 @@ void MxSetChannelVolume(MixerChannel *mc, uint volume, float pan)
 {
 	/* Use sinusoidal pan to maintain overall sound power level regardless
 	 * of position. */
-	mc->volume_left = (uint)(sin((1.0 - pan) * M_PI / 2.0) * volume);
-	mc->volume_right = (uint)(sin(pan * M_PI / 2.0) * volume);
+	mc->volume_left = (uint)(sin((1.0 - pan) * M_PI / 2.0) * volume) / 65536.0f;
+	mc->volume_right = (uint)(sin(pan * M_PI / 2.0) * volume) / 65536.0f;
 }
 
 
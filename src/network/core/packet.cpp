@@ -16,6 +16,52 @@
 
 #include "../../safeguards.h"
 
+static const uint MAX_CACHED_PACKETS = 64; ///< Maximum number of unused packets kept for reuse by a thread.
+
+/*
+ * Memory of packets that got deleted, kept so new packets do not need to allocate any.
+ * The packets are linked via a pointer at their start. Packets are made on several
+ * threads, e.g. when sending the map, so every thread has its own list. It is plain
+ * data, so packets can still be deleted while global objects are destroyed.
+ */
+static thread_local void *_cached_packets = nullptr; ///< First unused packet.
+static thread_local uint _cached_packet_count = 0;   ///< Number of unused packets.
+
+/**
+ * Get the memory for a new packet, reusing that of a deleted packet when possible.
+ * @param size The size of the packet.
+ * @return The memory for the packet.
+ */
+/* static */ void *Packet::operator new(size_t size)
+{
+	assert(size == sizeof(Packet));
+
+	void *p = _cached_packets;
+	if (p == nullptr) return MallocT<byte>(size);
+
+	memcpy(&_cached_packets, p, sizeof(void *));
+	_cached_packet_count--;
+	return p;
+}
+
+/**
+ * Release the memory of a deleted packet, keeping it for reuse by a next packet.
+ * @param p The memory of the packet.
+ */
+/* static */ void Packet::operator delete(void *p)
+{
+	if (p == nullptr) return;
+
+	if (_cached_packet_count == MAX_CACHED_PACKETS) {
+		free(p);
+		return;
+	}
+
+	memcpy(p, &_cached_packets, sizeof(void *));
+	_cached_packets = p;
+	_cached_packet_count++;
+}
+
 /**
  * Create a packet that is used to read from a network socket
  * @param cs the socket handler associated with the socket we are reading from
@@ -28,7 +74,6 @@ Packet::Packet(NetworkSocketHandler *cs)
 	this->next   = nullptr;
 	this->pos    = 0; // We start reading from here
 	this->size   = 0;
-	this->buffer = MallocT<byte>(SEND_MTU);
 }
 
 /**
@@ -43,18 +88,9 @@ Packet::Packet(PacketType type)
 	/* Skip the size so we can write that in before sending the packet */
 	this->pos                  = 0;
 	this->size                 = sizeof(PacketSize);
-	this->buffer               = MallocT<byte>(SEND_MTU);
 	this->buffer[this->size++] = type;
 }
 
-/**
- * Free the buffer of this packet.
- */
-Packet::~Packet()
-{
-	free(this->buffer);
-}
-
 /**
  * Writes the packet size from the raw packet from packet->size
  */
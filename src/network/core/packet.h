@@ -48,8 +48,8 @@ struct Packet {
 	PacketSize size;
 	/** The current read/write position in the packet */
 	PacketSize pos;
-	/** The buffer of this packet, of basically variable length up to SEND_MTU. */
-	byte *buffer;
+	/** The buffer of this packet; only the first #size bytes are used. */
+	byte buffer[SEND_MTU];
 
 private:
 	/** Socket we're associated with. */
@@ -58,7 +58,9 @@ private:
 public:
 	Packet(NetworkSocketHandler *cs);
 	Packet(PacketType type);
-	~Packet();
+
+	static void *operator new(size_t size);
+	static void operator delete(void *p);
 
 	/* Sending/writing of packets */
 	void PrepareToSend();
@@ -0,0 +1,285 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file poller.cpp Checking many sockets for being readable or writable at once.
+ */
+
+#include "../../stdafx.h"
+#include "../../debug.h"
+#include "../../thread.h"
+
+#include "poller.h"
+
+#if defined(UNIX) && !defined(__OS2__)
+#	include <poll.h>
+#endif
+
+#include "../../safeguards.h"
+
+/** The sockets of the game and admin servers. */
+SocketPoller _network_socket_poller;
+
+SocketPoller::SocketPoller()
+{
+#if defined(WITH_EPOLL)
+	this->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (this->epoll_fd < 0) DEBUG(net, 0, "epoll_create1 failed with error %d", GET_LAST_ERROR());
+#elif defined(WITH_KQUEUE)
+	this->kqueue_fd = kqueue();
+	if (this->kqueue_fd < 0) DEBUG(net, 0, "kqueue failed with error %d", GET_LAST_ERROR());
+#endif
+}
+
+SocketPoller::~SocketPoller()
+{
+#if defined(WITH_EPOLL)
+	if (this->epoll_fd >= 0) close(this->epoll_fd);
+#elif defined(WITH_KQUEUE)
+	if (this->kqueue_fd >= 0) close(this->kqueue_fd);
+#endif
+}
+
+/**
+ * Register a socket, so its readiness is determined by #Poll.
+ * @param s The socket to register.
+ * @param listener Whether the socket only accepts connections.
+ */
+void SocketPoller::Add(SOCKET s, bool listener)
+{
+	assert(s != INVALID_SOCKET);
+	assert(this->sockets.find(s) == this->sockets.end());
+
+#if defined(WITH_EPOLL)
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = listener ? EPOLLIN : (EPOLLIN | EPOLLOUT);
+	ev.data.fd = s;
+	if (epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, s, &ev) < 0) {
+		DEBUG(net, 0, "epoll_ctl failed with error %d", GET_LAST_ERROR());
+		return;
+	}
+	this->events.resize(this->sockets.size() + 1);
+#elif defined(WITH_KQUEUE)
+	struct kevent ev[2];
+	EV_SET(&ev[0], s, EVFILT_READ, EV_ADD, 0, 0, nullptr);
+	EV_SET(&ev[1], s, EVFILT_WRITE, EV_ADD, 0, 0, nullptr);
+	if (kevent(this->kqueue_fd, ev, listener ? 1 : 2, nullptr, 0, nullptr) < 0) {
+		DEBUG(net, 0, "kevent failed with error %d", GET_LAST_ERROR());
+		return;
+	}
+	this->events.resize((this->sockets.size() + 1) * 2);
+#elif !defined(_WIN32)
+	/* Elsewhere select can only handle sockets below FD_SETSIZE. */
+	if (s >= FD_SETSIZE) {
+		DEBUG(net, 0, "socket %d can not be polled with select", s);
+		return;
+	}
+#endif
+
+	this->sockets[s] = { listener, SR_NONE };
+}
+
+/**
+ * Unregister a socket; this must happen before the socket gets closed.
+ * Nothing happens when the socket has not been registered.
+ * @param s The socket to unregister.
+ */
+void SocketPoller::Remove(SOCKET s)
+{
+	auto it = this->sockets.find(s);
+	if (it == this->sockets.end()) return;
+
+#if defined(WITH_EPOLL)
+	epoll_ctl(this->epoll_fd, EPOLL_CTL_DEL, s, nullptr);
+#elif defined(WITH_KQUEUE)
+	struct kevent ev[2];
+	EV_SET(&ev[0], s, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+	EV_SET(&ev[1], s, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+	kevent(this->kqueue_fd, ev, it->second.listener ? 1 : 2, nullptr, 0, nullptr);
+#endif
+
+	this->sockets.erase(it);
+}
+
+/**
+ * Add to the readiness of a registered socket.
+ * @param s The socket that is ready.
+ * @param readiness What can be done with the socket.
+ */
+void SocketPoller::SetReadiness(SOCKET s, SocketReadiness readiness)
+{
+	auto it = this->sockets.find(s);
+	if (it == this->sockets.end()) return;
+
+	if (it->second.readiness == SR_NONE) this->ready.push_back(s);
+	it->second.readiness |= readiness;
+}
+
+/**
+ * Determine the readiness of all registered sockets, without blocking.
+ * @return False when determining the readiness failed.
+ */
+bool SocketPoller::Poll()
+{
+	for (SOCKET s : this->ready) {
+		auto it = this->sockets.find(s);
+		if (it != this->sockets.end()) it->second.readiness = SR_NONE;
+	}
+	this->ready.clear();
+
+	if (this->sockets.empty()) return true;
+
+#if defined(WITH_EPOLL)
+	int n = epoll_wait(this->epoll_fd, this->events.data(), (int)this->events.size(), 0);
+	if (n < 0) return false;
+
+	for (int i = 0; i < n; i++) {
+		const struct epoll_event &ev = this->events[i];
+		SocketReadiness readiness = SR_NONE;
+		/* Errors and hang-ups are found out about when trying to receive. */
+		if ((ev.events & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0) readiness |= SR_READ;
+		if ((ev.events & EPOLLOUT) != 0) readiness |= SR_WRITE;
+		this->SetReadiness(ev.data.fd, readiness);
+	}
+#elif defined(WITH_KQUEUE)
+	struct timespec ts = { 0, 0 }; // don't block at all.
+	int n = kevent(this->kqueue_fd, nullptr, 0, this->events.data(), (int)this->events.size(), &ts);
+	if (n < 0) return false;
+
+	for (int i = 0; i < n; i++) {
+		const struct kevent &ev = this->events[i];
+		if ((ev.flags & EV_ERROR) != 0) continue;
+		this->SetReadiness((SOCKET)ev.ident, ev.filter == EVFILT_WRITE ? SR_WRITE : SR_READ);
+	}
+#else
+	/* A single fd_set can only hold FD_SETSIZE sockets on Windows, so select them in batches. */
+	auto it = this->sockets.begin();
+	while (it != this->sockets.end()) {
+		fd_set read_fd, write_fd;
+		struct timeval tv;
+
+		FD_ZERO(&read_fd);
+		FD_ZERO(&write_fd);
+
+		auto first = it;
+		for (uint i = 0; i < FD_SETSIZE && it != this->sockets.end(); i++, ++it) {
+			FD_SET(it->first, &read_fd);
+			if (!it->second.listener) FD_SET(it->first, &write_fd);
+		}
+
+		tv.tv_sec = tv.tv_usec = 0; // don't block at all.
+		if (select(FD_SETSIZE, &read_fd, &write_fd, nullptr, &tv) < 0) return false;
+
+		for (; first != it; ++first) {
+			SocketReadiness readiness = SR_NONE;
+			if (FD_ISSET(first->first, &read_fd)) readiness |= SR_READ;
+			if (FD_ISSET(first->first, &write_fd)) readiness |= SR_WRITE;
+			if (readiness != SR_NONE) {
+				this->ready.push_back(first->first);
+				first->second.readiness = readiness;
+			}
+		}
+	}
+#endif
+
+	return true;
+}
+
+/**
+ * Block until something can be received on one of the registered sockets, or until the timeout passes.
+ * Only readability is waited for, as sockets can nearly always be written to.
+ * This does not change the readiness returned by #GetReadiness; call #Poll for that.
+ * @param timeout_ms The maximum time to wait, in milliseconds.
+ * @return True if a socket became readable before the timeout.
+ */
+bool SocketPoller::WaitForRead(uint timeout_ms)
+{
+#if defined(UNIX) && !defined(__OS2__)
+	/* For waiting, a single poll over all sockets is good enough everywhere; without sockets it just sleeps. */
+	std::vector<struct pollfd> pfds;
+	pfds.reserve(this->sockets.size());
+	for (const auto &it : this->sockets) {
+		struct pollfd pfd;
+		pfd.fd = it.first;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		pfds.push_back(pfd);
+	}
+
+	return poll(pfds.data(), (nfds_t)pfds.size(), (int)timeout_ms) > 0;
+#else
+	/* Select does not accept an empty set everywhere. */
+	if (this->sockets.empty()) {
+		CSleep(timeout_ms);
+		return false;
+	}
+
+	fd_set read_fd;
+	struct timeval tv;
+
+	FD_ZERO(&read_fd);
+	uint i = 0;
+	for (auto it = this->sockets.begin(); i < FD_SETSIZE && it != this->sockets.end(); i++, ++it) {
+		FD_SET(it->first, &read_fd);
+	}
+
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+	return select(FD_SETSIZE, &read_fd, nullptr, nullptr, &tv) > 0;
+#endif
+}
+
+/**
+ * Get the readiness of a registered socket as of the last #Poll.
+ * @param s The socket to get the readiness of.
+ * @return What can be done with the socket; nothing for sockets that are not registered.
+ */
+SocketReadiness SocketPoller::GetReadiness(SOCKET s) const
+{
+	auto it = this->sockets.find(s);
+	return it == this->sockets.end() ? SR_NONE : it->second.readiness;
+}
+
+/**
+ * Determine the readiness of a single socket, without blocking.
+ * @param s The socket to check.
+ * @return What can be done with the socket.
+ */
+/* static */ SocketReadiness SocketPoller::PollSocket(SOCKET s)
+{
+	SocketReadiness readiness = SR_NONE;
+
+#if defined(UNIX) && !defined(__OS2__)
+	/* Unlike select, poll is not limited to sockets below FD_SETSIZE. */
+	struct pollfd pfd;
+	pfd.fd = s;
+	pfd.events = POLLIN | POLLOUT;
+	pfd.revents = 0;
+	if (poll(&pfd, 1, 0) < 0) return SR_NONE;
+
+	if ((pfd.revents & (POLLIN | POLLERR | POLLHUP)) != 0) readiness |= SR_READ;
+	if ((pfd.revents & POLLOUT) != 0) readiness |= SR_WRITE;
+#else
+	fd_set read_fd, write_fd;
+	struct timeval tv;
+
+	FD_ZERO(&read_fd);
+	FD_ZERO(&write_fd);
+
+	FD_SET(s, &read_fd);
+	FD_SET(s, &write_fd);
+
+	tv.tv_sec = tv.tv_usec = 0; // don't block at all.
+	if (select(FD_SETSIZE, &read_fd, &write_fd, nullptr, &tv) < 0) return SR_NONE;
+
+	if (FD_ISSET(s, &read_fd)) readiness |= SR_READ;
+	if (FD_ISSET(s, &write_fd)) readiness |= SR_WRITE;
+#endif
+
+	return readiness;
+}
@@ -0,0 +1,76 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file poller.h Checking many sockets for being readable or writable at once.
+ */
+
+#ifndef NETWORK_CORE_POLLER_H
+#define NETWORK_CORE_POLLER_H
+
+#include "os_abstraction.h"
+#include "../../core/enum_type.hpp"
+#include <unordered_map>
+#include <vector>
+
+#if defined(__linux__)
+#	define WITH_EPOLL
+#	include <sys/epoll.h>
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
+#	define WITH_KQUEUE
+#	include <sys/event.h>
+#endif
+
+/** What can be done with a socket without blocking. */
+enum SocketReadiness {
+	SR_NONE  = 0,      ///< Nothing can be done.
+	SR_READ  = 1 << 0, ///< There is something to receive or to accept, or the connection got closed.
+	SR_WRITE = 1 << 1, ///< There is room to send more data.
+};
+DECLARE_ENUM_AS_BIT_SET(SocketReadiness)
+
+/**
+ * Set of sockets whose readiness is determined for all of them in a single call.
+ * Epoll is used on Linux and kqueue on BSD and macOS; elsewhere it falls back to select.
+ */
+class SocketPoller {
+private:
+	/** Information about a registered socket. */
+	struct Entry {
+		bool listener;             ///< Whether the socket only accepts connections, so only its readability is of interest.
+		SocketReadiness readiness; ///< Readiness of the socket as of the last #Poll.
+	};
+
+	std::unordered_map<SOCKET, Entry> sockets; ///< The registered sockets.
+	std::vector<SOCKET> ready;                 ///< The sockets that were ready during the last #Poll.
+
+#if defined(WITH_EPOLL)
+	int epoll_fd;                           ///< The epoll instance the sockets are registered with.
+	std::vector<struct epoll_event> events; ///< Buffer for the events returned by the epoll instance.
+#elif defined(WITH_KQUEUE)
+	int kqueue_fd;                          ///< The kqueue the sockets are registered with.
+	std::vector<struct kevent> events;      ///< Buffer for the events returned by the kqueue.
+#endif
+
+	void SetReadiness(SOCKET s, SocketReadiness readiness);
+
+public:
+	SocketPoller();
+	~SocketPoller();
+
+	void Add(SOCKET s, bool listener);
+	void Remove(SOCKET s);
+	bool Poll();
+	bool WaitForRead(uint timeout_ms);
+	SocketReadiness GetReadiness(SOCKET s) const;
+
+	static SocketReadiness PollSocket(SOCKET s);
+};
+
+extern SocketPoller _network_socket_poller;
+
+#endif /* NETWORK_CORE_POLLER_H */
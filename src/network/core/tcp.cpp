@@ -13,9 +13,16 @@
 #include "../../debug.h"
 
 #include "tcp.h"
+#include "poller.h"
+
+#if defined(UNIX) && !defined(__OS2__)
+#	include <sys/uio.h>
+#endif
 
 #include "../../safeguards.h"
 
+static const uint MAX_PACKETS_PER_SEND = 64; ///< Maximum number of queued packets handed to the OS in a single call.
+
 /**
  * Construct a socket handler for a TCP connection.
  * @param s The just opened TCP connection.
@@ -31,7 +38,10 @@ NetworkTCPSocketHandler::~NetworkTCPSocketHandler()
 {
 	this->CloseConnection();
 
-	if (this->sock != INVALID_SOCKET) closesocket(this->sock);
+	if (this->sock != INVALID_SOCKET) {
+		_network_socket_poller.Remove(this->sock);
+		closesocket(this->sock);
+	}
 	this->sock = INVALID_SOCKET;
 }
 
@@ -52,6 +62,19 @@ NetworkRecvStatus NetworkTCPSocketHandler::CloseConnection(bool error)
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
+/**
+ * Get the last packet in the send-queue.
+ * @return The packet, or nullptr when the queue is empty.
+ */
+Packet *NetworkTCPSocketHandler::GetLastQueuedPacket()
+{
+	Packet *p = this->packet_queue;
+	if (p == nullptr) return nullptr;
+
+	while (p->next != nullptr) p = p->next;
+	return p;
+}
+
 /**
  * This function puts the packet in the send-queue and it is send as
  * soon as possible. This is the next tick, or maybe one tick later
@@ -60,28 +83,57 @@ NetworkRecvStatus NetworkTCPSocketHandler::CloseConnection(bool error)
  */
 void NetworkTCPSocketHandler::SendPacket(Packet *packet)
 {
-	Packet *p;
 	assert(packet != nullptr);
 
 	packet->PrepareToSend();
 
-	/* Reallocate the packet as in 99+% of the times we send at most 25 bytes and
-	 * keeping the other 1400+ bytes wastes memory, especially when someone tries
-	 * to do a denial of service attack! */
-	packet->buffer = ReallocT(packet->buffer, packet->size);
-
-	/* Locate last packet buffered for the client */
-	p = this->packet_queue;
+	Packet *p = this->GetLastQueuedPacket();
 	if (p == nullptr) {
 		/* No packets yet */
 		this->packet_queue = packet;
+		return;
+	}
+
+	/* In 99+% of the times we send at most 25 bytes, so rather than keeping
+	 * a mostly empty buffer for every packet, which also wastes memory when
+	 * someone tries to do a denial of service attack, the packet is added to
+	 * the buffer of the last packet when it still fits. All that is done with
+	 * queued packets is sending their bytes, so that does not matter. */
+	if (p->size + packet->size <= SEND_MTU) {
+		memcpy(p->buffer + p->size, packet->buffer, packet->size);
+		p->size += packet->size;
+		delete packet;
 	} else {
-		/* Skip to the last packet */
-		while (p->next != nullptr) p = p->next;
 		p->next = packet;
 	}
 }
 
+/**
+ * Put the contents of a packet that is sent to several sockets in the
+ * send-queue. Unlike #SendPacket the packet stays with the caller, so it
+ * only has to be made and prepared once for all those sockets.
+ * @param packet The packet to send; #Packet::PrepareToSend must have been called for it.
+ */
+void NetworkTCPSocketHandler::SendSharedPacket(const Packet &packet)
+{
+	Packet *p = this->GetLastQueuedPacket();
+	if (p != nullptr && p->size + packet.size <= SEND_MTU) {
+		memcpy(p->buffer + p->size, packet.buffer, packet.size);
+		p->size += packet.size;
+		return;
+	}
+
+	Packet *copy = new Packet(packet);
+	copy->next = nullptr;
+	copy->pos = 0;
+
+	if (p == nullptr) {
+		this->packet_queue = copy;
+	} else {
+		p->next = copy;
+	}
+}
+
 /**
  * Sends all the buffered packets out for this client. It stops when:
  *   1) all packets are send (queue is empty)
@@ -103,7 +155,36 @@ SendPacketsState NetworkTCPSocketHandler::SendPackets(bool closing_down)
 
 	p = this->packet_queue;
 	while (p != nullptr) {
-		res = send(this->sock, (const char*)p->buffer + p->pos, p->size - p->pos, 0);
+		/* Hand as many of the queued packets as possible to the OS at once. */
+		uint count = 0;
+		size_t total = 0;
+#if defined(_WIN32)
+		WSABUF buffers[MAX_PACKETS_PER_SEND];
+		for (Packet *q = p; q != nullptr && count < MAX_PACKETS_PER_SEND; q = q->next, count++) {
+			buffers[count].buf = (char *)q->buffer + q->pos;
+			buffers[count].len = q->size - q->pos;
+			total += buffers[count].len;
+		}
+
+		DWORD sent;
+		res = WSASend(this->sock, buffers, count, &sent, 0, nullptr, nullptr) == SOCKET_ERROR ? -1 : (ssize_t)sent;
+#elif defined(UNIX) && !defined(__OS2__)
+		struct iovec buffers[MAX_PACKETS_PER_SEND];
+		for (Packet *q = p; q != nullptr && count < MAX_PACKETS_PER_SEND; q = q->next, count++) {
+			buffers[count].iov_base = q->buffer + q->pos;
+			buffers[count].iov_len = q->size - q->pos;
+			total += buffers[count].iov_len;
+		}
+
+		struct msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = buffers;
+		msg.msg_iovlen = count;
+		res = sendmsg(this->sock, &msg, 0);
+#else
+		total = p->size - p->pos;
+		res = send(this->sock, (const char*)p->buffer + p->pos, total, 0);
+#endif
 		if (res == -1) {
 			int err = GET_LAST_ERROR();
 			if (err != EWOULDBLOCK) {
@@ -122,17 +203,19 @@ SendPacketsState NetworkTCPSocketHandler::SendPackets(bool closing_down)
 			return SPS_CLOSED;
 		}
 
-		p->pos += res;
-
-		/* Is this packet sent? */
-		if (p->pos == p->size) {
-			/* Go to the next packet */
+		/* Remove the packets that are sent completely. */
+		size_t left = res;
+		while (left >= (size_t)(p->size - p->pos)) {
+			left -= p->size - p->pos;
 			this->packet_queue = p->next;
 			delete p;
 			p = this->packet_queue;
-		} else {
-			return SPS_PARTLY_SENT;
+			if (p == nullptr) break;
 		}
+		if (p != nullptr) p->pos += (PacketSize)left;
+
+		/* The OS could not take everything, so its buffer is full. */
+		if ((size_t)res < total) return SPS_PARTLY_SENT;
 	}
 
 	return SPS_ALL_SENT;
@@ -224,18 +307,8 @@ Packet *NetworkTCPSocketHandler::ReceivePacket()
  */
 bool NetworkTCPSocketHandler::CanSendReceive()
 {
-	fd_set read_fd, write_fd;
-	struct timeval tv;
-
-	FD_ZERO(&read_fd);
-	FD_ZERO(&write_fd);
-
-	FD_SET(this->sock, &read_fd);
-	FD_SET(this->sock, &write_fd);
-
-	tv.tv_sec = tv.tv_usec = 0; // don't block at all.
-	if (select(FD_SETSIZE, &read_fd, &write_fd, nullptr, &tv) < 0) return false;
+	SocketReadiness readiness = SocketPoller::PollSocket(this->sock);
 
-	this->writable = !!FD_ISSET(this->sock, &write_fd);
-	return FD_ISSET(this->sock, &read_fd) != 0;
+	this->writable = (readiness & SR_WRITE) != 0;
+	return (readiness & SR_READ) != 0;
 }
@@ -28,6 +28,8 @@ class NetworkTCPSocketHandler : public NetworkSocketHandler {
 private:
 	Packet *packet_queue;     ///< Packets that are awaiting delivery
 	Packet *packet_recv;      ///< Partially received packet
+
+	Packet *GetLastQueuedPacket();
 public:
 	SOCKET sock;              ///< The socket currently connected to
 	bool writable;            ///< Can we write to this socket?
@@ -40,6 +42,7 @@ public:
 
 	NetworkRecvStatus CloseConnection(bool error = true) override;
 	virtual void SendPacket(Packet *packet);
+	void SendSharedPacket(const Packet &packet);
 	SendPacketsState SendPackets(bool closing_down = false);
 
 	virtual Packet *ReceivePacket();
@@ -30,6 +30,7 @@ enum PacketAdminType {
 	ADMIN_PACKET_ADMIN_RCON,             ///< The admin sends a remote console command.
 	ADMIN_PACKET_ADMIN_GAMESCRIPT,       ///< The admin sends a JSON string for the GameScript.
 	ADMIN_PACKET_ADMIN_PING,             ///< The admin sends a ping to the server, expecting a ping-reply (PONG) packet.
+	ADMIN_PACKET_ADMIN_CMD_LOGGING_FILTER, ///< The admin tells the server which commands to log, and whether to batch them.
 
 	ADMIN_PACKET_SERVER_FULL = 100,      ///< The server tells the admin it cannot accept the admin.
 	ADMIN_PACKET_SERVER_BANNED,          ///< The server tells the admin it is banned.
@@ -59,6 +60,8 @@ enum PacketAdminType {
 	ADMIN_PACKET_SERVER_GAMESCRIPT,      ///< The server gives the admin information from the GameScript in JSON.
 	ADMIN_PACKET_SERVER_RCON_END,        ///< The server indicates that the remote console command has completed.
 	ADMIN_PACKET_SERVER_PONG,            ///< The server replies to a ping request from the admin.
+	ADMIN_PACKET_SERVER_PERFORMANCE,     ///< The server gives the admin metrics about its performance.
+	ADMIN_PACKET_SERVER_CMD_LOGGING_BATCH, ///< The server gives the admin copies of several incoming command packets at once.
 
 	INVALID_ADMIN_PACKET = 0xFF,         ///< An invalid marker for admin packets.
 };
@@ -82,6 +85,7 @@ enum AdminUpdateType {
 	ADMIN_UPDATE_CMD_NAMES,       ///< The admin would like a list of all DoCommand names.
 	ADMIN_UPDATE_CMD_LOGGING,     ///< The admin would like to have DoCommand information.
 	ADMIN_UPDATE_GAMESCRIPT,      ///< The admin would like to have gamescript messages.
+	ADMIN_UPDATE_PERFORMANCE,     ///< Updates about the performance of the server.
 	ADMIN_UPDATE_END,             ///< Must ALWAYS be on the end of this list!! (period)
 };
 
@@ -187,6 +191,19 @@ protected:
 	 */
 	virtual NetworkRecvStatus Receive_ADMIN_PING(Packet *p);
 
+	/**
+	 * Select the commands to receive with #ADMIN_UPDATE_CMD_LOGGING, and how to receive them:
+	 * bool    Whether to receive the commands in #ADMIN_PACKET_SERVER_CMD_LOGGING_BATCH packets.
+	 * These two fields are repeated until 'false' is read:
+	 * bool    Data to follow.
+	 * uint16  ID of a command to receive.
+	 * When no commands are given, all commands are received; this is also the
+	 * default. Command IDs are the ones given by #ADMIN_UPDATE_CMD_NAMES.
+	 * @param p The packet that was just received.
+	 * @return The state the network should have.
+	 */
+	virtual NetworkRecvStatus Receive_ADMIN_CMD_LOGGING_FILTER(Packet *p);
+
 	/**
 	 * The server is full (connection gets closed).
 	 * @param p The packet that was just received.
@@ -477,6 +494,47 @@ protected:
 	 */
 	virtual NetworkRecvStatus Receive_SERVER_RCON_END(Packet *p);
 
+	/**
+	 * Performance metrics of the server:
+	 * uint8   Number of performance elements that follow.
+	 * These three fields are repeated for each of them:
+	 * uint8   ID of the performance element (see #PerformanceElement).
+	 * uint32  Average duration of its recent measurements, in microseconds.
+	 * uint32  Duration 99% of its recent measurements did not exceed, in microseconds.
+	 * Followed by:
+	 * uint32  Number of vehicles, counting every part of them.
+	 * uint32  Number of stations and waypoints.
+	 * uint32  Number of cargo packets.
+	 * uint16  Number of link graph jobs running in the background.
+	 * uint16  Number of link graphs waiting for a job.
+	 * uint32  Time the game was halted by the last save, in microseconds.
+	 * uint32  Time spent compressing and writing the last save, in microseconds.
+	 *
+	 * NOTICE: The performance elements are not stable and will not be
+	 *         treated as such. Do not rely on their IDs to be constant
+	 *         across different versions / revisions of OpenTTD.
+	 * @param p The packet that was just received.
+	 * @return The state the network should have.
+	 */
+	virtual NetworkRecvStatus Receive_SERVER_PERFORMANCE(Packet *p);
+
+	/**
+	 * Commands executed in the last frames, for an admin that asked for them in batches.
+	 * These fields are repeated until 'false' is read:
+	 * bool    Data to follow.
+	 * uint32  ID of the client sending the command.
+	 * uint8   ID of the company (0..MAX_COMPANIES-1).
+	 * uint16  ID of the command.
+	 * uint32  P1 (variable data passed to the command).
+	 * uint32  P2 (variable data passed to the command).
+	 * uint32  Tile where this is taking place.
+	 * string  Text passed to the command.
+	 * uint32  Frame of execution.
+	 * @param p The packet that was just received.
+	 * @return The state the network should have.
+	 */
+	virtual NetworkRecvStatus Receive_SERVER_CMD_LOGGING_BATCH(Packet *p);
+
 	NetworkRecvStatus HandlePacket(Packet *p);
 public:
 	NetworkRecvStatus CloseConnection(bool error = true) override;
@@ -90,6 +90,7 @@ enum PacketGameType {
 	/* Sending commands around. */
 	PACKET_CLIENT_COMMAND,               ///< Client executed a command and sends it to the server.
 	PACKET_SERVER_COMMAND,               ///< Server distributes a command to (all) the clients.
+	PACKET_SERVER_COMMANDS,              ///< Server distributes a batch of commands of one frame to (all) the clients.
 
 	/* Human communication! */
 	PACKET_CLIENT_CHAT,                  ///< Client said something that should be distributed.
@@ -373,6 +374,24 @@ protected:
 	 */
 	virtual NetworkRecvStatus Receive_SERVER_COMMAND(Packet *p);
 
+	/**
+	 * Sends a batch of DoCommands that are executed in the same frame to the client:
+	 * uint32  Frame of execution.
+	 * uint8   Number of commands in the batch.
+	 * For each command:
+	 * uint8   Flags telling which of the following fields are there (see CommandBatchFlags).
+	 * varuint ID of the client the command originates from, when it differs from the previous command.
+	 * uint8   ID of the company (0..MAX_COMPANIES-1), when it differs from the previous command.
+	 * varuint ID of the command (see command.h), when it differs from the previous command.
+	 * varint  Difference of the tile where this is taking place with that of the previous command.
+	 * varint  Difference of P1 (free variable used in DoCommand) with that of the previous command.
+	 * varint  Difference of P2 with that of the previous command.
+	 * string  Text, when it is not empty.
+	 * uint8   ID of the callback, when the command has one.
+	 * @param p The packet that was just received.
+	 */
+	virtual NetworkRecvStatus Receive_SERVER_COMMANDS(Packet *p);
+
 	/**
 	 * Sends a chat-packet to the server:
 	 * uint8   ID of the action (see NetworkAction).
@@ -552,6 +571,7 @@ public:
 
 	const char *ReceiveCommand(Packet *p, CommandPacket *cp);
 	void SendCommand(Packet *p, const CommandPacket *cp);
+	const char *ReceiveCommandBatch(Packet *p, CommandQueue *queue);
 };
 
 #endif /* NETWORK_CORE_TCP_GAME_H */
@@ -13,6 +13,7 @@
 #define NETWORK_CORE_TCP_LISTEN_H
 
 #include "tcp.h"
+#include "poller.h"
 #include "../network.h"
 #include "../../core/pool_type.hpp"
 #include "../../debug.h"
@@ -85,45 +86,28 @@ public:
 				continue;
 			}
 
+			_network_socket_poller.Add(s, false);
 			Tsocket::AcceptConnection(s, address);
 		}
 	}
 
 	/**
 	 * Handle the receiving of packets.
+	 * @pre The readiness of the sockets has been determined by #_network_socket_poller.
 	 * @return true if everything went okay.
 	 */
 	static bool Receive()
 	{
-		fd_set read_fd, write_fd;
-		struct timeval tv;
-
-		FD_ZERO(&read_fd);
-		FD_ZERO(&write_fd);
-
-
-		for (Tsocket *cs : Tsocket::Iterate()) {
-			FD_SET(cs->sock, &read_fd);
-			FD_SET(cs->sock, &write_fd);
-		}
-
-		/* take care of listener port */
-		for (auto &s : sockets) {
-			FD_SET(s.second, &read_fd);
-		}
-
-		tv.tv_sec = tv.tv_usec = 0; // don't block at all.
-		if (select(FD_SETSIZE, &read_fd, &write_fd, nullptr, &tv) < 0) return false;
-
 		/* accept clients.. */
 		for (auto &s : sockets) {
-			if (FD_ISSET(s.second, &read_fd)) AcceptClient(s.second);
+			if ((_network_socket_poller.GetReadiness(s.second) & SR_READ) != 0) AcceptClient(s.second);
 		}
 
 		/* read stuff from clients */
 		for (Tsocket *cs : Tsocket::Iterate()) {
-			cs->writable = !!FD_ISSET(cs->sock, &write_fd);
-			if (FD_ISSET(cs->sock, &read_fd)) {
+			SocketReadiness readiness = _network_socket_poller.GetReadiness(cs->sock);
+			cs->writable = (readiness & SR_WRITE) != 0;
+			if ((readiness & SR_READ) != 0) {
 				cs->ReceivePackets();
 			}
 		}
@@ -146,6 +130,10 @@ public:
 			address.Listen(SOCK_STREAM, &sockets);
 		}
 
+		for (auto &s : sockets) {
+			_network_socket_poller.Add(s.second, true);
+		}
+
 		if (sockets.size() == 0) {
 			DEBUG(net, 0, "[server] could not start network: could not create listening socket");
 			NetworkError(STR_NETWORK_ERROR_SERVER_START);
@@ -159,6 +147,7 @@ public:
 	static void CloseListeners()
 	{
 		for (auto &s : sockets) {
+			_network_socket_poller.Remove(s.second);
 			closesocket(s.second);
 		}
 		sockets.clear();
@@ -21,6 +21,7 @@
 #include "network_base.h"
 #include "core/udp.h"
 #include "core/host.h"
+#include "core/poller.h"
 #include "network_gui.h"
 #include "../console_func.h"
 #include "../3rdparty/md5/md5.h"
@@ -38,6 +39,7 @@
 
 #ifdef DEBUG_DUMP_COMMANDS
 #include "../fileio_func.h"
+#include <chrono>
 /** When running the server till the wait point, run as fast as we can! */
 bool _ddc_fastforward = true;
 #endif /* DEBUG_DUMP_COMMANDS */
@@ -73,7 +75,9 @@ uint32 _sync_seed_1;                  ///< Seed to compare during sync checks.
 uint32 _sync_seed_2;                  ///< Second part of the seed.
 #endif
 uint32 _sync_frame;                   ///< The frame to perform the sync check.
+StateHash _sync_state_hash;           ///< Hashes of the game state to compare during sync checks.
 bool _network_first_time;             ///< Whether we have finished joining or not.
+bool _network_catching_up;            ///< Whether the client is running the frames it missed while joining, without drawing in between.
 bool _network_udp_server;             ///< Is the UDP server started?
 uint16 _network_udp_broadcast;        ///< Timeout for the UDP broadcasts.
 uint8 _network_advertise_retries;     ///< The number of advertisement retries we did.
@@ -438,6 +442,28 @@ static bool NetworkHasJoiningClient()
 	return false;
 }
 
+/**
+ * Get the number of frames the server waits before sending the next frame.
+ * With adaptive_frame_freq the configured frame_freq is only used while the
+ * command queues are backlogged; otherwise frames are sent as often as the
+ * slowest active client acknowledges them, for the lowest command latency.
+ * @param backlogged The number of command queues that could not be emptied.
+ * @return The frame frequency to use for the next batch.
+ */
+static uint GetNetworkFrameFreq(uint backlogged)
+{
+	uint max_freq = _settings_client.network.frame_freq;
+	if (!_settings_client.network.adaptive_frame_freq || max_freq == 0 || backlogged != 0) return max_freq;
+
+	uint max_lag = 0;
+	for (const NetworkClientSocket *cs : NetworkClientSocket::Iterate()) {
+		if (cs->status != NetworkClientSocket::STATUS_ACTIVE) continue;
+		max_lag = std::max(max_lag, NetworkCalculateLag(cs));
+	}
+
+	return std::min(max_freq, max_lag);
+}
+
 /**
  * Check whether we should pause on join
  */
@@ -554,6 +580,7 @@ static void NetworkInitialize(bool close_admins = true)
 
 	_sync_frame = 0;
 	_network_first_time = true;
+	_network_catching_up = false;
 
 	_network_reconnect = 0;
 }
@@ -811,6 +838,9 @@ void NetworkDisconnect(bool blocking, bool close_admins)
 static bool NetworkReceive()
 {
 	if (_network_server) {
+		/* Find out which of the game and admin sockets are ready in one go. */
+		if (!_network_socket_poller.Poll()) return false;
+
 		ServerNetworkAdminSocketHandler::Receive();
 		return ServerNetworkGameSocketHandler::Receive();
 	} else {
@@ -829,6 +859,53 @@ static void NetworkSend()
 	}
 }
 
+/**
+ * Run the frames a joining client is behind on the server back-to-back, until it is
+ * at the frame of the server. As the server keeps on running, new frames are received
+ * in the meantime. Windows are not drawn and sounds are not played in between; only
+ * after a while the loop returns to show the progress and to handle the input.
+ * @return False when things went bad and the connection got closed.
+ */
+static bool NetworkCatchUp()
+{
+	static const uint CATCH_UP_SLICE_MS = 100; ///< Time to run frames for before returning to the main loop.
+
+	auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(CATCH_UP_SLICE_MS);
+	for (;;) {
+		if (_frame_counter_server == _frame_counter) {
+			/* See whether the server sent more frames while we were running these. */
+			if (!NetworkReceive()) return false;
+			if (_frame_counter_server == _frame_counter) break;
+		}
+
+		if (!ClientNetworkGameSocketHandler::GameLoop()) return false;
+
+		if (std::chrono::steady_clock::now() >= end) {
+			SetWindowDirty(WC_NETWORK_STATUS_WINDOW, WN_NETWORK_STATUS_WINDOW_JOIN);
+			return true;
+		}
+	}
+
+	DEBUG(net, 3, "Caught up with the server at frame %u", _frame_counter);
+	_network_catching_up = false;
+	if (_network_join_status == NETWORK_JOIN_STATUS_PROCESSING) DeleteWindowById(WC_NETWORK_STATUS_WINDOW, WN_NETWORK_STATUS_WINDOW_JOIN);
+	return true;
+}
+
+/**
+ * Wait until a client or admin sends something, or until the timeout passes.
+ * What was received is handled right away instead of at the next tick, and
+ * the answers to it are sent.
+ * @param timeout_ms The maximum time to wait, in milliseconds.
+ */
+void NetworkServerWaitForPackets(uint timeout_ms)
+{
+	if (!_network_socket_poller.WaitForRead(timeout_ms)) return;
+	if (!_networking || !_network_server) return;
+
+	if (NetworkReceive()) NetworkSend();
+}
+
 /**
  * We have to do some (simple) background stuff that runs normally,
  * even when we are not in multiplayer. For example stuff needed
@@ -958,13 +1035,14 @@ void NetworkGameLoop()
 			f = nullptr;
 		}
 #endif /* DEBUG_DUMP_COMMANDS */
+		static uint frame_freq = 0;
 		if (_frame_counter >= _frame_counter_max) {
 			/* Only check for active clients just before we're going to send out
 			 * the commands so we don't send multiple pause/unpause commands when
 			 * the frame_freq is more than 1 tick. Same with distributing commands. */
 			CheckPauseOnJoin();
 			CheckMinActiveClients();
-			NetworkDistributeCommands();
+			frame_freq = GetNetworkFrameFreq(NetworkDistributeCommands());
 		}
 
 		bool send_frame = false;
@@ -973,7 +1051,7 @@ void NetworkGameLoop()
 		_frame_counter++;
 		/* Update max-frame-counter */
 		if (_frame_counter > _frame_counter_max) {
-			_frame_counter_max = _frame_counter + _settings_client.network.frame_freq;
+			_frame_counter_max = _frame_counter + frame_freq;
 			send_frame = true;
 		}
 
@@ -991,8 +1069,11 @@ void NetworkGameLoop()
 	} else {
 		/* Client */
 
-		/* Make sure we are at the frame were the server is (quick-frames) */
-		if (_frame_counter_server > _frame_counter) {
+		if (_network_catching_up) {
+			/* Run the frames we missed while joining as fast as possible. */
+			if (!NetworkCatchUp()) return;
+		} else if (_frame_counter_server > _frame_counter) {
+			/* Make sure we are at the frame were the server is (quick-frames) */
 			/* Run a number of frames; when things go bad, get out. */
 			while (_frame_counter_server > _frame_counter) {
 				if (!ClientNetworkGameSocketHandler::GameLoop()) return;
@@ -20,5 +20,6 @@ extern bool _network_server;     ///< network-server is active
 extern bool _network_available;  ///< is network mode available?
 extern bool _network_dedicated;  ///< are we a dedicated server?
 extern bool _is_network_server;  ///< Does this client wants to be a network-server?
+extern bool _network_catching_up; ///< Is this client running the frames it missed while joining?
 
 #endif /* NETWORK_H */
@@ -20,6 +20,13 @@
 #include "../map_func.h"
 #include "../rev.h"
 #include "../game/game.hpp"
+#include "../framerate_type.h"
+#include "../vehicle_base.h"
+#include "../base_station_base.h"
+#include "../cargopacket.h"
+#include "../linkgraph/linkgraphschedule.h"
+#include "../saveload/saveload.h"
+#include <vector>
 
 #include "../safeguards.h"
 
@@ -52,6 +59,7 @@ static const AdminUpdateFrequency _admin_update_type_frequencies[] = {
 	ADMIN_FREQUENCY_POLL,                                                                                                                                  ///< ADMIN_UPDATE_CMD_NAMES
 	                       ADMIN_FREQUENCY_AUTOMATIC,                                                                                                      ///< ADMIN_UPDATE_CMD_LOGGING
 	                       ADMIN_FREQUENCY_AUTOMATIC,                                                                                                      ///< ADMIN_UPDATE_GAMESCRIPT
+	ADMIN_FREQUENCY_POLL | ADMIN_FREQUENCY_DAILY | ADMIN_FREQUENCY_WEEKLY | ADMIN_FREQUENCY_MONTHLY | ADMIN_FREQUENCY_QUARTERLY | ADMIN_FREQUENCY_ANUALLY, ///< ADMIN_UPDATE_PERFORMANCE
 };
 /** Sanity check. */
 assert_compile(lengthof(_admin_update_type_frequencies) == ADMIN_UPDATE_END);
@@ -73,6 +81,7 @@ ServerNetworkAdminSocketHandler::ServerNetworkAdminSocketHandler(SOCKET s) : Net
 ServerNetworkAdminSocketHandler::~ServerNetworkAdminSocketHandler()
 {
 	_network_admins_connected--;
+	delete this->cmd_logging_batch;
 	DEBUG(net, 1, "[admin] '%s' (%s) has disconnected", this->admin_name, this->admin_version);
 	if (_redirect_console_to_admin == this->index) _redirect_console_to_admin = INVALID_ADMIN_ID;
 }
@@ -101,6 +110,7 @@ ServerNetworkAdminSocketHandler::~ServerNetworkAdminSocketHandler()
 			continue;
 		}
 		if (as->writable) {
+			as->SendCmdLoggingBatch();
 			as->SendPackets();
 		}
 	}
@@ -457,6 +467,45 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCompanyStats()
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
+/** Send metrics about the performance of the server. */
+NetworkRecvStatus ServerNetworkAdminSocketHandler::SendPerformance()
+{
+	struct ElementDurations {
+		PerformanceElement elem;
+		uint64 average;
+		uint64 p99;
+	};
+	std::vector<ElementDurations> elements;
+	for (PerformanceElement e = PFE_FIRST; e < PFE_MAX; e++) {
+		ElementDurations d = { e, 0, 0 };
+		if (GetPerformanceDurations(e, &d.average, &d.p99)) elements.push_back(d);
+	}
+
+	Packet *p = new Packet(ADMIN_PACKET_SERVER_PERFORMANCE);
+
+	p->Send_uint8((uint8)elements.size());
+	for (const ElementDurations &d : elements) {
+		p->Send_uint8(d.elem);
+		p->Send_uint32((uint32)min<uint64>(d.average, UINT32_MAX));
+		p->Send_uint32((uint32)min<uint64>(d.p99, UINT32_MAX));
+	}
+
+	p->Send_uint32((uint32)Vehicle::GetNumItems());
+	p->Send_uint32((uint32)BaseStation::GetNumItems());
+	p->Send_uint32((uint32)CargoPacket::GetNumItems());
+	p->Send_uint16(LinkGraphSchedule::instance.GetRunningJobCount());
+	p->Send_uint16(LinkGraphSchedule::instance.GetQueuedGraphCount());
+
+	uint64 save_blocking, save_writing;
+	GetLastSaveDurations(&save_blocking, &save_writing);
+	p->Send_uint32((uint32)min<uint64>(save_blocking, UINT32_MAX));
+	p->Send_uint32((uint32)min<uint64>(save_writing, UINT32_MAX));
+
+	this->SendPacket(p);
+
+	return NETWORK_RECV_STATUS_OKAY;
+}
+
 /**
  * Send a chat message.
  * @param action The action associated with the message.
@@ -539,6 +588,32 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::Receive_ADMIN_GAMESCRIPT(Pack
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
+NetworkRecvStatus ServerNetworkAdminSocketHandler::Receive_ADMIN_CMD_LOGGING_FILTER(Packet *p)
+{
+	if (this->status == ADMIN_STATUS_INACTIVE) return this->SendError(NETWORK_ERROR_NOT_EXPECTED);
+
+	bool batched = p->Recv_bool();
+	std::vector<bool> filter;
+	while (p->Recv_bool()) {
+		uint16 cmd = p->Recv_uint16();
+		if (cmd >= CMD_END) {
+			DEBUG(net, 3, "[admin] Unknown command %d in the command logging filter from '%s' (%s).", cmd, this->admin_name, this->admin_version);
+			return this->SendError(NETWORK_ERROR_ILLEGAL_PACKET);
+		}
+		if (filter.empty()) filter.resize(CMD_END, false);
+		filter[cmd] = true;
+	}
+
+	/* Commands logged so far keep the form the admin asked for when they were logged. */
+	if (!batched) this->SendCmdLoggingBatch();
+
+	this->cmd_logging_batched = batched;
+	this->cmd_logging_filter = std::move(filter);
+
+	DEBUG(net, 3, "[admin] Command logging filter from '%s' (%s): %s, %s", this->admin_name, this->admin_version, batched ? "batched" : "not batched", this->cmd_logging_filter.empty() ? "all commands" : "selected commands");
+	return NETWORK_RECV_STATUS_OKAY;
+}
+
 NetworkRecvStatus ServerNetworkAdminSocketHandler::Receive_ADMIN_PING(Packet *p)
 {
 	if (this->status == ADMIN_STATUS_INACTIVE) return this->SendError(NETWORK_ERROR_NOT_EXPECTED);
@@ -633,13 +708,27 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCmdNames()
 }
 
 /**
- * Send a command for logging purposes.
+ * Send a command for logging purposes, if the admin wants to know about it.
+ * In batched mode the command is only added to the next batch.
  * @param client_id The client executing the command.
  * @param cp The command that would be executed.
  */
 NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCmdLogging(ClientID client_id, const CommandPacket *cp)
 {
-	Packet *p = new Packet(ADMIN_PACKET_SERVER_CMD_LOGGING);
+	uint cmd = cp->cmd & CMD_ID_MASK;
+	if (!this->cmd_logging_filter.empty() && !this->cmd_logging_filter[cmd]) return NETWORK_RECV_STATUS_OKAY;
+
+	Packet *p;
+	if (this->cmd_logging_batched) {
+		/* Should SEND_MTU be exceeded, send the batch so far (magic 26: 24 bytes
+		 * of fixed size fields, the string '\0' termination and the "no more data" bool). */
+		if (this->cmd_logging_batch != nullptr && this->cmd_logging_batch->size + strlen(cp->text) + 26 >= SEND_MTU) this->SendCmdLoggingBatch();
+		if (this->cmd_logging_batch == nullptr) this->cmd_logging_batch = new Packet(ADMIN_PACKET_SERVER_CMD_LOGGING_BATCH);
+		p = this->cmd_logging_batch;
+		p->Send_bool(true);
+	} else {
+		p = new Packet(ADMIN_PACKET_SERVER_CMD_LOGGING);
+	}
 
 	p->Send_uint32(client_id);
 	p->Send_uint8 (cp->company);
@@ -650,11 +739,22 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCmdLogging(ClientID clien
 	p->Send_string(cp->text);
 	p->Send_uint32(cp->frame);
 
-	this->SendPacket(p);
+	if (!this->cmd_logging_batched) this->SendPacket(p);
 
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
+/** Send the batch of logged commands, if there is one. */
+void ServerNetworkAdminSocketHandler::SendCmdLoggingBatch()
+{
+	if (this->cmd_logging_batch == nullptr) return;
+
+	/* Marker to notify the end of the packet has been reached. */
+	this->cmd_logging_batch->Send_bool(false);
+	this->SendPacket(this->cmd_logging_batch);
+	this->cmd_logging_batch = nullptr;
+}
+
 /***********
  * Receiving functions
  ************/
@@ -768,6 +868,11 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::Receive_ADMIN_POLL(Packet *p)
 			this->SendCmdNames();
 			break;
 
+		case ADMIN_UPDATE_PERFORMANCE:
+			/* The admin is requesting performance metrics. */
+			this->SendPerformance();
+			break;
+
 		default:
 			/* An unsupported "poll" update type. */
 			DEBUG(net, 3, "[admin] Not supported poll %d (%d) from '%s' (%s).", type, d1, this->admin_name, this->admin_version);
@@ -1016,6 +1121,10 @@ void NetworkAdminUpdate(AdminUpdateFrequency freq)
 						as->SendCompanyStats();
 						break;
 
+					case ADMIN_UPDATE_PERFORMANCE:
+						as->SendPerformance();
+						break;
+
 					default: NOT_REACHED();
 				}
 			}
@@ -32,6 +32,7 @@ protected:
 	NetworkRecvStatus Receive_ADMIN_RCON(Packet *p) override;
 	NetworkRecvStatus Receive_ADMIN_GAMESCRIPT(Packet *p) override;
 	NetworkRecvStatus Receive_ADMIN_PING(Packet *p) override;
+	NetworkRecvStatus Receive_ADMIN_CMD_LOGGING_FILTER(Packet *p) override;
 
 	NetworkRecvStatus SendProtocol();
 	NetworkRecvStatus SendPong(uint32 d1);
@@ -39,6 +40,9 @@ public:
 	AdminUpdateFrequency update_frequency[ADMIN_UPDATE_END]; ///< Admin requested update intervals.
 	uint32 realtime_connect;                                 ///< Time of connection.
 	NetworkAddress address;                                  ///< Address of the admin.
+	std::vector<bool> cmd_logging_filter;                    ///< For each command, whether to log it; empty to log all commands.
+	bool cmd_logging_batched = false;                        ///< Whether to send the logged commands in batches.
+	Packet *cmd_logging_batch = nullptr;                     ///< Batch of logged commands not sent yet.
 
 	ServerNetworkAdminSocketHandler(SOCKET s);
 	~ServerNetworkAdminSocketHandler();
@@ -67,7 +71,9 @@ public:
 	NetworkRecvStatus SendGameScript(const char *json);
 	NetworkRecvStatus SendCmdNames();
 	NetworkRecvStatus SendCmdLogging(ClientID client_id, const CommandPacket *cp);
+	void SendCmdLoggingBatch();
 	NetworkRecvStatus SendRconEnd(const char *command);
+	NetworkRecvStatus SendPerformance();
 
 	static void Send();
 	static void AcceptConnection(SOCKET s, const NetworkAddress &address);
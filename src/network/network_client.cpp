@@ -28,6 +28,8 @@
 #include "network_client.h"
 #include "../core/backup_type.hpp"
 #include "../thread.h"
+#include <condition_variable>
+#include <mutex>
 
 #include "table/strings.h"
 
@@ -41,72 +43,94 @@ struct PacketReader : LoadFilter {
 	static const size_t CHUNK = 32 * 1024;  ///< 32 KiB chunks of memory.
 
 	std::vector<byte *> blocks;             ///< Buffer with blocks of allocated memory.
-	byte *buf;                              ///< Buffer we're going to write to/read from.
-	byte *bufe;                             ///< End of the buffer we write to/read from.
-	byte **block;                           ///< The block we're reading from/writing to.
 	size_t written_bytes;                   ///< The total number of bytes we've written.
 	size_t read_bytes;                      ///< The total number of read bytes.
+	bool finished;                          ///< Whether all data has been written.
+
+	std::mutex lock;                        ///< Lock for reading on another thread while the data is still being written.
+	std::condition_variable written;        ///< Signal of data having been written, or all of it.
+
+	PacketReader *decompressed;             ///< The savegame decompressed while it is downloaded, or nullptr.
+	bool decompress_success;                ///< Whether #decompressed contains the complete savegame.
+	std::thread decompress_thread;          ///< Thread decompressing the savegame while it is downloaded.
 
 	/** Initialise everything. */
-	PacketReader() : LoadFilter(nullptr), buf(nullptr), bufe(nullptr), block(nullptr), written_bytes(0), read_bytes(0)
+	PacketReader() : LoadFilter(nullptr), written_bytes(0), read_bytes(0), finished(false), decompressed(nullptr), decompress_success(false)
 	{
 	}
 
 	~PacketReader() override
 	{
+		this->Finish();
+		delete this->decompressed;
+
 		for (auto p : this->blocks) {
 			free(p);
 		}
 	}
 
+	/**
+	 * Add data to this buffer.
+	 * @param data The data to add.
+	 * @param len The number of bytes to add.
+	 */
+	void Write(const byte *data, size_t len)
+	{
+		{
+			std::lock_guard<std::mutex> guard(this->lock);
+			while (len != 0) {
+				size_t offset = this->written_bytes % CHUNK;
+				if (offset == 0 && this->written_bytes / CHUNK == this->blocks.size()) this->blocks.push_back(CallocT<byte>(CHUNK));
+
+				size_t to_write = min(CHUNK - offset, len);
+				memcpy(this->blocks[this->written_bytes / CHUNK] + offset, data, to_write);
+				this->written_bytes += to_write;
+				data += to_write;
+				len -= to_write;
+			}
+		}
+		this->written.notify_all();
+	}
+
 	/**
 	 * Add a packet to this buffer.
 	 * @param p The packet to add.
 	 */
 	void AddPacket(const Packet *p)
 	{
-		assert(this->read_bytes == 0);
-
-		size_t in_packet = p->size - p->pos;
-		size_t to_write  = min((size_t)(this->bufe - this->buf), in_packet);
-		const byte *pbuf = p->buffer + p->pos;
+		this->Write(p->buffer + p->pos, p->size - p->pos);
+	}
 
-		this->written_bytes += in_packet;
-		if (to_write != 0) {
-			memcpy(this->buf, pbuf, to_write);
-			this->buf += to_write;
+	/** Mark that all data has been written, and wait for the decompression of it to finish. */
+	void Finish()
+	{
+		{
+			std::lock_guard<std::mutex> guard(this->lock);
+			this->finished = true;
 		}
+		this->written.notify_all();
 
-		/* Did everything fit in the current chunk, then we're done. */
-		if (to_write == in_packet) return;
-
-		/* Allocate a new chunk and add the remaining data. */
-		pbuf += to_write;
-		to_write   = in_packet - to_write;
-		this->blocks.push_back(this->buf = CallocT<byte>(CHUNK));
-		this->bufe = this->buf + CHUNK;
-
-		memcpy(this->buf, pbuf, to_write);
-		this->buf += to_write;
+		if (this->decompress_thread.joinable()) this->decompress_thread.join();
 	}
 
+	/**
+	 * Read the data while it is still being written, blocking until more data
+	 * has been written; only once all data is written the end is reported.
+	 */
 	size_t Read(byte *rbuf, size_t size) override
 	{
-		/* Limit the amount to read to whatever we still have. */
-		size_t ret_size = size = min(this->written_bytes - this->read_bytes, size);
-		this->read_bytes += ret_size;
-		const byte *rbufe = rbuf + ret_size;
+		std::unique_lock<std::mutex> guard(this->lock);
+		this->written.wait(guard, [this]() { return this->read_bytes < this->written_bytes || this->finished; });
 
-		while (rbuf != rbufe) {
-			if (this->buf == this->bufe) {
-				this->buf = *this->block++;
-				this->bufe = this->buf + CHUNK;
-			}
-
-			size_t to_write = min(this->bufe - this->buf, rbufe - rbuf);
-			memcpy(rbuf, this->buf, to_write);
-			rbuf += to_write;
-			this->buf += to_write;
+		/* Limit the amount to read to whatever we have. */
+		size_t ret_size = size = min(this->written_bytes - this->read_bytes, size);
+		while (size != 0) {
+			size_t offset = this->read_bytes % CHUNK;
+			size_t to_read = min(CHUNK - offset, size);
+			memcpy(rbuf, this->blocks[this->read_bytes / CHUNK] + offset, to_read);
+			this->read_bytes += to_read;
+			rbuf += to_read;
+			size -= to_read;
 		}
 
 		return ret_size;
@@ -114,11 +138,65 @@ struct PacketReader : LoadFilter {
 
 	void Reset() override
 	{
+		std::lock_guard<std::mutex> guard(this->lock);
 		this->read_bytes = 0;
+	}
 
-		this->block = this->blocks.data();
-		this->buf   = *this->block++;
-		this->bufe  = this->buf + CHUNK;
+	/**
+	 * Start decompressing the savegame on another thread while it is downloaded,
+	 * so after the download only the game state has to be loaded.
+	 */
+	void StartDecompressing()
+	{
+		assert(this->decompressed == nullptr);
+		this->decompressed = new PacketReader();
+		if (!StartNewThread(&this->decompress_thread, "ottd:decompress", &PacketReader::Decompress, this)) {
+			delete this->decompressed;
+			this->decompressed = nullptr;
+		}
+	}
+
+	/** Decompress the savegame into #decompressed; run on the decompression thread. */
+	static void Decompress(PacketReader *reader)
+	{
+		/** Filter writing to a packet reader. */
+		struct PacketReaderWriter : SaveFilter {
+			PacketReader *reader; ///< The reader to write to.
+
+			PacketReaderWriter(PacketReader *reader) : SaveFilter(nullptr), reader(reader) {}
+
+			void Write(byte *buf, size_t len) override
+			{
+				this->reader->Write(buf, len);
+			}
+		};
+
+		PacketReaderWriter writer(reader->decompressed);
+		reader->decompress_success = DecompressSavegame(reader, &writer);
+		reader->decompressed->Finish();
+	}
+
+	/**
+	 * Get the filter to load the savegame from, once it is downloaded.
+	 * @param reader The reader of the download; it is deleted when the filter is another one.
+	 * @return The decompressed savegame if it could be decompressed, otherwise \a reader.
+	 */
+	static LoadFilter *GetLoadFilter(PacketReader *reader)
+	{
+		reader->Finish();
+
+		/* Any error is reported when loading the savegame as it was downloaded. */
+		if (reader->decompressed == nullptr || !reader->decompress_success) {
+			reader->Reset();
+			return reader;
+		}
+
+		DEBUG(net, 2, "Savegame of " PRINTF_SIZE " bytes was decompressed while downloading to " PRINTF_SIZE " bytes", reader->written_bytes, reader->decompressed->written_bytes);
+		LoadFilter *lf = reader->decompressed;
+		reader->decompressed = nullptr;
+		delete reader;
+		lf->Reset();
+		return lf;
 	}
 };
 
@@ -268,10 +346,20 @@ void ClientNetworkGameSocketHandler::ClientError(NetworkRecvStatus res)
 	if (_sync_frame != 0) {
 		if (_sync_frame == _frame_counter) {
 #ifdef NETWORK_SEND_DOUBLE_SEED
-			if (_sync_seed_1 != _random.state[0] || _sync_seed_2 != _random.state[1]) {
+			bool in_sync = _sync_seed_1 == _random.state[0] && _sync_seed_2 == _random.state[1];
 #else
-			if (_sync_seed_1 != _random.state[0]) {
+			bool in_sync = _sync_seed_1 == _random.state[0];
 #endif
+			/* The hashes of the game state may show a desync before the random seed does, and tell what diverged. */
+			if (_sync_state_hash.valid && _state_hash.valid) {
+				for (uint i = 0; i < SHP_END; i++) {
+					if (_sync_state_hash.parts[i] == _state_hash.parts[i]) continue;
+					DEBUG(desync, 0, "sync_err: hash of the %s is %08x instead of %08x", GetStateHashPartName((StateHashPart)i), _state_hash.parts[i], _sync_state_hash.parts[i]);
+					in_sync = false;
+				}
+			}
+
+			if (!in_sync) {
 				NetworkError(STR_NETWORK_ERROR_DESYNC);
 				DEBUG(desync, 1, "sync_err: %08x; %02x", _date, _date_fract);
 				DEBUG(net, 0, "Sync error detected!");
@@ -808,6 +896,7 @@ NetworkRecvStatus ClientNetworkGameSocketHandler::Receive_SERVER_MAP_BEGIN(Packe
 	if (this->savegame != nullptr) return NETWORK_RECV_STATUS_MALFORMED_PACKET;
 
 	this->savegame = new PacketReader();
+	this->savegame->StartDecompressing();
 
 	_frame_counter = _frame_counter_server = _frame_counter_max = p->Recv_uint32();
 
@@ -860,9 +949,8 @@ NetworkRecvStatus ClientNetworkGameSocketHandler::Receive_SERVER_MAP_DONE(Packet
 	 * loading fails the network gets reset upon loading the intro
 	 * game, which would cause us to free this->savegame twice.
 	 */
-	LoadFilter *lf = this->savegame;
+	LoadFilter *lf = PacketReader::GetLoadFilter(this->savegame);
 	this->savegame = nullptr;
-	lf->Reset();
 
 	/* The map is done downloading, load it */
 	ClearErrorMessages();
@@ -899,6 +987,10 @@ NetworkRecvStatus ClientNetworkGameSocketHandler::Receive_SERVER_MAP_DONE(Packet
 		SetLocalCompany(_network_join_as);
 	}
 
+	/* The server kept on running while we downloaded and loaded the map; run those frames first. */
+	_network_catching_up = true;
+	if (FindWindowById(WC_NETWORK_STATUS_WINDOW, WN_NETWORK_STATUS_WINDOW_JOIN) == nullptr) ShowJoinStatusWindow();
+
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
@@ -944,6 +1036,8 @@ NetworkRecvStatus ClientNetworkGameSocketHandler::Receive_SERVER_SYNC(Packet *p)
 #ifdef NETWORK_SEND_DOUBLE_SEED
 	_sync_seed_2 = p->Recv_uint32();
 #endif
+	_sync_state_hash.valid = p->Recv_bool();
+	for (uint i = 0; i < SHP_END; i++) _sync_state_hash.parts[i] = p->Recv_uint32();
 
 	return NETWORK_RECV_STATUS_OKAY;
 }
@@ -967,6 +1061,19 @@ NetworkRecvStatus ClientNetworkGameSocketHandler::Receive_SERVER_COMMAND(Packet
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
+NetworkRecvStatus ClientNetworkGameSocketHandler::Receive_SERVER_COMMANDS(Packet *p)
+{
+	if (this->status != STATUS_ACTIVE) return NETWORK_RECV_STATUS_MALFORMED_PACKET;
+
+	const char *err = this->ReceiveCommandBatch(p, &this->incoming_queue);
+	if (err != nullptr) {
+		IConsolePrintF(CC_ERROR, "WARNING: %s from server, dropping...", err);
+		return NETWORK_RECV_STATUS_MALFORMED_PACKET;
+	}
+
+	return NETWORK_RECV_STATUS_OKAY;
+}
+
 NetworkRecvStatus ClientNetworkGameSocketHandler::Receive_SERVER_CHAT(Packet *p)
 {
 	if (this->status != STATUS_ACTIVE) return NETWORK_RECV_STATUS_MALFORMED_PACKET;
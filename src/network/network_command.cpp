@@ -14,6 +14,7 @@
 #include "../command_func.h"
 #include "../company_func.h"
 #include "../settings_type.h"
+#include "../string_func.h"
 
 #include "../safeguards.h"
 
@@ -228,18 +229,222 @@ void NetworkFreeLocalCommandQueue()
 	_local_execution_queue.Free();
 }
 
+/** Flags telling which fields of a command in a #PACKET_SERVER_COMMANDS packet are there. */
+enum CommandBatchFlags {
+	CBF_ORIGIN   = 1 << 0, ///< The command originates from another client than the previous command.
+	CBF_COMPANY  = 1 << 1, ///< The command is executed by another company than the previous command.
+	CBF_COMMAND  = 1 << 2, ///< The command differs from the previous command.
+	CBF_TEXT     = 1 << 3, ///< The command has a text.
+	CBF_CALLBACK = 1 << 4, ///< The command has a callback.
+	CBF_ALL      = (1 << 5) - 1, ///< All valid flags.
+};
+
+/** The most bytes a command takes in a #PACKET_SERVER_COMMANDS packet. */
+static const uint COMMAND_BATCH_MAX_COMMAND_SIZE = 1 + 5 + 1 + 5 + 3 * 5 + sizeof(CommandPacket::text) + 1;
+
+/** What the commands in a #PACKET_SERVER_COMMANDS packet are encoded relative to. */
+struct CommandBatchState {
+	ClientID origin; ///< Client the previous command originates from.
+	CompanyID company; ///< Company that executes the previous command.
+	uint32 cmd;      ///< The previous command.
+	TileIndex tile;  ///< Tile of the previous command.
+	uint32 p1;       ///< P1 of the previous command.
+	uint32 p2;       ///< P2 of the previous command.
+
+	/** Initialise the state for the first command of a packet. */
+	CommandBatchState() : origin(INVALID_CLIENT_ID), company(INVALID_COMPANY), cmd(UINT32_MAX), tile(0), p1(0), p2(0) {}
+};
+
+/**
+ * Send an unsigned integer in as few bytes as needed, 7 bits per byte.
+ * @param p The packet to send it in.
+ * @param value The value to send.
+ */
+static void SendVarUint(Packet *p, uint32 value)
+{
+	while (value >= 0x80) {
+		p->Send_uint8(0x80 | (value & 0x7F));
+		value >>= 7;
+	}
+	p->Send_uint8(value);
+}
+
+/**
+ * Receive an unsigned integer as sent by #SendVarUint.
+ * @param p The packet to read from.
+ * @return The value.
+ */
+static uint32 RecvVarUint(Packet *p)
+{
+	uint32 value = 0;
+	for (uint shift = 0; shift < 32; shift += 7) {
+		uint8 b = p->Recv_uint8();
+		value |= (uint32)(b & 0x7F) << shift;
+		if ((b & 0x80) == 0) break;
+	}
+	return value;
+}
+
+/**
+ * Send the difference between two values, so small differences in
+ * either direction only take few bytes.
+ * @param p The packet to send it in.
+ * @param value The value to send.
+ * @param previous The value it is relative to.
+ */
+static void SendVarDelta(Packet *p, uint32 value, uint32 previous)
+{
+	int32 delta = (int32)(value - previous);
+	SendVarUint(p, ((uint32)delta << 1) ^ (uint32)(delta >> 31));
+}
+
+/**
+ * Receive a value as sent by #SendVarDelta.
+ * @param p The packet to read from.
+ * @param previous The value it is relative to.
+ * @return The value.
+ */
+static uint32 RecvVarDelta(Packet *p, uint32 previous)
+{
+	uint32 zigzag = RecvVarUint(p);
+	return previous + ((zigzag >> 1) ^ (0 - (zigzag & 1)));
+}
+
+/**
+ * Get the index of a callback in the #_callback_table.
+ * @param callback The callback.
+ * @return The index; that of no callback when it is not in the table.
+ */
+static byte GetCallbackIndex(CommandCallback *callback)
+{
+	byte index = 0;
+	while (index < lengthof(_callback_table) && _callback_table[index] != callback) {
+		index++;
+	}
+
+	if (index == lengthof(_callback_table)) {
+		DEBUG(net, 0, "Unknown callback. (Pointer: %p) No callback sent", callback);
+		index = 0; // _callback_table[0] == nullptr
+	}
+	return index;
+}
+
+/**
+ * The commands of a frame that are sent in #PACKET_SERVER_COMMANDS packets,
+ * which are the same for all clients that get them.
+ */
+class CommandBatch {
+	std::vector<Packet *> packets; ///< The packets with the commands.
+	CommandBatchState state;       ///< State of the last packet.
+	uint8 count;                   ///< Number of commands in the last packet.
+
+	/** Fill in the number of commands of the last packet. */
+	void FinishPacket()
+	{
+		if (this->packets.empty()) return;
+		this->packets.back()->buffer[sizeof(PacketSize) + sizeof(PacketType) + sizeof(uint32)] = this->count;
+	}
+
+public:
+	CommandBatch() : count(0) {}
+
+	/** Free the packets that have not been sent. */
+	~CommandBatch()
+	{
+		for (Packet *p : this->packets) delete p;
+	}
+
+	/**
+	 * Add a command to the batch.
+	 * @param cp The command; its frame must be the same for all commands.
+	 * @param origin The client the command originates from.
+	 * @param callback The callback of the command, only used by that client.
+	 */
+	void Add(const CommandPacket &cp, ClientID origin, CommandCallback *callback)
+	{
+		if (this->packets.empty() || this->count == UINT8_MAX || this->packets.back()->size + COMMAND_BATCH_MAX_COMMAND_SIZE > SEND_MTU) {
+			this->FinishPacket();
+
+			Packet *p = new Packet(PACKET_SERVER_COMMANDS);
+			p->Send_uint32(cp.frame);
+			p->Send_uint8(0); // Number of commands, filled in when sending.
+			this->packets.push_back(p);
+			this->state = CommandBatchState();
+			this->count = 0;
+		}
+
+		Packet *p = this->packets.back();
+		byte callback_index = GetCallbackIndex(callback);
+
+		uint8 flags = 0;
+		if (origin != this->state.origin) flags |= CBF_ORIGIN;
+		if (cp.company != this->state.company) flags |= CBF_COMPANY;
+		if (cp.cmd != this->state.cmd) flags |= CBF_COMMAND;
+		if (!StrEmpty(cp.text)) flags |= CBF_TEXT;
+		if (callback_index != 0) flags |= CBF_CALLBACK;
+
+		p->Send_uint8(flags);
+		if (flags & CBF_ORIGIN) SendVarUint(p, origin);
+		if (flags & CBF_COMPANY) p->Send_uint8(cp.company);
+		if (flags & CBF_COMMAND) SendVarUint(p, cp.cmd);
+		SendVarDelta(p, cp.tile, this->state.tile);
+		SendVarDelta(p, cp.p1, this->state.p1);
+		SendVarDelta(p, cp.p2, this->state.p2);
+		if (flags & CBF_TEXT) p->Send_string(cp.text);
+		if (flags & CBF_CALLBACK) p->Send_uint8(callback_index);
+
+		this->state.origin  = origin;
+		this->state.company = cp.company;
+		this->state.cmd     = cp.cmd;
+		this->state.tile    = cp.tile;
+		this->state.p1      = cp.p1;
+		this->state.p2      = cp.p2;
+		this->count++;
+	}
+
+	/**
+	 * Send the batch to all clients that get their commands via batches.
+	 * @see CanReceiveCommandBatch
+	 */
+	void Send()
+	{
+		if (this->packets.empty()) return;
+
+		this->FinishPacket();
+		for (Packet *p : this->packets) p->PrepareToSend();
+
+		for (NetworkClientSocket *cs : NetworkClientSocket::Iterate()) {
+			if (!CanReceiveCommandBatch(cs)) continue;
+			for (Packet *p : this->packets) cs->SendSharedPacket(*p);
+		}
+	}
+
+	/**
+	 * Whether a client gets the commands of a frame via a batch. Clients that
+	 * do not get commands yet, or that still have older commands waiting,
+	 * get them one by one and in order via their command queue instead.
+	 * @param cs The client to check.
+	 * @return True iff the client gets the batch.
+	 */
+	static bool CanReceiveCommandBatch(const NetworkClientSocket *cs)
+	{
+		return cs->status >= NetworkClientSocket::STATUS_PRE_ACTIVE && cs->outgoing_queue.Count() == 0;
+	}
+};
+
 /**
  * "Send" a particular CommandPacket to all clients.
  * @param cp    The command that has to be distributed.
  * @param owner The client that owns the command,
+ * @param batch The batch of commands for the clients that get those.
  */
-static void DistributeCommandPacket(CommandPacket &cp, const NetworkClientSocket *owner)
+static void DistributeCommandPacket(CommandPacket &cp, const NetworkClientSocket *owner, CommandBatch &batch)
 {
 	CommandCallback *callback = cp.callback;
 	cp.frame = _frame_counter_max + 1;
 
 	for (NetworkClientSocket *cs : NetworkClientSocket::Iterate()) {
-		if (cs->status >= NetworkClientSocket::STATUS_MAP) {
+		if (cs->status >= NetworkClientSocket::STATUS_MAP && !CommandBatch::CanReceiveCommandBatch(cs)) {
 			/* Callbacks are only send back to the client who sent them in the
 			 *  first place. This filters that out. */
 			cp.callback = (cs != owner) ? nullptr : callback;
@@ -248,6 +453,8 @@ static void DistributeCommandPacket(CommandPacket &cp, const NetworkClientSocket
 		}
 	}
 
+	batch.Add(cp, owner == nullptr ? CLIENT_ID_SERVER : owner->client_id, callback);
+
 	cp.callback = (nullptr != owner) ? nullptr : callback;
 	cp.my_cmd = (nullptr == owner);
 	_local_execution_queue.Append(&cp);
@@ -257,8 +464,10 @@ static void DistributeCommandPacket(CommandPacket &cp, const NetworkClientSocket
  * "Send" a particular CommandQueue to all clients.
  * @param queue The queue of commands that has to be distributed.
  * @param owner The client that owns the commands,
+ * @param batch The batch of commands for the clients that get those.
+ * @return Whether commands were left in the queue.
  */
-static void DistributeQueue(CommandQueue *queue, const NetworkClientSocket *owner)
+static bool DistributeQueue(CommandQueue *queue, const NetworkClientSocket *owner, CommandBatch &batch)
 {
 #ifdef DEBUG_DUMP_COMMANDS
 	/* When replaying we do not want this limitation. */
@@ -269,22 +478,33 @@ static void DistributeQueue(CommandQueue *queue, const NetworkClientSocket *owne
 
 	CommandPacket *cp;
 	while (--to_go >= 0 && (cp = queue->Pop(true)) != nullptr) {
-		DistributeCommandPacket(*cp, owner);
+		DistributeCommandPacket(*cp, owner, batch);
 		NetworkAdminCmdLogging(owner, cp);
 		free(cp);
 	}
+
+	return queue->Peek(true) != nullptr;
 }
 
-/** Distribute the commands of ourself and the clients. */
-void NetworkDistributeCommands()
+/**
+ * Distribute the commands of ourself and the clients.
+ * @return The number of queues that could not be emptied within commands_per_frame.
+ */
+uint NetworkDistributeCommands()
 {
+	CommandBatch batch;
+	uint backlogged = 0;
+
 	/* First send the server's commands. */
-	DistributeQueue(&_local_wait_queue, nullptr);
+	if (DistributeQueue(&_local_wait_queue, nullptr, batch)) backlogged++;
 
 	/* Then send the queues of the others. */
 	for (NetworkClientSocket *cs : NetworkClientSocket::Iterate()) {
-		DistributeQueue(&cs->incoming_queue, cs);
+		if (DistributeQueue(&cs->incoming_queue, cs, batch)) backlogged++;
 	}
+
+	batch.Send();
+	return backlogged;
 }
 
 /**
@@ -327,14 +547,56 @@ void NetworkGameSocketHandler::SendCommand(Packet *p, const CommandPacket *cp)
 	p->Send_uint32(cp->tile);
 	p->Send_string(cp->text);
 
-	byte callback = 0;
-	while (callback < lengthof(_callback_table) && _callback_table[callback] != cp->callback) {
-		callback++;
-	}
+	p->Send_uint8 (GetCallbackIndex(cp->callback));
+}
+
+/**
+ * Receives a batch of commands from the network.
+ * @param p The packet to read from.
+ * @param queue The queue to add the commands to.
+ * @return an error message. When nullptr there has been no error.
+ */
+const char *NetworkGameSocketHandler::ReceiveCommandBatch(Packet *p, CommandQueue *queue)
+{
+	CommandPacket cp;
+	cp.frame = p->Recv_uint32();
+
+	CommandBatchState state;
+	for (uint count = p->Recv_uint8(); count > 0; count--) {
+		uint8 flags = p->Recv_uint8();
+		if ((flags & ~CBF_ALL) != 0) return "invalid command batch flags";
+
+		if (flags & CBF_ORIGIN) state.origin = (ClientID)RecvVarUint(p);
+		if (flags & CBF_COMPANY) state.company = (CompanyID)p->Recv_uint8();
+		if (flags & CBF_COMMAND) state.cmd = RecvVarUint(p);
+		state.tile = RecvVarDelta(p, state.tile);
+		state.p1 = RecvVarDelta(p, state.p1);
+		state.p2 = RecvVarDelta(p, state.p2);
+
+		cp.company = state.company;
+		cp.cmd  = state.cmd;
+		if (!IsValidCommand(cp.cmd))               return "invalid command";
+		if (GetCommandFlags(cp.cmd) & CMD_OFFLINE) return "offline only command";
+		if ((cp.cmd & CMD_FLAGS_MASK) != 0)        return "invalid command flag";
+
+		cp.tile = state.tile;
+		cp.p1   = state.p1;
+		cp.p2   = state.p2;
+		if (flags & CBF_TEXT) {
+			p->Recv_string(cp.text, lengthof(cp.text), (!_network_server && GetCommandFlags(cp.cmd) & CMD_STR_CTRL) != 0 ? SVS_ALLOW_CONTROL_CODE | SVS_REPLACE_WITH_QUESTION_MARK : SVS_REPLACE_WITH_QUESTION_MARK);
+		} else {
+			cp.text[0] = '\0';
+		}
 
-	if (callback == lengthof(_callback_table)) {
-		DEBUG(net, 0, "Unknown callback. (Pointer: %p) No callback sent", cp->callback);
-		callback = 0; // _callback_table[0] == nullptr
+		byte callback = (flags & CBF_CALLBACK) ? p->Recv_uint8() : 0;
+		if (callback >= lengthof(_callback_table))  return "invalid callback";
+
+		/* Callbacks are only of interest to the client the command originates from. */
+		cp.my_cmd = (state.origin == _network_own_client_id);
+		cp.callback = cp.my_cmd ? _callback_table[callback] : nullptr;
+
+		queue->Append(&cp);
 	}
-	p->Send_uint8 (callback);
+
+	return nullptr;
 }
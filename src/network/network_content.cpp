@@ -15,6 +15,7 @@
 #include "../error.h"
 #include "../base_media_base.h"
 #include "../settings_type.h"
+#include "../thread.h"
 #include "network_content.h"
 
 #include "table/strings.h"
@@ -23,10 +24,28 @@
 #include <zlib.h>
 #endif
 
+#include <mutex>
+#include <condition_variable>
+
 #include "../safeguards.h"
 
 extern bool HasScenario(const ContentInfo *ci, bool md5sum);
 
+/** A downloaded file of content that has to be, or has been, decompressed. */
+struct ContentExtraction {
+	ContentType type;         ///< Type of the content.
+	ContentID id;             ///< Unique (server side) ID of the content.
+	std::string compressed;   ///< Path of the downloaded .tar.gz file.
+	std::string uncompressed; ///< Path of the .tar file it is decompressed to.
+	bool success;             ///< Whether decompressing succeeded.
+};
+
+static std::mutex _content_extraction_mutex;                     ///< Mutex for the files that are decompressed.
+static std::condition_variable _content_extraction_cv;           ///< Signalled when the decompression thread stops.
+static std::deque<ContentExtraction> _content_extraction_queue;  ///< Files that still have to be decompressed.
+static std::vector<ContentExtraction> _content_extracted;        ///< Files that have been decompressed, but are not made known yet.
+static bool _content_extraction_running = false;                ///< Whether the decompression thread is running.
+
 /** The client we use to connect to the server. */
 ClientNetworkContentSocketHandler _network_content_client;
 
@@ -387,23 +406,25 @@ static char *GetFullFilename(const ContentInfo *ci, bool compressed)
 }
 
 /**
- * Gunzip a given file and remove the .gz if successful.
- * @param ci container with filename
+ * Gunzip a given file.
+ * This does not touch any other state, so it can be done on another thread.
+ * @param compressed the file to gunzip
+ * @param uncompressed the file to write the result to
  * @return true if the gunzip completed
  */
-static bool GunzipFile(const ContentInfo *ci)
+static bool GunzipFile(const char *compressed, const char *uncompressed)
 {
 #if defined(WITH_ZLIB)
 	bool ret = true;
 
 	/* Need to open the file with fopen() to support non-ASCII on Windows. */
-	FILE *ftmp = fopen(GetFullFilename(ci, true), "rb");
+	FILE *ftmp = fopen(compressed, "rb");
 	if (ftmp == nullptr) return false;
 	/* Duplicate the handle, and close the FILE*, to avoid double-closing the handle later. */
 	gzFile fin = gzdopen(dup(fileno(ftmp)), "rb");
 	fclose(ftmp);
 
-	FILE *fout = fopen(GetFullFilename(ci, false), "wb");
+	FILE *fout = fopen(uncompressed, "wb");
 
 	if (fin == nullptr || fout == nullptr) {
 		ret = false;
@@ -448,6 +469,24 @@ static bool GunzipFile(const ContentInfo *ci)
 #endif /* defined(WITH_ZLIB) */
 }
 
+/** Decompress the queued downloaded files, until there are none left. */
+static void ContentExtractionThread()
+{
+	std::unique_lock<std::mutex> lock(_content_extraction_mutex);
+	while (!_content_extraction_queue.empty()) {
+		ContentExtraction extraction = std::move(_content_extraction_queue.front());
+		_content_extraction_queue.pop_front();
+
+		lock.unlock();
+		extraction.success = GunzipFile(extraction.compressed.c_str(), extraction.uncompressed.c_str());
+		lock.lock();
+
+		_content_extracted.push_back(std::move(extraction));
+	}
+	_content_extraction_running = false;
+	_content_extraction_cv.notify_all();
+}
+
 bool ClientNetworkContentSocketHandler::Receive_SERVER_CONTENT(Packet *p)
 {
 	if (this->curFile == nullptr) {
@@ -478,12 +517,39 @@ bool ClientNetworkContentSocketHandler::Receive_SERVER_CONTENT(Packet *p)
 
 		this->OnDownloadProgress(this->curInfo, (int)toRead);
 
-		if (toRead == 0) this->AfterDownload();
+		if (toRead == 0) {
+			/* We read nothing; that's our marker for end-of-stream. */
+			fclose(this->curFile);
+			this->curFile = nullptr;
+			this->AfterDownload(this->curInfo);
+		}
 	}
 
 	return true;
 }
 
+/**
+ * Open the file to download a piece of content to.
+ * @param ci the content that is going to be downloaded
+ * @param[out] file the opened file, or nullptr when there is nothing to download
+ * @return false on any error.
+ */
+static bool OpenDownloadFile(const ContentInfo *ci, FILE **file)
+{
+	*file = nullptr;
+	if (ci->filesize == 0) return true;
+
+	/* The filesize is > 0, so we are going to download it */
+	const char *filename = GetFullFilename(ci, true);
+	if (filename == nullptr || (*file = fopen(filename, "wb")) == nullptr) {
+		/* Unless that fails of course... */
+		DeleteWindowById(WC_NETWORK_STATUS_WINDOW, WN_NETWORK_STATUS_WINDOW_CONTENT_DOWNLOAD);
+		ShowErrorMessage(STR_CONTENT_ERROR_COULD_NOT_DOWNLOAD, STR_CONTENT_ERROR_COULD_NOT_DOWNLOAD_FILE_NOT_WRITABLE, WL_ERROR);
+		return false;
+	}
+	return true;
+}
+
 /**
  * Handle the opening of the file before downloading.
  * @return false on any error.
@@ -496,54 +562,87 @@ bool ClientNetworkContentSocketHandler::BeforeDownload()
 		return false;
 	}
 
-	if (this->curInfo->filesize != 0) {
-		/* The filesize is > 0, so we are going to download it */
-		const char *filename = GetFullFilename(this->curInfo, true);
-		if (filename == nullptr || (this->curFile = fopen(filename, "wb")) == nullptr) {
-			/* Unless that fails of course... */
-			DeleteWindowById(WC_NETWORK_STATUS_WINDOW, WN_NETWORK_STATUS_WINDOW_CONTENT_DOWNLOAD);
-			ShowErrorMessage(STR_CONTENT_ERROR_COULD_NOT_DOWNLOAD, STR_CONTENT_ERROR_COULD_NOT_DOWNLOAD_FILE_NOT_WRITABLE, WL_ERROR);
-			return false;
-		}
-	}
-	return true;
+	return OpenDownloadFile(this->curInfo, &this->curFile);
 }
 
 /**
- * Handle the closing and extracting of a file after
- * downloading it has been done.
+ * Handle the extracting of a file after downloading it has been done.
+ * The file is gunzipped on another thread; it is made known by
+ * #HandleExtractedContent once that is done.
+ * @param ci the downloaded content, of which the file has been closed
  */
-void ClientNetworkContentSocketHandler::AfterDownload()
+void ClientNetworkContentSocketHandler::AfterDownload(const ContentInfo *ci)
+{
+	ContentExtraction extraction;
+	extraction.type = ci->type;
+	extraction.id = ci->id;
+	extraction.compressed = GetFullFilename(ci, true);
+	extraction.uncompressed = GetFullFilename(ci, false);
+	extraction.success = false;
+
+	std::unique_lock<std::mutex> lock(_content_extraction_mutex);
+	_content_extraction_queue.push_back(std::move(extraction));
+	if (_content_extraction_running) return;
+	_content_extraction_running = true;
+	lock.unlock();
+
+	if (!StartNewThread(nullptr, "ottd:content-gz", &ContentExtractionThread)) ContentExtractionThread();
+}
+
+/** Make the content that has been gunzipped known, and tell "the world" it has been downloaded. */
+void ClientNetworkContentSocketHandler::HandleExtractedContent()
 {
-	/* We read nothing; that's our marker for end-of-stream.
-	 * Now gunzip the tar and make it known. */
-	fclose(this->curFile);
-	this->curFile = nullptr;
+	std::vector<ContentExtraction> extracted;
+	{
+		std::lock_guard<std::mutex> lock(_content_extraction_mutex);
+		extracted.swap(_content_extracted);
+	}
+
+	for (const ContentExtraction &extraction : extracted) {
+		if (!extraction.success) {
+			ShowErrorMessage(STR_CONTENT_ERROR_COULD_NOT_EXTRACT, INVALID_STRING_ID, WL_ERROR);
+			continue;
+		}
 
-	if (GunzipFile(this->curInfo)) {
-		unlink(GetFullFilename(this->curInfo, true));
+		unlink(extraction.compressed.c_str());
 
-		Subdirectory sd = GetContentInfoSubDir(this->curInfo->type);
+		Subdirectory sd = GetContentInfoSubDir(extraction.type);
 		if (sd == NO_DIRECTORY) NOT_REACHED();
 
 		TarScanner ts;
-		ts.AddFile(sd, GetFullFilename(this->curInfo, false));
+		ts.AddFile(sd, extraction.uncompressed.c_str());
 
-		if (this->curInfo->type == CONTENT_TYPE_BASE_MUSIC) {
+		if (extraction.type == CONTENT_TYPE_BASE_MUSIC) {
 			/* Music can't be in a tar. So extract the tar! */
-			ExtractTar(GetFullFilename(this->curInfo, false), BASESET_DIR);
-			unlink(GetFullFilename(this->curInfo, false));
+			ExtractTar(extraction.uncompressed.c_str(), BASESET_DIR);
+			unlink(extraction.uncompressed.c_str());
 		}
 
-		this->OnDownloadComplete(this->curInfo->id);
-	} else {
-		ShowErrorMessage(STR_CONTENT_ERROR_COULD_NOT_EXTRACT, INVALID_STRING_ID, WL_ERROR);
+		this->OnDownloadComplete(extraction.id);
+	}
+}
+
+/**
+ * Wait until all downloaded files have been gunzipped, and make them known.
+ * Needed before scanning for the downloaded content.
+ */
+void ClientNetworkContentSocketHandler::FinishExtracting()
+{
+	{
+		std::unique_lock<std::mutex> lock(_content_extraction_mutex);
+		_content_extraction_cv.wait(lock, []() { return !_content_extraction_running; });
 	}
+	this->HandleExtractedContent();
 }
 
 /* Also called to just clean up the mess. */
 void ClientNetworkContentSocketHandler::OnFailure()
 {
+	this->CancelHTTPDownloads();
+
+	/* Make the files downloaded so far known, so they are not downloaded again. */
+	this->FinishExtracting();
+
 	/* If we fail, download the rest via the 'old' system. */
 	uint files, bytes;
 	this->DownloadSelectedContent(files, bytes, true);
@@ -551,15 +650,6 @@ void ClientNetworkContentSocketHandler::OnFailure()
 	this->http_response.clear();
 	this->http_response.shrink_to_fit();
 	this->http_response_index = -2;
-
-	if (this->curFile != nullptr) {
-		/* Revert the download progress when we are going for the old system. */
-		long size = ftell(this->curFile);
-		if (size > 0) this->OnDownloadProgress(this->curInfo, (int)-size);
-
-		fclose(this->curFile);
-		this->curFile = nullptr;
-	}
 }
 
 void ClientNetworkContentSocketHandler::OnReceiveData(const char *data, size_t length)
@@ -569,57 +659,43 @@ void ClientNetworkContentSocketHandler::OnReceiveData(const char *data, size_t l
 	/* Ignore any latent data coming from a connection we closed. */
 	if (this->http_response_index == -2) return;
 
-	if (this->http_response_index == -1) {
-		if (data != nullptr) {
-			/* Append the rest of the response. */
-			this->http_response.insert(this->http_response.end(), data, data + length);
-			return;
-		} else {
-			/* Make sure the response is properly terminated. */
-			this->http_response.push_back('\0');
-
-			/* And prepare for receiving the rest of the data. */
-			this->http_response_index = 0;
-		}
-	}
-
 	if (data != nullptr) {
-		/* We have data, so write it to the file. */
-		if (fwrite(data, 1, length, this->curFile) != length) {
-			/* Writing failed somehow, let try via the old method. */
-			this->OnFailure();
-		} else {
-			/* Just received the data. */
-			this->OnDownloadProgress(this->curInfo, (int)length);
-		}
-		/* Nothing more to do now. */
+		/* Append the rest of the response. */
+		this->http_response.insert(this->http_response.end(), data, data + length);
 		return;
 	}
 
-	if (this->curFile != nullptr) {
-		/* We've finished downloading a file. */
-		this->AfterDownload();
-	}
+	/* Make sure the response is properly terminated. */
+	this->http_response.push_back('\0');
+	this->http_response_index = 0;
 
-	if ((uint)this->http_response_index >= this->http_response.size()) {
-		/* It's not a real failure, but if there's
-		 * nothing more to download it helps with
-		 * cleaning up the stuff we allocated. */
+	if (!this->ParseHTTPResponse()) {
 		this->OnFailure();
 		return;
 	}
 
-	delete this->curInfo;
-	/* When we haven't opened a file this must be our first packet with metadata. */
-	this->curInfo = new ContentInfo;
+	this->StartHTTPDownloads();
+}
 
-/** Check p for not being null and return calling OnFailure if that's not the case. */
-#define check_not_null(p) { if ((p) == nullptr) { this->OnFailure(); return; } }
-/** Check p for not being null and then terminate, or return calling OnFailure. */
+/**
+ * Parse the response to the request of the content, which lists where to download the files from.
+ * All files that can be downloaded over HTTP are queued.
+ * @return false when the response is malformed.
+ */
+bool ClientNetworkContentSocketHandler::ParseHTTPResponse()
+{
+/** Check p for not being null and return false if that's not the case. */
+#define check_not_null(p) { if ((p) == nullptr) { delete download; return false; } }
+/** Check p for not being null and then terminate, or return false. */
 #define check_and_terminate(p) { check_not_null(p); *(p) = '\0'; }
 
 	for (;;) {
 		char *str = this->http_response.data() + this->http_response_index;
+		/* Have we gone through all lines? */
+		if (*str == '\0') return true;
+
+		ContentHTTPDownload *download = new ContentHTTPDownload(this);
+
 		char *p = strchr(str, '\n');
 		check_and_terminate(p);
 
@@ -629,31 +705,28 @@ void ClientNetworkContentSocketHandler::OnReceiveData(const char *data, size_t l
 		/* Read the ID */
 		p = strchr(str, ',');
 		check_and_terminate(p);
-		this->curInfo->id = (ContentID)atoi(str);
+		download->info.id = (ContentID)atoi(str);
 
 		/* Read the type */
 		str = p + 1;
 		p = strchr(str, ',');
 		check_and_terminate(p);
-		this->curInfo->type = (ContentType)atoi(str);
+		download->info.type = (ContentType)atoi(str);
 
 		/* Read the file size */
 		str = p + 1;
 		p = strchr(str, ',');
 		check_and_terminate(p);
-		this->curInfo->filesize = atoi(str);
+		download->info.filesize = atoi(str);
 
 		/* Read the URL */
 		str = p + 1;
 		/* Is it a fallback URL? If so, just continue with the next one. */
 		if (strncmp(str, "ottd", 4) == 0) {
-			if ((uint)this->http_response_index >= this->http_response.size()) {
-				/* Have we gone through all lines? */
-				this->OnFailure();
-				return;
-			}
+			delete download;
 			continue;
 		}
+		download->url = str;
 
 		p = strrchr(str, '/');
 		check_not_null(p);
@@ -661,8 +734,8 @@ void ClientNetworkContentSocketHandler::OnReceiveData(const char *data, size_t l
 
 		char tmp[MAX_PATH];
 		if (strecpy(tmp, p, lastof(tmp)) == lastof(tmp)) {
-			this->OnFailure();
-			return;
+			delete download;
+			return false;
 		}
 		/* Remove the extension from the string. */
 		for (uint i = 0; i < 2; i++) {
@@ -671,20 +744,134 @@ void ClientNetworkContentSocketHandler::OnReceiveData(const char *data, size_t l
 		}
 
 		/* Copy the string, without extension, to the filename. */
-		strecpy(this->curInfo->filename, tmp, lastof(this->curInfo->filename));
+		strecpy(download->info.filename, tmp, lastof(download->info.filename));
 
-		/* Request the next file. */
-		if (!this->BeforeDownload()) {
+		this->http_queue.push_back(download);
+	}
+
+#undef check_not_null
+#undef check_and_terminate
+}
+
+/**
+ * Start downloading the next queued files, as long as not too many are being downloaded.
+ * When nothing is left to download, clean up.
+ */
+void ClientNetworkContentSocketHandler::StartHTTPDownloads()
+{
+	while (this->http_downloads.size() < MAX_HTTP_DOWNLOADS && !this->http_queue.empty()) {
+		ContentHTTPDownload *download = this->http_queue.front();
+		this->http_queue.pop_front();
+
+		if (!download->info.IsValid() || !OpenDownloadFile(&download->info, &download->file)) {
+			delete download;
 			this->OnFailure();
 			return;
 		}
 
-		NetworkHTTPSocketHandler::Connect(str, this);
+		/* Nothing to download. */
+		if (download->file == nullptr) {
+			delete download;
+			continue;
+		}
+
+		this->http_downloads.push_back(download);
+		if (NetworkHTTPSocketHandler::Connect(&download->url[0], download) != 0) {
+			this->OnHTTPDownloadFailure(download, true);
+			return;
+		}
+	}
+
+	if (this->http_downloads.empty() && this->http_queue.empty()) {
+		/* It's not a real failure, but if there's
+		 * nothing more to download it helps with
+		 * cleaning up the stuff we allocated. */
+		this->OnFailure();
+	}
+}
+
+/** Cancel all downloads over HTTP, and revert their download progress. */
+void ClientNetworkContentSocketHandler::CancelHTTPDownloads()
+{
+	for (ContentHTTPDownload *download : this->http_queue) delete download;
+	this->http_queue.clear();
+
+	for (ContentHTTPDownload *download : this->http_downloads) {
+		/* Revert the download progress when we are going for the old system. */
+		long size = ftell(download->file);
+		if (size > 0) this->OnDownloadProgress(&download->info, (int)-size);
+
+		fclose(download->file);
+		download->file = nullptr;
+
+		/* The download is freed once its connection is closed. */
+		download->cancelled = true;
+	}
+	this->http_downloads.clear();
+}
+
+/**
+ * Handle the data received for one of the downloads over HTTP.
+ * @param download the download the data is for
+ * @param data the received data, nullptr when all data has been received
+ * @param length the amount of received data
+ */
+void ClientNetworkContentSocketHandler::OnHTTPDownloadData(ContentHTTPDownload *download, const char *data, size_t length)
+{
+	/* Ignore any latent data coming from a download we cancelled. */
+	if (download->cancelled) {
+		if (data == nullptr) delete download;
 		return;
 	}
 
-#undef check
-#undef check_and_terminate
+	if (data != nullptr) {
+		/* We have data, so write it to the file. */
+		if (fwrite(data, 1, length, download->file) != length) {
+			/* Writing failed somehow, let try via the old method. */
+			this->OnHTTPDownloadFailure(download, false);
+		} else {
+			/* Just received the data. */
+			this->OnDownloadProgress(&download->info, (int)length);
+		}
+		return;
+	}
+
+	/* We've finished downloading a file. */
+	fclose(download->file);
+	download->file = nullptr;
+	this->AfterDownload(&download->info);
+
+	this->http_downloads.erase(std::find(this->http_downloads.begin(), this->http_downloads.end(), download));
+	delete download;
+
+	this->StartHTTPDownloads();
+}
+
+/**
+ * Handle the failure of one of the downloads over HTTP; all files that are left are downloaded via the 'old' system.
+ * @param download the download that failed
+ * @param closed whether the connection of the download is closed, so it has to be freed
+ */
+void ClientNetworkContentSocketHandler::OnHTTPDownloadFailure(ContentHTTPDownload *download, bool closed)
+{
+	if (!download->cancelled) this->OnFailure();
+	if (closed) delete download;
+}
+
+/** Free the download, when it did not finish. */
+ContentHTTPDownload::~ContentHTTPDownload()
+{
+	if (this->file != nullptr) fclose(this->file);
+}
+
+void ContentHTTPDownload::OnFailure()
+{
+	this->handler->OnHTTPDownloadFailure(this, true);
+}
+
+void ContentHTTPDownload::OnReceiveData(const char *data, size_t length)
+{
+	this->handler->OnHTTPDownloadData(this, data, length);
 }
 
 /**
@@ -705,6 +892,7 @@ ClientNetworkContentSocketHandler::~ClientNetworkContentSocketHandler()
 {
 	delete this->curInfo;
 	if (this->curFile != nullptr) fclose(this->curFile);
+	for (ContentHTTPDownload *download : this->http_queue) delete download;
 
 	for (ContentInfo *ci : this->infos) delete ci;
 }
@@ -763,6 +951,8 @@ void ClientNetworkContentSocketHandler::Close()
  */
 void ClientNetworkContentSocketHandler::SendReceive()
 {
+	this->HandleExtractedContent();
+
 	if (this->sock == INVALID_SOCKET || this->isConnecting) return;
 
 	if (this->lastActivity + IDLE_TIMEOUT < _realtime_tick) {
@@ -12,6 +12,8 @@
 
 #include "core/tcp_content.h"
 #include "core/tcp_http.h"
+#include <deque>
+#include <string>
 
 /** Vector with content info */
 typedef std::vector<ContentInfo *> ContentVector;
@@ -59,6 +61,27 @@ struct ContentCallback {
 	virtual ~ContentCallback() {}
 };
 
+class ClientNetworkContentSocketHandler;
+
+/** Download of a single file of content over HTTP; several of these may be running at the same time. */
+struct ContentHTTPDownload : HTTPCallback {
+	ClientNetworkContentSocketHandler *handler; ///< The handler the file is downloaded for.
+	ContentInfo info; ///< Information about the downloaded file.
+	std::string url;  ///< The URL the file is downloaded from.
+	FILE *file;       ///< The file the download is written to, or \c nullptr when it is not being written.
+	bool cancelled;   ///< Whether the download was cancelled, so its remaining data is ignored.
+
+	/**
+	 * Create the download of a file.
+	 * @param handler The handler the file is downloaded for.
+	 */
+	ContentHTTPDownload(ClientNetworkContentSocketHandler *handler) : handler(handler), file(nullptr), cancelled(false) {}
+	~ContentHTTPDownload();
+
+	void OnFailure() override;
+	void OnReceiveData(const char *data, size_t length) override;
+};
+
 /**
  * Socket handler for the content server connection
  */
@@ -71,12 +94,16 @@ protected:
 	std::vector<char> http_response;              ///< The HTTP response to the requests we've been doing
 	int http_response_index;                      ///< Where we are, in the response, with handling it
 
+	std::deque<ContentHTTPDownload *> http_queue;      ///< Downloads over HTTP that still have to be started
+	std::vector<ContentHTTPDownload *> http_downloads; ///< Downloads over HTTP that are running
+
 	FILE *curFile;        ///< Currently downloaded file
 	ContentInfo *curInfo; ///< Information about the currently downloaded file
 	bool isConnecting;    ///< Whether we're connecting
 	uint32 lastActivity;  ///< The last time there was network activity
 
 	friend class NetworkContentConnecter;
+	friend struct ContentHTTPDownload;
 
 	bool Receive_SERVER_INFO(Packet *p) override;
 	bool Receive_SERVER_CONTENT(Packet *p) override;
@@ -94,13 +121,22 @@ protected:
 	void OnReceiveData(const char *data, size_t length) override;
 
 	bool BeforeDownload();
-	void AfterDownload();
+	void AfterDownload(const ContentInfo *ci);
+	void HandleExtractedContent();
+
+	bool ParseHTTPResponse();
+	void StartHTTPDownloads();
+	void CancelHTTPDownloads();
+	void OnHTTPDownloadData(ContentHTTPDownload *download, const char *data, size_t length);
+	void OnHTTPDownloadFailure(ContentHTTPDownload *download, bool closed);
 
 	void DownloadSelectedContentHTTP(const ContentIDList &content);
 	void DownloadSelectedContentFallback(const ContentIDList &content);
 public:
 	/** The idle timeout; when to close the connection because it's idle. */
 	static const int IDLE_TIMEOUT = 60 * 1000;
+	/** The number of files that are downloaded over HTTP at the same time. */
+	static const uint MAX_HTTP_DOWNLOADS = 4;
 
 	ClientNetworkContentSocketHandler();
 	~ClientNetworkContentSocketHandler();
@@ -114,6 +150,7 @@ public:
 	void RequestContentList(ContentVector *cv, bool send_md5sum = true);
 
 	void DownloadSelectedContent(uint &files, uint &bytes, bool fallback = false);
+	void FinishExtracting();
 
 	void Select(ContentID cid);
 	void Unselect(ContentID cid);
@@ -147,7 +147,7 @@ void BaseNetworkContentDownloadStatusWindow::OnDownloadProgress(const ContentInf
 	if (ci->id != this->cur_id) {
 		strecpy(this->name, ci->filename, lastof(this->name));
 		this->cur_id = ci->id;
-		this->downloaded_files++;
+		if (!include(this->started_ids, ci->id)) this->downloaded_files++;
 	}
 
 	this->downloaded_bytes += bytes;
@@ -173,6 +173,9 @@ public:
 	/** Free whatever we've allocated */
 	~NetworkContentDownloadStatusWindow()
 	{
+		/* The last downloaded files might still be gunzipped. */
+		_network_content_client.FinishExtracting();
+
 		TarScanner::Mode mode = TarScanner::NONE;
 		for (auto ctype : this->receivedTypes) {
 			switch (ctype) {
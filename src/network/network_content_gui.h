@@ -24,6 +24,7 @@ protected:
 
 	uint32 cur_id; ///< The current ID of the downloaded file
 	char name[48]; ///< The current name of the downloaded file
+	std::vector<ContentID> started_ids; ///< IDs of the files of which the download started, as several are downloaded at once
 
 public:
 	/**
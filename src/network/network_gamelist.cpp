@@ -39,6 +39,9 @@ void NetworkGameListAddItemDelayed(NetworkGameList *item)
 /** Perform the delayed (thread safe) insertion into the game list */
 static void NetworkGameListHandleDelayedInsert()
 {
+	bool changed = false;
+	bool rebuild_host_list = false;
+
 	while (true) {
 		NetworkGameList *ins_item = _network_game_delayed_insertion_list.load(std::memory_order_relaxed);
 		while (ins_item != nullptr && !_network_game_delayed_insertion_list.compare_exchange_weak(ins_item, ins_item->next, std::memory_order_acq_rel)) {}
@@ -55,11 +58,15 @@ static void NetworkGameListHandleDelayedInsert()
 				item->online = false;
 			}
 			item->manually |= ins_item->manually;
-			if (item->manually) NetworkRebuildHostList();
-			UpdateNetworkGameWindow();
+			if (item->manually) rebuild_host_list = true;
+			changed = true;
 		}
 		free(ins_item);
 	}
+
+	/* Update the host list and window once for the whole batch. */
+	if (rebuild_host_list) NetworkRebuildHostList();
+	if (changed) UpdateNetworkGameWindow();
 }
 
 /**
@@ -143,6 +150,8 @@ void NetworkGameListRequery()
 
 	static uint8 requery_cnt = 0;
 
+	/* Do not requery before all queries of the previous round have been sent. */
+	if (NetworkUDPHasQueuedQueries()) return;
 	if (++requery_cnt < REQUERY_EVERY_X_GAMELOOPS) return;
 	requery_cnt = 0;
 
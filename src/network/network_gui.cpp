@@ -2054,6 +2054,14 @@ struct NetworkJoinStatusWindow : Window {
 				}
 				FALLTHROUGH;
 
+			case NETWORK_JOIN_STATUS_PROCESSING:
+			case NETWORK_JOIN_STATUS_REGISTERING:
+				if (_network_catching_up) {
+					SetDParam(0, _frame_counter_server - _frame_counter);
+					DrawString(r.left + 2, r.right - 2, r.top + 20 + FONT_HEIGHT_NORMAL, STR_NETWORK_CONNECTING_CATCHING_UP, TC_FROMSTRING, SA_HOR_CENTER);
+				}
+				FALLTHROUGH;
+
 			default: // Waiting is 15%, so the resting receivement of map is maximum 70%
 				progress = 15 + _network_join_bytes * (100 - 15) / _network_join_bytes_total;
 		}
@@ -2084,6 +2092,10 @@ struct NetworkJoinStatusWindow : Window {
 		width = max(width, GetStringBoundingBox(STR_NETWORK_CONNECTING_DOWNLOADING_1).width);
 		width = max(width, GetStringBoundingBox(STR_NETWORK_CONNECTING_DOWNLOADING_2).width);
 
+		/* For the number of frames to catch up with */
+		SetDParamMaxDigits(0, 8);
+		width = max(width, GetStringBoundingBox(STR_NETWORK_CONNECTING_CATCHING_UP).width);
+
 		/* Give a bit more clearing for the widest strings than strictly needed */
 		size->width = width + WD_FRAMERECT_LEFT + WD_FRAMERECT_BOTTOM + 10;
 	}
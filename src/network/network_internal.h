@@ -14,6 +14,7 @@
 #include "core/tcp_game.h"
 
 #include "../command_type.h"
+#include "../state_hash.h"
 
 #ifdef RANDOM_DEBUG
 /**
@@ -117,6 +118,7 @@ extern uint32 _sync_seed_1;
 extern uint32 _sync_seed_2;
 #endif
 extern uint32 _sync_frame;
+extern StateHash _sync_state_hash;
 extern bool _network_first_time;
 /* Vars needed for the join-GUI */
 extern NetworkJoinStatus _network_join_status;
@@ -155,7 +157,7 @@ struct CommandPacket : CommandContainer {
 	bool my_cmd;         ///< did the command originate from "me"
 };
 
-void NetworkDistributeCommands();
+uint NetworkDistributeCommands();
 void NetworkExecuteLocalCommandQueue();
 void NetworkFreeLocalCommandQueue();
 void NetworkSyncCommandQueue(NetworkClientSocket *cs);
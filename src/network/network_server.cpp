@@ -52,20 +52,29 @@ INSTANTIATE_POOL_METHODS(NetworkClientSocket)
 /** Instantiate the listen sockets. */
 template SocketList TCPListenHandler<ServerNetworkGameSocketHandler, PACKET_SERVER_FULL, PACKET_SERVER_BANNED>::sockets;
 
-/** Writing a savegame directly to a number of packets. */
+/**
+ * Writing a savegame directly to memory, from which it is sent to the clients.
+ * All clients that start downloading the map at the same moment share one
+ * writer, so the savegame is made and kept in memory only once. Each of them
+ * creates its packets from the shared data when it is able to send them, so
+ * the data can be sent while it is still being compressed.
+ */
 struct PacketWriter : SaveFilter {
-	ServerNetworkGameSocketHandler *cs; ///< Socket we are associated with.
-	Packet *current;                    ///< The packet we're currently writing to.
-	size_t total_size;                  ///< Total size of the compressed savegame.
-	Packet *packets;                    ///< Packet queue of the savegame; send these "slowly" to the client.
-	std::mutex mutex;                   ///< Mutex for making threaded saving safe.
-	std::condition_variable exit_sig;   ///< Signal for threaded destruction of this packet writer.
+	/** Amount of savegame data that fits in one packet. */
+	static const size_t CHUNK_SIZE = SEND_MTU - sizeof(PacketSize) - sizeof(PacketType);
+
+	std::vector<std::vector<byte>> chunks; ///< The compressed savegame, split in the payloads for the packets.
+	size_t total_size;                     ///< Total size of the compressed savegame.
+	bool finished;                         ///< Whether the whole savegame has been written.
+	uint readers;                          ///< Number of sockets that still have to send (a part of) the savegame.
+	std::mutex mutex;                      ///< Mutex for making threaded saving safe.
+	std::condition_variable exit_sig;      ///< Signal for threaded destruction of this packet writer.
 
 	/**
 	 * Create the packet writer.
-	 * @param cs The socket handler we're making the packets for.
+	 * @param readers The number of sockets that are going to send the savegame.
 	 */
-	PacketWriter(ServerNetworkGameSocketHandler *cs) : SaveFilter(nullptr), cs(cs), current(nullptr), total_size(0), packets(nullptr)
+	PacketWriter(uint readers) : SaveFilter(nullptr), total_size(0), finished(false), readers(readers)
 	{
 	}
 
@@ -74,34 +83,26 @@ struct PacketWriter : SaveFilter {
 	{
 		std::unique_lock<std::mutex> lock(this->mutex);
 
-		if (this->cs != nullptr) this->exit_sig.wait(lock);
-
-		/* This must all wait until the Destroy function is called. */
-
-		while (this->packets != nullptr) {
-			Packet *p = this->packets->next;
-			delete this->packets;
-			this->packets = p;
-		}
-
-		delete this->current;
+		/* This must all wait until the last reader called the Release function. */
+		this->exit_sig.wait(lock, [this] { return this->readers == 0; });
 	}
 
 	/**
-	 * Begin the destruction of this packet writer. It can happen in two ways:
-	 * in the first case the client disconnected while saving the map. In this
-	 * case the saving has not finished and killed this PacketWriter. In that
-	 * case we simply set cs to nullptr, triggering the appending to fail due to
-	 * the connection problem and eventually triggering the destructor. In the
+	 * Tell that one of the sockets does not need the savegame anymore, either
+	 * because it sent everything or because the client disconnected. When
+	 * this is the last socket, the destruction of this packet writer begins.
+	 * It can happen in two ways: in the first case the saving has not finished
+	 * yet. As there are no readers anymore writing will fail due to the
+	 * connection problem, which eventually triggers the destructor. In the
 	 * second case the destructor is already called, and it is waiting for our
-	 * signal which we will send. Only then the packets will be removed by the
-	 * destructor.
+	 * signal which we will send.
 	 */
-	void Destroy()
+	void Release()
 	{
 		std::unique_lock<std::mutex> lock(this->mutex);
 
-		this->cs = nullptr;
+		assert(this->readers > 0);
+		if (--this->readers != 0) return;
 
 		this->exit_sig.notify_all();
 		lock.unlock();
@@ -114,65 +115,64 @@ struct PacketWriter : SaveFilter {
 	}
 
 	/**
-	 * Checks whether there are packets.
-	 * It's not 100% threading safe, but this is only asked for when checking
-	 * whether there still is something to send. Then another call will be made
-	 * to actually get the Packet, which will be the only one popping packets
-	 * and thus eventually setting this on false.
+	 * Get the size of the savegame.
+	 * @return The size of the savegame, or 0 when it is still being written.
 	 */
-	bool HasPackets()
+	size_t GetFinishedSize()
 	{
-		return this->packets != nullptr;
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		return this->finished ? this->total_size : 0;
 	}
 
 	/**
-	 * Pop a single created packet from the queue with packets.
+	 * Create the next packet one of the sockets has to send.
+	 * @param[in,out] chunk The next chunk the socket has to send; advanced when a packet is made.
+	 * @return The packet, or \c nullptr when no new data is available (yet).
 	 */
-	Packet *PopPacket()
+	Packet *NextPacket(size_t &chunk)
 	{
 		std::lock_guard<std::mutex> lock(this->mutex);
 
-		Packet *p = this->packets;
-		this->packets = p->next;
-		p->next = nullptr;
-
-		return p;
-	}
+		/* The last chunk is only complete once the saving has finished. */
+		size_t available = this->chunks.size();
+		if (!this->finished && available > 0) available--;
 
-	/** Append the current packet to the queue. */
-	void AppendQueue()
-	{
-		if (this->current == nullptr) return;
+		if (chunk < available) {
+			const std::vector<byte> &data = this->chunks[chunk++];
+			Packet *p = new Packet(PACKET_SERVER_MAP_DATA);
+			memcpy(p->buffer + p->size, data.data(), data.size());
+			p->size += (PacketSize)data.size();
+			return p;
+		}
 
-		Packet **p = &this->packets;
-		while (*p != nullptr) {
-			p = &(*p)->next;
+		if (this->finished && chunk == available) {
+			/* Add a packet stating that this is the end. */
+			chunk++;
+			return new Packet(PACKET_SERVER_MAP_DONE);
 		}
-		*p = this->current;
 
-		this->current = nullptr;
+		return nullptr;
 	}
 
 	void Write(byte *buf, size_t size) override
 	{
-		/* We want to abort the saving when the socket is closed. */
-		if (this->cs == nullptr) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
-
-		if (this->current == nullptr) this->current = new Packet(PACKET_SERVER_MAP_DATA);
-
 		std::lock_guard<std::mutex> lock(this->mutex);
 
+		/* We want to abort the saving when all sockets are closed. */
+		if (this->readers == 0) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
+
 		byte *bufe = buf + size;
 		while (buf != bufe) {
-			size_t to_write = min(SEND_MTU - this->current->size, bufe - buf);
-			memcpy(this->current->buffer + this->current->size, buf, to_write);
-			this->current->size += (PacketSize)to_write;
-			buf += to_write;
-
-			if (this->current->size == SEND_MTU) {
-				this->AppendQueue();
-				if (buf != bufe) this->current = new Packet(PACKET_SERVER_MAP_DATA);
+			if (this->chunks.empty() || this->chunks.back().size() == CHUNK_SIZE) {
+				this->chunks.emplace_back();
+				this->chunks.back().reserve(CHUNK_SIZE);
 			}
+
+			std::vector<byte> &chunk = this->chunks.back();
+			size_t to_write = min(CHUNK_SIZE - chunk.size(), (size_t)(bufe - buf));
+			chunk.insert(chunk.end(), buf, buf + to_write);
+			buf += to_write;
 		}
 
 		this->total_size += size;
@@ -180,22 +180,12 @@ struct PacketWriter : SaveFilter {
 
 	void Finish() override
 	{
-		/* We want to abort the saving when the socket is closed. */
-		if (this->cs == nullptr) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
-
 		std::lock_guard<std::mutex> lock(this->mutex);
 
-		/* Make sure the last packet is flushed. */
-		this->AppendQueue();
-
-		/* Add a packet stating that this is the end to the queue. */
-		this->current = new Packet(PACKET_SERVER_MAP_DONE);
-		this->AppendQueue();
+		/* We want to abort the saving when all sockets are closed. */
+		if (this->readers == 0) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
 
-		/* Fast-track the size to the client. */
-		Packet *p = new Packet(PACKET_SERVER_MAP_SIZE);
-		p->Send_uint32((uint32)this->total_size);
-		this->cs->NetworkTCPSocketHandler::SendPacket(p);
+		this->finished = true;
 	}
 };
 
@@ -225,7 +215,7 @@ ServerNetworkGameSocketHandler::~ServerNetworkGameSocketHandler()
 	OrderBackup::ResetUser(this->client_id);
 
 	if (this->savegame != nullptr) {
-		this->savegame->Destroy();
+		this->savegame->Release();
 		this->savegame = nullptr;
 	}
 }
@@ -558,39 +548,63 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendWait()
 /** This sends the map to the client */
 NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 {
-	static uint sent_packets; // How many packets we did send successfully last time
-
 	if (this->status < STATUS_AUTHORIZED) {
 		/* Illegal call, return error and ignore the packet */
 		return this->SendError(NETWORK_ERROR_NOT_AUTHORIZED);
 	}
 
 	if (this->status == STATUS_AUTHORIZED) {
-		this->savegame = new PacketWriter(this);
-
-		/* Now send the _frame_counter and how many packets are coming */
-		Packet *p = new Packet(PACKET_SERVER_MAP_BEGIN);
-		p->Send_uint32(_frame_counter);
-		this->SendPacket(p);
-
-		NetworkSyncCommandQueue(this);
-		this->status = STATUS_MAP;
-		/* Mark the start of download */
-		this->last_frame = _frame_counter;
-		this->last_frame_server = _frame_counter;
+		/* Everyone waiting for the map gets the same dump of the game. */
+		uint readers = 0;
+		for (NetworkClientSocket *new_cs : NetworkClientSocket::Iterate()) {
+			if (new_cs == this || new_cs->status == STATUS_MAP_WAIT) readers++;
+		}
 
-		sent_packets = 4; // We start with trying 4 packets
+		PacketWriter *savegame = new PacketWriter(readers);
+		for (NetworkClientSocket *new_cs : NetworkClientSocket::Iterate()) {
+			if (new_cs != this && new_cs->status != STATUS_MAP_WAIT) continue;
+
+			new_cs->savegame = savegame;
+			new_cs->savegame_chunk = 0;
+			new_cs->savegame_packets = 4; // We start with trying 4 packets
+			new_cs->savegame_size_sent = false;
+
+			/* Now send the _frame_counter and how many packets are coming */
+			Packet *p = new Packet(PACKET_SERVER_MAP_BEGIN);
+			p->Send_uint32(_frame_counter);
+			new_cs->SendPacket(p);
+
+			NetworkSyncCommandQueue(new_cs);
+			new_cs->status = STATUS_MAP;
+			/* Mark the start of download */
+			new_cs->last_frame = _frame_counter;
+			new_cs->last_frame_server = _frame_counter;
+		}
 
 		/* Make a dump of the current game */
-		if (SaveWithFilter(this->savegame, true) != SL_OK) usererror("network savedump failed");
+		if (SaveWithFilter(savegame, true) != SL_OK) usererror("network savedump failed");
 	}
 
 	if (this->status == STATUS_MAP) {
 		bool last_packet = false;
 		bool has_packets = false;
 
-		for (uint i = 0; (has_packets = this->savegame->HasPackets()) && i < sent_packets; i++) {
-			Packet *p = this->savegame->PopPacket();
+		if (!this->savegame_size_sent) {
+			/* Fast-track the size to the client. */
+			size_t size = this->savegame->GetFinishedSize();
+			if (size != 0) {
+				Packet *p = new Packet(PACKET_SERVER_MAP_SIZE);
+				p->Send_uint32((uint32)size);
+				this->SendPacket(p);
+				this->savegame_size_sent = true;
+			}
+		}
+
+		for (uint i = 0; i < this->savegame_packets; i++) {
+			Packet *p = this->savegame->NextPacket(this->savegame_chunk);
+			if (p == nullptr) break;
+
+			has_packets = true;
 			last_packet = p->buffer[2] == PACKET_SERVER_MAP_DONE;
 
 			this->SendPacket(p);
@@ -603,16 +617,21 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 
 		if (last_packet) {
 			/* Done reading, make sure saving is done as well */
-			this->savegame->Destroy();
+			this->savegame->Release();
 			this->savegame = nullptr;
 
 			/* Set the status to DONE_MAP, no we will wait for the client
 			 *  to send it is ready (maybe that happens like never ;)) */
 			this->status = STATUS_DONE_MAP;
 
-			/* Find the best candidate for joining, i.e. the first joiner. */
+			/* Find the best candidate for joining, i.e. the first joiner.
+			 * A new dump can only be made when nobody is downloading the current one. */
 			NetworkClientSocket *best = nullptr;
 			for (NetworkClientSocket *new_cs : NetworkClientSocket::Iterate()) {
+				if (new_cs->status == STATUS_MAP) {
+					best = nullptr;
+					break;
+				}
 				if (new_cs->status == STATUS_MAP_WAIT) {
 					if (best == nullptr || best->GetInfo()->join_date > new_cs->GetInfo()->join_date || (best->GetInfo()->join_date == new_cs->GetInfo()->join_date && best->client_id > new_cs->client_id)) {
 						best = new_cs;
@@ -622,7 +641,7 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 
 			/* Is there someone else to join? */
 			if (best != nullptr) {
-				/* Let the first start joining. */
+				/* Let the first start joining; the others will join along. */
 				best->status = STATUS_AUTHORIZED;
 				best->SendMap();
 
@@ -639,7 +658,7 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 
 			case SPS_ALL_SENT:
 				/* All are sent, increase the sent_packets */
-				if (has_packets) sent_packets *= 2;
+				if (has_packets) this->savegame_packets *= 2;
 				break;
 
 			case SPS_PARTLY_SENT:
@@ -648,7 +667,7 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 
 			case SPS_NONE_SENT:
 				/* Not everything is sent, decrease the sent_packets */
-				if (sent_packets > 1) sent_packets /= 2;
+				if (this->savegame_packets > 1) this->savegame_packets /= 2;
 				break;
 		}
 	}
@@ -669,8 +688,11 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendJoin(ClientID client_id)
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
-/** Tell the client that they may run to a particular frame. */
-NetworkRecvStatus ServerNetworkGameSocketHandler::SendFrame()
+/**
+ * Make the packet that tells the clients up to which frame they may run.
+ * @return The packet, without the token that #SendFrame adds for some clients.
+ */
+static Packet *NewFramePacket()
 {
 	Packet *p = new Packet(PACKET_SERVER_FRAME);
 	p->Send_uint32(_frame_counter);
@@ -681,6 +703,31 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendFrame()
 	p->Send_uint32(_sync_seed_2);
 #endif
 #endif
+	return p;
+}
+
+/**
+ * Make the packet that lets the clients check they are still in sync.
+ * @return The packet.
+ */
+static Packet *NewSyncPacket()
+{
+	Packet *p = new Packet(PACKET_SERVER_SYNC);
+	p->Send_uint32(_frame_counter);
+	p->Send_uint32(_sync_seed_1);
+
+#ifdef NETWORK_SEND_DOUBLE_SEED
+	p->Send_uint32(_sync_seed_2);
+#endif
+	p->Send_bool(_state_hash.valid);
+	for (uint i = 0; i < SHP_END; i++) p->Send_uint32(_state_hash.parts[i]);
+	return p;
+}
+
+/** Tell the client that they may run to a particular frame. */
+NetworkRecvStatus ServerNetworkGameSocketHandler::SendFrame()
+{
+	Packet *p = NewFramePacket();
 
 	/* If token equals 0, we need to make a new token and send that. */
 	if (this->last_token == 0) {
@@ -695,22 +742,16 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendFrame()
 /** Request the client to sync. */
 NetworkRecvStatus ServerNetworkGameSocketHandler::SendSync()
 {
-	Packet *p = new Packet(PACKET_SERVER_SYNC);
-	p->Send_uint32(_frame_counter);
-	p->Send_uint32(_sync_seed_1);
-
-#ifdef NETWORK_SEND_DOUBLE_SEED
-	p->Send_uint32(_sync_seed_2);
-#endif
-	this->SendPacket(p);
+	this->SendPacket(NewSyncPacket());
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
 /**
- * Send a command to the client to execute.
+ * Make the packet to send a command to a client with.
  * @param cp The command to send.
+ * @return The packet.
  */
-NetworkRecvStatus ServerNetworkGameSocketHandler::SendCommand(const CommandPacket *cp)
+Packet *ServerNetworkGameSocketHandler::NewCommandPacket(const CommandPacket *cp)
 {
 	Packet *p = new Packet(PACKET_SERVER_COMMAND);
 
@@ -718,7 +759,16 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendCommand(const CommandPacke
 	p->Send_uint32(cp->frame);
 	p->Send_bool  (cp->my_cmd);
 
-	this->SendPacket(p);
+	return p;
+}
+
+/**
+ * Send a command to the client to execute.
+ * @param cp The command to send.
+ */
+NetworkRecvStatus ServerNetworkGameSocketHandler::SendCommand(const CommandPacket *cp)
+{
+	this->SendPacket(this->NewCommandPacket(cp));
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
@@ -1795,6 +1845,11 @@ void NetworkServer_Tick(bool send_frame)
 	}
 #endif
 
+	/* The frame and sync packets are the same for (nearly) all clients,
+	 * so with many clients, e.g. spectators, make them only once. */
+	Packet *frame_packet = nullptr;
+	Packet *sync_packet = nullptr;
+
 	/* Now we are done with the frame, inform the clients that they can
 	 *  do their frame! */
 	for (NetworkClientSocket *cs : NetworkClientSocket::Iterate()) {
@@ -1893,15 +1948,35 @@ void NetworkServer_Tick(bool send_frame)
 			NetworkHandleCommandQueue(cs);
 
 			/* Send an updated _frame_counter_max to the client */
-			if (send_frame) cs->SendFrame();
+			if (send_frame) {
+				if (cs->last_token == 0) {
+					/* This client gets a new token; that cannot be shared. */
+					cs->SendFrame();
+				} else {
+					if (frame_packet == nullptr) {
+						frame_packet = NewFramePacket();
+						frame_packet->PrepareToSend();
+					}
+					cs->SendSharedPacket(*frame_packet);
+				}
+			}
 
 #ifndef ENABLE_NETWORK_SYNC_EVERY_FRAME
 			/* Send a sync-check packet */
-			if (send_sync) cs->SendSync();
+			if (send_sync) {
+				if (sync_packet == nullptr) {
+					sync_packet = NewSyncPacket();
+					sync_packet->PrepareToSend();
+				}
+				cs->SendSharedPacket(*sync_packet);
+			}
 #endif
 		}
 	}
 
+	delete frame_packet;
+	delete sync_packet;
+
 	/* See if we need to advertise */
 	NetworkUDPAdvertise();
 }
@@ -71,6 +71,9 @@ public:
 	int receive_limit;           ///< Amount of bytes that we can receive at this moment
 
 	struct PacketWriter *savegame; ///< Writer used to write the savegame.
+	size_t savegame_chunk;         ///< Next chunk of the savegame to send.
+	uint savegame_packets;         ///< Number of packets of the savegame to try to send at once.
+	bool savegame_size_sent;       ///< Whether the size of the savegame has been sent.
 	NetworkAddress client_address; ///< IP-address of the client (so he can be banned)
 
 	ServerNetworkGameSocketHandler(SOCKET s);
@@ -94,6 +97,7 @@ public:
 	NetworkRecvStatus SendJoin(ClientID client_id);
 	NetworkRecvStatus SendFrame();
 	NetworkRecvStatus SendSync();
+	Packet *NewCommandPacket(const CommandPacket *cp);
 	NetworkRecvStatus SendCommand(const CommandPacket *cp);
 	NetworkRecvStatus SendCompanyUpdate();
 	NetworkRecvStatus SendConfigUpdate();
@@ -28,6 +28,8 @@
 #include "../strings_func.h"
 #include "table/strings.h"
 #include <mutex>
+#include <deque>
+#include <algorithm>
 
 #include "core/udp.h"
 
@@ -47,27 +49,75 @@ NetworkUDPSocketHandler *_udp_client_socket = nullptr; ///< udp client socket
 NetworkUDPSocketHandler *_udp_server_socket = nullptr; ///< udp server socket
 NetworkUDPSocketHandler *_udp_master_socket = nullptr; ///< udp master socket
 
+static const uint UDP_QUERIES_PER_LOOP  =   16; ///< maximum number of server queries sent per background loop
+static const uint UDP_QUERIES_IN_FLIGHT =   64; ///< maximum number of server queries waiting for a response
+static const uint32 UDP_QUERY_TIMEOUT   = 1000; ///< time in ms after which a server query no longer counts as waiting for a response
+
+/** A query of a server that is waiting to be sent. */
+struct UDPServerQuery {
+	NetworkAddress address; ///< The address of the server.
+	bool manually;          ///< Whether the address was entered manually.
+};
+
+/** A query of a server that was sent. */
+struct UDPServerQueryInFlight {
+	NetworkAddress address; ///< The address of the server.
+	uint32 sent;            ///< The time the query was sent.
+};
+
+/** Queries of servers that still have to be sent, protected by #_network_udp_mutex. */
+static std::deque<UDPServerQuery> _udp_query_queue;
+/** Queries of servers that were sent, but not responded to yet. */
+static std::vector<UDPServerQueryInFlight> _udp_queries_in_flight;
+/** Whether the game list changed since the network game window was last updated. */
+static bool _udp_game_list_changed = false;
+
 /**
- * Helper function doing the actual work for querying the server.
+ * Helper function queueing the query of the server.
+ * The queries are sent by #SendQueuedUDPQueries, so refreshing a long list of
+ * servers does not send a burst of packets, and their responses do not arrive
+ * all at once.
  * @param address The address of the server.
- * @param needs_mutex Whether we need to acquire locks when sending the packet or not.
+ * @param needs_mutex Whether we need to acquire locks when queueing the query or not.
  * @param manually Whether the address was entered manually.
  */
 static void DoNetworkUDPQueryServer(NetworkAddress &address, bool needs_mutex, bool manually)
 {
-	/* Clear item in gamelist */
-	NetworkGameList *item = CallocT<NetworkGameList>(1);
-	address.GetAddressAsString(item->info.server_name, lastof(item->info.server_name));
-	strecpy(item->info.hostname, address.GetHostname(), lastof(item->info.hostname));
-	item->address = address;
-	item->manually = manually;
-	NetworkGameListAddItemDelayed(item);
+	/* Resolve the address now, which might take a while when done in a thread. */
+	address.GetAddress();
 
 	std::unique_lock<std::mutex> lock(_network_udp_mutex, std::defer_lock);
 	if (needs_mutex) lock.lock();
-	/* Init the packet */
-	Packet p(PACKET_UDP_CLIENT_FIND_SERVER);
-	if (_udp_client_socket != nullptr) _udp_client_socket->SendPacket(&p, &address);
+	_udp_query_queue.push_back({address, manually});
+}
+
+/**
+ * Send the next queued queries of servers, as long as not too many are waiting for a response.
+ * @pre #_network_udp_mutex is locked.
+ */
+static void SendQueuedUDPQueries()
+{
+	_udp_queries_in_flight.erase(std::remove_if(_udp_queries_in_flight.begin(), _udp_queries_in_flight.end(),
+			[](const UDPServerQueryInFlight &q) { return _realtime_tick - q.sent >= UDP_QUERY_TIMEOUT; }), _udp_queries_in_flight.end());
+
+	for (uint i = 0; i < UDP_QUERIES_PER_LOOP && !_udp_query_queue.empty() && _udp_queries_in_flight.size() < UDP_QUERIES_IN_FLIGHT; i++) {
+		UDPServerQuery &query = _udp_query_queue.front();
+
+		/* Clear item in gamelist */
+		NetworkGameList *item = CallocT<NetworkGameList>(1);
+		query.address.GetAddressAsString(item->info.server_name, lastof(item->info.server_name));
+		strecpy(item->info.hostname, query.address.GetHostname(), lastof(item->info.hostname));
+		item->address = query.address;
+		item->manually = query.manually;
+		NetworkGameListAddItemDelayed(item);
+
+		/* Init the packet */
+		Packet p(PACKET_UDP_CLIENT_FIND_SERVER);
+		_udp_client_socket->SendPacket(&p, &query.address);
+
+		_udp_queries_in_flight.push_back({query.address, _realtime_tick});
+		_udp_query_queue.pop_front();
+	}
 }
 
 /**
@@ -82,6 +132,16 @@ void NetworkUDPQueryServer(NetworkAddress address, bool manually)
 	}
 }
 
+/**
+ * Check whether there are queries of servers that still have to be sent.
+ * @return True if there are queued queries.
+ */
+bool NetworkUDPHasQueuedQueries()
+{
+	std::lock_guard<std::mutex> lock(_network_udp_mutex);
+	return !_udp_query_queue.empty();
+}
+
 ///*** Communication with the masterserver ***/
 
 /** Helper class for connecting to the master server. */
@@ -309,6 +369,10 @@ void ClientNetworkUDPSocketHandler::Receive_SERVER_RESPONSE(Packet *p, NetworkAd
 
 	DEBUG(net, 4, "[udp] server response from %s", client_addr->GetAddressAsString());
 
+	/* The query is answered, so make room for the next one. */
+	_udp_queries_in_flight.erase(std::remove_if(_udp_queries_in_flight.begin(), _udp_queries_in_flight.end(),
+			[client_addr](UDPServerQueryInFlight &q) { return q.address == *client_addr; }), _udp_queries_in_flight.end());
+
 	/* Find next item */
 	item = NetworkGameListAddItem(*client_addr);
 
@@ -363,7 +427,7 @@ void ClientNetworkUDPSocketHandler::Receive_SERVER_RESPONSE(Packet *p, NetworkAd
 
 	item->online = true;
 
-	UpdateNetworkGameWindow();
+	_udp_game_list_changed = true;
 }
 
 void ClientNetworkUDPSocketHandler::Receive_MASTER_RESPONSE_LIST(Packet *p, NetworkAddress *client_addr)
@@ -654,6 +718,9 @@ void NetworkUDPClose()
 	_udp_server_socket = nullptr;
 	_udp_master_socket = nullptr;
 
+	_udp_query_queue.clear();
+	_udp_queries_in_flight.clear();
+
 	_network_udp_server = false;
 	_network_udp_broadcast = 0;
 	DEBUG(net, 1, "[udp] closed listeners");
@@ -670,5 +737,12 @@ void NetworkBackgroundUDPLoop()
 	} else {
 		_udp_client_socket->ReceivePackets();
 		if (_network_udp_broadcast > 0) _network_udp_broadcast--;
+		SendQueuedUDPQueries();
+
+		/* Update the window once for all responses received. */
+		if (_udp_game_list_changed) {
+			_udp_game_list_changed = false;
+			UpdateNetworkGameWindow();
+		}
 	}
 }
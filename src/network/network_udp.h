@@ -16,6 +16,7 @@ void NetworkUDPInitialize();
 void NetworkUDPSearchGame();
 void NetworkUDPQueryMasterServer();
 void NetworkUDPQueryServer(NetworkAddress address, bool manually = false);
+bool NetworkUDPHasQueuedQueries();
 void NetworkUDPAdvertise();
 void NetworkUDPRemoveAdvertise(bool blocking);
 void NetworkUDPClose();
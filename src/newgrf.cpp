@@ -5112,6 +5112,7 @@ static void NewSpriteGroup(ByteReader *buf)
 				group->ranges = MallocT<DeterministicSpriteGroupRange>(group->num_ranges);
 				MemCpyT(group->ranges, &optimised.front(), group->num_ranges);
 			}
+			group->Optimise();
 			break;
 		}
 
@@ -8644,6 +8645,8 @@ void ResetNewGRFData()
 
 	InitializeSoundPool();
 	_spritegroup_pool.CleanPool();
+	InvalidateNewGRFCallbackCache();
+	InvalidateVehicleSpriteCache();
 }
 
 /**
@@ -9376,6 +9379,8 @@ void LoadNewGRFFile(GRFConfig *config, uint file_index, GrfLoadingStage stage, S
 	}
 
 	FioOpenFile(file_index, filename, subdir);
+	/* Only in the activation stage real sprites are loaded, and only then the MD5 sum is known for sure. */
+	SetSpriteDiskCacheKey(file_index, stage == GLS_ACTIVATION ? config->ident.md5sum : nullptr);
 	_cur.file_index = file_index; // XXX
 	_palette_remap_grf[_cur.file_index] = (config->palette & GRFP_USE_MASK);
 
@@ -9392,7 +9397,7 @@ void LoadNewGRFFile(GRFConfig *config, uint file_index, GrfLoadingStage stage, S
 	if (stage == GLS_INIT || stage == GLS_ACTIVATION) {
 		/* We need the sprite offsets in the init stage for NewGRF sounds
 		 * and in the activation stage for real sprites. */
-		ReadGRFSpriteOffsets(_cur.grf_container_ver);
+		ReadGRFSpriteOffsets(_cur.grf_container_ver, filename);
 	} else {
 		/* Skip sprite section offset if present. */
 		if (_cur.grf_container_ver >= 2) FioReadDword();
@@ -9792,6 +9797,14 @@ void LoadNewGRF(uint load_index, uint file_index, uint num_baseset)
 
 	_cur.spriteid = load_index;
 
+	/* Parsing the sprite sections only needs the files, so do that for all of them at once. */
+	std::vector<std::pair<std::string, Subdirectory>> files;
+	for (GRFConfig *c = _grfconfig; c != nullptr; c = c->next) {
+		if (c->status == GCS_DISABLED || c->status == GCS_NOT_FOUND) continue;
+		files.emplace_back(c->filename, files.size() < num_baseset ? BASESET_DIR : NEWGRF_DIR);
+	}
+	PrepareGRFSpriteOffsets(files);
+
 	/* Load newgrf sprites
 	 * in each loading stage, (try to) open each file specified in the config
 	 * and load information from it. */
@@ -9857,6 +9870,7 @@ void LoadNewGRF(uint load_index, uint file_index, uint num_baseset)
 
 	/* Pseudo sprite processing is finished; free temporary stuff */
 	_cur.ClearDataForNextFile();
+	ClearPreparedGRFSpriteOffsets();
 
 	/* Call any functions that should be run after GRFs have been loaded. */
 	AfterLoadGRFs();
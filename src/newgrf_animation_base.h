@@ -47,6 +47,9 @@ struct AnimationBase {
 				if (callback >= 0x100 && spec->grf_prop.grffile->grf_version >= 8) ErrorUnknownCallbackResult(spec->grf_prop.grffile->grfid, Tbase::cb_animation_speed, callback);
 				animation_speed = Clamp(callback & 0xFF, 0, 16);
 			}
+		} else {
+			/* Without the callback the speed only changes with the tile, so the animation loop may skip it until its next frame. */
+			SetAnimatedTileSpeed(tile, animation_speed);
 		}
 
 		/* An animation speed of 2 means the animation frame changes 4 ticks, and
@@ -24,6 +24,14 @@
 
 #include "fileio_func.h"
 #include "fios.h"
+#include "worker_pool.h"
+#include "ini_type.h"
+
+#include <map>
+#include <sys/stat.h>
+#if defined(_WIN32)
+#	include <tchar.h>
+#endif
 
 #include "safeguards.h"
 
@@ -403,13 +411,13 @@ static bool CalcGRFMD5Sum(GRFConfig *config, Subdirectory subdir)
 
 
 /**
- * Find the GRFID of a given grf, and calculate its md5sum.
+ * Find the GRFID of a given grf, without calculating its md5sum.
  * @param config    grf to fill.
  * @param is_static grf is static.
  * @param subdir    the subdirectory to search in.
  * @return Operation was successfully completed.
  */
-bool FillGRFDetails(GRFConfig *config, bool is_static, Subdirectory subdir)
+static bool ReadGRFDetails(GRFConfig *config, bool is_static, Subdirectory subdir)
 {
 	if (!FioCheckFileExists(config->filename, subdir)) {
 		config->status = GCS_NOT_FOUND;
@@ -432,7 +440,19 @@ bool FillGRFDetails(GRFConfig *config, bool is_static, Subdirectory subdir)
 		if (HasBit(config->flags, GCF_UNSAFE)) return false;
 	}
 
-	return CalcGRFMD5Sum(config, subdir);
+	return true;
+}
+
+/**
+ * Find the GRFID of a given grf, and calculate its md5sum.
+ * @param config    grf to fill.
+ * @param is_static grf is static.
+ * @param subdir    the subdirectory to search in.
+ * @return Operation was successfully completed.
+ */
+bool FillGRFDetails(GRFConfig *config, bool is_static, Subdirectory subdir)
+{
+	return ReadGRFDetails(config, is_static, subdir) && CalcGRFMD5Sum(config, subdir);
 }
 
 
@@ -623,10 +643,119 @@ compatible_grf:
 	return res;
 }
 
+char *_newgrf_scan_cache_file; ///< Path of the file with the md5sums of the NewGRFs found by the last scan.
+
+/** Identification of the contents of a scanned NewGRF file, to know whether a cached md5sum of it is still valid. */
+struct GRFFileStamp {
+	std::string path; ///< Path of the file, or of the tar file and the file in it.
+	bool valid;       ///< Could the size and modification time of the file be determined?
+	uint64 size;      ///< Size of the file.
+	int64 mtime;      ///< Modification time of the file.
+};
+
+/** The md5sum of a NewGRF file, as stored in the scan cache. */
+struct GRFScanCacheEntry {
+	uint64 size;       ///< Size of the file when the md5sum was calculated.
+	int64 mtime;       ///< Modification time of the file when the md5sum was calculated.
+	uint32 grfid;      ///< GRF ID of the file.
+	uint8 md5sum[16];  ///< MD5 checksum of the file.
+};
+
+/** The scan cache, by path of the file. */
+typedef std::map<std::string, GRFScanCacheEntry> GRFScanCache;
+
+/**
+ * Determine the identification of a scanned NewGRF file.
+ * @param filename Name of the file, or of the file in the tar.
+ * @param tar_filename Name of the tar the file is in, or \c nullptr.
+ * @return The identification of the file.
+ */
+static GRFFileStamp GetGRFFileStamp(const char *filename, const char *tar_filename)
+{
+	GRFFileStamp stamp;
+	stamp.path = tar_filename == nullptr ? filename : std::string(tar_filename) + PATHSEPCHAR + filename;
+
+	/* Files in a tar can only change together with the tar. */
+	const char *file = tar_filename == nullptr ? filename : tar_filename;
+#if defined(_WIN32)
+	struct _stat64 sb;
+	stamp.valid = _tstat64(OTTD2FS(file), &sb) == 0;
+#else
+	struct stat sb;
+	stamp.valid = stat(OTTD2FS(file), &sb) == 0;
+#endif
+	stamp.size = stamp.valid ? sb.st_size : 0;
+	stamp.mtime = stamp.valid ? sb.st_mtime : 0;
+	return stamp;
+}
+
+/**
+ * Load the md5sums of the NewGRFs found by the last scan.
+ * @return The cached md5sums.
+ */
+static GRFScanCache LoadGRFScanCache()
+{
+	GRFScanCache cache;
+	if (_newgrf_scan_cache_file == nullptr) return cache;
+
+	IniFile ini;
+	ini.LoadFromDisk(_newgrf_scan_cache_file, NO_DIRECTORY);
+	IniGroup *group = ini.GetGroup("md5sums", 0, false);
+	if (group == nullptr) return cache;
+
+	for (const IniItem *item = group->item; item != nullptr; item = item->next) {
+		if (item->value == nullptr) continue;
+
+		/* The value is "<size> <mtime> <grfid> <md5sum>", all in hexadecimal. */
+		GRFScanCacheEntry entry;
+		char *p = item->value;
+		entry.size = strtoull(p, &p, 16);
+		entry.mtime = (int64)strtoull(p, &p, 16);
+		entry.grfid = (uint32)strtoul(p, &p, 16);
+		while (*p == ' ') p++;
+
+		uint i;
+		for (i = 0; i < lengthof(entry.md5sum) && isxdigit(p[0]) && isxdigit(p[1]); i++, p += 2) {
+			char byte[3] = { p[0], p[1], '\0' };
+			entry.md5sum[i] = (uint8)strtoul(byte, nullptr, 16);
+		}
+		if (i == lengthof(entry.md5sum) && *p == '\0') cache[item->name] = entry;
+	}
+	return cache;
+}
+
+/**
+ * Save the md5sums of the NewGRFs found by a scan.
+ * @param cache The md5sums to save.
+ */
+static void SaveGRFScanCache(const GRFScanCache &cache)
+{
+	if (_newgrf_scan_cache_file == nullptr) return;
+
+	IniFile ini;
+	IniGroup *group = ini.GetGroup("md5sums");
+	for (const auto &it : cache) {
+		const GRFScanCacheEntry &entry = it.second;
+		char md5sum[33];
+		md5sumToString(md5sum, lastof(md5sum), entry.md5sum);
+
+		char value[128];
+		seprintf(value, lastof(value), OTTD_PRINTFHEX64 " " OTTD_PRINTFHEX64 " %08X %s", (unsigned long long)entry.size, (unsigned long long)entry.mtime, entry.grfid, md5sum);
+		/* Items are appended to the group, so the files do not have to be looked up in a list. */
+		IniItem *item = new IniItem(group, it.first.c_str());
+		item->SetValue(value);
+	}
+	ini.SaveToDisk(_newgrf_scan_cache_file);
+}
+
 /** Helper for scanning for files with GRF as extension */
 class GRFFileScanner : FileScanner {
 	uint next_update; ///< The next (realtime tick) we do update the screen.
 	uint num_scanned; ///< The number of GRFs we have scanned.
+	std::vector<GRFConfig *> found; ///< The GRFs found so far, without their md5sum.
+	std::vector<GRFFileStamp> stamps; ///< Identification of the files of #found.
+
+	static bool AddGRF(GRFConfig *c);
 
 public:
 	GRFFileScanner() : next_update(_realtime_tick), num_scanned(0)
@@ -639,7 +768,53 @@ public:
 	static uint DoScan()
 	{
 		GRFFileScanner fs;
-		int ret = fs.Scan(".grf", NEWGRF_DIR);
+		fs.Scan(".grf", NEWGRF_DIR);
+
+		/* Reading the GRFs uses the shared file slots, but their md5sums can be
+		 * calculated for all of them at once. They are only added to the list
+		 * after that, in the order they were found, as the first of duplicate
+		 * NewGRFs is the one that is kept. Files that did not change since the
+		 * last scan keep the md5sum of then, so they are not read again. */
+		const GRFScanCache cache = LoadGRFScanCache();
+		std::vector<byte> valid(fs.found.size());
+		std::vector<byte> cached(fs.found.size());
+		RunParallelFor((uint)fs.found.size(), 1, [&fs, &cache, &valid, &cached](uint begin, uint end) {
+			for (uint i = begin; i < end; i++) {
+				GRFConfig *c = fs.found[i];
+				const GRFFileStamp &stamp = fs.stamps[i];
+				auto entry = cache.find(stamp.path);
+				if (stamp.valid && entry != cache.end() && entry->second.size == stamp.size && entry->second.mtime == stamp.mtime && entry->second.grfid == c->ident.grfid) {
+					memcpy(c->ident.md5sum, entry->second.md5sum, sizeof(c->ident.md5sum));
+					valid[i] = cached[i] = true;
+				} else {
+					valid[i] = CalcGRFMD5Sum(c, NEWGRF_DIR);
+				}
+			}
+		});
+
+		GRFScanCache new_cache;
+		bool changed = false;
+		for (size_t i = 0; i < fs.found.size(); i++) {
+			if (!valid[i] || !fs.stamps[i].valid) continue;
+			GRFScanCacheEntry &entry = new_cache[fs.stamps[i].path];
+			entry.size = fs.stamps[i].size;
+			entry.mtime = fs.stamps[i].mtime;
+			entry.grfid = fs.found[i]->ident.grfid;
+			memcpy(entry.md5sum, fs.found[i]->ident.md5sum, sizeof(entry.md5sum));
+			if (!cached[i]) changed = true;
+		}
+		if (changed || new_cache.size() != cache.size()) SaveGRFScanCache(new_cache);
+
+		uint ret = 0;
+		for (size_t i = 0; i < fs.found.size(); i++) {
+			if (valid[i] && AddGRF(fs.found[i])) {
+				ret++;
+			} else {
+				/* The md5sum couldn't be calculated or it's already known, so forget about it. */
+				delete fs.found[i];
+			}
+		}
+
 		/* The number scanned and the number returned may not be the same;
 		 * duplicate NewGRFs and base sets are ignored in the return value. */
 		_settings_client.gui.last_newgrf_count = fs.num_scanned;
@@ -647,37 +822,49 @@ public:
 	}
 };
 
-bool GRFFileScanner::AddFile(const char *filename, size_t basepath_length, const char *tar_filename)
+/**
+ * Add a scanned GRF to the list of all GRFs.
+ * @param c The GRF with its details and md5sum.
+ * @return False iff the GRF is already in the list.
+ */
+/* static */ bool GRFFileScanner::AddGRF(GRFConfig *c)
 {
-	GRFConfig *c = new GRFConfig(filename + basepath_length);
+	if (_all_grfs == nullptr) {
+		_all_grfs = c;
+		return true;
+	}
 
+	/* Insert file into list at a position determined by its
+	 * name, so the list is sorted as we go along */
+	GRFConfig **pd, *d;
 	bool added = true;
-	if (FillGRFDetails(c, false)) {
-		if (_all_grfs == nullptr) {
-			_all_grfs = c;
-		} else {
-			/* Insert file into list at a position determined by its
-			 * name, so the list is sorted as we go along */
-			GRFConfig **pd, *d;
-			bool stop = false;
-			for (pd = &_all_grfs; (d = *pd) != nullptr; pd = &d->next) {
-				if (c->ident.grfid == d->ident.grfid && memcmp(c->ident.md5sum, d->ident.md5sum, sizeof(c->ident.md5sum)) == 0) added = false;
-				/* Because there can be multiple grfs with the same name, make sure we checked all grfs with the same name,
-				 *  before inserting the entry. So insert a new grf at the end of all grfs with the same name, instead of
-				 *  just after the first with the same name. Avoids doubles in the list. */
-				if (strcasecmp(c->GetName(), d->GetName()) <= 0) {
-					stop = true;
-				} else if (stop) {
-					break;
-				}
-			}
-			if (added) {
-				c->next = d;
-				*pd = c;
-			}
+	bool stop = false;
+	for (pd = &_all_grfs; (d = *pd) != nullptr; pd = &d->next) {
+		if (c->ident.grfid == d->ident.grfid && memcmp(c->ident.md5sum, d->ident.md5sum, sizeof(c->ident.md5sum)) == 0) added = false;
+		/* Because there can be multiple grfs with the same name, make sure we checked all grfs with the same name,
+		 *  before inserting the entry. So insert a new grf at the end of all grfs with the same name, instead of
+		 *  just after the first with the same name. Avoids doubles in the list. */
+		if (strcasecmp(c->GetName(), d->GetName()) <= 0) {
+			stop = true;
+		} else if (stop) {
+			break;
 		}
-	} else {
-		added = false;
+	}
+	if (added) {
+		c->next = d;
+		*pd = c;
+	}
+	return added;
+}
+
+bool GRFFileScanner::AddFile(const char *filename, size_t basepath_length, const char *tar_filename)
+{
+	GRFConfig *c = new GRFConfig(filename + basepath_length);
+
+	bool added = ReadGRFDetails(c, false, NEWGRF_DIR);
+	if (added) {
+		this->found.push_back(c);
+		this->stamps.push_back(GetGRFFileStamp(filename, tar_filename));
 	}
 
 	this->num_scanned++;
@@ -698,7 +885,7 @@ bool GRFFileScanner::AddFile(const char *filename, size_t basepath_length, const
 
 	if (!added) {
 		/* File couldn't be opened, or is either not a NewGRF or is a
-		 * 'system' NewGRF or it's already known, so forget about it. */
+		 * 'system' NewGRF, so forget about it. */
 		delete c;
 	}
 
@@ -23,6 +23,7 @@
 #include "newgrf_railtype.h"
 #include "newgrf_roadtype.h"
 #include "ship.h"
+#include "newgrf_profiling.h"
 
 #include "safeguards.h"
 
@@ -1018,11 +1019,48 @@ VehicleResolverObject::VehicleResolverObject(EngineID engine_type, const Vehicle
 
 
 
+static uint64 _vehicle_sprite_cache_generation = 1; ///< Entries of #Vehicle::sprite_cache of any other generation are invalid.
+
+/**
+ * Forget the cached sprites of all vehicles, because the sprite groups they were resolved from are gone.
+ */
+void InvalidateVehicleSpriteCache()
+{
+	_vehicle_sprite_cache_generation++;
+}
+
 void GetCustomEngineSprite(EngineID engine, const Vehicle *v, Direction direction, EngineImageType image_type, VehicleSpriteSeq *result)
 {
 	VehicleResolverObject object(engine, v, VehicleResolverObject::WO_CACHED, false, CBID_NO_CALLBACK);
 	result->Clear();
 
+	/* Sprites on the map are resolved whenever the vehicle moves. If the chain doesn't read any
+	 * variables, the result only changes with what ResolveReal and the random groups look at. */
+	VehicleSpriteCache *cache = nullptr;
+	if (v != nullptr && image_type == EIT_ON_MAP && IsObjectInvariant(object.root_spritegroup) &&
+			std::none_of(_newgrf_profilers.begin(), _newgrf_profilers.end(), [](const NewGRFProfiler &pr) { return pr.active; })) {
+		cache = &v->sprite_cache;
+		bool in_motion = !v->First()->current_order.IsType(OT_LOADING);
+		if (cache->generation == _vehicle_sprite_cache_generation && cache->root == object.root_spritegroup &&
+				cache->cargo_count == v->cargo.StoredCount() && cache->cargo_cap == v->cargo_cap &&
+				cache->in_motion == in_motion && cache->random_bits == v->random_bits) {
+			for (uint i = 0; i < cache->count; i++) {
+				result->seq[i].sprite = cache->result[i] + (direction % cache->num_results[i]);
+				result->seq[i].pal    = cache->pal[i];
+			}
+			result->count = cache->count;
+			return;
+		}
+
+		cache->generation = _vehicle_sprite_cache_generation;
+		cache->root = object.root_spritegroup;
+		cache->cargo_count = v->cargo.StoredCount();
+		cache->cargo_cap = v->cargo_cap;
+		cache->in_motion = in_motion;
+		cache->random_bits = v->random_bits;
+		cache->count = 0;
+	}
+
 	bool sprite_stack = HasBit(EngInfo(engine)->misc_flags, EF_SPRITE_STACK);
 	uint max_stack = sprite_stack ? lengthof(result->seq) : 1;
 	for (uint stack = 0; stack < max_stack; ++stack) {
@@ -1031,6 +1069,12 @@ void GetCustomEngineSprite(EngineID engine, const Vehicle *v, Direction directio
 		const SpriteGroup *group = object.Resolve();
 		uint32 reg100 = sprite_stack ? GetRegister(0x100) : 0;
 		if (group != nullptr && group->GetNumResults() != 0) {
+			if (cache != nullptr) {
+				cache->result[result->count] = group->GetResult();
+				cache->num_results[result->count] = group->GetNumResults();
+				cache->pal[result->count] = GB(reg100, 0, 16);
+				cache->count++;
+			}
 			result->seq[result->count].sprite = group->GetResult() + (direction % group->GetNumResults());
 			result->seq[result->count].pal    = GB(reg100, 0, 16); // zero means default recolouring
 			result->count++;
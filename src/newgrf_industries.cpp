@@ -387,8 +387,8 @@ static uint32 GetCountAndDistanceOfClosestInstance(byte param_setID, byte layout
 		case 0xA7: return this->industry->founder;
 		case 0xA8: return this->industry->random_colour;
 		case 0xA9: return Clamp(this->industry->last_prod_year - ORIGINAL_BASE_YEAR, 0, 255);
-		case 0xAA: return this->industry->counter;
-		case 0xAB: return GB(this->industry->counter, 8, 8);
+		case 0xAA: return this->industry->GetCounter();
+		case 0xAB: return GB(this->industry->GetCounter(), 8, 8);
 		case 0xAC: return this->industry->was_cargo_delivered;
 
 		case 0xB0: return Clamp(this->industry->construction_date - DAYS_TILL_ORIGINAL_BASE_YEAR, 0, 65535); // Date when built since 1920 (in days)
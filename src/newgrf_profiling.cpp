@@ -15,6 +15,7 @@
 #include "spritecache.h"
 
 #include <chrono>
+#include <algorithm>
 #include <time.h>
 
 
@@ -27,7 +28,7 @@ Date _newgrf_profile_end_date;
  * @param grffile   The GRF file to collect profiling data on
  * @param end_date  Game date to end profiling on
  */
-NewGRFProfiler::NewGRFProfiler(const GRFFile *grffile) : grffile{ grffile }, active{ false }, cur_call{}
+NewGRFProfiler::NewGRFProfiler(const GRFFile *grffile) : grffile{ grffile }, active{ false }, aggregate{ false }, cur_call{}
 {
 }
 
@@ -72,7 +73,15 @@ void NewGRFProfiler::EndResolve(const SpriteGroup *result)
 		this->cur_call.result = result->nfo_line;
 	}
 
-	this->calls.push_back(this->cur_call);
+	if (this->aggregate) {
+		Aggregate &total = this->aggregates[{ this->cur_call.root_sprite, this->cur_call.feat, this->cur_call.cb }];
+		total.calls++;
+		total.subs += this->cur_call.subs;
+		total.time += this->cur_call.time;
+		total.max_time = max(total.max_time, this->cur_call.time);
+	} else {
+		this->calls.push_back(this->cur_call);
+	}
 }
 
 /**
@@ -83,10 +92,15 @@ void NewGRFProfiler::RecursiveResolve()
 	this->cur_call.subs += 1;
 }
 
-void NewGRFProfiler::Start()
+/**
+ * Begin collecting data.
+ * @param aggregate Whether to only keep totals per sprite group, instead of every call.
+ */
+void NewGRFProfiler::Start(bool aggregate)
 {
 	this->Abort();
 	this->active = true;
+	this->aggregate = aggregate;
 	this->start_tick = _tick_counter;
 }
 
@@ -94,6 +108,17 @@ uint32 NewGRFProfiler::Finish()
 {
 	if (!this->active) return 0;
 
+	if (this->aggregate) {
+		uint64 total_microseconds = 0;
+		for (const auto &it : this->aggregates) total_microseconds += it.second.time;
+
+		IConsolePrintF(CC_DEBUG, "Finished aggregated profile of NewGRF [%08X]", BSWAP32(this->grffile->grfid));
+		this->PrintAggregates(UINT_MAX);
+		this->Abort();
+
+		return (uint32)total_microseconds;
+	}
+
 	if (this->calls.empty()) {
 		IConsolePrintF(CC_DEBUG, "Finished profile of NewGRF [%08X], no events collected, not writing a file", BSWAP32(this->grffile->grfid));
 		return 0;
@@ -122,6 +147,34 @@ void NewGRFProfiler::Abort()
 {
 	this->active = false;
 	this->calls.clear();
+	this->aggregates.clear();
+}
+
+/**
+ * Print the sprite groups that took the most time in an aggregated profile to the console.
+ * @param count Maximum number of sprite groups to print.
+ */
+void NewGRFProfiler::PrintAggregates(uint count) const
+{
+	std::vector<std::pair<AggregateKey, Aggregate>> sorted(this->aggregates.begin(), this->aggregates.end());
+	std::sort(sorted.begin(), sorted.end(), [](const std::pair<AggregateKey, Aggregate> &a, const std::pair<AggregateKey, Aggregate> &b) { return a.second.time > b.second.time; });
+
+	uint64 total_microseconds = 0;
+	uint64 total_calls = 0;
+	for (const auto &it : sorted) {
+		total_microseconds += it.second.time;
+		total_calls += it.second.calls;
+	}
+	IConsolePrintF(CC_DEBUG, "NewGRF [%08X]: " OTTD_PRINTF64 " calls, " OTTD_PRINTF64 " microseconds over %d ticks, %u sprite groups",
+			BSWAP32(this->grffile->grfid), (int64)total_calls, (int64)total_microseconds, (uint16)(_tick_counter - this->start_tick), (uint)sorted.size());
+
+	for (const auto &it : sorted) {
+		if (count-- == 0) break;
+		const AggregateKey &key = it.first;
+		const Aggregate &total = it.second;
+		IConsolePrintF(CC_DEBUG, "  sprite %u, feature 0x%X, callback 0x%X: %u calls, " OTTD_PRINTF64 " us total, %.1f us avg, %u us max, %.1f subcalls avg",
+				key.root_sprite, key.feat, (uint)key.cb, total.calls, (int64)total.time, (double)total.time / total.calls, total.max_time, (double)total.subs / total.calls);
+	}
 }
 
 /**
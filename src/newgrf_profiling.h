@@ -19,6 +19,8 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <map>
+#include <tuple>
 
 /**
  * Callback profiler for NewGRF development
@@ -31,10 +33,11 @@ struct NewGRFProfiler {
 	void EndResolve(const SpriteGroup *result);
 	void RecursiveResolve();
 
-	void Start();
+	void Start(bool aggregate = false);
 	uint32 Finish();
 	void Abort();
 	std::string GetOutputFilename() const;
+	void PrintAggregates(uint count) const;
 
 	static uint32 FinishAll();
 
@@ -50,11 +53,33 @@ struct NewGRFProfiler {
 		GrfSpecFeature feat; ///< GRF feature being resolved for
 	};
 
+	/** What the measurements of an aggregated profile are collected by */
+	struct AggregateKey {
+		uint32 root_sprite;  ///< Pseudo-sprite index in GRF file
+		GrfSpecFeature feat; ///< GRF feature being resolved for
+		CallbackID cb;       ///< Callback ID
+
+		bool operator<(const AggregateKey &other) const
+		{
+			return std::tie(this->root_sprite, this->feat, this->cb) < std::tie(other.root_sprite, other.feat, other.cb);
+		}
+	};
+
+	/** Totals of the measurements of the sprite group resolutions with the same key */
+	struct Aggregate {
+		uint32 calls;    ///< Number of resolutions
+		uint64 subs;     ///< Total sub-calls to other sprite groups
+		uint64 time;     ///< Total time taken for the resolutions (microseconds)
+		uint32 max_time; ///< Longest time taken for a resolution (microseconds)
+	};
+
 	const GRFFile *grffile;  ///< Which GRF is being profiled
 	bool active;             ///< Is this profiler collecting data
+	bool aggregate;          ///< Are the calls summed per sprite group instead of collected one by one
 	uint16 start_tick;       ///< Tick number this profiler was started on
 	Call cur_call;           ///< Data for current call in progress
 	std::vector<Call> calls; ///< All calls collected so far
+	std::map<AggregateKey, Aggregate> aggregates; ///< Totals of the calls collected so far, when aggregating
 };
 
 extern std::vector<NewGRFProfiler> _newgrf_profilers;
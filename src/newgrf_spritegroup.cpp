@@ -12,6 +12,7 @@
 #include "debug.h"
 #include "newgrf_spritegroup.h"
 #include "newgrf_profiling.h"
+#include "date_func.h"
 #include "core/pool_func.hpp"
 
 #include "safeguards.h"
@@ -19,8 +20,20 @@
 SpriteGroupPool _spritegroup_pool("SpriteGroup");
 INSTANTIATE_POOL_METHODS(SpriteGroup)
 
+/**
+ * Get the size of the slots the sprite groups are allocated in, which fit all types of sprite groups.
+ * @return The size of the biggest type of sprite group.
+ */
+/* static */ size_t SpriteGroup::GetPoolSlotSize()
+{
+	return std::max({ sizeof(RealSpriteGroup), sizeof(DeterministicSpriteGroup), sizeof(RandomizedSpriteGroup), sizeof(CallbackResultSpriteGroup),
+			sizeof(ResultSpriteGroup), sizeof(TileLayoutSpriteGroup), sizeof(IndustryProductionSpriteGroup) });
+}
+
 TemporaryStorageArray<int32, 0x110> _temp_store;
 
+static uint64 _last_resolution = 0; ///< Number of the last started resolution of a sprite group chain.
+
 
 /**
  * ResolverObject (re)entry point.
@@ -35,6 +48,7 @@ TemporaryStorageArray<int32, 0x110> _temp_store;
 /* static */ const SpriteGroup *SpriteGroup::Resolve(const SpriteGroup *group, ResolverObject &object, bool top_level)
 {
 	if (group == nullptr) return nullptr;
+	if (top_level) object.resolution = ++_last_resolution;
 
 	const GRFFile *grf = object.grffile;
 	auto profiler = std::find_if(_newgrf_profilers.begin(), _newgrf_profilers.end(), [&](const NewGRFProfiler &pr) { return pr.grffile == grf; });
@@ -64,6 +78,7 @@ DeterministicSpriteGroup::~DeterministicSpriteGroup()
 {
 	free(this->adjusts);
 	free(this->ranges);
+	free(this->range_table);
 }
 
 RandomizedSpriteGroup::~RandomizedSpriteGroup()
@@ -198,6 +213,278 @@ static U EvalAdjustT(const DeterministicSpriteGroupAdjust *adjust, ScopeResolver
 	}
 }
 
+/**
+ * Evaluate an adjustment for a variable.
+ * @param size Size of the variables of the group.
+ * @param adjust The adjustment.
+ * @param scope The scope to store persistent values in.
+ * @param last_value Result of the previous adjustment.
+ * @param value Value of the variable of the adjustment.
+ * @return The result of the adjustment.
+ */
+static uint32 EvalAdjust(DeterministicSpriteGroupSize size, const DeterministicSpriteGroupAdjust *adjust, ScopeResolver *scope, uint32 last_value, uint32 value)
+{
+	switch (size) {
+		case DSG_SIZE_BYTE:  return EvalAdjustT<uint8,  int8> (adjust, scope, last_value, value);
+		case DSG_SIZE_WORD:  return EvalAdjustT<uint16, int16>(adjust, scope, last_value, value);
+		case DSG_SIZE_DWORD: return EvalAdjustT<uint32, int32>(adjust, scope, last_value, value);
+		default: NOT_REACHED();
+	}
+}
+
+/**
+ * Check whether an adjustment uses a constant value and can be evaluated when loading the NewGRF.
+ * @param adjust The adjustment.
+ * @return True iff the adjustment always has the same result for the same previous result.
+ */
+static bool IsConstantAdjust(const DeterministicSpriteGroupAdjust &adjust)
+{
+	/* Variable 1A is always -1. Signed divisions and the div/mod types are left alone, so a division by zero in a NewGRF does not crash while loading it. */
+	if (adjust.variable != 0x1A || adjust.type != DSGA_TYPE_NONE) return false;
+
+	switch (adjust.operation) {
+		case DSGA_OP_SDIV:
+		case DSGA_OP_SMOD:
+		case DSGA_OP_STO:
+		case DSGA_OP_STOP:
+			return false;
+
+		default:
+			return true;
+	}
+}
+
+/**
+ * Check whether a constant adjustment leaves the previous result unchanged.
+ * @param size Size of the variables of the group.
+ * @param adjust The constant adjustment.
+ * @return True iff the adjustment does not change the result.
+ */
+static bool IsIdentityAdjust(DeterministicSpriteGroupSize size, const DeterministicSpriteGroupAdjust &adjust)
+{
+	static const uint32 masks[] = { 0xFF, 0xFFFF, 0xFFFFFFFF };
+	uint32 value = (UINT32_MAX >> adjust.shift_num) & adjust.and_mask & masks[size];
+
+	switch (adjust.operation) {
+		case DSGA_OP_ADD:
+		case DSGA_OP_SUB:
+		case DSGA_OP_UMAX:
+		case DSGA_OP_OR:
+		case DSGA_OP_XOR:
+		case DSGA_OP_ROR:
+		case DSGA_OP_SHL:
+		case DSGA_OP_SHR:
+		case DSGA_OP_SAR:
+			return value == 0;
+
+		case DSGA_OP_UMIN:
+		case DSGA_OP_AND:
+			return value == masks[size];
+
+		case DSGA_OP_UDIV:
+		case DSGA_OP_MUL:
+			return value == 1;
+
+		default:
+			return false;
+	}
+}
+
+/**
+ * Check whether resolving a group changes no state, so its result does not change during a resolution.
+ * @param group The group, may be \c nullptr.
+ * @return True iff the group and everything it refers to have no side effects.
+ */
+static bool IsSideEffectFree(const SpriteGroup *group)
+{
+	if (group == nullptr) return true;
+
+	switch (group->type) {
+		case SGT_DETERMINISTIC: return static_cast<const DeterministicSpriteGroup *>(group)->side_effect_free;
+		case SGT_RANDOMIZED: return false; // Triggers change what is rerandomised.
+		default: return true;
+	}
+}
+
+/**
+ * Check whether a variable only depends on global state that does not change during a game tick.
+ * The callback and its parameters are part of the key of the callback cache, so they qualify as well.
+ * @param variable The variable.
+ * @return True iff reading the variable again in the same tick yields the same value.
+ */
+static bool IsTickInvariantVariable(byte variable)
+{
+	switch (variable) {
+		case 0x00: case 0x01: case 0x02: case 0x03: // Date and climate.
+		case 0x06: case 0x09: case 0x0A: case 0x0B: // Road side, date fraction, animation counter and TTDPatch version.
+		case 0x0C: case 0x10: case 0x11: case 0x12: // Callback, its first parameter, rail tool and game mode.
+		case 0x18: case 0x1A: case 0x1B: case 0x1D: // Second callback parameter and constants.
+		case 0x20: case 0x21: case 0x22: case 0x23: // Snow line, OpenTTD version, difficulty and long date.
+		case 0x24: case 0x7F:                       // Long year and NewGRF parameters.
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+/**
+ * Check whether resolving a group only reads global state that does not change during a game tick.
+ * @param group The group, may be \c nullptr.
+ * @return True iff the result of the group is the same throughout a tick.
+ */
+static bool IsTickInvariant(const SpriteGroup *group)
+{
+	if (group == nullptr) return true;
+
+	switch (group->type) {
+		case SGT_DETERMINISTIC: return static_cast<const DeterministicSpriteGroup *>(group)->tick_invariant;
+		case SGT_RANDOMIZED: return false; // Random bits belong to the resolved object.
+		case SGT_REAL: return false; // The feature chooses from the sets depending on the resolved object.
+		default: return true;
+	}
+}
+
+/**
+ * Check whether a variable has the same value whenever a chain is resolved for the same
+ * callback, no matter for which object or when. The temporary storage and the result of
+ * the previous group are included, as they only depend on what the chain did before.
+ * @param variable The variable.
+ * @return True iff the value only depends on the chain and the callback.
+ */
+static bool IsObjectInvariantVariable(byte variable)
+{
+	switch (variable) {
+		case 0x0B: case 0x0C: case 0x10: case 0x18: // TTDPatch version, callback and its parameters.
+		case 0x1A: case 0x1B: case 0x1C: case 0x1D: // Constants and the result of the previous group.
+		case 0x21: case 0x7D: case 0x7F:            // OpenTTD version, temporary storage and NewGRF parameters.
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+/**
+ * Check whether resolving a group only depends on the callback and the few properties of the
+ * resolved object that the feature itself uses to choose between groups: the random bits of
+ * the object itself for #RandomizedSpriteGroup and whatever the feature looks at in
+ * #ResolverObject::ResolveReal. Features can cache such results for as long as those don't change.
+ * @param group The group, may be \c nullptr.
+ * @return True iff no variables of the object, of related objects or of the game are read.
+ */
+bool IsObjectInvariant(const SpriteGroup *group)
+{
+	if (group == nullptr) return true;
+
+	switch (group->type) {
+		case SGT_DETERMINISTIC: return static_cast<const DeterministicSpriteGroup *>(group)->object_invariant;
+
+		case SGT_RANDOMIZED: {
+			const RandomizedSpriteGroup *rsg = static_cast<const RandomizedSpriteGroup *>(group);
+			if (rsg->var_scope != VSG_SCOPE_SELF) return false;
+			for (uint i = 0; i < rsg->num_groups; i++) {
+				if (!IsObjectInvariant(rsg->groups[i])) return false;
+			}
+			return true;
+		}
+
+		default: return true;
+	}
+}
+
+/**
+ * Simplify a just loaded group, so resolving it is cheaper.
+ * The leading adjustments with constant values are evaluated once here, and
+ * further constant adjustments that do not change the result are removed.
+ * Ranges that span few values get a table to look up the group directly.
+ * Finally the group is marked as cacheable when the result of its adjustments
+ * can be reused when it is resolved again in the same resolution, as happens
+ * with procedures that are called from several places.
+ * @pre The adjustments, ranges and groups it refers to are loaded.
+ */
+void DeterministicSpriteGroup::Optimise()
+{
+	uint folded = 0;
+	uint32 last_value = 0;
+	while (folded < this->num_adjusts && IsConstantAdjust(this->adjusts[folded])) {
+		last_value = EvalAdjust(this->size, &this->adjusts[folded], nullptr, last_value, UINT32_MAX);
+		folded++;
+	}
+	if (folded > 0) {
+		/* Replace them by a single addition of their result to the initial zero. */
+		DeterministicSpriteGroupAdjust &adjust = this->adjusts[0];
+		adjust.operation = DSGA_OP_ADD;
+		adjust.type = DSGA_TYPE_NONE;
+		adjust.shift_num = 0;
+		adjust.and_mask = last_value;
+		adjust.add_val = 0;
+		adjust.divmod_val = 0;
+		MemMoveT(this->adjusts + 1, this->adjusts + folded, this->num_adjusts - folded);
+		this->num_adjusts -= folded - 1;
+	}
+
+	uint used = 1;
+	for (uint i = 1; i < this->num_adjusts; i++) {
+		const DeterministicSpriteGroupAdjust &adjust = this->adjusts[i];
+		if (IsConstantAdjust(adjust) && IsIdentityAdjust(this->size, adjust)) continue;
+		this->adjusts[used++] = adjust;
+	}
+	this->num_adjusts = used;
+
+	static const uint32 MAX_RANGE_TABLE_SIZE = 256;
+	if (this->num_ranges > 4 && this->ranges[this->num_ranges - 1].high - this->ranges[0].low < MAX_RANGE_TABLE_SIZE) {
+		this->range_table_low = this->ranges[0].low;
+		this->range_table_size = this->ranges[this->num_ranges - 1].high - this->range_table_low + 1;
+		this->range_table = MallocT<const SpriteGroup *>(this->range_table_size);
+		for (uint i = 0; i < this->range_table_size; i++) this->range_table[i] = this->default_group;
+		for (uint i = 0; i < this->num_ranges; i++) {
+			for (uint j = this->ranges[i].low - this->range_table_low; j <= this->ranges[i].high - this->range_table_low; j++) this->range_table[j] = this->ranges[i].group;
+		}
+	}
+
+	this->cacheable = true;
+	for (uint i = 0; i < this->num_adjusts; i++) {
+		const DeterministicSpriteGroupAdjust &adjust = this->adjusts[i];
+		switch (adjust.variable) {
+			case 0x1C: // Result of the previous group in the chain.
+			case 0x7B: // Indirect access of any of the variables.
+			case 0x7C: // Persistent storage.
+			case 0x7D: // Temporary storage.
+				this->cacheable = false;
+				break;
+
+			case 0x7E:
+				if (!IsSideEffectFree(adjust.subroutine)) this->cacheable = false;
+				break;
+		}
+		if (adjust.operation == DSGA_OP_STO || adjust.operation == DSGA_OP_STOP) this->cacheable = false;
+	}
+
+	this->side_effect_free = this->cacheable && IsSideEffectFree(this->default_group) && IsSideEffectFree(this->error_group);
+	for (uint i = 0; i < this->num_ranges; i++) {
+		if (!IsSideEffectFree(this->ranges[i].group)) this->side_effect_free = false;
+	}
+
+	this->tick_invariant = this->side_effect_free && IsTickInvariant(this->default_group) && IsTickInvariant(this->error_group);
+	for (uint i = 0; i < this->num_adjusts; i++) {
+		const DeterministicSpriteGroupAdjust &adjust = this->adjusts[i];
+		if (adjust.variable == 0x7E ? !IsTickInvariant(adjust.subroutine) : !IsTickInvariantVariable(adjust.variable)) this->tick_invariant = false;
+	}
+	for (uint i = 0; i < this->num_ranges; i++) {
+		if (!IsTickInvariant(this->ranges[i].group)) this->tick_invariant = false;
+	}
+
+	this->object_invariant = IsObjectInvariant(this->default_group) && IsObjectInvariant(this->error_group);
+	for (uint i = 0; i < this->num_adjusts; i++) {
+		const DeterministicSpriteGroupAdjust &adjust = this->adjusts[i];
+		if (adjust.variable == 0x7E ? !IsObjectInvariant(adjust.subroutine) : !IsObjectInvariantVariable(adjust.variable)) this->object_invariant = false;
+		if (adjust.operation == DSGA_OP_STOP) this->object_invariant = false;
+	}
+	for (uint i = 0; i < this->num_ranges; i++) {
+		if (!IsObjectInvariant(this->ranges[i].group)) this->object_invariant = false;
+	}
+}
 
 static bool RangeHighComparator(const DeterministicSpriteGroupRange& range, uint32 value)
 {
@@ -210,41 +497,46 @@ const SpriteGroup *DeterministicSpriteGroup::Resolve(ResolverObject &object) con
 	uint32 value = 0;
 	uint i;
 
-	ScopeResolver *scope = object.GetScope(this->var_scope);
-
-	for (i = 0; i < this->num_adjusts; i++) {
-		DeterministicSpriteGroupAdjust *adjust = &this->adjusts[i];
-
-		/* Try to get the variable. We shall assume it is available, unless told otherwise. */
-		bool available = true;
-		if (adjust->variable == 0x7E) {
-			const SpriteGroup *subgroup = SpriteGroup::Resolve(adjust->subroutine, object, false);
-			if (subgroup == nullptr) {
-				value = CALLBACK_FAILED;
+	if (this->cacheable && this->cached_resolution == object.resolution) {
+		/* Nothing it depends on changed since it was resolved before. */
+		value = last_value = this->cached_value;
+	} else {
+		ScopeResolver *scope = object.GetScope(this->var_scope);
+
+		for (i = 0; i < this->num_adjusts; i++) {
+			DeterministicSpriteGroupAdjust *adjust = &this->adjusts[i];
+
+			/* Try to get the variable. We shall assume it is available, unless told otherwise. */
+			bool available = true;
+			if (adjust->variable == 0x7E) {
+				const SpriteGroup *subgroup = SpriteGroup::Resolve(adjust->subroutine, object, false);
+				if (subgroup == nullptr) {
+					value = CALLBACK_FAILED;
+				} else {
+					value = subgroup->GetCallbackResult();
+				}
+
+				/* Note: 'last_value' and 'reseed' are shared between the main chain and the procedure */
+			} else if (adjust->variable == 0x7B) {
+				value = GetVariable(object, scope, adjust->parameter, last_value, &available);
 			} else {
-				value = subgroup->GetCallbackResult();
+				value = GetVariable(object, scope, adjust->variable, adjust->parameter, &available);
 			}
 
-			/* Note: 'last_value' and 'reseed' are shared between the main chain and the procedure */
-		} else if (adjust->variable == 0x7B) {
-			value = GetVariable(object, scope, adjust->parameter, last_value, &available);
-		} else {
-			value = GetVariable(object, scope, adjust->variable, adjust->parameter, &available);
-		}
+			if (!available) {
+				/* Unsupported variable: skip further processing and return either
+				 * the group from the first range or the default group. */
+				return SpriteGroup::Resolve(this->error_group, object, false);
+			}
 
-		if (!available) {
-			/* Unsupported variable: skip further processing and return either
-			 * the group from the first range or the default group. */
-			return SpriteGroup::Resolve(this->error_group, object, false);
+			value = EvalAdjust(this->size, adjust, scope, last_value, value);
+			last_value = value;
 		}
 
-		switch (this->size) {
-			case DSG_SIZE_BYTE:  value = EvalAdjustT<uint8,  int8> (adjust, scope, last_value, value); break;
-			case DSG_SIZE_WORD:  value = EvalAdjustT<uint16, int16>(adjust, scope, last_value, value); break;
-			case DSG_SIZE_DWORD: value = EvalAdjustT<uint32, int32>(adjust, scope, last_value, value); break;
-			default: NOT_REACHED();
+		if (this->cacheable) {
+			this->cached_resolution = object.resolution;
+			this->cached_value = value;
 		}
-		last_value = value;
 	}
 
 	object.last_value = last_value;
@@ -257,6 +549,11 @@ const SpriteGroup *DeterministicSpriteGroup::Resolve(ResolverObject &object) con
 		return &nvarzero;
 	}
 
+	if (this->range_table != nullptr) {
+		uint32 index = value - this->range_table_low;
+		return SpriteGroup::Resolve(index < this->range_table_size ? this->range_table[index] : this->default_group, object, false);
+	}
+
 	if (this->num_ranges > 4) {
 		DeterministicSpriteGroupRange *lower = std::lower_bound(this->ranges + 0, this->ranges + this->num_ranges, value, RangeHighComparator);
 		if (lower != this->ranges + this->num_ranges && lower->low <= value) {
@@ -275,6 +572,78 @@ const SpriteGroup *DeterministicSpriteGroup::Resolve(ResolverObject &object) con
 }
 
 
+/** Result of a callback that only depends on global state, see #DeterministicSpriteGroup::tick_invariant. */
+struct CallbackCacheEntry {
+	const SpriteGroup *group; ///< Root group of the resolution.
+	const GRFFile *grffile;   ///< NewGRF of the resolution, for its parameters.
+	CallbackID callback;      ///< Resolved callback.
+	uint32 callback_param1;   ///< First parameter of the callback.
+	uint32 callback_param2;   ///< Second parameter of the callback.
+	uint64 generation;        ///< Value of #_callback_cache_generation when the result was stored.
+	Date date;                ///< Date when the result was stored.
+	DateFract date_fract;     ///< Date fraction when the result was stored.
+	uint16 tick_counter;      ///< Tick counter when the result was stored.
+	Year year;                ///< Year when the result was stored.
+	uint16 result;            ///< The callback result.
+};
+
+static const uint CALLBACK_CACHE_SIZE = 1024; ///< Number of entries in #_callback_cache, a power of two.
+static CallbackCacheEntry _callback_cache[CALLBACK_CACHE_SIZE]; ///< Results of callbacks that only depend on global state.
+static uint64 _callback_cache_generation = 1; ///< Entries of #_callback_cache for any other generation are invalid.
+
+/**
+ * Forget the cached results of callbacks, because the global state they
+ * depend on might have changed other than by passing time, e.g. by a
+ * command changing a setting or by reloading the NewGRFs.
+ */
+void InvalidateNewGRFCallbackCache()
+{
+	_callback_cache_generation++;
+}
+
+/**
+ * Resolve callback.
+ * The results of callbacks whose chain is #DeterministicSpriteGroup::tick_invariant
+ * are cached, so the GUI, pathfinders and vehicle controllers asking the same in
+ * a tick only resolve the chain once.
+ * @return Callback result.
+ */
+uint16 ResolverObject::ResolveCallback()
+{
+	bool cacheable = this->root_spritegroup != nullptr && IsTickInvariant(this->root_spritegroup) &&
+			std::none_of(_newgrf_profilers.begin(), _newgrf_profilers.end(), [](const NewGRFProfiler &pr) { return pr.active; });
+
+	if (!cacheable) {
+		const SpriteGroup *result = Resolve();
+		return result != nullptr ? result->GetCallbackResult() : CALLBACK_FAILED;
+	}
+
+	size_t hash = (size_t)this->root_spritegroup->index * 0x9E3779B1u ^ this->callback ^ this->callback_param1 * 0x85EBCA6Bu ^ this->callback_param2 * 0xC2B2AE35u;
+	CallbackCacheEntry &entry = _callback_cache[(hash ^ (hash >> 16)) & (CALLBACK_CACHE_SIZE - 1)];
+	if (entry.generation == _callback_cache_generation && entry.group == this->root_spritegroup && entry.grffile == this->grffile &&
+			entry.callback == this->callback && entry.callback_param1 == this->callback_param1 && entry.callback_param2 == this->callback_param2 &&
+			entry.date == _date && entry.date_fract == _date_fract && entry.tick_counter == _tick_counter && entry.year == _cur_year) {
+		/* A resolution starts with clearing the temporary storage, which the chain would not have written to. */
+		_temp_store.ClearChanges();
+		return entry.result;
+	}
+
+	const SpriteGroup *result = Resolve();
+	entry.group = this->root_spritegroup;
+	entry.grffile = this->grffile;
+	entry.callback = this->callback;
+	entry.callback_param1 = this->callback_param1;
+	entry.callback_param2 = this->callback_param2;
+	entry.generation = _callback_cache_generation;
+	entry.date = _date;
+	entry.date_fract = _date_fract;
+	entry.tick_counter = _tick_counter;
+	entry.year = _cur_year;
+	entry.result = result != nullptr ? result->GetCallbackResult() : CALLBACK_FAILED;
+	return entry.result;
+}
+
+
 const SpriteGroup *RandomizedSpriteGroup::Resolve(ResolverObject &object) const
 {
 	ScopeResolver *scope = object.GetScope(this->var_scope, this->count);
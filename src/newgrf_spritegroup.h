@@ -71,6 +71,7 @@ public:
 	virtual uint16 GetCallbackResult() const { return CALLBACK_FAILED; }
 
 	static const SpriteGroup *Resolve(const SpriteGroup *group, ResolverObject &object, bool top_level = true);
+	static size_t GetPoolSlotSize();
 };
 
 
@@ -176,14 +177,27 @@ struct DeterministicSpriteGroup : SpriteGroup {
 	uint num_adjusts;
 	uint num_ranges;
 	bool calculated_result;
+	bool cacheable;        ///< The result of the adjusts only depends on the resolved object, so it does not change during a resolution.
+	bool side_effect_free; ///< Resolving this group and the groups it refers to changes no state.
+	bool tick_invariant;   ///< Resolving this group and the groups it refers to only reads global state that does not change during a game tick.
+	bool object_invariant; ///< Resolving this group and the groups it refers to reads no variables of the resolved object or of the game; see #IsObjectInvariant.
 	DeterministicSpriteGroupAdjust *adjusts;
 	DeterministicSpriteGroupRange *ranges; // Dynamically allocated
 
+	const SpriteGroup **range_table; ///< Dynamically allocated group for every value from #range_table_low on, or \c nullptr to search the ranges.
+	uint32 range_table_low;          ///< Value of the first entry of #range_table.
+	uint range_table_size;           ///< Number of entries in #range_table.
+
 	/* Dynamically allocated, this is the sole owner */
 	const SpriteGroup *default_group;
 
 	const SpriteGroup *error_group; // was first range, before sorting ranges
 
+	mutable uint64 cached_resolution; ///< Resolution in which #cached_value was calculated, when #cacheable.
+	mutable uint32 cached_value;      ///< Result of the adjusts in that resolution.
+
+	void Optimise();
+
 protected:
 	const SpriteGroup *Resolve(ResolverObject &object) const;
 };
@@ -321,7 +335,7 @@ struct ResolverObject {
 	 * @param callback_param2 Second parameter (var 18) of the callback (only used when \a callback is also set).
 	 */
 	ResolverObject(const GRFFile *grffile, CallbackID callback = CBID_NO_CALLBACK, uint32 callback_param1 = 0, uint32 callback_param2 = 0)
-		: default_scope(*this), callback(callback), callback_param1(callback_param1), callback_param2(callback_param2), grffile(grffile), root_spritegroup(nullptr)
+		: default_scope(*this), callback(callback), callback_param1(callback_param1), callback_param2(callback_param2), grffile(grffile), root_spritegroup(nullptr), resolution(0)
 	{
 		this->ResetState();
 	}
@@ -342,6 +356,7 @@ struct ResolverObject {
 
 	const GRFFile *grffile;     ///< GRFFile the resolved SpriteGroup belongs to
 	const SpriteGroup *root_spritegroup; ///< Root SpriteGroup to use for resolving
+	uint64 resolution;          ///< Number of the current resolution, to know which cached results of #DeterministicSpriteGroup are valid.
 
 	/**
 	 * Resolve SpriteGroup.
@@ -352,15 +367,7 @@ struct ResolverObject {
 		return SpriteGroup::Resolve(this->root_spritegroup, *this);
 	}
 
-	/**
-	 * Resolve callback.
-	 * @return Callback result.
-	 */
-	uint16 ResolveCallback()
-	{
-		const SpriteGroup *result = Resolve();
-		return result != nullptr ? result->GetCallbackResult() : CALLBACK_FAILED;
-	}
+	uint16 ResolveCallback();
 
 	virtual const SpriteGroup *ResolveReal(const RealSpriteGroup *group) const;
 
@@ -413,4 +420,7 @@ struct ResolverObject {
 	virtual uint32 GetDebugID() const { return 0; }
 };
 
+void InvalidateNewGRFCallbackCache();
+bool IsObjectInvariant(const SpriteGroup *group);
+
 #endif /* NEWGRF_SPRITEGROUP_H */
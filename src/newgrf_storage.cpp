@@ -12,15 +12,16 @@
 #include "core/pool_func.hpp"
 #include "core/endian_func.hpp"
 #include "debug.h"
-#include <set>
+#include <algorithm>
+#include <vector>
 
 #include "safeguards.h"
 
 PersistentStoragePool _persistent_storage_pool("PersistentStorage");
 INSTANTIATE_POOL_METHODS(PersistentStorage)
 
-/** The changed storage arrays */
-static std::set<BasePersistentStorageArray*> *_changed_storage_arrays = new std::set<BasePersistentStorageArray*>;
+/** The changed storage arrays; each is only added on its first temporary change. */
+static std::vector<BasePersistentStorageArray*> *_changed_storage_arrays = new std::vector<BasePersistentStorageArray*>;
 
 bool BasePersistentStorageArray::gameloop;
 bool BasePersistentStorageArray::command;
@@ -31,7 +32,8 @@ bool BasePersistentStorageArray::testmode;
  */
 BasePersistentStorageArray::~BasePersistentStorageArray()
 {
-	_changed_storage_arrays->erase(this);
+	auto it = std::find(_changed_storage_arrays->begin(), _changed_storage_arrays->end(), this);
+	if (it != _changed_storage_arrays->end()) _changed_storage_arrays->erase(it);
 }
 
 /**
@@ -42,7 +44,7 @@ BasePersistentStorageArray::~BasePersistentStorageArray()
  */
 void AddChangedPersistentStorage(BasePersistentStorageArray *storage)
 {
-	_changed_storage_arrays->insert(storage);
+	_changed_storage_arrays->push_back(storage);
 }
 
 /**
@@ -91,7 +93,7 @@ void AddChangedPersistentStorage(BasePersistentStorageArray *storage)
 	}
 
 	/* Discard all temporary changes */
-	for (std::set<BasePersistentStorageArray*>::iterator it = _changed_storage_arrays->begin(); it != _changed_storage_arrays->end(); it++) {
+	for (std::vector<BasePersistentStorageArray*>::iterator it = _changed_storage_arrays->begin(); it != _changed_storage_arrays->end(); it++) {
 		DEBUG(desync, 1, "Discarding persistent storage changes: Feature %d, GrfID %08X, Tile %d", (*it)->feature, BSWAP32((*it)->grfid), (*it)->tile);
 		(*it)->ClearChanges();
 	}
@@ -12,6 +12,7 @@
 
 #include "core/pool_type.hpp"
 #include "tile_type.h"
+#include <vector>
 
 /**
  * Mode switches to the behaviour of persistent storage array.
@@ -65,20 +66,14 @@ private:
 template <typename TYPE, uint SIZE>
 struct PersistentStorageArray : BasePersistentStorageArray {
 	TYPE storage[SIZE]; ///< Memory to for the storage array
-	TYPE *prev_storage; ///< Memory to store "old" states so we can revert them on the performance of test cases for commands etc.
+	std::vector<std::pair<uint16, TYPE>> journal; ///< Positions and "old" values of temporary changes, so we can revert them on the performance of test cases for commands etc.
 
 	/** Simply construct the array */
-	PersistentStorageArray() : prev_storage(nullptr)
+	PersistentStorageArray()
 	{
 		memset(this->storage, 0, sizeof(this->storage));
 	}
 
-	/** And free all data related to it */
-	~PersistentStorageArray()
-	{
-		free(this->prev_storage);
-	}
-
 	/** Resets all values to zero. */
 	void ResetToZero()
 	{
@@ -87,7 +82,7 @@ struct PersistentStorageArray : BasePersistentStorageArray {
 
 	/**
 	 * Stores some value at a given position.
-	 * If there is no backup of the data that backup is made and then
+	 * When the change is temporary the old value is journaled and then
 	 * we write the data.
 	 * @param pos   the position to write at
 	 * @param value the value to write
@@ -101,16 +96,15 @@ struct PersistentStorageArray : BasePersistentStorageArray {
 		 * Saves a few cycles and such and it's pretty easy to check. */
 		if (this->storage[pos] == value) return;
 
-		/* We do not have made a backup; lets do so */
 		if (AreChangesPersistent()) {
-			assert(this->prev_storage == nullptr);
-		} else if (this->prev_storage == nullptr) {
-			this->prev_storage = MallocT<TYPE>(SIZE);
-			memcpy(this->prev_storage, this->storage, sizeof(this->storage));
-
-			/* We only need to register ourselves when we made the backup
-			 * as that is the only time something will have changed */
-			AddChangedPersistentStorage(this);
+			assert(this->journal.empty());
+		} else {
+			/* We only need to register ourselves on the first temporary
+			 * change as that is the only time something will have changed */
+			if (this->journal.empty()) AddChangedPersistentStorage(this);
+
+			/* Only remember the touched position instead of backing up the whole array. */
+			this->journal.emplace_back(pos, this->storage[pos]);
 		}
 
 		this->storage[pos] = value;
@@ -131,11 +125,11 @@ struct PersistentStorageArray : BasePersistentStorageArray {
 
 	void ClearChanges()
 	{
-		if (this->prev_storage != nullptr) {
-			memcpy(this->storage, this->prev_storage, sizeof(this->storage));
-			free(this->prev_storage);
-			this->prev_storage = nullptr;
+		/* Revert in reverse order, so every position gets its value from before the first change. */
+		for (auto it = this->journal.rbegin(); it != this->journal.rend(); ++it) {
+			this->storage[it->first] = it->second;
 		}
+		this->journal.clear();
 	}
 };
 
@@ -148,16 +142,17 @@ struct PersistentStorageArray : BasePersistentStorageArray {
  */
 template <typename TYPE, uint SIZE>
 struct TemporaryStorageArray {
-	TYPE storage[SIZE]; ///< Memory to for the storage array
-	uint16 init[SIZE];  ///< Storage has been assigned, if this equals 'init_key'.
-	uint16 init_key;    ///< Magic key to 'init'.
+	static const uint MAX_CHANGES = 32; ///< Number of assignments remembered before #ClearChanges resets the whole array.
+
+	TYPE storage[SIZE];          ///< Memory to for the storage array; unassigned positions are zero.
+	uint16 changes[MAX_CHANGES]; ///< Positions assigned since the last call to #ClearChanges.
+	uint num_changes;            ///< Number of entries in #changes, or more than #MAX_CHANGES if they did not fit.
 
 	/** Simply construct the array */
 	TemporaryStorageArray()
 	{
-		memset(this->storage, 0, sizeof(this->storage)); // not exactly needed, but makes code analysers happy
-		memset(this->init, 0, sizeof(this->init));
-		this->init_key = 1;
+		memset(this->storage, 0, sizeof(this->storage));
+		this->num_changes = 0;
 	}
 
 	/**
@@ -170,8 +165,11 @@ struct TemporaryStorageArray {
 		/* Out of the scope of the array */
 		if (pos >= SIZE) return;
 
+		/* Remember the position, unless the whole array has to be reset anyway. */
+		if (this->num_changes < MAX_CHANGES) this->changes[this->num_changes] = pos;
+		if (this->num_changes <= MAX_CHANGES) this->num_changes++;
+
 		this->storage[pos] = value;
-		this->init[pos] = this->init_key;
 	}
 
 	/**
@@ -184,23 +182,18 @@ struct TemporaryStorageArray {
 		/* Out of the scope of the array */
 		if (pos >= SIZE) return 0;
 
-		if (this->init[pos] != this->init_key) {
-			/* Unassigned since last call to ClearChanges */
-			return 0;
-		}
-
 		return this->storage[pos];
 	}
 
 	void ClearChanges()
 	{
-		/* Increment init_key to invalidate all storage */
-		this->init_key++;
-		if (this->init_key == 0) {
-			/* When init_key wraps around, we need to reset everything */
-			memset(this->init, 0, sizeof(this->init));
-			this->init_key = 1;
+		if (this->num_changes > MAX_CHANGES) {
+			/* Too many assignments to remember; reset everything */
+			memset(this->storage, 0, sizeof(this->storage));
+		} else {
+			for (uint i = 0; i < this->num_changes; i++) this->storage[this->changes[i]] = 0;
 		}
+		this->num_changes = 0;
 	}
 };
 
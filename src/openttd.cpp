@@ -32,6 +32,8 @@
 #include "screenshot.h"
 #include "network/network.h"
 #include "network/network_func.h"
+#include "state_hash.h"
+#include "map_snapshot.h"
 #include "ai/ai.hpp"
 #include "ai/ai_config.hpp"
 #include "settings_func.h"
@@ -64,11 +66,16 @@
 #include "viewport_func.h"
 #include "viewport_sprite_sorter.h"
 #include "framerate_type.h"
+#include "trace_zone.h"
 
 #include "linkgraph/linkgraphschedule.h"
 
 #include <stdarg.h>
 #include <system_error>
+#include <chrono>
+#if defined(UNIX)
+#	include <sys/resource.h>
+#endif
 
 #include "safeguards.h"
 
@@ -79,11 +86,16 @@ void MusicLoop();
 void ResetMusic();
 void CallWindowGameTickEvent();
 bool HandleBootstrap();
+void StateGameLoop();
 
 extern Company *DoStartupNewCompany(bool is_ai, CompanyID company = INVALID_COMPANY);
 extern void ShowOSErrorBox(const char *buf, bool system);
 extern char *_config_file;
 
+static bool _saveload_benchmark = false; ///< Whether to benchmark loading and saving the game of the -B command line option.
+static uint _batch_generate_count = 0;  ///< Number of maps to generate and save for the -w command line option.
+static uint _tick_benchmark_ticks = 0;  ///< Number of game ticks to run for the -T command line option.
+
 /**
  * Error handling for fatal user errors.
  * @param s the string to print.
@@ -179,6 +191,9 @@ static void ShowHelp()
 		"  -c config_file      = Use 'config_file' instead of 'openttd.cfg'\n"
 		"  -x                  = Do not automatically save to config file on exit\n"
 		"  -q savegame         = Write some information about the savegame and exit\n"
+		"  -B savegame         = Measure loading and saving the savegame and exit\n"
+		"  -w count            = Generate and save count maps from the -G seed on and exit\n"
+		"  -T ticks            = Run ticks game ticks of the -g game as fast as possible, report the time spent and exit\n"
 		"\n",
 		lastof(buf)
 	);
@@ -520,6 +535,9 @@ static const OptionData _options[] = {
 	 GETOPT_SHORT_VALUE('c'),
 	 GETOPT_SHORT_NOVAL('x'),
 	 GETOPT_SHORT_VALUE('q'),
+	 GETOPT_SHORT_VALUE('B'),
+	 GETOPT_SHORT_VALUE('w'),
+	 GETOPT_SHORT_VALUE('T'),
 	 GETOPT_SHORT_NOVAL('h'),
 	GETOPT_END()
 };
@@ -664,6 +682,42 @@ int openttd_main(int argc, char *argv[])
 
 			goto exit_noshutdown;
 		}
+		case 'B':
+			/* Load the savegame like -g does; the benchmark runs once it is loaded. */
+			_file_to_saveload.SetName(mgo.opt);
+			_file_to_saveload.SetMode(SLO_LOAD, FT_SAVEGAME, DFT_GAME_FILE);
+			_switch_mode = SM_LOAD_GAME;
+			_saveload_benchmark = true;
+			break;
+		case 'w':
+			/* Generate without any video, sound or music output; the maps are generated and saved once started. */
+			free(musicdriver);
+			free(sounddriver);
+			free(videodriver);
+			free(blitter);
+			musicdriver = stredup("null");
+			sounddriver = stredup("null");
+			videodriver = stredup("null");
+			blitter = stredup("null");
+			_batch_generate_count = max(atoi(mgo.opt), 1);
+			_switch_mode = SM_NEWGAME;
+			if (scanner->generation_seed == GENERATE_NEW_SEED) {
+				scanner->generation_seed = InteractiveRandom();
+			}
+			break;
+		case 'T':
+			/* Run without any video, sound or music output; the ticks run once the game of -g, or a new game, is started. */
+			free(musicdriver);
+			free(sounddriver);
+			free(videodriver);
+			free(blitter);
+			musicdriver = stredup("null");
+			sounddriver = stredup("null");
+			videodriver = stredup("null");
+			blitter = stredup("null");
+			_tick_benchmark_ticks = max(atoi(mgo.opt), 1);
+			if (_switch_mode != SM_LOAD_GAME) _switch_mode = SM_NEWGAME;
+			break;
 		case 'G': scanner->generation_seed = strtoul(mgo.opt, nullptr, 10); break;
 		case 'c': free(_config_file); _config_file = stredup(mgo.opt); break;
 		case 'x': scanner->save_config = false; break;
@@ -701,6 +755,9 @@ int openttd_main(int argc, char *argv[])
 	if (_dedicated_forks) DedicatedFork();
 #endif
 
+	/* Only now, as threads do not survive forking. */
+	StartDebugLogWriter();
+
 	LoadFromConfig(true);
 
 	if (resolution.width != 0) _cur_resolution = resolution;
@@ -897,6 +954,8 @@ exit_normal:
 
 	delete scanner;
 
+	StopDebugLogWriter();
+
 	extern FILE *_log_fd;
 	if (_log_fd != nullptr) {
 		fclose(_log_fd);
@@ -973,6 +1032,103 @@ static void MakeNewGame(bool from_heightmap, bool reset_settings)
 	GenerateWorld(from_heightmap ? GWM_HEIGHTMAP : GWM_NEWGAME, 1 << _settings_game.game_creation.map_x, 1 << _settings_game.game_creation.map_y, reset_settings);
 }
 
+/**
+ * Save the map that was just generated, and generate and save the maps of
+ * the following seeds, reporting the time spent on each of them. This is
+ * the batch generation of the -w command line option. To generate maps in
+ * parallel, run several instances with different seeds.
+ */
+static void RunBatchGenerate()
+{
+	for (uint i = 0; i < _batch_generate_count; i++) {
+		uint32 seed = _settings_newgame.game_creation.generation_seed;
+		if (i != 0) MakeNewGame(false, true);
+
+		char buf[2048];
+		char *p = buf;
+		p += seprintf(p, lastof(buf), "Map %u of %u, seed %u:\n", i + 1, _batch_generate_count, seed);
+
+		if (_game_mode != GM_NORMAL) {
+			/* Generating failed, e.g. because no towns could be placed. */
+			p += seprintf(p, lastof(buf), "  generation failed\n");
+		} else {
+			p = WriteGeneratingWorldTimings(p, lastof(buf));
+
+			char name[MAX_PATH];
+			seprintf(name, lastof(name), "generated_%u.sav", seed);
+			auto start = std::chrono::steady_clock::now();
+			bool saved = SaveOrLoad(name, SLO_SAVE, DFT_GAME_FILE, SAVE_DIR, false) == SL_OK;
+			auto save_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+			p += seprintf(p, lastof(buf), "  %-12s %10.2f ms  %s %s\n", "save", save_time / 1000.0, saved ? "saved as" : "failed to save", name);
+		}
+
+		/* Like the savegame information of -q, this goes to stdout. */
+#if !defined(_WIN32)
+		printf("%s", buf);
+		fflush(stdout);
+#else
+		ShowInfo(buf);
+#endif
+
+		_settings_newgame.game_creation.generation_seed = seed + 1;
+	}
+
+	_exit_game = true;
+}
+
+/**
+ * Get the largest amount of memory the process has had in use.
+ * @return The peak resident set size in bytes, or 0 when it is not known.
+ */
+static uint64 GetPeakMemoryUsage()
+{
+#if defined(UNIX)
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#	if defined(__APPLE__)
+	return usage.ru_maxrss;
+#	else
+	return (uint64)usage.ru_maxrss * 1024;
+#	endif
+#else
+	return 0;
+#endif
+}
+
+/**
+ * Run the game state loop of the game that was just started or loaded as
+ * fast as possible, and report the time spent on each performance element.
+ * This is the tick benchmark of the -T command line option.
+ */
+static void RunTickBenchmark()
+{
+	/* The game might have been saved paused; also measure the detailed elements. */
+	_pause_mode = PM_UNPAUSED;
+	_settings_client.gui.framerate_details = true;
+	ResetPerformanceTotals();
+
+	auto start = std::chrono::steady_clock::now();
+	for (uint i = 0; i < _tick_benchmark_ticks && _game_mode == GM_NORMAL; i++) StateGameLoop();
+	auto time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+	char buf[8192];
+	char *p = buf;
+	p += seprintf(p, lastof(buf), "Ran %u ticks in %.2f ms: %.1f ticks/s\n", _tick_benchmark_ticks, time / 1000.0, time == 0 ? 0.0 : _tick_benchmark_ticks * 1000000.0 / time);
+	p = WritePerformanceTotals(p, lastof(buf), _tick_benchmark_ticks);
+	uint64 peak = GetPeakMemoryUsage();
+	if (peak != 0) p += seprintf(p, lastof(buf), "Peak memory usage: %.1f MiB\n", peak / (1024.0 * 1024.0));
+
+	/* Like the savegame information of -q, this goes to stdout. */
+#if !defined(_WIN32)
+	printf("%s", buf);
+	fflush(stdout);
+#else
+	ShowInfo(buf);
+#endif
+
+	_exit_game = true;
+}
+
 static void MakeNewEditorWorldDone()
 {
 	SetLocalCompany(OWNER_NONE);
@@ -1084,6 +1240,8 @@ void SwitchToMode(SwitchMode new_mode)
 				seprintf(_network_game_info.map_name, lastof(_network_game_info.map_name), "Random Map");
 			}
 			MakeNewGame(false, new_mode == SM_NEWGAME);
+			if (_batch_generate_count != 0) RunBatchGenerate();
+			if (_tick_benchmark_ticks != 0) RunTickBenchmark();
 			break;
 
 		case SM_LOAD_GAME: { // Load game, Play Scenario
@@ -1093,6 +1251,10 @@ void SwitchToMode(SwitchMode new_mode)
 			if (!SafeLoad(_file_to_saveload.name, _file_to_saveload.file_op, _file_to_saveload.detail_ftype, GM_NORMAL, NO_DIRECTORY)) {
 				SetDParamStr(0, GetSaveLoadErrorString());
 				ShowErrorMessage(STR_JUST_RAW_STRING, INVALID_STRING_ID, WL_ERROR);
+				if (_saveload_benchmark || _tick_benchmark_ticks != 0) _exit_game = true;
+			} else if (_saveload_benchmark) {
+				RunSaveLoadBenchmark();
+				_exit_game = true;
 			} else {
 				if (_file_to_saveload.abstract_ftype == FT_SCENARIO) {
 					/* Reset engine pool to simplify changing engine NewGRFs in scenario editor. */
@@ -1108,6 +1270,7 @@ void SwitchToMode(SwitchMode new_mode)
 				if (_network_server) {
 					seprintf(_network_game_info.map_name, lastof(_network_game_info.map_name), "%s (Loaded game)", _file_to_saveload.title);
 				}
+				if (_tick_benchmark_ticks != 0) RunTickBenchmark();
 			}
 			break;
 		}
@@ -1204,18 +1367,25 @@ static void CheckCaches()
 		i++;
 	}
 
-	/* Check company infrastructure cache. */
+	/* Check company infrastructure and assets cache. */
 	std::vector<CompanyInfrastructure> old_infrastructure;
-	for (const Company *c : Company::Iterate()) old_infrastructure.push_back(c->infrastructure);
+	std::vector<CompanyAssets> old_assets;
+	for (const Company *c : Company::Iterate()) {
+		old_infrastructure.push_back(c->infrastructure);
+		old_assets.push_back(c->assets);
+	}
 
-	extern void AfterLoadCompanyStats();
-	AfterLoadCompanyStats();
+	extern void AfterLoadCompanyStats(bool recount_infrastructure);
+	AfterLoadCompanyStats(true);
 
 	i = 0;
 	for (const Company *c : Company::Iterate()) {
 		if (MemCmpT(old_infrastructure.data() + i, &c->infrastructure) != 0) {
 			DEBUG(desync, 2, "infrastructure cache mismatch: company %i", (int)c->index);
 		}
+		if (old_assets[i] != c->assets) {
+			DEBUG(desync, 2, "assets cache mismatch: company %i", (int)c->index);
+		}
 		i++;
 	}
 
@@ -1336,20 +1506,28 @@ void StateGameLoop()
 		PerformanceMeasurer::Paused(PFE_GL_SHIPS);
 		PerformanceMeasurer::Paused(PFE_GL_AIRCRAFT);
 		PerformanceMeasurer::Paused(PFE_GL_LANDSCAPE);
+		for (PerformanceElement e = PFE_GL_DETAIL_FIRST; e <= PFE_GL_DETAIL_LAST; e++) PerformanceMeasurer::Paused(e);
 
 		UpdateLandscapingLimits();
 #ifndef DEBUG_DUMP_COMMANDS
 		Game::GameLoop();
 #endif
+		/* Commands may still change the map while paused. */
+		UpdateMapSnapshot();
 		return;
 	}
 
 	PerformanceMeasurer framerate(PFE_GAMELOOP);
+	TraceZone zone("StateGameLoop");
 	PerformanceAccumulator::Reset(PFE_GL_LANDSCAPE);
+	PerformanceAccumulator::ResetDetails();
 	if (HasModalProgress()) return;
 
 	Layouter::ReduceLineCache();
 
+	/* Commands of the previous frame have been executed; fix the seed of the random streams for this tick. */
+	UpdateRandomStreamSeed(_tick_counter);
+
 	if (_game_mode == GM_EDITOR) {
 		BasePersistentStorageArray::SwitchMode(PSM_ENTER_GAMELOOP);
 		RunTileLoop();
@@ -1390,12 +1568,16 @@ void StateGameLoop()
 		}
 #endif
 		UpdateLandscapingLimits();
+		if (_networking) UpdateStateHash();
 
-		CallWindowGameTickEvent();
+		/* Windows are not shown anyway while catching up with the server. */
+		if (!_network_catching_up) CallWindowGameTickEvent();
 		NewsLoop();
 		cur_company.Restore();
 	}
 
+	UpdateMapSnapshot();
+
 	assert(IsLocalCompany());
 }
 
@@ -1419,8 +1601,21 @@ static void DoAutosave()
 		if (++_autosave_ctr >= _settings_client.gui.max_num_autosaves) _autosave_ctr = 0;
 	}
 
+	/* Delta autosaves only contain the changes since the last full autosave, their keyframe. */
+	static std::string _autosave_keyframe;
+	static uint _autosave_deltas = 0;
+	const char *delta_base = nullptr;
+	if (_autosave_deltas < _settings_client.gui.autosave_delta_interval && !_autosave_keyframe.empty() && _autosave_keyframe != buf) {
+		delta_base = _autosave_keyframe.c_str();
+		_autosave_deltas++;
+	} else {
+		_autosave_keyframe = buf;
+		_autosave_deltas = 0;
+	}
+
 	DEBUG(sl, 2, "Autosaving to '%s'", buf);
-	if (SaveOrLoad(buf, SLO_SAVE, DFT_GAME_FILE, AUTOSAVE_DIR) != SL_OK) {
+	if (SaveOrLoad(buf, SLO_SAVE, DFT_GAME_FILE, AUTOSAVE_DIR, true, delta_base) != SL_OK) {
+		if (delta_base == nullptr) _autosave_keyframe.clear();
 		ShowErrorMessage(STR_ERROR_AUTOSAVE_FAILED, INVALID_STRING_ID, WL_ERROR);
 	}
 }
@@ -1435,6 +1630,7 @@ void GameLoop()
 	}
 
 	ProcessAsyncSaveFinish();
+	ProcessAsyncScreenshotFinish();
 
 	/* autosave game? */
 	if (_do_autosave) {
@@ -1449,7 +1645,6 @@ void GameLoop()
 		_switch_mode = SM_NONE;
 	}
 
-	IncreaseSpriteLRU();
 	InteractiveRandom();
 
 	/* Check for UDP stuff */
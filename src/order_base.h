@@ -18,6 +18,7 @@
 #include "station_type.h"
 #include "vehicle_type.h"
 #include "date_type.h"
+#include <vector>
 
 typedef Pool<Order, OrderID, 256, 0xFF0000> OrderPool;
 typedef Pool<OrderList, OrderListID, 128, 64000> OrderListPool;
@@ -253,8 +254,10 @@ private:
 	friend const struct SaveLoad *GetOrderListDescription(); ///< Saving and loading of order lists.
 
 	StationID GetBestLoadableNext(const Vehicle *v, const Order *o1, const Order *o2) const;
+	void LinkOrders();
 
 	Order *first;                     ///< First order of the order list.
+	std::vector<Order *> orders;      ///< NOSAVE: The orders of the list in their order, for access by index without walking the chain.
 	VehicleOrderID num_orders;        ///< NOSAVE: How many orders there are in the list.
 	VehicleOrderID num_manual_orders; ///< NOSAVE: How many manually added orders are there in the list.
 	uint num_vehicles;                ///< NOSAVE: Number of vehicles that share this order list.
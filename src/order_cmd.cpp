@@ -296,9 +296,11 @@ void OrderList::Initialize(Order *chain, Vehicle *v)
 	this->num_manual_orders = 0;
 	this->num_vehicles = 1;
 	this->timetable_duration = 0;
+	this->orders.clear();
 
 	for (Order *o = this->first; o != nullptr; o = o->next) {
 		++this->num_orders;
+		this->orders.push_back(o);
 		if (!o->IsType(OT_IMPLICIT)) ++this->num_manual_orders;
 		this->total_duration += o->GetWaitTime() + o->GetTravelTime();
 	}
@@ -340,6 +342,7 @@ void OrderList::FreeChain(bool keep_orderlist)
 
 	if (keep_orderlist) {
 		this->first = nullptr;
+		this->orders.clear();
 		this->num_orders = 0;
 		this->num_manual_orders = 0;
 		this->timetable_duration = 0;
@@ -355,14 +358,19 @@ void OrderList::FreeChain(bool keep_orderlist)
  */
 Order *OrderList::GetOrderAt(int index) const
 {
-	if (index < 0) return nullptr;
-
-	Order *order = this->first;
+	if (index < 0 || (uint)index >= this->orders.size()) return nullptr;
+	return this->orders[index];
+}
 
-	while (order != nullptr && index-- > 0) {
-		order = order->next;
+/**
+ * Link the chain of orders again after the orders were changed.
+ */
+void OrderList::LinkOrders()
+{
+	this->first = this->orders.empty() ? nullptr : this->orders.front();
+	for (size_t i = 0; i < this->orders.size(); i++) {
+		this->orders[i]->next = (i + 1 < this->orders.size()) ? this->orders[i + 1] : nullptr;
 	}
-	return order;
 }
 
 /**
@@ -470,23 +478,11 @@ StationIDStack OrderList::GetNextStoppingStation(const Vehicle *v, const Order *
  */
 void OrderList::InsertOrderAt(Order *new_order, int index)
 {
-	if (this->first == nullptr) {
-		this->first = new_order;
-	} else {
-		if (index == 0) {
-			/* Insert as first or only order */
-			new_order->next = this->first;
-			this->first = new_order;
-		} else if (index >= this->num_orders) {
-			/* index is after the last order, add it to the end */
-			this->GetLastOrder()->next = new_order;
-		} else {
-			/* Put the new order in between */
-			Order *order = this->GetOrderAt(index - 1);
-			new_order->next = order->next;
-			order->next = new_order;
-		}
-	}
+	/* An index after the last order adds it to the end. */
+	index = Clamp(index, 0, this->num_orders);
+	this->orders.insert(this->orders.begin() + index, new_order);
+	this->LinkOrders();
+
 	++this->num_orders;
 	if (!new_order->IsType(OT_IMPLICIT)) ++this->num_manual_orders;
 	this->timetable_duration += new_order->GetTimetabledWait() + new_order->GetTimetabledTravel();
@@ -510,16 +506,10 @@ void OrderList::DeleteOrderAt(int index)
 {
 	if (index >= this->num_orders) return;
 
-	Order *to_remove;
+	Order *to_remove = this->orders[index];
+	this->orders.erase(this->orders.begin() + index);
+	this->LinkOrders();
 
-	if (index == 0) {
-		to_remove = this->first;
-		this->first = to_remove->next;
-	} else {
-		Order *prev = GetOrderAt(index - 1);
-		to_remove = prev->next;
-		prev->next = to_remove->next;
-	}
 	--this->num_orders;
 	if (!to_remove->IsType(OT_IMPLICIT)) --this->num_manual_orders;
 	this->timetable_duration -= (to_remove->GetTimetabledWait() + to_remove->GetTimetabledTravel());
@@ -536,27 +526,10 @@ void OrderList::MoveOrder(int from, int to)
 {
 	if (from >= this->num_orders || to >= this->num_orders || from == to) return;
 
-	Order *moving_one;
-
-	/* Take the moving order out of the pointer-chain */
-	if (from == 0) {
-		moving_one = this->first;
-		this->first = moving_one->next;
-	} else {
-		Order *one_before = GetOrderAt(from - 1);
-		moving_one = one_before->next;
-		one_before->next = moving_one->next;
-	}
-
-	/* Insert the moving_order again in the pointer-chain */
-	if (to == 0) {
-		moving_one->next = this->first;
-		this->first = moving_one;
-	} else {
-		Order *one_before = GetOrderAt(to - 1);
-		moving_one->next = one_before->next;
-		one_before->next = moving_one;
-	}
+	Order *moving_one = this->orders[from];
+	this->orders.erase(this->orders.begin() + from);
+	this->orders.insert(this->orders.begin() + to, moving_one);
+	this->LinkOrders();
 }
 
 /**
@@ -623,12 +596,14 @@ void OrderList::DebugCheckSanity() const
 	DEBUG(misc, 6, "Checking OrderList %hu for sanity...", this->index);
 
 	for (const Order *o = this->first; o != nullptr; o = o->next) {
+		assert(check_num_orders < this->orders.size() && this->orders[check_num_orders] == o);
 		++check_num_orders;
 		if (!o->IsType(OT_IMPLICIT)) ++check_num_manual_orders;
 		check_timetable_duration += o->GetTimetabledWait() + o->GetTimetabledTravel();
 		check_total_duration += o->GetWaitTime() + o->GetTravelTime();
 	}
 	assert(this->num_orders == check_num_orders);
+	assert(this->orders.size() == check_num_orders);
 	assert(this->num_manual_orders == check_num_manual_orders);
 	assert(this->timetable_duration == check_timetable_duration);
 	assert(this->total_duration == check_total_duration);
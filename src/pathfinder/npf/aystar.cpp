@@ -19,6 +19,11 @@
  *  And when not free'd, it can cause system-crashes.
  * Also remember that when you stop an algorithm before it is finished, your
  * should call clear() yourself!
+ *
+ * The nodes of a search are not allocated one by one, but taken from blocks
+ * that stay allocated until Free() is called. A node popped from the open
+ * list stays where it is and becomes part of the closed list, so the nodes
+ * are only released all at once when the search is cleared.
  */
 
 #include "../../stdafx.h"
@@ -39,15 +44,28 @@ PathNode *AyStar::ClosedListIsInList(const AyStarNode *node)
 
 /**
  * This adds a node to the closed list.
- * It makes a copy of the data.
+ * The node has to stay valid until the search is cleared.
  * @param node Node to add to the closed list.
  */
-void AyStar::ClosedListAdd(const PathNode *node)
+void AyStar::ClosedListAdd(PathNode *node)
 {
 	/* Add a node to the ClosedList */
-	PathNode *new_node = MallocT<PathNode>(1);
-	*new_node = *node;
-	this->closedlist_hash.Set(node->node.tile, node->node.direction, new_node);
+	this->closedlist_hash.Set(node->node.tile, node->node.direction, node);
+}
+
+/**
+ * Get memory for a new node of the search.
+ * @return The node, which stays valid until the search is cleared.
+ */
+OpenListNode *AyStar::NewNode()
+{
+	uint block = this->num_nodes / NODE_BLOCK_SIZE;
+	if (block == this->node_blocks.size()) this->node_blocks.push_back(MallocT<OpenListNode>(NODE_BLOCK_SIZE));
+
+	OpenListNode *node = &this->node_blocks[block][this->num_nodes % NODE_BLOCK_SIZE];
+	this->num_nodes++;
+	node->heap_index = 0;
+	return node;
 }
 
 /**
@@ -68,7 +86,7 @@ OpenListNode *AyStar::OpenListIsInList(const AyStarNode *node)
 OpenListNode *AyStar::OpenListPop()
 {
 	/* Return the item the Queue returns.. the best next OpenList item. */
-	OpenListNode *res = (OpenListNode*)this->openlist_queue.Pop();
+	OpenListNode *res = static_cast<OpenListNode *>(this->openlist_queue.Pop());
 	if (res != nullptr) {
 		this->openlist_hash.DeleteValue(res->path.node.tile, res->path.node.direction);
 	}
@@ -83,7 +101,7 @@ OpenListNode *AyStar::OpenListPop()
 void AyStar::OpenListAdd(PathNode *parent, const AyStarNode *node, int f, int g)
 {
 	/* Add a new Node to the OpenList */
-	OpenListNode *new_node = MallocT<OpenListNode>(1);
+	OpenListNode *new_node = this->NewNode();
 	new_node->g = g;
 	new_node->path.parent = parent;
 	new_node->path.node = *node;
@@ -133,7 +151,7 @@ void AyStar::CheckTile(AyStarNode *current, OpenListNode *parent)
 		uint i;
 		/* Yes, check if this g value is lower.. */
 		if (new_g > check->g) return;
-		this->openlist_queue.Delete(check, 0);
+		this->openlist_queue.Delete(check);
 		/* It is lower, so change it to this item */
 		check->g = new_g;
 		check->path.parent = closedlist_parent;
@@ -166,13 +184,13 @@ int AyStar::Loop()
 	OpenListNode *current = this->OpenListPop();
 	/* If empty, drop an error */
 	if (current == nullptr) return AYSTAR_EMPTY_OPENLIST;
+	this->num_steps++;
 
 	/* Check for end node and if found, return that code */
 	if (this->EndNodeCheck(this, current) == AYSTAR_FOUND_END_NODE && !CheckIgnoreFirstTile(&current->path)) {
 		if (this->FoundEndNode != nullptr) {
 			this->FoundEndNode(this, current);
 		}
-		free(current);
 		return AYSTAR_FOUND_END_NODE;
 	}
 
@@ -188,9 +206,6 @@ int AyStar::Loop()
 		this->CheckTile(&this->neighbours[i], current);
 	}
 
-	/* Free the node */
-	free(current);
-
 	if (this->max_search_nodes != 0 && this->closedlist_hash.GetSize() >= this->max_search_nodes) {
 		/* We've expanded enough nodes */
 		return AYSTAR_LIMIT_REACHED;
@@ -205,11 +220,13 @@ int AyStar::Loop()
  */
 void AyStar::Free()
 {
-	this->openlist_queue.Free(false);
-	/* 2nd argument above is false, below is true, to free the values only
-	 * once */
-	this->openlist_hash.Delete(true);
-	this->closedlist_hash.Delete(true);
+	this->openlist_queue.Free();
+	/* The values of the hashes are the nodes, which are freed below */
+	this->openlist_hash.Delete(false);
+	this->closedlist_hash.Delete(false);
+	for (OpenListNode *block : this->node_blocks) free(block);
+	this->node_blocks.clear();
+	this->num_nodes = 0;
 #ifdef AYSTAR_DEBUG
 	printf("[AyStar] Memory free'd\n");
 #endif
@@ -221,12 +238,12 @@ void AyStar::Free()
  */
 void AyStar::Clear()
 {
-	/* Clean the Queue, but not the elements within. That will be done by
-	 * the hash. */
-	this->openlist_queue.Clear(false);
-	/* Clean the hashes */
-	this->openlist_hash.Clear(true);
-	this->closedlist_hash.Clear(true);
+	/* Clean the Queue and the hashes; the nodes in them are reused for the
+	 * next search. */
+	this->openlist_queue.Clear();
+	this->openlist_hash.Clear(false);
+	this->closedlist_hash.Clear(false);
+	this->num_nodes = 0;
 
 #ifdef AYSTAR_DEBUG
 	printf("[AyStar] Cleared AyStar\n");
@@ -297,8 +314,9 @@ void AyStar::Init(Hash_HashProc hash, uint num_buckets)
 	this->closedlist_hash.Init(hash, num_buckets);
 
 	/* Set up our sorting queue
-	 *  BinaryHeap allocates a block of 1024 nodes
-	 *  When that one gets full it reserves another one, till this number
+	 *  BinaryHeap allocates space for 1024 nodes
+	 *  When that gets full it doubles the space, till this number
 	 *  That is why it can stay this high */
 	this->openlist_queue.Init(102400);
+	this->num_nodes = 0;
 }
@@ -19,6 +19,7 @@
 #include "queue.h"
 #include "../../tile_type.h"
 #include "../../track_type.h"
+#include <vector>
 
 //#define AYSTAR_DEBUG
 
@@ -52,7 +53,7 @@ struct PathNode {
  * @note We do not save the h-value, because it is only needed to calculate the f-value.
  *       h-value should \em always be the distance left to the end-tile.
  */
-struct OpenListNode {
+struct OpenListNode : BinaryHeapItem {
 	int g;
 	PathNode path;
 };
@@ -138,12 +139,15 @@ struct AyStar {
 	byte loops_per_tick;   ///< How many loops are there called before Main() gives control back to the caller. 0 = until done.
 	uint max_path_cost;    ///< If the g-value goes over this number, it stops searching, 0 = infinite.
 	uint max_search_nodes; ///< The maximum number of nodes that will be expanded, 0 = infinite.
+	uint num_steps;        ///< Number of nodes expanded since the user last reset it; only used for statistics.
 
 	/* These should be filled with the neighbours of a tile by
 	 * GetNeighbours */
 	AyStarNode neighbours[12];
 	byte num_neighbours;
 
+	static const uint NODE_BLOCK_SIZE = 1024; ///< Number of nodes that are allocated at a time.
+
 	void Init(Hash_HashProc hash, uint num_buckets);
 
 	/* These will contain the methods for manipulating the AyStar. Only
@@ -160,11 +164,16 @@ protected:
 	BinaryHeap openlist_queue;  ///< The open queue.
 	Hash       openlist_hash;   ///< An extra hash to speed up the process of looking up an element in the open list.
 
+	std::vector<OpenListNode *> node_blocks; ///< Blocks of #NODE_BLOCK_SIZE nodes; they are kept for the next search when the search is cleared.
+	uint num_nodes;                          ///< Number of nodes of #node_blocks in use by the current search.
+
+	OpenListNode *NewNode();
+
 	void OpenListAdd(PathNode *parent, const AyStarNode *node, int f, int g);
 	OpenListNode *OpenListIsInList(const AyStarNode *node);
 	OpenListNode *OpenListPop();
 
-	void ClosedListAdd(const PathNode *node);
+	void ClosedListAdd(PathNode *node);
 	PathNode *ClosedListIsInList(const AyStarNode *node);
 };
 
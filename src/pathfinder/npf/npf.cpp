@@ -16,6 +16,7 @@
 #include "../pathfinder_func.h"
 #include "../pathfinder_type.h"
 #include "../follow_track.hpp"
+#include "../pf_trace.h"
 #include "aystar.h"
 
 #include "../../safeguards.h"
@@ -1046,8 +1047,10 @@ static NPFFoundTargetData NPFRouteInternal(AyStarNode *start1, bool ignore_start
 	_npf_aystar.user_data = user;
 
 	/* GO! */
+	_npf_aystar.num_steps = 0;
 	r = _npf_aystar.Main();
 	assert(r != AYSTAR_STILL_BUSY);
+	PfTraceNoteSearch(_npf_aystar.num_steps, 0, 0);
 
 	if (result.best_bird_dist != 0) {
 		if (target != nullptr) {
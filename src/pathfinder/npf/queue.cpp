@@ -9,6 +9,7 @@
 
 #include "../../stdafx.h"
 #include "../../core/alloc_func.hpp"
+#include "../../core/math_func.hpp"
 #include "queue.h"
 
 #include "../../safeguards.h"
@@ -19,106 +20,75 @@
  * For information, see: http://www.policyalmanac.org/games/binaryHeaps.htm
  */
 
-const int BinaryHeap::BINARY_HEAP_BLOCKSIZE_BITS = 10; ///< The number of elements that will be malloc'd at a time.
-const int BinaryHeap::BINARY_HEAP_BLOCKSIZE      = 1 << BinaryHeap::BINARY_HEAP_BLOCKSIZE_BITS;
-const int BinaryHeap::BINARY_HEAP_BLOCKSIZE_MASK = BinaryHeap::BINARY_HEAP_BLOCKSIZE - 1;
+const uint BinaryHeap::BINARY_HEAP_BLOCKSIZE = 1024;
 
 /**
  * Clears the queue, by removing all values from it. Its state is
- * effectively reset. If free_items is true, each of the items cleared
- * in this way are free()'d.
+ * effectively reset. The memory of the queue is kept for reuse,
+ * the items are not owned by the queue.
  */
-void BinaryHeap::Clear(bool free_values)
+void BinaryHeap::Clear()
 {
-	/* Free all items if needed and free all but the first blocks of memory */
-	uint i;
-	uint j;
-
-	for (i = 0; i < this->blocks; i++) {
-		if (this->elements[i] == nullptr) {
-			/* No more allocated blocks */
-			break;
-		}
-		/* For every allocated block */
-		if (free_values) {
-			for (j = 0; j < (1 << BINARY_HEAP_BLOCKSIZE_BITS); j++) {
-				/* For every element in the block */
-				if ((this->size >> BINARY_HEAP_BLOCKSIZE_BITS) == i &&
-						(this->size & BINARY_HEAP_BLOCKSIZE_MASK) == j) {
-					break; // We're past the last element
-				}
-				free(this->elements[i][j].item);
-			}
-		}
-		if (i != 0) {
-			/* Leave the first block of memory alone */
-			free(this->elements[i]);
-			this->elements[i] = nullptr;
-		}
-	}
+	for (uint i = 1; i <= this->size; i++) this->elements[i].item->heap_index = 0;
 	this->size = 0;
-	this->blocks = 1;
 }
 
 /**
  * Frees the queue, by reclaiming all memory allocated by it. After
- * this it is no longer usable. If free_items is true, any remaining
- * items are free()'d too.
+ * this it is no longer usable.
  */
-void BinaryHeap::Free(bool free_values)
+void BinaryHeap::Free()
 {
-	uint i;
-
-	this->Clear(free_values);
-	for (i = 0; i < this->blocks; i++) {
-		if (this->elements[i] == nullptr) break;
-		free(this->elements[i]);
-	}
+	this->Clear();
 	free(this->elements);
+	this->elements = nullptr;
+	this->capacity = 0;
+}
+
+/**
+ * Swap two elements of the queue.
+ * @param i The position of the first element.
+ * @param j The position of the second element.
+ */
+void BinaryHeap::Swap(uint i, uint j)
+{
+	BinaryHeapNode temp = this->elements[j];
+	this->SetElement(j, this->elements[i]);
+	this->SetElement(i, temp);
 }
 
 /**
  * Pushes an element into the queue, at the appropriate place for the queue.
- * Requires the queue pointer to be of an appropriate type, of course.
  */
-bool BinaryHeap::Push(void *item, int priority)
+bool BinaryHeap::Push(BinaryHeapItem *item, int priority)
 {
 	if (this->size == this->max_size) return false;
 	assert(this->size < this->max_size);
 
-	if (this->elements[this->size >> BINARY_HEAP_BLOCKSIZE_BITS] == nullptr) {
-		/* The currently allocated blocks are full, allocate a new one */
-		assert((this->size & BINARY_HEAP_BLOCKSIZE_MASK) == 0);
-		this->elements[this->size >> BINARY_HEAP_BLOCKSIZE_BITS] = MallocT<BinaryHeapNode>(BINARY_HEAP_BLOCKSIZE);
-		this->blocks++;
+	if (this->size == this->capacity) {
+		/* The allocated memory is full, make it larger */
+		this->capacity = min(max(this->capacity * 2, BINARY_HEAP_BLOCKSIZE), this->max_size);
+		this->elements = ReallocT<BinaryHeapNode>(this->elements, this->capacity + 1);
 	}
 
 	/* Add the item at the end of the array */
-	this->GetElement(this->size + 1).priority = priority;
-	this->GetElement(this->size + 1).item = item;
 	this->size++;
+	BinaryHeapNode node = { item, priority };
+	this->SetElement(this->size, node);
 
 	/* Now we are going to check where it belongs. As long as the parent is
 	 * bigger, we switch with the parent */
-	{
-		BinaryHeapNode temp;
-		int i;
-		int j;
-
-		i = this->size;
-		while (i > 1) {
-			/* Get the parent of this object (divide by 2) */
-			j = i / 2;
-			/* Is the parent bigger than the current, switch them */
-			if (this->GetElement(i).priority <= this->GetElement(j).priority) {
-				temp = this->GetElement(j);
-				this->GetElement(j) = this->GetElement(i);
-				this->GetElement(i) = temp;
-				i = j;
-			} else {
-				/* It is not, we're done! */
-				break;
-			}
+	uint i = this->size;
+	while (i > 1) {
+		/* Get the parent of this object (divide by 2) */
+		uint j = i / 2;
+		/* Is the parent bigger than the current, switch them */
+		if (this->elements[i].priority <= this->elements[j].priority) {
+			this->Swap(i, j);
+			i = j;
+		} else {
+			/* It is not, we're done! */
+			break;
 		}
 	}
 
@@ -126,59 +96,44 @@ bool BinaryHeap::Push(void *item, int priority)
 }
 
 /**
- * Deletes the item from the queue. priority should be specified if
- * known, which speeds up the deleting for some queue's. Should be -1
- * if not known.
+ * Deletes the item from the queue. The item knows where it is in the
+ * queue, so it does not need to be searched for.
  */
-bool BinaryHeap::Delete(void *item, int priority)
+bool BinaryHeap::Delete(BinaryHeapItem *item)
 {
-	uint i = 0;
-
-	/* First, we try to find the item.. */
-	do {
-		if (this->GetElement(i + 1).item == item) break;
-		i++;
-	} while (i < this->size);
-	/* We did not find the item, so we return false */
-	if (i == this->size) return false;
+	uint i = item->heap_index;
+	/* The item is not in the queue, so we return false */
+	if (i == 0) return false;
+	assert(i <= this->size && this->elements[i].item == item);
+	item->heap_index = 0;
 
 	/* Now we put the last item over the current item while decreasing the size of the elements */
 	this->size--;
-	this->GetElement(i + 1) = this->GetElement(this->size + 1);
+	if (i == this->size + 1) return true;
+	this->SetElement(i, this->elements[this->size + 1]);
 
 	/* Now the only thing we have to do, is resort it..
 	 * On place i there is the item to be sorted.. let's start there */
-	{
-		uint j;
-		BinaryHeapNode temp;
-		/* Because of the fact that Binary Heap uses array from 1 to n, we need to
-		 * increase i by 1
-		 */
-		i++;
-
-		for (;;) {
-			j = i;
-			/* Check if we have 2 children */
-			if (2 * j + 1 <= this->size) {
-				/* Is this child smaller than the parent? */
-				if (this->GetElement(j).priority >= this->GetElement(2 * j).priority) i = 2 * j;
-				/* Yes, we _need_ to use i here, not j, because we want to have the smallest child
-				 *  This way we get that straight away! */
-				if (this->GetElement(i).priority >= this->GetElement(2 * j + 1).priority) i = 2 * j + 1;
-			/* Do we have one child? */
-			} else if (2 * j <= this->size) {
-				if (this->GetElement(j).priority >= this->GetElement(2 * j).priority) i = 2 * j;
-			}
+	for (;;) {
+		uint j = i;
+		/* Check if we have 2 children */
+		if (2 * j + 1 <= this->size) {
+			/* Is this child smaller than the parent? */
+			if (this->elements[j].priority >= this->elements[2 * j].priority) i = 2 * j;
+			/* Yes, we _need_ to use i here, not j, because we want to have the smallest child
+			 *  This way we get that straight away! */
+			if (this->elements[i].priority >= this->elements[2 * j + 1].priority) i = 2 * j + 1;
+		/* Do we have one child? */
+		} else if (2 * j <= this->size) {
+			if (this->elements[j].priority >= this->elements[2 * j].priority) i = 2 * j;
+		}
 
-			/* One of our children is smaller than we are, switch */
-			if (i != j) {
-				temp = this->GetElement(j);
-				this->GetElement(j) = this->GetElement(i);
-				this->GetElement(i) = temp;
-			} else {
-				/* None of our children is smaller, so we stay here.. stop :) */
-				break;
-			}
+		/* One of our children is smaller than we are, switch */
+		if (i != j) {
+			this->Swap(i, j);
+		} else {
+			/* None of our children is smaller, so we stay here.. stop :) */
+			break;
 		}
 	}
 
@@ -189,38 +144,30 @@ bool BinaryHeap::Delete(void *item, int priority)
  * Pops the first element from the queue. What exactly is the first element,
  * is defined by the exact type of queue.
  */
-void *BinaryHeap::Pop()
+BinaryHeapItem *BinaryHeap::Pop()
 {
-	void *result;
-
 	if (this->size == 0) return nullptr;
 
 	/* The best item is always on top, so give that as result */
-	result = this->GetElement(1).item;
+	BinaryHeapItem *result = this->elements[1].item;
 	/* And now we should get rid of this item... */
-	this->Delete(this->GetElement(1).item, this->GetElement(1).priority);
+	this->Delete(result);
 
 	return result;
 }
 
 /**
- * Initializes a binary heap and allocates internal memory for maximum of
- * max_size elements
+ * Initializes a binary heap for a maximum of max_size elements. Memory
+ * is allocated when needed, and kept until the heap is freed.
  */
 void BinaryHeap::Init(uint max_size)
 {
 	this->max_size = max_size;
 	this->size = 0;
-	/* We malloc memory in block of BINARY_HEAP_BLOCKSIZE
-	 *   It autosizes when it runs out of memory */
-	this->elements = CallocT<BinaryHeapNode*>((max_size - 1) / BINARY_HEAP_BLOCKSIZE + 1);
-	this->elements[0] = MallocT<BinaryHeapNode>(BINARY_HEAP_BLOCKSIZE);
-	this->blocks = 1;
+	this->capacity = 0;
+	this->elements = nullptr;
 }
 
-/* Because we don't want anyone else to bother with our defines */
-#undef BIN_HEAP_ARR
-
 /*
  * Hash
  */
@@ -243,6 +190,30 @@ void Hash::Init(Hash_HashProc *hash, uint num_buckets)
 	this->buckets = (HashNode*)MallocT<byte>(num_buckets * (sizeof(*this->buckets) + sizeof(*this->buckets_in_use)));
 	this->buckets_in_use = (bool*)(this->buckets + num_buckets);
 	for (i = 0; i < num_buckets; i++) this->buckets_in_use[i] = false;
+	this->free_nodes = nullptr;
+}
+
+/**
+ * Get a node for a bucket chain, reusing a node that is no longer in use if possible.
+ * @return The node.
+ */
+HashNode *Hash::NewNode()
+{
+	if (this->free_nodes == nullptr) return MallocT<HashNode>(1);
+
+	HashNode *node = this->free_nodes;
+	this->free_nodes = node->next;
+	return node;
+}
+
+/**
+ * Put a node of a bucket chain aside for reuse.
+ * @param node The node that is no longer in use.
+ */
+void Hash::FreeNode(HashNode *node)
+{
+	node->next = this->free_nodes;
+	this->free_nodes = node;
 }
 
 /**
@@ -273,6 +244,11 @@ void Hash::Delete(bool free_values)
 			}
 		}
 	}
+	while (this->free_nodes != nullptr) {
+		HashNode *node = this->free_nodes;
+		this->free_nodes = node->next;
+		free(node);
+	}
 	free(this->buckets);
 	/* No need to free buckets_in_use, it is always allocated in one
 	 * malloc with buckets */
@@ -330,7 +306,7 @@ void Hash::PrintStatistics() const
 #endif
 
 /**
- * Cleans the hash, but keeps the memory allocated
+ * Cleans the hash, but keeps the memory allocated, including the nodes of the bucket chains
  */
 void Hash::Clear(bool free_values)
 {
@@ -354,7 +330,7 @@ void Hash::Clear(bool free_values)
 
 				node = node->next;
 				if (free_values) free(prev->value);
-				free(prev);
+				this->FreeNode(prev);
 			}
 		}
 	}
@@ -425,7 +401,7 @@ void *Hash::DeleteValue(uint key1, uint key2)
 			/* Copy the second to the first */
 			*node = *next;
 			/* Free the second */
-			free(next);
+			this->FreeNode(next);
 		} else {
 			/* This was the last in this bucket
 			 * Mark it as empty */
@@ -439,7 +415,7 @@ void *Hash::DeleteValue(uint key1, uint key2)
 		/* Link previous and next nodes */
 		prev->next = node->next;
 		/* Free the node */
-		free(node);
+		this->FreeNode(node);
 	}
 	if (result != nullptr) this->size--;
 	return result;
@@ -469,7 +445,7 @@ void *Hash::Set(uint key1, uint key2, void *value)
 		node = this->buckets + hash;
 	} else {
 		/* Add it after prev */
-		node = MallocT<HashNode>(1);
+		node = this->NewNode();
 		prev->next = node;
 	}
 	node->next = nullptr;
@@ -13,8 +13,13 @@
 //#define HASH_STATS
 
 
+/** Item of a #BinaryHeap, which remembers where in the heap it is, so it can be deleted without searching for it. */
+struct BinaryHeapItem {
+	uint heap_index; ///< Position of the item in the heap, starting at \c 1; \c 0 when it is not in the heap.
+};
+
 struct BinaryHeapNode {
-	void *item;
+	BinaryHeapItem *item;
 	int priority;
 };
 
@@ -24,17 +29,15 @@ struct BinaryHeapNode {
  * For information, see: http://www.policyalmanac.org/games/binaryHeaps.htm
  */
 struct BinaryHeap {
-	static const int BINARY_HEAP_BLOCKSIZE;
-	static const int BINARY_HEAP_BLOCKSIZE_BITS;
-	static const int BINARY_HEAP_BLOCKSIZE_MASK;
+	static const uint BINARY_HEAP_BLOCKSIZE; ///< The number of elements that will be allocated at first.
 
 	void Init(uint max_size);
 
-	bool Push(void *item, int priority);
-	void *Pop();
-	bool Delete(void *item, int priority);
-	void Clear(bool free_values);
-	void Free(bool free_values);
+	bool Push(BinaryHeapItem *item, int priority);
+	BinaryHeapItem *Pop();
+	bool Delete(BinaryHeapItem *item);
+	void Clear();
+	void Free();
 
 	/**
 	 * Get an element from the #elements.
@@ -43,14 +46,28 @@ struct BinaryHeap {
 	 */
 	inline BinaryHeapNode &GetElement(uint i)
 	{
-		assert(i > 0);
-		return this->elements[(i - 1) >> BINARY_HEAP_BLOCKSIZE_BITS][(i - 1) & BINARY_HEAP_BLOCKSIZE_MASK];
+		assert(i > 0 && i <= this->size);
+		return this->elements[i];
 	}
 
 	uint max_size;
 	uint size;
-	uint blocks; ///< The amount of blocks for which space is reserved in elements
-	BinaryHeapNode **elements;
+	uint capacity;             ///< The amount of elements for which space is reserved in elements
+	BinaryHeapNode *elements;  ///< The elements, starting at index \c 1; the memory is kept when the heap is cleared.
+
+protected:
+	/**
+	 * Put a node at a position in the heap, and tell its item where it is.
+	 * @param i Position in the heap.
+	 * @param node The node to put there.
+	 */
+	inline void SetElement(uint i, const BinaryHeapNode &node)
+	{
+		this->elements[i] = node;
+		node.item->heap_index = i;
+	}
+
+	void Swap(uint i, uint j);
 };
 
 
@@ -80,6 +97,9 @@ struct Hash {
 	/* A pointer to an array of numbuckets booleans, which will be true if
 	 * there are any Nodes in the bucket */
 	bool *buckets_in_use;
+	/* A chain of allocated nodes that are not in use; these are reused
+	 * instead of allocating new ones */
+	HashNode *free_nodes;
 
 	void Init(Hash_HashProc *hash, uint num_buckets);
 
@@ -104,6 +124,8 @@ protected:
 	void PrintStatistics() const;
 #endif
 	HashNode *FindNode(uint key1, uint key2, HashNode** prev_out) const;
+	HashNode *NewNode();
+	void FreeNode(HashNode *node);
 };
 
 #endif /* QUEUE_H */
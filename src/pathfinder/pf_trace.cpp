@@ -0,0 +1,267 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file pf_trace.cpp Recording and replaying of the pathfinder requests of vehicles, for benchmarking pathfinder changes. */
+
+#include "../stdafx.h"
+#include "pf_trace.h"
+#include "../vehicle_base.h"
+#include "../date_func.h"
+#include "../map_func.h"
+#include "../settings_type.h"
+#include "../console_func.h"
+#include "../fileio_func.h"
+#include "../debug.h"
+#include <chrono>
+#include <vector>
+
+#include "../safeguards.h"
+
+/** A single pathfinder request of a trace. */
+struct PfTraceRecord {
+	Date date;              ///< Date of the request.
+	DateFract date_fract;   ///< Tick within the day of the request.
+	VehicleType type;       ///< Type of the vehicle.
+	uint pathfinder;        ///< The #VehiclePathFinders used for the request.
+	VehicleID vehicle;      ///< The vehicle asking for a path.
+	TileIndex tile;         ///< The tile the vehicle is about to enter.
+	DiagDirection enterdir; ///< The direction the tile is entered from.
+	int result;             ///< The track or trackdir the pathfinder chose.
+	bool path_found;        ///< Whether a path to the destination was found.
+	PfTraceStats stats;     ///< The work done for the request.
+	uint64 time;            ///< Time the request took, in microseconds.
+
+	/**
+	 * Check whether another record is the same request, i.e. whether the game did not diverge.
+	 * @param other The other record.
+	 * @return True if the requests only differ in the work done to answer them.
+	 */
+	bool IsSameRequest(const PfTraceRecord &other) const
+	{
+		return this->date == other.date && this->date_fract == other.date_fract && this->type == other.type &&
+				this->pathfinder == other.pathfinder && this->vehicle == other.vehicle &&
+				this->tile == other.tile && this->enterdir == other.enterdir;
+	}
+};
+
+/** Totals of a replay. */
+struct PfTraceReplayTotals {
+	uint requests;          ///< Number of requests compared.
+	uint different_results; ///< Number of requests that got another answer than in the trace.
+	PfTraceStats old_stats; ///< Work done for the compared requests according to the trace.
+	PfTraceStats new_stats; ///< Work done for the compared requests now.
+	uint64 old_time;        ///< Time the compared requests took according to the trace, in microseconds.
+	uint64 new_time;        ///< Time the compared requests took now, in microseconds.
+};
+
+/** What is done with the pathfinder requests. */
+enum PfTraceMode {
+	PTM_NONE,   ///< Nothing, tracing is not active.
+	PTM_RECORD, ///< Write them to the trace file.
+	PTM_REPLAY, ///< Compare them with the requests of the trace file.
+};
+
+bool _pf_trace_request_open = false; ///< Whether a pathfinder request is being traced at the moment.
+PfTraceStats _pf_trace_stats;        ///< The work done so far for the pathfinder request being traced.
+
+static PfTraceMode _pf_trace_mode = PTM_NONE;      ///< What is done with the pathfinder requests.
+static FILE *_pf_trace_file = nullptr;             ///< File requests are recorded to.
+static std::vector<PfTraceRecord> _pf_trace_replay; ///< Requests of the trace being replayed.
+static size_t _pf_trace_replay_pos = 0;             ///< The next request of the trace being replayed.
+static bool _pf_trace_diverged = false;            ///< Whether the game diverged from the trace being replayed.
+static PfTraceReplayTotals _pf_trace_totals;       ///< Totals of the current replay.
+
+/** Get the current time in microseconds. */
+static uint64 GetPfTraceTime()
+{
+	using namespace std::chrono;
+	return (uint64)time_point_cast<microseconds>(high_resolution_clock::now()).time_since_epoch().count();
+}
+
+/**
+ * Get the pathfinder that is used for a type of vehicle.
+ * @param type The vehicle type.
+ * @return The #VehiclePathFinders used for the type.
+ */
+static uint GetPathfinderForType(VehicleType type)
+{
+	switch (type) {
+		case VEH_TRAIN: return _settings_game.pf.pathfinder_for_trains;
+		case VEH_ROAD:  return _settings_game.pf.pathfinder_for_roadvehs;
+		case VEH_SHIP:  return _settings_game.pf.pathfinder_for_ships;
+		default: NOT_REACHED();
+	}
+}
+
+/**
+ * Start recording all pathfinder requests to a trace file.
+ * The trace starts at the current date; replay it by loading the same savegame again.
+ * @param filename The file to write to.
+ * @return True if recording started.
+ */
+bool PfTraceStartRecording(const char *filename)
+{
+	PfTraceStop();
+
+	_pf_trace_file = FioFOpenFile(filename, "w", BASE_DIR);
+	if (_pf_trace_file == nullptr) return false;
+
+	fprintf(_pf_trace_file, "# pftrace %d %d %u %u\n", _date, _date_fract, MapSizeX(), MapSizeY());
+	_pf_trace_mode = PTM_RECORD;
+	return true;
+}
+
+/**
+ * Start comparing all pathfinder requests with those of a trace file.
+ * The current game has to be in the same state as when the trace was started.
+ * @param filename The file to read from.
+ * @return True if the replay started.
+ */
+bool PfTraceStartReplay(const char *filename)
+{
+	PfTraceStop();
+
+	FILE *f = FioFOpenFile(filename, "r", BASE_DIR);
+	if (f == nullptr) return false;
+
+	int date, date_fract;
+	uint size_x, size_y;
+	if (fscanf(f, "# pftrace %d %d %u %u", &date, &date_fract, &size_x, &size_y) != 4) {
+		IConsoleError("not a pathfinder trace");
+		FioFCloseFile(f);
+		return false;
+	}
+	if (date != _date || date_fract != _date_fract || size_x != MapSizeX() || size_y != MapSizeY()) {
+		IConsoleWarning("the trace was not started in this state of the game, comparisons will likely fail");
+	}
+
+	PfTraceRecord r;
+	int type, enterdir, path_found;
+	int64 time;
+	while (fscanf(f, "%d %hu %d %u %u %u %d %d %d %u %u %u " OTTD_PRINTF64, &date, &r.date_fract, &type, &r.pathfinder, &r.vehicle, &r.tile,
+			&enterdir, &r.result, &path_found, &r.stats.steps, &r.stats.cache_hits, &r.stats.cost_calcs, &time) == 13) {
+		r.date = date;
+		r.type = (VehicleType)type;
+		r.enterdir = (DiagDirection)enterdir;
+		r.path_found = path_found != 0;
+		r.time = time;
+		_pf_trace_replay.push_back(r);
+	}
+	FioFCloseFile(f);
+
+	_pf_trace_replay_pos = 0;
+	_pf_trace_diverged = false;
+	_pf_trace_totals = {};
+	_pf_trace_mode = PTM_REPLAY;
+	IConsolePrintF(CC_INFO, "Replaying %u pathfinder requests.", (uint)_pf_trace_replay.size());
+	return true;
+}
+
+/**
+ * Stop recording or replaying, and report the totals of a replay.
+ * @return True if tracing was active.
+ */
+bool PfTraceStop()
+{
+	PfTraceMode mode = _pf_trace_mode;
+	_pf_trace_mode = PTM_NONE;
+
+	if (mode == PTM_RECORD) {
+		FioFCloseFile(_pf_trace_file);
+		_pf_trace_file = nullptr;
+	} else if (mode == PTM_REPLAY) {
+		const PfTraceReplayTotals &t = _pf_trace_totals;
+		IConsolePrintF(CC_INFO, "Compared %u of %u pathfinder requests, %u got a different answer.", t.requests, (uint)_pf_trace_replay.size(), t.different_results);
+		IConsolePrintF(CC_INFO, "  nodes expanded:  %u -> %u", t.old_stats.steps, t.new_stats.steps);
+		IConsolePrintF(CC_INFO, "  cache hits:      %u -> %u", t.old_stats.cache_hits, t.new_stats.cache_hits);
+		IConsolePrintF(CC_INFO, "  cost calculated: %u -> %u", t.old_stats.cost_calcs, t.new_stats.cost_calcs);
+		IConsolePrintF(CC_INFO, "  time (us):       " OTTD_PRINTF64 " -> " OTTD_PRINTF64, (int64)t.old_time, (int64)t.new_time);
+		if (_pf_trace_diverged) IConsoleWarning("the game diverged from the trace, the remaining requests were not compared");
+		_pf_trace_replay.clear();
+	}
+
+	return mode != PTM_NONE;
+}
+
+/**
+ * Check whether pathfinder requests are being recorded or replayed.
+ * @return True if tracing is active.
+ */
+bool PfTraceIsActive()
+{
+	return _pf_trace_mode != PTM_NONE;
+}
+
+/**
+ * Start a pathfinder request of a vehicle.
+ * @param v The vehicle asking for a path.
+ * @param tile The tile the vehicle is about to enter.
+ * @param enterdir The direction the tile is entered from.
+ */
+PfTraceRequest::PfTraceRequest(const Vehicle *v, TileIndex tile, DiagDirection enterdir) : v(v), tile(tile), enterdir(enterdir)
+{
+	this->active = _pf_trace_mode != PTM_NONE && !_pf_trace_request_open;
+	if (!this->active) return;
+
+	_pf_trace_request_open = true;
+	_pf_trace_stats = {};
+	this->start_time = GetPfTraceTime();
+}
+
+/**
+ * Finish the pathfinder request, and record or compare it.
+ * @param result The track or trackdir the pathfinder chose.
+ * @param path_found Whether a path to the destination was found.
+ */
+void PfTraceRequest::Finish(int result, bool path_found)
+{
+	if (!this->active) return;
+	this->active = false;
+	_pf_trace_request_open = false;
+
+	PfTraceRecord r;
+	r.time = GetPfTraceTime() - this->start_time;
+	r.date = _date;
+	r.date_fract = _date_fract;
+	r.type = this->v->type;
+	r.pathfinder = GetPathfinderForType(r.type);
+	r.vehicle = this->v->index;
+	r.tile = this->tile;
+	r.enterdir = this->enterdir;
+	r.result = result;
+	r.path_found = path_found;
+	r.stats = _pf_trace_stats;
+
+	if (_pf_trace_mode == PTM_RECORD) {
+		fprintf(_pf_trace_file, "%d %u %d %u %u %u %d %d %d %u %u %u " OTTD_PRINTF64 "\n", r.date, r.date_fract, r.type, r.pathfinder, r.vehicle, r.tile,
+				r.enterdir, r.result, r.path_found ? 1 : 0, r.stats.steps, r.stats.cache_hits, r.stats.cost_calcs, (int64)r.time);
+		return;
+	}
+
+	if (_pf_trace_diverged) return;
+	if (_pf_trace_replay_pos == _pf_trace_replay.size() || !_pf_trace_replay[_pf_trace_replay_pos].IsSameRequest(r)) {
+		_pf_trace_diverged = true;
+		return;
+	}
+
+	const PfTraceRecord &old = _pf_trace_replay[_pf_trace_replay_pos++];
+	PfTraceReplayTotals &t = _pf_trace_totals;
+	t.requests++;
+	if (old.result != r.result || old.path_found != r.path_found) t.different_results++;
+	t.old_stats.steps += old.stats.steps;
+	t.old_stats.cache_hits += old.stats.cache_hits;
+	t.old_stats.cost_calcs += old.stats.cost_calcs;
+	t.new_stats.steps += r.stats.steps;
+	t.new_stats.cache_hits += r.stats.cache_hits;
+	t.new_stats.cost_calcs += r.stats.cost_calcs;
+	t.old_time += old.time;
+	t.new_time += r.time;
+
+	DEBUG(yapf, 2, "[pftrace] veh %u tile 0x%X: %u -> %u nodes, %u -> %u cache hits, " OTTD_PRINTF64 " -> " OTTD_PRINTF64 " us%s",
+			r.vehicle, r.tile, old.stats.steps, r.stats.steps, old.stats.cache_hits, r.stats.cache_hits, (int64)old.time, (int64)r.time,
+			old.result != r.result ? " (different answer)" : "");
+}
@@ -0,0 +1,63 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file pf_trace.h Recording and replaying of the pathfinder requests of vehicles, for benchmarking pathfinder changes. */
+
+#ifndef PF_TRACE_H
+#define PF_TRACE_H
+
+#include "../direction_type.h"
+#include "../tile_type.h"
+#include "../vehicle_type.h"
+
+/** Statistics of the searches done while handling a single pathfinder request. */
+struct PfTraceStats {
+	uint steps;      ///< Number of nodes expanded.
+	uint cache_hits; ///< Number of segment costs taken from the segment cost cache.
+	uint cost_calcs; ///< Number of segment costs that had to be calculated.
+};
+
+bool PfTraceStartRecording(const char *filename);
+bool PfTraceStartReplay(const char *filename);
+bool PfTraceStop();
+bool PfTraceIsActive();
+
+extern bool _pf_trace_request_open;
+extern PfTraceStats _pf_trace_stats;
+
+/**
+ * Add the statistics of a search to the pathfinder request that is being traced, if any.
+ * @param steps Number of nodes expanded.
+ * @param cache_hits Number of segment costs taken from the cache.
+ * @param cost_calcs Number of segment costs calculated.
+ */
+static inline void PfTraceNoteSearch(uint steps, uint cache_hits, uint cost_calcs)
+{
+	if (!_pf_trace_request_open) return;
+	_pf_trace_stats.steps += steps;
+	_pf_trace_stats.cache_hits += cache_hits;
+	_pf_trace_stats.cost_calcs += cost_calcs;
+}
+
+/**
+ * Scope of a single pathfinder request of a vehicle.
+ * While recording, the request and the work done for it are written to the trace.
+ * While replaying, they are compared with the same request of the trace.
+ */
+class PfTraceRequest {
+	bool active;            ///< Whether the request is traced.
+	const Vehicle *v;       ///< The vehicle asking for a path.
+	TileIndex tile;         ///< The tile the vehicle is about to enter.
+	DiagDirection enterdir; ///< The direction the tile is entered from.
+	uint64 start_time;      ///< Time the request started, in microseconds.
+
+public:
+	PfTraceRequest(const Vehicle *v, TileIndex tile, DiagDirection enterdir);
+	void Finish(int result, bool path_found);
+};
+
+#endif /* PF_TRACE_H */
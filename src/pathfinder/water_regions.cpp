@@ -0,0 +1,392 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file water_regions.cpp Handles dividing the water in the map into square regions to assist pathfinding. */
+
+#include "../stdafx.h"
+#include "../map_func.h"
+#include "../tile_map.h"
+#include "../ship.h"
+#include "../tunnelbridge_map.h"
+#include "follow_track.hpp"
+#include "water_regions.h"
+#include <mutex>
+
+#include "../safeguards.h"
+
+typedef uint16 TWaterRegionTraversabilityBits; ///< Bit i is set when ships can cross the edge of a region at local coordinate i.
+
+/** Label of the first patch in a region; regions with just one patch only use this label. */
+static const TWaterRegionPatchLabel FIRST_REGION_LABEL = 1;
+
+assert_compile(sizeof(TWaterRegionTraversabilityBits) * 8 == WATER_REGION_EDGE_LENGTH);
+
+/**
+ * Get the water tracks of a tile ships can use.
+ * @param tile The tile.
+ * @return The water tracks.
+ */
+static inline TrackBits GetWaterTracks(TileIndex tile)
+{
+	return TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_WATER, 0));
+}
+
+/**
+ * Is the tile the end of an aqueduct?
+ * @param tile The tile.
+ * @return True iff the tile is an aqueduct ramp.
+ */
+static inline bool IsAqueductTile(TileIndex tile)
+{
+	return IsBridgeTile(tile) && GetTunnelBridgeTransportType(tile) == TRANSPORT_WATER;
+}
+
+/** The number of water regions along the X axis. */
+static inline uint GetWaterRegionMapSizeX() { return MapSizeX() / WATER_REGION_EDGE_LENGTH; }
+/** The number of water regions along the Y axis. */
+static inline uint GetWaterRegionMapSizeY() { return MapSizeY() / WATER_REGION_EDGE_LENGTH; }
+
+/**
+ * Get the index of the water region with the given coordinates.
+ * @param region_x The X coordinate of the water region.
+ * @param region_y The Y coordinate of the water region.
+ * @return The index in #_water_regions.
+ */
+static inline uint GetWaterRegionIndex(uint region_x, uint region_y)
+{
+	return region_y * GetWaterRegionMapSizeX() + region_x;
+}
+
+/**
+ * Get the index of the water region a tile is in.
+ * @param tile The tile.
+ * @return The index in #_water_regions.
+ */
+static inline uint GetWaterRegionIndex(TileIndex tile)
+{
+	return GetWaterRegionIndex(TileX(tile) / WATER_REGION_EDGE_LENGTH, TileY(tile) / WATER_REGION_EDGE_LENGTH);
+}
+
+/**
+ * The connected patches of water within a square part of the map, and the
+ * places where ships can cross over to the neighbouring regions. Regions are
+ * only (re)calculated when they are needed after they have been invalidated.
+ */
+class WaterRegion {
+	TileArea tile_area;                                                                ///< Tiles of the region.
+	TWaterRegionPatchLabel tile_patch_labels[WATER_REGION_NUMBER_OF_TILES];            ///< Label of the patch of each tile, or #INVALID_WATER_REGION_PATCH.
+	TWaterRegionTraversabilityBits edge_traversability_bits[DIAGDIR_END];              ///< Where ships can leave the region on each side.
+	TWaterRegionPatchLabel number_of_patches;                                          ///< Number of patches, i.e. the highest label in use.
+	bool has_cross_region_aqueducts;                                                   ///< Whether aqueducts lead from this region into another one.
+	bool initialized;                                                                  ///< Whether the labels are up to date.
+
+	/**
+	 * Get the index of a tile within the region.
+	 * @param tile The tile.
+	 * @return The index in #tile_patch_labels.
+	 */
+	inline uint GetLocalIndex(TileIndex tile) const
+	{
+		assert(this->tile_area.Contains(tile));
+		return (TileX(tile) - TileX(this->tile_area.tile)) + WATER_REGION_EDGE_LENGTH * (TileY(tile) - TileY(this->tile_area.tile));
+	}
+
+public:
+	/**
+	 * Create the (not yet initialized) region with the given coordinates.
+	 * @param region_x The X coordinate of the water region.
+	 * @param region_y The Y coordinate of the water region.
+	 */
+	WaterRegion(uint region_x, uint region_y) :
+		tile_area(TileXY(region_x * WATER_REGION_EDGE_LENGTH, region_y * WATER_REGION_EDGE_LENGTH), WATER_REGION_EDGE_LENGTH, WATER_REGION_EDGE_LENGTH),
+		number_of_patches(0), has_cross_region_aqueducts(false), initialized(false)
+	{
+	}
+
+	/** Mark the region as out of date. */
+	inline void Invalidate() { this->initialized = false; }
+	inline bool IsInitialized() const { return this->initialized; }
+	inline const TileArea &GetTileArea() const { return this->tile_area; }
+	inline TWaterRegionPatchLabel NumberOfPatches() const { return this->number_of_patches; }
+	inline bool HasCrossRegionAqueducts() const { return this->has_cross_region_aqueducts; }
+
+	/**
+	 * Get where ships can leave the region on one side.
+	 * @param side The side of the region.
+	 * @return Bit i is set when the tile at local coordinate i along that edge leads out of the region.
+	 */
+	inline TWaterRegionTraversabilityBits GetEdgeTraversabilityBits(DiagDirection side) const { return this->edge_traversability_bits[side]; }
+
+	/**
+	 * Get the label of the patch a tile belongs to.
+	 * @param tile The tile, which must be in the region.
+	 * @return The label, or #INVALID_WATER_REGION_PATCH when ships cannot use the tile.
+	 */
+	inline TWaterRegionPatchLabel GetLabel(TileIndex tile) const
+	{
+		assert(this->initialized);
+		return this->tile_patch_labels[this->GetLocalIndex(tile)];
+	}
+
+	/**
+	 * Recalculate the patches of the region. The patches are found by flood
+	 * filling with the same track follower the ship pathfinder uses, but only
+	 * within the region.
+	 */
+	void ForceUpdate()
+	{
+		this->has_cross_region_aqueducts = false;
+		this->number_of_patches = 0;
+		MemSetT(this->tile_patch_labels, INVALID_WATER_REGION_PATCH, lengthof(this->tile_patch_labels));
+		MemSetT(this->edge_traversability_bits, 0, lengthof(this->edge_traversability_bits));
+
+		static std::vector<TileIndex> tiles_to_check;
+		TWaterRegionPatchLabel current_label = FIRST_REGION_LABEL;
+		for (TileIndex start_tile : this->tile_area) {
+			if (this->tile_patch_labels[this->GetLocalIndex(start_tile)] != INVALID_WATER_REGION_PATCH) continue;
+
+			tiles_to_check.clear();
+			tiles_to_check.push_back(start_tile);
+			bool increase_label = false;
+			while (!tiles_to_check.empty()) {
+				TileIndex tile = tiles_to_check.back();
+				tiles_to_check.pop_back();
+
+				TrackdirBits valid_dirs = TrackBitsToTrackdirBits(GetWaterTracks(tile));
+				if (valid_dirs == TRACKDIR_BIT_NONE) continue;
+
+				TWaterRegionPatchLabel &label = this->tile_patch_labels[this->GetLocalIndex(tile)];
+				if (label != INVALID_WATER_REGION_PATCH) continue;
+				label = current_label;
+				increase_label = true;
+
+				for (; valid_dirs != TRACKDIR_BIT_NONE; valid_dirs = KillFirstBit(valid_dirs)) {
+					Trackdir dir = (Trackdir)FindFirstBit2x64(valid_dirs);
+					CFollowTrackWater ft;
+					if (!ft.Follow(tile, dir)) continue;
+
+					if (this->tile_area.Contains(ft.m_new_tile)) {
+						tiles_to_check.push_back(ft.m_new_tile);
+					} else if (ft.m_is_bridge) {
+						this->has_cross_region_aqueducts = true;
+					} else {
+						DiagDirection side = DiagdirBetweenTiles(tile, ft.m_new_tile);
+						uint local = DiagDirToAxis(side) == AXIS_X ? TileY(tile) - TileY(this->tile_area.tile) : TileX(tile) - TileX(this->tile_area.tile);
+						SetBit(this->edge_traversability_bits[side], local);
+					}
+				}
+			}
+
+			if (increase_label) this->number_of_patches = current_label++;
+		}
+
+		this->initialized = true;
+	}
+};
+
+static std::vector<WaterRegion> _water_regions; ///< All water regions of the map.
+static bool _water_regions_shared = false;       ///< Whether several threads may use the water regions at the same time.
+static std::mutex _water_regions_lock;           ///< Makes the threads update the water regions one at a time while they are shared.
+
+/**
+ * Get a water region, making sure it is up to date.
+ * @param region_x The X coordinate of the water region.
+ * @param region_y The Y coordinate of the water region.
+ * @return The water region.
+ */
+static WaterRegion &GetUpdatedWaterRegion(uint region_x, uint region_y)
+{
+	WaterRegion &region = _water_regions[GetWaterRegionIndex(region_x, region_y)];
+	if (_water_regions_shared) {
+		std::lock_guard<std::mutex> lock(_water_regions_lock);
+		if (!region.IsInitialized()) region.ForceUpdate();
+		return region;
+	}
+	if (!region.IsInitialized()) region.ForceUpdate();
+	return region;
+}
+
+/**
+ * Get a water region, making sure it is up to date.
+ * @param tile A tile in the water region.
+ * @return The water region.
+ */
+static WaterRegion &GetUpdatedWaterRegion(TileIndex tile)
+{
+	return GetUpdatedWaterRegion(TileX(tile) / WATER_REGION_EDGE_LENGTH, TileY(tile) / WATER_REGION_EDGE_LENGTH);
+}
+
+/**
+ * Get the tile at a local position along an edge of a water region.
+ * @param region_x The X coordinate of the water region.
+ * @param region_y The Y coordinate of the water region.
+ * @param side The side of the region.
+ * @param x_or_y The local coordinate along the edge.
+ * @return The tile.
+ */
+static TileIndex GetEdgeTileCoordinate(uint region_x, uint region_y, DiagDirection side, uint x_or_y)
+{
+	assert(x_or_y < WATER_REGION_EDGE_LENGTH);
+	uint bottom_x = region_x * WATER_REGION_EDGE_LENGTH;
+	uint bottom_y = region_y * WATER_REGION_EDGE_LENGTH;
+	switch (side) {
+		case DIAGDIR_NE: return TileXY(bottom_x, bottom_y + x_or_y);
+		case DIAGDIR_SW: return TileXY(bottom_x + WATER_REGION_EDGE_LENGTH - 1, bottom_y + x_or_y);
+		case DIAGDIR_NW: return TileXY(bottom_x + x_or_y, bottom_y);
+		case DIAGDIR_SE: return TileXY(bottom_x + x_or_y, bottom_y + WATER_REGION_EDGE_LENGTH - 1);
+		default: NOT_REACHED();
+	}
+}
+
+/**
+ * Calculate the hash of a water region patch, unique for every patch on the map.
+ * @param water_region_patch The patch.
+ * @return The hash.
+ */
+int CalculateWaterRegionPatchHash(const WaterRegionPatchDesc &water_region_patch)
+{
+	return water_region_patch.label | GetWaterRegionIndex(water_region_patch.x, water_region_patch.y) << 8;
+}
+
+/**
+ * Get the tile in the middle of the region of a water region patch.
+ * @param water_region_patch The patch.
+ * @return The center tile of its region.
+ */
+TileIndex GetWaterRegionCenterTile(const WaterRegionPatchDesc &water_region_patch)
+{
+	return TileXY(water_region_patch.x * WATER_REGION_EDGE_LENGTH + WATER_REGION_EDGE_LENGTH / 2, water_region_patch.y * WATER_REGION_EDGE_LENGTH + WATER_REGION_EDGE_LENGTH / 2);
+}
+
+/**
+ * Get the water region patch a tile belongs to.
+ * @param tile The tile.
+ * @return The patch; its label is #INVALID_WATER_REGION_PATCH when ships cannot use the tile.
+ */
+WaterRegionPatchDesc GetWaterRegionPatchInfo(TileIndex tile)
+{
+	const WaterRegion &region = GetUpdatedWaterRegion(tile);
+	return WaterRegionPatchDesc{ TileX(tile) / WATER_REGION_EDGE_LENGTH, TileY(tile) / WATER_REGION_EDGE_LENGTH, region.GetLabel(tile) };
+}
+
+/**
+ * Mark the water region a tile is in as out of date. As the edges of the
+ * neighbouring regions depend on the tiles across them, those regions are
+ * marked too when the tile is at the edge of its region.
+ * @param tile The tile that changed.
+ */
+void InvalidateWaterRegion(TileIndex tile)
+{
+	if (_water_regions.empty() || tile >= MapSize()) return;
+
+	uint index = GetWaterRegionIndex(tile);
+	_water_regions[index].Invalidate();
+
+	for (DiagDirection side = DIAGDIR_BEGIN; side < DIAGDIR_END; side++) {
+		TileIndex adjacent_tile = AddTileIndexDiffCWrap(tile, TileIndexDiffCByDiagDir(side));
+		if (adjacent_tile == INVALID_TILE) continue;
+		uint adjacent_index = GetWaterRegionIndex(adjacent_tile);
+		if (adjacent_index != index) _water_regions[adjacent_index].Invalidate();
+	}
+}
+
+/**
+ * Call a function for every patch of the neighbouring region on one side that
+ * is connected to the given patch.
+ * @param water_region_patch The patch to start from.
+ * @param side The side of its region to look at.
+ * @param callback The function to call for every connected patch.
+ */
+static void VisitAdjacentWaterRegionPatchNeighbors(const WaterRegionPatchDesc &water_region_patch, DiagDirection side, const TVisitWaterRegionPatchCallBack &callback)
+{
+	const TileIndexDiffC offset = TileIndexDiffCByDiagDir(side);
+	const int nx = (int)water_region_patch.x + offset.x;
+	const int ny = (int)water_region_patch.y + offset.y;
+	if (nx < 0 || ny < 0 || nx >= (int)GetWaterRegionMapSizeX() || ny >= (int)GetWaterRegionMapSizeY()) return;
+
+	const WaterRegion &current_region = GetUpdatedWaterRegion(water_region_patch.x, water_region_patch.y);
+	const WaterRegion &neighboring_region = GetUpdatedWaterRegion(nx, ny);
+	const DiagDirection opposite_side = ReverseDiagDir(side);
+
+	/* The local coordinates along the edge where ships can cross over into the adjacent region. */
+	const TWaterRegionTraversabilityBits traversability_bits = current_region.GetEdgeTraversabilityBits(side) & neighboring_region.GetEdgeTraversabilityBits(opposite_side);
+	if (traversability_bits == 0) return;
+
+	if (current_region.NumberOfPatches() == 1 && neighboring_region.NumberOfPatches() == 1) {
+		/* Nothing to distinguish, so the edge tiles need not be checked. */
+		callback(WaterRegionPatchDesc{ (uint)nx, (uint)ny, FIRST_REGION_LABEL });
+		return;
+	}
+
+	/* Multiple patches can be involved, so check each crossing individually. */
+	TWaterRegionPatchLabel unique_labels[WATER_REGION_EDGE_LENGTH];
+	uint num_labels = 0;
+	for (uint x_or_y = 0; x_or_y < WATER_REGION_EDGE_LENGTH; x_or_y++) {
+		if (!HasBit(traversability_bits, x_or_y)) continue;
+
+		const TileIndex current_edge_tile = GetEdgeTileCoordinate(water_region_patch.x, water_region_patch.y, side, x_or_y);
+		if (current_region.GetLabel(current_edge_tile) != water_region_patch.label) continue;
+
+		const TileIndex neighbor_edge_tile = GetEdgeTileCoordinate(nx, ny, opposite_side, x_or_y);
+		const TWaterRegionPatchLabel neighbor_label = neighboring_region.GetLabel(neighbor_edge_tile);
+		if (std::find(unique_labels, unique_labels + num_labels, neighbor_label) == unique_labels + num_labels) unique_labels[num_labels++] = neighbor_label;
+	}
+	for (uint i = 0; i < num_labels; i++) callback(WaterRegionPatchDesc{ (uint)nx, (uint)ny, unique_labels[i] });
+}
+
+/**
+ * Call a function for every water region patch ships can directly reach
+ * from the given patch, either across the edges of its region or along
+ * aqueducts leading into other regions.
+ * @param water_region_patch The patch to start from.
+ * @param callback The function to call for every neighbouring patch.
+ */
+void VisitWaterRegionPatchNeighbors(const WaterRegionPatchDesc &water_region_patch, const TVisitWaterRegionPatchCallBack &callback)
+{
+	if (water_region_patch.label == INVALID_WATER_REGION_PATCH) return;
+
+	for (DiagDirection side = DIAGDIR_BEGIN; side < DIAGDIR_END; side++) {
+		VisitAdjacentWaterRegionPatchNeighbors(water_region_patch, side, callback);
+	}
+
+	const WaterRegion &current_region = GetUpdatedWaterRegion(water_region_patch.x, water_region_patch.y);
+	if (!current_region.HasCrossRegionAqueducts()) return;
+
+	for (TileIndex tile : current_region.GetTileArea()) {
+		if (current_region.GetLabel(tile) != water_region_patch.label || !IsAqueductTile(tile)) continue;
+
+		const TileIndex other_end_tile = GetOtherBridgeEnd(tile);
+		if (!current_region.GetTileArea().Contains(other_end_tile)) callback(GetWaterRegionPatchInfo(other_end_tile));
+	}
+}
+
+/**
+ * Allow several threads to search paths over the water regions at the same
+ * time. Regions are then updated under a lock; they must not be invalidated
+ * while they are shared.
+ * @param shared Whether the water regions are shared between threads.
+ */
+void SetWaterRegionsShared(bool shared)
+{
+	_water_regions_shared = shared;
+}
+
+/**
+ * (Re)create the water regions for the current map size. They are all out of
+ * date, so they will be calculated when the pathfinder first needs them.
+ */
+void AllocateWaterRegions()
+{
+	_water_regions.clear();
+	_water_regions.reserve(GetWaterRegionMapSizeX() * GetWaterRegionMapSizeY());
+
+	for (uint y = 0; y < GetWaterRegionMapSizeY(); y++) {
+		for (uint x = 0; x < GetWaterRegionMapSizeX(); x++) {
+			_water_regions.emplace_back(x, y);
+		}
+	}
+}
@@ -0,0 +1,48 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file water_regions.h Handles dividing the water in the map into regions to assist pathfinding. */
+
+#ifndef WATER_REGIONS_H
+#define WATER_REGIONS_H
+
+#include "../tile_type.h"
+#include <functional>
+
+typedef uint8 TWaterRegionPatchLabel; ///< Label of a connected patch of water within a water region.
+
+static const uint WATER_REGION_EDGE_LENGTH = 16;                                                    ///< Number of tiles along an edge of a water region.
+static const uint WATER_REGION_NUMBER_OF_TILES = WATER_REGION_EDGE_LENGTH * WATER_REGION_EDGE_LENGTH; ///< Number of tiles in a water region.
+
+static const TWaterRegionPatchLabel INVALID_WATER_REGION_PATCH = 0; ///< Label of tiles that ships cannot use.
+
+/**
+ * Describes a single interconnected patch of water within a particular water region.
+ */
+struct WaterRegionPatchDesc {
+	uint x;                       ///< The X coordinate of the water region, i.e. X=2 is the 3rd water region along the X-axis.
+	uint y;                       ///< The Y coordinate of the water region, i.e. Y=2 is the 3rd water region along the Y-axis.
+	TWaterRegionPatchLabel label; ///< Unique label identifying the patch within the region.
+
+	bool operator==(const WaterRegionPatchDesc &other) const { return x == other.x && y == other.y && label == other.label; }
+	bool operator!=(const WaterRegionPatchDesc &other) const { return !(*this == other); }
+};
+
+/** Callback for visiting water region patches. */
+typedef std::function<void(const WaterRegionPatchDesc &)> TVisitWaterRegionPatchCallBack;
+
+int CalculateWaterRegionPatchHash(const WaterRegionPatchDesc &water_region_patch);
+TileIndex GetWaterRegionCenterTile(const WaterRegionPatchDesc &water_region_patch);
+WaterRegionPatchDesc GetWaterRegionPatchInfo(TileIndex tile);
+
+void InvalidateWaterRegion(TileIndex tile);
+void VisitWaterRegionPatchNeighbors(const WaterRegionPatchDesc &water_region_patch, const TVisitWaterRegionPatchCallBack &callback);
+
+void SetWaterRegionsShared(bool shared);
+void AllocateWaterRegions();
+
+#endif /* WATER_REGIONS_H */
@@ -13,6 +13,8 @@
 #include "../../misc/array.hpp"
 #include "../../misc/hashtable.hpp"
 #include "../../misc/binaryheap.hpp"
+#include <memory>
+#include <vector>
 
 /**
  * Hash table based node list multi-container class.
@@ -48,6 +50,16 @@ public:
 	{
 	}
 
+	/** forget all nodes, keeping the allocated storage for the next search */
+	inline void Clear()
+	{
+		m_arr.Reset();
+		m_open.Clear();
+		m_closed.Clear();
+		m_open_queue.Clear();
+		m_new_node = nullptr;
+	}
+
 	/** return number of open nodes */
 	inline int OpenCount()
 	{
@@ -157,4 +169,43 @@ public:
 	}
 };
 
+/**
+ * Storage of node lists for reuse by later searches. A pathfinder takes a
+ *  node list when it is constructed and gives it back when it is destructed,
+ *  so searches do not allocate and free their node storage over and over.
+ *  Every thread has its own storage, so no locking is needed.
+ */
+template <class Tnodelist>
+class CNodeListPoolT {
+	static const size_t MAX_POOLED = 4; ///< Maximum number of unused node lists kept per thread.
+
+	static thread_local std::vector<std::unique_ptr<Tnodelist>> s_free; ///< Node lists available for reuse.
+
+public:
+	/** take an empty node list from the pool, or create one if there is none */
+	static Tnodelist &Acquire()
+	{
+		if (s_free.empty()) return *new Tnodelist();
+
+		Tnodelist *list = s_free.back().release();
+		s_free.pop_back();
+		return *list;
+	}
+
+	/** give an acquired node list back to the pool */
+	static void Release(Tnodelist &list)
+	{
+		if (s_free.size() >= MAX_POOLED) {
+			delete &list;
+			return;
+		}
+
+		list.Clear();
+		s_free.emplace_back(&list);
+	}
+};
+
+template <class Tnodelist>
+thread_local std::vector<std::unique_ptr<Tnodelist>> CNodeListPoolT<Tnodelist>::s_free;
+
 #endif /* NODELIST_HPP */
@@ -28,6 +28,19 @@
  */
 Track YapfShipChooseTrack(const Ship *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, ShipPathCache &path_cache);
 
+/**
+ * Finds the path of a ship behind the end of its cached path, before the ship gets there.
+ * May be called from worker threads while the water regions are shared and the game state does not change.
+ * @param v        the ship that needs to find a path
+ * @param tile     the tile the ship will enter at the end of its cached path
+ * @param enterdir diagonal direction which the ship will enter this tile from
+ * @param tracks   available tracks on the tile (to choose from)
+ * @param trackdir the last trackdir of the cached path
+ * @param path_found [out] Whether a path has been found (true) or has been guessed (false)
+ * @return         the best trackdir on \a tile or INVALID_TRACKDIR if the path could not be found
+ */
+Trackdir YapfShipChooseTrackAhead(const Ship *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, Trackdir trackdir, bool &path_found, ShipPathCache &path_cache);
+
 /**
  * Returns true if it is better to reverse the ship before leaving depot using YAPF.
  * @param v the ship leaving the depot
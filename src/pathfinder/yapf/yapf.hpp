@@ -13,6 +13,7 @@
 #include "../../landscape.h"
 #include "../pathfinder_func.h"
 #include "../pf_performance_timer.hpp"
+#include "../pf_trace.h"
 #include "yapf.h"
 
 //#undef FORCEINLINE
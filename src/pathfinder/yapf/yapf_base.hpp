@@ -56,7 +56,7 @@ public:
 	typedef typename Node::Key Key;            ///< key to hash tables
 
 
-	NodeList             m_nodes;              ///< node list multi-container
+	NodeList            &m_nodes;              ///< node list multi-container, taken from CNodeListPoolT
 protected:
 	Node                *m_pBestDestNode;      ///< pointer to the destination node found at last round
 	Node                *m_pBestIntermediateNode; ///< here should be node closest to the destination if path not found
@@ -79,7 +79,8 @@ public:
 public:
 	/** default constructor */
 	inline CYapfBaseT()
-		: m_pBestDestNode(nullptr)
+		: m_nodes(CNodeListPoolT<NodeList>::Acquire())
+		, m_pBestDestNode(nullptr)
 		, m_pBestIntermediateNode(nullptr)
 		, m_settings(&_settings_game.pf.yapf)
 		, m_max_search_nodes(PfGetSettings().max_search_nodes)
@@ -91,7 +92,10 @@ public:
 	}
 
 	/** default destructor */
-	~CYapfBaseT() {}
+	~CYapfBaseT()
+	{
+		CNodeListPoolT<NodeList>::Release(m_nodes);
+	}
 
 protected:
 	/** to access inherited path finder */
@@ -151,6 +155,7 @@ public:
 		bDestFound &= (m_pBestDestNode != nullptr);
 
 		perf.Stop();
+		PfTraceNoteSearch(m_num_steps, m_stats_cache_hits, m_stats_cost_calcs);
 		if (_debug_yapf_level >= 2) {
 			int t = perf.Get(1000000);
 			_total_pf_time_us += t;
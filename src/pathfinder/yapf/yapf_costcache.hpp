@@ -11,6 +11,8 @@
 #define YAPF_COSTCACHE_HPP
 
 #include "../../date_func.h"
+#include "../../map_func.h"
+#include <vector>
 
 /**
  * CYapfSegmentCostCacheNoneT - the formal only yapf cost cache provider that implements
@@ -90,21 +92,109 @@ public:
 };
 
 
+/** Rectangle of regions of the map a cached segment passes through, see CSegmentCostCacheBase. */
+struct CSegmentCostCacheArea
+{
+	uint16 left;   ///< Smallest X coordinate of the regions.
+	uint16 top;    ///< Smallest Y coordinate of the regions.
+	uint16 right;  ///< Largest X coordinate of the regions.
+	uint16 bottom; ///< Largest Y coordinate of the regions.
+};
+
 /**
- * Base class for segment cost cache providers. Contains global counter
- *  of track layout changes and static notification function called whenever
+ * Base class for segment cost cache providers. Contains the change bookkeeping
+ *  of the track layout and static notification function called whenever
  *  the track layout changes. It is implemented as base class because it needs
- *  to be shared between all rail YAPF types (one shared counter, one notification
+ *  to be shared between all rail YAPF types (one shared bookkeeping, one notification
  *  function.
+ *
+ * The map is divided into square regions; every track layout change stamps the
+ *  region of the changed tile with an ever increasing change stamp. A cached
+ *  segment remembers the regions it passes through and the change stamp at the time
+ *  it was calculated, so it only becomes invalid when the track in one of those
+ *  regions changed. Changes that are not bound to a tile flush all caches.
  */
 struct CSegmentCostCacheBase
 {
-	static int   s_rail_change_counter;
+	static const uint REGION_SHIFT = 4; ///< Regions are squares of (1 << REGION_SHIFT) tiles.
 
-	static void NotifyTrackLayoutChange(TileIndex tile, Track track)
+	static int    s_rail_change_counter;     ///< Incremented for changes that invalidate all cached segments.
+	static uint32 s_change_stamp;            ///< Stamp of the last change in any region.
+	static std::vector<uint32> s_region_stamps; ///< Stamp of the last change in each region.
+	static uint   s_regions_x;               ///< Number of regions along the X axis of the map.
+	static uint   s_regions_y;               ///< Number of regions along the Y axis of the map.
+
+	/**
+	 * Make sure the region bookkeeping matches the size of the current map.
+	 * When it does not, the cached segments belong to another map and have to be flushed.
+	 */
+	static void CheckRegionMap()
 	{
+		uint regions_x = MapSizeX() >> REGION_SHIFT;
+		uint regions_y = MapSizeY() >> REGION_SHIFT;
+		if (regions_x == s_regions_x && regions_y == s_regions_y) return;
+
+		s_regions_x = regions_x;
+		s_regions_y = regions_y;
+		s_region_stamps.assign(regions_x * regions_y, 0);
+		s_change_stamp = 0;
 		s_rail_change_counter++;
 	}
+
+	static void NotifyTrackLayoutChange(TileIndex tile, Track track)
+	{
+		if (tile == INVALID_TILE) {
+			s_rail_change_counter++;
+			return;
+		}
+
+		CheckRegionMap();
+		if (++s_change_stamp == 0) {
+			/* The stamps wrapped around; start all over. */
+			s_region_stamps.assign(s_region_stamps.size(), 0);
+			s_change_stamp = 1;
+			s_rail_change_counter++;
+		}
+		s_region_stamps[(TileY(tile) >> REGION_SHIFT) * s_regions_x + (TileX(tile) >> REGION_SHIFT)] = s_change_stamp;
+	}
+
+	/**
+	 * Check whether the track layout of an area did not change since a given stamp.
+	 * @param area  Area to check, in regions.
+	 * @param stamp Change stamp the area is compared against.
+	 * @return True if none of the regions of the area changed after \a stamp.
+	 */
+	static bool IsAreaUnchangedSince(const CSegmentCostCacheArea &area, uint32 stamp)
+	{
+		for (uint y = area.top; y <= area.bottom; y++) {
+			const uint32 *row = &s_region_stamps[y * s_regions_x];
+			for (uint x = area.left; x <= area.right; x++) {
+				if (row[x] > stamp) return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Get the area, in regions, around a rectangle of tiles.
+	 * The area includes the neighbouring tiles, as whether a segment ends depends on them too.
+	 * @param left   Smallest X coordinate of the tiles.
+	 * @param top    Smallest Y coordinate of the tiles.
+	 * @param right  Largest X coordinate of the tiles.
+	 * @param bottom Largest Y coordinate of the tiles.
+	 * @return The area of the regions.
+	 */
+	static CSegmentCostCacheArea GetRegionArea(uint left, uint top, uint right, uint bottom)
+	{
+		CheckRegionMap();
+
+		CSegmentCostCacheArea area;
+		area.left   = (left > 0 ? left - 1 : 0) >> REGION_SHIFT;
+		area.top    = (top  > 0 ? top  - 1 : 0) >> REGION_SHIFT;
+		area.right  = min(right  + 1, MapMaxX()) >> REGION_SHIFT;
+		area.bottom = min(bottom + 1, MapMaxY()) >> REGION_SHIFT;
+		return area;
+	}
 };
 
 
@@ -193,6 +283,7 @@ protected:
 		}
 
 		/* delete the cache sometimes... */
+		Cache::CheckRegionMap();
 		if (last_rail_change_counter != Cache::s_rail_change_counter) {
 			last_rail_change_counter = Cache::s_rail_change_counter;
 			C.Flush();
@@ -213,6 +304,11 @@ public:
 		CacheKey key(n.GetKey());
 		bool found;
 		CachedData &item = m_global_cache.Get(key, &found);
+		if (found && item.m_cost >= 0 && !Cache::IsAreaUnchangedSince(item.m_area, item.m_change_stamp)) {
+			/* The track layout around the segment changed; calculate it again. */
+			item.Invalidate();
+			found = false;
+		}
 		Yapf().ConnectNodeToCachedData(n, item);
 		return found;
 	}
@@ -318,6 +318,18 @@ public:
 		/* start at n.m_key.m_tile / n.m_key.m_td and walk to the end of segment */
 		TILE cur(n.m_key.m_tile, n.m_key.m_td);
 
+		/* bounding box of the tiles the segment depends on, for invalidating the cached segment */
+		uint area_left = TileX(cur.tile);
+		uint area_top = TileY(cur.tile);
+		uint area_right = area_left;
+		uint area_bottom = area_top;
+		auto extend_area = [&](TileIndex tile) {
+			area_left   = min(area_left,   TileX(tile));
+			area_top    = min(area_top,    TileY(tile));
+			area_right  = max(area_right,  TileX(tile));
+			area_bottom = max(area_bottom, TileY(tile));
+		};
+
 		/* the previous tile will be needed for transition cost calculations */
 		TILE prev = !has_parent ? TILE() : TILE(n.m_parent->GetLastTile(), n.m_parent->GetLastTrackdir());
 
@@ -371,6 +383,8 @@ public:
 
 no_entry_cost: // jump here at the beginning if the node has no parent (it is the first node)
 
+			extend_area(cur.tile);
+
 			/* All other tile costs will be calculated here. */
 			segment_cost += Yapf().OneTileCost(cur.tile, cur.td);
 
@@ -498,6 +512,9 @@ no_entry_cost: // jump here at the beginning if the node has no parent (it is th
 				break;
 			}
 
+			/* Whether the segment ends depends on the next tile too. */
+			extend_area(tf_local.m_new_tile);
+
 			/* Check if the next tile is not a choice. */
 			if (KillFirstBit(tf_local.m_new_td_bits) != TRACKDIR_BIT_NONE) {
 				/* More than one segment will follow. Close this one. */
@@ -569,6 +586,8 @@ no_entry_cost: // jump here at the beginning if the node has no parent (it is th
 			/* Write back the segment information so it can be reused the next time. */
 			segment.m_cost = segment_cost;
 			segment.m_end_segment_reason = end_segment_reason & ESRB_CACHED_MASK;
+			segment.m_area = CSegmentCostCacheBase::GetRegionArea(area_left, area_top, area_right, area_bottom);
+			segment.m_change_stamp = CSegmentCostCacheBase::s_change_stamp;
 			/* Save end of segment back to the node. */
 			n.SetLastTileTrackdir(cur.tile, cur.td);
 		}
@@ -631,6 +650,11 @@ no_entry_cost: // jump here at the beginning if the node has no parent (it is th
 	{
 		m_disable_cache = disable;
 	}
+
+	inline bool IsCacheDisabled() const
+	{
+		return m_disable_cache;
+	}
 };
 
 #endif /* YAPF_COSTRAIL_HPP */
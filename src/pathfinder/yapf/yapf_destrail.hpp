@@ -118,6 +118,8 @@ protected:
 	TileIndex    m_destTile;
 	TrackdirBits m_destTrackdirs;
 	StationID    m_dest_station_id;
+	TileIndex    m_intermediate_tile; ///< First tile behind the junction of a planned route the search ends at, or INVALID_TILE.
+	Trackdir     m_intermediate_td;   ///< Trackdir behind the junction of a planned route the search ends at.
 
 	/** to access inherited path finder */
 	Tpf& Yapf()
@@ -152,13 +154,33 @@ public:
 				m_destTrackdirs = TrackStatusToTrackdirBits(GetTileTrackStatus(v->dest_tile, TRANSPORT_RAIL, 0));
 				break;
 		}
+		m_intermediate_tile = INVALID_TILE;
+		m_intermediate_td = INVALID_TRACKDIR;
 		CYapfDestinationRailBase::SetDestination(v);
 	}
 
+	/**
+	 * Let the search end at a junction along a route planned over the rail graph,
+	 *  instead of searching all the way to the destination.
+	 * @param tile The first tile behind the junction.
+	 * @param td   The trackdir behind the junction.
+	 */
+	void SetIntermediateDestination(TileIndex tile, Trackdir td)
+	{
+		m_intermediate_tile = tile;
+		m_intermediate_td = td;
+	}
+
+	/** Does the node start at the intermediate destination? */
+	inline bool IsIntermediateDestination(const Node &n) const
+	{
+		return n.GetTile() == m_intermediate_tile && n.GetTrackdir() == m_intermediate_td;
+	}
+
 	/** Called by YAPF to detect if node ends in the desired destination */
 	inline bool PfDetectDestination(Node &n)
 	{
-		return PfDetectDestination(n.GetLastTile(), n.GetLastTrackdir());
+		return IsIntermediateDestination(n) || PfDetectDestination(n.GetLastTile(), n.GetLastTrackdir());
 	}
 
 	/** Called by YAPF to detect if node ends in the desired destination */
@@ -190,8 +212,9 @@ public:
 		DiagDirection exitdir = TrackdirToExitdir(n.GetLastTrackdir());
 		int x1 = 2 * TileX(tile) + dg_dir_to_x_offs[(int)exitdir];
 		int y1 = 2 * TileY(tile) + dg_dir_to_y_offs[(int)exitdir];
-		int x2 = 2 * TileX(m_destTile);
-		int y2 = 2 * TileY(m_destTile);
+		TileIndex dest_tile = (m_intermediate_tile != INVALID_TILE) ? m_intermediate_tile : m_destTile;
+		int x2 = 2 * TileX(dest_tile);
+		int y2 = 2 * TileY(dest_tile);
 		int dx = abs(x1 - x2);
 		int dy = abs(y1 - y2);
 		int dmin = min(dx, dy);
@@ -71,6 +71,8 @@ struct CYapfRailSegment
 	TileIndex              m_last_signal_tile;
 	Trackdir               m_last_signal_td;
 	EndSegmentReasonBits   m_end_segment_reason;
+	CSegmentCostCacheArea  m_area;
+	uint32                 m_change_stamp;
 	CYapfRailSegment      *m_hash_next;
 
 	inline CYapfRailSegment(const CYapfRailSegmentKey &key)
@@ -81,9 +83,22 @@ struct CYapfRailSegment
 		, m_last_signal_tile(INVALID_TILE)
 		, m_last_signal_td(INVALID_TRACKDIR)
 		, m_end_segment_reason(ESRB_NONE)
+		, m_area()
+		, m_change_stamp(0)
 		, m_hash_next(nullptr)
 	{}
 
+	/** Forget the calculated segment, while staying in the hash table. */
+	inline void Invalidate()
+	{
+		m_last_tile = INVALID_TILE;
+		m_last_td = INVALID_TRACKDIR;
+		m_cost = -1;
+		m_last_signal_tile = INVALID_TILE;
+		m_last_signal_td = INVALID_TRACKDIR;
+		m_end_segment_reason = ESRB_NONE;
+	}
+
 	inline const Key& GetKey() const
 	{
 		return m_key;
@@ -14,8 +14,11 @@
 #include "yapf_node_rail.hpp"
 #include "yapf_costrail.hpp"
 #include "yapf_destrail.hpp"
+#include "yapf_rail_graph.hpp"
 #include "../../viewport_func.h"
 #include "../../newgrf_station.h"
+#include "../../framerate_type.h"
+#include "../../trace_zone.h"
 
 #include "../../safeguards.h"
 
@@ -108,6 +111,13 @@ private:
 		return tile != m_res_dest || td != m_res_dest_td;
 	}
 
+	/** Notify the segment cost caches of a reserved track/platform. */
+	bool NotifyReservedTrack(TileIndex tile, Trackdir td)
+	{
+		YapfNotifyTrackLayoutChange(tile, TrackdirToTrack(td));
+		return tile != m_res_dest || td != m_res_dest_td;
+	}
+
 	/** Unreserve a single track/platform. Stops when the previous failer is reached. */
 	bool UnreserveSingleTrack(TileIndex tile, Trackdir td)
 	{
@@ -133,6 +143,12 @@ public:
 		m_res_dest_td = td;
 	}
 
+	/** Get the node the reservation is extended to. */
+	inline const Node *GetReservationTargetNode() const
+	{
+		return m_res_node;
+	}
+
 	/** Check the node for a possible reservation target. */
 	inline void FindSafePositionOnNode(Node *node)
 	{
@@ -180,7 +196,10 @@ public:
 		if (target != nullptr) target->okay = true;
 
 		if (Yapf().CanUseGlobalCache(*m_res_node)) {
-			YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+			/* The reservation changes the cost of the cached segments along the path. */
+			for (Node *node = m_res_node; node->m_parent != nullptr; node = node->m_parent) {
+				node->IterateTiles(Yapf().GetVehicle(), Yapf(), *this, &CYapfReserveTrack<Types>::NotifyReservedTrack);
+			}
 		}
 
 		return true;
@@ -419,7 +438,7 @@ public:
 		return result1;
 	}
 
-	inline Trackdir ChooseRailTrack(const Train *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, bool reserve_track, PBSTileInfo *target)
+	inline Trackdir ChooseRailTrack(const Train *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, bool reserve_track, PBSTileInfo *target, bool plan_route = true)
 	{
 		if (target != nullptr) target->tile = INVALID_TILE;
 
@@ -428,14 +447,25 @@ public:
 		Yapf().SetOrigin(origin.tile, origin.trackdir, INVALID_TILE, INVALID_TRACKDIR, 1, true);
 		Yapf().SetDestination(v);
 
+		/* For long routes plan the route over the rail graph first, so the
+		 * detailed search only has to look up to a junction along it. */
+		TileIndex intermediate_tile;
+		Trackdir intermediate_td;
+		bool planned = plan_route && YapfRailGraphFindIntermediateDestination<TrackFollower>(v, origin.tile, origin.trackdir, &intermediate_tile, &intermediate_td);
+		if (planned) Yapf().SetIntermediateDestination(intermediate_tile, intermediate_td);
+
 		/* find the best path */
 		path_found = Yapf().FindPath(v);
 
+		/* The detailed search could not follow the planned route; search the whole route. */
+		if (planned && !path_found) return this->ChooseRailTrackWithoutPlan(v, tile, enterdir, tracks, path_found, reserve_track, target);
+
 		/* if path not found - return INVALID_TRACKDIR */
 		Trackdir next_trackdir = INVALID_TRACKDIR;
 		Node *pNode = Yapf().GetBestNode();
 		if (pNode != nullptr) {
 			/* reserve till end of path */
+			Node *pBest = pNode;
 			this->SetReservationTarget(pNode, pNode->GetLastTile(), pNode->GetLastTrackdir());
 
 			/* path was found or at least suggested
@@ -447,6 +477,12 @@ public:
 
 				this->FindSafePositionOnNode(pPrev);
 			}
+			/* A junction is no place to end a reservation at; without a safe
+			 * position before it the path has to be searched completely. */
+			if (reserve_track && Yapf().IsIntermediateDestination(*pBest) && this->GetReservationTargetNode() == pBest) {
+				return this->ChooseRailTrackWithoutPlan(v, tile, enterdir, tracks, path_found, reserve_track, target);
+			}
+
 			/* return trackdir from the best origin node (one of start nodes) */
 			Node &best_next_node = *pPrev;
 			next_trackdir = best_next_node.GetTrackdir();
@@ -459,6 +495,14 @@ public:
 		return next_trackdir;
 	}
 
+	/** Choose the track with a new pathfinder that searches the whole route, without planning it over the rail graph. */
+	inline Trackdir ChooseRailTrackWithoutPlan(const Train *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, bool reserve_track, PBSTileInfo *target)
+	{
+		Tpf pf;
+		pf.DisableCache(Yapf().IsCacheDisabled());
+		return pf.ChooseRailTrack(v, tile, enterdir, tracks, path_found, reserve_track, target, false);
+	}
+
 	static bool stCheckReverseTrain(const Train *v, TileIndex t1, Trackdir td1, TileIndex t2, Trackdir td2, int reverse_penalty)
 	{
 		Tpf pf1;
@@ -532,6 +576,9 @@ struct CYapfAnySafeTileRail2 : CYapfT<CYapfRail_TypesT<CYapfAnySafeTileRail2, CF
 
 Track YapfTrainChooseTrack(const Train *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, bool reserve_track, PBSTileInfo *target)
 {
+	PerformanceAccumulator framerate(PFE_GL_YAPF_TRAINS, v->index);
+	TraceZone zone("Train pathfinding", v->index);
+
 	/* default is YAPF type 2 */
 	typedef Trackdir (*PfnChooseRailTrack)(const Train*, TileIndex, DiagDirection, TrackBits, bool&, bool, PBSTileInfo*);
 	PfnChooseRailTrack pfnChooseRailTrack = &CYapfRail1::stChooseRailTrack;
@@ -636,10 +683,15 @@ bool YapfTrainFindNearestSafeTile(const Train *v, TileIndex tile, Trackdir td, b
 	return pfnFindNearestSafeTile(v, tile, td, override_railtype);
 }
 
-/** if any track changes, this counter is incremented - that will invalidate segment cost cache */
+/** if the track changes in a way that is not bound to a tile, this counter is incremented - that will invalidate segment cost cache */
 int CSegmentCostCacheBase::s_rail_change_counter = 0;
+uint32 CSegmentCostCacheBase::s_change_stamp = 0;
+std::vector<uint32> CSegmentCostCacheBase::s_region_stamps;
+uint CSegmentCostCacheBase::s_regions_x = 0;
+uint CSegmentCostCacheBase::s_regions_y = 0;
 
 void YapfNotifyTrackLayoutChange(TileIndex tile, Track track)
 {
 	CSegmentCostCacheBase::NotifyTrackLayoutChange(tile, track);
+	NotifyReservationChange();
 }
@@ -0,0 +1,314 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file yapf_rail_graph.hpp Abstract graph of the rail network, used for planning long routes before searching them in detail. */
+
+#ifndef YAPF_RAIL_GRAPH_HPP
+#define YAPF_RAIL_GRAPH_HPP
+
+static const int RAIL_GRAPH_MAX_EDGE_COST      = 10000;                    ///< Cost after which an edge is split, like the segments of the detailed search.
+static const int RAIL_GRAPH_LOOKAHEAD_COST     = 256 * YAPF_TILE_LENGTH;   ///< Cost of the part of a planned route the detailed search covers.
+static const uint RAIL_GRAPH_MIN_ROUTE_DISTANCE = 512;                     ///< Minimal distance, in tiles, to the destination before a route is planned.
+static const int RAIL_GRAPH_NODES_FACTOR       = 4;                        ///< Number of graph nodes searched per node of the detailed search.
+
+/**
+ * Abstract graph of the rail network. The nodes are the tile/trackdirs just
+ *  behind junctions, the edges the track between them, cached in their own
+ *  CSegmentCostCacheT. The cost of an edge only depends on the track layout
+ *  (length, tunnels and bridges), never on the vehicle or on signal states,
+ *  so every cached edge is identical to a freshly calculated one.
+ * @tparam TrackFollower Track follower the graph is built with.
+ */
+template <class TrackFollower>
+struct CYapfRailGraphT
+{
+	typedef CSegmentCostCacheT<CYapfRailSegment> Cache;
+
+	/** Get the cache with the edges, flushing it when the rail network changed as a whole. */
+	static Cache &GetCache()
+	{
+		static int last_rail_change_counter = 0;
+		static Cache C;
+
+		Cache::CheckRegionMap();
+		if (last_rail_change_counter != Cache::s_rail_change_counter) {
+			last_rail_change_counter = Cache::s_rail_change_counter;
+			C.Flush();
+		}
+		return C;
+	}
+
+	/**
+	 * Follow the track from the start of an edge until the next junction or
+	 *  any other reason the segments of the detailed search end.
+	 * @param edge The edge to calculate; its key is the first tile/trackdir.
+	 */
+	static void CalcEdge(CYapfRailSegment &edge)
+	{
+		TileIndex tile = edge.m_key.GetTile();
+		Trackdir td = edge.m_key.GetTrackdir();
+
+		/* Only follow track of the same owner and rail type; the search
+		 * decides whether the vehicle can continue on the next edge. */
+		RailTypes railtypes = RAILTYPES_NONE;
+		SetBit(railtypes, GetTileRailType(tile));
+		TrackFollower F(GetTileOwner(tile), railtypes);
+
+		uint area_left = TileX(tile);
+		uint area_top = TileY(tile);
+		uint area_right = area_left;
+		uint area_bottom = area_top;
+		auto extend_area = [&](TileIndex t) {
+			area_left   = min(area_left,   TileX(t));
+			area_top    = min(area_top,    TileY(t));
+			area_right  = max(area_right,  TileX(t));
+			area_bottom = max(area_bottom, TileY(t));
+		};
+
+		int cost = 0;
+		EndSegmentReasonBits end_segment_reason = ESRB_NONE;
+		for (;;) {
+			extend_area(tile);
+			cost += IsDiagonalTrackdir(td) ? YAPF_TILE_LENGTH : YAPF_TILE_CORNER_LENGTH;
+
+			if (IsRailDepotTile(tile)) {
+				end_segment_reason |= ESRB_DEPOT;
+			} else if (HasStationTileRail(tile)) {
+				end_segment_reason |= IsRailWaypoint(tile) ? ESRB_WAYPOINT : ESRB_STATION;
+			} else if (HasOnewaySignalBlockingTrackdir(tile, td)) {
+				end_segment_reason |= ESRB_DEAD_END;
+			}
+			if (end_segment_reason != ESRB_NONE) break;
+
+			if (!F.Follow(tile, td)) {
+				end_segment_reason |= (F.m_err == TrackFollower::EC_RAIL_ROAD_TYPE) ? ESRB_RAIL_TYPE : ESRB_DEAD_END;
+				break;
+			}
+
+			extend_area(F.m_new_tile);
+
+			if (KillFirstBit(F.m_new_td_bits) != TRACKDIR_BIT_NONE) {
+				end_segment_reason |= ESRB_CHOICE_FOLLOWS;
+				break;
+			}
+
+			Trackdir next_td = FindFirstTrackdir(F.m_new_td_bits);
+			if (F.m_new_tile == edge.m_key.GetTile() && next_td == edge.m_key.GetTrackdir()) {
+				end_segment_reason |= ESRB_INFINITE_LOOP;
+				break;
+			}
+
+			if (cost > RAIL_GRAPH_MAX_EDGE_COST && IsTileType(F.m_new_tile, MP_RAILWAY)) {
+				end_segment_reason |= ESRB_SEGMENT_TOO_LONG;
+				break;
+			}
+
+			cost += YAPF_TILE_LENGTH * F.m_tiles_skipped;
+			tile = F.m_new_tile;
+			td = next_td;
+		}
+
+		edge.m_last_tile = tile;
+		edge.m_last_td = td;
+		edge.m_cost = cost;
+		edge.m_end_segment_reason = end_segment_reason;
+		edge.m_area = CSegmentCostCacheBase::GetRegionArea(area_left, area_top, area_right, area_bottom);
+		edge.m_change_stamp = CSegmentCostCacheBase::s_change_stamp;
+	}
+
+	/**
+	 * Get the edge starting at a tile/trackdir, calculating it when it is not cached or outdated.
+	 * @param key The first tile/trackdir of the edge.
+	 * @return The edge.
+	 */
+	static const CYapfRailSegment &GetEdge(const CYapfNodeKeyTrackDir &key)
+	{
+		CYapfRailSegmentKey edge_key(key);
+		bool found;
+		CYapfRailSegment &edge = GetCache().Get(edge_key, &found);
+		if (found && edge.m_cost >= 0 && !Cache::IsAreaUnchangedSince(edge.m_area, edge.m_change_stamp)) found = false;
+		if (!found || edge.m_cost < 0) CalcEdge(edge);
+		return edge;
+	}
+};
+
+/** Yapf Node for the rail graph; it stores a copy of the edge it ends with. */
+template <class Tkey_>
+struct CYapfRailGraphNodeT
+	: CYapfNodeT<Tkey_, CYapfRailGraphNodeT<Tkey_> >
+{
+	typedef CYapfNodeT<Tkey_, CYapfRailGraphNodeT<Tkey_> > base;
+
+	TileIndex            m_last_tile;          ///< Last tile of the edge.
+	Trackdir             m_last_td;            ///< Last trackdir of the edge.
+	EndSegmentReasonBits m_end_segment_reason; ///< Why the edge ends.
+
+	inline void Set(CYapfRailGraphNodeT *parent, TileIndex tile, Trackdir td, bool is_choice)
+	{
+		base::Set(parent, tile, td, is_choice);
+		m_last_tile = tile;
+		m_last_td = td;
+		m_end_segment_reason = ESRB_NONE;
+	}
+
+	inline TileIndex GetLastTile() const
+	{
+		return m_last_tile;
+	}
+
+	inline Trackdir GetLastTrackdir() const
+	{
+		return m_last_td;
+	}
+};
+
+typedef CYapfRailGraphNodeT<CYapfNodeKeyTrackDir> CYapfRailGraphNode;
+typedef CNodeList_HashTableT<CYapfRailGraphNode, 10, 12> CRailGraphNodeList;
+
+/** Node Follower module of YAPF for the rail graph. */
+template <class Types>
+class CYapfFollowRailGraphT
+{
+public:
+	typedef typename Types::Tpf Tpf;                     ///< the pathfinder class (derived from THIS class)
+	typedef typename Types::TrackFollower TrackFollower;
+	typedef typename Types::NodeList::Titem Node;        ///< this will be our node type
+
+protected:
+	/** to access inherited path finder */
+	inline Tpf& Yapf()
+	{
+		return *static_cast<Tpf *>(this);
+	}
+
+public:
+	/** Called by YAPF to move from the end of the given edge to the edges behind it. */
+	inline void PfFollowNode(Node &old_node)
+	{
+		TrackFollower F(Yapf().GetVehicle());
+		if (F.Follow(old_node.GetLastTile(), old_node.GetLastTrackdir())) {
+			Yapf().AddMultipleNodes(&old_node, F);
+		}
+	}
+
+	/** return debug report character to identify the transportation type */
+	inline char TransportTypeChar() const
+	{
+		return 'g';
+	}
+};
+
+/** Cost Provider of YAPF for the rail graph. */
+template <class Types>
+class CYapfCostRailGraphT
+{
+public:
+	typedef typename Types::Tpf Tpf;                     ///< the pathfinder class (derived from THIS class)
+	typedef typename Types::TrackFollower TrackFollower;
+	typedef typename Types::NodeList::Titem Node;        ///< this will be our node type
+
+protected:
+	/** to access inherited path finder */
+	inline Tpf& Yapf()
+	{
+		return *static_cast<Tpf *>(this);
+	}
+
+public:
+	/** The graph is always cached; called by the destination for complex waypoints. */
+	void DisableCache(bool disable)
+	{
+	}
+
+	/**
+	 * Called by YAPF to calculate the cost from the origin to the given node.
+	 *  The edges starting right at the origin are usually not behind a junction,
+	 *  so they are calculated without being added to the cache.
+	 */
+	inline bool PfCalcCost(Node &n, const TrackFollower *tf)
+	{
+		CYapfRailSegment local_edge(CYapfRailSegmentKey(n.GetKey()));
+		const CYapfRailSegment *edge = &local_edge;
+		if (n.m_parent->m_parent == nullptr) {
+			CYapfRailGraphT<TrackFollower>::CalcEdge(local_edge);
+		} else {
+			edge = &CYapfRailGraphT<TrackFollower>::GetEdge(n.GetKey());
+		}
+
+		n.m_last_tile = edge->m_last_tile;
+		n.m_last_td = edge->m_last_td;
+		n.m_end_segment_reason = edge->m_end_segment_reason;
+		n.m_cost = n.m_parent->m_cost + YAPF_TILE_LENGTH * tf->m_tiles_skipped + edge->m_cost;
+
+		bool target_seen = (edge->m_end_segment_reason & ESRB_POSSIBLE_TARGET) != ESRB_NONE && Yapf().PfDetectDestination(n.m_last_tile, n.m_last_td);
+		return target_seen || (edge->m_end_segment_reason & ESRB_ABORT_PF_MASK) == ESRB_NONE;
+	}
+};
+
+/** Config struct of YAPF for the rail graph. */
+template <class Tpf_, class Ttrack_follower>
+struct CYapfRailGraph_TypesT
+{
+	typedef CYapfRailGraph_TypesT<Tpf_, Ttrack_follower> Types;
+
+	typedef Tpf_                                       Tpf;
+	typedef Ttrack_follower                            TrackFollower;
+	typedef CRailGraphNodeList                         NodeList;
+	typedef Train                                      VehicleType;
+	typedef CYapfBaseT<Types>                          PfBase;
+	typedef CYapfFollowRailGraphT<Types>               PfFollow;
+	typedef CYapfOriginTileTwoWayT<Types>              PfOrigin;
+	typedef CYapfDestinationTileOrStationRailT<Types>  PfDestination;
+	typedef CYapfSegmentCostCacheNoneT<Types>          PfCache;
+	typedef CYapfCostRailGraphT<Types>                 PfCost;
+};
+
+/** YAPF pathfinder for the rail graph. */
+template <class TrackFollower>
+struct CYapfRailGraphPathT : CYapfT<CYapfRailGraph_TypesT<CYapfRailGraphPathT<TrackFollower>, TrackFollower> >
+{
+	/** Create the pathfinder; searching edges is cheap, so it may visit more nodes than the detailed search. */
+	CYapfRailGraphPathT()
+	{
+		this->m_max_search_nodes *= RAIL_GRAPH_NODES_FACTOR;
+	}
+};
+
+/**
+ * Plan the route of a train over the rail graph and find the junction on it
+ *  up to which the detailed search has to look.
+ * @param v         The train.
+ * @param tile      The tile the route starts at.
+ * @param td        The trackdir the route starts with.
+ * @param[out] dest_tile The first tile behind the junction.
+ * @param[out] dest_td   The trackdir behind the junction.
+ * @return True if the route is long enough to plan and a route was found.
+ */
+template <class TrackFollower>
+bool YapfRailGraphFindIntermediateDestination(const Train *v, TileIndex tile, Trackdir td, TileIndex *dest_tile, Trackdir *dest_td)
+{
+	if (v->dest_tile == INVALID_TILE || DistanceManhattan(tile, v->dest_tile) < RAIL_GRAPH_MIN_ROUTE_DISTANCE) return false;
+
+	CYapfRailGraphPathT<TrackFollower> pf;
+	pf.SetOrigin(tile, td, INVALID_TILE, INVALID_TRACKDIR, 1, true);
+	pf.SetDestination(v);
+	if (!pf.FindPath(v)) return false;
+
+	/* Walking back from the destination, the junction closest to the origin
+	 * that is at least the look ahead away is the one we want. */
+	const CYapfRailGraphNode *intermediate = nullptr;
+	for (const CYapfRailGraphNode *node = pf.GetBestNode(); node->m_parent != nullptr; node = node->m_parent) {
+		if (node->GetIsChoice() && node->GetCost() >= RAIL_GRAPH_LOOKAHEAD_COST) intermediate = node;
+	}
+	if (intermediate == nullptr) return false;
+
+	*dest_tile = intermediate->GetTile();
+	*dest_td = intermediate->GetTrackdir();
+	return true;
+}
+
+#endif /* YAPF_RAIL_GRAPH_HPP */
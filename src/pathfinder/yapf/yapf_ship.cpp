@@ -11,9 +11,13 @@
 #include "../../ship.h"
 #include "../../industry.h"
 #include "../../vehicle_func.h"
+#include "../../framerate_type.h"
+#include "../../trace_zone.h"
 
 #include "yapf.hpp"
 #include "yapf_node_ship.hpp"
+#include "yapf_ship_regions.h"
+#include "../water_regions.h"
 
 #include "../../safeguards.h"
 
@@ -31,6 +35,10 @@ protected:
 	TrackdirBits m_destTrackdirs;
 	StationID    m_destStation;
 
+	bool                 m_has_intermediate_dest = false;
+	TileIndex            m_intermediate_dest_tile;
+	WaterRegionPatchDesc m_intermediate_dest_region_patch;
+
 public:
 	void SetDestination(const Ship *v)
 	{
@@ -45,6 +53,14 @@ public:
 		}
 	}
 
+	/** Go towards any tile of a water region patch on the way instead of to the final destination. */
+	void SetIntermediateDestination(const WaterRegionPatchDesc &water_region_patch)
+	{
+		m_has_intermediate_dest = true;
+		m_intermediate_dest_tile = GetWaterRegionCenterTile(water_region_patch);
+		m_intermediate_dest_region_patch = water_region_patch;
+	}
+
 protected:
 	/** to access inherited path finder */
 	inline Tpf& Yapf()
@@ -61,6 +77,10 @@ public:
 
 	inline bool PfDetectDestinationTile(TileIndex tile, Trackdir trackdir)
 	{
+		if (m_has_intermediate_dest) {
+			return GetWaterRegionPatchInfo(tile) == m_intermediate_dest_region_patch;
+		}
+
 		if (m_destStation != INVALID_STATION) {
 			return IsDockingTile(tile) && IsShipDestinationTile(tile, m_destStation);
 		}
@@ -85,8 +105,9 @@ public:
 		DiagDirection exitdir = TrackdirToExitdir(n.m_segment_last_td);
 		int x1 = 2 * TileX(tile) + dg_dir_to_x_offs[(int)exitdir];
 		int y1 = 2 * TileY(tile) + dg_dir_to_y_offs[(int)exitdir];
-		int x2 = 2 * TileX(m_destTile);
-		int y2 = 2 * TileY(m_destTile);
+		TileIndex dest_tile = m_has_intermediate_dest ? m_intermediate_dest_tile : m_destTile;
+		int x2 = 2 * TileX(dest_tile);
+		int y2 = 2 * TileY(dest_tile);
 		int dx = abs(x1 - x2);
 		int dy = abs(y1 - y2);
 		int dmin = min(dx, dy);
@@ -110,6 +131,8 @@ public:
 	typedef typename Node::Key Key;                      ///< key to hash tables
 
 protected:
+	std::vector<WaterRegionPatchDesc> m_water_region_corridor; ///< if not empty, only tiles in these water region patches are searched
+
 	/** to access inherited path finder */
 	inline Tpf& Yapf()
 	{
@@ -117,6 +140,12 @@ protected:
 	}
 
 public:
+	/** Only search the tiles in the given water region patches. */
+	inline void RestrictSearch(const std::vector<WaterRegionPatchDesc> &path)
+	{
+		m_water_region_corridor = path;
+	}
+
 	/**
 	 * Called by YAPF to move from the given node to the next tile. For each
 	 *  reachable trackdir on the new tile creates new node, initializes it
@@ -126,6 +155,10 @@ public:
 	{
 		TrackFollower F(Yapf().GetVehicle());
 		if (F.Follow(old_node.m_key.m_tile, old_node.m_key.m_td)) {
+			if (!m_water_region_corridor.empty() &&
+					std::find(m_water_region_corridor.begin(), m_water_region_corridor.end(), GetWaterRegionPatchInfo(F.m_new_tile)) == m_water_region_corridor.end()) {
+				return;
+			}
 			Yapf().AddMultipleNodes(&old_node, F);
 		}
 	}
@@ -136,7 +169,7 @@ public:
 		return 'w';
 	}
 
-	static Trackdir ChooseShipTrack(const Ship *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, ShipPathCache &path_cache)
+	static Trackdir ChooseShipTrack(const Ship *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, Trackdir trackdir, bool &path_found, ShipPathCache &path_cache)
 	{
 		/* handle special case - when next tile is destination tile */
 		if (tile == v->dest_tile) {
@@ -146,29 +179,46 @@ public:
 			trackdirs &= DiagdirReachesTrackdirs(enterdir);
 
 			/* use vehicle's current direction if that's possible, otherwise use first usable one. */
-			Trackdir veh_dir = v->GetVehicleTrackdir();
-			return (HasTrackdir(trackdirs, veh_dir)) ? veh_dir : (Trackdir)FindFirstBit2x64(trackdirs);
+			return (HasTrackdir(trackdirs, trackdir)) ? trackdir : (Trackdir)FindFirstBit2x64(trackdirs);
 		}
 
 		/* move back to the old tile/trackdir (where ship is coming from) */
 		TileIndex src_tile = TileAddByDiagDir(tile, ReverseDiagDir(enterdir));
-		Trackdir trackdir = v->GetVehicleTrackdir();
 		assert(IsValidTrackdir(trackdir));
 
 		/* convert origin trackdir to TrackdirBits */
 		TrackdirBits trackdirs = TrackdirToTrackdirBits(trackdir);
 
+		/* Find the water region patches on the way to the destination first; the
+		 * tile search then only has to reach the last of the first few of them. */
+		const std::vector<WaterRegionPatchDesc> high_level_path = YapfShipFindWaterRegionPath(v, tile, WATER_REGION_LOOKAHEAD + 1);
+
 		/* create pathfinder instance */
 		Tpf pf;
 		/* set origin and destination nodes */
 		pf.SetOrigin(src_tile, trackdirs);
 		pf.SetDestination(v);
+		if (high_level_path.size() > WATER_REGION_LOOKAHEAD) pf.SetIntermediateDestination(high_level_path.back());
 		/* find best path */
 		path_found = pf.FindPath(v);
 
+		/* The unrestricted search gives the most natural paths, but it can run
+		 * out of nodes, e.g. in mazes of canals. There is a path though, so
+		 * search again only over the water region patches on the way. */
+		Tpf pf_restricted;
+		Tpf *best_pf = &pf;
+		if (!path_found && !high_level_path.empty()) {
+			pf_restricted.SetOrigin(src_tile, trackdirs);
+			pf_restricted.SetDestination(v);
+			if (high_level_path.size() > WATER_REGION_LOOKAHEAD) pf_restricted.SetIntermediateDestination(high_level_path.back());
+			pf_restricted.RestrictSearch(high_level_path);
+			path_found = pf_restricted.FindPath(v);
+			if (path_found) best_pf = &pf_restricted;
+		}
+
 		Trackdir next_trackdir = INVALID_TRACKDIR; // this would mean "path not found"
 
-		Node *pNode = pf.GetBestNode();
+		Node *pNode = best_pf->GetBestNode();
 		if (pNode != nullptr) {
 			uint steps = 0;
 			for (Node *n = pNode; n->m_parent != nullptr; n = n->m_parent) steps++;
@@ -208,11 +258,14 @@ public:
 	 */
 	static bool CheckShipReverse(const Ship *v, TileIndex tile, Trackdir td1, Trackdir td2)
 	{
+		const std::vector<WaterRegionPatchDesc> high_level_path = YapfShipFindWaterRegionPath(v, tile, WATER_REGION_LOOKAHEAD + 1);
+
 		/* create pathfinder instance */
 		Tpf pf;
 		/* set origin and destination nodes */
 		pf.SetOrigin(tile, TrackdirToTrackdirBits(td1) | TrackdirToTrackdirBits(td2));
 		pf.SetDestination(v);
+		if (high_level_path.size() > WATER_REGION_LOOKAHEAD) pf.SetIntermediateDestination(high_level_path.back());
 		/* find best path */
 		if (!pf.FindPath(v)) return false;
 
@@ -347,11 +400,21 @@ static inline bool RequireTrackdirKey()
 	return _settings_game.pf.yapf.ship_curve45_penalty != _settings_game.pf.yapf.ship_curve90_penalty;
 }
 
-/** Ship controller helper - path finder invoker */
-Track YapfShipChooseTrack(const Ship *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, ShipPathCache &path_cache)
+/**
+ * Find the path of a ship that is about to enter a tile.
+ * @param v          The ship.
+ * @param tile       The tile the ship is about to enter.
+ * @param enterdir   The direction the ship enters the tile in.
+ * @param tracks     The available tracks on \a tile.
+ * @param trackdir   The trackdir of the ship on the tile before \a tile.
+ * @param[out] path_found Whether a path to the destination was found.
+ * @param[out] path_cache The path after \a tile is appended to this.
+ * @return The trackdir to take on \a tile, or INVALID_TRACKDIR.
+ */
+static Trackdir YapfShipFindPath(const Ship *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, Trackdir trackdir, bool &path_found, ShipPathCache &path_cache)
 {
 	/* default is YAPF type 2 */
-	typedef Trackdir (*PfnChooseShipTrack)(const Ship*, TileIndex, DiagDirection, TrackBits, bool &path_found, ShipPathCache &path_cache);
+	typedef Trackdir (*PfnChooseShipTrack)(const Ship*, TileIndex, DiagDirection, TrackBits, Trackdir, bool &path_found, ShipPathCache &path_cache);
 	PfnChooseShipTrack pfnChooseShipTrack = CYapfShip2::ChooseShipTrack; // default: ExitDir
 
 	/* check if non-default YAPF type needed */
@@ -359,10 +422,25 @@ Track YapfShipChooseTrack(const Ship *v, TileIndex tile, DiagDirection enterdir,
 		pfnChooseShipTrack = &CYapfShip1::ChooseShipTrack; // Trackdir
 	}
 
-	Trackdir td_ret = pfnChooseShipTrack(v, tile, enterdir, tracks, path_found, path_cache);
+	return pfnChooseShipTrack(v, tile, enterdir, tracks, trackdir, path_found, path_cache);
+}
+
+/** Ship controller helper - path finder invoker */
+Track YapfShipChooseTrack(const Ship *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, ShipPathCache &path_cache)
+{
+	PerformanceAccumulator framerate(PFE_GL_YAPF_SHIPS, v->index);
+	TraceZone zone("Ship pathfinding", v->index);
+
+	Trackdir td_ret = YapfShipFindPath(v, tile, enterdir, tracks, v->GetVehicleTrackdir(), path_found, path_cache);
 	return (td_ret != INVALID_TRACKDIR) ? TrackdirToTrack(td_ret) : INVALID_TRACK;
 }
 
+/** Ship controller helper - path finder invoker for paths searched ahead of time */
+Trackdir YapfShipChooseTrackAhead(const Ship *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, Trackdir trackdir, bool &path_found, ShipPathCache &path_cache)
+{
+	return YapfShipFindPath(v, tile, enterdir, tracks, trackdir, path_found, path_cache);
+}
+
 bool YapfShipCheckReverse(const Ship *v)
 {
 	Trackdir td = v->GetVehicleTrackdir();
@@ -0,0 +1,319 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file yapf_ship_regions.cpp Implementation of YAPF for water regions, which are used for finding intermediate ship destinations. */
+
+#include "../../stdafx.h"
+#include "../../ship.h"
+
+#include "yapf.hpp"
+#include "yapf_ship_regions.h"
+#include "../water_regions.h"
+
+#include "../../safeguards.h"
+
+static const int DIRECT_NEIGHBOR_COST = 100;           ///< Cost of moving to a directly neighbouring water region.
+static const int NODES_PER_REGION = 4;                 ///< Nodes reserved per water region; nearly all regions have only one or two patches.
+static const int MAX_NUMBER_OF_NODES = 65536;          ///< Maximum number of nodes the region pathfinder visits.
+
+/** Yapf Node Key that represents a single patch of interconnected water within a water region. */
+struct CYapfRegionPatchNodeKey {
+	WaterRegionPatchDesc m_water_region_patch;
+
+	inline void Set(const WaterRegionPatchDesc &water_region_patch)
+	{
+		m_water_region_patch = water_region_patch;
+	}
+
+	inline int CalcHash() const
+	{
+		return CalculateWaterRegionPatchHash(m_water_region_patch);
+	}
+
+	inline bool operator==(const CYapfRegionPatchNodeKey &other) const
+	{
+		return m_water_region_patch == other.m_water_region_patch;
+	}
+};
+
+/**
+ * Manhattan distance between the water regions of two patches.
+ * @param a The first patch.
+ * @param b The second patch.
+ * @return The distance counted in water regions.
+ */
+static inline int ManhattanDistance(const CYapfRegionPatchNodeKey &a, const CYapfRegionPatchNodeKey &b)
+{
+	return (Delta(a.m_water_region_patch.x, b.m_water_region_patch.x) + Delta(a.m_water_region_patch.y, b.m_water_region_patch.y)) * DIRECT_NEIGHBOR_COST;
+}
+
+/** Yapf Node for water regions. */
+template <class Tkey_>
+struct CYapfRegionNodeT {
+	typedef Tkey_ Key;
+	typedef CYapfRegionNodeT<Tkey_> Node;
+
+	Tkey_ m_key;
+	Node *m_hash_next;
+	Node *m_parent;
+	int   m_cost;
+	int   m_estimate;
+
+	inline void Set(Node *parent, const WaterRegionPatchDesc &water_region_patch)
+	{
+		m_key.Set(water_region_patch);
+		m_hash_next = nullptr;
+		m_parent = parent;
+		m_cost = 0;
+		m_estimate = 0;
+	}
+
+	inline Node *GetHashNext() { return m_hash_next; }
+	inline void SetHashNext(Node *pNext) { m_hash_next = pNext; }
+	inline const Tkey_ &GetKey() const { return m_key; }
+	inline int GetCost() const { return m_cost; }
+	inline int GetCostEstimate() const { return m_estimate; }
+	inline bool operator<(const Node &other) const { return m_estimate < other.m_estimate; }
+};
+
+/** YAPF origin for water regions. */
+template <class Types>
+class CYapfOriginRegionT
+{
+public:
+	typedef typename Types::Tpf Tpf;              ///< the pathfinder class (derived from THIS class)
+	typedef typename Types::NodeList::Titem Node; ///< this will be our node type
+	typedef typename Node::Key Key;               ///< key to hash tables
+
+protected:
+	std::vector<CYapfRegionPatchNodeKey> m_origin_keys; ///< origin patches
+
+	/** to access inherited path finder */
+	inline Tpf& Yapf()
+	{
+		return *static_cast<Tpf *>(this);
+	}
+
+public:
+	/** Add an origin patch */
+	void AddOrigin(const WaterRegionPatchDesc &water_region_patch)
+	{
+		if (water_region_patch.label == INVALID_WATER_REGION_PATCH || this->HasOrigin(water_region_patch)) return;
+		m_origin_keys.push_back(CYapfRegionPatchNodeKey{ water_region_patch });
+	}
+
+	/** Is the patch one of the origins? */
+	bool HasOrigin(const WaterRegionPatchDesc &water_region_patch) const
+	{
+		for (const CYapfRegionPatchNodeKey &key : m_origin_keys) {
+			if (key.m_water_region_patch == water_region_patch) return true;
+		}
+		return false;
+	}
+
+	/** Are there any origins? */
+	bool HasOrigins() const
+	{
+		return !m_origin_keys.empty();
+	}
+
+	/** Called when YAPF needs to place origin nodes into open list */
+	void PfSetStartupNodes()
+	{
+		for (const CYapfRegionPatchNodeKey &origin_key : m_origin_keys) {
+			Node &node = Yapf().CreateNewNode();
+			node.Set(nullptr, origin_key.m_water_region_patch);
+			Yapf().AddStartupNode(node);
+		}
+	}
+};
+
+/** YAPF destination provider for water regions. */
+template <class Types>
+class CYapfDestinationRegionT
+{
+public:
+	typedef typename Types::Tpf Tpf;              ///< the pathfinder class (derived from THIS class)
+	typedef typename Types::NodeList::Titem Node; ///< this will be our node type
+	typedef typename Node::Key Key;               ///< key to hash tables
+
+protected:
+	Key m_dest; ///< destination patch
+
+public:
+	/** Set the destination patch */
+	void SetDestination(const WaterRegionPatchDesc &water_region_patch)
+	{
+		m_dest.Set(water_region_patch);
+	}
+
+	/** Called by YAPF to detect if node ends in the desired destination */
+	inline bool PfDetectDestination(Node &n) const
+	{
+		return n.m_key == m_dest;
+	}
+
+	/** Called by YAPF to calculate cost estimate, which is the number of regions to the destination times the cost per region */
+	inline bool PfCalcEstimate(Node &n)
+	{
+		if (PfDetectDestination(n)) {
+			n.m_estimate = n.m_cost;
+			return true;
+		}
+
+		n.m_estimate = n.m_cost + ManhattanDistance(n.m_key, m_dest);
+		return true;
+	}
+};
+
+/** Node Follower module of YAPF for water regions */
+template <class Types>
+class CYapfFollowRegionT
+{
+public:
+	typedef typename Types::Tpf Tpf;                     ///< the pathfinder class (derived from THIS class)
+	typedef typename Types::TrackFollower TrackFollower;
+	typedef typename Types::NodeList::Titem Node;        ///< this will be our node type
+	typedef typename Node::Key Key;                      ///< key to hash tables
+
+protected:
+	/** to access inherited path finder */
+	inline Tpf& Yapf()
+	{
+		return *static_cast<Tpf *>(this);
+	}
+
+public:
+	/** Called by YAPF to move from the given node to the neighbouring patches */
+	inline void PfFollowNode(Node &old_node)
+	{
+		VisitWaterRegionPatchNeighbors(old_node.m_key.m_water_region_patch, [&](const WaterRegionPatchDesc &water_region_patch) {
+			Node &node = Yapf().CreateNewNode();
+			node.Set(&old_node, water_region_patch);
+			Yapf().AddNewNode(node, TrackFollower());
+		});
+	}
+
+	/** return debug report character to identify the transportation type */
+	inline char TransportTypeChar() const
+	{
+		return '^';
+	}
+
+	static std::vector<WaterRegionPatchDesc> FindWaterRegionPath(const Ship *v, TileIndex start_tile, uint max_returned_path_length)
+	{
+		const WaterRegionPatchDesc start_water_region_patch = GetWaterRegionPatchInfo(start_tile);
+		if (start_water_region_patch.label == INVALID_WATER_REGION_PATCH) return {};
+
+		/* The search runs backwards, from the destination to the ship, so the
+		 * parents of the best node lead from the ship towards the destination. */
+		Tpf pf(min(MapSize() * NODES_PER_REGION / WATER_REGION_NUMBER_OF_TILES, (uint)MAX_NUMBER_OF_NODES));
+		pf.SetDestination(start_water_region_patch);
+
+		if (v->current_order.IsType(OT_GOTO_STATION)) {
+			StationID station_id = v->current_order.GetDestination();
+			const BaseStation *station = BaseStation::Get(station_id);
+			TileArea tile_area;
+			station->GetTileArea(&tile_area, STATION_DOCK);
+			for (TileIndex tile : tile_area) {
+				if (IsDockingTile(tile) && IsShipDestinationTile(tile, station_id)) pf.AddOrigin(GetWaterRegionPatchInfo(tile));
+			}
+		} else {
+			pf.AddOrigin(GetWaterRegionPatchInfo(v->dest_tile));
+		}
+		if (!pf.HasOrigins()) return {};
+
+		/* If origin and destination are the same we simply return that patch. */
+		std::vector<WaterRegionPatchDesc> path = { start_water_region_patch };
+		if (pf.HasOrigin(start_water_region_patch)) return path;
+
+		if (!pf.FindPath(v)) return {};
+
+		Node *node = pf.GetBestNode();
+		while (path.size() < max_returned_path_length && node->m_parent != nullptr) {
+			node = node->m_parent;
+			path.push_back(node->m_key.m_water_region_patch);
+		}
+		return path;
+	}
+};
+
+/** Cost Provider of YAPF for water regions */
+template <class Types>
+class CYapfCostRegionT
+{
+public:
+	typedef typename Types::Tpf Tpf;                     ///< the pathfinder class (derived from THIS class)
+	typedef typename Types::TrackFollower TrackFollower;
+	typedef typename Types::NodeList::Titem Node;        ///< this will be our node type
+	typedef typename Node::Key Key;                      ///< key to hash tables
+
+public:
+	/**
+	 * Called by YAPF to calculate the cost from the origin to the given node.
+	 *  Every region moved over costs the same.
+	 */
+	inline bool PfCalcCost(Node &n, const TrackFollower *tf)
+	{
+		n.m_cost = n.m_parent->m_cost + ManhattanDistance(n.m_key, n.m_parent->m_key);
+		return true;
+	}
+};
+
+/**
+ * Config struct of YAPF for water regions.
+ *  Defines all 6 base YAPF modules as classes providing services for CYapfBaseT.
+ */
+template <class Tpf_, class Tnode_list>
+struct CYapfRegion_TypesT
+{
+	/** Types - shortcut for this struct type */
+	typedef CYapfRegion_TypesT<Tpf_, Tnode_list> Types;
+
+	/** Tpf - pathfinder type */
+	typedef Tpf_                              Tpf;
+	/** track follower helper class, not used for regions but YAPF needs one */
+	typedef CFollowTrackWater                 TrackFollower;
+	/** node list type */
+	typedef Tnode_list                        NodeList;
+	typedef Ship                              VehicleType;
+	/** pathfinder components (modules) */
+	typedef CYapfBaseT<Types>                 PfBase;        // base pathfinder class
+	typedef CYapfFollowRegionT<Types>         PfFollow;      // node follower
+	typedef CYapfOriginRegionT<Types>         PfOrigin;      // origin provider
+	typedef CYapfDestinationRegionT<Types>    PfDestination; // destination/distance provider
+	typedef CYapfSegmentCostCacheNoneT<Types> PfCache;       // segment cost cache provider
+	typedef CYapfCostRegionT<Types>           PfCost;        // cost provider
+};
+
+typedef CNodeList_HashTableT<CYapfRegionNodeT<CYapfRegionPatchNodeKey>, 12, 12> CRegionNodeListWater;
+
+/** YAPF pathfinder for water regions */
+struct CYapfRegionWater : CYapfT<CYapfRegion_TypesT<CYapfRegionWater, CRegionNodeListWater>>
+{
+	/**
+	 * Create the pathfinder.
+	 * @param max_nodes Maximum number of nodes to visit.
+	 */
+	explicit CYapfRegionWater(int max_nodes)
+	{
+		m_max_search_nodes = max_nodes;
+	}
+};
+
+/**
+ * Find the path from the water region patch of a tile towards the
+ * destination of a ship, counted in water region patches.
+ * @param v The ship.
+ * @param start_tile The tile the path starts at.
+ * @param max_returned_path_length The maximum number of patches to return.
+ * @return The patches along the path, starting with the patch of \a start_tile, or an empty list when there is no path.
+ */
+std::vector<WaterRegionPatchDesc> YapfShipFindWaterRegionPath(const Ship *v, TileIndex start_tile, uint max_returned_path_length)
+{
+	return CYapfRegionWater::FindWaterRegionPath(v, start_tile, max_returned_path_length);
+}
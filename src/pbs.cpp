@@ -15,6 +15,8 @@
 
 #include "safeguards.h"
 
+uint32 _reservation_change_counter = 1; ///< Incremented for every change that may move the end of a reservation.
+
 /**
  * Get the reserved trackbits for any tile, regardless of type.
  * @param t the tile
@@ -295,8 +297,20 @@ PBSTileInfo FollowTrainReservation(const Train *v, Vehicle **train_on_res)
 
 	if (IsRailDepotTile(tile) && !GetDepotReservationTrackBits(tile)) return PBSTileInfo(tile, trackdir, false);
 
+	/* Following the reservation again is only needed when any reservation
+	 * or track changed since the last time, or the train moved. */
+	RailTypes rts = GetRailTypeInfo(v->railtype)->compatible_railtypes;
+	PBSReservationCache &cache = v->reservation_cache;
+	if (cache.counter != _reservation_change_counter || cache.origin != tile || cache.origin_trackdir != trackdir || cache.railtypes != rts) {
+		cache.origin = tile;
+		cache.origin_trackdir = trackdir;
+		cache.railtypes = rts;
+		cache.counter = _reservation_change_counter;
+		cache.end = FollowReservation(v->owner, rts, tile, trackdir);
+	}
+
 	FindTrainOnTrackInfo ftoti;
-	ftoti.res = FollowReservation(v->owner, GetRailTypeInfo(v->railtype)->compatible_railtypes, tile, trackdir);
+	ftoti.res = cache.end;
 	ftoti.res.okay = IsSafeWaitingPosition(v, ftoti.res.tile, ftoti.res.trackdir, true, _settings_game.pf.forbid_90_deg);
 	if (train_on_res != nullptr) {
 		FindVehicleOnPos(ftoti.res.tile, &ftoti, FindTrainOnTrackEnum);
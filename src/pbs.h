@@ -14,6 +14,18 @@
 #include "direction_type.h"
 #include "track_type.h"
 #include "vehicle_type.h"
+#include "rail_type.h"
+
+extern uint32 _reservation_change_counter;
+
+/**
+ * Tell the caches of the reservation ends that a reservation, or the track
+ * a reservation may be followed over, changed.
+ */
+static inline void NotifyReservationChange()
+{
+	_reservation_change_counter++;
+}
 
 TrackBits GetReservedTrackbits(TileIndex t);
 
@@ -42,6 +54,15 @@ struct PBSTileInfo {
 	PBSTileInfo(TileIndex _t, Trackdir _td, bool _okay) : tile(_t), trackdir(_td), okay(_okay) {}
 };
 
+/** Cache of the last tile of the reservation of a train, see FollowTrainReservation(). */
+struct PBSReservationCache {
+	TileIndex origin;          ///< Tile the reservation was followed from.
+	Trackdir origin_trackdir;  ///< Trackdir the reservation was followed from.
+	RailTypes railtypes;       ///< Rail types the reservation was followed over.
+	uint32 counter;            ///< Value of #_reservation_change_counter when the reservation was followed.
+	PBSTileInfo end;           ///< The last tile of the reservation; PBSTileInfo::okay is not cached.
+};
+
 PBSTileInfo FollowTrainReservation(const Train *v, Vehicle **train_on_res = nullptr);
 bool IsSafeWaitingPosition(const Train *v, TileIndex tile, Trackdir trackdir, bool include_line_end, bool forbid_90deg = false);
 bool IsWaitingPositionFree(const Train *v, TileIndex tile, Trackdir trackdir, bool forbid_90deg = false);
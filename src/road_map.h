@@ -15,6 +15,7 @@
 #include "rail_type.h"
 #include "road_func.h"
 #include "tile_map.h"
+#include "pbs.h"
 
 
 /** The different types of road tiles. */
@@ -394,6 +395,7 @@ static inline void SetCrossingReservation(TileIndex t, bool b)
 {
 	assert(IsLevelCrossingTile(t));
 	SB(_m[t].m5, 4, 1, b ? 1 : 0);
+	NotifyReservationChange();
 }
 
 /**
@@ -81,6 +81,7 @@ static const byte RV_OVERTAKE_TIMEOUT = 35;
 
 void RoadVehUpdateCache(RoadVehicle *v, bool same_length = false);
 void GetRoadVehSpriteSize(EngineID engine, uint &width, uint &height, int &xoffs, int &yoffs, EngineImageType image_type);
+void InvalidateRoadVehPathCacheNearTile(TileIndex tile, RoadTramType rtt);
 
 struct RoadVehPathCache {
 	std::deque<Trackdir> td;
@@ -17,6 +17,7 @@
 #include "articulated_vehicles.h"
 #include "newgrf_sound.h"
 #include "pathfinder/yapf/yapf.h"
+#include "pathfinder/pf_trace.h"
 #include "strings_func.h"
 #include "tunnelbridge_map.h"
 #include "date_func.h"
@@ -25,6 +26,7 @@
 #include "ai/ai.hpp"
 #include "game/game.hpp"
 #include "depot_map.h"
+#include "depot_func.h"
 #include "effectvehicle_func.h"
 #include "roadstop_base.h"
 #include "spritecache.h"
@@ -338,6 +340,8 @@ static FindDepotData FindClosestRoadDepot(const RoadVehicle *v, int max_distance
 {
 	if (IsRoadDepotTile(v->tile)) return FindDepotData(v->tile, 0);
 
+	if (!IsDepotWithinPenalty(TRANSPORT_ROAD, &v->tile, 1, max_distance)) return FindDepotData();
+
 	switch (_settings_game.pf.pathfinder_for_roadvehs) {
 		case VPF_NPF: return NPFRoadVehicleFindNearestDepot(v, max_distance);
 		case VPF_YAPF: return YapfRoadVehicleFindNearestDepot(v, max_distance);
@@ -610,30 +614,30 @@ struct RoadVehFindData {
 	int x;
 	int y;
 	const Vehicle *veh;
+	const Vehicle *front; ///< First vehicle of the chain of #veh.
 	Vehicle *best;
 	uint best_diff;
 	Direction dir;
+	int x_min;            ///< Minimum X distance of a vehicle in front from (#x, #y).
+	int x_max;            ///< Maximum X distance of a vehicle in front from (#x, #y).
+	int y_min;            ///< Minimum Y distance of a vehicle in front from (#x, #y).
+	int y_max;            ///< Maximum Y distance of a vehicle in front from (#x, #y).
 };
 
 static Vehicle *EnumCheckRoadVehClose(Vehicle *v, void *data)
 {
-	static const int8 dist_x[] = { -4, -8, -4, -1, 4, 8, 4, 1 };
-	static const int8 dist_y[] = { -4, -1, 4, 8, 4, 1, -4, -8 };
-
 	RoadVehFindData *rvf = (RoadVehFindData*)data;
 
-	short x_diff = v->x_pos - rvf->x;
-	short y_diff = v->y_pos - rvf->y;
+	/* Cheapest rejections first; most vehicles in a busy hash bucket fail these. */
+	if (v->type != VEH_ROAD || v->direction != rvf->dir) return nullptr;
+
+	int x_diff = (short)(v->x_pos - rvf->x);
+	int y_diff = (short)(v->y_pos - rvf->y);
+	if (x_diff < rvf->x_min || x_diff > rvf->x_max || y_diff < rvf->y_min || y_diff > rvf->y_max) return nullptr;
 
-	if (v->type == VEH_ROAD &&
+	if (abs(v->z_pos - rvf->veh->z_pos) < 6 &&
 			!v->IsInDepot() &&
-			abs(v->z_pos - rvf->veh->z_pos) < 6 &&
-			v->direction == rvf->dir &&
-			rvf->veh->First() != v->First() &&
-			(dist_x[v->direction] >= 0 || (x_diff > dist_x[v->direction] && x_diff <= 0)) &&
-			(dist_x[v->direction] <= 0 || (x_diff < dist_x[v->direction] && x_diff >= 0)) &&
-			(dist_y[v->direction] >= 0 || (y_diff > dist_y[v->direction] && y_diff <= 0)) &&
-			(dist_y[v->direction] <= 0 || (y_diff < dist_y[v->direction] && y_diff >= 0))) {
+			rvf->front != v->First()) {
 		uint diff = abs(x_diff) + abs(y_diff);
 
 		if (diff < rvf->best_diff || (diff == rvf->best_diff && v->index < rvf->best->index)) {
@@ -647,6 +651,9 @@ static Vehicle *EnumCheckRoadVehClose(Vehicle *v, void *data)
 
 static RoadVehicle *RoadVehFindCloseTo(RoadVehicle *v, int x, int y, Direction dir, bool update_blocked_ctr = true)
 {
+	static const int8 dist_x[] = { -4, -8, -4, -1, 4, 8, 4, 1 };
+	static const int8 dist_y[] = { -4, -1, 4, 8, 4, 1, -4, -8 };
+
 	RoadVehFindData rvf;
 	RoadVehicle *front = v->First();
 
@@ -656,8 +663,16 @@ static RoadVehicle *RoadVehFindCloseTo(RoadVehicle *v, int x, int y, Direction d
 	rvf.y = y;
 	rvf.dir = dir;
 	rvf.veh = v;
+	rvf.front = front;
 	rvf.best_diff = UINT_MAX;
 
+	/* A vehicle is in front when it is strictly less than dist_x/dist_y
+	 * away along the direction of travel, and not behind us. */
+	rvf.x_min = dist_x[dir] < 0 ? dist_x[dir] + 1 : 0;
+	rvf.x_max = dist_x[dir] > 0 ? dist_x[dir] - 1 : 0;
+	rvf.y_min = dist_y[dir] < 0 ? dist_y[dir] + 1 : 0;
+	rvf.y_max = dist_y[dir] > 0 ? dist_y[dir] - 1 : 0;
+
 	if (front->state == RVSB_WORMHOLE) {
 		FindVehicleOnPos(v->tile, &rvf, EnumCheckRoadVehClose);
 		FindVehicleOnPos(GetOtherTunnelBridgeEnd(v->tile), &rvf, EnumCheckRoadVehClose);
@@ -984,11 +999,15 @@ static Trackdir RoadFindPathToDest(RoadVehicle *v, TileIndex tile, DiagDirection
 		}
 	}
 
-	switch (_settings_game.pf.pathfinder_for_roadvehs) {
-		case VPF_NPF:  best_track = NPFRoadVehicleChooseTrack(v, tile, enterdir, path_found); break;
-		case VPF_YAPF: best_track = YapfRoadVehicleChooseTrack(v, tile, enterdir, trackdirs, path_found, v->path); break;
+	{
+		PfTraceRequest trace(v, tile, enterdir);
+		switch (_settings_game.pf.pathfinder_for_roadvehs) {
+			case VPF_NPF:  best_track = NPFRoadVehicleChooseTrack(v, tile, enterdir, path_found); break;
+			case VPF_YAPF: best_track = YapfRoadVehicleChooseTrack(v, tile, enterdir, trackdirs, path_found, v->path); break;
 
-		default: NOT_REACHED();
+			default: NOT_REACHED();
+		}
+		trace.Finish(best_track, path_found);
 	}
 	v->HandlePathfindingResult(path_found);
 
@@ -1630,7 +1649,7 @@ Money RoadVehicle::GetRunningCost() const
 
 bool RoadVehicle::Tick()
 {
-	PerformanceAccumulator framerate(PFE_GL_ROADVEHS);
+	PerformanceAccumulator framerate(PFE_GL_ROADVEHS, this->index);
 
 	this->tick_counter++;
 
@@ -1649,6 +1668,24 @@ void RoadVehicle::SetDestTile(TileIndex tile)
 	this->dest_tile = tile;
 }
 
+/**
+ * Forget the cached paths that may lead over a tile whose road layout changed.
+ * The cache only holds the junctions along the path, so a path is forgotten
+ * when the tile lies in the area spanned by the vehicle and these junctions.
+ * @param tile The tile whose road layout changed.
+ * @param rtt Whether the road or the tram layout changed.
+ */
+void InvalidateRoadVehPathCacheNearTile(TileIndex tile, RoadTramType rtt)
+{
+	for (RoadVehicle *v : RoadVehicle::Iterate()) {
+		if (v->path.empty() || GetRoadTramType(v->roadtype) != rtt) continue;
+
+		TileArea path_area(v->tile, 1, 1);
+		for (TileIndex path_tile : v->path.tile) path_area.Add(path_tile);
+		if (path_area.Expand(1).Contains(tile)) v->path.clear();
+	}
+}
+
 static void CheckIfRoadVehNeedsService(RoadVehicle *v)
 {
 	/* If we already got a slot at a stop, use that FIRST, and go to a depot later */
@@ -61,11 +61,58 @@
 #include "saveload_internal.h"
 
 #include <signal.h>
+#include <chrono>
 
 #include "../safeguards.h"
 
 extern Company *DoStartupNewCompany(bool is_ai, CompanyID company = INVALID_COMPANY);
 
+/**
+ * Measurement of how long the phases of loading a savegame take, for the debug log.
+ * The time of the last phase is written when the timer goes out of scope, so
+ * returning early from a conversion does not lose the measurement.
+ */
+class AfterLoadPhaseTimer {
+	typedef std::chrono::steady_clock Clock;
+
+	const char *phase;         ///< Name of the phase being measured.
+	Clock::time_point start;   ///< Start of the phase being measured.
+	Clock::time_point begin;   ///< Start of the first phase.
+
+	/** Write the time the current phase took to the debug log. */
+	void Report(Clock::time_point now) const
+	{
+		DEBUG(sl, 2, "After load: %s took %u ms", this->phase, (uint)std::chrono::duration_cast<std::chrono::milliseconds>(now - this->start).count());
+	}
+
+public:
+	/**
+	 * Start measuring the first phase.
+	 * @param phase Name of the phase.
+	 */
+	AfterLoadPhaseTimer(const char *phase) : phase(phase), start(Clock::now()), begin(start) {}
+
+	/** Report the last phase, and the total time. */
+	~AfterLoadPhaseTimer()
+	{
+		Clock::time_point now = Clock::now();
+		this->Report(now);
+		DEBUG(sl, 1, "After load took %u ms", (uint)std::chrono::duration_cast<std::chrono::milliseconds>(now - this->begin).count());
+	}
+
+	/**
+	 * Report the current phase, and start measuring the next one.
+	 * @param phase Name of the next phase.
+	 */
+	void Next(const char *phase)
+	{
+		Clock::time_point now = Clock::now();
+		this->Report(now);
+		this->phase = phase;
+		this->start = now;
+	}
+};
+
 /**
  * Makes a tile canal or water depending on the surroundings.
  *
@@ -543,6 +590,8 @@ bool AfterLoadGame()
 {
 	SetSignalHandlers();
 
+	AfterLoadPhaseTimer timer("early conversions");
+
 	TileIndex map_size = MapSize();
 
 	extern TileIndex _cur_tileloop_tile; // From landscape.cpp.
@@ -559,6 +608,8 @@ bool AfterLoadGame()
 	/* This needs to be done even before conversion, because some conversions will destroy objects
 	 * that otherwise won't exist in the tree. */
 	RebuildViewportKdtree();
+	/* This drops duplicate animated tiles of old savegames as well. */
+	AfterLoadAnimatedTiles();
 
 	if (IsSavegameVersionBefore(SLV_98)) GamelogGRFAddList(_grfconfig);
 
@@ -609,14 +660,14 @@ bool AfterLoadGame()
 
 		/* In old savegame versions, the heightlevel was coded in bits 0..3 of the type field */
 		for (TileIndex t = 0; t < map_size; t++) {
-			_m[t].height = GB(_m[t].type, 0, 4);
-			SB(_m[t].type, 0, 2, GB(_me[t].m6, 0, 2));
+			_mth[t].height = GB(_mth[t].type, 0, 4);
+			SB(_mth[t].type, 0, 2, GB(_me[t].m6, 0, 2));
 			SB(_me[t].m6, 0, 2, 0);
 			if (MayHaveBridgeAbove(t)) {
-				SB(_m[t].type, 2, 2, GB(_me[t].m6, 6, 2));
+				SB(_mth[t].type, 2, 2, GB(_me[t].m6, 6, 2));
 				SB(_me[t].m6, 6, 2, 0);
 			} else {
-				SB(_m[t].type, 2, 2, 0);
+				SB(_mth[t].type, 2, 2, 0);
 			}
 		}
 	}
@@ -798,7 +849,9 @@ bool AfterLoadGame()
 	}
 
 	/* Update all vehicles */
+	timer.Next("vehicle caches");
 	AfterLoadVehicles(true);
+	timer.Next("conversions");
 
 	/* Make sure there is an AI attached to an AI company */
 	{
@@ -1261,6 +1314,8 @@ bool AfterLoadGame()
 			} else {
 				RoadVehicle::From(v)->state = RVSB_WORMHOLE;
 			}
+			/* The vehicle may have moved to the bridge head; update the tile location hash. */
+			v->UpdatePosition();
 		}
 	}
 
@@ -1508,7 +1563,9 @@ bool AfterLoadGame()
 	}
 
 	/* Check and update house and town values */
+	timer.Next("town caches");
 	UpdateHousesAndTowns();
+	timer.Next("conversions");
 
 	if (IsSavegameVersionBefore(SLV_43)) {
 		for (TileIndex t = 0; t < map_size; t++) {
@@ -1606,11 +1663,14 @@ bool AfterLoadGame()
 		/* For some reason non-loading vehicles could be in the station's loading vehicle list */
 
 		for (Station *st : Station::Iterate()) {
-			std::list<Vehicle *>::iterator iter;
+			std::vector<Vehicle *>::iterator iter;
 			for (iter = st->loading_vehicles.begin(); iter != st->loading_vehicles.end();) {
 				Vehicle *v = *iter;
-				iter++;
-				if (!v->current_order.IsType(OT_LOADING)) st->loading_vehicles.remove(v);
+				if (!v->current_order.IsType(OT_LOADING)) {
+					iter = st->loading_vehicles.erase(iter);
+				} else {
+					iter++;
+				}
 			}
 		}
 	}
@@ -2175,7 +2235,7 @@ bool AfterLoadGame()
 		 * add cargopayment for the vehicles that don't have it.
 		 */
 		for (Station *st : Station::Iterate()) {
-			std::list<Vehicle *>::iterator iter;
+			std::vector<Vehicle *>::iterator iter;
 			for (iter = st->loading_vehicles.begin(); iter != st->loading_vehicles.end(); ++iter) {
 				/* There are always as many CargoPayments as Vehicles. We need to make the
 				 * assert() in Pool::GetNew() happy by calling CanAllocateItem(). */
@@ -2189,25 +2249,16 @@ bool AfterLoadGame()
 
 	if (IsSavegameVersionBefore(SLV_122)) {
 		/* Animated tiles would sometimes not be actually animated or
-		 * in case of old savegames duplicate. */
+		 * in case of old savegames duplicate; the duplicates are already
+		 * removed by AfterLoadAnimatedTiles(). */
 
 		extern std::vector<TileIndex> _animated_tiles;
 
-		for (auto tile = _animated_tiles.begin(); tile < _animated_tiles.end(); /* Nothing */) {
+		for (TileIndex tile : _animated_tiles) {
 			/* Remove if tile is not animated */
-			bool remove = _tile_type_procs[GetTileType(*tile)]->animate_tile_proc == nullptr;
-
-			/* and remove if duplicate */
-			for (auto j = _animated_tiles.begin(); !remove && j < tile; j++) {
-				remove = *tile == *j;
-			}
-
-			if (remove) {
-				DeleteAnimatedTile(*tile);
-			} else {
-				tile++;
-			}
+			if (_tile_type_procs[GetTileType(tile)]->animate_tile_proc == nullptr) DeleteAnimatedTile(tile);
 		}
+		RemoveDeletedAnimatedTiles();
 	}
 
 	if (IsSavegameVersionBefore(SLV_124) && !IsSavegameVersionBefore(SLV_1)) {
@@ -2618,8 +2669,7 @@ bool AfterLoadGame()
 					ClrBit(t->flags, 2);
 
 					/* Clear both bits first. */
-					ClrBit(t->gv_flags, GVF_GOINGUP_BIT);
-					ClrBit(t->gv_flags, GVF_GOINGDOWN_BIT);
+					t->SetInclinationFlags(0);
 
 					/* Crashed vehicles can't be going up/down. */
 					if (t->vehstatus & VS_CRASHED) break;
@@ -2627,13 +2677,12 @@ bool AfterLoadGame()
 					/* Only X/Y tracks can be sloped. */
 					if (t->track != TRACK_BIT_X && t->track != TRACK_BIT_Y) break;
 
-					t->gv_flags |= FixVehicleInclination(t, t->direction);
+					t->SetInclinationFlags(FixVehicleInclination(t, t->direction));
 					break;
 				}
 				case VEH_ROAD: {
 					RoadVehicle *rv = RoadVehicle::From(v);
-					ClrBit(rv->gv_flags, GVF_GOINGUP_BIT);
-					ClrBit(rv->gv_flags, GVF_GOINGDOWN_BIT);
+					rv->SetInclinationFlags(0);
 
 					/* Crashed vehicles can't be going up/down. */
 					if (rv->vehstatus & VS_CRASHED) break;
@@ -2657,7 +2706,7 @@ bool AfterLoadGame()
 						dir = INVALID_DIR;
 					}
 
-					rv->gv_flags |= FixVehicleInclination(rv, dir);
+					rv->SetInclinationFlags(FixVehicleInclination(rv, dir));
 					break;
 				}
 				case VEH_SHIP:
@@ -3119,10 +3168,20 @@ bool AfterLoadGame()
 	}
 
 	/* Update station docking tiles. */
+	timer.Next("docking tiles");
 	AfterLoadScanDockingTiles();
 
 	/* Compute station catchment areas. This is needed here in case UpdateStationAcceptance is called below. */
+	timer.Next("station catchment");
 	Station::RecomputeCatchmentForAll();
+	timer.Next("station caches");
+
+	/* The set of stations with loading vehicles is a cache as well. */
+	Station::RebuildLoadingStations();
+
+	/* The same goes for the towns that are due to grow and the phases of the industry counters. */
+	Town::RebuildGrowthSchedule();
+	Industry::RebuildCounterPhases();
 
 	/* Station acceptance is some kind of cache */
 	if (IsSavegameVersionBefore(SLV_127)) {
@@ -3132,15 +3191,20 @@ bool AfterLoadGame()
 	/* Road stops is 'only' updating some caches */
 	AfterLoadRoadStops();
 	AfterLoadLabelMaps();
-	AfterLoadCompanyStats();
+	/* The saved infrastructure counts are only valid if the rail and road types, and the NewGRF
+	 * stations deciding which station tiles have track, did not change since saving. */
+	timer.Next("company infrastructure");
+	AfterLoadCompanyStats(IsSavegameVersionBefore(SLV_COMPANY_INFRASTRUCTURE) || gcf_res != GLC_ALL_GOOD);
 	AfterLoadStoryBook();
 
 	GamelogPrintDebug(1);
 
+	timer.Next("windows and caches");
 	InitializeWindowsAndCaches();
 	/* Restore the signals */
 	ResetSignalHandlers();
 
+	timer.Next("link graphs");
 	AfterLoadLinkGraphs();
 	return true;
 }
@@ -3166,6 +3230,8 @@ void ReloadNewGRFData()
 	GroupStatistics::UpdateAfterLoad();
 	/* update station graphics */
 	AfterLoadStations();
+	/* forget when animated tiles have their next frame, the animation speeds may have changed */
+	ResetAnimatedTileHints();
 	/* Update company statistics. */
 	AfterLoadCompanyStats();
 	/* Check and update house and town values */
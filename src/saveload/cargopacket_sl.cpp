@@ -108,9 +108,12 @@ const SaveLoad *GetCargoPacketDesc()
  */
 static void Save_CAPA()
 {
+	/* Vehicles age their cargo lazily; store the actual days in transit. */
+	for (Vehicle *v : Vehicle::Iterate()) v->cargo.UpdateAges();
+
 	for (CargoPacket *cp : CargoPacket::Iterate()) {
 		SlSetArrayIndex(cp->index);
-		SlObject(cp, GetCargoPacketDesc());
+		SlCompiledObject(cp, GetCargoPacketDesc());
 	}
 }
 
@@ -123,11 +126,11 @@ static void Load_CAPA()
 
 	while ((index = SlIterateArray()) != -1) {
 		CargoPacket *cp = new (index) CargoPacket();
-		SlObject(cp, GetCargoPacketDesc());
+		SlCompiledObject(cp, GetCargoPacketDesc());
 	}
 }
 
 /** Chunk handlers related to cargo packets. */
 extern const ChunkHandler _cargopacket_chunk_handlers[] = {
-	{ 'CAPA', Save_CAPA, Load_CAPA, nullptr, nullptr, CH_ARRAY | CH_LAST},
+	{ 'CAPA', Save_CAPA, Load_CAPA, nullptr, nullptr, CH_ARRAY | CH_PARALLEL_SAVE | CH_LAST},
 };
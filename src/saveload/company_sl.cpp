@@ -14,6 +14,8 @@
 #include "../tunnelbridge_map.h"
 #include "../tunnelbridge.h"
 #include "../station_base.h"
+#include "../vehicle_base.h"
+#include "../vehicle_func.h"
 #include "../strings_func.h"
 
 #include "saveload.h"
@@ -90,9 +92,19 @@ CompanyManagerFace ConvertFromOldCompanyManagerFace(uint32 face)
 	return cmf;
 }
 
-/** Rebuilding of company statistics after loading a savegame. */
-void AfterLoadCompanyStats()
+/**
+ * Rebuilding of company statistics after loading a savegame.
+ * @param recount_infrastructure Whether to count the infrastructure on the map; otherwise the saved counts are kept.
+ */
+void AfterLoadCompanyStats(bool recount_infrastructure)
 {
+	/* Collect the assets for the company value. */
+	for (Company *c : Company::Iterate()) c->assets = {};
+	for (const Station *st : Station::Iterate()) st->UpdateOwnerAssets(1);
+	for (const Vehicle *v : Vehicle::Iterate()) CountVehicleAssetValue(v, 1);
+
+	if (!recount_infrastructure) return;
+
 	/* Reset infrastructure statistics to zero. */
 	for (Company *c : Company::Iterate()) MemSetT(&c->infrastructure, 0);
 
@@ -409,6 +421,16 @@ static const SaveLoad _company_livery_desc[] = {
 	SLE_END()
 };
 
+static const SaveLoad _company_infrastructure_desc[] = {
+	SLE_CONDARR(CompanyInfrastructure, road,    SLE_UINT32, ROADTYPE_END, SLV_COMPANY_INFRASTRUCTURE, SL_MAX_VERSION),
+	SLE_CONDVAR(CompanyInfrastructure, signal,  SLE_UINT32,               SLV_COMPANY_INFRASTRUCTURE, SL_MAX_VERSION),
+	SLE_CONDARR(CompanyInfrastructure, rail,    SLE_UINT32, RAILTYPE_END, SLV_COMPANY_INFRASTRUCTURE, SL_MAX_VERSION),
+	SLE_CONDVAR(CompanyInfrastructure, water,   SLE_UINT32,               SLV_COMPANY_INFRASTRUCTURE, SL_MAX_VERSION),
+	SLE_CONDVAR(CompanyInfrastructure, station, SLE_UINT32,               SLV_COMPANY_INFRASTRUCTURE, SL_MAX_VERSION),
+	SLE_CONDVAR(CompanyInfrastructure, airport, SLE_UINT32,               SLV_COMPANY_INFRASTRUCTURE, SL_MAX_VERSION),
+	SLE_END()
+};
+
 static void SaveLoad_PLYR_common(Company *c, CompanyProperties *cprops)
 {
 	int i;
@@ -476,6 +498,14 @@ static void SaveLoad_PLYR_common(Company *c, CompanyProperties *cprops)
 			SlObject(&dummy_livery, _company_livery_desc);
 		}
 	}
+
+	/* Write the infrastructure counts, so they do not have to be counted on the map when loading. */
+	if (c != nullptr) {
+		SlObject(&c->infrastructure, _company_infrastructure_desc);
+	} else {
+		CompanyInfrastructure dummy_infrastructure;
+		SlObject(&dummy_infrastructure, _company_infrastructure_desc);
+	}
 }
 
 static void SaveLoad_PLYR(Company *c)
@@ -78,6 +78,7 @@ static const SaveLoad _industry_desc[] = {
 static void Save_INDY()
 {
 	/* Write the industries */
+	Industry::UpdateCounters();
 	for (Industry *ind : Industry::Iterate()) {
 		SlSetArrayIndex(ind->index);
 		SlObject(ind, _industry_desc);
@@ -22,6 +22,8 @@ typedef LinkGraph::BaseEdge Edge;
 const SettingDesc *GetSettingDescription(uint index);
 
 static uint16 _num_nodes;
+static NodeID _next_edge; ///< Destination of the next edge of a node, as the edges are saved as a linked list.
+static uint32 _num_route_links; ///< Number of links of the previous routes of a link graph job.
 
 /**
  * Get a SaveLoad array for a link graph.
@@ -75,6 +77,7 @@ const SaveLoad *GetLinkGraphJobDesc()
 		const SaveLoad job_desc[] = {
 			SLE_VAR(LinkGraphJob, join_date,        SLE_INT32),
 			SLE_VAR(LinkGraphJob, link_graph.index, SLE_UINT16),
+			SLEG_CONDVAR(_num_route_links,          SLE_UINT32, SLV_LINKGRAPH_INCREMENTAL, SL_MAX_VERSION),
 			SLE_END()
 		};
 
@@ -124,31 +127,102 @@ static const SaveLoad _edge_desc[] = {
 	     SLE_VAR(Edge, usage,                    SLE_UINT32),
 	     SLE_VAR(Edge, last_unrestricted_update, SLE_INT32),
 	 SLE_CONDVAR(Edge, last_restricted_update,   SLE_INT32, SLV_187, SL_MAX_VERSION),
-	     SLE_VAR(Edge, next_edge,                SLE_UINT16),
+	    SLEG_VAR(_next_edge,                     SLE_UINT16),
 	     SLE_END()
 };
 
 /**
- * Save/load a link graph.
- * @param lg Link graph to be saved or loaded.
+ * Save a link graph. The edges of each node are saved as a linked list,
+ * headed by an empty edge of the node to itself.
+ * @param lg Link graph to be saved.
  */
-void SaveLoad_LinkGraph(LinkGraph &lg)
+void Save_LinkGraph(LinkGraph &lg)
 {
 	uint size = lg.Size();
 	for (NodeID from = 0; from < size; ++from) {
-		Node *node = &lg.nodes[from];
-		SlObject(node, _node_desc);
+		SlObject(&lg.nodes[from], _node_desc);
+
+		/* Saving only reads the edges, so don't copy them away from link graph jobs sharing them. */
+		LinkGraph::EdgeList &edges = const_cast<LinkGraph::EdgeList &>(*lg.edges[from]);
+		Edge head;
+		head.Init(from);
+		_next_edge = edges.empty() ? INVALID_NODE : edges.front().dest;
+		SlObject(&head, _edge_desc);
+		for (size_t i = 0; i < edges.size(); ++i) {
+			_next_edge = i + 1 < edges.size() ? edges[i + 1].dest : INVALID_NODE;
+			SlObject(&edges[i], _edge_desc);
+		}
+	}
+}
+
+/**
+ * Load a link graph.
+ * @param lg Link graph to be loaded. It has to be initialized with the right size already.
+ */
+void Load_LinkGraph(LinkGraph &lg)
+{
+	uint size = lg.Size();
+	for (NodeID from = 0; from < size; ++from) {
+		SlObject(&lg.nodes[from], _node_desc);
+
+		LinkGraph::EdgeList &edges = lg.edges[from].Mutable();
 		if (IsSavegameVersionBefore(SLV_191)) {
 			/* We used to save the full matrix ... */
+			std::vector<Edge> row(size);
+			std::vector<NodeID> next(size);
 			for (NodeID to = 0; to < size; ++to) {
-				SlObject(&lg.edges[from][to], _edge_desc);
+				row[to].Init(to);
+				SlObject(&row[to], _edge_desc);
+				next[to] = _next_edge;
+			}
+			for (NodeID to = next[from]; to != INVALID_NODE; to = next[to]) {
+				edges.push_back(row[to]);
 			}
 		} else {
 			/* ... but as that wasted a lot of space we save a sparse matrix now. */
-			for (NodeID to = from; to != INVALID_NODE; to = lg.edges[from][to].next_edge) {
-				SlObject(&lg.edges[from][to], _edge_desc);
+			Edge head;
+			head.Init(from);
+			SlObject(&head, _edge_desc);
+			for (NodeID to = _next_edge; to != INVALID_NODE; to = _next_edge) {
+				edges.emplace_back();
+				edges.back().Init(to);
+				SlObject(&edges.back(), _edge_desc);
 			}
 		}
+		std::sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b) { return a.dest < b.dest; });
+	}
+}
+
+/**
+ * SaveLoad desc for a link of the previous routes of a link graph job.
+ */
+static const SaveLoad _route_link_desc[] = {
+	SLE_VAR(LinkGraphJob::RouteLink, origin, SLE_UINT16),
+	SLE_VAR(LinkGraphJob::RouteLink, from,   SLE_UINT16),
+	SLE_VAR(LinkGraphJob::RouteLink, to,     SLE_UINT16),
+	SLE_END()
+};
+
+/**
+ * Save the previous routes of a link graph job. Their number has been saved already.
+ * @param lgj Link graph job to be saved.
+ */
+void Save_LinkGraphJobRoutes(LinkGraphJob &lgj)
+{
+	for (LinkGraphJob::RouteLink &link : lgj.previous_routes) {
+		SlObject(&link, _route_link_desc);
+	}
+}
+
+/**
+ * Load the previous routes of a link graph job.
+ * @param lgj Link graph job to be loaded.
+ */
+void Load_LinkGraphJobRoutes(LinkGraphJob &lgj)
+{
+	lgj.previous_routes.resize(_num_route_links);
+	for (LinkGraphJob::RouteLink &link : lgj.previous_routes) {
+		SlObject(&link, _route_link_desc);
 	}
 }
 
@@ -158,10 +232,12 @@ void SaveLoad_LinkGraph(LinkGraph &lg)
  */
 static void DoSave_LGRJ(LinkGraphJob *lgj)
 {
+	_num_route_links = (uint32)lgj->PreviousRoutes().size();
 	SlObject(lgj, GetLinkGraphJobDesc());
 	_num_nodes = lgj->Size();
 	SlObject(const_cast<LinkGraph *>(&lgj->Graph()), GetLinkGraphDesc());
-	SaveLoad_LinkGraph(const_cast<LinkGraph &>(lgj->Graph()));
+	Save_LinkGraph(const_cast<LinkGraph &>(lgj->Graph()));
+	Save_LinkGraphJobRoutes(*lgj);
 }
 
 /**
@@ -172,7 +248,7 @@ static void DoSave_LGRP(LinkGraph *lg)
 {
 	_num_nodes = lg->Size();
 	SlObject(lg, GetLinkGraphDesc());
-	SaveLoad_LinkGraph(*lg);
+	Save_LinkGraph(*lg);
 }
 
 /**
@@ -189,7 +265,7 @@ static void Load_LGRP()
 		LinkGraph *lg = new (index) LinkGraph();
 		SlObject(lg, GetLinkGraphDesc());
 		lg->Init(_num_nodes);
-		SaveLoad_LinkGraph(*lg);
+		Load_LinkGraph(*lg);
 	}
 }
 
@@ -205,11 +281,13 @@ static void Load_LGRJ()
 			NOT_REACHED();
 		}
 		LinkGraphJob *lgj = new (index) LinkGraphJob();
+		_num_route_links = 0;
 		SlObject(lgj, GetLinkGraphJobDesc());
 		LinkGraph &lg = const_cast<LinkGraph &>(lgj->Graph());
 		SlObject(&lg, GetLinkGraphDesc());
 		lg.Init(_num_nodes);
-		SaveLoad_LinkGraph(lg);
+		Load_LinkGraph(lg);
+		Load_LinkGraphJobRoutes(*lgj);
 	}
 }
 
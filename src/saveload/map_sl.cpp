@@ -48,168 +48,113 @@ static void Check_MAPS()
 
 static const uint MAP_SL_BUF_SIZE = 4096;
 
-static void Load_MAPT()
+/**
+ * Load one plane of the map, i.e. the same field of all tiles.
+ * @param tiles The tile data to load into, #_mth, #_m or #_me.
+ * @param field The field of the tiles to load.
+ * @param conv  The type of the field in the savegame.
+ */
+template <typename Ttile, typename T>
+static void LoadMapPlane(Ttile *tiles, T Ttile::*field, VarType conv)
 {
-	std::array<byte, MAP_SL_BUF_SIZE> buf;
+	std::array<T, MAP_SL_BUF_SIZE> buf;
 	TileIndex size = MapSize();
 
 	for (TileIndex i = 0; i != size;) {
-		SlArray(buf.data(), MAP_SL_BUF_SIZE, SLE_UINT8);
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) _m[i++].type = buf[j];
+		SlArray(buf.data(), MAP_SL_BUF_SIZE, conv);
+		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) tiles[i++].*field = buf[j];
 	}
 }
 
-static void Save_MAPT()
+/**
+ * Save one plane of the map, i.e. the same field of all tiles.
+ * The field is gathered into a buffer that is then written in bulk.
+ * @param tiles The tile data to save, #_mth, #_m or #_me.
+ * @param field The field of the tiles to save.
+ * @param conv  The type of the field in the savegame.
+ */
+template <typename Ttile, typename T>
+static void SaveMapPlane(const Ttile *tiles, T Ttile::*field, VarType conv)
 {
-	std::array<byte, MAP_SL_BUF_SIZE> buf;
+	std::array<T, MAP_SL_BUF_SIZE> buf;
 	TileIndex size = MapSize();
 
-	SlSetLength(size);
+	SlSetLength(size * sizeof(T));
 	for (TileIndex i = 0; i != size;) {
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) buf[j] = _m[i++].type;
-		SlArray(buf.data(), MAP_SL_BUF_SIZE, SLE_UINT8);
+		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) buf[j] = tiles[i++].*field;
+		SlArray(buf.data(), MAP_SL_BUF_SIZE, conv);
 	}
 }
 
-static void Load_MAPH()
+static void Load_MAPT()
 {
-	std::array<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
+	LoadMapPlane(_mth, &TileTypeHeight::type, SLE_UINT8);
+}
 
-	for (TileIndex i = 0; i != size;) {
-		SlArray(buf.data(), MAP_SL_BUF_SIZE, SLE_UINT8);
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) _m[i++].height = buf[j];
-	}
+static void Save_MAPT()
+{
+	SaveMapPlane(_mth, &TileTypeHeight::type, SLE_UINT8);
 }
 
-static void Save_MAPH()
+static void Load_MAPH()
 {
-	std::array<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
+	LoadMapPlane(_mth, &TileTypeHeight::height, SLE_UINT8);
+}
 
-	SlSetLength(size);
-	for (TileIndex i = 0; i != size;) {
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) buf[j] = _m[i++].height;
-		SlArray(buf.data(), MAP_SL_BUF_SIZE, SLE_UINT8);
-	}
+static void Save_MAPH()
+{
+	SaveMapPlane(_mth, &TileTypeHeight::height, SLE_UINT8);
 }
 
 static void Load_MAP1()
 {
-	std::array<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	for (TileIndex i = 0; i != size;) {
-		SlArray(buf.data(), MAP_SL_BUF_SIZE, SLE_UINT8);
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) _m[i++].m1 = buf[j];
-	}
+	LoadMapPlane(_m, &Tile::m1, SLE_UINT8);
 }
 
 static void Save_MAP1()
 {
-	std::array<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	SlSetLength(size);
-	for (TileIndex i = 0; i != size;) {
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) buf[j] = _m[i++].m1;
-		SlArray(buf.data(), MAP_SL_BUF_SIZE, SLE_UINT8);
-	}
+	SaveMapPlane(_m, &Tile::m1, SLE_UINT8);
 }
 
 static void Load_MAP2()
 {
-	std::array<uint16, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	for (TileIndex i = 0; i != size;) {
-		SlArray(buf.data(), MAP_SL_BUF_SIZE,
-			/* In those versions the m2 was 8 bits */
-			IsSavegameVersionBefore(SLV_5) ? SLE_FILE_U8 | SLE_VAR_U16 : SLE_UINT16
-		);
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) _m[i++].m2 = buf[j];
-	}
+	/* In those versions the m2 was 8 bits */
+	LoadMapPlane(_m, &Tile::m2, IsSavegameVersionBefore(SLV_5) ? SLE_FILE_U8 | SLE_VAR_U16 : SLE_UINT16);
 }
 
 static void Save_MAP2()
 {
-	std::array<uint16, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	SlSetLength(size * sizeof(uint16));
-	for (TileIndex i = 0; i != size;) {
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) buf[j] = _m[i++].m2;
-		SlArray(buf.data(), MAP_SL_BUF_SIZE, SLE_UINT16);
-	}
+	SaveMapPlane(_m, &Tile::m2, SLE_UINT16);
 }
 
 static void Load_MAP3()
 {
-	std::array<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	for (TileIndex i = 0; i != size;) {
-		SlArray(buf.data(), MAP_SL_BUF_SIZE, SLE_UINT8);
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) _m[i++].m3 = buf[j];
-	}
+	LoadMapPlane(_m, &Tile::m3, SLE_UINT8);
 }
 
 static void Save_MAP3()
 {
-	std::array<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	SlSetLength(size);
-	for (TileIndex i = 0; i != size;) {
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) buf[j] = _m[i++].m3;
-		SlArray(buf.data(), MAP_SL_BUF_SIZE, SLE_UINT8);
-	}
+	SaveMapPlane(_m, &Tile::m3, SLE_UINT8);
 }
 
 static void Load_MAP4()
 {
-	std::array<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	for (TileIndex i = 0; i != size;) {
-		SlArray(buf.data(), MAP_SL_BUF_SIZE, SLE_UINT8);
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) _m[i++].m4 = buf[j];
-	}
+	LoadMapPlane(_m, &Tile::m4, SLE_UINT8);
 }
 
 static void Save_MAP4()
 {
-	std::array<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	SlSetLength(size);
-	for (TileIndex i = 0; i != size;) {
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) buf[j] = _m[i++].m4;
-		SlArray(buf.data(), MAP_SL_BUF_SIZE, SLE_UINT8);
-	}
+	SaveMapPlane(_m, &Tile::m4, SLE_UINT8);
 }
 
 static void Load_MAP5()
 {
-	std::array<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	for (TileIndex i = 0; i != size;) {
-		SlArray(buf.data(), MAP_SL_BUF_SIZE, SLE_UINT8);
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) _m[i++].m5 = buf[j];
-	}
+	LoadMapPlane(_m, &Tile::m5, SLE_UINT8);
 }
 
 static void Save_MAP5()
 {
-	std::array<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	SlSetLength(size);
-	for (TileIndex i = 0; i != size;) {
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) buf[j] = _m[i++].m5;
-		SlArray(buf.data(), MAP_SL_BUF_SIZE, SLE_UINT8);
-	}
+	SaveMapPlane(_m, &Tile::m5, SLE_UINT8);
 }
 
 static void Load_MAP6()
@@ -229,82 +174,46 @@ static void Load_MAP6()
 			}
 		}
 	} else {
-		for (TileIndex i = 0; i != size;) {
-			SlArray(buf.data(), MAP_SL_BUF_SIZE, SLE_UINT8);
-			for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) _me[i++].m6 = buf[j];
-		}
+		LoadMapPlane(_me, &TileExtended::m6, SLE_UINT8);
 	}
 }
 
 static void Save_MAP6()
 {
-	std::array<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	SlSetLength(size);
-	for (TileIndex i = 0; i != size;) {
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) buf[j] = _me[i++].m6;
-		SlArray(buf.data(), MAP_SL_BUF_SIZE, SLE_UINT8);
-	}
+	SaveMapPlane(_me, &TileExtended::m6, SLE_UINT8);
 }
 
 static void Load_MAP7()
 {
-	std::array<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	for (TileIndex i = 0; i != size;) {
-		SlArray(buf.data(), MAP_SL_BUF_SIZE, SLE_UINT8);
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) _me[i++].m7 = buf[j];
-	}
+	LoadMapPlane(_me, &TileExtended::m7, SLE_UINT8);
 }
 
 static void Save_MAP7()
 {
-	std::array<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	SlSetLength(size);
-	for (TileIndex i = 0; i != size;) {
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) buf[j] = _me[i++].m7;
-		SlArray(buf.data(), MAP_SL_BUF_SIZE, SLE_UINT8);
-	}
+	SaveMapPlane(_me, &TileExtended::m7, SLE_UINT8);
 }
 
 static void Load_MAP8()
 {
-	std::array<uint16, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	for (TileIndex i = 0; i != size;) {
-		SlArray(buf.data(), MAP_SL_BUF_SIZE, SLE_UINT16);
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) _me[i++].m8 = buf[j];
-	}
+	LoadMapPlane(_me, &TileExtended::m8, SLE_UINT16);
 }
 
 static void Save_MAP8()
 {
-	std::array<uint16, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	SlSetLength(size * sizeof(uint16));
-	for (TileIndex i = 0; i != size;) {
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) buf[j] = _me[i++].m8;
-		SlArray(buf.data(), MAP_SL_BUF_SIZE, SLE_UINT16);
-	}
+	SaveMapPlane(_me, &TileExtended::m8, SLE_UINT16);
 }
 
 
 extern const ChunkHandler _map_chunk_handlers[] = {
 	{ 'MAPS', Save_MAPS, Load_MAPS, nullptr, Check_MAPS, CH_RIFF },
-	{ 'MAPT', Save_MAPT, Load_MAPT, nullptr, nullptr,    CH_RIFF },
-	{ 'MAPH', Save_MAPH, Load_MAPH, nullptr, nullptr,    CH_RIFF },
-	{ 'MAPO', Save_MAP1, Load_MAP1, nullptr, nullptr,    CH_RIFF },
-	{ 'MAP2', Save_MAP2, Load_MAP2, nullptr, nullptr,    CH_RIFF },
-	{ 'M3LO', Save_MAP3, Load_MAP3, nullptr, nullptr,    CH_RIFF },
-	{ 'M3HI', Save_MAP4, Load_MAP4, nullptr, nullptr,    CH_RIFF },
-	{ 'MAP5', Save_MAP5, Load_MAP5, nullptr, nullptr,    CH_RIFF },
-	{ 'MAPE', Save_MAP6, Load_MAP6, nullptr, nullptr,    CH_RIFF },
-	{ 'MAP7', Save_MAP7, Load_MAP7, nullptr, nullptr,    CH_RIFF },
-	{ 'MAP8', Save_MAP8, Load_MAP8, nullptr, nullptr,    CH_RIFF | CH_LAST },
+	{ 'MAPT', Save_MAPT, Load_MAPT, nullptr, nullptr,    CH_RIFF | CH_PARALLEL_SAVE },
+	{ 'MAPH', Save_MAPH, Load_MAPH, nullptr, nullptr,    CH_RIFF | CH_PARALLEL_SAVE },
+	{ 'MAPO', Save_MAP1, Load_MAP1, nullptr, nullptr,    CH_RIFF | CH_PARALLEL_SAVE },
+	{ 'MAP2', Save_MAP2, Load_MAP2, nullptr, nullptr,    CH_RIFF | CH_PARALLEL_SAVE },
+	{ 'M3LO', Save_MAP3, Load_MAP3, nullptr, nullptr,    CH_RIFF | CH_PARALLEL_SAVE },
+	{ 'M3HI', Save_MAP4, Load_MAP4, nullptr, nullptr,    CH_RIFF | CH_PARALLEL_SAVE },
+	{ 'MAP5', Save_MAP5, Load_MAP5, nullptr, nullptr,    CH_RIFF | CH_PARALLEL_SAVE },
+	{ 'MAPE', Save_MAP6, Load_MAP6, nullptr, nullptr,    CH_RIFF | CH_PARALLEL_SAVE },
+	{ 'MAP7', Save_MAP7, Load_MAP7, nullptr, nullptr,    CH_RIFF | CH_PARALLEL_SAVE },
+	{ 'MAP8', Save_MAP8, Load_MAP8, nullptr, nullptr,    CH_RIFF | CH_PARALLEL_SAVE | CH_LAST },
 };
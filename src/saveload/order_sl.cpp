@@ -125,7 +125,7 @@ static void Save_ORDR()
 {
 	for (Order *order : Order::Iterate()) {
 		SlSetArrayIndex(order->index);
-		SlObject(order, GetOrderDescription());
+		SlCompiledObject(order, GetOrderDescription());
 	}
 }
 
@@ -181,7 +181,7 @@ static void Load_ORDR()
 
 		while ((index = SlIterateArray()) != -1) {
 			Order *order = new (index) Order();
-			SlObject(order, GetOrderDescription());
+			SlCompiledObject(order, GetOrderDescription());
 		}
 	}
 }
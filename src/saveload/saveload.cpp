@@ -15,11 +15,14 @@
  * <li>use their description array (#SaveLoad) to know what elements to save and in what version
  *    of the game it was active (used when loading)
  * <li>write all data byte-by-byte to the temporary buffer so it is endian-safe
- * <li>when the buffer is full; flush it to the output (eg save to file) (_sl.buf, _sl.bufp, _sl.bufe)
+ * <li>when the buffer is full; flush it to the output (eg save to file) (_sl->buf, _sl->bufp, _sl->bufe)
  * <li>repeat this until everything is done, and flush any remaining output to file
  * </ol>
  */
 #include <deque>
+#include <unordered_map>
+#include <algorithm>
+#include <memory>
 
 #include "../stdafx.h"
 #include "../debug.h"
@@ -43,7 +46,27 @@
 #include "../string_func.h"
 #include "../fios.h"
 #include "../error.h"
+#include "../worker_pool.h"
 #include <atomic>
+#include <chrono>
+#include <exception>
+
+#if defined(UNIX) && !defined(__EMSCRIPTEN__)
+#	define WITH_SNAPSHOT_SAVE
+#	include <errno.h>
+#	include <sys/wait.h>
+#	include <unistd.h>
+#endif
+
+#if TTD_ENDIAN == TTD_LITTLE_ENDIAN && defined(__SSE2__)
+#	include <emmintrin.h>
+#endif
+
+#if defined(UNIX)
+#	define WITH_MMAP_LOAD
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#endif
 
 #include "table/strings.h"
 
@@ -111,6 +134,38 @@ struct ReadBuffer {
 		return *this->bufp++;
 	}
 
+	/**
+	 * Read a number of bytes at once.
+	 * @param ptr  The location to store the bytes at.
+	 * @param size The number of bytes to read.
+	 */
+	void CopyBytes(byte *ptr, size_t size)
+	{
+		for (;;) {
+			size_t to_copy = min<size_t>(this->bufe - this->bufp, size);
+			if (to_copy != 0) {
+				memcpy(ptr, this->bufp, to_copy);
+				this->bufp += to_copy;
+				ptr += to_copy;
+				size -= to_copy;
+			}
+			if (size == 0) return;
+
+			/* Large reads skip the buffer, so the data gets copied only once. */
+			size_t len = size >= lengthof(this->buf) ? this->reader->Read(ptr, size) : this->reader->Read(this->buf, lengthof(this->buf));
+			if (len == 0) SlErrorCorrupt("Unexpected end of chunk");
+			this->read += len;
+
+			if (size >= lengthof(this->buf)) {
+				ptr += len;
+				size -= len;
+			} else {
+				this->bufp = this->buf;
+				this->bufe = this->buf + len;
+			}
+		}
+	}
+
 	/**
 	 * Get the size of the memory dump made so far.
 	 * @return The size.
@@ -175,6 +230,42 @@ struct MemoryDumper {
 		writer->Finish();
 	}
 
+	/**
+	 * Write a number of bytes into the dumper.
+	 * @param p    The bytes to write.
+	 * @param size The number of bytes to write.
+	 */
+	void Write(const byte *p, size_t size)
+	{
+		while (size > 0) {
+			if (this->buf == this->bufe) {
+				this->buf = CallocT<byte>(MEMORY_CHUNK_SIZE);
+				this->blocks.push_back(this->buf);
+				this->bufe = this->buf + MEMORY_CHUNK_SIZE;
+			}
+
+			size_t to_copy = min<size_t>(size, this->bufe - this->buf);
+			memcpy(this->buf, p, to_copy);
+			this->buf += to_copy;
+			p += to_copy;
+			size -= to_copy;
+		}
+	}
+
+	/**
+	 * Append the contents of another dumper to this dumper.
+	 * @param other The dumper to copy the data from.
+	 */
+	void Append(const MemoryDumper &other)
+	{
+		size_t t = other.GetSize();
+		for (uint i = 0; t > 0; i++) {
+			size_t to_write = min(MEMORY_CHUNK_SIZE, t);
+			this->Write(other.blocks[i], to_write);
+			t -= to_write;
+		}
+	}
+
 	/**
 	 * Get the size of the memory dump made so far.
 	 * @return The size.
@@ -183,6 +274,33 @@ struct MemoryDumper {
 	{
 		return this->blocks.size() * MEMORY_CHUNK_SIZE - (this->bufe - this->buf);
 	}
+
+	/**
+	 * Copy a part of the memory dump.
+	 * @param offset The offset of the part in the dump.
+	 * @param buf    The location to copy the part to.
+	 * @param size   The size of the part.
+	 */
+	void CopyOut(size_t offset, byte *buf, size_t size) const
+	{
+		assert(offset + size <= this->GetSize());
+		while (size > 0) {
+			size_t block_offset = offset % MEMORY_CHUNK_SIZE;
+			size_t to_copy = min(size, MEMORY_CHUNK_SIZE - block_offset);
+			memcpy(buf, this->blocks[offset / MEMORY_CHUNK_SIZE] + block_offset, to_copy);
+			buf += to_copy;
+			offset += to_copy;
+			size -= to_copy;
+		}
+	}
+};
+
+/** Position of a chunk within the uncompressed data of a savegame. */
+struct SavedChunk {
+	uint32 id;     ///< Identifier of the chunk.
+	size_t offset; ///< Offset of the chunk, starting at its identifier.
+	size_t length; ///< Length of the chunk, including its identifier.
+	uint64 time;   ///< Microseconds spent on saving or loading the chunk, if measured.
 };
 
 /** The saveload struct, containing reader-writer functions, buffer, version, etc. */
@@ -206,9 +324,30 @@ struct SaveLoadParams {
 
 	byte ff_state;                       ///< The state of fast-forward when saving started.
 	bool saveinprogress;                 ///< Whether there is currently a save in progress.
+
+	std::string delta_base;              ///< Savegame in the autosave directory to save a delta against, or empty for a full savegame.
+	std::vector<SavedChunk> chunks;      ///< Positions of the saved chunks in #dumper.
 };
 
-static SaveLoadParams _sl; ///< Parameters used for/at saveload.
+/**
+ * Get a timestamp to measure the time spent on parts of saving and loading.
+ * @return The timestamp in microseconds.
+ */
+static uint64 GetSaveLoadTimer()
+{
+	using namespace std::chrono;
+	return (uint64)time_point_cast<microseconds>(steady_clock::now()).time_since_epoch().count();
+}
+
+static std::vector<SavedChunk> _loaded_chunks; ///< Positions and loading times of the chunks of the last loaded savegame.
+static uint64 _fix_pointers_time;              ///< Microseconds spent fixing the pointers of the last loaded savegame.
+static uint64 _after_load_time;                ///< Microseconds spent in AfterLoadGame for the last loaded savegame.
+static uint64 _save_blocking_time;             ///< Microseconds the game was halted by the last save.
+static std::atomic<uint64> _save_write_time;   ///< Microseconds spent compressing and writing the last save, possibly in the save thread.
+
+static SaveLoadParams _sl_main; ///< Parameters used for/at saveload.
+/** Parameters of the current thread; chunks saved in parallel each get their own copy of #_sl_main. */
+static thread_local SaveLoadParams *_sl = &_sl_main;
 
 /* these define the chunks */
 extern const ChunkHandler _gamelog_chunk_handlers[];
@@ -294,7 +433,7 @@ static const ChunkHandler * const _chunk_handlers[] = {
 /** Null all pointers (convert index -> nullptr) */
 static void SlNullPointers()
 {
-	_sl.action = SLA_NULL;
+	_sl->action = SLA_NULL;
 
 	/* We don't want any savegame conversion code to run
 	 * during NULLing; especially those that try to get
@@ -312,7 +451,7 @@ static void SlNullPointers()
 
 	DEBUG(sl, 1, "All pointers nulled");
 
-	assert(_sl.action == SLA_NULL);
+	assert(_sl->action == SLA_NULL);
 }
 
 /**
@@ -326,21 +465,21 @@ static void SlNullPointers()
 void NORETURN SlError(StringID string, const char *extra_msg)
 {
 	/* Distinguish between loading into _load_check_data vs. normal save/load. */
-	if (_sl.action == SLA_LOAD_CHECK) {
+	if (_sl->action == SLA_LOAD_CHECK) {
 		_load_check_data.error = string;
 		free(_load_check_data.error_data);
 		_load_check_data.error_data = (extra_msg == nullptr) ? nullptr : stredup(extra_msg);
 	} else {
-		_sl.error_str = string;
-		free(_sl.extra_msg);
-		_sl.extra_msg = (extra_msg == nullptr) ? nullptr : stredup(extra_msg);
+		_sl->error_str = string;
+		free(_sl->extra_msg);
+		_sl->extra_msg = (extra_msg == nullptr) ? nullptr : stredup(extra_msg);
 	}
 
 	/* We have to nullptr all pointers here; we might be in a state where
 	 * the pointers are actually filled with indices, which means that
 	 * when we access them during cleaning the pool dereferences of
 	 * those indices will be made with segmentation faults as result. */
-	if (_sl.action == SLA_LOAD || _sl.action == SLA_PTRS) SlNullPointers();
+	if (_sl->action == SLA_LOAD || _sl->action == SLA_PTRS) SlNullPointers();
 	throw std::exception();
 }
 
@@ -380,6 +519,10 @@ typedef void (*AsyncSaveFinishProc)();                      ///< Callback for wh
 static std::atomic<AsyncSaveFinishProc> _async_save_finish; ///< Callback to call when the savegame loading is finished.
 static std::thread _save_thread;                            ///< The thread we're using to compress and write a savegame
 
+#ifdef WITH_SNAPSHOT_SAVE
+static void ProcessSnapshotSaveFinish(bool wait);
+#endif /* WITH_SNAPSHOT_SAVE */
+
 /**
  * Called by save thread to tell we finished saving.
  * @param proc The callback to call when saving is done.
@@ -397,6 +540,10 @@ static void SetAsyncSaveFinish(AsyncSaveFinishProc proc)
  */
 void ProcessAsyncSaveFinish()
 {
+#ifdef WITH_SNAPSHOT_SAVE
+	ProcessSnapshotSaveFinish(false);
+#endif /* WITH_SNAPSHOT_SAVE */
+
 	AsyncSaveFinishProc proc = _async_save_finish.exchange(nullptr, std::memory_order_acq_rel);
 	if (proc == nullptr) return;
 
@@ -413,7 +560,7 @@ void ProcessAsyncSaveFinish()
  */
 byte SlReadByte()
 {
-	return _sl.reader->ReadByte();
+	return _sl->reader->ReadByte();
 }
 
 /**
@@ -422,7 +569,7 @@ byte SlReadByte()
  */
 void SlWriteByte(byte b)
 {
-	_sl.dumper->WriteByte(b);
+	_sl->dumper->WriteByte(b);
 }
 
 static inline int SlReadUint16()
@@ -624,8 +771,8 @@ static inline size_t SlCalcRefLen()
 
 void SlSetArrayIndex(uint index)
 {
-	_sl.need_length = NL_WANTLENGTH;
-	_sl.array_index = index;
+	_sl->need_length = NL_WANTLENGTH;
+	_sl->array_index = index;
 }
 
 static size_t _next_offs;
@@ -640,7 +787,7 @@ int SlIterateArray()
 
 	/* After reading in the whole array inside the loop
 	 * we must have read in all the data, so we must be at end of current block. */
-	if (_next_offs != 0 && _sl.reader->GetSize() != _next_offs) SlErrorCorrupt("Invalid chunk size");
+	if (_next_offs != 0 && _sl->reader->GetSize() != _next_offs) SlErrorCorrupt("Invalid chunk size");
 
 	for (;;) {
 		uint length = SlReadArrayLength();
@@ -649,12 +796,12 @@ int SlIterateArray()
 			return -1;
 		}
 
-		_sl.obj_len = --length;
-		_next_offs = _sl.reader->GetSize() + length;
+		_sl->obj_len = --length;
+		_next_offs = _sl->reader->GetSize() + length;
 
-		switch (_sl.block_mode) {
+		switch (_sl->block_mode) {
 			case CH_SPARSE_ARRAY: index = (int)SlReadSparseIndex(); break;
-			case CH_ARRAY:        index = _sl.array_index++; break;
+			case CH_ARRAY:        index = _sl->array_index++; break;
 			default:
 				DEBUG(sl, 0, "SlIterateArray error");
 				return -1; // error
@@ -670,7 +817,7 @@ int SlIterateArray()
 void SlSkipArray()
 {
 	while (SlIterateArray() != -1) {
-		SlSkipBytes(_next_offs - _sl.reader->GetSize());
+		SlSkipBytes(_next_offs - _sl->reader->GetSize());
 	}
 }
 
@@ -681,12 +828,12 @@ void SlSkipArray()
  */
 void SlSetLength(size_t length)
 {
-	assert(_sl.action == SLA_SAVE);
+	assert(_sl->action == SLA_SAVE);
 
-	switch (_sl.need_length) {
+	switch (_sl->need_length) {
 		case NL_WANTLENGTH:
-			_sl.need_length = NL_NONE;
-			switch (_sl.block_mode) {
+			_sl->need_length = NL_NONE;
+			switch (_sl->block_mode) {
 				case CH_RIFF:
 					/* Ugly encoding of >16M RIFF chunks
 					 * The lower 24 bits are normal
@@ -695,22 +842,22 @@ void SlSetLength(size_t length)
 					SlWriteUint32((uint32)((length & 0xFFFFFF) | ((length >> 24) << 28)));
 					break;
 				case CH_ARRAY:
-					assert(_sl.last_array_index <= _sl.array_index);
-					while (++_sl.last_array_index <= _sl.array_index) {
+					assert(_sl->last_array_index <= _sl->array_index);
+					while (++_sl->last_array_index <= _sl->array_index) {
 						SlWriteArrayLength(1);
 					}
 					SlWriteArrayLength(length + 1);
 					break;
 				case CH_SPARSE_ARRAY:
-					SlWriteArrayLength(length + 1 + SlGetArrayLength(_sl.array_index)); // Also include length of sparse index.
-					SlWriteSparseIndex(_sl.array_index);
+					SlWriteArrayLength(length + 1 + SlGetArrayLength(_sl->array_index)); // Also include length of sparse index.
+					SlWriteSparseIndex(_sl->array_index);
 					break;
 				default: NOT_REACHED();
 			}
 			break;
 
 		case NL_CALCLENGTH:
-			_sl.obj_len += (int)length;
+			_sl->obj_len += (int)length;
 			break;
 
 		default: NOT_REACHED();
@@ -727,13 +874,13 @@ static void SlCopyBytes(void *ptr, size_t length)
 {
 	byte *p = (byte *)ptr;
 
-	switch (_sl.action) {
+	switch (_sl->action) {
 		case SLA_LOAD_CHECK:
 		case SLA_LOAD:
-			for (; length != 0; length--) *p++ = SlReadByte();
+			_sl->reader->CopyBytes(p, length);
 			break;
 		case SLA_SAVE:
-			for (; length != 0; length--) SlWriteByte(*p++);
+			_sl->dumper->Write(p, length);
 			break;
 		default: NOT_REACHED();
 	}
@@ -742,7 +889,7 @@ static void SlCopyBytes(void *ptr, size_t length)
 /** Get the length of the current object */
 size_t SlGetFieldLength()
 {
-	return _sl.obj_len;
+	return _sl->obj_len;
 }
 
 /**
@@ -804,7 +951,7 @@ void WriteValue(void *ptr, VarType conv, int64 val)
  */
 static void SlSaveLoadConv(void *ptr, VarType conv)
 {
-	switch (_sl.action) {
+	switch (_sl->action) {
 		case SLA_SAVE: {
 			int64 x = ReadValue(ptr, conv);
 
@@ -905,7 +1052,7 @@ static inline size_t SlCalcStringLen(const void *ptr, size_t length, VarType con
  */
 static void SlString(void *ptr, size_t length, VarType conv)
 {
-	switch (_sl.action) {
+	switch (_sl->action) {
 		case SLA_SAVE: {
 			size_t len;
 			switch (GetVarMemType(conv)) {
@@ -986,6 +1133,67 @@ static inline size_t SlCalcArrayLen(size_t length, VarType conv)
 	return SlCalcConvFileLen(conv) * length;
 }
 
+/**
+ * Convert 16 bit values between the byte order of the savegame (big endian) and of the memory.
+ * @param dst   The destination of the converted values; may be the same as \a src.
+ * @param src   The values to convert.
+ * @param count The number of values.
+ */
+static void SlConvertBigEndian(uint16 *dst, const uint16 *src, size_t count)
+{
+#if TTD_ENDIAN == TTD_BIG_ENDIAN
+	if (dst != src) MemCpyT(dst, src, count);
+#else
+	size_t i = 0;
+#	ifdef __SSE2__
+	for (; i + 8 <= count; i += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+	}
+#	endif /* __SSE2__ */
+	for (; i < count; i++) dst[i] = BSWAP16(src[i]);
+#endif
+}
+
+/**
+ * Convert 32 bit values between the byte order of the savegame (big endian) and of the memory.
+ * @param dst   The destination of the converted values; may be the same as \a src.
+ * @param src   The values to convert.
+ * @param count The number of values.
+ */
+static void SlConvertBigEndian(uint32 *dst, const uint32 *src, size_t count)
+{
+#if TTD_ENDIAN == TTD_BIG_ENDIAN
+	if (dst != src) MemCpyT(dst, src, count);
+#else
+	for (size_t i = 0; i < count; i++) dst[i] = BSWAP32(src[i]);
+#endif
+}
+
+/**
+ * Save/Load an array of values that have the same size in memory and in the savegame.
+ * Instead of converting value by value, the array is copied in bulk and its byte order fixed in one go.
+ * @param array  The array being manipulated.
+ * @param length The length of the array in elements.
+ */
+template <typename T>
+static void SlCopyBigEndianArray(T *array, size_t length)
+{
+	if (_sl->action == SLA_SAVE) {
+		T buf[1024];
+		while (length != 0) {
+			size_t count = min(length, lengthof(buf));
+			SlConvertBigEndian(buf, array, count);
+			_sl->dumper->Write((const byte *)buf, count * sizeof(T));
+			array += count;
+			length -= count;
+		}
+	} else {
+		SlCopyBytes(array, length * sizeof(T));
+		SlConvertBigEndian(array, array, length);
+	}
+}
+
 /**
  * Save/Load an array.
  * @param array The array being manipulated
@@ -994,18 +1202,18 @@ static inline size_t SlCalcArrayLen(size_t length, VarType conv)
  */
 void SlArray(void *array, size_t length, VarType conv)
 {
-	if (_sl.action == SLA_PTRS || _sl.action == SLA_NULL) return;
+	if (_sl->action == SLA_PTRS || _sl->action == SLA_NULL) return;
 
 	/* Automatically calculate the length? */
-	if (_sl.need_length != NL_NONE) {
+	if (_sl->need_length != NL_NONE) {
 		SlSetLength(SlCalcArrayLen(length, conv));
 		/* Determine length only? */
-		if (_sl.need_length == NL_CALCLENGTH) return;
+		if (_sl->need_length == NL_CALCLENGTH) return;
 	}
 
 	/* NOTICE - handle some buggy stuff, in really old versions everything was saved
 	 * as a byte-type. So detect this, and adjust array size accordingly */
-	if (_sl.action != SLA_SAVE && _sl_version == 0) {
+	if (_sl->action != SLA_SAVE && _sl_version == 0) {
 		/* all arrays except difficulty settings */
 		if (conv == SLE_INT16 || conv == SLE_UINT16 || conv == SLE_STRINGID ||
 				conv == SLE_INT32 || conv == SLE_UINT32) {
@@ -1025,6 +1233,10 @@ void SlArray(void *array, size_t length, VarType conv)
 	 * conversion is needed, use specialized copy-copy function to speed up things */
 	if (conv == SLE_INT8 || conv == SLE_UINT8) {
 		SlCopyBytes(array, length);
+	} else if (conv == SLE_INT16 || conv == SLE_UINT16) {
+		SlCopyBigEndianArray((uint16 *)array, length);
+	} else if (conv == SLE_INT32 || conv == SLE_UINT32) {
+		SlCopyBigEndianArray((uint32 *)array, length);
 	} else {
 		byte *a = (byte*)array;
 		byte mem_size = SlCalcConvMemLen(conv);
@@ -1049,7 +1261,7 @@ void SlArray(void *array, size_t length, VarType conv)
  */
 static size_t ReferenceToInt(const void *obj, SLRefType rt)
 {
-	assert(_sl.action == SLA_SAVE);
+	assert(_sl->action == SLA_SAVE);
 
 	if (obj == nullptr) return 0;
 
@@ -1084,7 +1296,7 @@ static void *IntToReference(size_t index, SLRefType rt)
 {
 	assert_compile(sizeof(size_t) <= sizeof(void *));
 
-	assert(_sl.action == SLA_PTRS);
+	assert(_sl->action == SLA_PTRS);
 
 	/* After version 4.3 REF_VEHICLE_OLD is saved as REF_VEHICLE,
 	 * and should be loaded like that */
@@ -1153,11 +1365,13 @@ static void *IntToReference(size_t index, SLRefType rt)
 
 /**
  * Return the size in bytes of a list
- * @param list The std::list to find the size of
+ * @tparam PtrList Container of references the list is stored in.
+ * @param list The std::list or std::vector to find the size of
  */
+template <typename PtrList>
 static inline size_t SlCalcListLen(const void *list)
 {
-	const std::list<void *> *l = (const std::list<void *> *) list;
+	const PtrList *l = (const PtrList *) list;
 
 	int type_size = IsSavegameVersionBefore(SLV_69) ? 2 : 4;
 	/* Each entry is saved as type_size bytes, plus type_size bytes are used for the length
@@ -1167,27 +1381,28 @@ static inline size_t SlCalcListLen(const void *list)
 
 
 /**
- * Save/Load a list.
+ * Save/Load a list. Lists stored in a std::vector have the same format as those in a std::list.
+ * @tparam PtrList Container of references the list is stored in.
  * @param list The list being manipulated
  * @param conv SLRefType type of the list (Vehicle *, Station *, etc)
  */
+template <typename PtrList>
 static void SlList(void *list, SLRefType conv)
 {
 	/* Automatically calculate the length? */
-	if (_sl.need_length != NL_NONE) {
-		SlSetLength(SlCalcListLen(list));
+	if (_sl->need_length != NL_NONE) {
+		SlSetLength(SlCalcListLen<PtrList>(list));
 		/* Determine length only? */
-		if (_sl.need_length == NL_CALCLENGTH) return;
+		if (_sl->need_length == NL_CALCLENGTH) return;
 	}
 
-	typedef std::list<void *> PtrList;
 	PtrList *l = (PtrList *)list;
 
-	switch (_sl.action) {
+	switch (_sl->action) {
 		case SLA_SAVE: {
 			SlWriteUint32((uint32)l->size());
 
-			PtrList::iterator iter;
+			typename PtrList::iterator iter;
 			for (iter = l->begin(); iter != l->end(); ++iter) {
 				void *ptr = *iter;
 				SlWriteUint32((uint32)ReferenceToInt(ptr, conv));
@@ -1209,7 +1424,7 @@ static void SlList(void *list, SLRefType conv)
 			PtrList temp = *l;
 
 			l->clear();
-			PtrList::iterator iter;
+			typename PtrList::iterator iter;
 			for (iter = temp.begin(); iter != temp.end(); ++iter) {
 				void *ptr = IntToReference((size_t)*iter, conv);
 				l->push_back(ptr);
@@ -1255,7 +1470,7 @@ public:
 	{
 		SlDequeT *l = (SlDequeT *)deque;
 
-		switch (_sl.action) {
+		switch (_sl->action) {
 			case SLA_SAVE: {
 				SlWriteUint32((uint32)l->size());
 
@@ -1363,7 +1578,7 @@ static inline bool SlIsObjectValidInSavegame(const SaveLoad *sld)
  */
 static inline bool SlSkipVariableOnLoad(const SaveLoad *sld)
 {
-	if ((sld->conv & SLF_NO_NETWORK_SYNC) && _sl.action != SLA_SAVE && _networking && !_network_server) {
+	if ((sld->conv & SLF_NO_NETWORK_SYNC) && _sl->action != SLA_SAVE && _networking && !_network_server) {
 		SlSkipBytes(SlCalcConvMemLen(sld->conv) * sld->length);
 		return true;
 	}
@@ -1390,7 +1605,7 @@ size_t SlCalcObjLength(const void *object, const SaveLoad *sld)
 
 size_t SlCalcObjMemberLength(const void *object, const SaveLoad *sld)
 {
-	assert(_sl.action == SLA_SAVE);
+	assert(_sl->action == SLA_SAVE);
 
 	switch (sld->cmd) {
 		case SL_VAR:
@@ -1399,6 +1614,7 @@ size_t SlCalcObjMemberLength(const void *object, const SaveLoad *sld)
 		case SL_STR:
 		case SL_LST:
 		case SL_DEQUE:
+		case SL_VEC:
 			/* CONDITIONAL saveload types depend on the savegame version */
 			if (!SlIsObjectValidInSavegame(sld)) break;
 
@@ -1407,7 +1623,8 @@ size_t SlCalcObjMemberLength(const void *object, const SaveLoad *sld)
 				case SL_REF: return SlCalcRefLen();
 				case SL_ARR: return SlCalcArrayLen(sld->length, sld->conv);
 				case SL_STR: return SlCalcStringLen(GetVariableAddress(object, sld), sld->length, sld->conv);
-				case SL_LST: return SlCalcListLen(GetVariableAddress(object, sld));
+				case SL_LST: return SlCalcListLen<std::list<void *>>(GetVariableAddress(object, sld));
+				case SL_VEC: return SlCalcListLen<std::vector<void *>>(GetVariableAddress(object, sld));
 				case SL_DEQUE: return SlCalcDequeLen(GetVariableAddress(object, sld), sld->conv);
 				default: NOT_REACHED();
 			}
@@ -1478,6 +1695,7 @@ bool SlObjectMember(void *ptr, const SaveLoad *sld)
 		case SL_STR:
 		case SL_LST:
 		case SL_DEQUE:
+		case SL_VEC:
 			/* CONDITIONAL saveload types depend on the savegame version */
 			if (!SlIsObjectValidInSavegame(sld)) return false;
 			if (SlSkipVariableOnLoad(sld)) return false;
@@ -1485,7 +1703,7 @@ bool SlObjectMember(void *ptr, const SaveLoad *sld)
 			switch (sld->cmd) {
 				case SL_VAR: SlSaveLoadConv(ptr, conv); break;
 				case SL_REF: // Reference variable, translate
-					switch (_sl.action) {
+					switch (_sl->action) {
 						case SLA_SAVE:
 							SlWriteUint32((uint32)ReferenceToInt(*(void **)ptr, (SLRefType)conv));
 							break;
@@ -1504,7 +1722,8 @@ bool SlObjectMember(void *ptr, const SaveLoad *sld)
 					break;
 				case SL_ARR: SlArray(ptr, sld->length, conv); break;
 				case SL_STR: SlString(ptr, sld->length, sld->conv); break;
-				case SL_LST: SlList(ptr, (SLRefType)conv); break;
+				case SL_LST: SlList<std::list<void *>>(ptr, (SLRefType)conv); break;
+				case SL_VEC: SlList<std::vector<void *>>(ptr, (SLRefType)conv); break;
 				case SL_DEQUE: SlDeque(ptr, conv); break;
 				default: NOT_REACHED();
 			}
@@ -1514,7 +1733,7 @@ bool SlObjectMember(void *ptr, const SaveLoad *sld)
 		 * When loading, the value is read explicitly with SlReadByte() to determine which
 		 * object description to use. */
 		case SL_WRITEBYTE:
-			switch (_sl.action) {
+			switch (_sl->action) {
 				case SLA_SAVE: SlWriteByte(*(uint8 *)ptr); break;
 				case SLA_LOAD_CHECK:
 				case SLA_LOAD:
@@ -1546,9 +1765,9 @@ bool SlObjectMember(void *ptr, const SaveLoad *sld)
 void SlObject(void *object, const SaveLoad *sld)
 {
 	/* Automatically calculate the length? */
-	if (_sl.need_length != NL_NONE) {
+	if (_sl->need_length != NL_NONE) {
 		SlSetLength(SlCalcObjLength(object, sld));
-		if (_sl.need_length == NL_CALCLENGTH) return;
+		if (_sl->need_length == NL_CALCLENGTH) return;
 	}
 
 	for (; sld->cmd != SL_END; sld++) {
@@ -1557,6 +1776,212 @@ void SlObject(void *object, const SaveLoad *sld)
 	}
 }
 
+/** Handler of a single field of a compiled SaveLoad description. */
+typedef void SlCompiledFieldProc(void *ptr);
+
+/**
+ * Write a value of a fixed size to the savegame.
+ * @tparam Tfile Type of the value in the savegame.
+ * @param x The value to write.
+ */
+template <typename Tfile>
+static inline void SlWriteFileValue(int64 x)
+{
+	switch (sizeof(Tfile)) {
+		case 1: SlWriteByte((byte)x); break;
+		case 2: SlWriteUint16((uint16)x); break;
+		case 4: SlWriteUint32((uint32)x); break;
+		case 8: SlWriteUint64((uint64)x); break;
+		default: NOT_REACHED();
+	}
+}
+
+/**
+ * Read a value of a fixed size from the savegame.
+ * @tparam Tfile Type of the value in the savegame.
+ * @return The value that was read.
+ */
+template <typename Tfile>
+static inline Tfile SlReadFileValue()
+{
+	switch (sizeof(Tfile)) {
+		case 1: return (Tfile)SlReadByte();
+		case 2: return (Tfile)SlReadUint16();
+		case 4: return (Tfile)SlReadUint32();
+		case 8: return (Tfile)SlReadUint64();
+		default: NOT_REACHED();
+	}
+}
+
+/** Save a variable, like #SlSaveLoadConv but with the types known at compile time. */
+template <typename Tmem, typename Tfile>
+static void SlSaveVar(void *ptr)
+{
+	int64 x = (int64)*(const Tmem *)ptr;
+	assert(sizeof(Tfile) >= 4 || (int64)(Tfile)x == x);
+	SlWriteFileValue<Tfile>(x);
+}
+
+/** Load a variable, like #SlSaveLoadConv but with the types known at compile time. */
+template <typename Tmem, typename Tfile>
+static void SlLoadVar(void *ptr)
+{
+	*(Tmem *)ptr = (Tmem)SlReadFileValue<Tfile>();
+}
+
+/**
+ * Get the handler of a variable for a known type in the savegame.
+ * @tparam Tfile Type of the variable in the savegame.
+ * @param conv The type of the variable.
+ * @param save Whether the handler is for saving.
+ * @return The handler, or \c nullptr if the variable has to be handled by #SlObjectMember.
+ */
+template <typename Tfile>
+static SlCompiledFieldProc *GetSlVarProc(VarType conv, bool save)
+{
+	switch (GetVarMemType(conv)) {
+		case SLE_VAR_BL:  return save ? &SlSaveVar<bool,   Tfile> : &SlLoadVar<bool,   Tfile>;
+		case SLE_VAR_I8:  return save ? &SlSaveVar<int8,   Tfile> : &SlLoadVar<int8,   Tfile>;
+		case SLE_VAR_U8:  return save ? &SlSaveVar<byte,   Tfile> : &SlLoadVar<byte,   Tfile>;
+		case SLE_VAR_I16: return save ? &SlSaveVar<int16,  Tfile> : &SlLoadVar<int16,  Tfile>;
+		case SLE_VAR_U16: return save ? &SlSaveVar<uint16, Tfile> : &SlLoadVar<uint16, Tfile>;
+		case SLE_VAR_I32: return save ? &SlSaveVar<int32,  Tfile> : &SlLoadVar<int32,  Tfile>;
+		case SLE_VAR_U32: return save ? &SlSaveVar<uint32, Tfile> : &SlLoadVar<uint32, Tfile>;
+		case SLE_VAR_I64: return save ? &SlSaveVar<int64,  Tfile> : &SlLoadVar<int64,  Tfile>;
+		case SLE_VAR_U64: return save ? &SlSaveVar<uint64, Tfile> : &SlLoadVar<uint64, Tfile>;
+		default: return nullptr;
+	}
+}
+
+/**
+ * Get the handler of a variable.
+ * @param conv The type of the variable.
+ * @param save Whether the handler is for saving.
+ * @return The handler, or \c nullptr if the variable has to be handled by #SlObjectMember.
+ */
+static SlCompiledFieldProc *GetSlVarProc(VarType conv, bool save)
+{
+	switch (GetVarFileType(conv)) {
+		case SLE_FILE_I8:  return GetSlVarProc<int8>(conv, save);
+		case SLE_FILE_U8:  return GetSlVarProc<byte>(conv, save);
+		case SLE_FILE_I16: return GetSlVarProc<int16>(conv, save);
+		case SLE_FILE_U16: return GetSlVarProc<uint16>(conv, save);
+		case SLE_FILE_I32: return GetSlVarProc<int32>(conv, save);
+		case SLE_FILE_U32: return GetSlVarProc<uint32>(conv, save);
+		case SLE_FILE_I64: return GetSlVarProc<int64>(conv, save);
+		case SLE_FILE_U64: return GetSlVarProc<uint64>(conv, save);
+		default: return nullptr; // String IDs are remapped when loading
+	}
+}
+
+/** A field of a compiled SaveLoad description. */
+struct SlCompiledField {
+	const SaveLoad *sld;        ///< The description of the field.
+	SlCompiledFieldProc *proc;  ///< Handler of the field, or \c nullptr to use #SlObjectMember.
+};
+
+/**
+ * A SaveLoad description reduced to the fields of the savegame version at
+ * hand, with the included descriptions expanded and the handlers of the
+ * variables resolved, for one kind of action.
+ */
+struct SlCompiledDescription {
+	SaveLoadVersion version;             ///< Savegame version the description is compiled for.
+	SaveLoadAction action;               ///< Action the description is compiled for.
+	bool network_client;                 ///< Whether the description is compiled for a network client.
+	std::vector<SlCompiledField> fields; ///< The fields in the savegame.
+	size_t fixed_length;                 ///< Length in the savegame of the fields that do not depend on the object.
+	std::vector<const SaveLoad *> variable_length; ///< Fields with a length in the savegame that depends on the object.
+};
+
+/** Compiled descriptions of the current thread, by their SaveLoad description. */
+static thread_local std::unordered_map<const SaveLoad *, SlCompiledDescription> _sl_compiled;
+
+/**
+ * Add the fields of a SaveLoad description to a compiled description.
+ * @param desc The compiled description.
+ * @param sld The SaveLoad description.
+ */
+static void SlCompileDescription(SlCompiledDescription &desc, const SaveLoad *sld)
+{
+	bool save = desc.action == SLA_SAVE;
+	for (; sld->cmd != SL_END; sld++) {
+		switch (sld->cmd) {
+			case SL_VEH_INCLUDE: SlCompileDescription(desc, GetVehicleDescription(VEH_END)); continue;
+			case SL_ST_INCLUDE: SlCompileDescription(desc, GetBaseStationDescription()); continue;
+			case SL_WRITEBYTE: break;
+			default:
+				if (!SlIsObjectValidInSavegame(sld)) continue;
+				break;
+		}
+
+		SlCompiledField field = { sld, nullptr };
+		/* Variables that are not synced to network clients are skipped by SlObjectMember. */
+		if (sld->cmd == SL_VAR && (!desc.network_client || !(sld->conv & SLF_NO_NETWORK_SYNC))) {
+			field.proc = GetSlVarProc(sld->conv, save);
+		}
+		desc.fields.push_back(field);
+
+		if (!save) continue;
+		switch (sld->cmd) {
+			case SL_VAR:
+			case SL_REF:
+			case SL_ARR:
+			case SL_WRITEBYTE:
+				desc.fixed_length += SlCalcObjMemberLength(nullptr, sld);
+				break;
+			default:
+				desc.variable_length.push_back(sld);
+				break;
+		}
+	}
+}
+
+/**
+ * Save or load an object like #SlObject, but with its description compiled
+ * once for the savegame version and action at hand. This avoids checking the
+ * savegame version and type of every field for every object, which matters
+ * for chunks with very many objects.
+ * @param object The object that is being saved or loaded.
+ * @param sld The SaveLoad description of the object; it must not change during the lifetime of the game.
+ */
+void SlCompiledObject(void *object, const SaveLoad *sld)
+{
+	if (_sl->action != SLA_SAVE && _sl->action != SLA_LOAD && _sl->action != SLA_LOAD_CHECK) {
+		SlObject(object, sld);
+		return;
+	}
+
+	bool network_client = _networking && !_network_server;
+	SlCompiledDescription &desc = _sl_compiled[sld];
+	if (desc.fields.empty() || desc.version != _sl_version || desc.action != _sl->action || desc.network_client != network_client) {
+		desc.version = _sl_version;
+		desc.action = _sl->action;
+		desc.network_client = network_client;
+		desc.fields.clear();
+		desc.fixed_length = 0;
+		desc.variable_length.clear();
+		SlCompileDescription(desc, sld);
+	}
+
+	/* Automatically calculate the length? */
+	if (_sl->need_length != NL_NONE) {
+		size_t length = desc.fixed_length;
+		for (const SaveLoad *field : desc.variable_length) length += SlCalcObjMemberLength(object, field);
+		SlSetLength(length);
+		if (_sl->need_length == NL_CALCLENGTH) return;
+	}
+
+	for (const SlCompiledField &field : desc.fields) {
+		void *ptr = field.sld->global ? field.sld->address : GetVariableAddress(object, field.sld);
+		if (field.proc != nullptr) {
+			field.proc(ptr);
+		} else {
+			SlObjectMember(ptr, field.sld);
+		}
+	}
+}
+
 /**
  * Save or Load (a list of) global variables
  * @param sldg The global variable that is being loaded or saved
@@ -1575,23 +2000,23 @@ void SlAutolength(AutolengthProc *proc, void *arg)
 {
 	size_t offs;
 
-	assert(_sl.action == SLA_SAVE);
+	assert(_sl->action == SLA_SAVE);
 
 	/* Tell it to calculate the length */
-	_sl.need_length = NL_CALCLENGTH;
-	_sl.obj_len = 0;
+	_sl->need_length = NL_CALCLENGTH;
+	_sl->obj_len = 0;
 	proc(arg);
 
 	/* Setup length */
-	_sl.need_length = NL_WANTLENGTH;
-	SlSetLength(_sl.obj_len);
+	_sl->need_length = NL_WANTLENGTH;
+	SlSetLength(_sl->obj_len);
 
-	offs = _sl.dumper->GetSize() + _sl.obj_len;
+	offs = _sl->dumper->GetSize() + _sl->obj_len;
 
 	/* And write the stuff */
 	proc(arg);
 
-	if (offs != _sl.dumper->GetSize()) SlErrorCorrupt("Invalid chunk size");
+	if (offs != _sl->dumper->GetSize()) SlErrorCorrupt("Invalid chunk size");
 }
 
 /**
@@ -1604,12 +2029,12 @@ static void SlLoadChunk(const ChunkHandler *ch)
 	size_t len;
 	size_t endoffs;
 
-	_sl.block_mode = m;
-	_sl.obj_len = 0;
+	_sl->block_mode = m;
+	_sl->obj_len = 0;
 
 	switch (m) {
 		case CH_ARRAY:
-			_sl.array_index = 0;
+			_sl->array_index = 0;
 			ch->load_proc();
 			if (_next_offs != 0) SlErrorCorrupt("Invalid array length");
 			break;
@@ -1622,10 +2047,10 @@ static void SlLoadChunk(const ChunkHandler *ch)
 				/* Read length */
 				len = (SlReadByte() << 16) | ((m >> 4) << 24);
 				len += SlReadUint16();
-				_sl.obj_len = len;
-				endoffs = _sl.reader->GetSize() + len;
+				_sl->obj_len = len;
+				endoffs = _sl->reader->GetSize() + len;
 				ch->load_proc();
-				if (_sl.reader->GetSize() != endoffs) SlErrorCorrupt("Invalid chunk size");
+				if (_sl->reader->GetSize() != endoffs) SlErrorCorrupt("Invalid chunk size");
 			} else {
 				SlErrorCorrupt("Invalid chunk type");
 			}
@@ -1644,12 +2069,12 @@ static void SlLoadCheckChunk(const ChunkHandler *ch)
 	size_t len;
 	size_t endoffs;
 
-	_sl.block_mode = m;
-	_sl.obj_len = 0;
+	_sl->block_mode = m;
+	_sl->obj_len = 0;
 
 	switch (m) {
 		case CH_ARRAY:
-			_sl.array_index = 0;
+			_sl->array_index = 0;
 			if (ch->load_check_proc) {
 				ch->load_check_proc();
 			} else {
@@ -1668,14 +2093,14 @@ static void SlLoadCheckChunk(const ChunkHandler *ch)
 				/* Read length */
 				len = (SlReadByte() << 16) | ((m >> 4) << 24);
 				len += SlReadUint16();
-				_sl.obj_len = len;
-				endoffs = _sl.reader->GetSize() + len;
+				_sl->obj_len = len;
+				endoffs = _sl->reader->GetSize() + len;
 				if (ch->load_check_proc) {
 					ch->load_check_proc();
 				} else {
 					SlSkipBytes(len);
 				}
-				if (_sl.reader->GetSize() != endoffs) SlErrorCorrupt("Invalid chunk size");
+				if (_sl->reader->GetSize() != endoffs) SlErrorCorrupt("Invalid chunk size");
 			} else {
 				SlErrorCorrupt("Invalid chunk type");
 			}
@@ -1687,7 +2112,7 @@ static void SlLoadCheckChunk(const ChunkHandler *ch)
  * Stub Chunk handlers to only calculate length and do nothing else.
  * The intended chunk handler that should be called.
  */
-static ChunkSaveLoadProc *_stub_save_proc;
+static thread_local ChunkSaveLoadProc *_stub_save_proc;
 
 /**
  * Stub Chunk handlers to only calculate length and do nothing else.
@@ -1730,14 +2155,14 @@ static void SlSaveChunk(const ChunkHandler *ch)
 		proc = SlStubSaveProc;
 	}
 
-	_sl.block_mode = ch->flags & CH_TYPE_MASK;
+	_sl->block_mode = ch->flags & CH_TYPE_MASK;
 	switch (ch->flags & CH_TYPE_MASK) {
 		case CH_RIFF:
-			_sl.need_length = NL_WANTLENGTH;
+			_sl->need_length = NL_WANTLENGTH;
 			proc();
 			break;
 		case CH_ARRAY:
-			_sl.last_array_index = 0;
+			_sl->last_array_index = 0;
 			SlWriteByte(CH_ARRAY);
 			proc();
 			SlWriteArrayLength(0); // Terminate arrays
@@ -1751,11 +2176,79 @@ static void SlSaveChunk(const ChunkHandler *ch)
 	}
 }
 
+/** A chunk that is saved in parallel to the other chunks. */
+struct ParallelSaveChunk {
+	const ChunkHandler *ch;       ///< The handler of the chunk.
+	MemoryDumper dumper;          ///< The saved chunk.
+	uint64 time;                  ///< Microseconds spent on saving the chunk.
+	std::exception_ptr error;     ///< The error thrown while saving the chunk, if any.
+	StringID error_str;           ///< The translatable error message of the error.
+	char *extra_msg;              ///< The extra error message of the error.
+};
+
 /** Save all chunks */
 static void SlSaveChunks()
 {
+	/* Chunks that only read the game state can be saved concurrently; they are added to the savegame in their normal order. */
+	std::vector<ParallelSaveChunk> parallel;
+	FOR_ALL_CHUNK_HANDLERS(ch) {
+		if ((ch->flags & CH_PARALLEL_SAVE) != 0 && ch->save_proc != nullptr) {
+			parallel.emplace_back();
+			parallel.back().ch = ch;
+		}
+	}
+
+	RunParallelFor((uint)parallel.size(), 1, [&parallel](uint begin, uint end) {
+		SaveLoadParams *main = _sl;
+		for (uint i = begin; i < end; i++) {
+			ParallelSaveChunk &chunk = parallel[i];
+			SaveLoadParams params = *main;
+			params.dumper = &chunk.dumper;
+			params.extra_msg = nullptr;
+			_sl = &params;
+			uint64 start = GetSaveLoadTimer();
+			try {
+				SlSaveChunk(chunk.ch);
+				chunk.time = GetSaveLoadTimer() - start;
+			} catch (...) {
+				chunk.error = std::current_exception();
+				chunk.error_str = params.error_str;
+				chunk.extra_msg = params.extra_msg;
+			}
+			_sl = main;
+		}
+	});
+
+	/* Errors are reported as if the first failing chunk was saved on this thread. */
+	std::exception_ptr error;
+	for (ParallelSaveChunk &chunk : parallel) {
+		if (chunk.error == nullptr) continue;
+		if (error != nullptr) {
+			free(chunk.extra_msg);
+			continue;
+		}
+		error = chunk.error;
+		_sl->error_str = chunk.error_str;
+		free(_sl->extra_msg);
+		_sl->extra_msg = chunk.extra_msg;
+	}
+	if (error != nullptr) std::rethrow_exception(error);
+
+	_sl->chunks.clear();
+	auto it = parallel.begin();
 	FOR_ALL_CHUNK_HANDLERS(ch) {
-		SlSaveChunk(ch);
+		size_t offset = _sl->dumper->GetSize();
+		uint64 time;
+		if (it != parallel.end() && it->ch == ch) {
+			_sl->dumper->Append(it->dumper);
+			time = it->time;
+			++it;
+		} else {
+			uint64 start = GetSaveLoadTimer();
+			SlSaveChunk(ch);
+			time = GetSaveLoadTimer() - start;
+		}
+		if (_sl->dumper->GetSize() != offset) _sl->chunks.push_back({ch->id, offset, _sl->dumper->GetSize() - offset, time});
 	}
 
 	/* Terminator */
@@ -1780,12 +2273,18 @@ static void SlLoadChunks()
 	uint32 id;
 	const ChunkHandler *ch;
 
+	_loaded_chunks.clear();
 	for (id = SlReadUint32(); id != 0; id = SlReadUint32()) {
 		DEBUG(sl, 2, "Loading chunk %c%c%c%c", id >> 24, id >> 16, id >> 8, id);
 
+		size_t offset = _sl->reader->GetSize() - sizeof(id);
+		uint64 start = GetSaveLoadTimer();
+
 		ch = SlFindChunkHandler(id);
 		if (ch == nullptr) SlErrorCorrupt("Unknown chunk type");
 		SlLoadChunk(ch);
+
+		_loaded_chunks.push_back({id, offset, _sl->reader->GetSize() - offset, GetSaveLoadTimer() - start});
 	}
 }
 
@@ -1807,7 +2306,7 @@ static void SlLoadCheckChunks()
 /** Fix all pointers (convert index -> pointer) */
 static void SlFixPointers()
 {
-	_sl.action = SLA_PTRS;
+	_sl->action = SLA_PTRS;
 
 	DEBUG(sl, 1, "Fixing pointers");
 
@@ -1820,7 +2319,7 @@ static void SlFixPointers()
 
 	DEBUG(sl, 1, "All pointers fixed");
 
-	assert(_sl.action == SLA_PTRS);
+	assert(_sl->action == SLA_PTRS);
 }
 
 
@@ -1828,6 +2327,11 @@ static void SlFixPointers()
 struct FileReader : LoadFilter {
 	FILE *file; ///< The file to read from.
 	long begin; ///< The begin of the file.
+#ifdef WITH_MMAP_LOAD
+	byte *map;       ///< The file mapped into memory, or \c nullptr when it is read via \c fread.
+	size_t map_size; ///< The size of the mapped file.
+	size_t map_pos;  ///< The position in the mapped file to read next.
+#endif /* WITH_MMAP_LOAD */
 
 	/**
 	 * Create the file reader, so it reads from a specific file.
@@ -1835,16 +2339,37 @@ struct FileReader : LoadFilter {
 	 */
 	FileReader(FILE *file) : LoadFilter(nullptr), file(file), begin(ftell(file))
 	{
+#ifdef WITH_MMAP_LOAD
+		/* Reading straight from the page cache saves a copy and a system call per block. */
+		this->map = nullptr;
+		struct stat st;
+		if (this->begin >= 0 && fstat(fileno(file), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > this->begin) {
+			void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+			if (map != MAP_FAILED) {
+				this->map = (byte *)map;
+				this->map_size = st.st_size;
+				this->map_pos = this->begin;
+#ifdef MADV_SEQUENTIAL
+				madvise(map, this->map_size, MADV_SEQUENTIAL);
+#endif
+			}
+		}
+#endif /* WITH_MMAP_LOAD */
 	}
 
 	/** Make sure everything is cleaned up. */
 	~FileReader()
 	{
+#ifdef WITH_MMAP_LOAD
+		if (this->map != nullptr) munmap(this->map, this->map_size);
+		this->map = nullptr;
+#endif /* WITH_MMAP_LOAD */
+
 		if (this->file != nullptr) fclose(this->file);
 		this->file = nullptr;
 
 		/* Make sure we don't double free. */
-		_sl.sf = nullptr;
+		_sl->sf = nullptr;
 	}
 
 	size_t Read(byte *buf, size_t size) override
@@ -1852,11 +2377,27 @@ struct FileReader : LoadFilter {
 		/* We're in the process of shutting down, i.e. in "failure" mode. */
 		if (this->file == nullptr) return 0;
 
+#ifdef WITH_MMAP_LOAD
+		if (this->map != nullptr) {
+			size = min(size, this->map_size - this->map_pos);
+			memcpy(buf, this->map + this->map_pos, size);
+			this->map_pos += size;
+			return size;
+		}
+#endif /* WITH_MMAP_LOAD */
+
 		return fread(buf, 1, size, this->file);
 	}
 
 	void Reset() override
 	{
+#ifdef WITH_MMAP_LOAD
+		if (this->map != nullptr) {
+			this->map_pos = this->begin;
+			return;
+		}
+#endif /* WITH_MMAP_LOAD */
+
 		clearerr(this->file);
 		if (fseek(this->file, this->begin, SEEK_SET)) {
 			DEBUG(sl, 1, "Could not reset the file reading");
@@ -1882,7 +2423,7 @@ struct FileWriter : SaveFilter {
 		this->Finish();
 
 		/* Make sure we don't double free. */
-		_sl.sf = nullptr;
+		_sl->sf = nullptr;
 	}
 
 	void Write(byte *buf, size_t size) override
@@ -2150,6 +2691,169 @@ struct ZlibSaveFilter : SaveFilter {
 	}
 };
 
+/*******************************************
+ ******* START OF PARALLEL ZLIB CODE *******
+ *******************************************/
+
+/** Size of the blocks the parallel zlib format compresses independently of each other. */
+static const uint32 PZLIB_BLOCK_SIZE = 1024 * 1024;
+
+/**
+ * Block of the parallel zlib format. In the file each block is preceded by its
+ * uncompressed and compressed size, so the blocks can be located without
+ * decompressing them. A block with an uncompressed size of 0 marks the end.
+ */
+struct PZlibBlock {
+	std::vector<byte> raw;    ///< Uncompressed data of the block.
+	std::vector<byte> packed; ///< Compressed data of the block; when saving including its header.
+	bool failed;              ///< Whether compressing or decompressing the block failed.
+};
+
+/** Filter using zlib compression of blocks that are decompressed on multiple threads. */
+struct PZlibLoadFilter : LoadFilter {
+	std::vector<PZlibBlock> blocks; ///< Blocks of the current batch.
+	uint used;                      ///< Number of blocks in the current batch.
+	uint current;                   ///< Block of the current batch we are reading from.
+	size_t pos;                     ///< Position in the current block.
+	bool finished;                  ///< Whether the end marker has been read.
+
+	/**
+	 * Initialise this filter.
+	 * @param chain The next filter in this chain.
+	 */
+	PZlibLoadFilter(LoadFilter *chain) : LoadFilter(chain), blocks(GetWorkerThreadCount()), used(0), current(0), pos(0), finished(false)
+	{
+	}
+
+	/** Read the next batch of blocks and decompress them. */
+	void ReadBatch()
+	{
+		this->used = 0;
+		this->current = 0;
+		this->pos = 0;
+
+		while (!this->finished && this->used < this->blocks.size()) {
+			uint32 hdr[2];
+			if (this->chain->Read((byte*)hdr, sizeof(hdr)) != sizeof(hdr)) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_READABLE, "File read failed");
+
+			uint32 raw_size = TO_BE32(hdr[0]);
+			uint32 packed_size = TO_BE32(hdr[1]);
+			if (raw_size == 0) {
+				this->finished = true;
+				break;
+			}
+			if (raw_size > PZLIB_BLOCK_SIZE || packed_size > compressBound(PZLIB_BLOCK_SIZE)) SlErrorCorrupt("Inconsistent block size");
+
+			PZlibBlock &block = this->blocks[this->used++];
+			block.raw.resize(raw_size);
+			block.packed.resize(packed_size);
+			if (this->chain->Read(block.packed.data(), packed_size) != packed_size) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_READABLE, "File read failed");
+		}
+
+		RunParallelFor(this->used, 1, [this](uint begin, uint end) {
+			for (uint i = begin; i < end; i++) {
+				PZlibBlock &block = this->blocks[i];
+				uLongf len = (uLongf)block.raw.size();
+				block.failed = uncompress(block.raw.data(), &len, block.packed.data(), (uLong)block.packed.size()) != Z_OK || len != block.raw.size();
+			}
+		});
+
+		/* Errors can only be thrown from this thread. */
+		for (uint i = 0; i < this->used; i++) {
+			if (this->blocks[i].failed) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "uncompress() failed");
+		}
+	}
+
+	size_t Read(byte *buf, size_t size) override
+	{
+		size_t done = 0;
+		while (done < size) {
+			if (this->current == this->used) {
+				if (this->finished) break;
+				this->ReadBatch();
+				if (this->used == 0) break;
+			}
+
+			const std::vector<byte> &raw = this->blocks[this->current].raw;
+			size_t len = min(size - done, raw.size() - this->pos);
+			memcpy(buf + done, raw.data() + this->pos, len);
+			done += len;
+			this->pos += len;
+			if (this->pos == raw.size()) {
+				this->current++;
+				this->pos = 0;
+			}
+		}
+		return done;
+	}
+};
+
+/** Filter using zlib compression of blocks that are compressed on multiple threads. */
+struct PZlibSaveFilter : SaveFilter {
+	std::vector<PZlibBlock> blocks; ///< Blocks of the batch being filled.
+	uint used;                      ///< Number of blocks of the batch that contain data.
+	int level;                      ///< Compression level.
+
+	/**
+	 * Initialise this filter.
+	 * @param chain             The next filter in this chain.
+	 * @param compression_level The requested level of compression.
+	 */
+	PZlibSaveFilter(SaveFilter *chain, byte compression_level) : SaveFilter(chain), blocks(GetWorkerThreadCount()), used(0), level(compression_level)
+	{
+		for (PZlibBlock &block : this->blocks) block.raw.reserve(PZLIB_BLOCK_SIZE);
+	}
+
+	/** Compress the filled blocks and write them in order. */
+	void WriteBatch()
+	{
+		RunParallelFor(this->used, 1, [this](uint begin, uint end) {
+			for (uint i = begin; i < end; i++) {
+				PZlibBlock &block = this->blocks[i];
+				uLongf len = compressBound((uLong)block.raw.size());
+				block.packed.resize(len + sizeof(uint32) * 2);
+				block.failed = compress2(block.packed.data() + sizeof(uint32) * 2, &len, block.raw.data(), (uLong)block.raw.size(), this->level) != Z_OK;
+				((uint32*)block.packed.data())[0] = TO_BE32((uint32)block.raw.size());
+				((uint32*)block.packed.data())[1] = TO_BE32((uint32)len);
+				block.packed.resize(len + sizeof(uint32) * 2);
+			}
+		});
+
+		for (uint i = 0; i < this->used; i++) {
+			PZlibBlock &block = this->blocks[i];
+			if (block.failed) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "zlib returned error code");
+			this->chain->Write(block.packed.data(), block.packed.size());
+			block.raw.clear();
+		}
+		this->used = 0;
+	}
+
+	void Write(byte *buf, size_t size) override
+	{
+		while (size > 0) {
+			if (this->used == 0 || this->blocks[this->used - 1].raw.size() == PZLIB_BLOCK_SIZE) {
+				if (this->used == this->blocks.size()) this->WriteBatch();
+				this->used++;
+			}
+
+			std::vector<byte> &raw = this->blocks[this->used - 1].raw;
+			size_t len = min<size_t>(size, PZLIB_BLOCK_SIZE - raw.size());
+			raw.insert(raw.end(), buf, buf + len);
+			buf += len;
+			size -= len;
+		}
+	}
+
+	void Finish() override
+	{
+		this->WriteBatch();
+
+		uint32 end[2] = { 0, 0 };
+		this->chain->Write((byte*)end, sizeof(end));
+		this->chain->Finish();
+	}
+};
+
 #endif /* WITH_ZLIB */
 
 /********************************************
@@ -2271,22 +2975,132 @@ struct LZMASaveFilter : SaveFilter {
 
 #endif /* WITH_LIBLZMA */
 
-/*******************************************
- ************* END OF CODE *****************
- *******************************************/
-
-/** The format for a reader/writer type of a savegame */
-struct SaveLoadFormat {
-	const char *name;                     ///< name of the compressor/decompressor (debug-only)
-	uint32 tag;                           ///< the 4-letter tag by which it is identified in the savegame
+/********************************************
+ ********** START OF ZSTD CODE **************
+ ********************************************/
 
-	LoadFilter *(*init_load)(LoadFilter *chain);                    ///< Constructor for the load filter.
-	SaveFilter *(*init_write)(SaveFilter *chain, byte compression); ///< Constructor for the save filter.
+#if defined(WITH_ZSTD)
+#include <zstd.h>
 
-	byte min_compression;                 ///< the minimum compression level of this format
-	byte default_compression;             ///< the default compression level of this format
-	byte max_compression;                 ///< the maximum compression level of this format
-};
+/** Filter using Zstandard compression. */
+struct ZstdLoadFilter : LoadFilter {
+	ZSTD_DStream *zstd;                ///< Stream state that we are reading from.
+	ZSTD_inBuffer input;               ///< Part of the read buffer that still has to be decompressed.
+	byte fread_buf[MEMORY_CHUNK_SIZE]; ///< Buffer for reading from the file.
+
+	/**
+	 * Initialise this filter.
+	 * @param chain The next filter in this chain.
+	 */
+	ZstdLoadFilter(LoadFilter *chain) : LoadFilter(chain)
+	{
+		this->input.src = this->fread_buf;
+		this->input.size = 0;
+		this->input.pos = 0;
+
+		this->zstd = ZSTD_createDStream();
+		if (this->zstd == nullptr || ZSTD_isError(ZSTD_initDStream(this->zstd))) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "cannot initialize decompressor");
+	}
+
+	/** Clean everything up. */
+	~ZstdLoadFilter()
+	{
+		ZSTD_freeDStream(this->zstd);
+	}
+
+	size_t Read(byte *buf, size_t size) override
+	{
+		ZSTD_outBuffer output = { buf, size, 0 };
+
+		do {
+			/* read more bytes from the file? */
+			if (this->input.pos == this->input.size) {
+				this->input.size = this->chain->Read(this->fread_buf, sizeof(this->fread_buf));
+				this->input.pos = 0;
+				if (this->input.size == 0) break;
+			}
+
+			/* decompress the data */
+			size_t r = ZSTD_decompressStream(this->zstd, &output, &this->input);
+			if (ZSTD_isError(r)) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "libzstd returned error code");
+			if (r == 0) break;
+		} while (output.pos != output.size);
+
+		return output.pos;
+	}
+};
+
+/** Filter using Zstandard compression. */
+struct ZstdSaveFilter : SaveFilter {
+	ZSTD_CStream *zstd; ///< Stream state that we are writing to.
+
+	/**
+	 * Initialise this filter.
+	 * @param chain             The next filter in this chain.
+	 * @param compression_level The requested level of compression.
+	 */
+	ZstdSaveFilter(SaveFilter *chain, byte compression_level) : SaveFilter(chain)
+	{
+		this->zstd = ZSTD_createCStream();
+		if (this->zstd == nullptr || ZSTD_isError(ZSTD_initCStream(this->zstd, compression_level))) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "cannot initialize compressor");
+	}
+
+	/** Clean up what we allocated. */
+	~ZstdSaveFilter()
+	{
+		ZSTD_freeCStream(this->zstd);
+	}
+
+	void Write(byte *buf, size_t size) override
+	{
+		byte out[MEMORY_CHUNK_SIZE]; // output buffer
+		ZSTD_inBuffer input = { buf, size, 0 };
+
+		while (input.pos != input.size) {
+			ZSTD_outBuffer output = { out, sizeof(out), 0 };
+			size_t r = ZSTD_compressStream(this->zstd, &output, &input);
+			if (ZSTD_isError(r)) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "libzstd returned error code");
+
+			/* bytes were emitted? */
+			if (output.pos != 0) this->chain->Write(out, output.pos);
+		}
+	}
+
+	void Finish() override
+	{
+		byte out[MEMORY_CHUNK_SIZE]; // output buffer
+		size_t remaining;
+
+		do {
+			ZSTD_outBuffer output = { out, sizeof(out), 0 };
+			remaining = ZSTD_endStream(this->zstd, &output);
+			if (ZSTD_isError(remaining)) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "libzstd returned error code");
+
+			if (output.pos != 0) this->chain->Write(out, output.pos);
+		} while (remaining != 0);
+
+		this->chain->Finish();
+	}
+};
+
+#endif /* WITH_ZSTD */
+
+/*******************************************
+ ************* END OF CODE *****************
+ *******************************************/
+
+/** The format for a reader/writer type of a savegame */
+struct SaveLoadFormat {
+	const char *name;                     ///< name of the compressor/decompressor (debug-only)
+	uint32 tag;                           ///< the 4-letter tag by which it is identified in the savegame
+
+	LoadFilter *(*init_load)(LoadFilter *chain);                    ///< Constructor for the load filter.
+	SaveFilter *(*init_write)(SaveFilter *chain, byte compression); ///< Constructor for the save filter.
+
+	byte min_compression;                 ///< the minimum compression level of this format
+	byte default_compression;             ///< the default compression level of this format
+	byte max_compression;                 ///< the maximum compression level of this format
+};
 
 /** The different saveload formats known/understood by OpenTTD. */
 static const SaveLoadFormat _saveload_formats[] = {
@@ -2298,6 +3112,13 @@ static const SaveLoadFormat _saveload_formats[] = {
 #endif
 	/* Roughly 5 times larger at only 1% of the CPU usage over zlib level 6. */
 	{"none",   TO_BE32X('OTTN'), CreateLoadFilter<NoCompLoadFilter>, CreateSaveFilter<NoCompSaveFilter>, 0, 0, 0},
+#if defined(WITH_ZLIB)
+	/* Same compression as zlib, but split into independently compressed blocks of 1 MiB so saving and loading use all
+	 * worker threads. The output is the same for any number of threads and only a little larger than zlib. */
+	{"pzlib",  TO_BE32X('OTTP'), CreateLoadFilter<PZlibLoadFilter>,  CreateSaveFilter<PZlibSaveFilter>,  0, 6, 9},
+#else
+	{"pzlib",  TO_BE32X('OTTP'), nullptr,                            nullptr,                            0, 0, 0},
+#endif
 #if defined(WITH_ZLIB)
 	/* After level 6 the speed reduction is significant (1.5x to 2.5x slower per level), but the reduction in filesize is
 	 * fairly insignificant (~1% for each step). Lower levels become ~5-10% bigger by each level than level 6 while level
@@ -2306,6 +3127,14 @@ static const SaveLoadFormat _saveload_formats[] = {
 #else
 	{"zlib",   TO_BE32X('OTTZ'), nullptr,                            nullptr,                            0, 0, 0},
 #endif
+#if defined(WITH_ZSTD)
+	/* Level 3 compresses about as well as zlib level 6 at a fraction of the CPU usage, and decompression is several
+	 * times faster than zlib at any level, which makes it a good fit for frequent autosaves and map transfers.
+	 * Levels above 19 need a lot more memory for both compression and decompression, so they are not offered. */
+	{"zstd",   TO_BE32X('OTTS'), CreateLoadFilter<ZstdLoadFilter>,   CreateSaveFilter<ZstdSaveFilter>,   1, 3, 19},
+#else
+	{"zstd",   TO_BE32X('OTTS'), nullptr,                            nullptr,                            0, 0, 0},
+#endif
 #if defined(WITH_LIBLZMA)
 	/* Level 2 compression is speed wise as fast as zlib level 6 compression (old default), but results in ~10% smaller saves.
 	 * Higher compression levels are possible, and might improve savegame size by up to 25%, but are also up to 10 times slower.
@@ -2372,6 +3201,330 @@ static const SaveLoadFormat *GetSavegameFormat(char *s, byte *compression_level)
 	return def;
 }
 
+/********************************************
+ ********** START OF DELTA SAVEGAMES ********
+ ********************************************/
+
+/*
+ * A delta savegame only contains the parts of the chunks that differ from
+ * those of a full savegame in the autosave directory, its keyframe. It
+ * starts with DELTA_SAVEGAME_TAG followed by a normal savegame header, after
+ * which (compressed with the format of that header) follow:
+ *  - the name of the keyframe: uint32 length and the characters,
+ *  - the uint64 size and uint32 checksum of the chunk data of the keyframe,
+ *  - for every chunk: its uint32 identifier, the uint32 index of the chunk of
+ *    the keyframe it is based on (or UINT32_MAX), its uint64 length and the
+ *    uint32 number of changed blocks, each being a uint32 block index and
+ *    the data of that block,
+ *  - a uint32 zero.
+ * All numbers are big endian, just like in the chunks themselves.
+ */
+
+/** Tag in front of the normal header of a delta savegame. */
+static const uint32 DELTA_SAVEGAME_TAG = TO_BE32X('ODLT');
+/** Size of the blocks in which chunks are compared with those of the keyframe. */
+static const size_t DELTA_BLOCK_SIZE = 64 * 1024;
+/** Chunk index for chunks of a delta savegame that are not in the keyframe. */
+static const uint32 DELTA_NO_BASE_CHUNK = UINT32_MAX;
+
+/**
+ * Get the checksum with which a delta savegame recognises its keyframe.
+ * @param data The chunk data of the keyframe.
+ * @return The checksum.
+ */
+static uint32 GetDeltaChecksum(const std::vector<byte> &data)
+{
+	/* FNV-1a over (little endian) words instead of bytes. */
+	uint32 hash = 2166136261U;
+	size_t i = 0;
+	for (; i + 4 <= data.size(); i += 4) {
+		hash = (hash ^ (data[i] | data[i + 1] << 8 | data[i + 2] << 16 | (uint32)data[i + 3] << 24)) * 16777619U;
+	}
+	for (; i < data.size(); i++) hash = (hash ^ data[i]) * 16777619U;
+	return hash;
+}
+
+/**
+ * Find the chunks in the chunk data of a savegame of the current version.
+ * @param data The chunk data.
+ * @return The found chunks.
+ */
+static std::vector<SavedChunk> SplitChunks(const std::vector<byte> &data)
+{
+	size_t pos = 0;
+	auto read_byte = [&data, &pos]() -> uint {
+		if (pos >= data.size()) SlErrorCorrupt("Unexpected end of chunk");
+		return data[pos++];
+	};
+
+	std::vector<SavedChunk> chunks;
+	for (;;) {
+		size_t offset = pos;
+		uint32 id = read_byte() << 24;
+		id |= read_byte() << 16;
+		id |= read_byte() << 8;
+		id |= read_byte();
+		if (id == 0) break;
+
+		uint m = read_byte();
+		switch (m & 0xF) {
+			case CH_RIFF: {
+				size_t len = (m >> 4) << 24;
+				len |= read_byte() << 16;
+				len |= read_byte() << 8;
+				len |= read_byte();
+				pos += len;
+				break;
+			}
+
+			case CH_ARRAY:
+			case CH_SPARSE_ARRAY:
+				for (;;) {
+					/* Same encoding as SlReadSimpleGamma. */
+					uint len = read_byte();
+					if (HasBit(len, 7)) {
+						len &= ~0x80;
+						if (HasBit(len, 6)) {
+							len &= ~0x40;
+							if (HasBit(len, 5)) {
+								len &= ~0x20;
+								if (HasBit(len, 4)) {
+									if (HasBit(len, 3)) SlErrorCorrupt("Unsupported gamma");
+									len = read_byte();
+								}
+								len = (len << 8) | read_byte();
+							}
+							len = (len << 8) | read_byte();
+						}
+						len = (len << 8) | read_byte();
+					}
+					if (len == 0) break;
+					pos += len - 1;
+				}
+				break;
+
+			default: SlErrorCorrupt("Invalid chunk type");
+		}
+
+		if (pos > data.size()) SlErrorCorrupt("Unexpected end of chunk");
+		chunks.push_back({id, offset, pos - offset, 0});
+	}
+	return chunks;
+}
+
+/**
+ * Read all uncompressed chunk data of a savegame from the autosave directory.
+ * @param name    The name of the savegame.
+ * @param version The savegame version it must have.
+ * @param[out] data The chunk data, including the terminating zero.
+ */
+static void ReadDeltaKeyframe(const char *name, SaveLoadVersion version, std::vector<byte> &data)
+{
+	FILE *fh = FioFOpenFile(name, "rb", AUTOSAVE_DIR);
+	if (fh == nullptr) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_READABLE, "Keyframe of the delta savegame not found");
+
+	/* Destroying the file reader clears the save filter, which might be in use. */
+	SaveFilter *sf = _sl->sf;
+	try {
+		std::unique_ptr<LoadFilter> reader(new FileReader(fh));
+
+		uint32 hdr[2];
+		if (reader->Read((byte*)hdr, sizeof(hdr)) != sizeof(hdr)) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_READABLE);
+
+		const SaveLoadFormat *fmt = _saveload_formats;
+		while (fmt != endof(_saveload_formats) && (fmt->tag != hdr[0] || fmt->init_load == nullptr)) fmt++;
+		if (fmt == endof(_saveload_formats) || (SaveLoadVersion)(TO_BE32(hdr[1]) >> 16) != version) {
+			SlErrorCorrupt("Keyframe of the delta savegame has been replaced");
+		}
+		reader.reset(fmt->init_load(reader.release()));
+
+		data.clear();
+		for (;;) {
+			size_t size = data.size();
+			data.resize(size + MEMORY_CHUNK_SIZE);
+			size_t len = reader->Read(data.data() + size, MEMORY_CHUNK_SIZE);
+			data.resize(size + len);
+			if (len == 0) break;
+		}
+	} catch (...) {
+		_sl->sf = sf;
+		throw;
+	}
+	_sl->sf = sf;
+}
+
+/**
+ * Write the savegame in #_sl as the difference with its keyframe.
+ * @param writer   The filter to write the delta savegame to.
+ * @param name     The name of the keyframe.
+ * @param keyframe The chunk data of the keyframe.
+ */
+static void WriteDeltaSavegame(SaveFilter *writer, const std::string &name, const std::vector<byte> &keyframe)
+{
+	std::vector<SavedChunk> keyframe_chunks = SplitChunks(keyframe);
+
+	std::vector<byte> out;
+	auto write_uint32 = [&out](uint32 v) {
+		out.push_back(GB(v, 24, 8));
+		out.push_back(GB(v, 16, 8));
+		out.push_back(GB(v, 8, 8));
+		out.push_back(GB(v, 0, 8));
+	};
+	auto write_uint64 = [&write_uint32](uint64 v) {
+		write_uint32((uint32)(v >> 32));
+		write_uint32((uint32)v);
+	};
+
+	write_uint32((uint32)name.size());
+	out.insert(out.end(), name.begin(), name.end());
+	write_uint64(keyframe.size());
+	write_uint32(GetDeltaChecksum(keyframe));
+
+	std::vector<byte> block(DELTA_BLOCK_SIZE);
+	std::vector<uint32> changed;
+	for (const SavedChunk &chunk : _sl->chunks) {
+		/* Chunk identifiers are unique, so just match them by identifier. */
+		auto base = std::find_if(keyframe_chunks.begin(), keyframe_chunks.end(), [&chunk](const SavedChunk &c) { return c.id == chunk.id; });
+
+		changed.clear();
+		for (size_t offset = 0; offset < chunk.length; offset += DELTA_BLOCK_SIZE) {
+			size_t len = min(DELTA_BLOCK_SIZE, chunk.length - offset);
+			if (base != keyframe_chunks.end() && offset + len <= base->length) {
+				_sl->dumper->CopyOut(chunk.offset + offset, block.data(), len);
+				if (memcmp(block.data(), keyframe.data() + base->offset + offset, len) == 0) continue;
+			}
+			changed.push_back((uint32)(offset / DELTA_BLOCK_SIZE));
+		}
+
+		write_uint32(chunk.id);
+		write_uint32(base == keyframe_chunks.end() ? DELTA_NO_BASE_CHUNK : (uint32)(base - keyframe_chunks.begin()));
+		write_uint64(chunk.length);
+		write_uint32((uint32)changed.size());
+		for (uint32 index : changed) {
+			size_t offset = index * DELTA_BLOCK_SIZE;
+			size_t len = min(DELTA_BLOCK_SIZE, chunk.length - offset);
+
+			write_uint32(index);
+			size_t size = out.size();
+			out.resize(size + len);
+			_sl->dumper->CopyOut(chunk.offset + offset, out.data() + size, len);
+
+			if (out.size() >= MEMORY_CHUNK_SIZE) {
+				writer->Write(out.data(), out.size());
+				out.clear();
+			}
+		}
+	}
+	write_uint32(0);
+
+	writer->Write(out.data(), out.size());
+	writer->Finish();
+}
+
+/** Filter that combines a delta savegame with its keyframe into the chunk data of the full savegame. */
+struct DeltaLoadFilter : LoadFilter {
+	std::vector<byte> data; ///< The chunk data of the full savegame.
+	size_t pos;             ///< The position in the chunk data to read next.
+
+	/**
+	 * Read the delta savegame and its keyframe.
+	 * @param chain The next filter in this chain.
+	 */
+	DeltaLoadFilter(LoadFilter *chain) : LoadFilter(chain), pos(0)
+	{
+		char name[MAX_PATH];
+		uint32 name_len = this->ReadUint32();
+		if (name_len >= lengthof(name)) SlErrorCorrupt("Invalid keyframe name");
+		this->ReadBytes((byte *)name, name_len);
+		name[name_len] = '\0';
+		str_validate(name, lastof(name));
+
+		uint64 keyframe_size = this->ReadUint64();
+		uint32 keyframe_checksum = this->ReadUint32();
+
+		std::vector<byte> keyframe;
+		ReadDeltaKeyframe(name, _sl_version, keyframe);
+		if (keyframe.size() != keyframe_size || GetDeltaChecksum(keyframe) != keyframe_checksum) {
+			SlErrorCorrupt("Keyframe of the delta savegame has been replaced");
+		}
+		std::vector<SavedChunk> keyframe_chunks = SplitChunks(keyframe);
+
+		DEBUG(sl, 1, "Loading delta savegame of '%s'", name);
+
+		for (uint32 id = this->ReadUint32(); id != 0; id = this->ReadUint32()) {
+			uint32 base = this->ReadUint32();
+			uint64 length = this->ReadUint64();
+			if (base != DELTA_NO_BASE_CHUNK && base >= keyframe_chunks.size()) SlErrorCorrupt("Invalid keyframe chunk");
+			if (length > (1U << 31)) SlErrorCorrupt("Invalid chunk size");
+
+			size_t offset = this->data.size();
+			this->data.resize(offset + length);
+			if (base != DELTA_NO_BASE_CHUNK) {
+				const SavedChunk &chunk = keyframe_chunks[base];
+				memcpy(this->data.data() + offset, keyframe.data() + chunk.offset, min<size_t>(length, chunk.length));
+			}
+
+			for (uint32 count = this->ReadUint32(); count != 0; count--) {
+				size_t block = this->ReadUint32() * DELTA_BLOCK_SIZE;
+				if (block >= length) SlErrorCorrupt("Invalid block index");
+				this->ReadBytes(this->data.data() + offset + block, min<size_t>(DELTA_BLOCK_SIZE, length - block));
+			}
+		}
+
+		/* Terminator */
+		this->data.resize(this->data.size() + sizeof(uint32), 0);
+	}
+
+	/**
+	 * Read bytes of the delta savegame.
+	 * @param buf  The location to store the bytes.
+	 * @param size The number of bytes to read.
+	 */
+	void ReadBytes(byte *buf, size_t size)
+	{
+		while (size > 0) {
+			size_t len = this->chain->Read(buf, size);
+			if (len == 0) SlErrorCorrupt("Unexpected end of chunk");
+			buf += len;
+			size -= len;
+		}
+	}
+
+	/**
+	 * Read a number of the delta savegame.
+	 * @return The number.
+	 */
+	uint32 ReadUint32()
+	{
+		byte b[4];
+		this->ReadBytes(b, sizeof(b));
+		return b[0] << 24 | b[1] << 16 | b[2] << 8 | b[3];
+	}
+
+	/**
+	 * Read a 64 bit number of the delta savegame.
+	 * @return The number.
+	 */
+	uint64 ReadUint64()
+	{
+		uint64 x = this->ReadUint32();
+		return x << 32 | this->ReadUint32();
+	}
+
+	size_t Read(byte *buf, size_t size) override
+	{
+		size = min(size, this->data.size() - this->pos);
+		memcpy(buf, this->data.data() + this->pos, size);
+		this->pos += size;
+		return size;
+	}
+
+	void Reset() override
+	{
+		this->pos = 0;
+	}
+};
+
 /* actual loader/saver function */
 void InitializeGame(uint size_x, uint size_y, bool reset_date, bool reset_settings);
 extern bool AfterLoadGame();
@@ -2392,17 +3545,20 @@ static void ResetSaveloadData()
  */
 static inline void ClearSaveLoadState()
 {
-	delete _sl.dumper;
-	_sl.dumper = nullptr;
+	delete _sl->dumper;
+	_sl->dumper = nullptr;
 
-	delete _sl.sf;
-	_sl.sf = nullptr;
+	delete _sl->sf;
+	_sl->sf = nullptr;
 
-	delete _sl.reader;
-	_sl.reader = nullptr;
+	delete _sl->reader;
+	_sl->reader = nullptr;
 
-	delete _sl.lf;
-	_sl.lf = nullptr;
+	delete _sl->lf;
+	_sl->lf = nullptr;
+
+	_sl->delta_base.clear();
+	_sl->chunks.clear();
 }
 
 /**
@@ -2412,38 +3568,49 @@ static inline void ClearSaveLoadState()
  */
 static void SaveFileStart()
 {
-	_sl.ff_state = _fast_forward;
+	_sl->ff_state = _fast_forward;
 	_fast_forward = 0;
 	SetMouseCursorBusy(true);
 
 	InvalidateWindowData(WC_STATUS_BAR, 0, SBI_SAVELOAD_START);
-	_sl.saveinprogress = true;
+	_sl->saveinprogress = true;
 }
 
 /** Update the gui accordingly when saving is done and release locks on saveload. */
 static void SaveFileDone()
 {
-	if (_game_mode != GM_MENU) _fast_forward = _sl.ff_state;
+	if (_game_mode != GM_MENU) _fast_forward = _sl->ff_state;
 	SetMouseCursorBusy(false);
 
 	InvalidateWindowData(WC_STATUS_BAR, 0, SBI_SAVELOAD_FINISH);
-	_sl.saveinprogress = false;
+	_sl->saveinprogress = false;
 }
 
 /** Set the error message from outside of the actual loading/saving of the game (AfterLoadGame and friends) */
 void SetSaveLoadError(StringID str)
 {
-	_sl.error_str = str;
+	_sl->error_str = str;
+}
+
+/**
+ * Get how long the last save of the game took.
+ * @param[out] blocking Microseconds the game was halted by it.
+ * @param[out] writing Microseconds spent compressing and writing it, which may have happened in the background.
+ */
+void GetLastSaveDurations(uint64 *blocking, uint64 *writing)
+{
+	*blocking = _save_blocking_time;
+	*writing = _save_write_time;
 }
 
 /** Get the string representation of the error message */
 const char *GetSaveLoadErrorString()
 {
-	SetDParam(0, _sl.error_str);
-	SetDParamStr(1, _sl.extra_msg);
+	SetDParam(0, _sl->error_str);
+	SetDParamStr(1, _sl->extra_msg);
 
 	static char err_str[512];
-	GetString(err_str, _sl.action == SLA_SAVE ? STR_ERROR_GAME_SAVE_FAILED : STR_ERROR_GAME_LOAD_FAILED, lastof(err_str));
+	GetString(err_str, _sl->action == SLA_SAVE ? STR_ERROR_GAME_SAVE_FAILED : STR_ERROR_GAME_LOAD_FAILED, lastof(err_str));
 	return err_str;
 }
 
@@ -2461,19 +3628,39 @@ static void SaveFileError()
  */
 static SaveOrLoadResult SaveFileToDisk(bool threaded)
 {
+	uint64 start = GetSaveLoadTimer();
 	try {
 		byte compression;
 		const SaveLoadFormat *fmt = GetSavegameFormat(_savegame_format, &compression);
 
+		std::vector<byte> keyframe;
+		if (!_sl->delta_base.empty()) {
+			try {
+				ReadDeltaKeyframe(_sl->delta_base.c_str(), SAVEGAME_VERSION, keyframe);
+			} catch (...) {
+				DEBUG(sl, 1, "Cannot read keyframe '%s', saving a full savegame instead...", _sl->delta_base.c_str());
+				_sl->delta_base.clear();
+			}
+		}
+
 		/* We have written our stuff to memory, now write it to file! */
+		if (!_sl->delta_base.empty()) {
+			uint32 tag = DELTA_SAVEGAME_TAG;
+			_sl->sf->Write((byte*)&tag, sizeof(tag));
+		}
 		uint32 hdr[2] = { fmt->tag, TO_BE32(SAVEGAME_VERSION << 16) };
-		_sl.sf->Write((byte*)hdr, sizeof(hdr));
+		_sl->sf->Write((byte*)hdr, sizeof(hdr));
 
-		_sl.sf = fmt->init_write(_sl.sf, compression);
-		_sl.dumper->Flush(_sl.sf);
+		_sl->sf = fmt->init_write(_sl->sf, compression);
+		if (_sl->delta_base.empty()) {
+			_sl->dumper->Flush(_sl->sf);
+		} else {
+			WriteDeltaSavegame(_sl->sf, _sl->delta_base, keyframe);
+		}
 
 		ClearSaveLoadState();
 
+		_save_write_time = GetSaveLoadTimer() - start;
 		if (threaded) SetAsyncSaveFinish(SaveFileDone);
 
 		return SL_OK;
@@ -2484,7 +3671,7 @@ static SaveOrLoadResult SaveFileToDisk(bool threaded)
 
 		/* We don't want to shout when saving is just
 		 * cancelled due to a client disconnecting. */
-		if (_sl.error_str != STR_NETWORK_ERROR_LOSTCONNECTION) {
+		if (_sl->error_str != STR_NETWORK_ERROR_LOSTCONNECTION) {
 			/* Skip the "colour" character */
 			DEBUG(sl, 0, "%s", GetSaveLoadErrorString() + 3);
 			asfp = SaveFileError;
@@ -2499,8 +3686,45 @@ static SaveOrLoadResult SaveFileToDisk(bool threaded)
 	}
 }
 
+#ifdef WITH_SNAPSHOT_SAVE
+static pid_t _snapshot_save_pid = -1; ///< Process writing a snapshot of the game, or -1 when there is none.
+
+/**
+ * Handle the end of the process writing a snapshot of the game.
+ * @param wait Whether to wait for the process to finish.
+ */
+static void ProcessSnapshotSaveFinish(bool wait)
+{
+	if (_snapshot_save_pid == -1) return;
+
+	int status;
+	pid_t pid;
+	do {
+		pid = waitpid(_snapshot_save_pid, &status, wait ? 0 : WNOHANG);
+	} while (pid == -1 && errno == EINTR);
+	if (pid == 0) return;
+
+	_snapshot_save_pid = -1;
+	if (pid == -1 || (WIFEXITED(status) && WEXITSTATUS(status) == 0)) {
+		SaveFileDone();
+		return;
+	}
+
+	/* The process has already logged the actual error. */
+	_sl->action = SLA_SAVE;
+	_sl->error_str = STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR;
+	free(_sl->extra_msg);
+	_sl->extra_msg = stredup("Writing the snapshot failed");
+	SaveFileError();
+}
+#endif /* WITH_SNAPSHOT_SAVE */
+
 void WaitTillSaved()
 {
+#ifdef WITH_SNAPSHOT_SAVE
+	ProcessSnapshotSaveFinish(true);
+#endif /* WITH_SNAPSHOT_SAVE */
+
 	if (!_save_thread.joinable()) return;
 
 	_save_thread.join();
@@ -2519,10 +3743,12 @@ void WaitTillSaved()
  */
 static SaveOrLoadResult DoSave(SaveFilter *writer, bool threaded)
 {
-	assert(!_sl.saveinprogress);
+	assert(!_sl->saveinprogress);
+
+	uint64 start = GetSaveLoadTimer();
 
-	_sl.dumper = new MemoryDumper();
-	_sl.sf = writer;
+	_sl->dumper = new MemoryDumper();
+	_sl->sf = writer;
 
 	_sl_version = SAVEGAME_VERSION;
 
@@ -2537,9 +3763,11 @@ static SaveOrLoadResult DoSave(SaveFilter *writer, bool threaded)
 		SaveOrLoadResult result = SaveFileToDisk(false);
 		SaveFileDone();
 
+		_save_blocking_time = GetSaveLoadTimer() - start;
 		return result;
 	}
 
+	_save_blocking_time = GetSaveLoadTimer() - start;
 	return SL_OK;
 }
 
@@ -2552,7 +3780,8 @@ static SaveOrLoadResult DoSave(SaveFilter *writer, bool threaded)
 SaveOrLoadResult SaveWithFilter(SaveFilter *writer, bool threaded)
 {
 	try {
-		_sl.action = SLA_SAVE;
+		_sl->action = SLA_SAVE;
+		_sl->delta_base.clear();
 		return DoSave(writer, threaded);
 	} catch (...) {
 		ClearSaveLoadState();
@@ -2560,6 +3789,46 @@ SaveOrLoadResult SaveWithFilter(SaveFilter *writer, bool threaded)
 	}
 }
 
+#ifdef WITH_SNAPSHOT_SAVE
+/**
+ * Save the game from a forked copy of this process. The copy has a snapshot
+ * of the game state, so the game can continue while the copy serializes,
+ * compresses and writes its snapshot.
+ * @param fh The file to save the game to.
+ * @return True iff the copy was started; otherwise the game still has to be saved.
+ */
+static bool StartSnapshotSave(FILE *fh)
+{
+	pid_t pid = fork();
+	if (pid == -1) {
+		DEBUG(sl, 1, "Cannot fork to write a snapshot, saving on the game thread...");
+		return false;
+	}
+
+	if (pid == 0) {
+		/* Only this thread exists in the copy, so do not wait for the workers of the original process. */
+		DisableWorkerThreads();
+
+		SaveOrLoadResult result = SL_ERROR;
+		try {
+			result = DoSave(new FileWriter(fh), false);
+		} catch (...) {
+			ClearSaveLoadState();
+			/* Skip the "colour" character */
+			DEBUG(sl, 0, "%s", GetSaveLoadErrorString() + 3);
+		}
+		_exit(result == SL_OK ? 0 : 1);
+	}
+
+	/* The copy writes the file; close our handle to it without writing anything. */
+	fclose(fh);
+	_sl->delta_base.clear();
+	_snapshot_save_pid = pid;
+	SaveFileStart();
+	return true;
+}
+#endif /* WITH_SNAPSHOT_SAVE */
+
 /**
  * Actually perform the loading of a "non-old" savegame.
  * @param reader     The filter to read the savegame from.
@@ -2568,7 +3837,7 @@ SaveOrLoadResult SaveWithFilter(SaveFilter *writer, bool threaded)
  */
 static SaveOrLoadResult DoLoad(LoadFilter *reader, bool load_check)
 {
-	_sl.lf = reader;
+	_sl->lf = reader;
 
 	if (load_check) {
 		/* Clear previous check data */
@@ -2578,15 +3847,23 @@ static SaveOrLoadResult DoLoad(LoadFilter *reader, bool load_check)
 	}
 
 	uint32 hdr[2];
-	if (_sl.lf->Read((byte*)hdr, sizeof(hdr)) != sizeof(hdr)) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_READABLE);
+	if (_sl->lf->Read((byte*)hdr, sizeof(hdr)) != sizeof(hdr)) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_READABLE);
+
+	/* A delta savegame has the normal header after its own tag. */
+	bool delta = hdr[0] == DELTA_SAVEGAME_TAG;
+	if (delta) {
+		hdr[0] = hdr[1];
+		if (_sl->lf->Read((byte*)&hdr[1], sizeof(hdr[1])) != sizeof(hdr[1])) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_READABLE);
+	}
 
 	/* see if we have any loader for this type. */
 	const SaveLoadFormat *fmt = _saveload_formats;
 	for (;;) {
 		/* No loader found, treat as version 0 and use LZO format */
 		if (fmt == endof(_saveload_formats)) {
+			if (delta) SlErrorCorrupt("Unknown delta savegame type");
 			DEBUG(sl, 0, "Unknown savegame type, trying to load it as the buggy format");
-			_sl.lf->Reset();
+			_sl->lf->Reset();
 			_sl_version = SL_MIN_VERSION;
 			_sl_minor_version = 0;
 
@@ -2628,8 +3905,9 @@ static SaveOrLoadResult DoLoad(LoadFilter *reader, bool load_check)
 		SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, err_str);
 	}
 
-	_sl.lf = fmt->init_load(_sl.lf);
-	_sl.reader = new ReadBuffer(_sl.lf);
+	_sl->lf = fmt->init_load(_sl->lf);
+	if (delta) _sl->lf = new DeltaLoadFilter(_sl->lf);
+	_sl->reader = new ReadBuffer(_sl->lf);
 	_next_offs = 0;
 
 	if (!load_check) {
@@ -2675,7 +3953,9 @@ static SaveOrLoadResult DoLoad(LoadFilter *reader, bool load_check)
 	} else {
 		/* Load chunks and resolve references */
 		SlLoadChunks();
+		uint64 start = GetSaveLoadTimer();
 		SlFixPointers();
+		_fix_pointers_time = GetSaveLoadTimer() - start;
 	}
 
 	ClearSaveLoadState();
@@ -2690,7 +3970,10 @@ static SaveOrLoadResult DoLoad(LoadFilter *reader, bool load_check)
 
 		/* After loading fix up savegame for any internal changes that
 		 * might have occurred since then. If it fails, load back the old game. */
-		if (!AfterLoadGame()) {
+		uint64 start = GetSaveLoadTimer();
+		bool loaded = AfterLoadGame();
+		_after_load_time = GetSaveLoadTimer() - start;
+		if (!loaded) {
 			GamelogStopAction();
 			return SL_REINIT;
 		}
@@ -2709,7 +3992,7 @@ static SaveOrLoadResult DoLoad(LoadFilter *reader, bool load_check)
 SaveOrLoadResult LoadWithFilter(LoadFilter *reader)
 {
 	try {
-		_sl.action = SLA_LOAD;
+		_sl->action = SLA_LOAD;
 		return DoLoad(reader, false);
 	} catch (...) {
 		ClearSaveLoadState();
@@ -2717,6 +4000,74 @@ SaveOrLoadResult LoadWithFilter(LoadFilter *reader)
 	}
 }
 
+/** Filter reading from another filter without owning it. */
+struct BorrowedLoadFilter : LoadFilter {
+	LoadFilter *source; ///< The filter to read from.
+
+	/**
+	 * Initialise this filter.
+	 * @param source The filter to read from; it is not deleted with this filter.
+	 */
+	BorrowedLoadFilter(LoadFilter *source) : LoadFilter(nullptr), source(source)
+	{
+	}
+
+	size_t Read(byte *buf, size_t size) override
+	{
+		return this->source->Read(buf, size);
+	}
+};
+
+/**
+ * Decompress a savegame, so it can be loaded later on without the cost of decompressing it.
+ * This does not touch the game state, so it may run on another thread while a game is
+ * running, for example while the savegame is still being downloaded.
+ * @param reader The filter to read the savegame from; it is not deleted.
+ * @param writer The filter to write the savegame to, as an uncompressed savegame; it is not finished nor deleted.
+ * @return False if the savegame could not be decompressed. The LZO format, old savegames without
+ *         header and delta savegames are not decompressed; they have to be loaded as they are.
+ */
+bool DecompressSavegame(LoadFilter *reader, SaveFilter *writer)
+{
+	/* Errors must not touch the parameters of a game that is being loaded or saved at the same time. */
+	SaveLoadParams params;
+	params.action = SLA_NULL;
+	params.extra_msg = nullptr;
+	SaveLoadParams *main = _sl;
+	_sl = &params;
+
+	bool success = false;
+	try {
+		uint32 hdr[2];
+		size_t len = 0;
+		while (len < sizeof(hdr)) {
+			size_t read = reader->Read((byte *)hdr + len, sizeof(hdr) - len);
+			if (read == 0) break;
+			len += read;
+		}
+
+		const SaveLoadFormat *fmt = _saveload_formats;
+		while (fmt != endof(_saveload_formats) && fmt->tag != hdr[0]) fmt++;
+
+		/* Decompressing LZO needs the savegame version, which is only known to the game loading it. */
+		if (len == sizeof(hdr) && fmt != endof(_saveload_formats) && fmt->init_load != nullptr && fmt->tag != TO_BE32X('OTTD')) {
+			std::unique_ptr<LoadFilter> lf(fmt->init_load(new BorrowedLoadFilter(reader)));
+
+			hdr[0] = TO_BE32X('OTTN');
+			writer->Write((byte *)hdr, sizeof(hdr));
+
+			std::vector<byte> buf(MEMORY_CHUNK_SIZE);
+			while ((len = lf->Read(buf.data(), buf.size())) != 0) writer->Write(buf.data(), len);
+			success = true;
+		}
+	} catch (...) {
+	}
+
+	free(params.extra_msg);
+	_sl = main;
+	return success;
+}
+
 /**
  * Main Save or Load function where the high-level saveload functions are
  * handled. It opens the savegame, selects format and checks versions
@@ -2724,12 +4075,13 @@ SaveOrLoadResult LoadWithFilter(LoadFilter *reader)
  * @param fop Save or load mode. Load can also be a TTD(Patch) game.
  * @param sb The sub directory to save the savegame in
  * @param threaded True when threaded saving is allowed
+ * @param delta_base Name of a full savegame in the autosave directory to only save the differences with, or \c nullptr to save a full savegame.
  * @return Return the result of the action. #SL_OK, #SL_ERROR, or #SL_REINIT ("unload" the game)
  */
-SaveOrLoadResult SaveOrLoad(const char *filename, SaveLoadOperation fop, DetailedFileType dft, Subdirectory sb, bool threaded)
+SaveOrLoadResult SaveOrLoad(const char *filename, SaveLoadOperation fop, DetailedFileType dft, Subdirectory sb, bool threaded, const char *delta_base)
 {
 	/* An instance of saving is already active, so don't go saving again */
-	if (_sl.saveinprogress && fop == SLO_SAVE && dft == DFT_GAME_FILE && threaded) {
+	if (_sl->saveinprogress && fop == SLO_SAVE && dft == DFT_GAME_FILE && threaded) {
 		/* if not an autosave, but a user action, show error message */
 		if (!_do_autosave) ShowErrorMessage(STR_ERROR_SAVE_STILL_IN_PROGRESS, INVALID_STRING_ID, WL_ERROR);
 		return SL_OK;
@@ -2764,15 +4116,15 @@ SaveOrLoadResult SaveOrLoad(const char *filename, SaveLoadOperation fop, Detaile
 		assert(dft == DFT_GAME_FILE);
 		switch (fop) {
 			case SLO_CHECK:
-				_sl.action = SLA_LOAD_CHECK;
+				_sl->action = SLA_LOAD_CHECK;
 				break;
 
 			case SLO_LOAD:
-				_sl.action = SLA_LOAD;
+				_sl->action = SLA_LOAD;
 				break;
 
 			case SLO_SAVE:
-				_sl.action = SLA_SAVE;
+				_sl->action = SLA_SAVE;
 				break;
 
 			default: NOT_REACHED();
@@ -2791,6 +4143,11 @@ SaveOrLoadResult SaveOrLoad(const char *filename, SaveLoadOperation fop, Detaile
 
 		if (fop == SLO_SAVE) { // SAVE game
 			DEBUG(desync, 1, "save: %08x; %02x; %s", _date, _date_fract, filename);
+			_sl->delta_base = delta_base != nullptr ? delta_base : "";
+#ifdef WITH_SNAPSHOT_SAVE
+			/* A snapshot does not block the game, not even on servers. */
+			if (threaded && _settings_client.gui.threaded_saves && StartSnapshotSave(fh)) return SL_OK;
+#endif /* WITH_SNAPSHOT_SAVE */
 			if (_network_server || !_settings_client.gui.threaded_saves) threaded = false;
 
 			return DoSave(new FileWriter(fh), threaded);
@@ -2812,6 +4169,143 @@ SaveOrLoadResult SaveOrLoad(const char *filename, SaveLoadOperation fop, Detaile
 	}
 }
 
+/** Filter collecting the compressed savegame for #RunSaveLoadBenchmark. */
+struct BenchmarkSaveFilter : SaveFilter {
+	std::vector<byte> data; ///< The written data.
+
+	/** Create the filter. */
+	BenchmarkSaveFilter() : SaveFilter(nullptr)
+	{
+	}
+
+	void Write(byte *buf, size_t len) override
+	{
+		this->data.insert(this->data.end(), buf, buf + len);
+	}
+
+	void Finish() override
+	{
+	}
+};
+
+/** Filter reading the compressed savegame for #RunSaveLoadBenchmark. */
+struct BenchmarkLoadFilter : LoadFilter {
+	std::vector<byte> data; ///< The data to read.
+	size_t pos;             ///< The position in the data to read next.
+
+	/**
+	 * Create the filter.
+	 * @param data The data to read.
+	 */
+	BenchmarkLoadFilter(std::vector<byte> &&data) : LoadFilter(nullptr), data(std::move(data)), pos(0)
+	{
+	}
+
+	size_t Read(byte *buf, size_t size) override
+	{
+		size = min(size, this->data.size() - this->pos);
+		memcpy(buf, this->data.data() + this->pos, size);
+		this->pos += size;
+		return size;
+	}
+
+	void Reset() override
+	{
+		this->pos = 0;
+	}
+};
+
+/**
+ * Write the size of chunks and the time spent on them.
+ * @param p      The buffer to write to.
+ * @param last   The last element of the buffer.
+ * @param chunks The chunks to write.
+ * @return The end of the written text.
+ */
+static char *WriteChunkTimings(char *p, const char *last, const std::vector<SavedChunk> &chunks)
+{
+	uint64 time = 0;
+	size_t length = 0;
+	for (const SavedChunk &chunk : chunks) {
+		time += chunk.time;
+		length += chunk.length;
+	}
+	p += seprintf(p, last, "  total %12.1f KiB %10.2f ms\n", length / 1024.0, time / 1000.0);
+
+	for (const SavedChunk &chunk : chunks) {
+		p += seprintf(p, last, "  %c%c%c%c  %12.1f KiB %10.2f ms %10.1f MB/s\n", chunk.id >> 24, chunk.id >> 16, chunk.id >> 8, chunk.id,
+				chunk.length / 1024.0, chunk.time / 1000.0, chunk.time == 0 ? 0.0 : chunk.length / (double)chunk.time);
+	}
+	return p;
+}
+
+/**
+ * Report the time spent on loading the current game, and measure the time
+ * needed for saving it and for compressing and decompressing it with each of
+ * the savegame formats. This is the savegame benchmark of the -B command
+ * line option.
+ * @pre The game has just been loaded.
+ */
+void RunSaveLoadBenchmark()
+{
+	char buf[16384];
+	char *p = buf;
+
+	p += seprintf(p, lastof(buf), "Loading chunks:\n");
+	p = WriteChunkTimings(p, lastof(buf), _loaded_chunks);
+	p += seprintf(p, lastof(buf), "Fixing pointers: %.2f ms\n", _fix_pointers_time / 1000.0);
+	p += seprintf(p, lastof(buf), "AfterLoadGame:   %.2f ms\n", _after_load_time / 1000.0);
+
+	try {
+		_sl->action = SLA_SAVE;
+		_sl->dumper = new MemoryDumper();
+		_sl_version = SAVEGAME_VERSION;
+
+		SaveViewportBeforeSaveGame();
+		SlSaveChunks();
+
+		p += seprintf(p, lastof(buf), "Saving chunks:\n");
+		p = WriteChunkTimings(p, lastof(buf), _sl->chunks);
+
+		size_t size = _sl->dumper->GetSize();
+		p += seprintf(p, lastof(buf), "Formats (default compression level):\n");
+		for (const SaveLoadFormat &fmt : _saveload_formats) {
+			if (fmt.init_write == nullptr || fmt.init_load == nullptr) continue;
+
+			BenchmarkSaveFilter *writer = new BenchmarkSaveFilter();
+			std::unique_ptr<SaveFilter> sf(fmt.init_write(writer, fmt.default_compression));
+			uint64 start = GetSaveLoadTimer();
+			_sl->dumper->Flush(sf.get());
+			uint64 save_time = GetSaveLoadTimer() - start;
+			size_t packed_size = writer->data.size();
+
+			std::unique_ptr<LoadFilter> lf(fmt.init_load(new BenchmarkLoadFilter(std::move(writer->data))));
+			sf.reset();
+
+			std::vector<byte> block(MEMORY_CHUNK_SIZE);
+			size_t unpacked_size = 0;
+			start = GetSaveLoadTimer();
+			for (size_t len; (len = lf->Read(block.data(), block.size())) != 0;) unpacked_size += len;
+			uint64 load_time = GetSaveLoadTimer() - start;
+			if (unpacked_size != size) SlErrorCorrupt("Decompressed savegame differs in size");
+
+			p += seprintf(p, lastof(buf), "  %-6s %12.1f KiB  save %10.2f ms %8.1f MB/s  load %10.2f ms %8.1f MB/s\n", fmt.name, packed_size / 1024.0,
+					save_time / 1000.0, save_time == 0 ? 0.0 : size / (double)save_time, load_time / 1000.0, load_time == 0 ? 0.0 : size / (double)load_time);
+		}
+	} catch (...) {
+		/* Skip the "colour" character */
+		p += seprintf(p, lastof(buf), "Saving failed: %s\n", GetSaveLoadErrorString() + 3);
+	}
+	ClearSaveLoadState();
+
+	/* Like the savegame information of -q, this goes to stdout. */
+#if !defined(_WIN32)
+	printf("%s", buf);
+#else
+	ShowInfo(buf);
+#endif
+}
+
 /** Do a save when exiting the game (_settings_client.gui.autosave_on_exit) */
 void DoExitSave()
 {
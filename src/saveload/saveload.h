@@ -302,6 +302,12 @@ enum SaveLoadVersion : uint16 {
 	SLV_MULTITILE_DOCKS,                    ///< 216  PR#7380 Multiple docks per station.
 	SLV_TRADING_AGE,                        ///< 217  PR#7780 Configurable company trading age.
 	SLV_ENDING_YEAR,                        ///< 218  PR#7747 v1.10 Configurable ending year.
+	SLV_LINKGRAPH_INCREMENTAL,              ///< 219  Link graph jobs can start from the routes of the previous flows.
+	SLV_CARGO_PACKET_MERGE_DAYS,            ///< 220  Cargo packets with slightly different days in transit can be merged.
+	SLV_SHIP_PATH_PREFETCH,                 ///< 221  Ships can search their path ahead of time.
+	SLV_COMPANY_INFRASTRUCTURE,             ///< 222  Company infrastructure counts are saved.
+	SLV_SCRIPT_INT_DATA,                    ///< 223  Script arrays and tables of only integers are saved in one go.
+	SLV_LINKGRAPH_DEMAND_APPROXIMATION,     ///< 224  Demands of large link graph components can be approximated.
 
 	SL_MAX_VERSION,                         ///< Highest possible saveload version
 };
@@ -342,13 +348,16 @@ extern FileToSaveLoad _file_to_saveload;
 void GenerateDefaultSaveName(char *buf, const char *last);
 void SetSaveLoadError(StringID str);
 const char *GetSaveLoadErrorString();
-SaveOrLoadResult SaveOrLoad(const char *filename, SaveLoadOperation fop, DetailedFileType dft, Subdirectory sb, bool threaded = true);
+void GetLastSaveDurations(uint64 *blocking, uint64 *writing);
+SaveOrLoadResult SaveOrLoad(const char *filename, SaveLoadOperation fop, DetailedFileType dft, Subdirectory sb, bool threaded = true, const char *delta_base = nullptr);
 void WaitTillSaved();
 void ProcessAsyncSaveFinish();
+void RunSaveLoadBenchmark();
 void DoExitSave();
 
 SaveOrLoadResult SaveWithFilter(struct SaveFilter *writer, bool threaded);
 SaveOrLoadResult LoadWithFilter(struct LoadFilter *reader);
+bool DecompressSavegame(struct LoadFilter *reader, struct SaveFilter *writer);
 
 typedef void ChunkSaveLoadProc();
 typedef void AutolengthProc(void *arg);
@@ -391,6 +400,7 @@ enum ChunkType {
 	CH_TYPE_MASK    =  3,
 	CH_LAST         =  8, ///< Last chunk in this array.
 	CH_AUTO_LENGTH  = 16,
+	CH_PARALLEL_SAVE = 32, ///< The save proc only reads the game state, so the chunk can be saved concurrently with other chunks.
 };
 
 /**
@@ -485,6 +495,7 @@ enum SaveLoadTypes {
 	SL_STR         =  3, ///< Save/load a string.
 	SL_LST         =  4, ///< Save/load a list.
 	SL_DEQUE       =  5, ///< Save/load a deque.
+	SL_VEC         =  6, ///< Save/load a vector of references, stored like a list.
 	/* non-normal save-load types */
 	SL_WRITEBYTE   =  8,
 	SL_VEH_INCLUDE =  9,
@@ -587,6 +598,16 @@ typedef SaveLoad SaveLoadGlobVarList;
  */
 #define SLE_CONDDEQUE(base, variable, type, from, to) SLE_GENERAL(SL_DEQUE, base, variable, type, 0, from, to)
 
+/**
+ * Storage of a vector of references in some savegame versions. The savegame format is the same as the one of a list.
+ * @param base     Name of the class or struct containing the vector.
+ * @param variable Name of the variable in the class or struct referenced by \a base.
+ * @param type     Storage of the data in memory and in the savegame.
+ * @param from     First savegame version that has the vector.
+ * @param to       Last savegame version that has the vector.
+ */
+#define SLE_CONDVEC(base, variable, type, from, to) SLE_GENERAL(SL_VEC, base, variable, type, 0, from, to)
+
 /**
  * Storage of a variable in every version of a savegame.
  * @param base     Name of the class or struct containing the variable.
@@ -629,6 +650,14 @@ typedef SaveLoad SaveLoadGlobVarList;
  */
 #define SLE_LST(base, variable, type) SLE_CONDLST(base, variable, type, SL_MIN_VERSION, SL_MAX_VERSION)
 
+/**
+ * Storage of a vector of references in every savegame version.
+ * @param base     Name of the class or struct containing the vector.
+ * @param variable Name of the variable in the class or struct referenced by \a base.
+ * @param type     Storage of the data in memory and in the savegame.
+ */
+#define SLE_VEC(base, variable, type) SLE_CONDVEC(base, variable, type, SL_MIN_VERSION, SL_MAX_VERSION)
+
 /**
  * Empty space in every savegame version.
  * @param length Length of the empty space.
@@ -845,6 +874,7 @@ void SlWriteByte(byte b);
 void SlGlobList(const SaveLoadGlobVarList *sldg);
 void SlArray(void *array, size_t length, VarType conv);
 void SlObject(void *object, const SaveLoad *sld);
+void SlCompiledObject(void *object, const SaveLoad *sld);
 bool SlObjectMember(void *object, const SaveLoad *sld);
 void NORETURN SlError(StringID string, const char *extra_msg = nullptr);
 void NORETURN SlErrorCorrupt(const char *msg);
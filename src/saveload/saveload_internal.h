@@ -34,7 +34,7 @@ void ResetLabelMaps();
 void AfterLoadLabelMaps();
 void AfterLoadStoryBook();
 void AfterLoadLinkGraphs();
-void AfterLoadCompanyStats();
+void AfterLoadCompanyStats(bool recount_infrastructure = true);
 void UpdateHousesAndTowns();
 
 void UpdateOldAircraft();
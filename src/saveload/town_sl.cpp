@@ -242,6 +242,8 @@ const SaveLoad *GetTileMatrixDesc()
 
 static void RealSave_Town(Town *t)
 {
+	/* Growing towns only count down their grow counter when it is needed. */
+	t->grow_counter = t->GetGrowCounter();
 	SlObject(t, _town_desc);
 
 	for (CargoID i = 0; i < NUM_CARGO; i++) {
@@ -24,9 +24,14 @@
 #include "window_func.h"
 #include "tile_map.h"
 #include "landscape.h"
+#include "smallmap_gui.h"
+#include "thread.h"
+#include "console_func.h"
 
 #include "table/strings.h"
 
+#include <atomic>
+
 #include "safeguards.h"
 
 static const char * const SCREENSHOT_NAME = "screenshot"; ///< Default filename of a saved screenshot.
@@ -230,8 +235,43 @@ static bool MakeBMPImage(const char *name, ScreenshotCallback *callb, void *user
 #include "ai/ai_info.hpp"
 #include "company_base.h"
 #include "base_media_base.h"
+
+/** Description of the game for PNG screenshots written on another thread, which cannot look at the game itself. */
+static thread_local const char *_screenshot_description = nullptr;
+
+/**
+ * Describe the game, for the metadata of a PNG screenshot; this makes it more useful for debugging and archival purposes.
+ * @param buf Buffer to write the description to.
+ * @param last Last element of the buffer.
+ * @return End of the description.
+ */
+static char *MakeScreenshotDescription(char *buf, const char *last)
+{
+	char *p = buf;
+	p += seprintf(p, last, "Graphics set: %s (%u)\n", BaseGraphics::GetUsedSet()->name, BaseGraphics::GetUsedSet()->version);
+	p = strecpy(p, "NewGRFs:\n", last);
+	for (const GRFConfig *c = _game_mode == GM_MENU ? nullptr : _grfconfig; c != nullptr; c = c->next) {
+		p += seprintf(p, last, "%08X ", BSWAP32(c->ident.grfid));
+		p = md5sumToString(p, last, c->ident.md5sum);
+		p += seprintf(p, last, " %s\n", c->filename);
+	}
+	p = strecpy(p, "\nCompanies:\n", last);
+	for (const Company *c : Company::Iterate()) {
+		if (c->ai_info == nullptr) {
+			p += seprintf(p, last, "%2i: Human\n", (int)c->index);
+		} else {
+			p += seprintf(p, last, "%2i: %s (v%d)\n", (int)c->index, c->ai_info->GetName(), c->ai_info->GetVersion());
+		}
+	}
+	return p;
+}
 #endif /* PNG_TEXT_SUPPORTED */
 
+#if defined(WITH_ZLIB)
+#include <zlib.h>
+#include "worker_pool.h"
+#endif /* WITH_ZLIB */
+
 static void PNGAPI png_my_error(png_structp png_ptr, png_const_charp message)
 {
 	DEBUG(misc, 0, "[libpng] error: %s - %s", message, (const char *)png_get_error_ptr(png_ptr));
@@ -243,6 +283,176 @@ static void PNGAPI png_my_warning(png_structp png_ptr, png_const_charp message)
 	DEBUG(misc, 1, "[libpng] warning: %s - %s", message, (const char *)png_get_error_ptr(png_ptr));
 }
 
+#if defined(WITH_ZLIB)
+static const uint PNG_DEFLATE_BLOCK_SIZE = 256 * 1024; ///< Number of bytes of image data that are deflated on their own, by one of the worker threads.
+static const uint PNG_DEFLATE_WINDOW = 32768;          ///< Size of the window of deflate; this much data before a block is used as its dictionary.
+
+/** Image data of a PNG file that is deflated on its own. */
+struct PNGDeflateBlock {
+	std::vector<byte> output; ///< The deflated data.
+	uLong adler;              ///< Adler-32 checksum of the data.
+	uint length;              ///< Number of bytes of data.
+	bool ok;                  ///< Whether the data was deflated successfully.
+};
+
+/**
+ * Write a chunk of a PNG file.
+ * @param f The file.
+ * @param type The four letter type of the chunk.
+ * @param data The data of the chunk.
+ * @param length The number of bytes of data.
+ * @return True if the chunk was written successfully.
+ */
+static bool WritePNGChunk(FILE *f, const char *type, const byte *data, size_t length)
+{
+	uint32 header[2] = { TO_BE32((uint32)length), 0 };
+	memcpy(&header[1], type, 4);
+
+	uLong crc = crc32(crc32(0, nullptr, 0), (const Bytef *)type, 4);
+	if (length != 0) crc = crc32(crc, data, (uInt)length);
+	uint32 footer = TO_BE32((uint32)crc);
+
+	return fwrite(header, sizeof(header), 1, f) == 1 && (length == 0 || fwrite(data, length, 1, f) == 1) && fwrite(&footer, sizeof(footer), 1, f) == 1;
+}
+
+/**
+ * Deflate a block of image data as part of a raw deflate stream, like pigz does.
+ * All but the last block end byte aligned with an empty stored block,
+ * so the deflated blocks can simply be concatenated.
+ * @param[out] block The deflated block.
+ * @param data The data of the block.
+ * @param length The number of bytes of data.
+ * @param dict The number of bytes just before \a data to use as dictionary.
+ * @param last Whether this is the last block of the image.
+ */
+static void DeflatePNGBlock(PNGDeflateBlock &block, const byte *data, uint length, uint dict, bool last)
+{
+	block.length = length;
+	block.adler = adler32(adler32(0, nullptr, 0), data, length);
+	block.ok = false;
+
+	z_stream z;
+	memset(&z, 0, sizeof(z));
+	if (deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) return;
+	if (dict != 0) deflateSetDictionary(&z, data - dict, dict);
+
+	block.output.resize(deflateBound(&z, length) + 16);
+	z.next_in = const_cast<byte *>(data);
+	z.avail_in = length;
+	z.next_out = block.output.data();
+	z.avail_out = (uInt)block.output.size();
+
+	for (;;) {
+		int res = deflate(&z, last ? Z_FINISH : Z_SYNC_FLUSH);
+		if (res == Z_STREAM_END || (!last && res == Z_OK && z.avail_out != 0)) break;
+		if (res != Z_OK && res != Z_BUF_ERROR) {
+			deflateEnd(&z);
+			return;
+		}
+
+		/* Out of space; make the output bigger. */
+		size_t used = block.output.size() - z.avail_out;
+		block.output.resize(block.output.size() * 2);
+		z.next_out = block.output.data() + used;
+		z.avail_out = (uInt)(block.output.size() - used);
+	}
+
+	block.output.resize(block.output.size() - z.avail_out);
+	deflateEnd(&z);
+	block.ok = true;
+}
+
+/**
+ * Write the image data and the end of a PNG file, deflating the data on the worker threads.
+ * The data is split into blocks that are deflated on their own, each with the data
+ * before it as dictionary, so the image hardly gets bigger than when deflated at once.
+ * @param f The file, to which the header of the PNG file is written already.
+ * @param callb Callback function for generating lines of pixels.
+ * @param userdata User data, passed on to \a callb.
+ * @param w Width of the image in pixels.
+ * @param h Height of the image in pixels.
+ * @param pixelformat Bits per pixel (bpp), either 8 or 32.
+ * @return True if the data was written successfully.
+ */
+static bool WritePNGImageDataParallel(FILE *f, ScreenshotCallback *callb, void *userdata, uint w, uint h, int pixelformat)
+{
+	const uint bpp = pixelformat / 8;
+	const size_t row_size = 1 + (size_t)w * (pixelformat == 8 ? 1 : 3); // Filter type, and RGB or palette index of each pixel.
+
+	/* Generate more lines at a time than for libpng, so there are enough blocks for all threads; by default 4M temp memory. */
+	const uint maxlines = Clamp((4 << 20) / (w * bpp), 16, 1024);
+
+	std::vector<byte> pixels((size_t)w * maxlines * bpp);
+	/* The lines in the format of PNG, preceded by the end of the lines before them as dictionary. */
+	std::vector<byte> data(PNG_DEFLATE_WINDOW + row_size * maxlines);
+	size_t dict = 0;
+
+	std::vector<PNGDeflateBlock> blocks;
+	std::vector<byte> idat = { 0x78, 0x9C }; // Header of zlib: deflate with 32K window, default compression.
+	uLong adler = adler32(0, nullptr, 0);
+
+	uint y = 0;
+	do {
+		/* determine # lines to write */
+		uint n = min(h - y, maxlines);
+
+		/* render the pixels into the buffer */
+		callb(userdata, pixels.data(), y, w, n);
+		y += n;
+
+		/* convert them to the format of PNG */
+		byte *rows = data.data() + dict;
+		RunParallelFor(n, 1, [&](uint begin, uint end) {
+			for (uint i = begin; i < end; i++) {
+				byte *dst = rows + i * row_size;
+				*dst++ = PNG_FILTER_VALUE_NONE;
+				if (pixelformat == 8) {
+					memcpy(dst, pixels.data() + (size_t)i * w, w);
+				} else {
+					const Colour *src = (const Colour *)pixels.data() + (size_t)i * w;
+					for (uint x = 0; x < w; x++, src++) {
+						*dst++ = src->r;
+						*dst++ = src->g;
+						*dst++ = src->b;
+					}
+				}
+			}
+		});
+
+		/* deflate them */
+		const uint length = (uint)(row_size * n);
+		const uint count = CeilDiv(length, PNG_DEFLATE_BLOCK_SIZE);
+		const bool last = y == h;
+		blocks.resize(count);
+		RunParallelFor(count, 1, [&](uint begin, uint end) {
+			for (uint i = begin; i < end; i++) {
+				uint start = i * PNG_DEFLATE_BLOCK_SIZE;
+				DeflatePNGBlock(blocks[i], rows + start, min(length - start, PNG_DEFLATE_BLOCK_SIZE), (uint)min<size_t>(dict + start, PNG_DEFLATE_WINDOW), last && i == count - 1);
+			}
+		});
+
+		/* write them to png */
+		for (const PNGDeflateBlock &block : blocks) {
+			if (!block.ok) return false;
+			adler = adler32_combine(adler, block.adler, block.length);
+			idat.insert(idat.end(), block.output.begin(), block.output.end());
+		}
+		if (last) {
+			for (int shift = 24; shift >= 0; shift -= 8) idat.push_back(GB(adler, shift, 8));
+		}
+		if (!WritePNGChunk(f, "IDAT", idat.data(), idat.size())) return false;
+		idat.clear();
+
+		/* keep the end of the lines as dictionary of the next lines */
+		size_t keep = min<size_t>(dict + length, PNG_DEFLATE_WINDOW);
+		memmove(data.data(), rows + length - keep, keep);
+		dict = keep;
+	} while (y != h);
+
+	return WritePNGChunk(f, "IEND", nullptr, 0);
+}
+#endif /* WITH_ZLIB */
+
 /**
  * Generic .PNG file image writer.
  * @param name        Filename, including extension.
@@ -309,22 +519,7 @@ static bool MakePNGImage(const char *name, ScreenshotCallback *callb, void *user
 	text[0].compression = PNG_TEXT_COMPRESSION_NONE;
 
 	char buf[8192];
-	char *p = buf;
-	p += seprintf(p, lastof(buf), "Graphics set: %s (%u)\n", BaseGraphics::GetUsedSet()->name, BaseGraphics::GetUsedSet()->version);
-	p = strecpy(p, "NewGRFs:\n", lastof(buf));
-	for (const GRFConfig *c = _game_mode == GM_MENU ? nullptr : _grfconfig; c != nullptr; c = c->next) {
-		p += seprintf(p, lastof(buf), "%08X ", BSWAP32(c->ident.grfid));
-		p = md5sumToString(p, lastof(buf), c->ident.md5sum);
-		p += seprintf(p, lastof(buf), " %s\n", c->filename);
-	}
-	p = strecpy(p, "\nCompanies:\n", lastof(buf));
-	for (const Company *c : Company::Iterate()) {
-		if (c->ai_info == nullptr) {
-			p += seprintf(p, lastof(buf), "%2i: Human\n", (int)c->index);
-		} else {
-			p += seprintf(p, lastof(buf), "%2i: %s (v%d)\n", (int)c->index, c->ai_info->GetName(), c->ai_info->GetVersion());
-		}
-	}
+	char *p = _screenshot_description != nullptr ? strecpy(buf, _screenshot_description, lastof(buf)) : MakeScreenshotDescription(buf, lastof(buf));
 	text[1].key = const_cast<char *>("Description");
 	text[1].text = buf;
 	text[1].text_length = p - buf;
@@ -365,6 +560,16 @@ static bool MakePNGImage(const char *name, ScreenshotCallback *callb, void *user
 #endif /* TTD_ENDIAN == TTD_LITTLE_ENDIAN */
 	}
 
+#if defined(WITH_ZLIB)
+	if (GetWorkerThreadCount() > 1) {
+		/* libpng deflates on this thread only, so write the image data without it. */
+		bool ret = WritePNGImageDataParallel(f, callb, userdata, w, h, pixelformat);
+		png_destroy_write_struct(&png_ptr, &info_ptr);
+		fclose(f);
+		return ret;
+	}
+#endif /* WITH_ZLIB */
+
 	/* use by default 64k temp memory */
 	maxlines = Clamp(65536 / w, 16, 128);
 
@@ -613,7 +818,6 @@ static void LargeWorldCallback(void *userdata, void *buf, uint y, uint pitch, ui
 {
 	ViewPort *vp = (ViewPort *)userdata;
 	DrawPixelInfo dpi, *old_dpi;
-	int wx, left;
 
 	/* We are no longer rendering to the screen */
 	DrawPixelInfo old_screen = _screen;
@@ -636,19 +840,8 @@ static void LargeWorldCallback(void *userdata, void *buf, uint y, uint pitch, ui
 	dpi.left = 0;
 	dpi.top = y;
 
-	/* Render viewport in blocks of 1600 pixels width */
-	left = 0;
-	while (vp->width - left != 0) {
-		wx = min(vp->width - left, 1600);
-		left += wx;
-
-		ViewportDoDraw(vp,
-			ScaleByZoom(left - wx - vp->left, vp->zoom) + vp->virtual_left,
-			ScaleByZoom(y - vp->top, vp->zoom) + vp->virtual_top,
-			ScaleByZoom(left - vp->left, vp->zoom) + vp->virtual_left,
-			ScaleByZoom((y + n) - vp->top, vp->zoom) + vp->virtual_top
-		);
-	}
+	/* Render the lines in parts, which are drawn on the worker threads when possible. */
+	ViewportDraw(vp, 0, y, vp->width, y + n);
 
 	_cur_dpi = old_dpi;
 
@@ -962,3 +1155,114 @@ bool MakeMinimapWorldScreenshot()
 	const ScreenshotFormat *sf = _screenshot_formats + _cur_screenshot_format;
 	return sf->proc(MakeScreenshotName(SCREENSHOT_NAME, sf->extension), MinimapScreenCallback, nullptr, MapSizeX(), MapSizeY(), 32, _cur_palette.palette);
 }
+
+/** A smallmap screenshot that is written by a thread of its own. */
+struct SmallMapScreenshotJob {
+	std::vector<byte> image;         ///< Palette index of each pixel; a copy, so the game can continue while the image is written.
+	uint width;                      ///< Width of the image.
+	uint height;                     ///< Height of the image.
+	Colour palette[256];             ///< Palette of the image.
+	const ScreenshotFormat *format;  ///< Format of the file.
+	std::string filename;            ///< Pathname of the file.
+	std::string name;                ///< Name of the file, for the message when it is written.
+	std::string description;         ///< Description of the game, for the metadata of the file.
+	std::thread thread;              ///< The thread writing the file.
+	std::atomic<bool> done;          ///< Whether the thread is done; see #ProcessAsyncScreenshotFinish.
+	bool result;                     ///< Whether the file was written successfully.
+
+	SmallMapScreenshotJob() : done(false) {}
+
+	~SmallMapScreenshotJob()
+	{
+		if (this->thread.joinable()) this->thread.join();
+	}
+};
+
+static SmallMapScreenshotJob _smallmap_screenshot; ///< The smallmap screenshot being written.
+
+/**
+ * Copy lines of a smallmap screenshot.
+ * @param userdata The #SmallMapScreenshotJob.
+ * @param buf      Destination buffer.
+ * @param y        Line number of the first line to write.
+ * @param pitch    Number of pixels to write.
+ * @param n        Number of lines to write.
+ * @see ScreenshotCallback
+ */
+static void SmallMapScreenshotCallback(void *userdata, void *buf, uint y, uint pitch, uint n)
+{
+	const SmallMapScreenshotJob *job = (const SmallMapScreenshotJob *)userdata;
+	memcpy(buf, job->image.data() + (size_t)y * job->width, (size_t)pitch * n);
+}
+
+/** Write the file of the smallmap screenshot; run by its own thread. */
+static void SmallMapScreenshotThread()
+{
+	SmallMapScreenshotJob &job = _smallmap_screenshot;
+#if defined(WITH_PNG) && defined(PNG_TEXT_SUPPORTED)
+	_screenshot_description = job.description.c_str();
+#endif
+	job.result = job.format->proc(job.filename.c_str(), SmallMapScreenshotCallback, &job, job.width, job.height, 8, job.palette);
+	job.done.store(true, std::memory_order_release);
+}
+
+/**
+ * Make a screenshot of the whole map the way the smallmap shows it, one pixel per tile.
+ * Only determining the colours is done by the game; the file is written by a thread of its own.
+ * This works without graphics as well, so also on dedicated servers.
+ * @param type Name of the type of map; see #SmallMapWindow::GetImage.
+ * @param name The name to give to the screenshot, or \c nullptr for the default name.
+ * @return False if the type of map is unknown.
+ */
+bool MakeSmallMapScreenshot(const char *type, const char *name)
+{
+	SmallMapScreenshotJob &job = _smallmap_screenshot;
+	if (job.thread.joinable()) {
+		IConsoleError("The previous smallmap screenshot is still being written.");
+		return true;
+	}
+
+	if (!SmallMapWindow::GetImage(type, job.image)) return false;
+	job.width = MapSizeX();
+	job.height = MapSizeY();
+	MemCpyT(job.palette, _cur_palette.palette, lengthof(job.palette));
+
+	_screenshot_name[0] = '\0';
+	if (name != nullptr) strecpy(_screenshot_name, name, lastof(_screenshot_name));
+	job.format = _screenshot_formats + _cur_screenshot_format;
+	job.filename = MakeScreenshotName(SCREENSHOT_NAME, job.format->extension);
+	job.name = _screenshot_name;
+
+#if defined(WITH_PNG) && defined(PNG_TEXT_SUPPORTED)
+	char description[8192];
+	MakeScreenshotDescription(description, lastof(description));
+	job.description = description;
+#endif
+
+	if (!StartNewThread(&job.thread, "ottd:screenshot", &SmallMapScreenshotThread)) {
+		SmallMapScreenshotThread();
+		ProcessAsyncScreenshotFinish();
+	}
+	return true;
+}
+
+/**
+ * Report a smallmap screenshot that was written by its thread, if any.
+ */
+void ProcessAsyncScreenshotFinish()
+{
+	SmallMapScreenshotJob &job = _smallmap_screenshot;
+	if (!job.done.load(std::memory_order_acquire)) return;
+
+	if (job.thread.joinable()) job.thread.join();
+	job.done.store(false, std::memory_order_relaxed);
+	job.image.clear();
+	job.image.shrink_to_fit();
+
+	if (job.result) {
+		SetDParamStr(0, job.name.c_str());
+		ShowErrorMessage(STR_MESSAGE_SCREENSHOT_SUCCESSFULLY, INVALID_STRING_ID, WL_WARNING);
+	} else {
+		ShowErrorMessage(STR_ERROR_SCREENSHOT_FAILED, INVALID_STRING_ID, WL_ERROR);
+	}
+}
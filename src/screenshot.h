@@ -29,6 +29,8 @@ void SetupScreenshotViewport(ScreenshotType t, struct ViewPort *vp);
 bool MakeHeightmapScreenshot(const char *filename);
 bool MakeScreenshot(ScreenshotType t, const char *name);
 bool MakeMinimapWorldScreenshot();
+bool MakeSmallMapScreenshot(const char *type, const char *name);
+void ProcessAsyncScreenshotFinish();
 
 extern char _screenshot_format_name[8];
 extern uint _num_screenshot_formats;
@@ -17,6 +17,17 @@
  *
  * This version is not yet released. The following changes are not set in stone yet.
  *
+ * API additions:
+ * \li AITileList::AddRectangleFiltered
+ * \li AITileList::ValuateMinHeight
+ * \li AITileList::ValuateMaxHeight
+ * \li AITileList::ValuateSlope
+ * \li AITileList::ValuateOwner
+ * \li AITileList::ValuateBuildable
+ * \li AITileList::ValuateDistanceManhattanToTile
+ * \li AITileList::ValuateDistanceSquareToTile
+ * \li AITileList::ValuateCargoAcceptance
+ *
  * \b 1.10.0
  *
  * API additions:
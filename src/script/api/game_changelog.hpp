@@ -17,6 +17,17 @@
  *
  * This version is not yet released. The following changes are not set in stone yet.
  *
+ * API additions:
+ * \li GSTileList::AddRectangleFiltered
+ * \li GSTileList::ValuateMinHeight
+ * \li GSTileList::ValuateMaxHeight
+ * \li GSTileList::ValuateSlope
+ * \li GSTileList::ValuateOwner
+ * \li GSTileList::ValuateBuildable
+ * \li GSTileList::ValuateDistanceManhattanToTile
+ * \li GSTileList::ValuateDistanceSquareToTile
+ * \li GSTileList::ValuateCargoAcceptance
+ *
  * \b 1.10.0
  *
  * API additions:
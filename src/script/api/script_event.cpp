@@ -10,15 +10,75 @@
 #include "../../stdafx.h"
 #include "script_event_types.hpp"
 
-#include <queue>
+#include <vector>
+#include <unordered_set>
 
 #include "../../safeguards.h"
 
-/** The queue of events for a script. */
+/**
+ * The queue of events for a script. The events are kept in a ring buffer
+ * that only grows, so queueing events does not allocate once the buffer is
+ * large enough for the usual number of waiting events.
+ */
 struct ScriptEventData {
-	std::queue<ScriptEvent *> stack; ///< The actual queue.
+	std::vector<ScriptEvent *> ring;         ///< The ring buffer with the waiting events.
+	size_t head = 0;                         ///< Position of the first waiting event in #ring.
+	size_t count = 0;                        ///< Number of waiting events.
+	std::unordered_set<uint64> coalesced;    ///< Keys of the waiting events that later events of the same kind are merged into.
+
+	bool Empty() const { return this->count == 0; }
+
+	/**
+	 * Add an event at the end of the queue.
+	 * @param event The event to add.
+	 */
+	void Push(ScriptEvent *event)
+	{
+		if (this->count == this->ring.size()) {
+			/* Full; unwrap the events into a larger buffer. */
+			std::vector<ScriptEvent *> ring(max<size_t>(16, this->ring.size() * 2));
+			for (size_t i = 0; i < this->count; i++) ring[i] = this->ring[(this->head + i) % this->ring.size()];
+			this->ring.swap(ring);
+			this->head = 0;
+		}
+		this->ring[(this->head + this->count) % this->ring.size()] = event;
+		this->count++;
+	}
+
+	/**
+	 * Remove the first event from the queue.
+	 * @return The removed event.
+	 */
+	ScriptEvent *Pop()
+	{
+		assert(this->count > 0);
+		ScriptEvent *event = this->ring[this->head];
+		this->head = (this->head + 1) % this->ring.size();
+		this->count--;
+		return event;
+	}
 };
 
+/**
+ * Get the key under which waiting events are merged. Events that only tell
+ * about the state of a vehicle carry no extra information when the same
+ * event for that vehicle is still waiting, so those are merged.
+ * @param event The event to get the key of.
+ * @return The key, or 0 if the event cannot be merged.
+ */
+static uint64 GetCoalesceKey(ScriptEvent *event)
+{
+	VehicleID vehicle;
+	switch (event->GetEventType()) {
+		case ScriptEvent::ET_VEHICLE_LOST:             vehicle = static_cast<ScriptEventVehicleLost *>(event)->GetVehicleID(); break;
+		case ScriptEvent::ET_VEHICLE_WAITING_IN_DEPOT: vehicle = static_cast<ScriptEventVehicleWaitingInDepot *>(event)->GetVehicleID(); break;
+		case ScriptEvent::ET_VEHICLE_UNPROFITABLE:     vehicle = static_cast<ScriptEventVehicleUnprofitable *>(event)->GetVehicleID(); break;
+		case ScriptEvent::ET_AIRCRAFT_DEST_TOO_FAR:    vehicle = static_cast<ScriptEventAircraftDestTooFar *>(event)->GetVehicleID(); break;
+		default: return 0;
+	}
+	return ((uint64)event->GetEventType() << 32) | ((uint64)vehicle + 1);
+}
+
 /* static */ void ScriptEventController::CreateEventPointer()
 {
 	assert(ScriptObject::GetEventPointer() == nullptr);
@@ -31,11 +91,7 @@ struct ScriptEventData {
 	ScriptEventData *data = (ScriptEventData *)ScriptObject::GetEventPointer();
 
 	/* Free all waiting events (if any) */
-	while (!data->stack.empty()) {
-		ScriptEvent *e = data->stack.front();
-		data->stack.pop();
-		e->Release();
-	}
+	while (!data->Empty()) data->Pop()->Release();
 
 	/* Now kill our data pointer */
 	delete data;
@@ -46,7 +102,7 @@ struct ScriptEventData {
 	if (ScriptObject::GetEventPointer() == nullptr) ScriptEventController::CreateEventPointer();
 	ScriptEventData *data = (ScriptEventData *)ScriptObject::GetEventPointer();
 
-	return !data->stack.empty();
+	return !data->Empty();
 }
 
 /* static */ ScriptEvent *ScriptEventController::GetNextEvent()
@@ -54,10 +110,13 @@ struct ScriptEventData {
 	if (ScriptObject::GetEventPointer() == nullptr) ScriptEventController::CreateEventPointer();
 	ScriptEventData *data = (ScriptEventData *)ScriptObject::GetEventPointer();
 
-	if (data->stack.empty()) return nullptr;
+	if (data->Empty()) return nullptr;
 
-	ScriptEvent *e = data->stack.front();
-	data->stack.pop();
+	ScriptEvent *e = data->Pop();
+	if (!data->coalesced.empty()) {
+		uint64 key = GetCoalesceKey(e);
+		if (key != 0) data->coalesced.erase(key);
+	}
 	return e;
 }
 
@@ -66,7 +125,11 @@ struct ScriptEventData {
 	if (ScriptObject::GetEventPointer() == nullptr) ScriptEventController::CreateEventPointer();
 	ScriptEventData *data = (ScriptEventData *)ScriptObject::GetEventPointer();
 
+	/* Merge the event into the same one that is still waiting. */
+	uint64 key = GetCoalesceKey(event);
+	if (key != 0 && !data->coalesced.insert(key).second) return;
+
 	event->AddRef();
-	data->stack.push(event);
+	data->Push(event);
 }
 
@@ -12,19 +12,82 @@
 #include "script_controller.hpp"
 #include "../../debug.h"
 #include "../../script/squirrel.hpp"
+#include <algorithm>
 
 #include "../../safeguards.h"
 
 /**
  * Base class for any ScriptList sorter.
+ * Sorters remember the next item by its key instead of by its position in the list,
+ * so they stay valid when the list's storage is sorted, purged or reallocated.
  */
 class ScriptListSorter {
 protected:
+	typedef ScriptList::ScriptListItem ScriptListItem;           ///< An item with its value.
+	typedef ScriptList::ScriptListValueItem ScriptListValueItem; ///< A value with its item.
+
 	ScriptList *list;       ///< The list that's being sorted.
 	bool has_no_more_items; ///< Whether we have more items to iterate over.
+	bool has_item_next;     ///< Whether #item_next is valid.
 	int64 item_next;        ///< The next item we will show.
+	int64 value_next;       ///< The value of the next item, at the moment it was found.
+
+	/**
+	 * Get the items of the list, sorted by item.
+	 * @return The items; some of them might be removed.
+	 */
+	const std::vector<ScriptListItem> &GetItems()
+	{
+		this->list->SortItems();
+		return this->list->items;
+	}
+
+	/**
+	 * Get the items of the list, sorted by value.
+	 * @return The (value, item) pairs; some of them might be stale.
+	 */
+	const std::vector<ScriptListValueItem> &GetValues()
+	{
+		return this->list->GetValues();
+	}
+
+	/**
+	 * Check whether a (value, item) pair is the current value of an item in the list.
+	 * @param value_item The pair to check.
+	 * @return True iff the item is in the list with this value.
+	 */
+	bool IsCurrentValue(const ScriptListValueItem &value_item)
+	{
+		return this->list->IsCurrentValue(value_item);
+	}
+
+	/**
+	 * Find the next item, and store that information.
+	 */
+	virtual void FindNext() = 0;
+
+	/**
+	 * Set the next item to show.
+	 * @param item  The item.
+	 * @param value Its value.
+	 */
+	void SetNext(int64 item, int64 value)
+	{
+		this->has_item_next = true;
+		this->item_next = item;
+		this->value_next = value;
+	}
 
 public:
+	/**
+	 * Create a new sorter.
+	 * @param list The list to sort.
+	 */
+	ScriptListSorter(ScriptList *list) : list(list)
+	{
+		this->End();
+	}
+
 	/**
 	 * Virtual dtor, needed to mute warnings.
 	 */
@@ -38,119 +101,116 @@ public:
 	/**
 	 * Stop iterating a sorter.
 	 */
-	virtual void End() = 0;
+	void End()
+	{
+		this->has_no_more_items = true;
+		this->has_item_next = false;
+		this->item_next = 0;
+		this->value_next = 0;
+	}
 
 	/**
 	 * Get the next item of the sorter.
 	 */
-	virtual int64 Next() = 0;
+	int64 Next()
+	{
+		if (this->IsEnd()) return 0;
+		if (!this->has_item_next) {
+			this->has_no_more_items = true;
+			return 0;
+		}
+
+		int64 item_current = this->item_next;
+		this->FindNext();
+		return item_current;
+	}
 
 	/**
 	 * See if the sorter has reached the end.
 	 */
 	bool IsEnd()
 	{
-		return this->list->buckets.empty() || this->has_no_more_items;
+		return this->list->IsEmpty() || this->has_no_more_items;
 	}
 
 	/**
-	 * Callback from the list if an item gets removed.
+	 * Callback from the list if items got removed or their values changed.
+	 * If the next item is affected, skip to the item after it.
 	 */
-	virtual void Remove(int item) = 0;
+	virtual void Revalidate()
+	{
+		if (this->IsEnd() || !this->has_item_next) return;
+
+		if (!this->list->HasItem(this->item_next)) this->FindNext();
+	}
 
 	/**
 	 * Attach the sorter to a new list. This assumes the content of the old list has been moved to
-	 * the new list, too, so that we don't have to invalidate any iterators. Note that std::swap
-	 * doesn't invalidate iterators on lists and maps, so that should be safe.
+	 * the new list, too. As the sorter only remembers the next item by its key, that is safe.
 	 * @param target New list to attach to.
 	 */
-	virtual void Retarget(ScriptList *new_list)
+	void Retarget(ScriptList *new_list)
 	{
 		this->list = new_list;
 	}
 };
 
 /**
- * Sort by value, ascending.
+ * Base class for sorting by value.
  */
-class ScriptListSorterValueAscending : public ScriptListSorter {
-private:
-	ScriptList::ScriptListBucket::iterator bucket_iter;    ///< The iterator over the list to find the buckets.
-	ScriptList::ScriptItemList *bucket_list;               ///< The current bucket list we're iterator over.
-	ScriptList::ScriptItemList::iterator bucket_list_iter; ///< The iterator over the bucket list.
-
+class ScriptListSorterValue : public ScriptListSorter {
 public:
 	/**
 	 * Create a new sorter.
 	 * @param list The list to sort.
 	 */
-	ScriptListSorterValueAscending(ScriptList *list)
-	{
-		this->list = list;
-		this->End();
-	}
+	ScriptListSorterValue(ScriptList *list) : ScriptListSorter(list) {}
 
-	int64 Begin()
+	void Revalidate() override
 	{
-		if (this->list->buckets.empty()) return 0;
-		this->has_no_more_items = false;
-
-		this->bucket_iter = this->list->buckets.begin();
-		this->bucket_list = &(*this->bucket_iter).second;
-		this->bucket_list_iter = this->bucket_list->begin();
-		this->item_next = *this->bucket_list_iter;
+		if (this->IsEnd() || !this->has_item_next) return;
 
-		int64 item_current = this->item_next;
-		FindNext();
-		return item_current;
-	}
-
-	void End()
-	{
-		this->bucket_list = nullptr;
-		this->has_no_more_items = true;
-		this->item_next = 0;
+		if (!this->IsCurrentValue(ScriptListValueItem(this->value_next, this->item_next))) this->FindNext();
 	}
+};
 
+/**
+ * Sort by value, ascending.
+ */
+class ScriptListSorterValueAscending : public ScriptListSorterValue {
+public:
 	/**
-	 * Find the next item, and store that information.
+	 * Create a new sorter.
+	 * @param list The list to sort.
 	 */
-	void FindNext()
+	ScriptListSorterValueAscending(ScriptList *list) : ScriptListSorterValue(list) {}
+
+	int64 Begin() override
 	{
-		if (this->bucket_list == nullptr) {
-			this->has_no_more_items = true;
-			return;
-		}
+		this->End();
+		if (this->list->IsEmpty()) return 0;
+		this->has_no_more_items = false;
 
-		this->bucket_list_iter++;
-		if (this->bucket_list_iter == this->bucket_list->end()) {
-			this->bucket_iter++;
-			if (this->bucket_iter == this->list->buckets.end()) {
-				this->bucket_list = nullptr;
-				return;
-			}
-			this->bucket_list = &(*this->bucket_iter).second;
-			this->bucket_list_iter = this->bucket_list->begin();
+		const std::vector<ScriptListValueItem> &values = this->GetValues();
+		for (const ScriptListValueItem &value_item : values) {
+			if (!this->IsCurrentValue(value_item)) continue;
+			this->SetNext(value_item.second, value_item.first);
+			break;
 		}
-		this->item_next = *this->bucket_list_iter;
-	}
 
-	int64 Next()
-	{
-		if (this->IsEnd()) return 0;
-
-		int64 item_current = this->item_next;
-		FindNext();
-		return item_current;
+		return this->Next();
 	}
 
-	void Remove(int item)
+	void FindNext() override
 	{
-		if (this->IsEnd()) return;
-
-		/* If we remove the 'next' item, skip to the next */
-		if (item == this->item_next) {
-			FindNext();
+		if (!this->has_item_next) return;
+		this->has_item_next = false;
+
+		const std::vector<ScriptListValueItem> &values = this->GetValues();
+		auto iter = std::upper_bound(values.begin(), values.end(), ScriptListValueItem(this->value_next, this->item_next));
+		for (; iter != values.end(); iter++) {
+			if (!this->IsCurrentValue(*iter)) continue;
+			this->SetNext(iter->second, iter->first);
 			return;
 		}
 	}
@@ -159,95 +219,41 @@ public:
 /**
  * Sort by value, descending.
  */
-class ScriptListSorterValueDescending : public ScriptListSorter {
-private:
-	/* Note: We cannot use reverse_iterator.
-	 *       The iterators must only be invalidated when the element they are pointing to is removed.
-	 *       This only holds for forward iterators. */
-	ScriptList::ScriptListBucket::iterator bucket_iter;    ///< The iterator over the list to find the buckets.
-	ScriptList::ScriptItemList *bucket_list;               ///< The current bucket list we're iterator over.
-	ScriptList::ScriptItemList::iterator bucket_list_iter; ///< The iterator over the bucket list.
-
+class ScriptListSorterValueDescending : public ScriptListSorterValue {
 public:
 	/**
 	 * Create a new sorter.
 	 * @param list The list to sort.
 	 */
-	ScriptListSorterValueDescending(ScriptList *list)
-	{
-		this->list = list;
-		this->End();
-	}
+	ScriptListSorterValueDescending(ScriptList *list) : ScriptListSorterValue(list) {}
 
-	int64 Begin()
+	int64 Begin() override
 	{
-		if (this->list->buckets.empty()) return 0;
+		this->End();
+		if (this->list->IsEmpty()) return 0;
 		this->has_no_more_items = false;
 
-		/* Go to the end of the bucket-list */
-		this->bucket_iter = this->list->buckets.end();
-		--this->bucket_iter;
-		this->bucket_list = &(*this->bucket_iter).second;
-
-		/* Go to the end of the items in the bucket */
-		this->bucket_list_iter = this->bucket_list->end();
-		--this->bucket_list_iter;
-		this->item_next = *this->bucket_list_iter;
-
-		int64 item_current = this->item_next;
-		FindNext();
-		return item_current;
-	}
-
-	void End()
-	{
-		this->bucket_list = nullptr;
-		this->has_no_more_items = true;
-		this->item_next = 0;
-	}
-
-	/**
-	 * Find the next item, and store that information.
-	 */
-	void FindNext()
-	{
-		if (this->bucket_list == nullptr) {
-			this->has_no_more_items = true;
-			return;
-		}
-
-		if (this->bucket_list_iter == this->bucket_list->begin()) {
-			if (this->bucket_iter == this->list->buckets.begin()) {
-				this->bucket_list = nullptr;
-				return;
-			}
-			this->bucket_iter--;
-			this->bucket_list = &(*this->bucket_iter).second;
-			/* Go to the end of the items in the bucket */
-			this->bucket_list_iter = this->bucket_list->end();
-			--this->bucket_list_iter;
-		} else {
-			this->bucket_list_iter--;
+		const std::vector<ScriptListValueItem> &values = this->GetValues();
+		for (auto iter = values.rbegin(); iter != values.rend(); iter++) {
+			if (!this->IsCurrentValue(*iter)) continue;
+			this->SetNext(iter->second, iter->first);
+			break;
 		}
-		this->item_next = *this->bucket_list_iter;
-	}
-
-	int64 Next()
-	{
-		if (this->IsEnd()) return 0;
 
-		int64 item_current = this->item_next;
-		FindNext();
-		return item_current;
+		return this->Next();
 	}
 
-	void Remove(int item)
+	void FindNext() override
 	{
-		if (this->IsEnd()) return;
-
-		/* If we remove the 'next' item, skip to the next */
-		if (item == this->item_next) {
-			FindNext();
+		if (!this->has_item_next) return;
+		this->has_item_next = false;
+
+		const std::vector<ScriptListValueItem> &values = this->GetValues();
+		auto iter = std::lower_bound(values.begin(), values.end(), ScriptListValueItem(this->value_next, this->item_next));
+		while (iter != values.begin()) {
+			--iter;
+			if (!this->IsCurrentValue(*iter)) continue;
+			this->SetNext(iter->second, iter->first);
 			return;
 		}
 	}
@@ -257,67 +263,38 @@ public:
  * Sort by item, ascending.
  */
 class ScriptListSorterItemAscending : public ScriptListSorter {
-private:
-	ScriptList::ScriptListMap::iterator item_iter; ///< The iterator over the items in the map.
-
 public:
 	/**
 	 * Create a new sorter.
 	 * @param list The list to sort.
 	 */
-	ScriptListSorterItemAscending(ScriptList *list)
-	{
-		this->list = list;
-		this->End();
-	}
+	ScriptListSorterItemAscending(ScriptList *list) : ScriptListSorter(list) {}
 
-	int64 Begin()
+	int64 Begin() override
 	{
-		if (this->list->items.empty()) return 0;
+		this->End();
+		if (this->list->IsEmpty()) return 0;
 		this->has_no_more_items = false;
 
-		this->item_iter = this->list->items.begin();
-		this->item_next = (*this->item_iter).first;
-
-		int64 item_current = this->item_next;
-		FindNext();
-		return item_current;
-	}
-
-	void End()
-	{
-		this->has_no_more_items = true;
-	}
-
-	/**
-	 * Find the next item, and store that information.
-	 */
-	void FindNext()
-	{
-		if (this->item_iter == this->list->items.end()) {
-			this->has_no_more_items = true;
-			return;
+		for (const ScriptListItem &entry : this->GetItems()) {
+			if (entry.removed) continue;
+			this->SetNext(entry.item, entry.value);
+			break;
 		}
-		this->item_iter++;
-		if (this->item_iter != this->list->items.end()) item_next = (*this->item_iter).first;
-	}
 
-	int64 Next()
-	{
-		if (this->IsEnd()) return 0;
-
-		int64 item_current = this->item_next;
-		FindNext();
-		return item_current;
+		return this->Next();
 	}
 
-	void Remove(int item)
+	void FindNext() override
 	{
-		if (this->IsEnd()) return;
-
-		/* If we remove the 'next' item, skip to the next */
-		if (item == this->item_next) {
-			FindNext();
+		if (!this->has_item_next) return;
+		this->has_item_next = false;
+
+		const std::vector<ScriptListItem> &items = this->GetItems();
+		auto iter = std::upper_bound(items.begin(), items.end(), this->item_next, [](int64 item, const ScriptListItem &entry) { return item < entry.item; });
+		for (; iter != items.end(); iter++) {
+			if (iter->removed) continue;
+			this->SetNext(iter->item, iter->value);
 			return;
 		}
 	}
@@ -327,76 +304,40 @@ public:
  * Sort by item, descending.
  */
 class ScriptListSorterItemDescending : public ScriptListSorter {
-private:
-	/* Note: We cannot use reverse_iterator.
-	 *       The iterators must only be invalidated when the element they are pointing to is removed.
-	 *       This only holds for forward iterators. */
-	ScriptList::ScriptListMap::iterator item_iter; ///< The iterator over the items in the map.
-
 public:
 	/**
 	 * Create a new sorter.
 	 * @param list The list to sort.
 	 */
-	ScriptListSorterItemDescending(ScriptList *list)
-	{
-		this->list = list;
-		this->End();
-	}
+	ScriptListSorterItemDescending(ScriptList *list) : ScriptListSorter(list) {}
 
-	int64 Begin()
+	int64 Begin() override
 	{
-		if (this->list->items.empty()) return 0;
+		this->End();
+		if (this->list->IsEmpty()) return 0;
 		this->has_no_more_items = false;
 
-		this->item_iter = this->list->items.end();
-		--this->item_iter;
-		this->item_next = (*this->item_iter).first;
-
-		int64 item_current = this->item_next;
-		FindNext();
-		return item_current;
-	}
-
-	void End()
-	{
-		this->has_no_more_items = true;
-	}
-
-	/**
-	 * Find the next item, and store that information.
-	 */
-	void FindNext()
-	{
-		if (this->item_iter == this->list->items.end()) {
-			this->has_no_more_items = true;
-			return;
-		}
-		if (this->item_iter == this->list->items.begin()) {
-			/* Use 'end' as marker for 'beyond begin' */
-			this->item_iter = this->list->items.end();
-		} else {
-			this->item_iter--;
+		const std::vector<ScriptListItem> &items = this->GetItems();
+		for (auto iter = items.rbegin(); iter != items.rend(); iter++) {
+			if (iter->removed) continue;
+			this->SetNext(iter->item, iter->value);
+			break;
 		}
-		if (this->item_iter != this->list->items.end()) item_next = (*this->item_iter).first;
-	}
-
-	int64 Next()
-	{
-		if (this->IsEnd()) return 0;
 
-		int64 item_current = this->item_next;
-		FindNext();
-		return item_current;
+		return this->Next();
 	}
 
-	void Remove(int item)
+	void FindNext() override
 	{
-		if (this->IsEnd()) return;
-
-		/* If we remove the 'next' item, skip to the next */
-		if (item == this->item_next) {
-			FindNext();
+		if (!this->has_item_next) return;
+		this->has_item_next = false;
+
+		const std::vector<ScriptListItem> &items = this->GetItems();
+		auto iter = std::lower_bound(items.begin(), items.end(), this->item_next, [](const ScriptListItem &entry, int64 item) { return entry.item < item; });
+		while (iter != items.begin()) {
+			--iter;
+			if (iter->removed) continue;
+			this->SetNext(iter->item, iter->value);
 			return;
 		}
 	}
@@ -412,6 +353,9 @@ ScriptList::ScriptList()
 	this->sort_ascending = false;
 	this->initialized    = false;
 	this->modifications  = 0;
+	this->items_sorted   = 0;
+	this->items_removed  = 0;
+	this->values_valid   = true;
 }
 
 ScriptList::~ScriptList()
@@ -419,9 +363,127 @@ ScriptList::~ScriptList()
 	delete this->sorter;
 }
 
+/**
+ * Make sure all items are sorted by item and unique.
+ * When an item was added more than once, only the first one is kept.
+ * Removed items are purged once they make up half of the list.
+ * @param purge Purge all removed items, regardless of their number.
+ */
+void ScriptList::SortItems(bool purge)
+{
+	if (this->items_removed > 0 && (purge || this->items_removed * 2 > this->items.size())) {
+		size_t sorted = 0;
+		size_t kept = 0;
+		for (size_t i = 0; i < this->items.size(); i++) {
+			if (this->items[i].removed) continue;
+			if (i < this->items_sorted) sorted++;
+			this->items[kept++] = this->items[i];
+		}
+		this->items.resize(kept);
+		this->items_sorted = sorted;
+		this->items_removed = 0;
+	}
+
+	if (this->items_sorted == this->items.size()) return;
+
+	auto compare = [](const ScriptListItem &a, const ScriptListItem &b) { return a.item < b.item; };
+	auto middle = this->items.begin() + this->items_sorted;
+	/* Both sorts are stable, so the first time an item was added comes first. */
+	std::stable_sort(middle, this->items.end(), compare);
+	std::inplace_merge(this->items.begin(), middle, this->items.end(), compare);
+
+	/* Only keep the first of each item; when that one is removed, a later one takes its place. */
+	size_t kept = 0;
+	for (size_t i = 0; i < this->items.size(); i++) {
+		const ScriptListItem &entry = this->items[i];
+		if (kept > 0 && this->items[kept - 1].item == entry.item) {
+			if (!this->items[kept - 1].removed) {
+				if (entry.removed) this->items_removed--;
+				continue;
+			}
+			this->items_removed--;
+			kept--;
+		}
+		this->items[kept++] = entry;
+	}
+	this->items.resize(kept);
+	this->items_sorted = kept;
+}
+
+/**
+ * Find an item in the list.
+ * @param item The item to find.
+ * @return The entry of the item, or \c nullptr when the item is not in the list.
+ * @note The entry is only valid until the list is changed or searched again.
+ */
+ScriptList::ScriptListItem *ScriptList::FindItem(int64 item)
+{
+	this->SortItems();
+
+	auto iter = std::lower_bound(this->items.begin(), this->items.end(), item, [](const ScriptListItem &entry, int64 key) { return entry.item < key; });
+	if (iter == this->items.end() || iter->item != item || iter->removed) return nullptr;
+	return &*iter;
+}
+
+/**
+ * Check whether a (value, item) pair of #values is not stale.
+ * @param value_item The pair to check.
+ * @return True iff the item is in the list with this value.
+ */
+bool ScriptList::IsCurrentValue(const ScriptListValueItem &value_item)
+{
+	const ScriptListItem *entry = this->FindItem(value_item.second);
+	return entry != nullptr && entry->value == value_item.first;
+}
+
+/**
+ * Get the items sorted by value, rebuilding the index when needed.
+ * @return The (value, item) pairs; pairs of removed items are stale and have to be skipped.
+ */
+const std::vector<ScriptList::ScriptListValueItem> &ScriptList::GetValues()
+{
+	if (!this->values_valid) {
+		this->SortItems(true);
+
+		this->values.clear();
+		this->values.reserve(this->items.size());
+		for (const ScriptListItem &entry : this->items) this->values.emplace_back(entry.value, entry.item);
+		std::sort(this->values.begin(), this->values.end());
+		this->values_valid = true;
+	}
+	return this->values;
+}
+
+/**
+ * Remove all items matching a predicate, in a single pass over the list.
+ * @param predicate Called with each item; returns true when the item has to be removed.
+ */
+template <typename Tpredicate>
+void ScriptList::RemoveItems(Tpredicate predicate)
+{
+	this->modifications++;
+
+	this->SortItems();
+	for (ScriptListItem &entry : this->items) {
+		if (entry.removed || !predicate(entry)) continue;
+		entry.removed = true;
+		this->items_removed++;
+	}
+	this->sorter->Revalidate();
+}
+
+/**
+ * Update the value index and the sorter after the values of items have been changed in place.
+ */
+void ScriptList::ValuesChanged()
+{
+	this->values_valid = false;
+	this->sorter->Revalidate();
+}
+
 bool ScriptList::HasItem(int64 item)
 {
-	return this->items.count(item) == 1;
+	return this->FindItem(item) != nullptr;
 }
 
 void ScriptList::Clear()
@@ -429,7 +491,10 @@ void ScriptList::Clear()
 	this->modifications++;
 
 	this->items.clear();
-	this->buckets.clear();
+	this->items_sorted = 0;
+	this->items_removed = 0;
+	this->values.clear();
+	this->values_valid = true;
 	this->sorter->End();
 }
 
@@ -437,27 +502,28 @@ void ScriptList::AddItem(int64 item, int64 value)
 {
 	this->modifications++;
 
-	if (this->HasItem(item)) return;
+	/* Items are usually added in increasing order, which keeps the list sorted.
+	 * Otherwise they are sorted in, and checked for duplicates, when the list is used. */
+	if (this->items_sorted == this->items.size() && (this->items.empty() || this->items.back().item < item)) {
+		this->items_sorted++;
+	} else if (this->items_sorted == this->items.size() && this->HasItem(item)) {
+		return;
+	}
 
-	this->items[item] = value;
-	this->buckets[value].insert(item);
+	this->items.push_back({item, value, false});
+	this->values_valid = false;
 }
 
 void ScriptList::RemoveItem(int64 item)
 {
 	this->modifications++;
 
-	ScriptListMap::iterator item_iter = this->items.find(item);
-	if (item_iter == this->items.end()) return;
+	ScriptListItem *entry = this->FindItem(item);
+	if (entry == nullptr) return;
 
-	int64 value = item_iter->second;
-
-	this->sorter->Remove(item);
-	ScriptListBucket::iterator bucket_iter = this->buckets.find(value);
-	assert(bucket_iter != this->buckets.end());
-	bucket_iter->second.erase(item);
-	if (bucket_iter->second.empty()) this->buckets.erase(bucket_iter);
-	this->items.erase(item_iter);
+	entry->removed = true;
+	this->items_removed++;
+	this->sorter->Revalidate();
 }
 
 int64 ScriptList::Begin()
@@ -477,7 +543,7 @@ int64 ScriptList::Next()
 
 bool ScriptList::IsEmpty()
 {
-	return this->items.empty();
+	return this->items.size() == this->items_removed;
 }
 
 bool ScriptList::IsEnd()
@@ -491,32 +557,27 @@ bool ScriptList::IsEnd()
 
 int32 ScriptList::Count()
 {
-	return (int32)this->items.size();
+	this->SortItems();
+	return (int32)(this->items.size() - this->items_removed);
 }
 
 int64 ScriptList::GetValue(int64 item)
 {
-	ScriptListMap::const_iterator item_iter = this->items.find(item);
-	return item_iter == this->items.end() ? 0 : item_iter->second;
+	const ScriptListItem *entry = this->FindItem(item);
+	return entry == nullptr ? 0 : entry->value;
 }
 
 bool ScriptList::SetValue(int64 item, int64 value)
 {
 	this->modifications++;
 
-	ScriptListMap::iterator item_iter = this->items.find(item);
-	if (item_iter == this->items.end()) return false;
-
-	int64 value_old = item_iter->second;
-	if (value_old == value) return true;
+	ScriptListItem *entry = this->FindItem(item);
+	if (entry == nullptr) return false;
+	if (entry->value == value) return true;
 
-	this->sorter->Remove(item);
-	ScriptListBucket::iterator bucket_iter = this->buckets.find(value_old);
-	assert(bucket_iter != this->buckets.end());
-	bucket_iter->second.erase(item);
-	if (bucket_iter->second.empty()) this->buckets.erase(bucket_iter);
-	item_iter->second = value;
-	this->buckets[value].insert(item);
+	entry->value = value;
+	this->values_valid = false;
+	this->sorter->Revalidate();
 
 	return true;
 }
@@ -557,18 +618,35 @@ void ScriptList::AddList(ScriptList *list)
 {
 	if (list == this) return;
 
+	this->modifications++;
+
+	list->SortItems(true);
 	if (this->IsEmpty()) {
 		/* If this is empty, we can just take the items of the other list as is. */
 		this->items = list->items;
-		this->buckets = list->buckets;
-		this->modifications++;
-	} else {
-		ScriptListMap *list_items = &list->items;
-		for (ScriptListMap::iterator iter = list_items->begin(); iter != list_items->end(); iter++) {
-			this->AddItem((*iter).first);
-			this->SetValue((*iter).first, (*iter).second);
-		}
+		this->items_sorted = list->items_sorted;
+		this->items_removed = 0;
+		this->values = list->values;
+		this->values_valid = list->values_valid;
+		return;
+	}
+
+	/* Merge both sorted lists; items of the other list overwrite the values of ours. */
+	this->SortItems(true);
+	std::vector<ScriptListItem> merged;
+	merged.reserve(this->items.size() + list->items.size());
+	auto own = this->items.begin();
+	for (const ScriptListItem &entry : list->items) {
+		while (own != this->items.end() && own->item < entry.item) merged.push_back(*own++);
+		if (own != this->items.end() && own->item == entry.item) own++;
+		merged.push_back(entry);
 	}
+	merged.insert(merged.end(), own, this->items.end());
+
+	this->items.swap(merged);
+	this->items_sorted = this->items.size();
+	this->values_valid = false;
+	this->sorter->Revalidate();
 }
 
 void ScriptList::SwapList(ScriptList *list)
@@ -576,7 +654,10 @@ void ScriptList::SwapList(ScriptList *list)
 	if (list == this) return;
 
 	this->items.swap(list->items);
-	this->buckets.swap(list->buckets);
+	this->values.swap(list->values);
+	Swap(this->items_sorted, list->items_sorted);
+	Swap(this->items_removed, list->items_removed);
+	Swap(this->values_valid, list->values_valid);
 	Swap(this->sorter, list->sorter);
 	Swap(this->sorter_type, list->sorter_type);
 	Swap(this->sort_ascending, list->sort_ascending);
@@ -588,116 +669,82 @@ void ScriptList::SwapList(ScriptList *list)
 
 void ScriptList::RemoveAboveValue(int64 value)
 {
-	this->modifications++;
-
-	for (ScriptListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second > value) this->RemoveItem((*iter).first);
-	}
+	this->RemoveItems([value](const ScriptListItem &entry) { return entry.value > value; });
 }
 
 void ScriptList::RemoveBelowValue(int64 value)
 {
-	this->modifications++;
-
-	for (ScriptListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second < value) this->RemoveItem((*iter).first);
-	}
+	this->RemoveItems([value](const ScriptListItem &entry) { return entry.value < value; });
 }
 
 void ScriptList::RemoveBetweenValue(int64 start, int64 end)
 {
-	this->modifications++;
-
-	for (ScriptListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second > start && (*iter).second < end) this->RemoveItem((*iter).first);
-	}
+	this->RemoveItems([start, end](const ScriptListItem &entry) { return entry.value > start && entry.value < end; });
 }
 
 void ScriptList::RemoveValue(int64 value)
 {
-	this->modifications++;
-
-	for (ScriptListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second == value) this->RemoveItem((*iter).first);
-	}
+	this->RemoveItems([value](const ScriptListItem &entry) { return entry.value == value; });
 }
 
 void ScriptList::RemoveTop(int32 count)
 {
 	this->modifications++;
 
-	if (!this->sort_ascending) {
-		this->Sort(this->sorter_type, !this->sort_ascending);
-		this->RemoveBottom(count);
-		this->Sort(this->sorter_type, !this->sort_ascending);
-		return;
-	}
+	if (count <= 0) return;
 
+	/* Find the items in the order of the current sorter; remove them afterwards,
+	 * as removing them right away could purge the list while walking it. */
+	std::vector<int64> remove;
 	switch (this->sorter_type) {
 		default: NOT_REACHED();
-		case SORT_BY_VALUE:
-			for (ScriptListBucket::iterator iter = this->buckets.begin(); iter != this->buckets.end(); iter = this->buckets.begin()) {
-				ScriptItemList *items = &(*iter).second;
-				size_t size = items->size();
-				for (ScriptItemList::iterator iter = items->begin(); iter != items->end(); iter = items->begin()) {
-					if (--count < 0) return;
-					this->RemoveItem(*iter);
-					/* When the last item is removed from the bucket, the bucket itself is removed.
-					 * This means that the iterators can be invalid after a call to RemoveItem.
-					 */
-					if (--size == 0) break;
-				}
+		case SORT_BY_VALUE: {
+			const std::vector<ScriptListValueItem> &values = this->GetValues();
+			auto find = [&](const ScriptListValueItem &value_item) {
+				if ((int32)remove.size() == count) return false;
+				if (this->IsCurrentValue(value_item)) remove.push_back(value_item.second);
+				return true;
+			};
+			if (this->sort_ascending) {
+				for (auto iter = values.begin(); iter != values.end() && find(*iter); iter++) {}
+			} else {
+				for (auto iter = values.rbegin(); iter != values.rend() && find(*iter); iter++) {}
 			}
 			break;
+		}
 
-		case SORT_BY_ITEM:
-			for (ScriptListMap::iterator iter = this->items.begin(); iter != this->items.end(); iter = this->items.begin()) {
-				if (--count < 0) return;
-				this->RemoveItem((*iter).first);
+		case SORT_BY_ITEM: {
+			this->SortItems();
+			auto find = [&](const ScriptListItem &entry) {
+				if ((int32)remove.size() == count) return false;
+				if (!entry.removed) remove.push_back(entry.item);
+				return true;
+			};
+			if (this->sort_ascending) {
+				for (auto iter = this->items.begin(); iter != this->items.end() && find(*iter); iter++) {}
+			} else {
+				for (auto iter = this->items.rbegin(); iter != this->items.rend() && find(*iter); iter++) {}
 			}
 			break;
+		}
+	}
+
+	for (int64 item : remove) {
+		ScriptListItem *entry = this->FindItem(item);
+		entry->removed = true;
+		this->items_removed++;
 	}
+	this->sorter->Revalidate();
 }
 
 void ScriptList::RemoveBottom(int32 count)
 {
 	this->modifications++;
 
-	if (!this->sort_ascending) {
-		this->Sort(this->sorter_type, !this->sort_ascending);
-		this->RemoveTop(count);
-		this->Sort(this->sorter_type, !this->sort_ascending);
-		return;
-	}
-
-	switch (this->sorter_type) {
-		default: NOT_REACHED();
-		case SORT_BY_VALUE:
-			for (ScriptListBucket::reverse_iterator iter = this->buckets.rbegin(); iter != this->buckets.rend(); iter = this->buckets.rbegin()) {
-				ScriptItemList *items = &(*iter).second;
-				size_t size = items->size();
-				for (ScriptItemList::reverse_iterator iter = items->rbegin(); iter != items->rend(); iter = items->rbegin()) {
-					if (--count < 0) return;
-					this->RemoveItem(*iter);
-					/* When the last item is removed from the bucket, the bucket itself is removed.
-					 * This means that the iterators can be invalid after a call to RemoveItem.
-					 */
-					if (--size == 0) break;
-				}
-			}
-			break;
-
-		case SORT_BY_ITEM:
-			for (ScriptListMap::reverse_iterator iter = this->items.rbegin(); iter != this->items.rend(); iter = this->items.rbegin()) {
-				if (--count < 0) return;
-				this->RemoveItem((*iter).first);
-			}
-			break;
-	}
+	/* Removing from the bottom is removing from the top in the opposite order. */
+	this->sort_ascending = !this->sort_ascending;
+	this->RemoveTop(count);
+	this->sort_ascending = !this->sort_ascending;
 }
 
 void ScriptList::RemoveList(ScriptList *list)
@@ -706,52 +753,36 @@ void ScriptList::RemoveList(ScriptList *list)
 
 	if (list == this) {
 		Clear();
-	} else {
-		ScriptListMap *list_items = &list->items;
-		for (ScriptListMap::iterator iter = list_items->begin(); iter != list_items->end(); iter++) {
-			this->RemoveItem((*iter).first);
-		}
+		return;
 	}
+
+	/* Walk both sorted lists at the same time. */
+	list->SortItems();
+	auto other = list->items.begin();
+	this->RemoveItems([&](const ScriptListItem &entry) {
+		while (other != list->items.end() && other->item < entry.item) other++;
+		return other != list->items.end() && other->item == entry.item && !other->removed;
+	});
 }
 
 void ScriptList::KeepAboveValue(int64 value)
 {
-	this->modifications++;
-
-	for (ScriptListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second <= value) this->RemoveItem((*iter).first);
-	}
+	this->RemoveItems([value](const ScriptListItem &entry) { return entry.value <= value; });
 }
 
 void ScriptList::KeepBelowValue(int64 value)
 {
-	this->modifications++;
-
-	for (ScriptListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second >= value) this->RemoveItem((*iter).first);
-	}
+	this->RemoveItems([value](const ScriptListItem &entry) { return entry.value >= value; });
 }
 
 void ScriptList::KeepBetweenValue(int64 start, int64 end)
 {
-	this->modifications++;
-
-	for (ScriptListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second <= start || (*iter).second >= end) this->RemoveItem((*iter).first);
-	}
+	this->RemoveItems([start, end](const ScriptListItem &entry) { return entry.value <= start || entry.value >= end; });
 }
 
 void ScriptList::KeepValue(int64 value)
 {
-	this->modifications++;
-
-	for (ScriptListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second != value) this->RemoveItem((*iter).first);
-	}
+	this->RemoveItems([value](const ScriptListItem &entry) { return entry.value != value; });
 }
 
 void ScriptList::KeepTop(int32 count)
@@ -774,10 +805,13 @@ void ScriptList::KeepList(ScriptList *list)
 
 	this->modifications++;
 
-	ScriptList tmp;
-	tmp.AddList(this);
-	tmp.RemoveList(list);
-	this->RemoveList(&tmp);
+	/* Walk both sorted lists at the same time. */
+	list->SortItems();
+	auto other = list->items.begin();
+	this->RemoveItems([&](const ScriptListItem &entry) {
+		while (other != list->items.end() && other->item < entry.item) other++;
+		return other == list->items.end() || other->item != entry.item || other->removed;
+	});
 }
 
 SQInteger ScriptList::_get(HSQUIRRELVM vm)
@@ -787,10 +821,10 @@ SQInteger ScriptList::_get(HSQUIRRELVM vm)
 	SQInteger idx;
 	sq_getinteger(vm, 2, &idx);
 
-	ScriptListMap::const_iterator item_iter = this->items.find(idx);
-	if (item_iter == this->items.end()) return SQ_ERROR;
+	const ScriptListItem *entry = this->FindItem(idx);
+	if (entry == nullptr) return SQ_ERROR;
 
-	sq_pushinteger(vm, item_iter->second);
+	sq_pushinteger(vm, entry->value);
 	return 1;
 }
 
@@ -869,14 +903,18 @@ SQInteger ScriptList::Valuate(HSQUIRRELVM vm)
 	/* Push the function to call */
 	sq_push(vm, 2);
 
-	for (ScriptListMap::iterator iter = this->items.begin(); iter != this->items.end(); iter++) {
+	/* Purge removed items, so the valuator can look up items without the
+	 * list being rearranged under our feet. Any other change is caught below. */
+	this->SortItems(true);
+
+	for (size_t i = 0; i < this->items.size(); i++) {
 		/* Check for changing of items. */
 		int previous_modification_count = this->modifications;
 
 		/* Push the root table as instance object, this is what squirrel does for meta-functions. */
 		sq_pushroottable(vm);
 		/* Push all arguments for the valuator function. */
-		sq_pushinteger(vm, (*iter).first);
+		sq_pushinteger(vm, this->items[i].item);
 		for (int i = 0; i < nparam - 1; i++) {
 			sq_push(vm, i + 3);
 		}
@@ -884,6 +922,7 @@ SQInteger ScriptList::Valuate(HSQUIRRELVM vm)
 		/* Call the function. Squirrel pops all parameters and pushes the return value. */
 		if (SQ_FAILED(sq_call(vm, nparam + 1, SQTrue, SQTrue))) {
 			ScriptObject::SetAllowDoCommand(backup_allow);
+			this->sorter->Revalidate();
 			return SQ_ERROR;
 		}
 
@@ -907,6 +946,7 @@ SQInteger ScriptList::Valuate(HSQUIRRELVM vm)
 				sq_pop(vm, nparam + 4);
 
 				ScriptObject::SetAllowDoCommand(backup_allow);
+				this->sorter->Revalidate();
 				return sq_throwerror(vm, "return value of valuator is not valid (not integer/bool)");
 			}
 		}
@@ -918,6 +958,7 @@ SQInteger ScriptList::Valuate(HSQUIRRELVM vm)
 			sq_pop(vm, nparam + 4);
 
 			ScriptObject::SetAllowDoCommand(backup_allow);
+			this->sorter->Revalidate();
 			return sq_throwerror(vm, "excessive CPU usage in valuator function");
 		}
 
@@ -927,10 +968,15 @@ SQInteger ScriptList::Valuate(HSQUIRRELVM vm)
 			sq_pop(vm, nparam + 4);
 
 			ScriptObject::SetAllowDoCommand(backup_allow);
+			this->sorter->Revalidate();
 			return sq_throwerror(vm, "modifying valuated list outside of valuator function");
 		}
 
-		this->SetValue((*iter).first, value);
+		if (this->items[i].value != value) {
+			this->items[i].value = value;
+			this->values_valid = false;
+		}
+		this->modifications++;
 
 		/* Pop the return value. */
 		sq_poptop(vm);
@@ -945,5 +991,6 @@ SQInteger ScriptList::Valuate(HSQUIRRELVM vm)
 	sq_pop(vm, nparam + 3);
 
 	ScriptObject::SetAllowDoCommand(backup_allow);
+	this->sorter->Revalidate();
 	return 0;
 }
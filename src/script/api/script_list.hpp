@@ -12,8 +12,7 @@
 #define SCRIPT_LIST_HPP
 
 #include "script_object.hpp"
-#include <map>
-#include <set>
+#include <vector>
 
 class ScriptListSorter;
 
@@ -41,14 +40,46 @@ private:
 	bool initialized;             ///< Whether an iteration has been started
 	int modifications;            ///< Number of modification that has been done. To prevent changing data while valuating.
 
-public:
-	typedef std::set<int64> ScriptItemList;                   ///< The list of items inside the bucket
-	typedef std::map<int64, ScriptItemList> ScriptListBucket; ///< The bucket list per value
-	typedef std::map<int64, int64> ScriptListMap;             ///< List per item
+	/** An item in the list with its value. */
+	struct ScriptListItem {
+		int64 item;   ///< The item itself.
+		int64 value;  ///< The value of the item.
+		bool removed; ///< Whether the item has been removed, but is not purged from the list yet.
+	};
+	/** The value of an item and the item itself; sorting these gives the order by value. */
+	typedef std::pair<int64, int64> ScriptListValueItem;
+
+	std::vector<ScriptListItem> items;       ///< The items in the list; the first #items_sorted are sorted by item, the others are appended in any order.
+	size_t items_sorted;                     ///< Number of items at the start of #items that are sorted and unique.
+	size_t items_removed;                    ///< Number of items in #items that are removed, but not purged yet.
+	std::vector<ScriptListValueItem> values; ///< The items sorted by value. Entries of items that have been removed, or whose value changed, are stale.
+	bool values_valid;                       ///< Whether #values contains the current value of every item.
 
-	ScriptListMap items;           ///< The items in the list
-	ScriptListBucket buckets;      ///< The items in the list, sorted by value
+	friend class ScriptListSorter;
 
+	void SortItems(bool purge = false);
+	ScriptListItem *FindItem(int64 item);
+	bool IsCurrentValue(const ScriptListValueItem &value_item);
+	const std::vector<ScriptListValueItem> &GetValues();
+	template <typename Tpredicate> void RemoveItems(Tpredicate predicate);
+	void ValuesChanged();
+
+protected:
+	/**
+	 * Give all items a value computed in C++, without calling into the script for every item.
+	 * @param valuator The function computing the value of an item; it is called with the item.
+	 */
+	template <typename Tvaluator>
+	void NativeValuate(Tvaluator valuator)
+	{
+		this->modifications++;
+
+		this->SortItems(true);
+		for (ScriptListItem &entry : this->items) entry.value = valuator(entry.item);
+		this->ValuesChanged();
+	}
+
+public:
 	ScriptList();
 	~ScriptList();
 
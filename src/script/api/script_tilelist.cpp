@@ -10,6 +10,7 @@
 #include "../../stdafx.h"
 #include "script_tilelist.hpp"
 #include "script_industry.hpp"
+#include "script_tile.hpp"
 #include "../../industry.h"
 #include "../../station_base.h"
 
@@ -24,6 +25,21 @@ void ScriptTileList::AddRectangle(TileIndex t1, TileIndex t2)
 	TILE_AREA_LOOP(t, ta) this->AddItem(t);
 }
 
+void ScriptTileList::AddRectangleFiltered(TileIndex t1, TileIndex t2, bool buildable, bool flat, int min_height, int max_height)
+{
+	if (!::IsValidTile(t1)) return;
+	if (!::IsValidTile(t2)) return;
+
+	TileArea ta(t1, t2);
+	TILE_AREA_LOOP(t, ta) {
+		if (buildable && !ScriptTile::IsBuildable(t)) continue;
+		if (flat && ScriptTile::GetSlope(t) != ScriptTile::SLOPE_FLAT) continue;
+		int32 height = ScriptTile::GetMinHeight(t);
+		if (height < min_height || height > max_height) continue;
+		this->AddItem(t);
+	}
+}
+
 void ScriptTileList::AddTile(TileIndex tile)
 {
 	if (!::IsValidTile(tile)) return;
@@ -47,6 +63,46 @@ void ScriptTileList::RemoveTile(TileIndex tile)
 	this->RemoveItem(tile);
 }
 
+void ScriptTileList::ValuateMinHeight()
+{
+	this->NativeValuate([](int64 item) { return ScriptTile::GetMinHeight((TileIndex)item); });
+}
+
+void ScriptTileList::ValuateMaxHeight()
+{
+	this->NativeValuate([](int64 item) { return ScriptTile::GetMaxHeight((TileIndex)item); });
+}
+
+void ScriptTileList::ValuateSlope()
+{
+	this->NativeValuate([](int64 item) { return ScriptTile::GetSlope((TileIndex)item); });
+}
+
+void ScriptTileList::ValuateOwner()
+{
+	this->NativeValuate([](int64 item) { return ScriptTile::GetOwner((TileIndex)item); });
+}
+
+void ScriptTileList::ValuateBuildable()
+{
+	this->NativeValuate([](int64 item) { return ScriptTile::IsBuildable((TileIndex)item) ? 1 : 0; });
+}
+
+void ScriptTileList::ValuateDistanceManhattanToTile(TileIndex tile)
+{
+	this->NativeValuate([tile](int64 item) { return ScriptTile::GetDistanceManhattanToTile((TileIndex)item, tile); });
+}
+
+void ScriptTileList::ValuateDistanceSquareToTile(TileIndex tile)
+{
+	this->NativeValuate([tile](int64 item) { return ScriptTile::GetDistanceSquareToTile((TileIndex)item, tile); });
+}
+
+void ScriptTileList::ValuateCargoAcceptance(CargoID cargo_type, int width, int height, int radius)
+{
+	this->NativeValuate([=](int64 item) { return ScriptTile::GetCargoAcceptance((TileIndex)item, cargo_type, width, height, radius); });
+}
+
 /**
  * Helper to get list of tiles that will cover an industry's production or acceptance.
  * @param i Industry in question
@@ -29,6 +29,24 @@ public:
 	 */
 	void AddRectangle(TileIndex tile_from, TileIndex tile_to);
 
+	/**
+	 * Adds the tiles of the rectangle between tile_from and tile_to that match
+	 *  all of the given conditions to the to-be-evaluated tiles.
+	 * @param tile_from One corner of the tiles to add.
+	 * @param tile_to The other corner of the tiles to add.
+	 * @param buildable Only add tiles that are buildable (see ScriptTile::IsBuildable).
+	 * @param flat Only add tiles that have no slope (see ScriptTile::GetSlope).
+	 * @param min_height Only add tiles with a lowest height (see ScriptTile::GetMinHeight) of at least this.
+	 * @param max_height Only add tiles with a lowest height (see ScriptTile::GetMinHeight) of at most this.
+	 * @pre ScriptMap::IsValidTile(tile_from).
+	 * @pre ScriptMap::IsValidTile(tile_to).
+	 * @note This gives the same result as AddRectangle followed by valuating and
+	 *  filtering the list for each of the conditions, but without building the
+	 *  list of all tiles and calling a script function for every tile, which
+	 *  makes it a lot faster.
+	 */
+	void AddRectangleFiltered(TileIndex tile_from, TileIndex tile_to, bool buildable, bool flat, int min_height, int max_height);
+
 	/**
 	 * Add a tile to the to-be-evaluated tiles.
 	 * @param tile The tile to add.
@@ -51,6 +69,69 @@ public:
 	 * @pre ScriptMap::IsValidTile(tile).
 	 */
 	void RemoveTile(TileIndex tile);
+
+	/**
+	 * Give all tiles their lowest height as value.
+	 * @note This gives the same result as Valuate(ScriptTile.GetMinHeight), but
+	 *  without calling a script function for every tile, which makes it a lot faster.
+	 */
+	void ValuateMinHeight();
+
+	/**
+	 * Give all tiles their highest height as value.
+	 * @note This gives the same result as Valuate(ScriptTile.GetMaxHeight), but
+	 *  without calling a script function for every tile, which makes it a lot faster.
+	 */
+	void ValuateMaxHeight();
+
+	/**
+	 * Give all tiles their slope as value.
+	 * @note This gives the same result as Valuate(ScriptTile.GetSlope), but
+	 *  without calling a script function for every tile, which makes it a lot faster.
+	 */
+	void ValuateSlope();
+
+	/**
+	 * Give all tiles their owner as value.
+	 * @note This gives the same result as Valuate(ScriptTile.GetOwner), but
+	 *  without calling a script function for every tile, which makes it a lot faster.
+	 */
+	void ValuateOwner();
+
+	/**
+	 * Give all tiles the value 1 when they are buildable and 0 otherwise.
+	 * @note This gives the same result as Valuate(ScriptTile.IsBuildable), but
+	 *  without calling a script function for every tile, which makes it a lot faster.
+	 */
+	void ValuateBuildable();
+
+	/**
+	 * Give all tiles their Manhattan distance to a tile as value.
+	 * @param tile The tile to get the distance to.
+	 * @note This gives the same result as Valuate(ScriptTile.GetDistanceManhattanToTile, tile), but
+	 *  without calling a script function for every tile, which makes it a lot faster.
+	 */
+	void ValuateDistanceManhattanToTile(TileIndex tile);
+
+	/**
+	 * Give all tiles their square distance to a tile as value.
+	 * @param tile The tile to get the distance to.
+	 * @note This gives the same result as Valuate(ScriptTile.GetDistanceSquareToTile, tile), but
+	 *  without calling a script function for every tile, which makes it a lot faster.
+	 */
+	void ValuateDistanceSquareToTile(TileIndex tile);
+
+	/**
+	 * Give all tiles the acceptance of a cargo by a station built on them as value.
+	 * @param cargo_type The cargo to check the acceptance of.
+	 * @param width The width of the station.
+	 * @param height The height of the station.
+	 * @param radius The radius of the station.
+	 * @note This gives the same result as Valuate(ScriptTile.GetCargoAcceptance, cargo_type, width, height, radius), but
+	 *  without calling a script function for every tile, which makes it a lot faster.
+	 * @see ScriptTile::GetCargoAcceptance
+	 */
+	void ValuateCargoAcceptance(CargoID cargo_type, int width, int height, int radius);
 };
 
 /**
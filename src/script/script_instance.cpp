@@ -27,6 +27,8 @@
 #include "../company_func.h"
 #include "../fileio_func.h"
 
+#include <vector>
+
 #include "../safeguards.h"
 
 ScriptStorage::~ScriptStorage()
@@ -47,6 +49,8 @@ static void PrintFunc(bool error_msg, const SQChar *message)
 	ScriptController::Print(error_msg, message);
 }
 
+/* static */ int ScriptInstance::spare_ops = 0;
+
 ScriptInstance::ScriptInstance(const char *APIName) :
 	engine(nullptr),
 	versionAPI(nullptr),
@@ -58,7 +62,8 @@ ScriptInstance::ScriptInstance(const char *APIName) :
 	is_save_data_on_stack(false),
 	suspend(0),
 	is_paused(false),
-	callback(nullptr)
+	callback(nullptr),
+	ops_exhausted(false)
 {
 	this->storage = new ScriptStorage();
 	this->engine  = new Squirrel(APIName);
@@ -168,6 +173,11 @@ void ScriptInstance::GameLoop()
 {
 	ScriptObject::ActiveInstance active(this);
 
+	/* Until proven otherwise this tick's opcodes are not used; other scripts can have them. */
+	const int ops = _settings_game.script.script_max_opcode_till_suspend;
+	ScriptInstance::spare_ops += ops;
+	this->ops_exhausted = false;
+
 	if (this->IsDead()) return;
 	if (this->engine->HasScriptCrashed()) {
 		/* The script crashed during saving, kill it here. */
@@ -203,6 +213,8 @@ void ScriptInstance::GameLoop()
 	this->callback = nullptr;
 
 	if (!this->is_started) {
+		/* Starting takes its own budgets; do not hand out this tick's opcodes. */
+		ScriptInstance::spare_ops -= ops;
 		try {
 			ScriptObject::SetAllowDoCommand(false);
 			/* Run the constructor if it exists. Don't allow any DoCommands in it. */
@@ -240,8 +252,33 @@ void ScriptInstance::GameLoop()
 	}
 
 	/* Continue the VM */
+	ScriptInstance::spare_ops -= this->ResumeVM(ops);
+}
+
+void ScriptInstance::ContinueWithSpareOps()
+{
+	if (!this->ops_exhausted || ScriptInstance::spare_ops <= 0) return;
+	if (this->IsDead() || this->is_paused) return;
+
+	ScriptObject::ActiveInstance active(this);
+	_current_company = ScriptObject::GetCompany();
+
+	/* Never more than a normal run, so a single script cannot take everything. */
+	const int ops = min(ScriptInstance::spare_ops, (int)_settings_game.script.script_max_opcode_till_suspend);
+	ScriptInstance::spare_ops -= this->ResumeVM(ops);
+}
+
+int ScriptInstance::ResumeVM(int ops)
+{
+	this->ops_exhausted = false;
 	try {
-		if (!this->engine->Resume(_settings_game.script.script_max_opcode_till_suspend)) this->Died();
+		if (!this->engine->Resume(ops)) {
+			this->Died();
+			return ops;
+		}
+		/* Without a suspend request the script only stops when its opcodes ran out */
+		this->ops_exhausted = true;
+		return ops;
 	} catch (Script_Suspend &e) {
 		this->suspend  = e.GetSuspendTime();
 		this->callback = e.GetSuspendCallback();
@@ -250,7 +287,11 @@ void ScriptInstance::GameLoop()
 		this->engine->ThrowError(e.GetErrorMessage());
 		this->engine->ResumeError();
 		this->Died();
+		return ops;
 	}
+
+	/* The script waits for something; whatever it did not use is spare */
+	return ops - (int)Clamp<SQInteger>(this->engine->GetOpsTillSuspend(), 0, ops);
 }
 
 void ScriptInstance::CollectGarbage() const
@@ -324,6 +365,12 @@ void *ScriptInstance::GetLogPointer()
  *             SQSL_ARRAY_TABLE_END.
  *  - bool:    A single byte with value 1 representing true and 0 false.
  *  - null:    No data.
+ *  - integer array: An array holding only integers. The number of elements
+ *             (uint32), followed by the binary representation of each of
+ *             the integers (int32).
+ *  - integer table: A table with only integer keys and values. The number of
+ *             key/value pairs (uint32), followed by the binary representation
+ *             of each key and its value (int32).
  */
 
 /** The type of the data that follows in the savegame. */
@@ -334,16 +381,40 @@ enum SQSaveLoadType {
 	SQSL_TABLE           = 0x03, ///< The following data is an table.
 	SQSL_BOOL            = 0x04, ///< The following data is a boolean.
 	SQSL_NULL            = 0x05, ///< A null variable.
+	SQSL_INT_ARRAY       = 0x06, ///< The following data is an array of only integers.
+	SQSL_INT_TABLE       = 0x07, ///< The following data is a table with only integer keys and values.
 	SQSL_ARRAY_TABLE_END = 0xFF, ///< Marks the end of an array or table, no data follows.
 };
 
-static byte _script_sl_byte; ///< Used as source/target by the script saveload code to store/load a single byte.
-
-/** SaveLoad array that saves/loads exactly one byte. */
-static const SaveLoad _script_byte[] = {
-	SLEG_VAR(_script_sl_byte, SLE_UINT8),
-	SLE_END()
-};
+/**
+ * Gather the contents of an array or table that only holds integers.
+ * @param vm The virtual machine to get the data from.
+ * @param index The index on the squirrel stack of the array or table.
+ * @param with_keys Whether to gather the keys too, each followed by its value.
+ * @param[out] values The gathered integers.
+ * @return True if all elements (and keys) are integers.
+ */
+static bool GetIntegerElements(HSQUIRRELVM vm, SQInteger index, bool with_keys, std::vector<int32> &values)
+{
+	values.clear();
+	sq_pushnull(vm);
+	while (SQ_SUCCEEDED(sq_next(vm, index - 1))) {
+		if (sq_gettype(vm, -1) != OT_INTEGER || (with_keys && sq_gettype(vm, -2) != OT_INTEGER)) {
+			sq_pop(vm, 3);
+			return false;
+		}
+		SQInteger res;
+		if (with_keys) {
+			sq_getinteger(vm, -2, &res);
+			values.push_back((int32)res);
+		}
+		sq_getinteger(vm, -1, &res);
+		values.push_back((int32)res);
+		sq_pop(vm, 2);
+	}
+	sq_pop(vm, 1);
+	return true;
+}
 
 /* static */ bool ScriptInstance::SaveObject(HSQUIRRELVM vm, SQInteger index, int max_depth, bool test)
 {
@@ -354,10 +425,7 @@ static const SaveLoad _script_byte[] = {
 
 	switch (sq_gettype(vm, index)) {
 		case OT_INTEGER: {
-			if (!test) {
-				_script_sl_byte = SQSL_INT;
-				SlObject(nullptr, _script_byte);
-			}
+			if (!test) SlWriteByte(SQSL_INT);
 			SQInteger res;
 			sq_getinteger(vm, index, &res);
 			if (!test) {
@@ -368,10 +436,7 @@ static const SaveLoad _script_byte[] = {
 		}
 
 		case OT_STRING: {
-			if (!test) {
-				_script_sl_byte = SQSL_STRING;
-				SlObject(nullptr, _script_byte);
-			}
+			if (!test) SlWriteByte(SQSL_STRING);
 			const SQChar *buf;
 			sq_getstring(vm, index, &buf);
 			size_t len = strlen(buf) + 1;
@@ -380,18 +445,26 @@ static const SaveLoad _script_byte[] = {
 				return false;
 			}
 			if (!test) {
-				_script_sl_byte = (byte)len;
-				SlObject(nullptr, _script_byte);
+				SlWriteByte((byte)len);
 				SlArray(const_cast<char *>(buf), len, SLE_CHAR);
 			}
 			return true;
 		}
 
 		case OT_ARRAY: {
-			if (!test) {
-				_script_sl_byte = SQSL_ARRAY;
-				SlObject(nullptr, _script_byte);
+			/* Store arrays of only integers in one go. */
+			static std::vector<int32> values;
+			if (GetIntegerElements(vm, index, false, values)) {
+				if (!test) {
+					SlWriteByte(SQSL_INT_ARRAY);
+					uint32 count = (uint32)values.size();
+					SlArray(&count, 1, SLE_UINT32);
+					SlArray(values.data(), values.size(), SLE_INT32);
+				}
+				return true;
 			}
+
+			if (!test) SlWriteByte(SQSL_ARRAY);
 			sq_pushnull(vm);
 			while (SQ_SUCCEEDED(sq_next(vm, index - 1))) {
 				/* Store the value */
@@ -403,18 +476,24 @@ static const SaveLoad _script_byte[] = {
 				}
 			}
 			sq_pop(vm, 1);
-			if (!test) {
-				_script_sl_byte = SQSL_ARRAY_TABLE_END;
-				SlObject(nullptr, _script_byte);
-			}
+			if (!test) SlWriteByte(SQSL_ARRAY_TABLE_END);
 			return true;
 		}
 
 		case OT_TABLE: {
-			if (!test) {
-				_script_sl_byte = SQSL_TABLE;
-				SlObject(nullptr, _script_byte);
+			/* Store tables of only integers in one go. */
+			static std::vector<int32> values;
+			if (GetIntegerElements(vm, index, true, values)) {
+				if (!test) {
+					SlWriteByte(SQSL_INT_TABLE);
+					uint32 count = (uint32)(values.size() / 2);
+					SlArray(&count, 1, SLE_UINT32);
+					SlArray(values.data(), values.size(), SLE_INT32);
+				}
+				return true;
 			}
+
+			if (!test) SlWriteByte(SQSL_TABLE);
 			sq_pushnull(vm);
 			while (SQ_SUCCEEDED(sq_next(vm, index - 1))) {
 				/* Store the key + value */
@@ -426,32 +505,20 @@ static const SaveLoad _script_byte[] = {
 				}
 			}
 			sq_pop(vm, 1);
-			if (!test) {
-				_script_sl_byte = SQSL_ARRAY_TABLE_END;
-				SlObject(nullptr, _script_byte);
-			}
+			if (!test) SlWriteByte(SQSL_ARRAY_TABLE_END);
 			return true;
 		}
 
 		case OT_BOOL: {
-			if (!test) {
-				_script_sl_byte = SQSL_BOOL;
-				SlObject(nullptr, _script_byte);
-			}
+			if (!test) SlWriteByte(SQSL_BOOL);
 			SQBool res;
 			sq_getbool(vm, index, &res);
-			if (!test) {
-				_script_sl_byte = res ? 1 : 0;
-				SlObject(nullptr, _script_byte);
-			}
+			if (!test) SlWriteByte(res ? 1 : 0);
 			return true;
 		}
 
 		case OT_NULL: {
-			if (!test) {
-				_script_sl_byte = SQSL_NULL;
-				SlObject(nullptr, _script_byte);
-			}
+			if (!test) SlWriteByte(SQSL_NULL);
 			return true;
 		}
 
@@ -463,8 +530,7 @@ static const SaveLoad _script_byte[] = {
 
 /* static */ void ScriptInstance::SaveEmpty()
 {
-	_script_sl_byte = 0;
-	SlObject(nullptr, _script_byte);
+	SlWriteByte(0);
 }
 
 void ScriptInstance::Save()
@@ -479,8 +545,7 @@ void ScriptInstance::Save()
 
 	HSQUIRRELVM vm = this->engine->GetVM();
 	if (this->is_save_data_on_stack) {
-		_script_sl_byte = 1;
-		SlObject(nullptr, _script_byte);
+		SlWriteByte(1);
 		/* Save the data that was just loaded. */
 		SaveObject(vm, -1, SQUIRREL_MAX_DEPTH, false);
 	} else if (!this->is_started) {
@@ -522,8 +587,7 @@ void ScriptInstance::Save()
 		}
 		sq_pushobject(vm, savedata);
 		if (SaveObject(vm, -1, SQUIRREL_MAX_DEPTH, true)) {
-			_script_sl_byte = 1;
-			SlObject(nullptr, _script_byte);
+			SlWriteByte(1);
 			SaveObject(vm, -1, SQUIRREL_MAX_DEPTH, false);
 			this->is_save_data_on_stack = true;
 		} else {
@@ -532,8 +596,7 @@ void ScriptInstance::Save()
 		}
 	} else {
 		ScriptLog::Warning("Save function is not implemented");
-		_script_sl_byte = 0;
-		SlObject(nullptr, _script_byte);
+		SaveEmpty();
 	}
 }
 
@@ -558,8 +621,7 @@ bool ScriptInstance::IsPaused()
 
 /* static */ bool ScriptInstance::LoadObjects(HSQUIRRELVM vm)
 {
-	SlObject(nullptr, _script_byte);
-	switch (_script_sl_byte) {
+	switch (SlReadByte()) {
 		case SQSL_INT: {
 			int value;
 			SlArray(&value, 1, SLE_INT32);
@@ -568,9 +630,9 @@ bool ScriptInstance::IsPaused()
 		}
 
 		case SQSL_STRING: {
-			SlObject(nullptr, _script_byte);
 			static char buf[256];
-			SlArray(buf, _script_sl_byte, SLE_CHAR);
+			byte len = SlReadByte();
+			SlArray(buf, len, SLE_CHAR);
 			if (vm != nullptr) sq_pushstring(vm, buf, -1);
 			return true;
 		}
@@ -595,8 +657,8 @@ bool ScriptInstance::IsPaused()
 		}
 
 		case SQSL_BOOL: {
-			SlObject(nullptr, _script_byte);
-			if (vm != nullptr) sq_pushbool(vm, (SQBool)(_script_sl_byte != 0));
+			byte value = SlReadByte();
+			if (vm != nullptr) sq_pushbool(vm, (SQBool)(value != 0));
 			return true;
 		}
 
@@ -605,6 +667,39 @@ bool ScriptInstance::IsPaused()
 			return true;
 		}
 
+		case SQSL_INT_ARRAY: {
+			uint32 count;
+			SlArray(&count, 1, SLE_UINT32);
+			static std::vector<int32> values;
+			values.resize(count);
+			SlArray(values.data(), count, SLE_INT32);
+			if (vm != nullptr) {
+				sq_newarray(vm, 0);
+				for (int32 value : values) {
+					sq_pushinteger(vm, (SQInteger)value);
+					sq_arrayappend(vm, -2);
+				}
+			}
+			return true;
+		}
+
+		case SQSL_INT_TABLE: {
+			uint32 count;
+			SlArray(&count, 1, SLE_UINT32);
+			static std::vector<int32> values;
+			values.resize(count * 2);
+			SlArray(values.data(), values.size(), SLE_INT32);
+			if (vm != nullptr) {
+				sq_newtable(vm);
+				for (size_t i = 0; i < values.size(); i += 2) {
+					sq_pushinteger(vm, (SQInteger)values[i]);
+					sq_pushinteger(vm, (SQInteger)values[i + 1]);
+					sq_rawset(vm, -3);
+				}
+			}
+			return true;
+		}
+
 		case SQSL_ARRAY_TABLE_END: {
 			return false;
 		}
@@ -615,9 +710,8 @@ bool ScriptInstance::IsPaused()
 
 /* static */ void ScriptInstance::LoadEmpty()
 {
-	SlObject(nullptr, _script_byte);
 	/* Check if there was anything saved at all. */
-	if (_script_sl_byte == 0) return;
+	if (SlReadByte() == 0) return;
 
 	LoadObjects(nullptr);
 }
@@ -632,9 +726,8 @@ void ScriptInstance::Load(int version)
 	}
 	HSQUIRRELVM vm = this->engine->GetVM();
 
-	SlObject(nullptr, _script_byte);
 	/* Check if there was anything saved at all. */
-	if (_script_sl_byte == 0) return;
+	if (SlReadByte() == 0) return;
 
 	sq_pushinteger(vm, version);
 	LoadObjects(vm);
@@ -65,6 +65,18 @@ public:
 	 */
 	void GameLoop();
 
+	/**
+	 * Let a script that ran out of opcodes in its #GameLoop of this tick
+	 *  continue with the opcodes other scripts left unused.
+	 */
+	void ContinueWithSpareOps();
+
+	/**
+	 * Forget about the opcodes the scripts left unused so far; to be called
+	 *  before the scripts of a tick are run.
+	 */
+	static void ResetSpareOps() { ScriptInstance::spare_ops = 0; }
+
 	/**
 	 * Let the VM collect any garbage.
 	 */
@@ -244,6 +256,16 @@ private:
 	bool is_paused;                       ///< Is the script paused? (a paused script will not be executed until unpaused)
 	Script_SuspendCallbackProc *callback; ///< Callback that should be called in the next tick the script runs.
 	size_t last_allocated_memory;         ///< Last known allocated memory value (for display for crashed scripts)
+	bool ops_exhausted;                   ///< Did the script run out of opcodes in its last run?
+
+	static int spare_ops;                 ///< Opcodes the scripts of the current tick did not use.
+
+	/**
+	 * Continue the VM of the script.
+	 * @param ops The maximum number of opcodes to run.
+	 * @return The number of opcodes used.
+	 */
+	int ResumeVM(int ops);
 
 	/**
 	 * Call the script Load function if it exists and data was loaded
@@ -9,6 +9,7 @@
 
 #include <stdarg.h>
 #include <map>
+#include <vector>
 #include "../stdafx.h"
 #include "../debug.h"
 #include "squirrel_std.hpp"
@@ -20,6 +21,8 @@
 #include <../squirrel/sqpcheader.h>
 #include <../squirrel/sqvm.h>
 #include "../core/alloc_func.hpp"
+#include "../3rdparty/md5/md5.h"
+#include "../rev.h"
 
 #include "../safeguards.h"
 
@@ -35,6 +38,22 @@ struct ScriptAllocator {
 
 	static const size_t SAFE_LIMIT = 0x8000000; ///< 128 MiB, a safe choice for almost any situation
 
+	static const size_t SIZE_CLASS_STEP = 16;   ///< Granularity (and alignment) of the small object size classes.
+	static const size_t SIZE_CLASS_COUNT = 16;  ///< Number of small object size classes; larger allocations go straight to the heap.
+	static const size_t MAX_SMALL_SIZE = SIZE_CLASS_STEP * SIZE_CLASS_COUNT; ///< Largest allocation served from the arenas.
+	static const size_t ARENA_SIZE = 0x4000;    ///< Size of a single arena carved into objects of one size class.
+
+	/** Administration of the objects of a single size class. */
+	struct SizeClass {
+		void *free_list; ///< Singly linked list of freed objects.
+		char *next;      ///< Next never used object in the current arena.
+		char *end;       ///< End of the current arena.
+	};
+
+	SizeClass size_classes[SIZE_CLASS_COUNT]; ///< Small object size classes.
+	std::vector<char *> arenas;               ///< All arenas of this allocator, released wholesale by #ReleaseArenas.
+	size_t small_allocated_size;              ///< Part of #allocated_size served from the arenas.
+
 #ifdef SCRIPT_DEBUG_ALLOCATIONS
 	std::map<void *, size_t> allocations;
 #endif
@@ -44,9 +63,53 @@ struct ScriptAllocator {
 		if (this->allocated_size > this->allocation_limit) throw Script_FatalError("Maximum memory allocation exceeded");
 	}
 
+	/**
+	 * Get the size class serving allocations of the given size.
+	 * @param size Size of the allocation, at most #MAX_SMALL_SIZE.
+	 * @return The size class.
+	 */
+	static inline size_t GetSizeClass(SQUnsignedInteger size)
+	{
+		return size == 0 ? 0 : (size - 1) / SIZE_CLASS_STEP;
+	}
+
+	void *AllocateSmall(size_t cls)
+	{
+		SizeClass &sc = this->size_classes[cls];
+		if (sc.free_list != nullptr) {
+			void *p = sc.free_list;
+			sc.free_list = *static_cast<void **>(p);
+			return p;
+		}
+
+		const size_t object_size = (cls + 1) * SIZE_CLASS_STEP;
+		if (sc.next == sc.end) {
+			char *arena = MallocT<char>(ARENA_SIZE);
+			this->arenas.push_back(arena);
+			sc.next = arena;
+			sc.end = arena + ARENA_SIZE - ARENA_SIZE % object_size;
+		}
+		void *p = sc.next;
+		sc.next += object_size;
+		return p;
+	}
+
+	void FreeSmall(void *p, size_t cls)
+	{
+		SizeClass &sc = this->size_classes[cls];
+		*static_cast<void **>(p) = sc.free_list;
+		sc.free_list = p;
+	}
+
 	void *Malloc(SQUnsignedInteger size)
 	{
-		void *p = MallocT<char>(size);
+		void *p;
+		if (size <= MAX_SMALL_SIZE) {
+			p = this->AllocateSmall(GetSizeClass(size));
+			this->small_allocated_size += size;
+		} else {
+			p = MallocT<char>(size);
+		}
 		this->allocated_size += size;
 
 #ifdef SCRIPT_DEBUG_ALLOCATIONS
@@ -68,29 +131,54 @@ struct ScriptAllocator {
 			return nullptr;
 		}
 
+		void *new_p;
+		if (oldsize > MAX_SMALL_SIZE && size > MAX_SMALL_SIZE) {
 #ifdef SCRIPT_DEBUG_ALLOCATIONS
-		assert(this->allocations[p] == oldsize);
-		this->allocations.erase(p);
+			assert(this->allocations[p] == oldsize);
+			this->allocations.erase(p);
 #endif
 
-		void *new_p = ReallocT<char>(static_cast<char *>(p), size);
+			new_p = ReallocT<char>(static_cast<char *>(p), size);
 
-		this->allocated_size -= oldsize;
-		this->allocated_size += size;
+			this->allocated_size -= oldsize;
+			this->allocated_size += size;
 
 #ifdef SCRIPT_DEBUG_ALLOCATIONS
-		assert(new_p != nullptr);
-		assert(this->allocations.find(p) == this->allocations.end());
-		this->allocations[new_p] = size;
+			assert(new_p != nullptr);
+			assert(this->allocations.find(p) == this->allocations.end());
+			this->allocations[new_p] = size;
+#endif
+		} else if (oldsize <= MAX_SMALL_SIZE && size <= MAX_SMALL_SIZE && GetSizeClass(oldsize) == GetSizeClass(size)) {
+			/* The object still fits in its slot */
+#ifdef SCRIPT_DEBUG_ALLOCATIONS
+			assert(this->allocations[p] == oldsize);
+			this->allocations[p] = size;
 #endif
 
+			new_p = p;
+			this->small_allocated_size -= oldsize;
+			this->small_allocated_size += size;
+			this->allocated_size -= oldsize;
+			this->allocated_size += size;
+		} else {
+			/* Moving between the arenas and the heap, or between size classes */
+			new_p = this->Malloc(size);
+			memcpy(new_p, p, min(oldsize, size));
+			this->Free(p, oldsize);
+		}
+
 		return new_p;
 	}
 
 	void Free(void *p, SQUnsignedInteger size)
 	{
 		if (p == nullptr) return;
-		free(p);
+		if (size <= MAX_SMALL_SIZE) {
+			this->FreeSmall(p, GetSizeClass(size));
+			this->small_allocated_size -= size;
+		} else {
+			free(p);
+		}
 		this->allocated_size -= size;
 
 #ifdef SCRIPT_DEBUG_ALLOCATIONS
@@ -99,11 +187,29 @@ struct ScriptAllocator {
 #endif
 	}
 
+	/**
+	 * Release all arenas at once. Any small object still allocated becomes
+	 * invalid, so this may only be called when the VM using this allocator
+	 * has been closed.
+	 */
+	void ReleaseArenas()
+	{
+		for (char *arena : this->arenas) free(arena);
+		this->arenas.clear();
+		memset(this->size_classes, 0, sizeof(this->size_classes));
+
+		/* Anything the VM leaked in the arenas is gone now too */
+		this->allocated_size -= this->small_allocated_size;
+		this->small_allocated_size = 0;
+	}
+
 	ScriptAllocator()
 	{
 		this->allocated_size = 0;
 		this->allocation_limit = static_cast<size_t>(_settings_game.script.script_max_memory_megabytes) << 20;
 		if (this->allocation_limit == 0) this->allocation_limit = SAFE_LIMIT; // in case the setting is somehow zero
+		memset(this->size_classes, 0, sizeof(this->size_classes));
+		this->small_allocated_size = 0;
 	}
 
 	~ScriptAllocator()
@@ -111,6 +217,7 @@ struct ScriptAllocator {
 #ifdef SCRIPT_DEBUG_ALLOCATIONS
 		assert(this->allocations.size() == 0);
 #endif
+		this->ReleaseArenas();
 	}
 };
 
@@ -564,6 +671,127 @@ static SQInteger _io_file_read(SQUserPointer file, SQUserPointer buf, SQInteger
 	return ret;
 }
 
+char *_script_bytecode_cache_dir; ///< Directory for the compiled script cache files.
+
+static const char SCRIPT_BYTECODE_CACHE_MAGIC[4] = { 'O', 'T', 'S', 'C' }; ///< Start of a compiled script cache file.
+static const uint32 SCRIPT_BYTECODE_CACHE_VERSION = (1 << 8) | (sizeof(SQInteger) << 4) | sizeof(void *); ///< Version of the compiled script cache files; the bytecode depends on the native types.
+
+/** Compiled scripts, by checksum of their name and source. */
+static std::map<std::string, std::vector<byte>> _script_bytecode_cache;
+
+/** Reader of a compiled script in memory. */
+struct SQBytecodeReader {
+	const std::vector<byte> &data; ///< The compiled script.
+	size_t pos;                    ///< Position of the next byte to read.
+};
+
+static SQInteger _io_bytecode_read(SQUserPointer reader, SQUserPointer buf, SQInteger size)
+{
+	SQBytecodeReader *r = (SQBytecodeReader *)reader;
+	size_t len = min<size_t>(size, r->data.size() - r->pos);
+	if (len == 0) return -1;
+	memcpy(buf, r->data.data() + r->pos, len);
+	r->pos += len;
+	return len;
+}
+
+static SQInteger _io_bytecode_write(SQUserPointer writer, SQUserPointer buf, SQInteger size)
+{
+	std::vector<byte> *data = (std::vector<byte> *)writer;
+	data->insert(data->end(), (byte *)buf, (byte *)buf + size);
+	return size;
+}
+
+/**
+ * Get the name of the cache file of a compiled script.
+ * @param buf Buffer for the name.
+ * @param last Last element of the buffer.
+ * @param key Checksum of the name and source of the script.
+ */
+static void GetScriptBytecodeCacheFile(char *buf, const char *last, const std::string &key)
+{
+	seprintf(buf, last, "%s%s.sqc", _script_bytecode_cache_dir, key.c_str());
+}
+
+/**
+ * Find a compiled script in the cache, or in its cache file.
+ * @param key Checksum of the name and source of the script.
+ * @return The compiled script, or \c nullptr if it was not compiled before.
+ */
+static const std::vector<byte> *FindScriptBytecode(const std::string &key)
+{
+	auto it = _script_bytecode_cache.find(key);
+	if (it != _script_bytecode_cache.end()) return &it->second;
+	if (_script_bytecode_cache_dir == nullptr) return nullptr;
+
+	char filename[MAX_PATH];
+	GetScriptBytecodeCacheFile(filename, lastof(filename), key);
+	FILE *f = fopen(filename, "rb");
+	if (f == nullptr) return nullptr;
+
+	/* The file holds the magic, version, length and checksum of the bytecode, followed by the bytecode. */
+	char magic[sizeof(SCRIPT_BYTECODE_CACHE_MAGIC)];
+	uint32 version;
+	uint32 length;
+	uint8 checksum[16];
+	std::vector<byte> data;
+	bool valid = fread(magic, sizeof(magic), 1, f) == 1 && memcmp(magic, SCRIPT_BYTECODE_CACHE_MAGIC, sizeof(magic)) == 0 &&
+			fread(&version, sizeof(version), 1, f) == 1 && version == SCRIPT_BYTECODE_CACHE_VERSION &&
+			fread(&length, sizeof(length), 1, f) == 1 && length > 0 && length < (1U << 26) &&
+			fread(checksum, sizeof(checksum), 1, f) == 1;
+	if (valid) {
+		data.resize(length);
+		valid = fread(data.data(), length, 1, f) == 1;
+	}
+	fclose(f);
+	if (valid) {
+		/* Do not feed a damaged file to squirrel. */
+		Md5 md5;
+		uint8 digest[16];
+		md5.Append(data.data(), data.size());
+		md5.Finish(digest);
+		valid = memcmp(digest, checksum, sizeof(digest)) == 0;
+	}
+	if (!valid) return nullptr;
+
+	std::vector<byte> &cached = _script_bytecode_cache[key];
+	cached = std::move(data);
+	return &cached;
+}
+
+/**
+ * Store a compiled script in the cache and in its cache file.
+ * @param key Checksum of the name and source of the script.
+ * @param data The compiled script.
+ */
+static void StoreScriptBytecode(const std::string &key, std::vector<byte> &&data)
+{
+	std::vector<byte> &cached = _script_bytecode_cache[key];
+	cached = std::move(data);
+	if (_script_bytecode_cache_dir == nullptr) return;
+
+	char filename[MAX_PATH];
+	GetScriptBytecodeCacheFile(filename, lastof(filename), key);
+	FioCreateDirectory(_script_bytecode_cache_dir);
+	FILE *f = fopen(filename, "wb");
+	if (f == nullptr) {
+		DEBUG(script, 1, "Could not create the compiled script cache %s", filename);
+		return;
+	}
+
+	Md5 md5;
+	uint8 checksum[16];
+	md5.Append(cached.data(), cached.size());
+	md5.Finish(checksum);
+	uint32 version = SCRIPT_BYTECODE_CACHE_VERSION;
+	uint32 length = (uint32)cached.size();
+	bool written = fwrite(SCRIPT_BYTECODE_CACHE_MAGIC, sizeof(SCRIPT_BYTECODE_CACHE_MAGIC), 1, f) == 1 &&
+			fwrite(&version, sizeof(version), 1, f) == 1 && fwrite(&length, sizeof(length), 1, f) == 1 &&
+			fwrite(checksum, sizeof(checksum), 1, f) == 1 && fwrite(cached.data(), cached.size(), 1, f) == 1;
+	fclose(f);
+	if (!written) remove(filename);
+}
+
 SQRESULT Squirrel::LoadFile(HSQUIRRELVM vm, const char *filename, SQBool printerror)
 {
 	ScriptAllocatorScope alloc_scope(this);
@@ -642,9 +870,41 @@ SQRESULT Squirrel::LoadFile(HSQUIRRELVM vm, const char *filename, SQBool printer
 			break;
 	}
 
+	/* Compiling is slow, so reuse the bytecode of an earlier compilation of
+	 * the same source. The bytecode remembers the name of the file for error
+	 * messages, and it may differ between versions, so both are part of the key. */
+	std::vector<byte> source(size);
+	size_t source_size = fread(source.data(), 1, size, file);
+	Md5 md5;
+	uint8 digest[16];
+	md5.Append(_openttd_revision, strlen(_openttd_revision) + 1);
+	md5.Append(filename, strlen(filename) + 1);
+	md5.Append(source.data(), source_size);
+	md5.Finish(digest);
+	char key[33];
+	md5sumToString(key, lastof(key), digest);
+
+	const std::vector<byte> *bytecode = FindScriptBytecode(key);
+	if (bytecode != nullptr) {
+		SQBytecodeReader reader{ *bytecode, 0 };
+		if (SQ_SUCCEEDED(sq_readclosure(vm, _io_bytecode_read, &reader))) {
+			FioFCloseFile(file);
+			return SQ_OK;
+		}
+		DEBUG(script, 1, "Compiled script cache of '%s' is unusable, compiling it again", filename);
+	}
+
+	if (fseek(file, -(long)source_size, SEEK_CUR) < 0) {
+		FioFCloseFile(file);
+		return sq_throwerror(vm, "cannot seek the file");
+	}
+
 	SQFile f(file, size);
 	if (SQ_SUCCEEDED(sq_compile(vm, func, &f, filename, printerror))) {
 		FioFCloseFile(file);
+
+		std::vector<byte> data;
+		if (SQ_SUCCEEDED(sq_writeclosure(vm, _io_bytecode_write, &data))) StoreScriptBytecode(key, std::move(data));
 		return SQ_OK;
 	}
 	FioFCloseFile(file);
@@ -692,6 +952,9 @@ void Squirrel::Uninitialize()
 	/* Clean up the stuff */
 	sq_pop(this->vm, 1);
 	sq_close(this->vm);
+
+	/* Nothing of the VM remains, so hand its small objects back in one go */
+	this->allocator->ReleaseArenas();
 }
 
 void Squirrel::Reset()
@@ -1554,6 +1554,7 @@ static SettingsContainer &GetSettingsTree()
 				construction->Add(new SettingEntry("gui.link_terraform_toolbar"));
 				construction->Add(new SettingEntry("gui.enable_signal_gui"));
 				construction->Add(new SettingEntry("gui.persistent_buildingtools"));
+				construction->Add(new SettingEntry("gui.predict_command_cost"));
 				construction->Add(new SettingEntry("gui.quick_goto"));
 				construction->Add(new SettingEntry("gui.default_rail_type"));
 				construction->Add(new SettingEntry("gui.disable_unsuitable_building"));
@@ -1620,6 +1621,7 @@ static SettingsContainer &GetSettingsTree()
 			accounting->Add(new SettingEntry("difficulty.max_loan"));
 			accounting->Add(new SettingEntry("difficulty.subsidy_multiplier"));
 			accounting->Add(new SettingEntry("economy.feeder_payment_share"));
+			accounting->Add(new SettingEntry("economy.cargo_packet_merge_days"));
 			accounting->Add(new SettingEntry("economy.infrastructure_maintenance"));
 			accounting->Add(new SettingEntry("difficulty.vehicle_costs"));
 			accounting->Add(new SettingEntry("difficulty.construction_cost"));
@@ -1746,6 +1748,8 @@ static SettingsContainer &GetSettingsTree()
 				cdist->Add(new SettingEntry("linkgraph.demand_distance"));
 				cdist->Add(new SettingEntry("linkgraph.demand_size"));
 				cdist->Add(new SettingEntry("linkgraph.short_path_saturation"));
+				cdist->Add(new SettingEntry("linkgraph.incremental"));
+				cdist->Add(new SettingEntry("linkgraph.demand_approximation"));
 			}
 
 			environment->Add(new SettingEntry("station.modified_catchment"));
@@ -2599,6 +2603,8 @@ struct CustomCurrencyWindow : Window {
 			ShowQueryString(str, STR_CURRENCY_CHANGE_PARAMETER, len + 1, this, afilter, QSF_NONE);
 		}
 
+		/* The custom currency might have changed, so money has to be formatted again. */
+		ClearFormattedStringCache();
 		this->SetTimeout();
 		this->SetDirty();
 	}
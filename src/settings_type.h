@@ -110,11 +110,15 @@ struct GUISettings {
 	bool   disable_unsuitable_building;      ///< disable infrastructure building when no suitable vehicles are available
 	byte   autosave;                         ///< how often should we do autosaves?
 	bool   threaded_saves;                   ///< should we do threaded saves?
+	uint8  worker_threads;                   ///< number of threads sharing parallelisable work; 0 is one per CPU core
+	bool   framerate_details;                ///< measure the detailed game loop elements of the framerate window
+	uint16 slow_tick_threshold;              ///< game ticks taking longer than this many milliseconds are reported to the debug log, 0 to disable
 	bool   keep_all_autosave;                ///< name the autosave in a different way
 	bool   autosave_on_exit;                 ///< save an autosave when you quit the game, but do not ask "Do you really want to quit?"
 	bool   autosave_on_network_disconnect;   ///< save an autosave when you get disconnected from a network game with an error?
 	uint8  date_format_in_default_names;     ///< should the default savegame/screenshot name use long dates (31th Dec 2008), short dates (31-12-2008) or ISO dates (2008-12-31)
 	byte   max_num_autosaves;                ///< controls how many autosavegames are made before the game starts to overwrite (names them 0 to max_num_autosaves - 1)
+	uint8  autosave_delta_interval;          ///< number of autosaves that only store the changes since the last full autosave, before making a full autosave again; 0 disables them
 	bool   population_in_label;              ///< show the population of a town in his label?
 	uint8  right_mouse_btn_emulation;        ///< should we emulate right mouse clicking?
 	uint8  scrollwheel_scrolling;            ///< scrolling using the scroll wheel?
@@ -139,6 +143,7 @@ struct GUISettings {
 	bool   station_dragdrop;                 ///< whether drag and drop is enabled for stations
 	bool   station_show_coverage;            ///< whether to highlight coverage area
 	bool   persistent_buildingtools;         ///< keep the building tools active after usage
+	bool   predict_command_cost;             ///< in multiplayer, show the estimated cost of construction before the server executes it
 	bool   expenses_layout;                  ///< layout of expenses window
 	uint32 last_newgrf_count;                ///< the numbers of NewGRFs we found during the last scan
 	byte   missing_strings_threshold;        ///< the number of missing strings before showing the warning
@@ -236,6 +241,7 @@ struct NewsSettings {
 struct NetworkSettings {
 	uint16 sync_freq;                                     ///< how often do we check whether we are still in-sync
 	uint8  frame_freq;                                    ///< how often do we send commands to the clients
+	bool   adaptive_frame_freq;                           ///< send frames more often than frame_freq when the load is light
 	uint16 commands_per_frame;                            ///< how many commands may be sent each frame_freq frames?
 	uint16 max_commands_in_queue;                         ///< how many commands may there be in the incoming queue before dropping the connection?
 	uint16 bytes_per_frame;                               ///< how many bytes may, over a long period, be received per frame?
@@ -410,6 +416,7 @@ struct YAPFSettings {
 	uint32 rail_shorter_platform_per_tile_penalty; ///< penalty for shorter station platform than train (per tile)
 	uint32 ship_curve45_penalty;                   ///< penalty for 45-deg curve for ships
 	uint32 ship_curve90_penalty;                   ///< penalty for 90-deg curve for ships
+	bool   ship_path_prefetch;                     ///< search the path of ships ahead of time on the worker threads
 };
 
 /** Settings related to all pathfinders. */
@@ -474,6 +481,7 @@ struct EconomySettings {
 	bool   allow_shares;                     ///< allow the buying/selling of shares
 	uint8  min_years_for_shares;             ///< minimum age of a company for it to trade shares
 	uint8  feeder_payment_share;             ///< percentage of leg payment to virtually pay in feeder systems
+	uint8  cargo_packet_merge_days;          ///< maximum difference in days in transit of cargo packets that are merged
 	byte   dist_local_authority;             ///< distance for town local authority, default 20
 	bool   exclusive_rights;                 ///< allow buying exclusive rights
 	bool   fund_buildings;                   ///< allow funding new buildings
@@ -505,6 +513,8 @@ struct LinkGraphSettings {
 	uint8 demand_size;                      ///< influence of supply ("station size") on the demand function
 	uint8 demand_distance;                  ///< influence of distance between stations on the demand function
 	uint8 short_path_saturation;            ///< percentage up to which short paths are saturated before saturating most capacious paths
+	bool incremental;                       ///< start the calculation from the routes of the current flows
+	uint16 demand_approximation;            ///< number of nodes above which demands are only calculated for a sample of that many destinations at a time; 0 to always be exact
 
 	inline DistributionType GetDistributionType(CargoID cargo) const {
 		if (IsCargoInClass(cargo, CC_PASSENGERS)) return this->distribution_pax;
@@ -56,5 +56,6 @@ struct Ship FINAL : public SpecializedVehicle<Ship, VEH_SHIP> {
 };
 
 bool IsShipDestinationTile(TileIndex tile, StationID station);
+void HandleShipPathRequests();
 
 #endif /* SHIP_H */
@@ -15,9 +15,13 @@
 #include "company_func.h"
 #include "pathfinder/npf/npf_func.h"
 #include "depot_base.h"
+#include "depot_func.h"
 #include "station_base.h"
 #include "newgrf_engine.h"
 #include "pathfinder/yapf/yapf.h"
+#include "pathfinder/follow_track.hpp"
+#include "pathfinder/water_regions.h"
+#include "pathfinder/pf_trace.h"
 #include "newgrf_sound.h"
 #include "spritecache.h"
 #include "strings_func.h"
@@ -32,8 +36,10 @@
 #include "tunnelbridge_map.h"
 #include "zoom_func.h"
 #include "framerate_type.h"
+#include "trace_zone.h"
 #include "industry.h"
 #include "industry_map.h"
+#include "worker_pool.h"
 
 #include "table/strings.h"
 
@@ -152,13 +158,12 @@ static const Depot *FindClosestShipDepot(const Vehicle *v, uint max_distance)
 	 * further away than max_distance can safely be ignored. */
 	uint best_dist = max_distance == 0 ? UINT_MAX : max_distance + 1;
 
-	for (const Depot *depot : Depot::Iterate()) {
-		TileIndex tile = depot->xy;
-		if (IsShipDepotTile(tile) && IsTileOwner(tile, v->owner)) {
+	for (TileIndex tile : GetDepotTiles(TRANSPORT_WATER)) {
+		if (IsTileOwner(tile, v->owner)) {
 			uint dist = DistanceManhattan(tile, v->tile);
 			if (dist < best_dist) {
 				best_dist = dist;
-				best_depot = depot;
+				best_depot = Depot::GetByTile(tile);
 			}
 		}
 	}
@@ -449,6 +454,115 @@ static void ShipArrivesAt(const Vehicle *v, Station *st)
 }
 
 
+/**
+ * Get the available water tracks on a tile for a ship entering a tile.
+ * @param tile The tile about to enter.
+ * @param dir The entry direction.
+ * @return The available trackbits on the next tile.
+ */
+static inline TrackBits GetAvailShipTracks(TileIndex tile, DiagDirection dir)
+{
+	TrackBits tracks = GetTileShipTrackStatus(tile) & DiagdirReachesTracks(dir);
+
+	return tracks;
+}
+
+/** Number of cached tiles left at which a ship searches the path behind its cached path. */
+static const uint SHIP_PATH_PREFETCH_TILES = 4;
+
+/** A search for the path behind the cached path of a ship. */
+struct ShipPathRequest {
+	VehicleID vehicle;       ///< The ship.
+	TileIndex tile;          ///< The tile the ship entered when the request was made.
+	Trackdir trackdir;       ///< The trackdir the ship took on \a tile.
+	TileIndex dest_tile;     ///< The destination of the ship when the request was made.
+	size_t path_size;        ///< The size of the path cache of the ship when the request was made.
+
+	/* Filled when the request is validated and searched. */
+	TileIndex next_tile;     ///< The tile at the end of the cached path.
+	DiagDirection enterdir;  ///< The direction the ship enters \a next_tile in.
+	TrackBits tracks;        ///< The available tracks on \a next_tile.
+	Trackdir last_trackdir;  ///< The trackdir of the last cached tile.
+	Trackdir result;         ///< The trackdir to take on \a next_tile.
+	bool path_found;         ///< Whether the search found a path.
+	ShipPathCache path;      ///< The path behind \a next_tile.
+
+	ShipPathRequest(VehicleID vehicle, TileIndex tile, Trackdir trackdir, TileIndex dest_tile, size_t path_size) :
+		vehicle(vehicle), tile(tile), trackdir(trackdir), dest_tile(dest_tile), path_size(path_size),
+		next_tile(INVALID_TILE), enterdir(INVALID_DIAGDIR), tracks(TRACK_BIT_NONE), last_trackdir(INVALID_TRACKDIR), result(INVALID_TRACKDIR), path_found(false) {}
+};
+
+static std::vector<ShipPathRequest> _ship_path_requests; ///< Ship path searches to run at the end of the vehicle ticks.
+
+/**
+ * Find the tile at the end of the cached path of a ship.
+ * @param v The ship.
+ * @param req The request to fill the end of the path of.
+ * @return Whether the end could be found; paths over bridges are not followed.
+ */
+static bool FindShipPathRequestEnd(const Ship *v, ShipPathRequest &req)
+{
+	CFollowTrackWater tf(v);
+	TileIndex tile = req.tile;
+	Trackdir trackdir = req.trackdir;
+	for (Trackdir next : v->path) {
+		if (!tf.Follow(tile, trackdir) || tf.m_tiles_skipped != 0) return false;
+		tile = tf.m_new_tile;
+		trackdir = next;
+	}
+	if (!tf.Follow(tile, trackdir) || tf.m_tiles_skipped != 0) return false;
+
+	req.next_tile = tf.m_new_tile;
+	req.enterdir = tf.m_exitdir;
+	req.tracks = GetAvailShipTracks(tf.m_new_tile, tf.m_exitdir);
+	req.last_trackdir = trackdir;
+	return req.tracks != TRACK_BIT_NONE;
+}
+
+/**
+ * Search the paths of the ships that asked for it during this tick, and
+ * append them to their path caches. The searches run on the worker threads;
+ * the results only depend on the game state, so they are the same for
+ * everyone in a network game and a saved path cache can be loaded as usual.
+ */
+void HandleShipPathRequests()
+{
+	if (_ship_path_requests.empty()) return;
+
+	/* Drop the requests of ships which changed their path since. */
+	auto last = std::remove_if(_ship_path_requests.begin(), _ship_path_requests.end(), [](ShipPathRequest &req) {
+		const Ship *v = Ship::GetIfValid(req.vehicle);
+		if (v == nullptr || v->dest_tile != req.dest_tile || v->path.size() != req.path_size) return true;
+		return !FindShipPathRequestEnd(v, req);
+	});
+	_ship_path_requests.erase(last, _ship_path_requests.end());
+
+	{
+		PerformanceAccumulator framerate(PFE_GL_YAPF_SHIPS);
+		TraceZone zone("Ship pathfinding requests");
+		SetWaterRegionsShared(true);
+		RunParallelFor((uint)_ship_path_requests.size(), 1, [](uint begin, uint end) {
+			for (uint i = begin; i < end; i++) {
+				ShipPathRequest &req = _ship_path_requests[i];
+				TraceZone request_zone("Ship pathfinding", req.vehicle);
+				req.path_found = true;
+				req.result = YapfShipChooseTrackAhead(Ship::Get(req.vehicle), req.next_tile, req.enterdir, req.tracks, req.last_trackdir, req.path_found, req.path);
+			}
+		});
+		SetWaterRegionsShared(false);
+	}
+
+	for (ShipPathRequest &req : _ship_path_requests) {
+		if (req.result == INVALID_TRACKDIR) continue;
+
+		Ship *v = Ship::Get(req.vehicle);
+		v->path.push_back(req.result);
+		v->path.insert(v->path.end(), req.path.begin(), req.path.end());
+		v->HandlePathfindingResult(req.path_found);
+	}
+	_ship_path_requests.clear();
+}
+
 /**
  * Runs the pathfinder to choose a track to continue along.
  *
@@ -477,7 +591,14 @@ static Track ChooseShipTrack(Ship *v, TileIndex tile, DiagDirection enterdir, Tr
 			track = TrackdirToTrack(v->path.front());
 
 			if (HasBit(tracks, track)) {
+				Trackdir trackdir = v->path.front();
 				v->path.pop_front();
+
+				/* Search the path behind the cached path before the ship gets there. */
+				if (v->path.size() == SHIP_PATH_PREFETCH_TILES && _settings_game.pf.yapf.ship_path_prefetch && _settings_game.pf.pathfinder_for_ships == VPF_YAPF) {
+					_ship_path_requests.emplace_back(v->index, tile, trackdir, v->dest_tile, v->path.size());
+				}
+
 				/* HandlePathfindResult() is not called here because this is not a new pathfinder result. */
 				return track;
 			}
@@ -486,30 +607,19 @@ static Track ChooseShipTrack(Ship *v, TileIndex tile, DiagDirection enterdir, Tr
 			v->path.clear();
 		}
 
+		PfTraceRequest trace(v, tile, enterdir);
 		switch (_settings_game.pf.pathfinder_for_ships) {
 			case VPF_NPF: track = NPFShipChooseTrack(v, path_found); break;
 			case VPF_YAPF: track = YapfShipChooseTrack(v, tile, enterdir, tracks, path_found, v->path); break;
 			default: NOT_REACHED();
 		}
+		trace.Finish(track, path_found);
 	}
 
 	v->HandlePathfindingResult(path_found);
 	return track;
 }
 
-/**
- * Get the available water tracks on a tile for a ship entering a tile.
- * @param tile The tile about to enter.
- * @param dir The entry direction.
- * @return The available trackbits on the next tile.
- */
-static inline TrackBits GetAvailShipTracks(TileIndex tile, DiagDirection dir)
-{
-	TrackBits tracks = GetTileShipTrackStatus(tile) & DiagdirReachesTracks(dir);
-
-	return tracks;
-}
-
 static const byte _ship_subcoord[4][6][3] = {
 	{
 		{15, 8, 1},
@@ -797,7 +907,7 @@ reverse_direction:
 
 bool Ship::Tick()
 {
-	PerformanceAccumulator framerate(PFE_GL_SHIPS);
+	PerformanceAccumulator framerate(PFE_GL_SHIPS, this->index);
 
 	if (!(this->vehstatus & VS_STOPPED)) this->running_ticks++;
 
@@ -16,16 +16,11 @@
 #include "train.h"
 #include "company_base.h"
 
-#include "safeguards.h"
-
+#include <unordered_map>
+#include <vector>
 
-/** these are the maximums used for updating signal blocks */
-static const uint SIG_TBU_SIZE    =  64; ///< number of signals entering to block
-static const uint SIG_TBD_SIZE    = 256; ///< number of intersections - open nodes in current block
-static const uint SIG_GLOB_SIZE   = 128; ///< number of open blocks (block can be opened more times until detected)
-static const uint SIG_GLOB_UPDATE =  64; ///< how many items need to be in _globset to force update
+#include "safeguards.h"
 
-assert_compile(SIG_GLOB_UPDATE <= SIG_GLOB_SIZE);
 
 /** incidating trackbits with given enterdir */
 static const TrackBits _enterdir_to_trackbits[DIAGDIR_END] = {
@@ -44,87 +39,70 @@ static const TrackdirBits _enterdir_to_trackdirbits[DIAGDIR_END] = {
 };
 
 /**
- * Set containing 'items' items of 'tile and Tdir'
- * No tree structure is used because it would cause
- * slowdowns in most usual cases
+ * Set of 'tile and Tdir' items that grows as needed.
+ * Items are taken out again in reverse order of adding; an index of the
+ * items makes finding and removing them independent of the size of the set.
  */
-template <typename Tdir, uint items>
-struct SmallSet {
+template <typename Tdir>
+struct SignalSet {
 private:
-	uint n;           // actual number of units
-	bool overflowed;  // did we try to overflow the set?
-	const char *name; // name, used for debugging purposes...
-
 	/** Element of set */
 	struct SSdata {
 		TileIndex tile;
 		Tdir dir;
-	} data[items];
+	};
 
-public:
-	/** Constructor - just set default values and 'name' */
-	SmallSet(const char *name) : n(0), overflowed(false), name(name) { }
-
-	/** Reset variables to default values */
-	void Reset()
-	{
-		this->n = 0;
-		this->overflowed = false;
-	}
+	std::vector<SSdata> data;               ///< The items, the last one is taken out first.
+	std::unordered_map<uint64, uint> index; ///< Position of each item in #data.
 
 	/**
-	 * Returns value of 'overflowed'
-	 * @return did we try to overflow the set?
-	 */
-	bool Overflowed()
-	{
-		return this->overflowed;
-	}
-
-	/**
-	 * Checks for empty set
-	 * @return is the set empty?
+	 * Get the key of an item in the index.
+	 * @param tile tile
+	 * @param dir dir
+	 * @return the key
 	 */
-	bool IsEmpty()
+	static inline uint64 Key(TileIndex tile, Tdir dir)
 	{
-		return this->n == 0;
+		return ((uint64)tile << 8) | (byte)dir;
 	}
 
-	/**
-	 * Checks for full set
-	 * @return is the set full?
-	 */
-	bool IsFull()
+public:
+	/** Remove all items, but keep the memory for the next run */
+	void Reset()
 	{
-		return this->n == lengthof(data);
+		this->data.clear();
+		this->index.clear();
 	}
 
 	/**
-	 * Reads the number of items
-	 * @return current number of items
+	 * Checks for empty set
+	 * @return is the set empty?
 	 */
-	uint Items()
+	bool IsEmpty() const
 	{
-		return this->n;
+		return this->data.empty();
 	}
 
-
 	/**
-	 * Tries to remove first instance of given tile and dir
+	 * Tries to remove given tile and dir
 	 * @param tile tile
 	 * @param dir and dir to remove
 	 * @return element was found and removed
 	 */
 	bool Remove(TileIndex tile, Tdir dir)
 	{
-		for (uint i = 0; i < this->n; i++) {
-			if (this->data[i].tile == tile && this->data[i].dir == dir) {
-				this->data[i] = this->data[--this->n];
-				return true;
-			}
+		auto it = this->index.find(Key(tile, dir));
+		if (it == this->index.end()) return false;
+
+		uint pos = it->second;
+		this->index.erase(it);
+		if (pos != this->data.size() - 1) {
+			this->data[pos] = this->data.back();
+			this->index[Key(this->data[pos].tile, this->data[pos].dir)] = pos;
 		}
+		this->data.pop_back();
 
-		return false;
+		return true;
 	}
 
 	/**
@@ -133,35 +111,21 @@ public:
 	 * @param dir and dir to find
 	 * @return true iff the tile & dir element was found
 	 */
-	bool IsIn(TileIndex tile, Tdir dir)
+	bool IsIn(TileIndex tile, Tdir dir) const
 	{
-		for (uint i = 0; i < this->n; i++) {
-			if (this->data[i].tile == tile && this->data[i].dir == dir) return true;
-		}
-
-		return false;
+		return this->index.find(Key(tile, dir)) != this->index.end();
 	}
 
 	/**
-	 * Adds tile & dir into the set, checks for full set
-	 * Sets the 'overflowed' flag if the set was full
+	 * Adds tile & dir into the set, unless it is in the set already
 	 * @param tile tile
 	 * @param dir and dir to add
-	 * @return true iff the item could be added (set wasn't full)
 	 */
-	bool Add(TileIndex tile, Tdir dir)
+	void Add(TileIndex tile, Tdir dir)
 	{
-		if (this->IsFull()) {
-			overflowed = true;
-			DEBUG(misc, 0, "SignalSegment too complex. Set %s is full (maximum %d)", name, items);
-			return false; // set is full
-		}
-
-		this->data[this->n].tile = tile;
-		this->data[this->n].dir = dir;
-		this->n++;
+		if (!this->index.emplace(Key(tile, dir), (uint)this->data.size()).second) return;
 
-		return true;
+		this->data.push_back({tile, dir});
 	}
 
 	/**
@@ -172,19 +136,20 @@ public:
 	 */
 	bool Get(TileIndex *tile, Tdir *dir)
 	{
-		if (this->n == 0) return false;
+		if (this->data.empty()) return false;
 
-		this->n--;
-		*tile = this->data[this->n].tile;
-		*dir = this->data[this->n].dir;
+		*tile = this->data.back().tile;
+		*dir = this->data.back().dir;
+		this->index.erase(Key(*tile, *dir));
+		this->data.pop_back();
 
 		return true;
 	}
 };
 
-static SmallSet<Trackdir, SIG_TBU_SIZE> _tbuset("_tbuset");         ///< set of signals that will be updated
-static SmallSet<DiagDirection, SIG_TBD_SIZE> _tbdset("_tbdset");    ///< set of open nodes in current signal block
-static SmallSet<DiagDirection, SIG_GLOB_SIZE> _globset("_globset"); ///< set of places to be updated in following runs
+static SignalSet<Trackdir> _tbuset;      ///< set of signals that will be updated
+static SignalSet<DiagDirection> _tbdset; ///< set of open nodes in current signal block
+static SignalSet<DiagDirection> _globset; ///< set of places to be updated in following runs
 
 
 /** Check whether there is a train on rail, not in a depot */
@@ -195,6 +160,17 @@ static Vehicle *TrainOnTileEnum(Vehicle *v, void *)
 	return v;
 }
 
+/**
+ * Check whether there is a train on rail, not in a depot, on a tile.
+ * Looking at the train counts first skips the vehicle hash for most tiles.
+ * @param tile The tile to check.
+ * @return True if there is such a train.
+ */
+static inline bool IsTrainOnTile(TileIndex tile)
+{
+	return HasTrainOnTile(tile) && HasVehicleOnPos(tile, nullptr, &TrainOnTileEnum);
+}
+
 
 /**
  * Perform some operations before adding data into Todo set
@@ -233,13 +209,10 @@ static inline bool CheckAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t
  * @param d1 direction (tile side) we are entering
  * @param t2 tile we are leaving
  * @param d2 direction (tile side) we are leaving
- * @return false iff the Todo buffer would be overrun
  */
-static inline bool MaybeAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2)
+static inline void MaybeAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2)
 {
-	if (!CheckAddToTodoSet(t1, d1, t2, d2)) return true;
-
-	return _tbdset.Add(t1, d1);
+	if (CheckAddToTodoSet(t1, d1, t2, d2)) _tbdset.Add(t1, d1);
 }
 
 
@@ -251,8 +224,7 @@ enum SigFlags {
 	SF_EXIT2  = 1 << 2, ///< two or more exits found
 	SF_GREEN  = 1 << 3, ///< green exitsignal found
 	SF_GREEN2 = 1 << 4, ///< two or more green exits found
-	SF_FULL   = 1 << 5, ///< some of buffers was full, do not continue
-	SF_PBS    = 1 << 6, ///< pbs signal found
+	SF_PBS    = 1 << 5, ///< pbs signal found
 };
 
 DECLARE_ENUM_AS_BIT_SET(SigFlags)
@@ -281,13 +253,13 @@ static SigFlags ExploreSegment(Owner owner)
 
 				if (IsRailDepot(tile)) {
 					if (enterdir == INVALID_DIAGDIR) { // from 'inside' - train just entered or left the depot
-						if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, nullptr, &TrainOnTileEnum)) flags |= SF_TRAIN;
+						if (!(flags & SF_TRAIN) && IsTrainOnTile(tile)) flags |= SF_TRAIN;
 						exitdir = GetRailDepotDirection(tile);
 						tile += TileOffsByDiagDir(exitdir);
 						enterdir = ReverseDiagDir(exitdir);
 						break;
 					} else if (enterdir == GetRailDepotDirection(tile)) { // entered a depot
-						if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, nullptr, &TrainOnTileEnum)) flags |= SF_TRAIN;
+						if (!(flags & SF_TRAIN) && IsTrainOnTile(tile)) flags |= SF_TRAIN;
 						continue;
 					} else {
 						continue;
@@ -301,10 +273,10 @@ static SigFlags ExploreSegment(Owner owner)
 				if (tracks == TRACK_BIT_HORZ || tracks == TRACK_BIT_VERT) { // there is exactly one incidating track, no need to check
 					tracks = tracks_masked;
 					/* If no train detected yet, and there is not no train -> there is a train -> set the flag */
-					if (!(flags & SF_TRAIN) && EnsureNoTrainOnTrackBits(tile, tracks).Failed()) flags |= SF_TRAIN;
+					if (!(flags & SF_TRAIN) && HasTrainOnTile(tile) && EnsureNoTrainOnTrackBits(tile, tracks).Failed()) flags |= SF_TRAIN;
 				} else {
 					if (tracks_masked == TRACK_BIT_NONE) continue; // no incidating track
-					if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, nullptr, &TrainOnTileEnum)) flags |= SF_TRAIN;
+					if (!(flags & SF_TRAIN) && IsTrainOnTile(tile)) flags |= SF_TRAIN;
 				}
 
 				if (HasSignals(tile)) { // there is exactly one track - not zero, because there is exit from this tile
@@ -319,8 +291,8 @@ static SigFlags ExploreSegment(Owner owner)
 						if (HasSignalOnTrackdir(tile, reversedir)) {
 							if (IsPbsSignal(sig)) {
 								flags |= SF_PBS;
-							} else if (!_tbuset.Add(tile, reversedir)) {
-								return flags | SF_FULL;
+							} else {
+								_tbuset.Add(tile, reversedir);
 							}
 						}
 						if (HasSignalOnTrackdir(tile, trackdir) && !IsOnewaySignal(tile, track)) flags |= SF_PBS;
@@ -343,7 +315,7 @@ static SigFlags ExploreSegment(Owner owner)
 					if (dir != enterdir && (tracks & _enterdir_to_trackbits[dir])) { // any track incidating?
 						TileIndex newtile = tile + TileOffsByDiagDir(dir);  // new tile to check
 						DiagDirection newdir = ReverseDiagDir(dir); // direction we are entering from
-						if (!MaybeAddToTodoSet(newtile, newdir, tile, dir)) return flags | SF_FULL;
+						MaybeAddToTodoSet(newtile, newdir, tile, dir);
 					}
 				}
 
@@ -356,7 +328,7 @@ static SigFlags ExploreSegment(Owner owner)
 				if (DiagDirToAxis(enterdir) != GetRailStationAxis(tile)) continue; // different axis
 				if (IsStationTileBlocked(tile)) continue; // 'eye-candy' station tile
 
-				if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, nullptr, &TrainOnTileEnum)) flags |= SF_TRAIN;
+				if (!(flags & SF_TRAIN) && IsTrainOnTile(tile)) flags |= SF_TRAIN;
 				tile += TileOffsByDiagDir(exitdir);
 				break;
 
@@ -365,7 +337,7 @@ static SigFlags ExploreSegment(Owner owner)
 				if (GetTileOwner(tile) != owner) continue;
 				if (DiagDirToAxis(enterdir) == GetCrossingRoadAxis(tile)) continue; // different axis
 
-				if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, nullptr, &TrainOnTileEnum)) flags |= SF_TRAIN;
+				if (!(flags & SF_TRAIN) && IsTrainOnTile(tile)) flags |= SF_TRAIN;
 				tile += TileOffsByDiagDir(exitdir);
 				break;
 
@@ -375,13 +347,13 @@ static SigFlags ExploreSegment(Owner owner)
 				DiagDirection dir = GetTunnelBridgeDirection(tile);
 
 				if (enterdir == INVALID_DIAGDIR) { // incoming from the wormhole
-					if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, nullptr, &TrainOnTileEnum)) flags |= SF_TRAIN;
+					if (!(flags & SF_TRAIN) && IsTrainOnTile(tile)) flags |= SF_TRAIN;
 					enterdir = dir;
 					exitdir = ReverseDiagDir(dir);
 					tile += TileOffsByDiagDir(exitdir); // just skip to next tile
 				} else { // NOT incoming from the wormhole!
 					if (ReverseDiagDir(enterdir) != dir) continue;
-					if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, nullptr, &TrainOnTileEnum)) flags |= SF_TRAIN;
+					if (!(flags & SF_TRAIN) && IsTrainOnTile(tile)) flags |= SF_TRAIN;
 					tile = GetOtherTunnelBridgeEnd(tile); // just skip to exit tile
 					enterdir = INVALID_DIAGDIR;
 					exitdir = INVALID_DIAGDIR;
@@ -393,7 +365,7 @@ static SigFlags ExploreSegment(Owner owner)
 				continue; // continue the while() loop
 		}
 
-		if (!MaybeAddToTodoSet(tile, enterdir, oldtile, exitdir)) return flags | SF_FULL;
+		MaybeAddToTodoSet(tile, enterdir, oldtile, exitdir);
 	}
 
 	return flags;
@@ -441,7 +413,7 @@ static void UpdateSignalsAroundSegment(SigFlags flags)
 			if (IsPresignalExit(tile, TrackdirToTrack(trackdir))) {
 				/* for pre-signal exits, add block to the global set */
 				DiagDirection exitdir = TrackdirToExitdir(ReverseTrackdir(trackdir));
-				_globset.Add(tile, exitdir); // do not check for full global set, first update all signals
+				_globset.Add(tile, exitdir);
 			}
 			SetSignalStateByTrackdir(tile, trackdir, newstate);
 			MarkTileDirtyByTile(tile);
@@ -451,15 +423,6 @@ static void UpdateSignalsAroundSegment(SigFlags flags)
 }
 
 
-/** Reset all sets after one set overflowed */
-static inline void ResetSets()
-{
-	_tbuset.Reset();
-	_tbdset.Reset();
-	_globset.Reset();
-}
-
-
 /**
  * Updates blocks in _globset buffer
  *
@@ -526,7 +489,6 @@ static SigSegState UpdateSignalsInBuffer(Owner owner)
 				continue; // continue the while() loop
 		}
 
-		assert(!_tbdset.Overflowed()); // it really shouldn't overflow by these one or two items
 		assert(!_tbdset.IsEmpty()); // it wouldn't hurt anyone, but shouldn't happen too
 
 		SigFlags flags = ExploreSegment(owner);
@@ -536,17 +498,11 @@ static SigSegState UpdateSignalsInBuffer(Owner owner)
 			/* SIGSEG_FREE is set by default */
 			if (flags & SF_PBS) {
 				state = SIGSEG_PBS;
-			} else if ((flags & SF_TRAIN) || ((flags & SF_EXIT) && !(flags & SF_GREEN)) || (flags & SF_FULL)) {
+			} else if ((flags & SF_TRAIN) || ((flags & SF_EXIT) && !(flags & SF_GREEN))) {
 				state = SIGSEG_FULL;
 			}
 		}
 
-		/* do not do anything when some buffer was full */
-		if (flags & SF_FULL) {
-			ResetSets(); // free all sets
-			break;
-		}
-
 		UpdateSignalsAroundSegment(flags);
 	}
 
@@ -593,12 +549,6 @@ void AddTrackToSignalBuffer(TileIndex tile, Track track, Owner owner)
 
 	_globset.Add(tile, _search_dir_1[track]);
 	_globset.Add(tile, _search_dir_2[track]);
-
-	if (_globset.Items() >= SIG_GLOB_UPDATE) {
-		/* too many items, force update */
-		UpdateSignalsInBuffer(_last_owner);
-		_last_owner = INVALID_OWNER;
-	}
 }
 
 
@@ -617,12 +567,6 @@ void AddSideToSignalBuffer(TileIndex tile, DiagDirection side, Owner owner)
 	_last_owner = owner;
 
 	_globset.Add(tile, side);
-
-	if (_globset.Items() >= SIG_GLOB_UPDATE) {
-		/* too many items, force update */
-		UpdateSignalsInBuffer(_last_owner);
-		_last_owner = INVALID_OWNER;
-	}
 }
 
 /**
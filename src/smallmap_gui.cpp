@@ -22,6 +22,7 @@
 #include "window_func.h"
 #include "company_base.h"
 #include "guitimer_func.h"
+#include "worker_pool.h"
 
 #include "smallmap_gui.h"
 
@@ -40,6 +41,10 @@ static uint8 _linkstat_colours_in_legenda[] = {0, 1, 3, 5, 7, 9, 11};
 
 static const int NUM_NO_COMPANY_ENTRIES = 4; ///< Number of entries in the owner legend that are not companies.
 
+static const uint SMALLMAP_DIRTY_BLOCK_SHIFT = 4;   ///< Log2 of the number of tiles along each side of a block of tiles whose change is tracked for the smallmap.
+static std::vector<bool> _smallmap_dirty_blocks;    ///< Blocks of tiles that changed since the smallmap was last drawn; empty while there is no smallmap.
+static std::vector<uint> _smallmap_dirty_block_list; ///< Indices of the blocks set in #_smallmap_dirty_blocks.
+
 /** Macro for ordinary entry of LegendAndColour */
 #define MK(a, b) {a, b, INVALID_INDUSTRYTYPE, 0, INVALID_COMPANY, true, false, false}
 
@@ -736,9 +741,10 @@ void SmallMapWindow::SetZoomLevel(ZoomLevelChange change, const Point *zoom_pt)
 /**
  * Decide which colours to show to the user for a group of tiles.
  * @param ta Tile area to investigate.
+ * @param map_type The type of map to show.
  * @return Colours to display.
  */
-inline uint32 SmallMapWindow::GetTileColours(const TileArea &ta) const
+/* static */ inline uint32 SmallMapWindow::GetTileColours(const TileArea &ta, SmallMapType map_type)
 {
 	int importance = 0;
 	TileIndex tile = INVALID_TILE; // Position of the most important tile.
@@ -761,7 +767,7 @@ inline uint32 SmallMapWindow::GetTileColours(const TileArea &ta) const
 
 			case MP_INDUSTRY:
 				/* Special handling of industries while in "Industries" smallmap view. */
-				if (this->map_type == SMT_INDUSTRY) {
+				if (map_type == SMT_INDUSTRY) {
 					/* If industry is allowed to be seen, use its colour on the map.
 					 * This has the highest priority above any value in _tiletype_importance. */
 					IndustryType type = Industry::GetByTile(ti)->type;
@@ -788,7 +794,7 @@ inline uint32 SmallMapWindow::GetTileColours(const TileArea &ta) const
 		}
 	}
 
-	switch (this->map_type) {
+	switch (map_type) {
 		case SMT_CONTOUR:
 			return GetSmallMapContoursPixels(tile, et);
 
@@ -814,6 +820,163 @@ inline uint32 SmallMapWindow::GetTileColours(const TileArea &ta) const
 	}
 }
 
+/** Forget all cached colours, for example because the colours of the displayed map type have changed. */
+void SmallMapWindow::InvalidateColourCache()
+{
+	this->colour_cache.zoom = 0;
+}
+
+/**
+ * Determine the colours of all groups of tiles of a chunk of the colour cache.
+ * Chunks of different groups can be updated at the same time.
+ * @param chunk Index of the chunk to update.
+ */
+void SmallMapWindow::UpdateColourCacheChunk(uint chunk) const
+{
+	const ColourCache &cache = this->colour_cache;
+	std::vector<uint32> &colours = this->colour_cache.chunks[chunk];
+	colours.resize(ColourCache::CHUNK_SIZE * ColourCache::CHUNK_SIZE);
+
+	uint min_xy = _settings_game.construction.freeform_edges ? 1 : 0;
+	uint first_x = (chunk % cache.chunks_x) * ColourCache::CHUNK_SIZE;
+	uint first_y = (chunk / cache.chunks_x) * ColourCache::CHUNK_SIZE;
+	uint last_x = min(first_x + ColourCache::CHUNK_SIZE, cache.size_x);
+	uint last_y = min(first_y + ColourCache::CHUNK_SIZE, cache.size_y);
+
+	for (uint gy = first_y; gy < last_y; gy++) {
+		for (uint gx = first_x; gx < last_x; gx++) {
+			uint xc = cache.origin_x + gx * cache.zoom;
+			uint yc = cache.origin_y + gy * cache.zoom;
+
+			/* Construct tilearea covered by (xc, yc, xc + this->zoom, yc + this->zoom) such that it is within min_xy limits. */
+			TileArea ta;
+			if (min_xy == 1 && (xc == 0 || yc == 0)) {
+				if (cache.zoom == 1) continue; // The tile area is empty, it is never drawn.
+
+				ta = TileArea(TileXY(max(min_xy, xc), max(min_xy, yc)), cache.zoom - (xc == 0), cache.zoom - (yc == 0));
+			} else {
+				ta = TileArea(TileXY(xc, yc), cache.zoom, cache.zoom);
+			}
+			ta.ClampToMap(); // Clamp to map boundaries (may contain MP_VOID tiles!).
+
+			colours[(gy - first_y) * ColourCache::CHUNK_SIZE + (gx - first_x)] = GetTileColours(ta, this->map_type);
+		}
+	}
+	this->colour_cache.valid[chunk] = true;
+}
+
+/**
+ * Bring the colour cache up to date for drawing a part of the smallmap.
+ * Chunks whose tiles have changed are invalidated, and the invalid chunks
+ * that are shown in \a dpi are determined on the worker threads.
+ * @param dpi The part of the smallmap that is going to be drawn.
+ */
+void SmallMapWindow::UpdateColourCache(const DrawPixelInfo *dpi) const
+{
+	ColourCache &cache = this->colour_cache;
+
+	/* The groups start at the tile at the top-left corner, see DrawSmallMap. */
+	uint origin_x = ((this->scroll_x / (int)TILE_SIZE) % this->zoom + this->zoom) % this->zoom;
+	uint origin_y = ((this->scroll_y / (int)TILE_SIZE) % this->zoom + this->zoom) % this->zoom;
+	uint size_x = MapMaxX() > origin_x ? (MapMaxX() - 1 - origin_x) / this->zoom + 1 : 0;
+	uint size_y = MapMaxY() > origin_y ? (MapMaxY() - 1 - origin_y) / this->zoom + 1 : 0;
+
+	if (cache.zoom != this->zoom || cache.origin_x != origin_x || cache.origin_y != origin_y || cache.size_x != size_x || cache.size_y != size_y) {
+		cache.zoom = this->zoom;
+		cache.origin_x = origin_x;
+		cache.origin_y = origin_y;
+		cache.size_x = size_x;
+		cache.size_y = size_y;
+		cache.chunks_x = CeilDiv(size_x, ColourCache::CHUNK_SIZE);
+		uint chunks = cache.chunks_x * CeilDiv(size_y, ColourCache::CHUNK_SIZE);
+		cache.chunks.clear();
+		cache.chunks.resize(chunks);
+		cache.valid.assign(chunks, false);
+	} else if (!cache.valid.empty()) {
+		/* Invalidate the chunks with groups on the changed blocks of tiles. */
+		for (uint block : _smallmap_dirty_block_list) {
+			int x = (block % (MapSizeX() >> SMALLMAP_DIRTY_BLOCK_SHIFT)) << SMALLMAP_DIRTY_BLOCK_SHIFT;
+			int y = (block / (MapSizeX() >> SMALLMAP_DIRTY_BLOCK_SHIFT)) << SMALLMAP_DIRTY_BLOCK_SHIFT;
+			int last_x = x + (1 << SMALLMAP_DIRTY_BLOCK_SHIFT) - 1 - (int)origin_x;
+			int last_y = y + (1 << SMALLMAP_DIRTY_BLOCK_SHIFT) - 1 - (int)origin_y;
+			if (last_x < 0 || last_y < 0) continue;
+
+			uint first_cx = max(0, x - (int)origin_x) / this->zoom / ColourCache::CHUNK_SIZE;
+			uint first_cy = max(0, y - (int)origin_y) / this->zoom / ColourCache::CHUNK_SIZE;
+			uint last_cx = min<uint>(last_x / this->zoom / ColourCache::CHUNK_SIZE, cache.chunks_x - 1);
+			uint last_cy = min<uint>(last_y / this->zoom / ColourCache::CHUNK_SIZE, cache.valid.size() / cache.chunks_x - 1);
+			for (uint cy = first_cy; cy <= last_cy; cy++) {
+				for (uint cx = first_cx; cx <= last_cx; cx++) {
+					cache.valid[cy * cache.chunks_x + cx] = false;
+				}
+			}
+		}
+	}
+	for (uint block : _smallmap_dirty_block_list) _smallmap_dirty_blocks[block] = false;
+	_smallmap_dirty_block_list.clear();
+
+	if (cache.valid.empty()) return;
+
+	/* Find the invalid chunks that are (partially) shown. */
+	static std::vector<uint> chunks_to_update;
+	chunks_to_update.clear();
+	int scroll_tile_x = this->scroll_x / (int)TILE_SIZE;
+	int scroll_tile_y = this->scroll_y / (int)TILE_SIZE;
+	int chunk_tiles = ColourCache::CHUNK_SIZE * this->zoom;
+	for (uint chunk = 0; chunk < cache.valid.size(); chunk++) {
+		if (cache.valid[chunk]) continue;
+
+		int tx = origin_x + (chunk % cache.chunks_x) * chunk_tiles;
+		int ty = origin_y + (chunk / cache.chunks_x) * chunk_tiles;
+		/* Screen positions of the corners of the chunk, relative to the position of the base tile; see RemapTile. */
+		int left   = (ty - (tx + chunk_tiles) - scroll_tile_y + scroll_tile_x) * 2 / this->zoom - this->subscroll - 8;
+		int right  = ((ty + chunk_tiles) - tx - scroll_tile_y + scroll_tile_x) * 2 / this->zoom - this->subscroll + 8;
+		int top    = (tx + ty - scroll_tile_x - scroll_tile_y) / this->zoom - 2;
+		int bottom = (tx + ty + 2 * chunk_tiles - scroll_tile_x - scroll_tile_y) / this->zoom + 2;
+		if (right < dpi->left || left >= dpi->left + dpi->width || bottom < dpi->top || top >= dpi->top + dpi->height) continue;
+
+		chunks_to_update.push_back(chunk);
+	}
+
+	RunParallelFor((uint)chunks_to_update.size(), 1, [this](uint begin, uint end) {
+		for (uint i = begin; i < end; i++) this->UpdateColourCacheChunk(chunks_to_update[i]);
+	});
+}
+
+/**
+ * Get the colours of a group of tiles from the colour cache.
+ * @param xc The X coordinate of the first tile of the group.
+ * @param yc The Y coordinate of the first tile of the group.
+ * @return Colours to display.
+ */
+inline uint32 SmallMapWindow::GetCachedTileColours(uint xc, uint yc) const
+{
+	const ColourCache &cache = this->colour_cache;
+	assert(cache.zoom == this->zoom && xc >= cache.origin_x && yc >= cache.origin_y);
+	uint gx = (xc - cache.origin_x) / cache.zoom;
+	uint gy = (yc - cache.origin_y) / cache.zoom;
+	uint chunk = (gy / ColourCache::CHUNK_SIZE) * cache.chunks_x + gx / ColourCache::CHUNK_SIZE;
+
+	/* Chunks just outside the part being drawn might not have been updated beforehand. */
+	if (!cache.valid[chunk]) this->UpdateColourCacheChunk(chunk);
+	return cache.chunks[chunk][(gy % ColourCache::CHUNK_SIZE) * ColourCache::CHUNK_SIZE + gx % ColourCache::CHUNK_SIZE];
+}
+
+/**
+ * Register a change of a tile, so the smallmap determines its colours again.
+ * @param tile The changed tile.
+ */
+void MarkSmallMapTileDirty(TileIndex tile)
+{
+	if (_smallmap_dirty_blocks.empty()) return;
+
+	uint block = (TileY(tile) >> SMALLMAP_DIRTY_BLOCK_SHIFT) * (MapSizeX() >> SMALLMAP_DIRTY_BLOCK_SHIFT) + (TileX(tile) >> SMALLMAP_DIRTY_BLOCK_SHIFT);
+	if (_smallmap_dirty_blocks[block]) return;
+
+	_smallmap_dirty_blocks[block] = true;
+	_smallmap_dirty_block_list.push_back(block);
+}
+
 /**
  * Draws one column of tiles of the small map in a certain mode onto the screen buffer, skipping the shifted rows in between.
  *
@@ -840,18 +1003,10 @@ void SmallMapWindow::DrawSmallMapColumn(void *dst, uint xc, uint yc, int pitch,
 		if (dst < _screen.dst_ptr) continue;
 		if (dst >= dst_ptr_abs_end) continue;
 
-		/* Construct tilearea covered by (xc, yc, xc + this->zoom, yc + this->zoom) such that it is within min_xy limits. */
-		TileArea ta;
-		if (min_xy == 1 && (xc == 0 || yc == 0)) {
-			if (this->zoom == 1) continue; // The tile area is empty, don't draw anything.
-
-			ta = TileArea(TileXY(max(min_xy, xc), max(min_xy, yc)), this->zoom - (xc == 0), this->zoom - (yc == 0));
-		} else {
-			ta = TileArea(TileXY(xc, yc), this->zoom, this->zoom);
-		}
-		ta.ClampToMap(); // Clamp to map boundaries (may contain MP_VOID tiles!).
+		/* The tile area is empty, don't draw anything. */
+		if (min_xy == 1 && (xc == 0 || yc == 0) && this->zoom == 1) continue;
 
-		uint32 val = this->GetTileColours(ta);
+		uint32 val = this->GetCachedTileColours(xc, yc);
 		uint8 *val8 = (uint8 *)&val;
 		int idx = max(0, -start_pos);
 		for (int pos = max(0, start_pos); pos < end_pos; pos++) {
@@ -968,6 +1123,8 @@ void SmallMapWindow::DrawSmallMap(DrawPixelInfo *dpi) const
 	old_dpi = _cur_dpi;
 	_cur_dpi = dpi;
 
+	this->UpdateColourCache(dpi);
+
 	/* Clear it */
 	GfxFillRect(dpi->left, dpi->top, dpi->left + dpi->width - 1, dpi->top + dpi->height - 1, PC_BLACK);
 
@@ -1069,6 +1226,9 @@ void SmallMapWindow::SetupWidgetData()
 SmallMapWindow::SmallMapWindow(WindowDesc *desc, int window_number) : Window(desc), refresh(GUITimer(FORCE_REFRESH_PERIOD))
 {
 	_smallmap_industry_highlight = INVALID_INDUSTRYTYPE;
+	_smallmap_dirty_blocks.assign((MapSizeX() >> SMALLMAP_DIRTY_BLOCK_SHIFT) * (MapSizeY() >> SMALLMAP_DIRTY_BLOCK_SHIFT), false);
+	_smallmap_dirty_block_list.clear();
+	this->InvalidateColourCache();
 	this->overlay = new LinkGraphOverlay(this, WID_SM_MAP, 0, this->GetOverlayCompanyMask(), 1);
 	this->InitNested(window_number);
 	this->LowerWidget(this->map_type + WID_SM_CONTOUR);
@@ -1088,6 +1248,9 @@ SmallMapWindow::SmallMapWindow(WindowDesc *desc, int window_number) : Window(des
 
 SmallMapWindow::~SmallMapWindow()
 {
+	_smallmap_dirty_blocks.clear();
+	_smallmap_dirty_blocks.shrink_to_fit();
+	_smallmap_dirty_block_list.clear();
 	delete this->overlay;
 	this->BreakIndustryChainLink();
 }
@@ -1095,7 +1258,7 @@ SmallMapWindow::~SmallMapWindow()
 /**
  * Rebuilds the colour indices used for fast access to the smallmap contour colours based on the heightlevel.
  */
-void SmallMapWindow::RebuildColourIndexIfNecessary()
+/* static */ void SmallMapWindow::RebuildColourIndexIfNecessary()
 {
 	/* Rebuild colour indices if necessary. */
 	if (SmallMapWindow::max_heightlevel == _settings_game.construction.max_heightlevel) return;
@@ -1117,6 +1280,61 @@ void SmallMapWindow::RebuildColourIndexIfNecessary()
 	BuildLandLegend();
 }
 
+/**
+ * Determine the colours of all tiles the way the smallmap shows them, for an image of the whole map.
+ * The tiles are spread over the worker threads, so the game is not held up long.
+ * @param type Name of the type of map: "contours", "vehicles", "industries", "routes", "vegetation" or "owners".
+ * @param[out] image Palette index of each tile, row by row, in the orientation of a minimap screenshot.
+ * @return False if the type of map is unknown.
+ */
+/* static */ bool SmallMapWindow::GetImage(const char *type, std::vector<byte> &image)
+{
+	static const struct {
+		const char *name;
+		SmallMapType map_type;
+	} map_types[] = {
+		{ "contours",   SMT_CONTOUR },
+		{ "vehicles",   SMT_VEHICLES },
+		{ "industries", SMT_INDUSTRY },
+		{ "routes",     SMT_ROUTES },
+		{ "vegetation", SMT_VEGETATION },
+		{ "owners",     SMT_OWNER },
+	};
+
+	uint i = 0;
+	while (i < lengthof(map_types) && strcmp(map_types[i].name, type) != 0) i++;
+	if (i == lengthof(map_types)) return false;
+	const SmallMapType map_type = map_types[i].map_type;
+
+	RebuildColourIndexIfNecessary();
+
+	const uint size_x = MapSizeX();
+	image.resize(MapSize());
+	RunParallelFor(MapSizeY(), 16, [&](uint begin, uint end) {
+		for (uint y = begin; y < end; y++) {
+			byte *row = image.data() + y * size_x;
+			for (uint x = 0; x < size_x; x++) {
+				uint32 colours = GetTileColours(TileArea(TileXY(x, y), 1, 1), map_type);
+				/* The smallmap shows four pixels per tile; pick them in turn, so things like roads remain visible. */
+				row[size_x - 1 - x] = ((const uint8 *)&colours)[(x + y) & 3];
+			}
+		}
+	});
+
+	if (map_type == SMT_VEHICLES) {
+		for (const Vehicle *v : Vehicle::Iterate()) {
+			if (v->type == VEH_EFFECT) continue;
+			if (v->vehstatus & (VS_HIDDEN | VS_UNCLICKABLE)) continue;
+
+			uint x = Clamp(v->x_pos / (int)TILE_SIZE, 0, (int)MapMaxX());
+			uint y = Clamp(v->y_pos / (int)TILE_SIZE, 0, (int)MapMaxY());
+			image[y * size_x + size_x - 1 - x] = _vehicle_type_colours[v->type];
+		}
+	}
+
+	return true;
+}
+
 /* virtual */ void SmallMapWindow::SetStringParameters(int widget) const
 {
 	switch (widget) {
@@ -1297,6 +1515,7 @@ void SmallMapWindow::SwitchMapType(SmallMapType map_type)
 	this->RaiseWidget(this->map_type + WID_SM_CONTOUR);
 	this->map_type = map_type;
 	this->LowerWidget(this->map_type + WID_SM_CONTOUR);
+	this->InvalidateColourCache();
 
 	this->SetupWidgetData();
 
@@ -1403,6 +1622,7 @@ int SmallMapWindow::GetPositionOnLegend(Point pt)
 		_smallmap_industry_highlight = new_highlight;
 		this->refresh.SetInterval(_smallmap_industry_highlight != INVALID_INDUSTRYTYPE ? BLINK_PERIOD : FORCE_REFRESH_PERIOD);
 		_smallmap_industry_highlight_state = true;
+		this->InvalidateColourCache();
 		this->SetDirty();
 	}
 }
@@ -1478,6 +1698,7 @@ int SmallMapWindow::GetPositionOnLegend(Point pt)
 						this->SelectLegendItem(click_pos, _legend_land_owners, _smallmap_company_count, NUM_NO_COMPANY_ENTRIES);
 					}
 				}
+				this->InvalidateColourCache();
 				this->SetDirty();
 			}
 			break;
@@ -1503,6 +1724,7 @@ int SmallMapWindow::GetPositionOnLegend(Point pt)
 				tbl->show_on_map = (widget == WID_SM_ENABLE_ALL);
 			}
 			if (this->map_type == SMT_LINKSTATS) this->SetOverlayCargoMask();
+			this->InvalidateColourCache();
 			this->SetDirty();
 			break;
 		}
@@ -1510,6 +1732,7 @@ int SmallMapWindow::GetPositionOnLegend(Point pt)
 		case WID_SM_SHOW_HEIGHT: // Enable/disable showing of heightmap.
 			_smallmap_show_heightmap = !_smallmap_show_heightmap;
 			this->SetWidgetLoweredState(WID_SM_SHOW_HEIGHT, _smallmap_show_heightmap);
+			this->InvalidateColourCache();
 			this->SetDirty();
 			break;
 	}
@@ -1521,6 +1744,7 @@ int SmallMapWindow::GetPositionOnLegend(Point pt)
  * - data = 0: Displayed industries at the industry chain window have changed.
  * - data = 1: Companies have changed.
  * - data = 2: Cheat changing the maximum heightlevel has been used, rebuild our heightlevel-to-colour index
+ * - data = 3: The colour scheme has changed.
  * @param gui_scope Whether the call is done from GUI scope. You may not do everything when not in GUI scope. See #InvalidateWindowData() for details.
  */
 /* virtual */ void SmallMapWindow::OnInvalidateData(int data, bool gui_scope)
@@ -1547,8 +1771,12 @@ int SmallMapWindow::GetPositionOnLegend(Point pt)
 			this->RebuildColourIndexIfNecessary();
 			break;
 
+		case 3:
+			break;
+
 		default: NOT_REACHED();
 	}
+	this->InvalidateColourCache();
 	this->SetDirty();
 }
 
@@ -1587,6 +1815,7 @@ int SmallMapWindow::GetPositionOnLegend(Point pt)
 		}
 	}
 	_smallmap_industry_highlight_state = !_smallmap_industry_highlight_state;
+	if (_smallmap_industry_highlight != INVALID_INDUSTRYTYPE) this->InvalidateColourCache();
 
 	this->refresh.SetInterval(_smallmap_industry_highlight != INVALID_INDUSTRYTYPE ? BLINK_PERIOD : FORCE_REFRESH_PERIOD);
 	this->SetDirty();
@@ -1626,7 +1855,7 @@ void SmallMapWindow::SetNewScroll(int sx, int sy, int sub)
 	this->scroll_x = sx;
 	this->scroll_y = sy;
 	this->subscroll = sub;
-	if (this->map_type == SMT_LINKSTATS) this->overlay->SetDirty();
+	if (this->map_type == SMT_LINKSTATS) this->overlay->SetViewDirty();
 }
 
 /* virtual */ void SmallMapWindow::OnScroll(Point delta)
@@ -26,6 +26,7 @@ void BuildIndustriesLegend();
 void ShowSmallMap();
 void BuildLandLegend();
 void BuildOwnerLegend();
+void MarkSmallMapTileDirty(TileIndex tile);
 
 /** Structure for holding relevant data for legends in small map */
 struct LegendAndColour {
@@ -81,6 +82,24 @@ protected:
 	GUITimer refresh; ///< Refresh timer.
 	LinkGraphOverlay *overlay;
 
+	/**
+	 * Colours of the groups of #zoom by #zoom tiles that are drawn as one in the displayed map type.
+	 * They are determined per chunk of groups, only when the chunk is first shown or when its tiles have changed.
+	 */
+	struct ColourCache {
+		static const uint CHUNK_SIZE = 16; ///< Number of groups along each side of a chunk.
+
+		int zoom;                                 ///< Zoom level of the cached colours; 0 when nothing is cached.
+		uint origin_x;                            ///< X coordinate of the first tile of each group, modulo #zoom.
+		uint origin_y;                            ///< Y coordinate of the first tile of each group, modulo #zoom.
+		uint size_x;                              ///< Number of groups along the X axis.
+		uint size_y;                              ///< Number of groups along the Y axis.
+		uint chunks_x;                            ///< Number of chunks along the X axis.
+		std::vector<std::vector<uint32>> chunks;  ///< Colours of the groups of each chunk; empty for chunks that were never shown.
+		std::vector<byte> valid;                  ///< Whether the colours of each chunk are up to date.
+	};
+	mutable ColourCache colour_cache; ///< Cached colours of the displayed map type.
+
 	static void BreakIndustryChainLink();
 	Point SmallmapRemapCoords(int x, int y) const;
 
@@ -147,7 +166,7 @@ protected:
 		return Company::IsValidID(_local_company) ? 1U << _local_company : 0xffffffff;
 	}
 
-	void RebuildColourIndexIfNecessary();
+	static void RebuildColourIndexIfNecessary();
 	uint GetNumberRowsLegend(uint columns) const;
 	void SelectLegendItem(int click_pos, LegendAndColour *legend, int end_legend_item, int begin_legend_item = 0);
 	void SwitchMapType(SmallMapType map_type);
@@ -165,7 +184,11 @@ protected:
 	void SetZoomLevel(ZoomLevelChange change, const Point *zoom_pt);
 	void SetOverlayCargoMask();
 	void SetupWidgetData();
-	uint32 GetTileColours(const TileArea &ta) const;
+	static uint32 GetTileColours(const TileArea &ta, SmallMapType map_type);
+	void InvalidateColourCache();
+	void UpdateColourCacheChunk(uint chunk) const;
+	void UpdateColourCache(const DrawPixelInfo *dpi) const;
+	uint32 GetCachedTileColours(uint xc, uint yc) const;
 
 	int GetPositionOnLegend(Point pt);
 
@@ -175,6 +198,8 @@ public:
 	SmallMapWindow(WindowDesc *desc, int window_number);
 	virtual ~SmallMapWindow();
 
+	static bool GetImage(const char *type, std::vector<byte> &image);
+
 	void SmallMapCenterOnCurrentPos();
 	Point GetStationMiddle(const Station *st) const;
 
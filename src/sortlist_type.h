@@ -243,8 +243,10 @@ public:
 	/**
 	 * Sort the list.
 	 *  For the first sorting we use quick sort since it is
-	 *  faster for irregular sorted data. After that we
-	 *  use gsort.
+	 *  faster for irregular sorted data. After that the
+	 *  list is usually almost sorted, so we insert the
+	 *  items that moved at their new place, unless too
+	 *  many of them moved.
 	 *
 	 * @param compare The function to compare two list items
 	 * @return true if the list sequence has been altered
@@ -263,16 +265,34 @@ public:
 		if (!this->IsSortable()) return false;
 
 		const bool desc = (this->flags & VL_DESC) != 0;
+		auto comp = [&](const T &a, const T &b) { return desc ? compare(b, a) : compare(a, b); };
+		const auto first = std::vector<T>::begin();
+		const auto last = std::vector<T>::end();
 
 		if (this->flags & VL_FIRST_SORT) {
 			CLRBITS(this->flags, VL_FIRST_SORT);
 
-			std::sort(std::vector<T>::begin(), std::vector<T>::end(), [&](const T &a, const T &b) { return desc ? compare(b, a) : compare(a, b); });
+			std::sort(first, last, comp);
 			return true;
 		}
 
-		std::sort(std::vector<T>::begin(), std::vector<T>::end(), [&](const T &a, const T &b) { return desc ? compare(b, a) : compare(a, b); });
-		return true;
+		/* Everything before 'it' is sorted; move each out of order item back to its place. */
+		const size_t max_moves = 8 * std::vector<T>::size();
+		size_t moves = 0;
+		for (auto it = first + 1; it < last; ++it) {
+			if (!comp(*it, *(it - 1))) continue;
+
+			auto pos = std::upper_bound(first, it, *it, comp);
+			moves += it - pos;
+			std::rotate(pos, it, it + 1);
+
+			if (moves > max_moves) {
+				/* Too much changed, do a full sort instead. */
+				std::sort(first, last, comp);
+				break;
+			}
+		}
+		return moves != 0;
 	}
 
 	/**
@@ -389,11 +409,13 @@ public:
 	 * Notify the sortlist that the rebuild is done
 	 *
 	 * @note This forces a resort
+	 * @param same_order Whether the rebuilt list kept the items of the old list in their sorted order, so only the changes have to be sorted.
 	 */
-	void RebuildDone()
+	void RebuildDone(bool same_order = false)
 	{
 		CLRBITS(this->flags, VL_REBUILD);
-		SETBITS(this->flags, VL_RESORT | VL_FIRST_SORT);
+		SETBITS(this->flags, VL_RESORT);
+		if (!same_order) SETBITS(this->flags, VL_FIRST_SORT);
 	}
 };
 
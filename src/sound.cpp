@@ -14,6 +14,7 @@
 #include "fios.h"
 #include "window_gui.h"
 #include "vehicle_base.h"
+#include "network/network.h"
 
 /* The type of set we're replacing */
 #define SET_TYPE "sounds"
@@ -157,7 +158,8 @@ void InitializeSound()
 /* Low level sound player */
 static void StartSound(SoundID sound_id, float pan, uint volume)
 {
-	if (volume == 0) return;
+	/* Sounds of the frames a joining client runs to catch up would all play at once. */
+	if (volume == 0 || _network_catching_up) return;
 
 	SoundEntry *sound = GetSound(sound_id);
 	if (sound == nullptr) return;
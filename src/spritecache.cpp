@@ -9,6 +9,7 @@
 
 #include "stdafx.h"
 #include "fileio_func.h"
+#include "fios.h"
 #include "spriteloader/grf.hpp"
 #include "gfx_func.h"
 #include "error.h"
@@ -17,6 +18,11 @@
 #include "blitter/factory.hpp"
 #include "core/math_func.hpp"
 #include "core/mem_func.hpp"
+#include "worker_pool.h"
+#include "string_func.h"
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
 
 #include "table/sprites.h"
 #include "table/strings.h"
@@ -26,16 +32,18 @@
 
 /* Default of 4MB spritecache */
 uint _sprite_cache_size = 4;
+bool _sprite_disk_cache = false; ///< Whether to store encoded sprites on disk, so they do not have to be encoded again.
 
 struct SpriteCache {
 	void *ptr;
 	size_t file_pos;
 	uint32 id;
 	uint16 file_slot;
-	int16 lru;
 	SpriteType type;     ///< In some cases a single sprite is misused by two NewGRFs. Once as real sprite and once as recolour sprite. If the recolour sprite gets into the cache it might be drawn as real sprite which causes enormous trouble.
 	bool warned;         ///< True iff the user has been warned about incorrect use of this sprite
 	byte container_ver;  ///< Container version of the GRF the sprite is from.
+	ZoomLevel zoom_min;  ///< Most zoomed in level that the cached sprite can be drawn at.
+	ZoomLevel zoom_max;  ///< Most zoomed out level that the cached sprite can be drawn at.
 };
 
 
@@ -72,17 +80,35 @@ static SpriteCache *AllocateSpriteCache(uint index)
 }
 
 
-struct MemBlock {
-	size_t size;
-	byte data[];
+/**
+ * Number of sprite cache size classes. The smallest class holds
+ * #SPRITE_CACHE_MIN_BLOCK bytes; above that there are four classes
+ * for each power of two, so at most a fifth of a block is unused.
+ */
+static const uint SPRITE_CACHE_SIZE_CLASSES = 4 * (sizeof(size_t) * 8 - 6) + 1;
+static const size_t SPRITE_CACHE_MIN_BLOCK = 64; ///< Size of the smallest size class.
+
+/** Header of a block of memory in the sprite cache. */
+struct SpriteCacheBlock {
+	SpriteCacheBlock *prev; ///< The more recently used block, or the next free block of the same size class.
+	SpriteCacheBlock *next; ///< The less recently used block.
+	SpriteID sprite;        ///< The sprite whose data is stored in this block.
+	uint16 size_class;      ///< The size class of this block.
+	bool in_lru;            ///< Whether the block is in the LRU list and thus may be evicted.
+	byte data[];            ///< The sprite data.
 };
 
-static uint _sprite_lru_counter;
-static MemBlock *_spritecache_ptr;
-static uint _allocated_sprite_cache_size = 0;
-static int _compact_cache_counter;
+/* Make sure the sprite data is aligned for the blitters. */
+assert_compile(sizeof(SpriteCacheBlock) % sizeof(size_t) == 0);
+
+static SpriteCacheBlock *_sprite_lru_head; ///< The most recently used block.
+static SpriteCacheBlock *_sprite_lru_tail; ///< The least recently used block; evicted first.
+static SpriteCacheBlock *_sprite_free_blocks[SPRITE_CACHE_SIZE_CLASSES]; ///< Unused blocks of each size class.
+static size_t _sprite_cache_budget;     ///< Number of bytes the sprite cache may use.
+static size_t _sprite_cache_used;       ///< Number of bytes in blocks that hold sprites.
+static size_t _sprite_cache_free;       ///< Number of bytes in unused blocks.
+static uint _sprite_cache_evictions; ///< Number of sprites removed from the cache to make room for other sprites.
 
-static void CompactSpriteCache();
 static void *AllocSprite(size_t mem_req);
 
 /**
@@ -252,39 +278,42 @@ static bool PadSingleSprite(SpriteLoader::Sprite *sprite, ZoomLevel zoom, uint p
 
 	if (width > UINT16_MAX || height > UINT16_MAX) return false;
 
-	/* Copy source data and reallocate sprite memory. */
-	SpriteLoader::CommonPixel *src_data = MallocT<SpriteLoader::CommonPixel>(sprite->width * sprite->height);
-	MemCpyT(src_data, sprite->data, sprite->width * sprite->height);
-	sprite->AllocateData(zoom, width * height);
-
-	/* Copy with padding to destination. */
-	SpriteLoader::CommonPixel *src = src_data;
-	SpriteLoader::CommonPixel *data = sprite->data;
-	for (uint y = 0; y < height; y++) {
-		if (y < pad_top || pad_bottom + y >= height) {
-			/* Top/bottom padding. */
-			MemSetT(data, 0, width);
-			data += width;
-		} else {
-			if (pad_left > 0) {
-				/* Pad left. */
-				MemSetT(data, 0, pad_left);
-				data += pad_left;
-			}
+	/* Sprites without data, which are only used for their size, need no copying. */
+	if (sprite->data != nullptr) {
+		/* Copy source data and reallocate sprite memory. */
+		SpriteLoader::CommonPixel *src_data = MallocT<SpriteLoader::CommonPixel>(sprite->width * sprite->height);
+		MemCpyT(src_data, sprite->data, sprite->width * sprite->height);
+		sprite->AllocateData(zoom, width * height);
+
+		/* Copy with padding to destination. */
+		SpriteLoader::CommonPixel *src = src_data;
+		SpriteLoader::CommonPixel *data = sprite->data;
+		for (uint y = 0; y < height; y++) {
+			if (y < pad_top || pad_bottom + y >= height) {
+				/* Top/bottom padding. */
+				MemSetT(data, 0, width);
+				data += width;
+			} else {
+				if (pad_left > 0) {
+					/* Pad left. */
+					MemSetT(data, 0, pad_left);
+					data += pad_left;
+				}
 
-			/* Copy pixels. */
-			MemCpyT(data, src, sprite->width);
-			src += sprite->width;
-			data += sprite->width;
+				/* Copy pixels. */
+				MemCpyT(data, src, sprite->width);
+				src += sprite->width;
+				data += sprite->width;
 
-			if (pad_right > 0) {
-				/* Pad right. */
-				MemSetT(data, 0, pad_right);
-				data += pad_right;
+				if (pad_right > 0) {
+					/* Pad right. */
+					MemSetT(data, 0, pad_right);
+					data += pad_right;
+				}
 			}
 		}
+		free(src_data);
 	}
-	free(src_data);
 
 	/* Update sprite size. */
 	sprite->width   = width;
@@ -336,20 +365,43 @@ static bool PadSprites(SpriteLoader::Sprite *sprite, uint8 sprite_avail)
 	return true;
 }
 
-static bool ResizeSprites(SpriteLoader::Sprite *sprite, uint8 sprite_avail, uint32 file_slot, uint32 file_pos)
+/**
+ * Create the zoom levels of a sprite that are needed for encoding it.
+ * The fully zoomed in level always gets the right size, but its data is only created when it is needed.
+ * @param sprite The sprite at all zoom levels.
+ * @param sprite_avail The zoom levels that were loaded.
+ * @param zoom_min Most zoomed in level whose data is needed.
+ * @param zoom_max Most zoomed out level whose data is needed.
+ * @return True if the zoom levels could be created.
+ */
+static bool ResizeSprites(SpriteLoader::Sprite *sprite, uint8 sprite_avail, ZoomLevel zoom_min, ZoomLevel zoom_max)
 {
-	/* Create a fully zoomed image if it does not exist */
+	/* Create the most zoomed in image that is needed if it does not exist */
 	ZoomLevel first_avail = static_cast<ZoomLevel>(FIND_FIRST_BIT(sprite_avail));
+	if (first_avail > zoom_min) {
+		if (!ResizeSpriteIn(sprite, first_avail, zoom_min)) return false;
+		SetBit(sprite_avail, zoom_min);
+		first_avail = zoom_min;
+	}
+
+	/* Without its data, the fully zoomed image still gives the size of the other zoom levels. */
 	if (first_avail != ZOOM_LVL_NORMAL) {
-		if (!ResizeSpriteIn(sprite, first_avail, ZOOM_LVL_NORMAL)) return false;
+		uint scaled_1 = ScaleByZoom(1, first_avail);
+		if (sprite[first_avail].width * scaled_1 > UINT16_MAX || sprite[first_avail].height * scaled_1 > UINT16_MAX) return false;
+
+		sprite[ZOOM_LVL_NORMAL].width  = sprite[first_avail].width  * scaled_1;
+		sprite[ZOOM_LVL_NORMAL].height = sprite[first_avail].height * scaled_1;
+		sprite[ZOOM_LVL_NORMAL].x_offs = sprite[first_avail].x_offs * scaled_1;
+		sprite[ZOOM_LVL_NORMAL].y_offs = sprite[first_avail].y_offs * scaled_1;
+		sprite[ZOOM_LVL_NORMAL].data   = nullptr;
 		SetBit(sprite_avail, ZOOM_LVL_NORMAL);
 	}
 
 	/* Pad sprites to make sizes match. */
 	if (!PadSprites(sprite, sprite_avail)) return false;
 
-	/* Create other missing zoom levels */
-	for (ZoomLevel zoom = ZOOM_LVL_OUT_2X; zoom != ZOOM_LVL_END; zoom++) {
+	/* Create other missing zoom levels that are needed */
+	for (ZoomLevel zoom = (ZoomLevel)(first_avail + 1); zoom <= zoom_max; zoom++) {
 		if (HasBit(sprite_avail, zoom)) {
 			/* Check that size and offsets match the fully zoomed image. */
 			assert(sprite[zoom].width  == UnScaleByZoom(sprite[ZOOM_LVL_NORMAL].width,  zoom));
@@ -398,15 +450,248 @@ static void *ReadRecolourSprite(uint16 file_slot, uint num)
 	return dest;
 }
 
+/** Sprites of one file slot that were encoded before, stored on disk. */
+struct SpriteDiskCache {
+	bool has_md5;                ///< Whether the MD5 sum of the file in the slot is known; without it there is no disk cache.
+	uint8 md5sum[16];            ///< MD5 sum of the file in the slot.
+	bool opened;                 ///< Whether an attempt to open the cache file was made.
+	FILE *file;                  ///< The cache file, or \c nullptr when it could not be opened.
+	uint32 end;                  ///< End of the last complete entry in the cache file.
+	std::unordered_map<uint64, std::pair<uint32, uint32>> index; ///< Offset and size of the data of the entries in the file, by #GetSpriteDiskCacheIndex.
+};
+
+static const char SPRITE_DISK_CACHE_MAGIC[8] = { 'O', 'T', 'T', 'D', 'S', 'P', 'R', 'C' }; ///< Start of a sprite disk cache file.
+static const uint32 SPRITE_DISK_CACHE_VERSION = 2; ///< Version of the format of the sprite disk cache files.
+
+char *_sprite_disk_cache_dir; ///< Directory for the sprite disk cache files.
+static SpriteDiskCache _sprite_disk_caches[MAX_FILE_SLOTS];
+static std::mutex _sprite_disk_cache_mutex; ///< Protects #_sprite_disk_caches, as sprites are also read on worker threads.
+
+/**
+ * Get what distinguishes the encodings of one sprite in the sprite disk cache.
+ * @param type Type of the sprite.
+ * @param zoom_min Most zoomed in level that was encoded.
+ * @param zoom_max Most zoomed out level that was encoded.
+ * @return The kind of the cache entry.
+ */
+static inline uint32 GetSpriteDiskCacheKind(SpriteType type, ZoomLevel zoom_min, ZoomLevel zoom_max)
+{
+	return type | zoom_min << 8 | zoom_max << 16;
+}
+
+static inline uint64 GetSpriteDiskCacheIndex(uint32 file_pos, uint32 kind)
+{
+	return ((uint64)file_pos << 32) | kind;
+}
+
+/**
+ * Close the sprite disk cache file of a slot.
+ * @param cache The disk cache of the slot.
+ */
+static void CloseSpriteDiskCache(SpriteDiskCache &cache)
+{
+	if (cache.file != nullptr) fclose(cache.file);
+	cache.file = nullptr;
+	cache.opened = false;
+	cache.index.clear();
+}
+
+/**
+ * Set the MD5 sum of the file in a slot, which identifies its sprites in the sprite disk cache.
+ * @param file_slot The slot.
+ * @param md5sum The MD5 sum, or \c nullptr when it is not known or the sprites of the file should not be cached.
+ */
+void SetSpriteDiskCacheKey(uint8 file_slot, const uint8 *md5sum)
+{
+	std::lock_guard<std::mutex> lock(_sprite_disk_cache_mutex);
+
+	SpriteDiskCache &cache = _sprite_disk_caches[file_slot];
+	if (md5sum != nullptr && cache.has_md5 && memcmp(cache.md5sum, md5sum, sizeof(cache.md5sum)) == 0) return;
+
+	CloseSpriteDiskCache(cache);
+	cache.has_md5 = md5sum != nullptr;
+	if (md5sum != nullptr) memcpy(cache.md5sum, md5sum, sizeof(cache.md5sum));
+}
+
+/**
+ * Close all sprite disk cache files, e.g. because the blitter changed,
+ * which changes the way sprites are encoded. They are reopened when needed.
+ */
+static void CloseSpriteDiskCaches()
+{
+	std::lock_guard<std::mutex> lock(_sprite_disk_cache_mutex);
+	for (SpriteDiskCache &cache : _sprite_disk_caches) CloseSpriteDiskCache(cache);
+}
+
+/**
+ * Get the disk cache of a slot, opening its file when needed. The caller must hold #_sprite_disk_cache_mutex.
+ * Every combination of file, blitter and palette has its own cache file, as they all change the encoded sprites.
+ * @param file_slot The slot.
+ * @return The disk cache, or \c nullptr if it cannot be used.
+ */
+static SpriteDiskCache *GetSpriteDiskCache(uint8 file_slot)
+{
+	SpriteDiskCache &cache = _sprite_disk_caches[file_slot];
+	if (!_sprite_disk_cache || !cache.has_md5 || _sprite_disk_cache_dir == nullptr) return nullptr;
+
+	if (!cache.opened) {
+		cache.opened = true;
+
+		char md5[33];
+		md5sumToString(md5, lastof(md5), cache.md5sum);
+		char filename[MAX_PATH];
+		seprintf(filename, lastof(filename), "%s%s-%s-%d.dat", _sprite_disk_cache_dir, md5, BlitterFactory::GetCurrentBlitter()->GetName(),
+				_palette_remap_grf[file_slot] ? 1 : 0);
+
+		cache.file = fopen(filename, "r+b");
+		if (cache.file != nullptr) {
+			/* Read the index of the entries; an incomplete entry at the end is overwritten. */
+			char magic[sizeof(SPRITE_DISK_CACHE_MAGIC)];
+			uint32 version;
+			fseek(cache.file, 0, SEEK_END);
+			size_t file_size = min<size_t>(ftell(cache.file), UINT32_MAX);
+			fseek(cache.file, 0, SEEK_SET);
+
+			if (fread(magic, sizeof(magic), 1, cache.file) == 1 && memcmp(magic, SPRITE_DISK_CACHE_MAGIC, sizeof(magic)) == 0 &&
+					fread(&version, sizeof(version), 1, cache.file) == 1 && version == SPRITE_DISK_CACHE_VERSION) {
+				cache.end = sizeof(magic) + sizeof(version);
+				uint32 header[3]; // File position of the sprite, kind of the entry, and size of its data.
+				while (cache.end + sizeof(header) <= file_size && fread(header, sizeof(header), 1, cache.file) == 1) {
+					uint32 offset = cache.end + sizeof(header);
+					if (header[2] > file_size - offset) break;
+					cache.index[GetSpriteDiskCacheIndex(header[0], header[1])] = { offset, header[2] };
+					cache.end = offset + header[2];
+					if (fseek(cache.file, cache.end, SEEK_SET) != 0) break;
+				}
+				DEBUG(sprite, 3, "Using %u sprites from the sprite disk cache %s", (uint)cache.index.size(), filename);
+				return &cache;
+			}
+			fclose(cache.file);
+		}
+
+		FioCreateDirectory(_sprite_disk_cache_dir);
+		cache.file = fopen(filename, "w+b");
+		if (cache.file == nullptr) {
+			DEBUG(sprite, 0, "Could not create the sprite disk cache %s", filename);
+			return nullptr;
+		}
+		uint32 version = SPRITE_DISK_CACHE_VERSION;
+		if (fwrite(SPRITE_DISK_CACHE_MAGIC, sizeof(SPRITE_DISK_CACHE_MAGIC), 1, cache.file) != 1 || fwrite(&version, sizeof(version), 1, cache.file) != 1) {
+			CloseSpriteDiskCache(cache);
+			cache.opened = true;
+			return nullptr;
+		}
+		cache.end = sizeof(SPRITE_DISK_CACHE_MAGIC) + sizeof(version);
+	}
+
+	return cache.file != nullptr ? &cache : nullptr;
+}
+
+/**
+ * Read an encoded sprite from the sprite disk cache.
+ * @param file_slot File slot of the sprite.
+ * @param file_pos Position of the sprite in the file.
+ * @param kind Kind of the entry, see #GetSpriteDiskCacheKind.
+ * @param allocator Allocator function to use.
+ * @return The sprite data, or \c nullptr if the sprite is not in the disk cache.
+ */
+static void *ReadSpriteFromDiskCache(uint8 file_slot, size_t file_pos, uint32 kind, AllocatorProc *allocator)
+{
+	if (!_sprite_disk_cache || file_pos > UINT32_MAX) return nullptr;
+
+	std::lock_guard<std::mutex> lock(_sprite_disk_cache_mutex);
+	SpriteDiskCache *cache = GetSpriteDiskCache(file_slot);
+	if (cache == nullptr) return nullptr;
+
+	auto it = cache->index.find(GetSpriteDiskCacheIndex((uint32)file_pos, kind));
+	if (it == cache->index.end()) return nullptr;
+
+	/* Read into a buffer first, so a failed read does not leave memory of the allocator unused. */
+	uint32 size = it->second.second;
+	static thread_local ReusableBuffer<byte> buffer;
+	byte *buf = buffer.Allocate(size);
+	if (fseek(cache->file, it->second.first, SEEK_SET) != 0 || fread(buf, size, 1, cache->file) != 1) {
+		cache->index.erase(it);
+		return nullptr;
+	}
+
+	void *data = allocator(size);
+	memcpy(data, buf, size);
+	return data;
+}
+
+/**
+ * Add an encoded sprite to the sprite disk cache.
+ * @param file_slot File slot of the sprite.
+ * @param file_pos Position of the sprite in the file.
+ * @param kind Kind of the entry, see #GetSpriteDiskCacheKind.
+ * @param data The encoded sprite.
+ * @param size Size of the encoded sprite.
+ */
+static void WriteSpriteToDiskCache(uint8 file_slot, size_t file_pos, uint32 kind, const void *data, size_t size)
+{
+	std::lock_guard<std::mutex> lock(_sprite_disk_cache_mutex);
+	SpriteDiskCache *cache = GetSpriteDiskCache(file_slot);
+	if (cache == nullptr || file_pos > UINT32_MAX || size > UINT32_MAX - cache->end - 3 * sizeof(uint32)) return;
+
+	uint32 header[3] = { (uint32)file_pos, kind, (uint32)size };
+	if (fseek(cache->file, cache->end, SEEK_SET) != 0 || fwrite(header, sizeof(header), 1, cache->file) != 1 || fwrite(data, size, 1, cache->file) != 1) {
+		DEBUG(sprite, 0, "Writing to the sprite disk cache failed; not using it anymore");
+		CloseSpriteDiskCache(*cache);
+		cache->opened = true;
+		return;
+	}
+
+	uint32 offset = cache->end + sizeof(header);
+	cache->index[GetSpriteDiskCacheIndex((uint32)file_pos, kind)] = { offset, (uint32)size };
+	cache->end = offset + (uint32)size;
+}
+
+static thread_local AllocatorProc *_disk_cache_allocator; ///< Allocator that #AllocEncodedSprite passes the allocation on to.
+static thread_local size_t _disk_cache_encoded_size;      ///< Size of the last allocation by #AllocEncodedSprite.
+
+/**
+ * Allocator for the blitters that remembers the size of the encoded sprite, for #WriteSpriteToDiskCache.
+ * @param size The number of bytes to allocate.
+ * @return The memory, allocated by #_disk_cache_allocator.
+ */
+static void *AllocEncodedSprite(size_t size)
+{
+	_disk_cache_encoded_size = size;
+	return _disk_cache_allocator(size);
+}
+
+static thread_local ZoomLevel _sprite_encode_zoom_min = ZOOM_LVL_NORMAL; ///< Most zoomed in level of the normal sprite that is being encoded.
+static thread_local ZoomLevel _sprite_encode_zoom_max = ZOOM_LVL_NORMAL; ///< Most zoomed out level of the normal sprite that is being encoded.
+
+/**
+ * Get the zoom levels that a blitter has to encode of a sprite.
+ * @param type Type of the sprite.
+ * @param[out] zoom_min Most zoomed in level to encode.
+ * @param[out] zoom_max Most zoomed out level to encode.
+ */
+void GetSpriteEncodeZoomLevels(SpriteType type, ZoomLevel *zoom_min, ZoomLevel *zoom_max)
+{
+	if (type == ST_FONT) {
+		*zoom_min = ZOOM_LVL_NORMAL;
+		*zoom_max = ZOOM_LVL_NORMAL;
+	} else {
+		*zoom_min = _sprite_encode_zoom_min;
+		*zoom_max = _sprite_encode_zoom_max;
+	}
+}
+
 /**
  * Read a sprite from disk.
  * @param sc          Location of sprite.
  * @param id          Sprite number.
  * @param sprite_type Type of sprite.
  * @param allocator   Allocator function to use.
+ * @param zoom_min    Most zoomed in level the sprite has to be drawable at.
+ * @param zoom_max    Most zoomed out level the sprite has to be drawable at.
  * @return Read sprite data.
  */
-static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_type, AllocatorProc *allocator)
+static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_type, AllocatorProc *allocator, ZoomLevel zoom_min, ZoomLevel zoom_max)
 {
 	uint8 file_slot = sc->file_slot;
 	size_t file_pos = sc->file_pos;
@@ -414,6 +699,19 @@ static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_ty
 	assert(sprite_type != ST_RECOLOUR);
 	assert(IsMapgenSpriteID(id) == (sprite_type == ST_MAPGEN));
 	assert(sc->type == sprite_type);
+	assert(zoom_min <= zoom_max && zoom_max <= ZOOM_LVL_MAX);
+
+	/* Simple blitters scale the fully zoomed in image while drawing, and characters are drawn without zoom. */
+	if (sprite_type == ST_FONT || BlitterFactory::GetCurrentBlitter()->DrawsFromNormalZoom()) {
+		zoom_min = ZOOM_LVL_NORMAL;
+		zoom_max = ZOOM_LVL_NORMAL;
+	}
+	uint32 kind = GetSpriteDiskCacheKind(sprite_type, zoom_min, zoom_max);
+
+	if (sprite_type != ST_MAPGEN) {
+		void *cached = ReadSpriteFromDiskCache(file_slot, file_pos, kind, allocator);
+		if (cached != nullptr) return cached;
+	}
 
 	DEBUG(sprite, 9, "Load sprite %d", id);
 
@@ -432,8 +730,10 @@ static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_ty
 
 	if (sprite_avail == 0) {
 		if (sprite_type == ST_MAPGEN) return nullptr;
+		/* Worker threads leave the fallback to the main thread. */
+		if (IsWorkerThread()) return nullptr;
 		if (id == SPR_IMG_QUERY) usererror("Okay... something went horribly wrong. I couldn't load the fallback sprite. What should I do?");
-		return (void*)GetRawSprite(SPR_IMG_QUERY, ST_NORMAL, allocator);
+		return ReadSprite(GetSpriteCache(SPR_IMG_QUERY), SPR_IMG_QUERY, ST_NORMAL, allocator, zoom_min, zoom_max);
 	}
 
 	if (sprite_type == ST_MAPGEN) {
@@ -464,9 +764,13 @@ static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_ty
 		return s;
 	}
 
-	if (!ResizeSprites(sprite, sprite_avail, file_slot, sc->id)) {
+	/* Characters are drawn from the image at ZOOM_LVL_FONT. */
+	ZoomLevel resize_min = sprite_type == ST_FONT ? ZOOM_LVL_FONT : zoom_min;
+	ZoomLevel resize_max = sprite_type == ST_FONT ? ZOOM_LVL_FONT : zoom_max;
+	if (!ResizeSprites(sprite, sprite_avail, resize_min, resize_max)) {
 		if (id == SPR_IMG_QUERY) usererror("Okay... something went horribly wrong. I couldn't resize the fallback sprite. What should I do?");
-		return (void*)GetRawSprite(SPR_IMG_QUERY, ST_NORMAL, allocator);
+		if (IsWorkerThread()) return nullptr;
+		return ReadSprite(GetSpriteCache(SPR_IMG_QUERY), SPR_IMG_QUERY, ST_NORMAL, allocator, zoom_min, zoom_max);
 	}
 
 	if (sprite->type == ST_FONT && ZOOM_LVL_FONT != ZOOM_LVL_NORMAL) {
@@ -478,7 +782,14 @@ static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_ty
 		sprite[ZOOM_LVL_NORMAL].data   = sprite[ZOOM_LVL_FONT].data;
 	}
 
-	return BlitterFactory::GetCurrentBlitter()->Encode(sprite, allocator);
+	_sprite_encode_zoom_min = zoom_min;
+	_sprite_encode_zoom_max = zoom_max;
+	if (!_sprite_disk_cache) return BlitterFactory::GetCurrentBlitter()->Encode(sprite, allocator);
+
+	_disk_cache_allocator = allocator;
+	Sprite *encoded = BlitterFactory::GetCurrentBlitter()->Encode(sprite, AllocEncodedSprite);
+	WriteSpriteToDiskCache(file_slot, file_pos, kind, encoded, _disk_cache_encoded_size);
+	return encoded;
 }
 
 
@@ -495,17 +806,101 @@ size_t GetGRFSpriteOffset(uint32 id)
 	return _grf_sprite_offsets.find(id) != _grf_sprite_offsets.end() ? _grf_sprite_offsets[id] : SIZE_MAX;
 }
 
+/** Sprite sections of GRFs that were parsed ahead of loading them, by file name. */
+static std::map<std::string, std::map<uint32, size_t>> _prepared_grf_sprite_offsets;
+
+/**
+ * Read a little endian dword from a file.
+ * @param f The file.
+ * @return The dword, or 0 at the end of the file.
+ */
+static uint32 ReadDword(FILE *f)
+{
+	byte buf[4];
+	if (fread(buf, 1, sizeof(buf), f) != sizeof(buf)) return 0;
+	return buf[0] | buf[1] << 8 | buf[2] << 16 | (uint32)buf[3] << 24;
+}
+
+/**
+ * Parse the sprite section of a GRF file the way #ReadGRFSpriteOffsets does,
+ * but with its own file handle so several files can be parsed at once.
+ * @param filename The file.
+ * @param subdir The directory to look in.
+ * @param[out] offsets The offsets of the sprites.
+ * @return True iff the file has a sprite section.
+ */
+static bool ParseGRFSpriteOffsets(const std::string &filename, Subdirectory subdir, std::map<uint32, size_t> &offsets)
+{
+	extern const byte _grf_cont_v2_sig[8];
+
+	FILE *f = FioFOpenFile(filename.c_str(), "rb", subdir);
+	if (f == nullptr) return false;
+	FileCloser fcloser(f);
+
+	/* Only container version 2 has a sprite section. */
+	byte header[2 + sizeof(_grf_cont_v2_sig)];
+	if (fread(header, 1, sizeof(header), f) != sizeof(header) || header[0] != 0 || header[1] != 0 || memcmp(header + 2, _grf_cont_v2_sig, sizeof(_grf_cont_v2_sig)) != 0) return false;
+
+	uint32 data_offset = ReadDword(f);
+	if (fseek(f, data_offset, SEEK_CUR) < 0) return false;
+
+	uint32 id, prev_id = 0;
+	while ((id = ReadDword(f)) != 0) {
+		if (id != prev_id) offsets[id] = ftell(f) - 4;
+		prev_id = id;
+		if (fseek(f, ReadDword(f), SEEK_CUR) < 0) break;
+	}
+	return true;
+}
+
+/**
+ * Parse the sprite sections of GRFs that are about to be loaded, spreading
+ * the files over the worker threads. #ReadGRFSpriteOffsets then uses these
+ * instead of seeking through the file itself, once for every loading stage
+ * that needs them.
+ * @param files The names and directories of the files.
+ */
+void PrepareGRFSpriteOffsets(const std::vector<std::pair<std::string, Subdirectory>> &files)
+{
+	std::vector<std::map<uint32, size_t>> offsets(files.size());
+	std::vector<byte> parsed(files.size());
+	RunParallelFor((uint)files.size(), 1, [&](uint begin, uint end) {
+		for (uint i = begin; i < end; i++) parsed[i] = ParseGRFSpriteOffsets(files[i].first, files[i].second, offsets[i]);
+	});
+
+	_prepared_grf_sprite_offsets.clear();
+	for (size_t i = 0; i < files.size(); i++) {
+		if (parsed[i]) _prepared_grf_sprite_offsets[files[i].first] = std::move(offsets[i]);
+	}
+}
+
+/** Forget the sprite sections parsed by #PrepareGRFSpriteOffsets. */
+void ClearPreparedGRFSpriteOffsets()
+{
+	_prepared_grf_sprite_offsets.clear();
+}
+
 /**
  * Parse the sprite section of GRFs.
  * @param container_version Container version of the GRF we're currently processing.
+ * @param filename Name of the GRF, to use the sprite section prepared by #PrepareGRFSpriteOffsets, or \c nullptr.
  */
-void ReadGRFSpriteOffsets(byte container_version)
+void ReadGRFSpriteOffsets(byte container_version, const char *filename)
 {
 	_grf_sprite_offsets.clear();
 
 	if (container_version >= 2) {
 		/* Seek to sprite section of the GRF. */
 		size_t data_offset = FioReadDword();
+
+		if (filename != nullptr) {
+			auto prepared = _prepared_grf_sprite_offsets.find(filename);
+			if (prepared != _prepared_grf_sprite_offsets.end()) {
+				_grf_sprite_offsets = prepared->second;
+				return;
+			}
+		}
+
 		size_t old_pos = FioGetPos();
 		FioSeekTo(data_offset, SEEK_CUR);
 
@@ -585,7 +980,6 @@ bool LoadNextSprite(int load_index, byte file_slot, uint file_sprite_id, byte co
 	sc->file_slot = file_slot;
 	sc->file_pos = file_pos;
 	sc->ptr = data;
-	sc->lru = 0;
 	sc->id = file_sprite_id;
 	sc->type = type;
 	sc->warned = false;
@@ -610,106 +1004,105 @@ void DupSprite(SpriteID old_spr, SpriteID new_spr)
 }
 
 /**
- * S_FREE_MASK is used to mask-out lower bits of MemBlock::size
- * If they are non-zero, the block is free.
- * S_FREE_MASK has to ensure MemBlock is correctly aligned -
- * it means 8B (S_FREE_MASK == 7) on 64bit systems!
+ * Get the size class a block of the given size belongs to.
+ * @param size Number of bytes needed, including the header.
+ * @return The size class.
  */
-static const size_t S_FREE_MASK = sizeof(size_t) - 1;
-
-/* to make sure nobody adds things to MemBlock without checking S_FREE_MASK first */
-assert_compile(sizeof(MemBlock) == sizeof(size_t));
-/* make sure it's a power of two */
-assert_compile((sizeof(size_t) & (sizeof(size_t) - 1)) == 0);
-
-static inline MemBlock *NextBlock(MemBlock *block)
+static inline uint GetSizeClass(size_t size)
 {
-	return (MemBlock*)((byte*)block + (block->size & ~S_FREE_MASK));
+	if (size <= SPRITE_CACHE_MIN_BLOCK) return 0;
+	uint bit = FindLastBit(size - 1);
+	return (bit - 6) * 4 + (((size - 1) >> (bit - 2)) & 3) + 1;
 }
 
-static size_t GetSpriteCacheUsage()
+/**
+ * Get the number of bytes of the blocks in a size class.
+ * @param size_class The size class.
+ * @return The size of the blocks, including the header.
+ */
+static inline size_t GetSizeClassBytes(uint size_class)
 {
-	size_t tot_size = 0;
-	MemBlock *s;
-
-	for (s = _spritecache_ptr; s->size != 0; s = NextBlock(s)) {
-		if (!(s->size & S_FREE_MASK)) tot_size += s->size;
-	}
-
-	return tot_size;
+	if (size_class == 0) return SPRITE_CACHE_MIN_BLOCK;
+	uint bit = (size_class - 1) / 4 + 6;
+	return (size_t)(5 + (size_class - 1) % 4) << (bit - 2);
 }
 
+static inline SpriteCacheBlock *GetSpriteCacheBlock(void *ptr)
+{
+	return (SpriteCacheBlock *)((byte *)ptr - sizeof(SpriteCacheBlock));
+}
 
-void IncreaseSpriteLRU()
+/**
+ * Remove a block from the LRU list.
+ * @param block The block to remove.
+ */
+static inline void UnlinkSpriteCacheBlock(SpriteCacheBlock *block)
 {
-	/* Increase all LRU values */
-	if (_sprite_lru_counter > 16384) {
-		SpriteID i;
+	assert(block->in_lru);
+	if (block->prev != nullptr) block->prev->next = block->next; else _sprite_lru_head = block->next;
+	if (block->next != nullptr) block->next->prev = block->prev; else _sprite_lru_tail = block->prev;
+	block->in_lru = false;
+}
 
-		DEBUG(sprite, 3, "Fixing lru %u, inuse=" PRINTF_SIZE, _sprite_lru_counter, GetSpriteCacheUsage());
+/**
+ * Put a block at the front of the LRU list, i.e. mark it as the most recently used.
+ * @param block The block.
+ * @param sprite The sprite whose data is in the block.
+ */
+static inline void LinkSpriteCacheBlock(SpriteCacheBlock *block, SpriteID sprite)
+{
+	assert(!block->in_lru);
+	block->sprite = sprite;
+	block->prev = nullptr;
+	block->next = _sprite_lru_head;
+	if (_sprite_lru_head != nullptr) _sprite_lru_head->prev = block; else _sprite_lru_tail = block;
+	_sprite_lru_head = block;
+	block->in_lru = true;
+}
 
-		for (i = 0; i != _spritecache_items; i++) {
-			SpriteCache *sc = GetSpriteCache(i);
-			if (sc->ptr != nullptr) {
-				if (sc->lru >= 0) {
-					sc->lru = -1;
-				} else if (sc->lru != -32768) {
-					sc->lru--;
-				}
-			}
+/**
+ * Give the unused blocks back to the system.
+ */
+static void ReleaseFreeSpriteCacheBlocks()
+{
+	for (uint i = 0; i < SPRITE_CACHE_SIZE_CLASSES && _sprite_cache_free != 0; i++) {
+		while (_sprite_free_blocks[i] != nullptr) {
+			SpriteCacheBlock *block = _sprite_free_blocks[i];
+			_sprite_free_blocks[i] = block->prev;
+			_sprite_cache_free -= GetSizeClassBytes(i);
+			delete[] reinterpret_cast<byte *>(block);
 		}
-		_sprite_lru_counter = 0;
-	}
-
-	/* Compact sprite cache every now and then. */
-	if (++_compact_cache_counter >= 740) {
-		CompactSpriteCache();
-		_compact_cache_counter = 0;
 	}
 }
 
 /**
- * Called when holes in the sprite cache should be removed.
- * That is accomplished by moving the cached data.
+ * Get the number of sprites that were removed from the sprite cache to make room for other sprites.
+ * As long as this number does not change, sprites that were loaded stay in the cache; they are only
+ * encoded again when they are drawn at a zoom level they were not encoded for.
+ * @return The number of removed sprites.
  */
-static void CompactSpriteCache()
+uint GetSpriteCacheEvictionCount()
 {
-	MemBlock *s;
-
-	DEBUG(sprite, 3, "Compacting sprite cache, inuse=" PRINTF_SIZE, GetSpriteCacheUsage());
-
-	for (s = _spritecache_ptr; s->size != 0;) {
-		if (s->size & S_FREE_MASK) {
-			MemBlock *next = NextBlock(s);
-			MemBlock temp;
-			SpriteID i;
-
-			/* Since free blocks are automatically coalesced, this should hold true. */
-			assert(!(next->size & S_FREE_MASK));
-
-			/* If the next block is the sentinel block, we can safely return */
-			if (next->size == 0) break;
+	return _sprite_cache_evictions;
+}
 
-			/* Locate the sprite belonging to the next pointer. */
-			for (i = 0; GetSpriteCache(i)->ptr != next->data; i++) {
-				assert(i != _spritecache_items);
-			}
+/**
+ * Free the memory of a single entry of the sprite cache, without counting it as evicted.
+ * Its block is kept for another sprite of the same size class.
+ * @param item Entry to free.
+ */
+static void FreeSpriteCacheEntry(uint item)
+{
+	SpriteCacheBlock *block = GetSpriteCacheBlock(GetSpriteCache(item)->ptr);
+	if (block->in_lru) UnlinkSpriteCacheBlock(block);
 
-			GetSpriteCache(i)->ptr = s->data; // Adjust sprite array entry
-			/* Swap this and the next block */
-			temp = *s;
-			memmove(s, next, next->size);
-			s = NextBlock(s);
-			*s = temp;
+	size_t bytes = GetSizeClassBytes(block->size_class);
+	_sprite_cache_used -= bytes;
+	_sprite_cache_free += bytes;
+	block->prev = _sprite_free_blocks[block->size_class];
+	_sprite_free_blocks[block->size_class] = block;
 
-			/* Coalesce free blocks */
-			while (NextBlock(s)->size & S_FREE_MASK) {
-				s->size += NextBlock(s)->size & ~S_FREE_MASK;
-			}
-		} else {
-			s = NextBlock(s);
-		}
-	}
+	GetSpriteCache(item)->ptr = nullptr;
 }
 
 /**
@@ -718,80 +1111,70 @@ static void CompactSpriteCache()
  */
 static void DeleteEntryFromSpriteCache(uint item)
 {
-	/* Mark the block as free (the block must be in use) */
-	MemBlock *s = (MemBlock*)GetSpriteCache(item)->ptr - 1;
-	assert(!(s->size & S_FREE_MASK));
-	s->size |= S_FREE_MASK;
-	GetSpriteCache(item)->ptr = nullptr;
-
-	/* And coalesce adjacent free blocks */
-	for (s = _spritecache_ptr; s->size != 0; s = NextBlock(s)) {
-		if (s->size & S_FREE_MASK) {
-			while (NextBlock(s)->size & S_FREE_MASK) {
-				s->size += NextBlock(s)->size & ~S_FREE_MASK;
-			}
-		}
-	}
+	FreeSpriteCacheEntry(item);
+	_sprite_cache_evictions++;
 }
 
-static void DeleteEntryFromSpriteCache()
+/**
+ * Delete the least recently used sprite from the sprite cache.
+ * @return False iff there was no sprite that could be deleted.
+ */
+static bool DeleteEntryFromSpriteCache()
 {
-	uint best = UINT_MAX;
-	int cur_lru;
-
-	DEBUG(sprite, 3, "DeleteEntryFromSpriteCache, inuse=" PRINTF_SIZE, GetSpriteCacheUsage());
-
-	cur_lru = 0xffff;
-	for (SpriteID i = 0; i != _spritecache_items; i++) {
-		SpriteCache *sc = GetSpriteCache(i);
-		if (sc->type != ST_RECOLOUR && sc->ptr != nullptr && sc->lru < cur_lru) {
-			cur_lru = sc->lru;
-			best = i;
-		}
-	}
-
-	/* Display an error message and die, in case we found no sprite at all.
-	 * This shouldn't really happen, unless all sprites are locked. */
-	if (best == UINT_MAX) error("Out of sprite memory");
+	if (_sprite_lru_tail == nullptr) return false;
 
-	DeleteEntryFromSpriteCache(best);
+	DEBUG(sprite, 3, "DeleteEntryFromSpriteCache, inuse=" PRINTF_SIZE, _sprite_cache_used);
+	DeleteEntryFromSpriteCache(_sprite_lru_tail->sprite);
+	return true;
 }
 
 static void *AllocSprite(size_t mem_req)
 {
-	mem_req += sizeof(MemBlock);
-
-	/* Align this to correct boundary. This also makes sure at least one
-	 * bit is not used, so we can use it for other things. */
-	mem_req = Align(mem_req, S_FREE_MASK + 1);
+	uint size_class = GetSizeClass(mem_req + sizeof(SpriteCacheBlock));
+	size_t bytes = GetSizeClassBytes(size_class);
 
+	SpriteCacheBlock *block;
 	for (;;) {
-		MemBlock *s;
+		/* Reuse a block of the same size class, if there is one. */
+		block = _sprite_free_blocks[size_class];
+		if (block != nullptr) {
+			_sprite_free_blocks[size_class] = block->prev;
+			_sprite_cache_free -= bytes;
+			break;
+		}
 
-		for (s = _spritecache_ptr; s->size != 0; s = NextBlock(s)) {
-			if (s->size & S_FREE_MASK) {
-				size_t cur_size = s->size & ~S_FREE_MASK;
+		/* Otherwise make room within the budget, first by giving back unused blocks of
+		 * other sizes and then by deleting the least recently used sprites. If only
+		 * sprites that can not be deleted are left the budget is exceeded. */
+		if (_sprite_cache_used + _sprite_cache_free + bytes <= _sprite_cache_budget) {
+			block = reinterpret_cast<SpriteCacheBlock *>(new (std::nothrow) byte[bytes]);
+			if (block != nullptr) break;
 
-				/* Is the block exactly the size we need or
-				 * big enough for an additional free block? */
-				if (cur_size == mem_req ||
-						cur_size >= mem_req + sizeof(MemBlock)) {
-					/* Set size and in use */
-					s->size = mem_req;
+			/* The system has less memory than the budget allows for. */
+			size_t budget = _sprite_cache_used + _sprite_cache_free;
+			DEBUG(misc, 0, "Not enough memory to allocate " PRINTF_SIZE " bytes of spritecache. Spritecache was reduced to " PRINTF_SIZE " bytes.", _sprite_cache_budget, budget);
 
-					/* Do we need to inject a free block too? */
-					if (cur_size != mem_req) {
-						NextBlock(s)->size = (cur_size - mem_req) | S_FREE_MASK;
-					}
+			ErrorMessageData msg(STR_CONFIG_ERROR_OUT_OF_MEMORY, STR_CONFIG_ERROR_SPRITECACHE_TOO_BIG);
+			msg.SetDParam(0, _sprite_cache_budget);
+			msg.SetDParam(1, budget);
+			ScheduleErrorMessage(msg);
 
-					return s->data;
-				}
-			}
+			_sprite_cache_budget = budget;
 		}
 
-		/* Reached sentinel, but no block found yet. Delete some old entry. */
-		DeleteEntryFromSpriteCache();
+		if (_sprite_cache_free != 0) {
+			ReleaseFreeSpriteCacheBlocks();
+		} else if (!DeleteEntryFromSpriteCache()) {
+			block = reinterpret_cast<SpriteCacheBlock *>(new (std::nothrow) byte[bytes]);
+			if (block == nullptr) error("Out of sprite memory");
+			break;
+		}
 	}
+
+	_sprite_cache_used += bytes;
+	block->size_class = size_class;
+	block->in_lru = false;
+	return block->data;
 }
 
 /**
@@ -803,7 +1186,7 @@ static void *AllocSprite(size_t mem_req)
  * @return fallback sprite
  * @note this function will do usererror() in the case the fallback sprite isn't available
  */
-static void *HandleInvalidSpriteRequest(SpriteID sprite, SpriteType requested, SpriteCache *sc, AllocatorProc *allocator)
+static void *HandleInvalidSpriteRequest(SpriteID sprite, SpriteType requested, SpriteCache *sc, AllocatorProc *allocator, ZoomLevel zoom)
 {
 	static const char * const sprite_types[] = {
 		"normal",        // ST_NORMAL
@@ -815,7 +1198,7 @@ static void *HandleInvalidSpriteRequest(SpriteID sprite, SpriteType requested, S
 	SpriteType available = sc->type;
 	if (requested == ST_FONT && available == ST_NORMAL) {
 		if (sc->ptr == nullptr) sc->type = ST_FONT;
-		return GetRawSprite(sprite, sc->type, allocator);
+		return GetRawSprite(sprite, sc->type, allocator, zoom);
 	}
 
 	byte warning_level = sc->warned ? 6 : 0;
@@ -827,7 +1210,7 @@ static void *HandleInvalidSpriteRequest(SpriteID sprite, SpriteType requested, S
 			if (sprite == SPR_IMG_QUERY) usererror("Uhm, would you be so kind not to load a NewGRF that makes the 'query' sprite a non-normal sprite?");
 			FALLTHROUGH;
 		case ST_FONT:
-			return GetRawSprite(SPR_IMG_QUERY, ST_NORMAL, allocator);
+			return GetRawSprite(SPR_IMG_QUERY, ST_NORMAL, allocator, zoom);
 		case ST_RECOLOUR:
 			if (sprite == PALETTE_TO_DARK_BLUE) usererror("Uhm, would you be so kind not to load a NewGRF that makes the 'PALETTE_TO_DARK_BLUE' sprite a non-remap sprite?");
 			return GetRawSprite(PALETTE_TO_DARK_BLUE, ST_RECOLOUR, allocator);
@@ -839,15 +1222,29 @@ static void *HandleInvalidSpriteRequest(SpriteID sprite, SpriteType requested, S
 	}
 }
 
+/**
+ * Check whether a cached sprite can be drawn at a zoom level.
+ * @param sc The sprite.
+ * @param zoom The zoom level, or #ZOOM_LVL_END when the sprite is not drawn.
+ * @return True if the sprite was encoded for the zoom level.
+ */
+static inline bool HasSpriteZoomLevel(const SpriteCache *sc, ZoomLevel zoom)
+{
+	if (zoom == ZOOM_LVL_END || sc->type != ST_NORMAL) return true;
+	if (zoom >= sc->zoom_min && zoom <= sc->zoom_max) return true;
+	return BlitterFactory::GetCurrentBlitter()->DrawsFromNormalZoom();
+}
+
 /**
  * Reads a sprite (from disk or sprite cache).
  * If the sprite is not available or of wrong type, a fallback sprite is returned.
  * @param sprite Sprite to read.
  * @param type Expected sprite type.
  * @param allocator Allocator function to use. Set to nullptr to use the usual sprite cache.
+ * @param zoom Zoom level the sprite is going to be drawn at, or #ZOOM_LVL_END when it is not drawn.
  * @return Sprite raw data
  */
-void *GetRawSprite(SpriteID sprite, SpriteType type, AllocatorProc *allocator)
+void *GetRawSprite(SpriteID sprite, SpriteType type, AllocatorProc *allocator, ZoomLevel zoom)
 {
 	assert(type != ST_MAPGEN || IsMapgenSpriteID(sprite));
 	assert(type < ST_INVALID);
@@ -861,86 +1258,182 @@ void *GetRawSprite(SpriteID sprite, SpriteType type, AllocatorProc *allocator)
 
 	SpriteCache *sc = GetSpriteCache(sprite);
 
-	if (sc->type != type) return HandleInvalidSpriteRequest(sprite, type, sc, allocator);
+	if (sc->type != type) return HandleInvalidSpriteRequest(sprite, type, sc, allocator, zoom);
+
+	/* Sprites are encoded for the zoom levels they are drawn at; the size is the same at all of them. */
+	ZoomLevel zoom_min = zoom != ZOOM_LVL_END ? zoom : ZOOM_LVL_GUI;
+	ZoomLevel zoom_max = zoom_min;
 
 	if (allocator == nullptr) {
 		/* Load sprite into/from spritecache */
 
-		/* Update LRU */
-		sc->lru = ++_sprite_lru_counter;
+		/* Worker threads may only use sprites that are already in the cache;
+		 * the thread that started them keeps the LRU up to date. */
+		if (IsWorkerThread()) {
+			assert(sc->ptr != nullptr && HasSpriteZoomLevel(sc, zoom));
+			return sc->ptr;
+		}
+
+		/* Encode the sprite again when it is drawn at a zoom level it was not encoded for; this does not count as eviction */
+		if (sc->ptr != nullptr && !HasSpriteZoomLevel(sc, zoom)) {
+			zoom_min = min(zoom_min, sc->zoom_min);
+			zoom_max = max(zoom_max, sc->zoom_max);
+			FreeSpriteCacheEntry(sprite);
+		}
 
 		/* Load the sprite, if it is not loaded, yet */
-		if (sc->ptr == nullptr) sc->ptr = ReadSprite(sc, sprite, type, AllocSprite);
+		if (sc->ptr == nullptr) {
+			sc->ptr = ReadSprite(sc, sprite, type, AllocSprite, zoom_min, zoom_max);
+			sc->zoom_min = zoom_min;
+			sc->zoom_max = zoom_max;
+		}
+
+		/* Update LRU; recolour sprites are never evicted, so they are not in it. */
+		if (type != ST_RECOLOUR) {
+			SpriteCacheBlock *block = GetSpriteCacheBlock(sc->ptr);
+			if (block != _sprite_lru_head) {
+				if (block->in_lru) UnlinkSpriteCacheBlock(block);
+				LinkSpriteCacheBlock(block, sprite);
+			}
+		}
 
 		return sc->ptr;
 	} else {
 		/* Do not use the spritecache, but a different allocator. */
-		return ReadSprite(sc, sprite, type, allocator);
+		return ReadSprite(sc, sprite, type, allocator, zoom_min, zoom_max);
 	}
 }
 
 
-static void GfxInitSpriteCache()
+/**
+ * Allocate memory for a sprite that is decoded on a worker thread.
+ * The memory is a sprite cache block, but it is only added to the sprite cache by #AddPrefetchedSprite.
+ * @param mem_req The number of bytes to allocate.
+ * @return The memory.
+ */
+static void *AllocPrefetchedSprite(size_t mem_req)
 {
-	/* initialize sprite cache heap */
-	int bpp = BlitterFactory::GetCurrentBlitter()->GetScreenDepth();
-	uint target_size = (bpp > 0 ? _sprite_cache_size * bpp / 8 : 1) * 1024 * 1024;
+	uint size_class = GetSizeClass(mem_req + sizeof(SpriteCacheBlock));
+	SpriteCacheBlock *block = reinterpret_cast<SpriteCacheBlock *>(new byte[GetSizeClassBytes(size_class)]);
+	block->size_class = size_class;
+	block->in_lru = false;
+	return block->data;
+}
 
-	/* Remember 'target_size' from the previous allocation attempt, so we do not try to reach the target_size multiple times in case of failure. */
-	static uint last_alloc_attempt = 0;
+/**
+ * Add a sprite that was decoded on a worker thread to the sprite cache.
+ * @param sprite The sprite.
+ * @param ptr The sprite data, allocated by #AllocPrefetchedSprite.
+ * @param evict Whether other sprites may be removed from the cache to make room.
+ * @param zoom_min Most zoomed in level the sprite was encoded for.
+ * @param zoom_max Most zoomed out level the sprite was encoded for.
+ */
+static void AddPrefetchedSprite(SpriteID sprite, void *ptr, bool evict, ZoomLevel zoom_min, ZoomLevel zoom_max)
+{
+	SpriteCache *sc = GetSpriteCache(sprite);
+	/* Replacing the sprite with one for more zoom levels does not remove it from the cache. */
+	if (sc->ptr != nullptr) FreeSpriteCacheEntry(sprite);
 
-	if (_spritecache_ptr == nullptr || (_allocated_sprite_cache_size != target_size && target_size != last_alloc_attempt)) {
-		delete[] reinterpret_cast<byte *>(_spritecache_ptr);
+	SpriteCacheBlock *block = GetSpriteCacheBlock(ptr);
+	size_t bytes = GetSizeClassBytes(block->size_class);
 
-		last_alloc_attempt = target_size;
-		_allocated_sprite_cache_size = target_size;
+	while (_sprite_cache_used + _sprite_cache_free + bytes > _sprite_cache_budget) {
+		if (_sprite_cache_free != 0) {
+			ReleaseFreeSpriteCacheBlocks();
+		} else if (!evict || !DeleteEntryFromSpriteCache()) {
+			break;
+		}
+	}
 
-		do {
-			try {
-				/* Try to allocate 50% more to make sure we do not allocate almost all available. */
-				_spritecache_ptr = reinterpret_cast<MemBlock *>(new byte[_allocated_sprite_cache_size + _allocated_sprite_cache_size / 2]);
-			} catch (std::bad_alloc &) {
-				_spritecache_ptr = nullptr;
-			}
+	if (!evict && _sprite_cache_used + bytes > _sprite_cache_budget) {
+		/* Sprites that might be needed later do not push out sprites that are in use. */
+		delete[] reinterpret_cast<byte *>(block);
+		return;
+	}
 
-			if (_spritecache_ptr != nullptr) {
-				/* Allocation succeeded, but we wanted less. */
-				delete[] reinterpret_cast<byte *>(_spritecache_ptr);
-				_spritecache_ptr = reinterpret_cast<MemBlock *>(new byte[_allocated_sprite_cache_size]);
-			} else if (_allocated_sprite_cache_size < 2 * 1024 * 1024) {
-				usererror("Cannot allocate spritecache");
-			} else {
-				/* Try again to allocate half. */
-				_allocated_sprite_cache_size >>= 1;
-			}
-		} while (_spritecache_ptr == nullptr);
+	_sprite_cache_used += bytes;
+	sc->ptr = ptr;
+	sc->zoom_min = zoom_min;
+	sc->zoom_max = zoom_max;
+	LinkSpriteCacheBlock(block, sprite);
+}
 
-		if (_allocated_sprite_cache_size != target_size) {
-			DEBUG(misc, 0, "Not enough memory to allocate %d MiB of spritecache. Spritecache was reduced to %d MiB.", target_size / 1024 / 1024, _allocated_sprite_cache_size / 1024 / 1024);
+/**
+ * Load normal sprites into the sprite cache, decoding them on the worker threads.
+ * Sprites from files that can only be read on the main thread, and sprites
+ * that fail to load, are left to #GetRawSprite.
+ * @param[in,out] sprites The sprites to load; sprites that are already cached for the zoom level are skipped. The vector is reordered.
+ * @param evict Whether other sprites may be removed from the cache to make room. If not, the sprites that do not fit are not cached.
+ * @param zoom The zoom level the sprites are going to be drawn at.
+ */
+void PrefetchSprites(std::vector<SpriteID> &sprites, bool evict, ZoomLevel zoom)
+{
+	assert(!IsWorkerThread());
+
+	std::sort(sprites.begin(), sprites.end());
+	auto last = std::unique(sprites.begin(), sprites.end());
+	last = std::remove_if(sprites.begin(), last, [zoom](SpriteID sprite) {
+		if (!SpriteExists(sprite)) return true;
+		const SpriteCache *sc = GetSpriteCache(sprite);
+		return (sc->ptr != nullptr && HasSpriteZoomLevel(sc, zoom)) || sc->type != ST_NORMAL || !FioCanReadConcurrently(sc->file_slot);
+	});
+	sprites.erase(last, sprites.end());
+	if (sprites.empty()) return;
+
+	/* Sprites that are cached for other zoom levels keep those. */
+	static std::vector<std::pair<ZoomLevel, ZoomLevel>> zooms;
+	zooms.clear();
+	for (SpriteID sprite : sprites) {
+		const SpriteCache *sc = GetSpriteCache(sprite);
+		if (sc->ptr == nullptr) {
+			zooms.emplace_back(zoom, zoom);
+		} else {
+			zooms.emplace_back(min(zoom, sc->zoom_min), max(zoom, sc->zoom_max));
+		}
+	}
 
-			ErrorMessageData msg(STR_CONFIG_ERROR_OUT_OF_MEMORY, STR_CONFIG_ERROR_SPRITECACHE_TOO_BIG);
-			msg.SetDParam(0, target_size);
-			msg.SetDParam(1, _allocated_sprite_cache_size);
-			ScheduleErrorMessage(msg);
+	static std::vector<void *> decoded;
+	decoded.resize(sprites.size());
+	RunParallelFor((uint)sprites.size(), 4, [&sprites](uint begin, uint end) {
+		for (uint i = begin; i < end; i++) {
+			decoded[i] = ReadSprite(GetSpriteCache(sprites[i]), sprites[i], ST_NORMAL, AllocPrefetchedSprite, zooms[i].first, zooms[i].second);
 		}
+	});
+
+	for (size_t i = 0; i < sprites.size(); i++) {
+		if (decoded[i] != nullptr) AddPrefetchedSprite(sprites[i], decoded[i], evict, zooms[i].first, zooms[i].second);
 	}
+}
 
-	/* A big free block */
-	_spritecache_ptr->size = (_allocated_sprite_cache_size - sizeof(MemBlock)) | S_FREE_MASK;
-	/* Sentinel block (identified by size == 0) */
-	NextBlock(_spritecache_ptr)->size = 0;
+static void GfxInitSpriteCache()
+{
+	/* The sprite cache budget scales with the size of the pixels. */
+	int bpp = BlitterFactory::GetCurrentBlitter()->GetScreenDepth();
+	_sprite_cache_budget = (bpp > 0 ? (size_t)_sprite_cache_size * bpp / 8 : 1) * 1024 * 1024;
 }
 
 void GfxInitSpriteMem()
 {
 	GfxInitSpriteCache();
 
+	/* Free the memory of all sprites, including the recolour sprites which are never evicted */
+	for (uint i = 0; i != _spritecache_items; i++) {
+		SpriteCache *sc = GetSpriteCache(i);
+		if (sc->ptr == nullptr) continue;
+
+		SpriteCacheBlock *block = GetSpriteCacheBlock(sc->ptr);
+		if (block->in_lru) UnlinkSpriteCacheBlock(block);
+		_sprite_cache_used -= GetSizeClassBytes(block->size_class);
+		delete[] reinterpret_cast<byte *>(block);
+	}
+	ReleaseFreeSpriteCacheBlocks();
+	CloseSpriteDiskCaches();
+	assert(_sprite_lru_head == nullptr && _sprite_cache_used == 0 && _sprite_cache_free == 0);
+
 	/* Reset the spritecache 'pool' */
 	free(_spritecache);
 	_spritecache_items = 0;
 	_spritecache = nullptr;
-
-	_compact_cache_counter = 0;
 }
 
 /**
@@ -954,6 +1447,11 @@ void GfxClearSpriteCache()
 		SpriteCache *sc = GetSpriteCache(i);
 		if (sc->type != ST_RECOLOUR && sc->ptr != nullptr) DeleteEntryFromSpriteCache(i);
 	}
+	ReleaseFreeSpriteCacheBlocks();
+	CloseSpriteDiskCaches();
+
+	/* The budget might have changed with the blitter or the settings. */
+	GfxInitSpriteCache();
 }
 
-/* static */ ReusableBuffer<SpriteLoader::CommonPixel> SpriteLoader::Sprite::buffer[ZOOM_LVL_COUNT];
+/* static */ thread_local ReusableBuffer<SpriteLoader::CommonPixel> SpriteLoader::Sprite::buffer[ZOOM_LVL_COUNT];
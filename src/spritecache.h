@@ -11,6 +11,10 @@
 #define SPRITECACHE_H
 
 #include "gfx_type.h"
+#include "fileio_type.h"
+#include <string>
+#include <utility>
+#include <vector>
 
 /** Data structure describing a sprite. */
 struct Sprite {
@@ -22,10 +26,11 @@ struct Sprite {
 };
 
 extern uint _sprite_cache_size;
+extern bool _sprite_disk_cache;
 
 typedef void *AllocatorProc(size_t size);
 
-void *GetRawSprite(SpriteID sprite, SpriteType type, AllocatorProc *allocator = nullptr);
+void *GetRawSprite(SpriteID sprite, SpriteType type, AllocatorProc *allocator = nullptr, ZoomLevel zoom = ZOOM_LVL_END);
 bool SpriteExists(SpriteID sprite);
 
 SpriteType GetSpriteType(SpriteID sprite);
@@ -35,10 +40,17 @@ uint GetSpriteCountForSlot(uint file_slot, SpriteID begin, SpriteID end);
 uint GetMaxSpriteID();
 
 
-static inline const Sprite *GetSprite(SpriteID sprite, SpriteType type)
+/**
+ * Get a sprite from the sprite cache.
+ * @param sprite The sprite.
+ * @param type Expected sprite type.
+ * @param zoom Zoom level the sprite is going to be drawn at, or #ZOOM_LVL_END when only its size is needed.
+ * @return The sprite.
+ */
+static inline const Sprite *GetSprite(SpriteID sprite, SpriteType type, ZoomLevel zoom = ZOOM_LVL_END)
 {
 	assert(type != ST_RECOLOUR);
-	return (Sprite*)GetRawSprite(sprite, type);
+	return (Sprite*)GetRawSprite(sprite, type, nullptr, zoom);
 }
 
 static inline const byte *GetNonSprite(SpriteID sprite, SpriteType type)
@@ -47,11 +59,16 @@ static inline const byte *GetNonSprite(SpriteID sprite, SpriteType type)
 	return (byte*)GetRawSprite(sprite, type);
 }
 
+void PrefetchSprites(std::vector<SpriteID> &sprites, bool evict, ZoomLevel zoom);
+void GetSpriteEncodeZoomLevels(SpriteType type, ZoomLevel *zoom_min, ZoomLevel *zoom_max);
+void SetSpriteDiskCacheKey(uint8 file_slot, const uint8 *md5sum);
 void GfxInitSpriteMem();
 void GfxClearSpriteCache();
-void IncreaseSpriteLRU();
+uint GetSpriteCacheEvictionCount();
 
-void ReadGRFSpriteOffsets(byte container_version);
+void PrepareGRFSpriteOffsets(const std::vector<std::pair<std::string, Subdirectory>> &files);
+void ClearPreparedGRFSpriteOffsets();
+void ReadGRFSpriteOffsets(byte container_version, const char *filename = nullptr);
 size_t GetGRFSpriteOffset(uint32 id);
 bool LoadNextSprite(int load_index, byte file_index, uint file_sprite_id, byte container_version);
 bool SkipSpriteData(byte type, uint16 num);
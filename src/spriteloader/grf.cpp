@@ -17,6 +17,7 @@
 #include "../core/math_func.hpp"
 #include "../core/alloc_type.hpp"
 #include "../core/bitmath_func.hpp"
+#include "../worker_pool.h"
 #include "grf.hpp"
 
 #include "../safeguards.h"
@@ -42,6 +43,9 @@ DECLARE_ENUM_AS_BIT_SET(SpriteColourComponent)
  */
 static bool WarnCorruptSprite(uint8 file_slot, size_t file_pos, int line)
 {
+	/* Worker threads cannot show errors; the sprite will be loaded again on the main thread. */
+	if (IsWorkerThread()) return false;
+
 	static byte warning_level = 0;
 	if (warning_level == 0) {
 		SetDParamStr(0, FioGetFilename(file_slot));
@@ -80,10 +84,8 @@ bool DecodeSingleSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t fi
 			int size = (code == 0) ? 0x80 : code;
 			num -= size;
 			if (num < 0) return WarnCorruptSprite(file_slot, file_pos, __LINE__);
-			for (; size > 0; size--) {
-				*dest = FioReadByte();
-				dest++;
-			}
+			FioReadBlock(dest, size);
+			dest += size;
 		} else {
 			/* Copy bytes from earlier in the sprite */
 			const uint data_offset = ((code & 7) << 8) | FioReadByte();
@@ -27,8 +27,8 @@ public:
 
 	/**
 	 * Structure for passing information from the sprite loader to the blitter.
-	 * You can only use this struct once at a time when using AllocateData to
-	 * allocate the memory as that will always return the same memory address.
+	 * You can only use this struct once at a time per thread when using AllocateData
+	 * to allocate the memory as that will always return the same memory address.
 	 * This to prevent thousands of malloc + frees just to load a sprite.
 	 */
 	struct Sprite {
@@ -47,7 +47,7 @@ public:
 		void AllocateData(ZoomLevel zoom, size_t size) { this->data = Sprite::buffer[zoom].ZeroAllocate(size); }
 	private:
 		/** Allocated memory to pass sprite data around */
-		static ReusableBuffer<SpriteLoader::CommonPixel> buffer[ZOOM_LVL_COUNT];
+		static thread_local ReusableBuffer<SpriteLoader::CommonPixel> buffer[ZOOM_LVL_COUNT];
 	};
 
 	/**
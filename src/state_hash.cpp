@@ -0,0 +1,119 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file state_hash.cpp Hashes of parts of the game state, for detecting desyncs early. */
+
+#include "stdafx.h"
+#include "state_hash.h"
+#include "map_func.h"
+#include "date_func.h"
+#include "vehicle_base.h"
+#include "station_base.h"
+#include "company_base.h"
+
+#include "safeguards.h"
+
+StateHash _state_hash;                ///< The hashes of the last completed interval.
+static StateHash _state_hash_working; ///< The hashes of the interval that is being hashed.
+
+/**
+ * Add a value to a hash.
+ * @param hash The hash to add to.
+ * @param value The value to add.
+ */
+static inline void StateHashAdd(uint32 &hash, uint32 value)
+{
+	hash = (hash ^ value) * 16777619U;
+}
+
+/** Forget the hashes, as the game state is not the one that was being hashed. */
+void ResetStateHash()
+{
+	_state_hash = {};
+	_state_hash_working = {};
+}
+
+/**
+ * Hash a part of the tiles.
+ * @param hash The hash to add to.
+ * @param begin The first tile to hash.
+ * @param end The tile after the last one to hash.
+ */
+static void HashTiles(uint32 &hash, TileIndex begin, TileIndex end)
+{
+	/* The fields are hashed one by one, so the memory layout of the tiles does not matter. */
+	for (TileIndex t = begin; t < end; t++) {
+		const TileTypeHeight &mth = _mth[t];
+		const Tile &m = _m[t];
+		const TileExtended &me = _me[t];
+		StateHashAdd(hash, mth.type | mth.height << 8 | m.m1 << 16 | m.m3 << 24);
+		StateHashAdd(hash, m.m2 | m.m4 << 16 | m.m5 << 24);
+		StateHashAdd(hash, me.m6 | me.m7 << 8 | me.m8 << 16);
+	}
+}
+
+/**
+ * Hash the next slice of the game state; called every tick.
+ * The slices are chosen by the tick counter, which is the same for every client in the game.
+ */
+void UpdateStateHash()
+{
+	uint slice = _tick_counter % STATE_HASH_INTERVAL;
+	if (slice == 0) _state_hash_working = { true, {} };
+
+	StateHash &h = _state_hash_working;
+
+	HashTiles(h.parts[SHP_MAP], (TileIndex)((uint64)MapSize() * slice / STATE_HASH_INTERVAL), (TileIndex)((uint64)MapSize() * (slice + 1) / STATE_HASH_INTERVAL));
+
+	for (size_t i = slice; i < Vehicle::GetPoolSize(); i += STATE_HASH_INTERVAL) {
+		const Vehicle *v = Vehicle::GetIfValid(i);
+		if (v == nullptr) continue;
+
+		StateHashAdd(h.parts[SHP_VEHICLES], v->index);
+		StateHashAdd(h.parts[SHP_VEHICLES], v->tile);
+		StateHashAdd(h.parts[SHP_VEHICLES], v->x_pos);
+		StateHashAdd(h.parts[SHP_VEHICLES], v->y_pos);
+		StateHashAdd(h.parts[SHP_VEHICLES], v->z_pos);
+		StateHashAdd(h.parts[SHP_VEHICLES], v->direction | v->cur_speed << 16);
+
+		StateHashAdd(h.parts[SHP_CARGO], v->index);
+		StateHashAdd(h.parts[SHP_CARGO], v->cargo.TotalCount());
+	}
+
+	for (size_t i = slice; i < Station::GetPoolSize(); i += STATE_HASH_INTERVAL) {
+		const Station *st = Station::GetIfValid(i);
+		if (st == nullptr) continue;
+
+		StateHashAdd(h.parts[SHP_CARGO], st->index);
+		for (CargoID c = 0; c < NUM_CARGO; c++) {
+			StateHashAdd(h.parts[SHP_CARGO], st->goods[c].cargo.TotalCount());
+		}
+	}
+
+	if (slice == 0) {
+		for (const Company *c : Company::Iterate()) {
+			StateHashAdd(h.parts[SHP_COMPANIES], c->index);
+			StateHashAdd(h.parts[SHP_COMPANIES], (uint32)c->money);
+			StateHashAdd(h.parts[SHP_COMPANIES], (uint32)((uint64)c->money >> 32));
+			StateHashAdd(h.parts[SHP_COMPANIES], (uint32)c->current_loan);
+		}
+	}
+
+	if (slice == STATE_HASH_INTERVAL - 1) _state_hash = _state_hash_working;
+}
+
+/**
+ * Get the name of a part of the game state, for the desync messages.
+ * @param part The part.
+ * @return The name of the part.
+ */
+const char *GetStateHashPartName(StateHashPart part)
+{
+	static const char * const names[] = { "map", "vehicles", "cargo", "companies" };
+	static_assert(lengthof(names) == SHP_END, "names must match StateHashPart");
+	return names[part];
+}
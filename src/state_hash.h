@@ -0,0 +1,43 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file state_hash.h
+ * Hashes of parts of the game state, for detecting desyncs early.
+ *
+ * Every tick a slice of the map, of the vehicles and of the stations is hashed, so after
+ * #STATE_HASH_INTERVAL ticks all of them are, at the cost of a small part per tick. The
+ * completed hashes are sent to the clients with the random seed at the sync frames, and
+ * as there is a hash per part of the game state, a desync also tells what diverged.
+ */
+
+#ifndef STATE_HASH_H
+#define STATE_HASH_H
+
+/** The parts of the game state that are hashed separately. */
+enum StateHashPart {
+	SHP_MAP,       ///< The contents of the tiles.
+	SHP_VEHICLES,  ///< The positions and speeds of the vehicles.
+	SHP_CARGO,     ///< The amounts of cargo in vehicles and stations.
+	SHP_COMPANIES, ///< The money and loans of the companies.
+	SHP_END,       ///< End marker.
+};
+
+static const uint STATE_HASH_INTERVAL = 256; ///< Number of ticks it takes to hash all of the game state; a divisor of the range of the tick counter.
+
+/** Hashes of the parts of the game state. */
+struct StateHash {
+	bool valid;              ///< Whether all of the game state has been hashed; not so after starting in the middle of an interval.
+	uint32 parts[SHP_END];   ///< The hash of each part.
+};
+
+extern StateHash _state_hash;
+
+void ResetStateHash();
+void UpdateStateHash();
+const char *GetStateHashPartName(StateHashPart part);
+
+#endif /* STATE_HASH_H */
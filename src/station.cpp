@@ -21,12 +21,14 @@
 #include "core/pool_func.hpp"
 #include "station_base.h"
 #include "station_kdtree.h"
+#include "waypoint_base.h"
 #include "roadstop_base.h"
 #include "industry.h"
 #include "town.h"
 #include "core/random_func.hpp"
 #include "linkgraph/linkgraph.h"
 #include "linkgraph/linkgraphschedule.h"
+#include "worker_pool.h"
 
 #include "table/strings.h"
 
@@ -36,14 +38,21 @@
 StationPool _station_pool("Station");
 INSTANTIATE_POOL_METHODS(Station)
 
+std::set<StationID> Station::loading_stations;
+
 
 StationKdtree _station_kdtree(Kdtree_StationXYFunc);
+uint _station_rect_max_size; ///< Upper bound for the width and height of the rectangles of all stations.
 
 void RebuildStationKdtree()
 {
 	std::vector<StationID> stids;
+	_station_rect_max_size = 0;
 	for (const Station *st : Station::Iterate()) {
 		stids.push_back(st->index);
+		if (!st->rect.IsEmpty()) {
+			_station_rect_max_size = max<uint>(_station_rect_max_size, max(st->rect.right - st->rect.left, st->rect.bottom - st->rect.top) + 1);
+		}
 	}
 	_station_kdtree.Build(stids.begin(), stids.end());
 }
@@ -90,9 +99,12 @@ Station::~Station()
 		for (CargoID c = 0; c < NUM_CARGO; c++) {
 			this->goods[c].cargo.OnCleanPool();
 		}
+		Station::loading_stations.erase(this->index);
 		return;
 	}
 
+	this->UpdateOwnerAssets(-1);
+
 	while (!this->loading_vehicles.empty()) {
 		this->loading_vehicles.front()->LeaveStation();
 	}
@@ -109,7 +121,7 @@ Station::~Station()
 		for (NodeID node = 0; node < lg->Size(); ++node) {
 			Station *st = Station::Get((*lg)[node].Station());
 			st->goods[c].flows.erase(this->index);
-			if ((*lg)[node][this->goods[c].node].LastUpdate() != INVALID_DATE) {
+			if ((*lg)[node].HasEdgeTo(this->goods[c].node)) {
 				st->goods[c].flows.DeleteFlows(this->index);
 				RerouteCargo(st, c, this->index, st->index);
 			}
@@ -163,6 +175,15 @@ Station::~Station()
 }
 
 
+/**
+ * Get the size of the slots the stations and waypoints are allocated in.
+ * @return The size of the biggest of both.
+ */
+/* static */ size_t BaseStation::GetPoolSlotSize()
+{
+	return max(sizeof(Station), sizeof(Waypoint));
+}
+
 /**
  * Invalidating of the JoinStation window has to be done
  * after removing item from the pool.
@@ -205,11 +226,34 @@ void Station::AddFacility(StationFacility new_facility_bit, TileIndex facil_xy)
 		this->MoveSign(facil_xy);
 		this->random_bits = Random();
 	}
+	this->UpdateOwnerAssets(-1);
 	this->facilities |= new_facility_bit;
 	this->owner = _current_company;
+	this->UpdateOwnerAssets(1);
 	this->build_date = _date;
 }
 
+/**
+ * Called when a facility is removed from the station.
+ * @param facility_bit The facility that is removed.
+ */
+void Station::RemoveFacility(StationFacility facility_bit)
+{
+	this->UpdateOwnerAssets(-1);
+	this->facilities &= ~facility_bit;
+	this->UpdateOwnerAssets(1);
+}
+
+/**
+ * Add the facilities of the station to, or remove them from, the assets of its owner.
+ * @param delta 1 to add the facilities, -1 to remove them.
+ */
+void Station::UpdateOwnerAssets(int delta) const
+{
+	Company *c = Company::GetIfValid(this->owner);
+	if (c != nullptr) c->assets.station_facilities += delta * (int)CountBits((byte)this->facilities);
+}
+
 /**
  * Marks the tiles of the station as dirty.
  *
@@ -402,58 +446,79 @@ bool Station::CatchmentCoversTown(TownID t) const
 }
 
 /**
- * Recompute tiles covered in our catchment area.
- * This will additionally recompute nearby towns and industries.
+ * Check whether the catchment of a station are tiles around its station tiles,
+ * or the tiles of the industry it is the neutral station of.
+ * @param st The station to check.
+ * @return True if the catchment consists of the tiles around the station tiles.
  */
-void Station::RecomputeCatchment()
+static bool HasTileCatchment(const Station *st)
 {
-	this->industries_near.clear();
-	this->RemoveFromAllNearbyLists();
+	return !st->rect.IsEmpty() && (_settings_game.station.serve_neutral_industries || st->industry == nullptr);
+}
 
-	if (this->rect.IsEmpty()) {
-		this->catchment_tiles.Reset();
-		return;
+/**
+ * Check whether the catchment of a station covers its whole catchment rectangle.
+ * That is the case when every tile of the station rectangle is a tile of the
+ * station with the largest catchment radius of the station, e.g. for any
+ * rectangular rail station or a single road stop.
+ * @param st The station, for which #HasTileCatchment holds.
+ * @return True if all tiles of the catchment rectangle are in the catchment.
+ */
+static bool CatchmentCoversRect(const Station *st)
+{
+	uint radius = st->GetCatchmentRadius();
+	if (radius == CA_NONE) return false;
+
+	TileArea ta(TileXY(st->rect.left, st->rect.top), TileXY(st->rect.right, st->rect.bottom));
+	TILE_AREA_LOOP(tile, ta) {
+		if (!IsTileType(tile, MP_STATION) || GetStationIndex(tile) != st->index) return false;
+		if (GetTileCatchmentRadius(tile, st) != radius) return false;
 	}
+	return true;
+}
 
-	if (!_settings_game.station.serve_neutral_industries && this->industry != nullptr) {
-		/* Station is associated with an industry, so we only need to deliver to that industry. */
-		this->catchment_tiles.Initialize(this->industry->location);
-		TILE_AREA_LOOP(tile, this->industry->location) {
-			if (IsTileType(tile, MP_INDUSTRY) && GetIndustryIndex(tile) == this->industry->index) {
-				this->catchment_tiles.SetTile(tile);
-			}
-		}
-		/* The industry's stations_near may have been computed before its neutral station was built so clear and re-add here. */
-		for (Station *st : this->industry->stations_near) {
-			st->industries_near.erase(this->industry);
-		}
-		this->industry->stations_near.clear();
-		this->industry->stations_near.insert(this);
-		this->industries_near.insert(this->industry);
+/**
+ * Compute the tiles around the station tiles that are in the catchment of a station.
+ * This only reads the map and writes the catchment of the station itself, so
+ * it can be done for multiple stations at once.
+ * @param st The station, for which #HasTileCatchment holds.
+ */
+static void ComputeCatchmentTiles(Station *st)
+{
+	/* No need to store, nor to fill, a bitmap of a completely covered rectangle. */
+	if (CatchmentCoversRect(st)) {
+		st->catchment_tiles.InitializeFull(st->GetCatchmentRect());
 		return;
 	}
 
-	this->catchment_tiles.Initialize(GetCatchmentRect());
+	st->catchment_tiles.Initialize(st->GetCatchmentRect());
 
 	/* Loop finding all station tiles */
-	TileArea ta(TileXY(this->rect.left, this->rect.top), TileXY(this->rect.right, this->rect.bottom));
+	TileArea ta(TileXY(st->rect.left, st->rect.top), TileXY(st->rect.right, st->rect.bottom));
 	TILE_AREA_LOOP(tile, ta) {
-		if (!IsTileType(tile, MP_STATION) || GetStationIndex(tile) != this->index) continue;
+		if (!IsTileType(tile, MP_STATION) || GetStationIndex(tile) != st->index) continue;
 
-		uint r = GetTileCatchmentRadius(tile, this);
+		uint r = GetTileCatchmentRadius(tile, st);
 		if (r == CA_NONE) continue;
 
 		/* This tile sub-loop doesn't need to test any tiles, they are simply added to the catchment set. */
 		TileArea ta2 = TileArea(tile, 1, 1).Expand(r);
-		TILE_AREA_LOOP(tile2, ta2) this->catchment_tiles.SetTile(tile2);
+		TILE_AREA_LOOP(tile2, ta2) st->catchment_tiles.SetTile(tile2);
 	}
+}
 
+/**
+ * Add a station to the nearby lists of the towns and industries in its catchment.
+ * @param st The station, for which #HasTileCatchment holds.
+ */
+static void AddToNearbyLists(Station *st)
+{
 	/* Search catchment tiles for towns and industries */
-	BitmapTileIterator it(this->catchment_tiles);
+	BitmapTileIterator it(st->catchment_tiles);
 	for (TileIndex tile = it; tile != INVALID_TILE; tile = ++it) {
 		if (IsTileType(tile, MP_HOUSE)) {
 			Town *t = Town::GetByTile(tile);
-			t->stations_near.insert(this);
+			t->stations_near.insert(st);
 		}
 		if (IsTileType(tile, MP_INDUSTRY)) {
 			Industry *i = Industry::GetByTile(tile);
@@ -461,21 +526,109 @@ void Station::RecomputeCatchment()
 			/* Ignore industry if it has a neutral station. It already can't be this station. */
 			if (!_settings_game.station.serve_neutral_industries && i->neutral_station != nullptr) continue;
 
-			i->stations_near.insert(this);
+			i->stations_near.insert(st);
 
 			/* Add if we can deliver to this industry as well */
-			AddIndustryToDeliver(i, this);
+			AddIndustryToDeliver(i, st);
 		}
 	}
 }
 
+/**
+ * Recompute tiles covered in our catchment area.
+ * This will additionally recompute nearby towns and industries.
+ * @param no_clear_nearby_lists If set, the station is not removed from the nearby lists of
+ *                              the towns and industries first, as those have been cleared already.
+ */
+void Station::RecomputeCatchment(bool no_clear_nearby_lists)
+{
+	this->industries_near.clear();
+	if (!no_clear_nearby_lists) this->RemoveFromAllNearbyLists();
+
+	if (this->rect.IsEmpty()) {
+		this->catchment_tiles.Reset();
+		return;
+	}
+
+	if (!_settings_game.station.serve_neutral_industries && this->industry != nullptr) {
+		/* Station is associated with an industry, so we only need to deliver to that industry. */
+		this->catchment_tiles.Initialize(this->industry->location);
+		TILE_AREA_LOOP(tile, this->industry->location) {
+			if (IsTileType(tile, MP_INDUSTRY) && GetIndustryIndex(tile) == this->industry->index) {
+				this->catchment_tiles.SetTile(tile);
+			}
+		}
+		/* The industry's stations_near may have been computed before its neutral station was built so clear and re-add here. */
+		for (Station *st : this->industry->stations_near) {
+			st->industries_near.erase(this->industry);
+		}
+		this->industry->stations_near.clear();
+		this->industry->stations_near.insert(this);
+		this->industries_near.insert(this->industry);
+		return;
+	}
+
+	ComputeCatchmentTiles(this);
+	AddToNearbyLists(this);
+}
+
 /**
  * Recomputes catchment of all stations.
  * This will additionally recompute nearby stations for all towns and industries.
+ * The catchment tiles of the stations are computed in parallel, the nearby lists
+ * are shared between stations so those are filled afterwards in order of the stations.
  */
 /* static */ void Station::RecomputeCatchmentForAll()
 {
-	for (Station *st : Station::Iterate()) { st->RecomputeCatchment(); }
+	for (Town *t : Town::Iterate()) { t->stations_near.clear(); }
+	for (Industry *i : Industry::Iterate()) { i->stations_near.clear(); }
+
+	std::vector<Station *> stations;
+	for (Station *st : Station::Iterate()) {
+		if (HasTileCatchment(st)) stations.push_back(st);
+	}
+	RunParallelFor((uint)stations.size(), 16, [&stations](uint begin, uint end) {
+		for (uint i = begin; i < end; i++) ComputeCatchmentTiles(stations[i]);
+	});
+
+	for (Station *st : Station::Iterate()) {
+		if (HasTileCatchment(st)) {
+			st->industries_near.clear();
+			AddToNearbyLists(st);
+		} else {
+			st->RecomputeCatchment(true);
+		}
+	}
+}
+
+/**
+ * Add a vehicle to the end of the queue of vehicles loading at this station.
+ * @param v Front vehicle that starts loading.
+ */
+void Station::AddLoadingVehicle(Vehicle *v)
+{
+	this->loading_vehicles.push_back(v);
+	Station::loading_stations.insert(this->index);
+}
+
+/**
+ * Remove a vehicle from the queue of vehicles loading at this station.
+ * @param v Front vehicle that stops loading.
+ */
+void Station::RemoveLoadingVehicle(Vehicle *v)
+{
+	std::vector<Vehicle *>::iterator it = std::find(this->loading_vehicles.begin(), this->loading_vehicles.end(), v);
+	if (it != this->loading_vehicles.end()) this->loading_vehicles.erase(it);
+	if (this->loading_vehicles.empty()) Station::loading_stations.erase(this->index);
+}
+
+/** Rebuild the set of stations with loading vehicles, e.g. after loading a game. */
+/* static */ void Station::RebuildLoadingStations()
+{
+	Station::loading_stations.clear();
+	for (const Station *st : Station::Iterate()) {
+		if (!st->loading_vehicles.empty()) Station::loading_stations.insert(st->index);
+	}
 }
 
 /************************************************************************/
@@ -521,6 +674,7 @@ CommandCost StationRect::BeforeAddTile(TileIndex tile, StationRectMode mode)
 		if (mode != ADD_TEST) {
 			this->left = this->right = x;
 			this->top = this->bottom = y;
+			_station_rect_max_size = max(_station_rect_max_size, 1U);
 		}
 	} else if (!this->PtInExtendedRect(x, y)) {
 		/* current rect is not empty and new point is outside this rect
@@ -539,6 +693,7 @@ CommandCost StationRect::BeforeAddTile(TileIndex tile, StationRectMode mode)
 		if (mode != ADD_TEST) {
 			/* we should update the station rect */
 			*this = new_rect;
+			_station_rect_max_size = max<uint>(_station_rect_max_size, max(w, h));
 		}
 	} else {
 		; // new point is inside the rect, we don't need to do anything
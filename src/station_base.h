@@ -18,6 +18,7 @@
 #include "linkgraph/linkgraph_type.h"
 #include "newgrf_storage.h"
 #include "bitmap_type.h"
+#include "core/flatmap_type.hpp"
 #include <map>
 #include <set>
 
@@ -28,14 +29,15 @@ static const byte INITIAL_STATION_RATING = 175;
 
 /**
  * Flow statistics telling how much flow should be sent along a link. This is
- * done by creating "flow shares" and using std::map's upper_bound() method to
+ * done by creating "flow shares" and using the map's upper_bound() method to
  * look them up with a random number. A flow share is the difference between a
  * key in a map and the previous key. So one key in the map doesn't actually
  * mean anything by itself.
  */
 class FlowStat {
 public:
-	typedef std::map<uint32, StationID> SharesMap;
+	/** Shares by their upper bound; most links only have a few next hops, which are stored in place. */
+	typedef FlatMap<uint32, StationID, 4> SharesMap;
 
 	static const SharesMap empty_sharesmap;
 
@@ -70,7 +72,7 @@ public:
 	inline void AppendShare(StationID st, uint flow, bool restricted = false)
 	{
 		assert(flow > 0);
-		this->shares[(--this->shares.end())->first + flow] = st;
+		this->shares[this->shares.back().first + flow] = st;
 		if (!restricted) this->unrestricted += flow;
 	}
 
@@ -119,7 +121,7 @@ public:
 	inline StationID GetViaWithRestricted(bool &is_restricted) const
 	{
 		assert(!this->shares.empty());
-		uint rand = RandomRange((--this->shares.end())->first);
+		uint rand = RandomRange(this->shares.back().first);
 		is_restricted = rand >= this->unrestricted;
 		return this->shares.upper_bound(rand)->second;
 	}
@@ -475,7 +477,7 @@ public:
 	byte time_since_unload;
 
 	byte last_vehicle_type;
-	std::list<Vehicle *> loading_vehicles;
+	std::vector<Vehicle *> loading_vehicles; ///< Vehicles loading or unloading at this station, in the order they arrived
 	GoodsEntry goods[NUM_CARGO];  ///< Goods at this station
 	CargoTypes always_accepted;       ///< Bitmask of always accepted cargo types (by houses, HQs, industry tiles when industry doesn't accept cargo)
 
@@ -486,6 +488,8 @@ public:
 	~Station();
 
 	void AddFacility(StationFacility new_facility_bit, TileIndex facil_xy);
+	void RemoveFacility(StationFacility facility_bit);
+	void UpdateOwnerAssets(int delta) const;
 
 	void MarkTilesDirty(bool cargo_change) const;
 
@@ -497,9 +501,15 @@ public:
 
 	uint GetPlatformLength(TileIndex tile, DiagDirection dir) const override;
 	uint GetPlatformLength(TileIndex tile) const override;
-	void RecomputeCatchment();
+	void RecomputeCatchment(bool no_clear_nearby_lists = false);
 	static void RecomputeCatchmentForAll();
 
+	void AddLoadingVehicle(Vehicle *v);
+	void RemoveLoadingVehicle(Vehicle *v);
+	static void RebuildLoadingStations();
+
+	static std::set<StationID> loading_stations; ///< NOSAVE: Stations with loading vehicles, in index order.
+
 	uint GetCatchmentRadius() const;
 	Rect GetCatchmentRect() const;
 	bool CatchmentCoversTown(TownID t) const;
@@ -55,6 +55,8 @@
 #include "linkgraph/refresh.h"
 #include "widgets/station_widget.h"
 #include "tunnelbridge_map.h"
+#include "framerate_type.h"
+#include "trace_zone.h"
 
 #include "table/strings.h"
 
@@ -510,7 +512,7 @@ CargoArray GetProductionAroundTiles(TileIndex tile, int w, int h, int rad)
 
 	/* Loop over all tiles to get the produced cargo of
 	 * everything except industries */
-	TILE_AREA_LOOP(tile, ta) {
+	for (TileIndex tile : ta) {
 		if (IsTileType(tile, MP_INDUSTRY)) industries.insert(GetIndustryIndex(tile));
 		AddProducedCargo(tile, produced);
 	}
@@ -548,7 +550,7 @@ CargoArray GetAcceptanceAroundTiles(TileIndex tile, int w, int h, int rad, Cargo
 
 	TileArea ta = TileArea(tile, w, h).Expand(rad);
 
-	TILE_AREA_LOOP(tile, ta) {
+	for (TileIndex tile : ta) {
 		/* Ignore industry if it has a neutral station. */
 		if (!_settings_game.station.serve_neutral_industries && IsTileType(tile, MP_INDUSTRY) && Industry::GetByTile(tile)->neutral_station != nullptr) continue;
 
@@ -1540,6 +1542,24 @@ static void MakeShipStationAreaSmaller(Station *st)
 	UpdateStationDockingTiles(st);
 }
 
+/**
+ * Remove the train facility from a station, keeping the assets of its owner up to date.
+ * @param st The station.
+ */
+static inline void RemoveTrainFacility(Station *st)
+{
+	st->RemoveFacility(FACIL_TRAIN);
+}
+
+/**
+ * Remove the train facility from a waypoint; waypoints do not count for the company value.
+ * @param wp The waypoint.
+ */
+static inline void RemoveTrainFacility(Waypoint *wp)
+{
+	wp->facilities &= ~FACIL_TRAIN;
+}
+
 /**
  * Remove a number of tiles from any rail station within the area.
  * @param ta the area to clear station tile from.
@@ -1636,7 +1656,7 @@ CommandCost RemoveFromRailBaseStation(TileArea ta, std::vector<T *> &affected_st
 
 		/* if we deleted the whole station, delete the train facility. */
 		if (st->train_station.tile == INVALID_TILE) {
-			st->facilities &= ~FACIL_TRAIN;
+			RemoveTrainFacility(st);
 			SetWindowWidgetDirty(WC_STATION_VIEW, st->index, WID_SV_TRAINS);
 			st->UpdateVirtCoord();
 			DeleteStationIfEmpty(st);
@@ -2018,7 +2038,7 @@ static CommandCost RemoveRoadStop(TileIndex tile, DoCommandFlag flags)
 			*primary_stop = cur_stop->next;
 			/* removed the only stop? */
 			if (*primary_stop == nullptr) {
-				st->facilities &= (is_truck ? ~FACIL_TRUCK_STOP : ~FACIL_BUS_STOP);
+				st->RemoveFacility(is_truck ? FACIL_TRUCK_STOP : FACIL_BUS_STOP);
 			}
 		} else {
 			/* tell the predecessor in the list to skip this stop */
@@ -2431,7 +2451,7 @@ static CommandCost RemoveAirport(TileIndex tile, DoCommandFlag flags)
 		st->rect.AfterRemoveRect(st, st->airport);
 
 		st->airport.Clear();
-		st->facilities &= ~FACIL_AIRPORT;
+		st->RemoveFacility(FACIL_AIRPORT);
 
 		InvalidateWindowData(WC_STATION_VIEW, st->index, -1);
 
@@ -2709,7 +2729,7 @@ static CommandCost RemoveDock(TileIndex tile, DoCommandFlag flags)
 		if (st->ship_station.tile == INVALID_TILE) {
 			st->ship_station.Clear();
 			st->docking_station.Clear();
-			st->facilities &= ~FACIL_DOCK;
+			st->RemoveFacility(FACIL_DOCK);
 		}
 
 		Company::Get(st->owner)->infrastructure.station -= 2;
@@ -3629,7 +3649,7 @@ void RerouteCargo(Station *st, CargoID c, StationID avoid, StationID avoid2)
 	ge.cargo.Reroute(UINT_MAX, &ge.cargo, avoid, avoid2, &ge);
 
 	/* Reroute cargo staged to be transferred. */
-	for (std::list<Vehicle *>::iterator it(st->loading_vehicles.begin()); it != st->loading_vehicles.end(); ++it) {
+	for (std::vector<Vehicle *>::iterator it(st->loading_vehicles.begin()); it != st->loading_vehicles.end(); ++it) {
 		for (Vehicle *v = *it; v != nullptr; v = v->Next()) {
 			if (v->cargo_type != c) continue;
 			v->cargo.Reroute(UINT_MAX, &v->cargo, avoid, avoid2, &ge);
@@ -3652,12 +3672,19 @@ void DeleteStaleLinks(Station *from)
 		GoodsEntry &ge = from->goods[c];
 		LinkGraph *lg = LinkGraph::GetIfValid(ge.link_graph);
 		if (lg == nullptr) continue;
-		Node node = (*lg)[ge.node];
-		for (EdgeIterator it(node.Begin()); it != node.End();) {
-			Edge edge = it->second;
-			Station *to = Station::Get((*lg)[it->first].Station());
-			assert(to->goods[c].node == it->first);
-			++it; // Do that before removing the edge. Anything else may crash.
+		/* Refreshing the links below may add nodes and edges, which moves the
+		 * edges around. Remember the destinations and look the edges up again
+		 * whenever they may have moved. */
+		std::vector<NodeID> to_nodes;
+		const LinkGraph *const_lg = lg;
+		ConstNode node = (*const_lg)[ge.node];
+		for (ConstEdgeIterator it(node.Begin()); it != node.End(); ++it) to_nodes.push_back(it->first);
+
+		for (NodeID to_node : to_nodes) {
+			/* Only look at the edge for now; changing it copies it away from a running link graph job. */
+			ConstEdge edge = (*const_lg)[ge.node][to_node];
+			Station *to = Station::Get((*const_lg)[to_node].Station());
+			assert(to->goods[c].node == to_node);
 			assert(_date >= edge.LastUpdate());
 			uint timeout = LinkGraph::MIN_TIMEOUT_DISTANCE + (DistanceManhattan(from->xy, to->xy) >> 3);
 			if ((uint)(_date - edge.LastUpdate()) > timeout) {
@@ -3689,7 +3716,7 @@ void DeleteStaleLinks(Station *from)
 						Vehicle *v = *iter;
 
 						LinkRefresher::Run(v, false); // Don't allow merging. Otherwise lg might get deleted.
-						if (edge.LastUpdate() == _date) {
+						if ((*lg)[ge.node][to_node].LastUpdate() == _date) {
 							updated = true;
 							break;
 						}
@@ -3708,16 +3735,16 @@ void DeleteStaleLinks(Station *from)
 
 				if (!updated) {
 					/* If it's still considered dead remove it. */
-					node.RemoveEdge(to->goods[c].node);
+					(*lg)[ge.node].RemoveEdge(to_node);
 					ge.flows.DeleteFlows(to->index);
 					RerouteCargo(from, c, to->index, from->index);
 				}
 			} else if (edge.LastUnrestrictedUpdate() != INVALID_DATE && (uint)(_date - edge.LastUnrestrictedUpdate()) > timeout) {
-				edge.Restrict();
+				(*lg)[ge.node][to_node].Restrict();
 				ge.flows.RestrictFlows(to->index);
 				RerouteCargo(from, c, to->index, from->index);
 			} else if (edge.LastRestrictedUpdate() != INVALID_DATE && (uint)(_date - edge.LastRestrictedUpdate()) > timeout) {
-				edge.Release();
+				(*lg)[ge.node][to_node].Release();
 			}
 		}
 		assert(_date >= lg->LastCompression());
@@ -3804,40 +3831,54 @@ void IncreaseStats(Station *st, const Vehicle *front, StationID next_station_id)
 	}
 }
 
-/* called for every station each tick */
+/* called for every station each STATION_RATING_TICKS ticks */
 static void StationHandleSmallTick(BaseStation *st)
 {
 	if ((st->facilities & FACIL_WAYPOINT) != 0 || !st->IsInUse()) return;
 
-	byte b = st->delete_ctr + 1;
-	if (b >= STATION_RATING_TICKS) b = 0;
-	st->delete_ctr = b;
+	UpdateStationRating(Station::From(st));
+}
 
-	if (b == 0) UpdateStationRating(Station::From(st));
+/**
+ * Call a handler for all stations that are due for it in this tick. A station
+ * is due whenever (_tick_counter + index) is a multiple of the period, so the
+ * stations due in a tick are the ones with their index in the same residue
+ * class. Those are enumerated directly instead of checking each station.
+ * @param period Number of ticks between two calls of the handler for a station.
+ * @param proc Handler to call for the due stations.
+ */
+template <typename Tproc>
+static void HandleDueStations(uint period, Tproc proc)
+{
+	for (size_t index = (period - _tick_counter % period) % period; index < BaseStation::GetPoolSize(); index += period) {
+		BaseStation *st = BaseStation::GetIfValid(index);
+		if (st == nullptr) continue;
+		PerformanceAccumulator framerate(PFE_GL_STATIONS, (uint32)index);
+		TraceZone zone("Station tick", (uint32)index);
+		proc(st);
+	}
 }
 
 void OnTick_Station()
 {
 	if (_game_mode == GM_EDITOR) return;
 
-	for (BaseStation *st : BaseStation::Iterate()) {
-		StationHandleSmallTick(st);
+	HandleDueStations(STATION_RATING_TICKS, StationHandleSmallTick);
 
-		/* Clean up the link graph about once a week. */
-		if (Station::IsExpected(st) && (_tick_counter + st->index) % STATION_LINKGRAPH_TICKS == 0) {
-			DeleteStaleLinks(Station::From(st));
-		};
+	/* Clean up the link graph about once a week. */
+	HandleDueStations(STATION_LINKGRAPH_TICKS, [](BaseStation *st) {
+		if (Station::IsExpected(st)) DeleteStaleLinks(Station::From(st));
+	});
 
-		/* Run STATION_ACCEPTANCE_TICKS = 250 tick interval trigger for station animation.
-		 * Station index is included so that triggers are not all done
-		 * at the same time. */
-		if ((_tick_counter + st->index) % STATION_ACCEPTANCE_TICKS == 0) {
-			/* Stop processing this station if it was deleted */
-			if (!StationHandleBigTick(st)) continue;
-			TriggerStationAnimation(st, st->xy, SAT_250_TICKS);
-			if (Station::IsExpected(st)) AirportAnimationTrigger(Station::From(st), AAT_STATION_250_TICKS);
-		}
-	}
+	/* Run STATION_ACCEPTANCE_TICKS = 250 tick interval trigger for station animation.
+	 * Station index is included so that triggers are not all done
+	 * at the same time. */
+	HandleDueStations(STATION_ACCEPTANCE_TICKS, [](BaseStation *st) {
+		/* Stop processing this station if it was deleted */
+		if (!StationHandleBigTick(st)) return;
+		TriggerStationAnimation(st, st->xy, SAT_250_TICKS);
+		if (Station::IsExpected(st)) AirportAnimationTrigger(Station::From(st), AAT_STATION_250_TICKS);
+	});
 }
 
 /** Monthly loop for stations. */
@@ -3958,11 +3999,23 @@ CommandCost CmdRenameStation(TileIndex tile, DoCommandFlag flags, uint32 p1, uin
 	return CommandCost();
 }
 
+/** Number of nearby stations up to which they are checked directly, instead of looking them up in the k-d tree first. */
+static const uint NEARBY_STATIONS_DIRECT_CHECK = 8;
+
 static void AddNearbyStationsByCatchment(TileIndex tile, StationList *stations, StationList &nearby)
 {
-	for (Station *st : nearby) {
-		if (st->TileIsInCatchment(tile)) stations->insert(st);
+	if (nearby.size() <= NEARBY_STATIONS_DIRECT_CHECK) {
+		for (Station *st : nearby) {
+			if (st->TileIsInCatchment(tile)) stations->insert(st);
+		}
+		return;
 	}
+
+	/* Many stations around, e.g. in a large city. Only check the ones close to the tile. */
+	uint max_c = _settings_game.station.modified_catchment ? MAX_CATCHMENT : CA_UNMODIFIED;
+	ForAllStationsNearTiles(TileArea(tile, 1, 1), max_c, [&](Station *st) {
+		if (st->TileIsInCatchment(tile) && nearby.count(st) != 0) stations->insert(st);
+	});
 }
 
 /**
@@ -3988,23 +4041,12 @@ void FindStationsAroundTiles(const TileArea &location, StationList * const stati
 		}
 	}
 
-	/* Not using, or don't have a nearby stations list, so we need to scan. */
-	std::set<StationID> seen_stations;
-
-	/* Scan an area around the building covering the maximum possible station
-	 * to find the possible nearby stations. */
+	/* Not using, or don't have a nearby stations list, so we need to look
+	 * for the stations that can have their catchment overlap the area. */
 	uint max_c = _settings_game.station.modified_catchment ? MAX_CATCHMENT : CA_UNMODIFIED;
-	TileArea ta = TileArea(location).Expand(max_c);
-	TILE_AREA_LOOP(tile, ta) {
-		if (IsTileType(tile, MP_STATION)) seen_stations.insert(GetStationIndex(tile));
-	}
-
-	for (StationID stationid : seen_stations) {
-		Station *st = Station::GetIfValid(stationid);
-		if (st == nullptr) continue; /* Waypoint */
-
+	ForAllStationsNearTiles(location, max_c, [&](Station *st) {
 		/* Check if station is attached to an industry */
-		if (!_settings_game.station.serve_neutral_industries && st->industry != nullptr) continue;
+		if (!_settings_game.station.serve_neutral_industries && st->industry != nullptr) return;
 
 		/* Test if the tile is within the station's catchment */
 		TILE_AREA_LOOP(tile, location) {
@@ -4013,7 +4055,7 @@ void FindStationsAroundTiles(const TileArea &location, StationList * const stati
 				break;
 			}
 		}
-	}
+	});
 }
 
 /**
@@ -4488,7 +4530,7 @@ void FlowStat::Invalidate()
 		if (it->first == this->unrestricted) this->unrestricted = i;
 	}
 	this->shares.swap(new_shares);
-	assert(!this->shares.empty() && this->unrestricted <= (--this->shares.end())->first);
+	assert(!this->shares.empty() && this->unrestricted <= this->shares.back().first);
 }
 
 /**
@@ -4742,7 +4784,7 @@ uint FlowStatMap::GetFlow() const
 {
 	uint ret = 0;
 	for (FlowStatMap::const_iterator i = this->begin(); i != this->end(); ++i) {
-		ret += (--(i->second.GetShares()->end()))->first;
+		ret += i->second.GetShares()->back().first;
 	}
 	return ret;
 }
@@ -4770,7 +4812,7 @@ uint FlowStatMap::GetFlowFrom(StationID from) const
 {
 	FlowStatMap::const_iterator i = this->find(from);
 	if (i == this->end()) return 0;
-	return (--(i->second.GetShares()->end()))->first;
+	return i->second.GetShares()->back().first;
 }
 
 /**
@@ -4801,4 +4843,5 @@ extern const TileTypeProcs _tile_type_station_procs = {
 	VehicleEnter_Station,       // vehicle_enter_tile_proc
 	GetFoundation_Station,      // get_foundation_proc
 	TerraformTile_Station,      // terraform_tile_proc
+	nullptr,                    // tile_loop_local_proc
 };
@@ -31,16 +31,59 @@
 #include "town.h"
 #include "linkgraph/linkgraph.h"
 #include "zoom_func.h"
+#include "date_func.h"
+#include "openttd.h"
 
 #include "widgets/station_widget.h"
 
 #include "table/strings.h"
 
+#include <map>
 #include <set>
 #include <vector>
 
 #include "safeguards.h"
 
+/** Cargo gathered around the tile highlight, so repainting a build window doesn't scan the whole catchment again. */
+struct StationCoverageCache {
+	TileIndex tile;       ///< Northern tile of the highlighted area.
+	int w;                ///< X extent of the highlighted area.
+	int h;                ///< Y extent of the highlighted area.
+	int rad;              ///< Catchment radius around the area.
+	Date date;            ///< Date the cargo was gathered on.
+	DateFract date_fract; ///< Tick of the day the cargo was gathered in; the cache is only valid during that tick.
+	CargoArray cargoes;   ///< Accepted or produced cargo around the area.
+};
+
+static StationCoverageCache _station_coverage_cache[2]; ///< Cached accepted [0] and supplied [1] cargo around the tile highlight.
+
+/**
+ * Get the accepted or supplied cargo around some tiles, reusing the result of
+ * the previous call for the same tiles in the same game tick. Build windows
+ * are repainted far more often than the highlight moves or the game state
+ * changes, e.g. whenever something in front of them is redrawn.
+ * @param tile Northern tile of the area.
+ * @param w X extent of the area.
+ * @param h Y extent of the area.
+ * @param rad Catchment radius around the area.
+ * @param supplies If supplied cargo is requested, else accepted cargo.
+ * @return The accepted or supplied cargo.
+ */
+static const CargoArray &GetCoverageAroundTiles(TileIndex tile, int w, int h, int rad, bool supplies)
+{
+	StationCoverageCache &cache = _station_coverage_cache[supplies ? 1 : 0];
+	if (cache.tile != tile || cache.w != w || cache.h != h || cache.rad != rad || cache.date != _date || cache.date_fract != _date_fract || _pause_mode != PM_UNPAUSED) {
+		cache.cargoes = supplies ? GetProductionAroundTiles(tile, w, h, rad) : GetAcceptanceAroundTiles(tile, w, h, rad);
+		cache.tile = tile;
+		cache.w = w;
+		cache.h = h;
+		cache.rad = rad;
+		cache.date = _date;
+		cache.date_fract = _date_fract;
+	}
+	return cache.cargoes;
+}
+
 /**
  * Calculates and draws the accepted or supplied cargo around the selected tile(s)
  * @param left x position where the string is to be drawn
@@ -56,12 +99,7 @@ int DrawStationCoverageAreaText(int left, int right, int top, StationCoverageTyp
 	TileIndex tile = TileVirtXY(_thd.pos.x, _thd.pos.y);
 	CargoTypes cargo_mask = 0;
 	if (_thd.drawstyle == HT_RECT && tile < MapSize()) {
-		CargoArray cargoes;
-		if (supplies) {
-			cargoes = GetProductionAroundTiles(tile, _thd.size.x / TILE_SIZE, _thd.size.y / TILE_SIZE, rad);
-		} else {
-			cargoes = GetAcceptanceAroundTiles(tile, _thd.size.x / TILE_SIZE, _thd.size.y / TILE_SIZE, rad);
-		}
+		const CargoArray &cargoes = GetCoverageAroundTiles(tile, _thd.size.x / TILE_SIZE, _thd.size.y / TILE_SIZE, rad, supplies);
 
 		/* Convert cargo counts to a set of cargo bits, and draw the result. */
 		for (CargoID i = 0; i < NUM_CARGO; i++) {
@@ -1595,27 +1633,36 @@ struct StationViewWindow : public Window {
 	 */
 	void BuildCargoList(CargoID i, const StationCargoList &packets, CargoDataEntry *cargo)
 	{
-		const CargoDataEntry *source_dest = this->cached_destinations.Retrieve(i);
+		/* Sum up the packets per source and next hop first, so the rows are updated once per group instead of once per packet. */
+		std::map<std::pair<StationID, StationID>, uint> groups;
 		for (StationCargoList::ConstIterator it = packets.Packets()->begin(); it != packets.Packets()->end(); it++) {
 			const CargoPacket *cp = *it;
-			StationID next = it.GetKey();
+			groups[std::make_pair(cp->SourceStation(), it.GetKey())] += cp->Count();
+		}
+
+		const CargoDataEntry *source_dest = this->cached_destinations.Retrieve(i);
+		for (const auto &group : groups) {
+			StationID source = group.first.first;
+			StationID next = group.first.second;
+			uint count = group.second;
 
-			const CargoDataEntry *source_entry = source_dest->Retrieve(cp->SourceStation());
+			const CargoDataEntry *source_entry = source_dest->Retrieve(source);
 			if (source_entry == nullptr) {
-				this->ShowCargo(cargo, i, cp->SourceStation(), next, INVALID_STATION, cp->Count());
+				this->ShowCargo(cargo, i, source, next, INVALID_STATION, count);
 				continue;
 			}
 
 			const CargoDataEntry *via_entry = source_entry->Retrieve(next);
 			if (via_entry == nullptr) {
-				this->ShowCargo(cargo, i, cp->SourceStation(), next, INVALID_STATION, cp->Count());
+				this->ShowCargo(cargo, i, source, next, INVALID_STATION, count);
 				continue;
 			}
 
 			for (CargoDataSet::iterator dest_it = via_entry->Begin(); dest_it != via_entry->End(); ++dest_it) {
 				CargoDataEntry *dest_entry = *dest_it;
-				uint val = DivideApprox(cp->Count() * dest_entry->GetCount(), via_entry->GetCount());
-				this->ShowCargo(cargo, i, cp->SourceStation(), next, dest_entry->GetStation(), val);
+				/* Groups can hold much more cargo than a packet; don't let the multiplication overflow. */
+				uint val = (uint)(((uint64)count * dest_entry->GetCount() + via_entry->GetCount() / 2) / via_entry->GetCount());
+				this->ShowCargo(cargo, i, source, next, dest_entry->GetStation(), val);
 			}
 		}
 		this->ShowCargo(cargo, i, NEW_STATION, NEW_STATION, NEW_STATION, packets.ReservedCount());
@@ -18,6 +18,7 @@
 inline uint16 Kdtree_StationXYFunc(StationID stid, int dim) { return (dim == 0) ? TileX(BaseStation::Get(stid)->xy) : TileY(BaseStation::Get(stid)->xy); }
 typedef Kdtree<StationID, decltype(&Kdtree_StationXYFunc), uint16, int> StationKdtree;
 extern StationKdtree _station_kdtree;
+extern uint _station_rect_max_size;
 
 /**
  * Call a function on all stations whose sign is within a radius of a center tile.
@@ -39,4 +40,29 @@ void ForAllStationsRadius(TileIndex center, uint radius, Func func)
 	});
 }
 
+/**
+ * Call a function on all stations that may have tiles within a distance of a tile area.
+ * The sign of a station is always within its rectangle, whose width and height
+ * never exceed #_station_rect_max_size, so only the stations with their sign
+ * close enough to the area are considered. The function is also called for some
+ * stations that turn out to be too far away; it has to check the actual tiles.
+ * @param ta       Tile area to search around.
+ * @param distance Distance in both X and Y to search within.
+ * @param func     The function to call, must take a single parameter which is Station*.
+ */
+template <typename Func>
+void ForAllStationsNearTiles(const TileArea &ta, uint distance, Func func)
+{
+	uint radius = distance + _station_rect_max_size;
+	uint16 x1, y1, x2, y2;
+	x1 = (uint16)max<int>(0, TileX(ta.tile) - radius);
+	x2 = (uint16)min<int>(TileX(ta.tile) + ta.w + radius, MapSizeX());
+	y1 = (uint16)max<int>(0, TileY(ta.tile) - radius);
+	y2 = (uint16)min<int>(TileY(ta.tile) + ta.h + radius, MapSizeY());
+
+	_station_kdtree.FindContained(x1, y1, x2, y2, [&](StationID id) {
+		func(Station::Get(id));
+	});
+}
+
 #endif
@@ -406,6 +406,7 @@ static inline void SetRailStationReservation(TileIndex t, bool b)
 {
 	assert(HasStationRail(t));
 	SB(_me[t].m6, 2, 1, b ? 1 : 0);
+	NotifyReservationChange();
 }
 
 /**
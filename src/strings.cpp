@@ -35,6 +35,7 @@
 #include "game/game_text.hpp"
 #include "network/network_content_gui.h"
 #include <stack>
+#include <unordered_map>
 
 #include "table/strings.h"
 #include "table/control_codes.h"
@@ -191,6 +192,65 @@ static uint _langtab_num[TEXT_TAB_END];   ///< Offset into langpack offs
 static uint _langtab_start[TEXT_TAB_END]; ///< Offset into langpack offs
 static bool _scan_for_gender_data = false;  ///< Are we scanning for the gender of the current string? (instead of formatting it)
 
+/** Key of a string in the formatted string cache: the string and the values of all global string parameters. */
+struct FormattedStringKey {
+	StringID string;                                      ///< The string.
+	uint64 params[lengthof(_global_string_params_data)]; ///< The global string parameters.
+
+	bool operator==(const FormattedStringKey &other) const
+	{
+		return this->string == other.string && memcmp(this->params, other.params, sizeof(this->params)) == 0;
+	}
+};
+
+/** Hash function for #FormattedStringKey. */
+struct FormattedStringKeyHash {
+	size_t operator()(const FormattedStringKey &key) const
+	{
+		uint64 hash = key.string;
+		for (uint64 param : key.params) hash = hash * 0x100000001B3ULL ^ param;
+		return (size_t)(hash ^ (hash >> 32));
+	}
+};
+
+/** A string in the formatted string cache. */
+struct FormattedString {
+	std::string text;                                          ///< The formatted string.
+	WChar types[lengthof(_global_string_params_type)];         ///< The types of the global string parameters after formatting.
+	uint offset;                                               ///< The offset in the global string parameters after formatting.
+	std::vector<std::pair<uint, std::string>> raw_strings;     ///< Index and contents of the raw string parameters.
+
+	/**
+	 * Check whether the raw string parameters still have the contents they had when formatting the string.
+	 * @param params The global string parameters.
+	 * @return True iff the cached text is still valid for the parameters.
+	 */
+	bool HasSameRawStrings(const uint64 *params) const
+	{
+		for (const auto &raw : this->raw_strings) {
+			if (strcmp((const char *)(size_t)params[raw.first], raw.second.c_str()) != 0) return false;
+		}
+		return true;
+	}
+};
+
+/** Maximum number of strings in the formatted string cache. */
+static const size_t MAX_FORMATTED_STRING_CACHE_SIZE = 4096;
+
+/**
+ * Fully formatted strings of #GetString by their parameters. Only strings that
+ * depend on nothing but their parameters, the language and the settings are
+ * cached; the cache is cleared whenever one of the latter might have changed.
+ */
+static std::unordered_map<FormattedStringKey, FormattedString, FormattedStringKeyHash> _formatted_string_cache;
+static bool _formatted_string_cacheable = false; ///< Whether the string being formatted may be put into the formatted string cache.
+
+/** Forget all strings in the formatted string cache. */
+void ClearFormattedStringCache()
+{
+	_formatted_string_cache.clear();
+}
+
 
 const char *GetStringPtr(StringID string)
 {
@@ -229,6 +289,8 @@ char *GetStringWithArgs(char *buffr, StringID string, StringParameters *args, co
 
 		case TEXT_TAB_SPECIAL:
 			if (index >= 0xE4 && !game_script) {
+				/* Some of these, like the resolutions, depend on more than the parameters. */
+				_formatted_string_cacheable = false;
 				return GetSpecialNameString(buffr, index - 0xE4, args, last);
 			}
 			break;
@@ -267,7 +329,51 @@ char *GetString(char *buffr, StringID string, const char *last)
 {
 	_global_string_params.ClearTypeInformation();
 	_global_string_params.offset = 0;
-	return GetStringWithArgs(buffr, string, &_global_string_params, last);
+
+	/* While scanning for genders, or with values on the NewGRF text stack, the parameters do not tell everything. */
+	if (_scan_for_gender_data || UsingNewGRFTextStack()) return GetStringWithArgs(buffr, string, &_global_string_params, last);
+
+	FormattedStringKey key;
+	key.string = string;
+	MemCpyT(key.params, _global_string_params_data, lengthof(key.params));
+
+	auto it = _formatted_string_cache.find(key);
+	if (it != _formatted_string_cache.end() && it->second.text.size() < (size_t)(last - buffr) && it->second.HasSameRawStrings(key.params)) {
+		const FormattedString &cached = it->second;
+		/* Leave the parameters as if the string was formatted, e.g. for CopyOutDParam. */
+		MemCpyT(_global_string_params_type, cached.types, lengthof(cached.types));
+		_global_string_params.offset = cached.offset;
+		return strecpy(buffr, cached.text.c_str(), last);
+	}
+
+	bool outer_cacheable = _formatted_string_cacheable;
+	_formatted_string_cacheable = true;
+	char *end = GetStringWithArgs(buffr, string, &_global_string_params, last);
+
+	/* Only cache strings that were not cut off by the end of the buffer; a character takes at most four bytes. */
+	if (_formatted_string_cacheable && end + 4 < last) {
+		FormattedString cached;
+		cached.text.assign(buffr, end);
+		MemCpyT(cached.types, _global_string_params_type, lengthof(cached.types));
+		cached.offset = _global_string_params.offset;
+		for (uint i = 0; i < lengthof(cached.types); i++) {
+			if (cached.types[i] != SCC_RAW_STRING_POINTER) continue;
+			const char *raw = (const char *)(size_t)key.params[i];
+			if (raw == nullptr) {
+				_formatted_string_cacheable = false;
+				break;
+			}
+			cached.raw_strings.emplace_back(i, raw);
+		}
+
+		if (_formatted_string_cacheable) {
+			if (_formatted_string_cache.size() >= MAX_FORMATTED_STRING_CACHE_SIZE) ClearFormattedStringCache();
+			_formatted_string_cache[key] = std::move(cached);
+		}
+	}
+
+	_formatted_string_cacheable = outer_cacheable && _formatted_string_cacheable;
+	return end;
 }
 
 
@@ -802,12 +908,34 @@ static char *FormatString(char *buff, const char *str_arg, StringParameters *arg
 		const char *&str = str_stack.top();
 
 		if (SCC_NEWGRF_FIRST <= b && b <= SCC_NEWGRF_LAST) {
+			_formatted_string_cacheable = false;
 			/* We need to pass some stuff as it might be modified; oh boy. */
 			//todo: should argve be passed here too?
 			b = RemapNewGRFStringControlCode(b, buf_start, &buff, &str, (int64 *)args->GetDataPointer(), args->GetDataLeft(), dry_run);
 			if (b == 0) continue;
 		}
 
+		switch (b) {
+			/* These strings show game state, which can change without their parameters changing. */
+			case SCC_COMPANY_NAME:
+			case SCC_COMPANY_NUM:
+			case SCC_DEPOT_NAME:
+			case SCC_ENGINE_NAME:
+			case SCC_GROUP_NAME:
+			case SCC_INDUSTRY_NAME:
+			case SCC_PRESIDENT_NAME:
+			case SCC_STATION_NAME:
+			case SCC_TOWN_NAME:
+			case SCC_WAYPOINT_NAME:
+			case SCC_VEHICLE_NAME:
+			case SCC_SIGN_NAME:
+				_formatted_string_cacheable = false;
+				break;
+
+			default:
+				break;
+		}
+
 		switch (b) {
 			case SCC_ENCODED: {
 				uint64 sub_args_data[20];
@@ -1776,6 +1904,7 @@ bool ReadLanguagePack(const LanguageMetadata *lang)
 
 	free(_langpack_offs);
 	_langpack_offs = langpack_offs;
+	ClearFormattedStringCache();
 
 	_current_language = lang;
 	_current_text_dir = (TextDirection)_current_language->text_dir;
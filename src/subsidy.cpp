@@ -112,6 +112,9 @@ Pair SetupSubsidyDecodeParam(const Subsidy *s, bool mode)
 	return p;
 }
 
+/** Towns and industries that may have a part of subsidy flag set, so the flags can be cleared without visiting all of them. */
+static std::vector<std::pair<SourceType, SourceID>> _subsidised_sources_and_destinations;
+
 /**
  * Sets a flag indicating that given town/industry is part of subsidised route.
  * @param type is it a town or an industry?
@@ -121,18 +124,45 @@ Pair SetupSubsidyDecodeParam(const Subsidy *s, bool mode)
 static inline void SetPartOfSubsidyFlag(SourceType type, SourceID index, PartOfSubsidy flag)
 {
 	switch (type) {
-		case ST_INDUSTRY: Industry::Get(index)->part_of_subsidy |= flag; return;
-		case ST_TOWN:   Town::Get(index)->cache.part_of_subsidy |= flag; return;
+		case ST_INDUSTRY: Industry::Get(index)->part_of_subsidy |= flag; break;
+		case ST_TOWN:   Town::Get(index)->cache.part_of_subsidy |= flag; break;
 		default: NOT_REACHED();
 	}
+	_subsidised_sources_and_destinations.emplace_back(type, index);
 }
 
-/** Perform a full rebuild of the subsidies cache. */
-void RebuildSubsidisedSourceAndDestinationCache()
+/**
+ * Gets the flags indicating whether given town/industry is part of a subsidised route.
+ * @param type is it a town or an industry?
+ * @param index index of town/industry
+ * @return the part of subsidy flags
+ */
+static inline PartOfSubsidy GetPartOfSubsidyFlags(SourceType type, SourceID index)
 {
-	for (Town *t : Town::Iterate()) t->cache.part_of_subsidy = POS_NONE;
+	switch (type) {
+		case ST_INDUSTRY: return Industry::Get(index)->part_of_subsidy;
+		case ST_TOWN:   return Town::Get(index)->cache.part_of_subsidy;
+		default: NOT_REACHED();
+	}
+}
 
-	for (Industry *i : Industry::Iterate()) i->part_of_subsidy = POS_NONE;
+/**
+ * Perform a rebuild of the subsidies cache. Only the towns and industries
+ * that were flagged before are reset, so this scales with the number of
+ * subsidies instead of the number of towns and industries.
+ */
+void RebuildSubsidisedSourceAndDestinationCache()
+{
+	/* Entries may refer to towns or industries that have been removed, or to
+	 * ones of a previously loaded game; resetting those is harmless. */
+	for (const auto &it : _subsidised_sources_and_destinations) {
+		switch (it.first) {
+			case ST_INDUSTRY: if (Industry::IsValidID(it.second)) Industry::Get(it.second)->part_of_subsidy = POS_NONE; break;
+			case ST_TOWN:     if (Town::IsValidID(it.second)) Town::Get(it.second)->cache.part_of_subsidy = POS_NONE; break;
+			default: NOT_REACHED();
+		}
+	}
+	_subsidised_sources_and_destinations.clear();
 
 	for (const Subsidy *s : Subsidy::Iterate()) {
 		SetPartOfSubsidyFlag(s->src_type, s->src, POS_SRC);
@@ -173,6 +203,9 @@ void DeleteSubsidyWith(SourceType type, SourceID index)
  */
 static bool CheckSubsidyDuplicate(CargoID cargo, SourceType src_type, SourceID src, SourceType dst_type, SourceID dst)
 {
+	/* Without any subsidy from the source and to the destination there can't be a duplicate. */
+	if (!(GetPartOfSubsidyFlags(src_type, src) & POS_SRC) || !(GetPartOfSubsidyFlags(dst_type, dst) & POS_DST)) return false;
+
 	for (const Subsidy *s : Subsidy::Iterate()) {
 		if (s->cargo_type == cargo &&
 				s->src_type == src_type && s->src == src &&
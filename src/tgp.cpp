@@ -14,6 +14,8 @@
 #include "genworld.h"
 #include "core/random_func.hpp"
 #include "landscape_type.h"
+#include "worker_pool.h"
+#include <vector>
 
 #include "safeguards.h"
 
@@ -201,6 +203,20 @@ static HeightMap _height_map = {nullptr, 0, 0, 0, 0};
 /** Walk through all items of _height_map.h */
 #define FOR_ALL_TILES_IN_HEIGHT(h) for (h = _height_map.h; h < &_height_map.h[_height_map.total_size]; h++)
 
+/** Number of height map rows a thread takes at once in the parallel passes over the height map. */
+static const uint HEIGHT_MAP_ROW_BATCH = 16;
+
+/**
+ * Run a pass over all rows of the height map, splitting the rows over the
+ * worker threads. Every tile must be processed without looking at other
+ * tiles, so the result is the same as when running the pass on one thread.
+ * @param proc Loop body, called with the first row and one past the last row to process.
+ */
+static void HeightMapForAllRows(const ParallelForProc &proc)
+{
+	RunParallelFor(_height_map.size_y + 1, HEIGHT_MAP_ROW_BATCH, proc);
+}
+
 /** Maximum number of TGP noise frequencies. */
 static const int MAX_TGP_FREQUENCIES = 10;
 
@@ -226,12 +242,12 @@ static height_t TGPGetMaxHeight()
 	 * around the mountain to build on. On a 4096x4096 map, it won't cover any major part of the map.
 	 */
 	static const int max_height[5][MAX_MAP_SIZE_BITS - MIN_MAP_SIZE_BITS + 1] = {
-		/* 64  128  256  512 1024 2048 4096 */
-		{   3,   3,   3,   3,   4,   5,   7 }, ///< Very flat
-		{   5,   7,   8,   9,  14,  19,  31 }, ///< Flat
-		{   8,   9,  10,  15,  23,  37,  61 }, ///< Hilly
-		{  10,  11,  17,  19,  49,  63,  73 }, ///< Mountainous
-		{  12,  19,  25,  31,  67,  75,  87 }, ///< Alpinist
+		/* 64  128  256  512 1024 2048 4096 8192 16384 */
+		{   3,   3,   3,   3,   4,   5,   7,   9,   11 }, ///< Very flat
+		{   5,   7,   8,   9,  14,  19,  31,  43,   55 }, ///< Flat
+		{   8,   9,  10,  15,  23,  37,  61,  85,  109 }, ///< Hilly
+		{  10,  11,  17,  19,  49,  63,  73,  83,   93 }, ///< Mountainous
+		{  12,  19,  25,  31,  67,  75,  87,  99,  111 }, ///< Alpinist
 	};
 
 	int max_height_from_table = max_height[_settings_game.difficulty.terrain_type][min(MapLogX(), MapLogY()) - MIN_MAP_SIZE_BITS];
@@ -406,15 +422,38 @@ static void HeightMapGenerate()
 /** Returns min, max and average height from height map */
 static void HeightMapGetMinMaxAvg(height_t *min_ptr, height_t *max_ptr, height_t *avg_ptr)
 {
-	height_t h_min, h_max, h_avg, *h;
+	/** Minimum, maximum and sum of the heights of a batch of rows. */
+	struct RowStats {
+		height_t h_min;
+		height_t h_max;
+		int64 h_accu;
+	};
+	uint batches = CeilDiv(_height_map.size_y + 1, HEIGHT_MAP_ROW_BATCH);
+	std::vector<RowStats> stats(batches);
+
+	/* Get h_min, h_max and accumulate heights per batch of rows; integer sums do not depend on the order of the batches. */
+	RunParallelFor(batches, 1, [&stats](uint begin, uint end) {
+		for (uint b = begin; b < end; b++) {
+			const height_t *first = &_height_map.height(0, b * HEIGHT_MAP_ROW_BATCH);
+			const height_t *last = &_height_map.h[min<int>((b + 1) * HEIGHT_MAP_ROW_BATCH * _height_map.dim_x, _height_map.total_size)];
+			RowStats &s = stats[b];
+			s.h_min = s.h_max = *first;
+			s.h_accu = 0;
+			for (const height_t *h = first; h < last; h++) {
+				if (*h < s.h_min) s.h_min = *h;
+				if (*h > s.h_max) s.h_max = *h;
+				s.h_accu += *h;
+			}
+		}
+	});
+
+	height_t h_min, h_max, h_avg;
 	int64 h_accu = 0;
 	h_min = h_max = _height_map.height(0, 0);
-
-	/* Get h_min, h_max and accumulate heights into h_accu */
-	FOR_ALL_TILES_IN_HEIGHT(h) {
-		if (*h < h_min) h_min = *h;
-		if (*h > h_max) h_max = *h;
-		h_accu += *h;
+	for (const RowStats &s : stats) {
+		h_min = min(h_min, s.h_min);
+		h_max = max(h_max, s.h_max);
+		h_accu += s.h_accu;
 	}
 
 	/* Get average height */
@@ -441,12 +480,16 @@ static int *HeightMapMakeHistogram(height_t h_min, height_t h_max, int *hist_buf
 	return hist;
 }
 
-/** Applies sine wave redistribution onto height map */
-static void HeightMapSineTransform(height_t h_min, height_t h_max)
+/**
+ * Applies sine wave redistribution onto a part of the height map.
+ * @param first First height to transform.
+ * @param last One past the last height to transform.
+ * @param h_min Lowest height to transform.
+ * @param h_max Highest height.
+ */
+static void HeightMapSineTransformRange(height_t *first, height_t *last, height_t h_min, height_t h_max)
 {
-	height_t *h;
-
-	FOR_ALL_TILES_IN_HEIGHT(h) {
+	for (height_t *h = first; h < last; h++) {
 		double fheight;
 
 		if (*h < h_min) continue;
@@ -518,6 +561,14 @@ static void HeightMapSineTransform(height_t h_min, height_t h_max)
 	}
 }
 
+/** Applies sine wave redistribution onto height map */
+static void HeightMapSineTransform(height_t h_min, height_t h_max)
+{
+	HeightMapForAllRows([h_min, h_max](uint begin, uint end) {
+		HeightMapSineTransformRange(&_height_map.height(0, begin), &_height_map.height(0, end), h_min, h_max);
+	});
+}
+
 /**
  * Additional map variety is provided by applying different curve maps
  * to different parts of the map. A randomized low resolution grid contains
@@ -563,9 +614,6 @@ static void HeightMapCurves(uint level)
 		{ lengthof(curve_map_4), curve_map_4 },
 	};
 
-	height_t ht[lengthof(curve_maps)];
-	MemSetT(ht, 0, lengthof(ht));
-
 	/* Set up a grid to choose curve maps based on location; attempt to get a somewhat square grid */
 	float factor = sqrt((float)_height_map.size_x / (float)_height_map.size_y);
 	uint sx = Clamp((int)(((1 << level) * factor) + 0.5), 1, 128);
@@ -576,88 +624,103 @@ static void HeightMapCurves(uint level)
 		c[i] = Random() % lengthof(curve_maps);
 	}
 
-	/* Apply curves */
-	for (int x = 0; x < _height_map.size_x; x++) {
-
-		/* Get our X grid positions and bi-linear ratio */
-		float fx = (float)(sx * x) / _height_map.size_x + 1.0f;
-		uint x1 = (uint)fx;
-		uint x2 = x1;
-		float xr = 2.0f * (fx - x1) - 1.0f;
-		xr = sin(xr * M_PI_2);
-		xr = sin(xr * M_PI_2);
-		xr = 0.5f * (xr + 1.0f);
-		float xri = 1.0f - xr;
-
-		if (x1 > 0) {
-			x1--;
-			if (x2 >= sx) x2--;
-		}
+	/** Grid positions and bi-linear ratio of a row or column of the height map. */
+	struct GridPosition {
+		uint p1;  ///< First grid position.
+		uint p2;  ///< Second grid position.
+		float r;  ///< Ratio of the second grid position.
+		float ri; ///< Ratio of the first grid position.
+	};
 
-		for (int y = 0; y < _height_map.size_y; y++) {
-
-			/* Get our Y grid position and bi-linear ratio */
-			float fy = (float)(sy * y) / _height_map.size_y + 1.0f;
-			uint y1 = (uint)fy;
-			uint y2 = y1;
-			float yr = 2.0f * (fy - y1) - 1.0f;
-			yr = sin(yr * M_PI_2);
-			yr = sin(yr * M_PI_2);
-			yr = 0.5f * (yr + 1.0f);
-			float yri = 1.0f - yr;
-
-			if (y1 > 0) {
-				y1--;
-				if (y2 >= sy) y2--;
-			}
+	/**
+	 * Get the grid positions and bi-linear ratio of a row or column.
+	 * @param s Grid size in this direction.
+	 * @param i Row or column.
+	 * @param size Height map size in this direction.
+	 */
+	auto get_grid_position = [](uint s, int i, int size) {
+		GridPosition pos;
+		float f = (float)(s * i) / size + 1.0f;
+		pos.p1 = (uint)f;
+		pos.p2 = pos.p1;
+		float r = 2.0f * (f - pos.p1) - 1.0f;
+		r = sin(r * M_PI_2);
+		r = sin(r * M_PI_2);
+		pos.r = 0.5f * (r + 1.0f);
+		pos.ri = 1.0f - pos.r;
+
+		if (pos.p1 > 0) {
+			pos.p1--;
+			if (pos.p2 >= s) pos.p2--;
+		}
+		return pos;
+	};
 
-			uint corner_a = c[x1 + sx * y1];
-			uint corner_b = c[x1 + sx * y2];
-			uint corner_c = c[x2 + sx * y1];
-			uint corner_d = c[x2 + sx * y2];
-
-			/* Bitmask of which curve maps are chosen, so that we do not bother
-			 * calculating a curve which won't be used. */
-			uint corner_bits = 0;
-			corner_bits |= 1 << corner_a;
-			corner_bits |= 1 << corner_b;
-			corner_bits |= 1 << corner_c;
-			corner_bits |= 1 << corner_d;
-
-			height_t *h = &_height_map.height(x, y);
-
-			/* Do not touch sea level */
-			if (*h < I2H(1)) continue;
-
-			/* Only scale above sea level */
-			*h -= I2H(1);
-
-			/* Apply all curve maps that are used on this tile. */
-			for (uint t = 0; t < lengthof(curve_maps); t++) {
-				if (!HasBit(corner_bits, t)) continue;
-
-				bool found = false;
-				const control_point_t *cm = curve_maps[t].list;
-				for (uint i = 0; i < curve_maps[t].length - 1; i++) {
-					const control_point_t &p1 = cm[i];
-					const control_point_t &p2 = cm[i + 1];
-
-					if (*h >= p1.x && *h < p2.x) {
-						ht[t] = p1.y + (*h - p1.x) * (p2.y - p1.y) / (p2.x - p1.x);
-						found = true;
-						break;
+	/* The grid positions only depend on the row or column, so determine them once. */
+	std::vector<GridPosition> grid_x(_height_map.size_x);
+	for (int x = 0; x < _height_map.size_x; x++) grid_x[x] = get_grid_position(sx, x, _height_map.size_x);
+	std::vector<GridPosition> grid_y(_height_map.size_y);
+	for (int y = 0; y < _height_map.size_y; y++) grid_y[y] = get_grid_position(sy, y, _height_map.size_y);
+
+	/* Apply curves; every tile only depends on its own height and the grid. */
+	RunParallelFor(_height_map.size_y, HEIGHT_MAP_ROW_BATCH, [&](uint begin, uint end) {
+		height_t ht[lengthof(curve_maps)];
+		MemSetT(ht, 0, lengthof(ht));
+
+		for (uint y = begin; y < end; y++) {
+			const GridPosition &gy = grid_y[y];
+
+			for (int x = 0; x < _height_map.size_x; x++) {
+				const GridPosition &gx = grid_x[x];
+
+				uint corner_a = c[gx.p1 + sx * gy.p1];
+				uint corner_b = c[gx.p1 + sx * gy.p2];
+				uint corner_c = c[gx.p2 + sx * gy.p1];
+				uint corner_d = c[gx.p2 + sx * gy.p2];
+
+				/* Bitmask of which curve maps are chosen, so that we do not bother
+				 * calculating a curve which won't be used. */
+				uint corner_bits = 0;
+				corner_bits |= 1 << corner_a;
+				corner_bits |= 1 << corner_b;
+				corner_bits |= 1 << corner_c;
+				corner_bits |= 1 << corner_d;
+
+				height_t *h = &_height_map.height(x, y);
+
+				/* Do not touch sea level */
+				if (*h < I2H(1)) continue;
+
+				/* Only scale above sea level */
+				*h -= I2H(1);
+
+				/* Apply all curve maps that are used on this tile. */
+				for (uint t = 0; t < lengthof(curve_maps); t++) {
+					if (!HasBit(corner_bits, t)) continue;
+
+					bool found = false;
+					const control_point_t *cm = curve_maps[t].list;
+					for (uint i = 0; i < curve_maps[t].length - 1; i++) {
+						const control_point_t &p1 = cm[i];
+						const control_point_t &p2 = cm[i + 1];
+
+						if (*h >= p1.x && *h < p2.x) {
+							ht[t] = p1.y + (*h - p1.x) * (p2.y - p1.y) / (p2.x - p1.x);
+							found = true;
+							break;
+						}
 					}
+					assert(found);
 				}
-				assert(found);
-			}
 
-			/* Apply interpolation of curve map results. */
-			*h = (height_t)((ht[corner_a] * yri + ht[corner_b] * yr) * xri + (ht[corner_c] * yri + ht[corner_d] * yr) * xr);
+				/* Apply interpolation of curve map results. */
+				*h = (height_t)((ht[corner_a] * gy.ri + ht[corner_b] * gy.r) * gx.ri + (ht[corner_c] * gy.ri + ht[corner_d] * gy.r) * gx.r);
 
-			/* Readd sea level */
-			*h += I2H(1);
+				/* Readd sea level */
+				*h += I2H(1);
+			}
 		}
-	}
+	});
 }
 
 /** Adjusts heights in height map to contain required amount of water tiles */
@@ -665,7 +728,6 @@ static void HeightMapAdjustWaterLevel(amplitude_t water_percent, height_t h_max_
 {
 	height_t h_min, h_max, h_avg, h_water_level;
 	int64 water_tiles, desired_water_tiles;
-	height_t *h;
 	int *hist;
 
 	HeightMapGetMinMaxAvg(&h_min, &h_max, &h_avg);
@@ -690,13 +752,15 @@ static void HeightMapAdjustWaterLevel(amplitude_t water_percent, height_t h_max_
 	 *   values from range: h_water_level..h_max are transformed into 0..h_max_new
 	 *   where h_max_new is depending on terrain type and map size.
 	 */
-	FOR_ALL_TILES_IN_HEIGHT(h) {
-		/* Transform height from range h_water_level..h_max into 0..h_max_new range */
-		*h = (height_t)(((int)h_max_new) * (*h - h_water_level) / (h_max - h_water_level)) + I2H(1);
-		/* Make sure all values are in the proper range (0..h_max_new) */
-		if (*h < 0) *h = I2H(0);
-		if (*h >= h_max_new) *h = h_max_new - 1;
-	}
+	HeightMapForAllRows([h_water_level, h_max, h_max_new](uint begin, uint end) {
+		for (height_t *h = &_height_map.height(0, begin); h < &_height_map.height(0, end); h++) {
+			/* Transform height from range h_water_level..h_max into 0..h_max_new range */
+			*h = (height_t)(((int)h_max_new) * (*h - h_water_level) / (h_max - h_water_level)) + I2H(1);
+			/* Make sure all values are in the proper range (0..h_max_new) */
+			if (*h < 0) *h = I2H(0);
+			if (*h >= h_max_new) *h = h_max_new - 1;
+		}
+	});
 
 	free(hist_buf);
 }
@@ -727,55 +791,62 @@ static void HeightMapCoastLines(uint8 water_borders)
 {
 	int smallest_size = min(_settings_game.game_creation.map_x, _settings_game.game_creation.map_y);
 	const int margin = 4;
-	int y, x;
-	double max_x;
-	double max_y;
-
-	/* Lower to sea level */
-	for (y = 0; y <= _height_map.size_y; y++) {
-		if (HasBit(water_borders, BORDER_NE)) {
-			/* Top right */
-			max_x = abs((perlin_coast_noise_2D(_height_map.size_y - y, y, 0.9, 53) + 0.25) * 5 + (perlin_coast_noise_2D(y, y, 0.35, 179) + 1) * 12);
-			max_x = max((smallest_size * smallest_size / 64) + max_x, (smallest_size * smallest_size / 64) + margin - max_x);
-			if (smallest_size < 8 && max_x > 5) max_x /= 1.5;
-			for (x = 0; x < max_x; x++) {
-				_height_map.height(x, y) = 0;
-			}
-		}
 
-		if (HasBit(water_borders, BORDER_SW)) {
-			/* Bottom left */
-			max_x = abs((perlin_coast_noise_2D(_height_map.size_y - y, y, 0.85, 101) + 0.3) * 6 + (perlin_coast_noise_2D(y, y, 0.45,  67) + 0.75) * 8);
-			max_x = max((smallest_size * smallest_size / 64) + max_x, (smallest_size * smallest_size / 64) + margin - max_x);
-			if (smallest_size < 8 && max_x > 5) max_x /= 1.5;
-			for (x = _height_map.size_x; x > (_height_map.size_x - 1 - max_x); x--) {
-				_height_map.height(x, y) = 0;
+	/* Lower to sea level; every row only writes to itself, so the rows can be done in parallel. */
+	HeightMapForAllRows([water_borders, smallest_size, margin](uint begin, uint end) {
+		for (int y = begin; y < (int)end; y++) {
+			double max_x;
+			int x;
+
+			if (HasBit(water_borders, BORDER_NE)) {
+				/* Top right */
+				max_x = abs((perlin_coast_noise_2D(_height_map.size_y - y, y, 0.9, 53) + 0.25) * 5 + (perlin_coast_noise_2D(y, y, 0.35, 179) + 1) * 12);
+				max_x = max((smallest_size * smallest_size / 64) + max_x, (smallest_size * smallest_size / 64) + margin - max_x);
+				if (smallest_size < 8 && max_x > 5) max_x /= 1.5;
+				for (x = 0; x < max_x; x++) {
+					_height_map.height(x, y) = 0;
+				}
 			}
-		}
-	}
 
-	/* Lower to sea level */
-	for (x = 0; x <= _height_map.size_x; x++) {
-		if (HasBit(water_borders, BORDER_NW)) {
-			/* Top left */
-			max_y = abs((perlin_coast_noise_2D(x, _height_map.size_y / 2, 0.9, 167) + 0.4) * 5 + (perlin_coast_noise_2D(x, _height_map.size_y / 3, 0.4, 211) + 0.7) * 9);
-			max_y = max((smallest_size * smallest_size / 64) + max_y, (smallest_size * smallest_size / 64) + margin - max_y);
-			if (smallest_size < 8 && max_y > 5) max_y /= 1.5;
-			for (y = 0; y < max_y; y++) {
-				_height_map.height(x, y) = 0;
+			if (HasBit(water_borders, BORDER_SW)) {
+				/* Bottom left */
+				max_x = abs((perlin_coast_noise_2D(_height_map.size_y - y, y, 0.85, 101) + 0.3) * 6 + (perlin_coast_noise_2D(y, y, 0.45,  67) + 0.75) * 8);
+				max_x = max((smallest_size * smallest_size / 64) + max_x, (smallest_size * smallest_size / 64) + margin - max_x);
+				if (smallest_size < 8 && max_x > 5) max_x /= 1.5;
+				for (x = _height_map.size_x; x > (_height_map.size_x - 1 - max_x); x--) {
+					_height_map.height(x, y) = 0;
+				}
 			}
 		}
+	});
+
+	/* Lower to sea level; likewise every column only writes to itself. */
+	RunParallelFor(_height_map.size_x + 1, HEIGHT_MAP_ROW_BATCH, [water_borders, smallest_size, margin](uint begin, uint end) {
+		for (int x = begin; x < (int)end; x++) {
+			double max_y;
+			int y;
+
+			if (HasBit(water_borders, BORDER_NW)) {
+				/* Top left */
+				max_y = abs((perlin_coast_noise_2D(x, _height_map.size_y / 2, 0.9, 167) + 0.4) * 5 + (perlin_coast_noise_2D(x, _height_map.size_y / 3, 0.4, 211) + 0.7) * 9);
+				max_y = max((smallest_size * smallest_size / 64) + max_y, (smallest_size * smallest_size / 64) + margin - max_y);
+				if (smallest_size < 8 && max_y > 5) max_y /= 1.5;
+				for (y = 0; y < max_y; y++) {
+					_height_map.height(x, y) = 0;
+				}
+			}
 
-		if (HasBit(water_borders, BORDER_SE)) {
-			/* Bottom right */
-			max_y = abs((perlin_coast_noise_2D(x, _height_map.size_y / 3, 0.85, 71) + 0.25) * 6 + (perlin_coast_noise_2D(x, _height_map.size_y / 3, 0.35, 193) + 0.75) * 12);
-			max_y = max((smallest_size * smallest_size / 64) + max_y, (smallest_size * smallest_size / 64) + margin - max_y);
-			if (smallest_size < 8 && max_y > 5) max_y /= 1.5;
-			for (y = _height_map.size_y; y > (_height_map.size_y - 1 - max_y); y--) {
-				_height_map.height(x, y) = 0;
+			if (HasBit(water_borders, BORDER_SE)) {
+				/* Bottom right */
+				max_y = abs((perlin_coast_noise_2D(x, _height_map.size_y / 3, 0.85, 71) + 0.25) * 6 + (perlin_coast_noise_2D(x, _height_map.size_y / 3, 0.35, 193) + 0.75) * 12);
+				max_y = max((smallest_size * smallest_size / 64) + max_y, (smallest_size * smallest_size / 64) + margin - max_y);
+				if (smallest_size < 8 && max_y > 5) max_y /= 1.5;
+				for (y = _height_map.size_y; y > (_height_map.size_y - 1 - max_y); y--) {
+					_height_map.height(x, y) = 0;
+				}
 			}
 		}
-	}
+	});
 }
 
 /** Start at given point, move in given direction, find and Smooth coast in that direction */
@@ -999,12 +1070,14 @@ void GenerateTerrainPerlin()
 
 	int max_height = H2I(TGPGetMaxHeight());
 
-	/* Transfer height map into OTTD map */
-	for (int y = 0; y < _height_map.size_y; y++) {
-		for (int x = 0; x < _height_map.size_x; x++) {
-			TgenSetTileHeight(TileXY(x, y), Clamp(H2I(_height_map.height(x, y)), 0, max_height));
+	/* Transfer height map into OTTD map; every tile is set on its own, so do the rows in parallel. */
+	RunParallelFor(_height_map.size_y, HEIGHT_MAP_ROW_BATCH, [max_height](uint begin, uint end) {
+		for (uint y = begin; y < end; y++) {
+			for (int x = 0; x < _height_map.size_x; x++) {
+				TgenSetTileHeight(TileXY(x, y), Clamp(H2I(_height_map.height(x, y)), 0, max_height));
+			}
 		}
-	}
+	});
 
 	IncreaseGeneratingWorldProgress(GWP_LANDSCAPE);
 
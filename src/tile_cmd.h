@@ -138,6 +138,27 @@ typedef Foundation GetFoundationProc(TileIndex tile, Slope tileh);
  */
 typedef CommandCost TerraformTileProc(TileIndex tile, DoCommandFlag flags, int z_new, Slope tileh_new);
 
+/** Result of a #TileLoopLocalProc. */
+enum TileLoopLocalResult {
+	TLLR_SERIAL, ///< The tile loop may affect more than the tile itself; it has to be run by the tile_loop_proc.
+	TLLR_DONE,   ///< The tile loop has been run and nothing visible changed.
+	TLLR_DIRTY,  ///< The tile loop has been run and the tile has to be redrawn.
+};
+
+/**
+ * Tile callback function signature of the local tile loop callback.
+ *
+ * The function is called for many tiles at the same time. When the tile loop of the tile
+ * only depends on and changes the tile itself (no randomness, no neighbouring tiles being
+ * changed, no redrawing) it has to run the tile loop and return #TLLR_DONE or #TLLR_DIRTY.
+ * Otherwise it must not change anything and return #TLLR_SERIAL, after which the tile loop
+ * is run by the tile_loop_proc.
+ *
+ * @param tile The tile to run the tile loop for.
+ * @return How the tile loop has been handled.
+ */
+typedef TileLoopLocalResult TileLoopLocalProc(TileIndex tile);
+
 /**
  * Set of callback functions for performing tile operations of a given tile type.
  * @see TileType
@@ -157,15 +178,43 @@ struct TileTypeProcs {
 	VehicleEnterTileProc *vehicle_enter_tile_proc; ///< Called when a vehicle enters a tile
 	GetFoundationProc *get_foundation_proc;
 	TerraformTileProc *terraform_tile_proc;        ///< Called when a terraforming operation is about to take place
+	TileLoopLocalProc *tile_loop_local_proc;       ///< Called to run the tile loop of a tile in parallel with other tiles, if possible
 };
 
 extern const TileTypeProcs * const _tile_type_procs[16];
 
-TrackStatus GetTileTrackStatus(TileIndex tile, TransportType mode, uint sub_mode, DiagDirection side = INVALID_DIAGDIR);
 VehicleEnterTileStatus VehicleEnterTile(Vehicle *v, TileIndex tile, int x, int y);
 void ChangeTileOwner(TileIndex tile, Owner old_owner, Owner new_owner);
 void GetTileDesc(TileIndex tile, TileDesc *td);
 
+/**
+ * Returns information about trackdirs and signal states.
+ * If there is any trackbit at 'side', return all trackdirbits.
+ * For TRANSPORT_ROAD, return no trackbits if there is no roadbit (of given subtype) at given side.
+ * @param tile tile to get info about
+ * @param mode transport type
+ * @param sub_mode for TRANSPORT_ROAD, roadtypes to check
+ * @param side side we are entering from, INVALID_DIAGDIR to return all trackbits
+ * @return trackdirbits and other info depending on 'mode'
+ */
+static inline TrackStatus GetTileTrackStatus(TileIndex tile, TransportType mode, uint sub_mode, DiagDirection side = INVALID_DIAGDIR)
+{
+	TileType type = GetTileType(tile);
+	switch (type) {
+		/* These tiles never have any tracks; skip the call into their tile procs. */
+		case MP_CLEAR:
+		case MP_HOUSE:
+		case MP_TREES:
+		case MP_INDUSTRY:
+		case MP_OBJECT:
+		case MP_VOID:
+			return 0;
+
+		default:
+			return _tile_type_procs[type]->get_tile_track_status_proc(tile, mode, sub_mode, side);
+	}
+}
+
 static inline void AddAcceptedCargo(TileIndex tile, CargoArray &acceptance, CargoTypes *always_accepted)
 {
 	AddAcceptedCargoProc *proc = _tile_type_procs[GetTileType(tile)]->add_accepted_cargo_proc;
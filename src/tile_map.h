@@ -14,6 +14,7 @@
 #include "map_func.h"
 #include "core/bitmath_func.hpp"
 #include "settings_type.h"
+#include "pathfinder/water_regions.h"
 
 /**
  * Returns the height of a tile
@@ -29,7 +30,7 @@
 static inline uint TileHeight(TileIndex tile)
 {
 	assert(tile < MapSize());
-	return _m[tile].height;
+	return _mth[tile].height;
 }
 
 /**
@@ -58,7 +59,7 @@ static inline void SetTileHeight(TileIndex tile, uint height)
 {
 	assert(tile < MapSize());
 	assert(height <= MAX_TILE_HEIGHT);
-	_m[tile].height = height;
+	_mth[tile].height = height;
 }
 
 /**
@@ -96,7 +97,7 @@ static inline uint TilePixelHeightOutsideMap(int x, int y)
 static inline TileType GetTileType(TileIndex tile)
 {
 	assert(tile < MapSize());
-	return (TileType)GB(_m[tile].type, 4, 4);
+	return (TileType)GB(_mth[tile].type, 4, 4);
 }
 
 /**
@@ -116,6 +117,25 @@ static inline bool IsInnerTile(TileIndex tile)
 	return x < MapMaxX() && y < MapMaxY() && ((x > 0 && y > 0) || !_settings_game.construction.freeform_edges);
 }
 
+/**
+ * Check whether flooding from a tile cannot reach any of its neighbours, because they all are water.
+ * @param tile The tile to check.
+ * @return True when the water tile loop found all neighbours to be water, and none of them changed since.
+ */
+static inline bool IsFloodStableTile(TileIndex tile)
+{
+	return HasBit(_flood_stable_tiles[tile / 8], tile % 8);
+}
+
+/**
+ * Mark that flooding from a tile cannot reach any of its neighbours.
+ * @param tile The tile whose neighbours all are water.
+ */
+static inline void SetFloodStableTile(TileIndex tile)
+{
+	SetBit(_flood_stable_tiles[tile / 8], tile % 8);
+}
+
 /**
  * Set the type of a tile
  *
@@ -135,7 +155,18 @@ static inline void SetTileType(TileIndex tile, TileType type)
 	 * edges of the map. If _settings_game.construction.freeform_edges is true,
 	 * the upper edges of the map are also VOID tiles. */
 	assert(IsInnerTile(tile) == (type != MP_VOID));
-	SB(_m[tile].type, 4, 4, type);
+	SB(_mth[tile].type, 4, 4, type);
+
+	/* The tile and its neighbours may be able to flood again. */
+	for (int dy = -1; dy <= 1; dy++) {
+		for (int dx = -1; dx <= 1; dx++) {
+			TileIndex t = tile + dy * (int)MapSizeX() + dx;
+			if (t < MapSize()) ClrBit(_flood_stable_tiles[t / 8], t % 8);
+		}
+	}
+
+	/* Ships may be able to go elsewhere now. */
+	InvalidateWaterRegion(tile);
 }
 
 /**
@@ -226,7 +257,7 @@ static inline void SetTropicZone(TileIndex tile, TropicZone type)
 {
 	assert(tile < MapSize());
 	assert(!IsTileType(tile, MP_VOID) || type == TROPICZONE_NORMAL);
-	SB(_m[tile].type, 0, 2, type);
+	SB(_mth[tile].type, 0, 2, type);
 }
 
 /**
@@ -238,7 +269,7 @@ static inline void SetTropicZone(TileIndex tile, TropicZone type)
 static inline TropicZone GetTropicZone(TileIndex tile)
 {
 	assert(tile < MapSize());
-	return (TropicZone)GB(_m[tile].type, 0, 2);
+	return (TropicZone)GB(_mth[tile].type, 0, 2);
 }
 
 /**
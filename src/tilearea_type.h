@@ -12,6 +12,8 @@
 
 #include "map_func.h"
 
+class OrthogonalTileIterator;
+
 /** Represents the covered area of e.g. a rail station */
 struct OrthogonalTileArea {
 	TileIndex tile; ///< The base tile of the area
@@ -50,6 +52,9 @@ struct OrthogonalTileArea {
 
 	void ClampToMap();
 
+	inline OrthogonalTileIterator begin() const;
+	inline OrthogonalTileIterator end() const;
+
 	/**
 	 * Get the center tile.
 	 * @return The tile at the center, or just north of it.
@@ -123,6 +128,15 @@ public:
 		return this->tile;
 	}
 
+	/**
+	 * Get the tile we are currently at.
+	 * @return The tile we are at, or INVALID_TILE when we're done.
+	 */
+	inline TileIndex operator *() const
+	{
+		return this->tile;
+	}
+
 	/**
 	 * Move ourselves to the next tile in the rectangle on the map.
 	 */
@@ -184,6 +198,24 @@ public:
 	}
 };
 
+/**
+ * Get an iterator for going over the tiles of the area, so it can be used in range based for loops.
+ * @return Iterator at the first tile of the area.
+ */
+inline OrthogonalTileIterator OrthogonalTileArea::begin() const
+{
+	return OrthogonalTileIterator(*this);
+}
+
+/**
+ * Get the iterator a range based for loop ends at.
+ * @return Iterator that is done.
+ */
+inline OrthogonalTileIterator OrthogonalTileArea::end() const
+{
+	return OrthogonalTileIterator(OrthogonalTileArea());
+}
+
 /** Iterator to iterate over a diagonal area of the map. */
 class DiagonalTileIterator : public TileIterator {
 private:
@@ -17,6 +17,7 @@
 #include "cargotype.h"
 #include "tilematrix_type.hpp"
 #include <list>
+#include <set>
 
 template <typename T>
 struct BuildingCounts {
@@ -91,8 +92,9 @@ struct Town : TownPool::PoolItem<&_town_pool> {
 
 	uint16 time_until_rebuild;       ///< time until we rebuild a house
 
-	uint16 grow_counter;             ///< counter to count when to grow, value is smaller than or equal to growth_rate
+	uint16 grow_counter;             ///< counter to count when to grow, value is smaller than or equal to growth_rate; only up to date while the town is not in #growth_schedule, see GetGrowCounter()
 	uint16 growth_rate;              ///< town growth rate
+	uint64 grow_tick;                ///< NOSAVE: Value of #growth_ticks at which the town grows next, or 0 when it is not in #growth_schedule.
 
 	byte fund_buildings_months;      ///< fund buildings program in action?
 	byte road_build_months;          ///< fund road reconstruction in action?
@@ -143,8 +145,22 @@ struct Town : TownPool::PoolItem<&_town_pool> {
 		return Town::Get(GetTownIndex(tile));
 	}
 
+	/**
+	 * Get the number of ticks until the town grows again.
+	 * @return The grow counter of the town.
+	 */
+	inline uint16 GetGrowCounter() const
+	{
+		if (this->grow_tick == 0) return this->grow_counter;
+		return (uint16)(this->grow_tick - Town::growth_ticks - 1);
+	}
+
 	static Town *GetRandom();
 	static void PostDestructor(size_t index);
+	static void RebuildGrowthSchedule();
+
+	static uint64 growth_ticks; ///< NOSAVE: Number of ticks towns have been given the chance to grow.
+	static std::set<std::pair<uint64, TownID>> growth_schedule; ///< NOSAVE: Growing towns by the tick they grow next, in index order per tick.
 
 private:
 	void FillCachedName() const;
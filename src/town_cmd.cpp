@@ -48,6 +48,8 @@
 #include "object_base.h"
 #include "ai/ai.hpp"
 #include "game/game.hpp"
+#include "framerate_type.h"
+#include "trace_zone.h"
 
 #include "table/strings.h"
 #include "table/town_land.h"
@@ -61,6 +63,43 @@ CargoTypes _town_cargoes_accepted; ///< Bitmap of all cargoes accepted by houses
 TownPool _town_pool("Town");
 INSTANTIATE_POOL_METHODS(Town)
 
+uint64 Town::growth_ticks;
+std::set<std::pair<uint64, TownID>> Town::growth_schedule;
+
+/**
+ * Take a town out of the growth schedule and bring its grow counter up to date.
+ * This has to be done before changing the grow counter or the growth flags.
+ * @param t The town to unschedule.
+ */
+static void UnscheduleTownGrowth(Town *t)
+{
+	if (t->grow_tick == 0) return;
+	t->grow_counter = t->GetGrowCounter();
+	Town::growth_schedule.erase(std::make_pair(t->grow_tick, t->index));
+	t->grow_tick = 0;
+}
+
+/**
+ * Put a town into the growth schedule according to its grow counter, if it is growing.
+ * @param t The town to schedule, which may not be in the schedule yet.
+ */
+static void ScheduleTownGrowth(Town *t)
+{
+	assert(t->grow_tick == 0);
+	if (!HasBit(t->flags, TOWN_IS_GROWING)) return;
+	t->grow_tick = Town::growth_ticks + t->grow_counter + 1;
+	Town::growth_schedule.insert(std::make_pair(t->grow_tick, t->index));
+}
+
+/** Rebuild the growth schedule from the grow counters of the towns, e.g. after loading a game. */
+/* static */ void Town::RebuildGrowthSchedule()
+{
+	for (Town *t : Town::Iterate()) {
+		UnscheduleTownGrowth(t);
+		ScheduleTownGrowth(t);
+	}
+}
+
 
 TownKdtree _town_kdtree(&Kdtree_TownXYFunc);
 
@@ -104,6 +143,8 @@ Town::~Town()
 	free(this->name);
 	free(this->text);
 
+	UnscheduleTownGrowth(this);
+
 	if (CleaningPool()) return;
 
 	/* Delete town authority window
@@ -540,8 +581,12 @@ static void TileLoop_Town(TileIndex tile)
 	StationFinder stations(TileArea(tile, 1, 1));
 
 	if (HasBit(hs->callback_mask, CBM_HOUSE_PRODUCE_CARGO)) {
+		/* All calls are for the same house tile, so they can share the resolver. */
+		HouseResolverObject object(house_id, tile, t, CBID_HOUSE_PRODUCE_CARGO, 0, r);
 		for (uint i = 0; i < 256; i++) {
-			uint16 callback = GetHouseCallback(CBID_HOUSE_PRODUCE_CARGO, i, r, house_id, t, tile);
+			object.callback_param1 = i;
+			object.ResetState();
+			uint16 callback = object.ResolveCallback();
 
 			if (callback == CALLBACK_FAILED || callback == CALLBACK_HOUSEPRODCARGO_END) break;
 
@@ -862,28 +907,42 @@ void UpdateTownCargoBitmap()
 
 static bool GrowTown(Town *t);
 
+/**
+ * Grow a town whose grow counter ran out, and schedule its next growth.
+ * @param t The town, which has to be the first one in the growth schedule.
+ */
 static void TownTickHandler(Town *t)
 {
-	if (HasBit(t->flags, TOWN_IS_GROWING)) {
-		int i = (int)t->grow_counter - 1;
-		if (i < 0) {
-			if (GrowTown(t)) {
-				i = t->growth_rate;
-			} else {
-				/* If growth failed wait a bit before retrying */
-				i = min(t->growth_rate, TOWN_GROWTH_TICKS - 1);
-			}
-		}
-		t->grow_counter = i;
+	assert(Town::growth_schedule.begin()->second == t->index);
+	Town::growth_schedule.erase(Town::growth_schedule.begin());
+	t->grow_tick = 0;
+	t->grow_counter = 0;
+
+	uint16 i;
+	if (GrowTown(t)) {
+		i = t->growth_rate;
+	} else {
+		/* If growth failed wait a bit before retrying */
+		i = min(t->growth_rate, TOWN_GROWTH_TICKS - 1);
 	}
+
+	/* Growing may have updated the growth rate, and with that put the town back into the schedule. */
+	UnscheduleTownGrowth(t);
+	t->grow_counter = i;
+	ScheduleTownGrowth(t);
 }
 
 void OnTick_Town()
 {
 	if (_game_mode == GM_EDITOR) return;
 
-	for (Town *t : Town::Iterate()) {
-		TownTickHandler(t);
+	/* Instead of counting down the grow counter of every town, only handle the towns that are due. */
+	Town::growth_ticks++;
+	while (!Town::growth_schedule.empty() && Town::growth_schedule.begin()->first == Town::growth_ticks) {
+		TownID index = Town::growth_schedule.begin()->second;
+		PerformanceAccumulator framerate(PFE_GL_TOWNS, index);
+		TraceZone zone("Town tick", index);
+		TownTickHandler(Town::Get(index));
 	}
 }
 
@@ -2441,6 +2500,50 @@ static bool CheckTownBuild2x2House(TileIndex *tile, Town *t, int maxz, bool nosl
  * @param tile where the house will be built
  * @return false iff no house can be built at this tile
  */
+/** Houses that may be built on a tile of a given town zone and climate, see GetTownHouseCandidates(). */
+struct TownHouseCandidates {
+	bool valid;                  ///< Whether the lists are up to date with the house specs.
+	std::vector<HouseID> houses; ///< Houses that may be built, in order of their IDs.
+	std::vector<uint> probs;     ///< Probability of each of the houses.
+};
+
+/** Candidate houses per town zone and climate; the climate index is one higher than the climate, the first being "above the snow line". */
+static TownHouseCandidates _town_house_candidates[HZB_END][NUM_LANDSCAPE + 1];
+
+/**
+ * Get the houses that may be built on a tile, according to the house specs.
+ * The specs only change when loading NewGRFs, so the lists are only built
+ * once per town zone and climate instead of for every house to build.
+ * @param rad Town zone of the tile.
+ * @param land Climate of the tile, or -1 if it is above the snow line.
+ * @return Candidate houses with their probabilities.
+ */
+static const TownHouseCandidates &GetTownHouseCandidates(HouseZonesBits rad, int land)
+{
+	TownHouseCandidates &candidates = _town_house_candidates[rad][land + 1];
+	if (candidates.valid) return candidates;
+
+	/* bits 0-4 are used
+	 * bits 11-15 are used
+	 * bits 5-10 are not used. */
+	uint bitmask = (1 << rad) + (1 << (land + 12));
+
+	candidates.houses.clear();
+	candidates.probs.clear();
+	for (uint i = 0; i < NUM_HOUSES; i++) {
+		const HouseSpec *hs = HouseSpec::Get(i);
+
+		/* Verify that the candidate house spec matches the current tile status */
+		if ((~hs->building_availability & bitmask) != 0 || !hs->enabled || hs->grf_prop.override != INVALID_HOUSE_ID) continue;
+
+		/* Without NewHouses, all houses have probability '1' */
+		candidates.houses.push_back((HouseID)i);
+		candidates.probs.push_back(_loaded_newgrf_features.has_newhouses ? hs->probability : 1);
+	}
+	candidates.valid = true;
+	return candidates;
+}
+
 static bool BuildTownHouse(Town *t, TileIndex tile)
 {
 	/* forbidden building here by town layout */
@@ -2460,23 +2563,17 @@ static bool BuildTownHouse(Town *t, TileIndex tile)
 	int land = _settings_game.game_creation.landscape;
 	if (land == LT_ARCTIC && maxz > HighestSnowLine()) land = -1;
 
-	uint bitmask = (1 << rad) + (1 << (land + 12));
-
-	/* bits 0-4 are used
-	 * bits 11-15 are used
-	 * bits 5-10 are not used. */
 	HouseID houses[NUM_HOUSES];
 	uint num = 0;
 	uint probs[NUM_HOUSES];
 	uint probability_max = 0;
 
 	/* Generate a list of all possible houses that can be built. */
-	for (uint i = 0; i < NUM_HOUSES; i++) {
+	const TownHouseCandidates &candidates = GetTownHouseCandidates(rad, land);
+	for (size_t j = 0; j < candidates.houses.size(); j++) {
+		HouseID i = candidates.houses[j];
 		const HouseSpec *hs = HouseSpec::Get(i);
 
-		/* Verify that the candidate house spec matches the current tile status */
-		if ((~hs->building_availability & bitmask) != 0 || !hs->enabled || hs->grf_prop.override != INVALID_HOUSE_ID) continue;
-
 		/* Don't let these counters overflow. Global counters are 32bit, there will never be that many houses. */
 		if (hs->class_id != HOUSE_NO_CLASS) {
 			/* id_count is always <= class_count, so it doesn't need to be checked */
@@ -2486,11 +2583,10 @@ static bool BuildTownHouse(Town *t, TileIndex tile)
 			if (t->cache.building_counts.id_count[i] == UINT16_MAX) continue;
 		}
 
-		/* Without NewHouses, all houses have probability '1' */
-		uint cur_prob = (_loaded_newgrf_features.has_newhouses ? hs->probability : 1);
+		uint cur_prob = candidates.probs[j];
 		probability_max += cur_prob;
 		probs[num] = cur_prob;
-		houses[num++] = (HouseID)i;
+		houses[num++] = i;
 	}
 
 	TileIndex baseTile = tile;
@@ -2799,6 +2895,7 @@ CommandCost CmdTownGrowthRate(TileIndex tile, DoCommandFlag flags, uint32 p1, ui
 	if (t == nullptr) return CMD_ERROR;
 
 	if (flags & DC_EXEC) {
+		UnscheduleTownGrowth(t);
 		if (p2 == 0) {
 			/* Just clear the flag, UpdateTownGrowth will determine a proper growth rate */
 			ClrBit(t->flags, TOWN_CUSTOM_GROWTH);
@@ -3140,6 +3237,7 @@ static CommandCost TownActionFundBuildings(Town *t, DoCommandFlag flags)
 
 		/* Enable growth (also checking GameScript's opinion) */
 		UpdateTownGrowth(t);
+		UnscheduleTownGrowth(t);
 
 		/* Build a new house, but add a small delay to make sure
 		 * that spamming funding doesn't let town grow any faster
@@ -3150,6 +3248,7 @@ static CommandCost TownActionFundBuildings(Town *t, DoCommandFlag flags)
 		 * spam funding with the exact same efficiency.
 		 */
 		t->grow_counter = min(t->grow_counter, 2 * TOWN_GROWTH_TICKS - (t->growth_rate - t->grow_counter) % TOWN_GROWTH_TICKS);
+		ScheduleTownGrowth(t);
 
 		SetWindowDirty(WC_TOWN_VIEW, t->index);
 	}
@@ -3310,11 +3409,10 @@ CommandCost CmdDoTownAction(TileIndex tile, DoCommandFlag flags, uint32 p1, uint
 template <typename Func>
 static void ForAllStationsNearTown(Town *t, Func func)
 {
-	/* Ideally the search radius should be close to the actual town zone 0 radius.
-	 * The true radius is not stored or calculated anywhere, only the squared radius. */
-	/* The efficiency of this search might be improved for large towns and many stations on the map,
-	 * by using an integer square root approximation giving a value not less than the true square root. */
-	uint search_radius = t->cache.squared_town_zone_radius[0] / 2;
+	/* The search radius should be close to the actual town zone 0 radius, so the station kdtree
+	 * only visits few stations outside the zone. Only the squared radius is stored; the rounded
+	 * integer square root plus one is never less than the true radius. */
+	uint search_radius = IntSqrt(t->cache.squared_town_zone_radius[0]) + 1;
 	ForAllStationsRadius(t->xy, search_radius, [&](const Station * st) {
 		if (DistanceSquare(st->xy, t->xy) <= t->cache.squared_town_zone_radius[0]) {
 			func(st);
@@ -3422,20 +3520,20 @@ static uint GetNormalGrowthRate(Town *t)
 static void UpdateTownGrowthRate(Town *t)
 {
 	if (HasBit(t->flags, TOWN_CUSTOM_GROWTH)) return;
+	UnscheduleTownGrowth(t);
 	uint old_rate = t->growth_rate;
 	t->growth_rate = GetNormalGrowthRate(t);
 	UpdateTownGrowCounter(t, old_rate);
+	ScheduleTownGrowth(t);
 	SetWindowDirty(WC_TOWN_VIEW, t->index);
 }
 
 /**
- * Updates town growth state (whether it is growing or not).
- * @param t The town to update growth for
+ * Updates whether the conditions for town growth are met.
+ * @param t The town to update the flag for
  */
-static void UpdateTownGrowth(Town *t)
+static void UpdateTownIsGrowing(Town *t)
 {
-	UpdateTownGrowthRate(t);
-
 	ClrBit(t->flags, TOWN_IS_GROWING);
 	SetWindowDirty(WC_TOWN_VIEW, t->index);
 
@@ -3470,6 +3568,19 @@ static void UpdateTownGrowth(Town *t)
 	SetWindowDirty(WC_TOWN_VIEW, t->index);
 }
 
+/**
+ * Updates town growth state (whether it is growing or not).
+ * @param t The town to update growth for
+ */
+static void UpdateTownGrowth(Town *t)
+{
+	UpdateTownGrowthRate(t);
+
+	UnscheduleTownGrowth(t);
+	UpdateTownIsGrowing(t);
+	ScheduleTownGrowth(t);
+}
+
 static void UpdateTownAmounts(Town *t)
 {
 	for (CargoID i = 0; i < NUM_CARGO; i++) t->supplied[i].NewMonth();
@@ -3749,6 +3860,7 @@ extern const TileTypeProcs _tile_type_town_procs = {
 	nullptr,                    // vehicle_enter_tile_proc
 	GetFoundation_Town,      // get_foundation_proc
 	TerraformTile_Town,      // terraform_tile_proc
+	nullptr,                 // tile_loop_local_proc
 };
 
 
@@ -3761,4 +3873,9 @@ void ResetHouses()
 
 	/* Reset any overrides that have been set. */
 	_house_mngr.ResetOverride();
+
+	/* The house specs are about to change, so the candidates have to be found again. */
+	for (auto &zone : _town_house_candidates) {
+		for (TownHouseCandidates &candidates : zone) candidates.valid = false;
+	}
 }
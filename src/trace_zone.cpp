@@ -0,0 +1,106 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file trace_zone.cpp Recording of nested time zones of the game loop to a trace file. */
+
+#include "stdafx.h"
+#include "trace_zone.h"
+#include "fileio_func.h"
+#include "console_func.h"
+#include <chrono>
+#include <mutex>
+
+#include "safeguards.h"
+
+std::atomic<bool> _trace_zones_active(false); ///< Whether zones are being recorded.
+
+static std::mutex _trace_zones_mutex;    ///< Mutex for writing zones, which may end on multiple threads at once.
+static FILE *_trace_zones_file = nullptr; ///< File the zones are written to.
+static uint64 _trace_zones_start = 0;     ///< Time the recording started, in microseconds.
+static uint _trace_zones_count = 0;       ///< Number of zones written to the file.
+
+/**
+ * Get the current time for zones.
+ * @return The time in microseconds.
+ */
+uint64 TraceZoneGetTime()
+{
+	using namespace std::chrono;
+	return (uint64)time_point_cast<microseconds>(steady_clock::now()).time_since_epoch().count();
+}
+
+/**
+ * Get a small number identifying the current thread in the trace.
+ * @return The number of the thread, the first thread recording a zone being 1.
+ */
+static uint GetTraceThreadId()
+{
+	static std::atomic<uint> next_id(1);
+	static thread_local uint id = next_id++;
+	return id;
+}
+
+/**
+ * Write a zone that ended to the trace.
+ * @param name Name of the zone.
+ * @param id The item processed in the zone, or #TraceZone::NO_ID.
+ * @param start_time Start of the zone, in microseconds.
+ */
+void TraceZoneRecord(const char *name, uint32 id, uint64 start_time)
+{
+	uint64 end_time = TraceZoneGetTime();
+	uint tid = GetTraceThreadId();
+
+	std::lock_guard<std::mutex> lock(_trace_zones_mutex);
+	/* Recording may have stopped while the zone was open. */
+	if (_trace_zones_file == nullptr || start_time < _trace_zones_start) return;
+
+	fprintf(_trace_zones_file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":" OTTD_PRINTF64 ",\"dur\":" OTTD_PRINTF64,
+			_trace_zones_count == 0 ? "" : ",\n", name, tid, (int64)(start_time - _trace_zones_start), (int64)(end_time - start_time));
+	if (id != TraceZone::NO_ID) fprintf(_trace_zones_file, ",\"args\":{\"id\":%u}", id);
+	fputc('}', _trace_zones_file);
+	_trace_zones_count++;
+}
+
+/**
+ * Start recording zones to a trace file.
+ * @param filename The file to write to.
+ * @return True if recording started.
+ */
+bool TraceZonesStart(const char *filename)
+{
+	TraceZonesStop();
+
+	FILE *f = FioFOpenFile(filename, "w", BASE_DIR);
+	if (f == nullptr) return false;
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", f);
+
+	std::lock_guard<std::mutex> lock(_trace_zones_mutex);
+	_trace_zones_file = f;
+	_trace_zones_start = TraceZoneGetTime();
+	_trace_zones_count = 0;
+	_trace_zones_active.store(true, std::memory_order_relaxed);
+	return true;
+}
+
+/**
+ * Stop recording zones, and finish the trace file.
+ * @return True if zones were being recorded.
+ */
+bool TraceZonesStop()
+{
+	std::lock_guard<std::mutex> lock(_trace_zones_mutex);
+	if (_trace_zones_file == nullptr) return false;
+
+	_trace_zones_active.store(false, std::memory_order_relaxed);
+	fputs("\n]}\n", _trace_zones_file);
+	FioFCloseFile(_trace_zones_file);
+	_trace_zones_file = nullptr;
+
+	IConsolePrintF(CC_INFO, "Wrote %u zones to the trace.", _trace_zones_count);
+	return true;
+}
@@ -0,0 +1,61 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file trace_zone.h
+ * Recording of nested time zones of the game loop to a trace file.
+ *
+ * The trace is written in the Chrome trace event format, which can be opened with
+ * chrome://tracing, Perfetto, or imported into Tracy with its \c import-chrome tool.
+ * Unlike the measurements of framerate_type.h, zones are not summed up per tick, so
+ * the trace shows which vehicle, station or company took how long in which tick.
+ */
+
+#ifndef TRACE_ZONE_H
+#define TRACE_ZONE_H
+
+#include <atomic>
+
+extern std::atomic<bool> _trace_zones_active;
+
+uint64 TraceZoneGetTime();
+void TraceZoneRecord(const char *name, uint32 id, uint64 start_time);
+
+/**
+ * Scope of a zone of the trace. Zones can be nested, and are recorded when they end.
+ * When no trace is being recorded, a zone costs a single check.
+ */
+class TraceZone {
+	const char *name;  ///< Name of the zone, or \c nullptr when the zone is not recorded.
+	uint32 id;         ///< The item processed in the zone, or #NO_ID.
+	uint64 start_time; ///< Start of the zone, in microseconds.
+
+public:
+	static const uint32 NO_ID = UINT32_MAX; ///< Id of zones that do not process a specific item.
+
+	/**
+	 * Start a zone of the trace.
+	 * @param name Name of the zone; a string literal, or \c nullptr to not record this zone.
+	 * @param id The item processed in the zone, like the index of a vehicle or company.
+	 */
+	inline TraceZone(const char *name, uint32 id = NO_ID) : name(nullptr), id(id)
+	{
+		if (name == nullptr || !_trace_zones_active.load(std::memory_order_relaxed)) return;
+		this->name = name;
+		this->start_time = TraceZoneGetTime();
+	}
+
+	/** End the zone, and record it. */
+	inline ~TraceZone()
+	{
+		if (this->name != nullptr) TraceZoneRecord(this->name, this->id, this->start_time);
+	}
+};
+
+bool TraceZonesStart(const char *filename);
+bool TraceZonesStop();
+
+#endif /* TRACE_ZONE_H */
@@ -13,6 +13,7 @@
 #include "command_func.h"
 #include "pathfinder/npf/npf_func.h"
 #include "pathfinder/yapf/yapf.hpp"
+#include "pathfinder/pf_trace.h"
 #include "news_func.h"
 #include "company_func.h"
 #include "newgrf_sound.h"
@@ -31,6 +32,7 @@
 #include "company_base.h"
 #include "newgrf.h"
 #include "order_backup.h"
+#include "depot_func.h"
 #include "zoom_func.h"
 #include "newgrf_debug.h"
 #include "framerate_type.h"
@@ -671,10 +673,10 @@ static void NormalizeTrainVehInDepot(const Train *u)
 static void AddRearEngineToMultiheadedTrain(Train *v)
 {
 	Train *u = new Train();
-	v->value >>= 1;
-	u->value = v->value;
+	SetVehicleValue(v, v->value >> 1);
 	u->direction = v->direction;
 	u->owner = v->owner;
+	SetVehicleValue(u, v->value);
 	u->tile = v->tile;
 	u->x_pos = v->x_pos;
 	u->y_pos = v->y_pos;
@@ -1500,35 +1502,32 @@ static void MarkTrainAsStuck(Train *v)
 	}
 }
 
+/**
+ * Get the up/down flags of a vehicle part when it is driving in the opposite direction.
+ * @param flags The ground vehicle flags of the part.
+ * @return #GVF_GOINGDOWN_BIT when going up, #GVF_GOINGUP_BIT when going down, nothing otherwise.
+ */
+static uint16 GetReversedInclinationFlags(uint16 flags)
+{
+	if (HasBit(flags, GVF_GOINGUP_BIT)) return 1 << GVF_GOINGDOWN_BIT;
+	if (HasBit(flags, GVF_GOINGDOWN_BIT)) return 1 << GVF_GOINGUP_BIT;
+	return 0;
+}
+
 /**
  * Swap the two up/down flags in two ways:
- * - Swap values of \a swap_flag1 and \a swap_flag2, and
+ * - Swap values of the flags of \a a and \a b, and
  * - If going up previously (#GVF_GOINGUP_BIT set), the #GVF_GOINGDOWN_BIT is set, and vice versa.
- * @param[in,out] swap_flag1 First train flag.
- * @param[in,out] swap_flag2 Second train flag.
+ * @param a First train part.
+ * @param b Second train part, may be the same as \a a.
  */
-static void SwapTrainFlags(uint16 *swap_flag1, uint16 *swap_flag2)
+static void SwapTrainFlags(Train *a, Train *b)
 {
-	uint16 flag1 = *swap_flag1;
-	uint16 flag2 = *swap_flag2;
-
-	/* Clear the flags */
-	ClrBit(*swap_flag1, GVF_GOINGUP_BIT);
-	ClrBit(*swap_flag1, GVF_GOINGDOWN_BIT);
-	ClrBit(*swap_flag2, GVF_GOINGUP_BIT);
-	ClrBit(*swap_flag2, GVF_GOINGDOWN_BIT);
+	uint16 flags_a = GetReversedInclinationFlags(b->gv_flags);
+	uint16 flags_b = GetReversedInclinationFlags(a->gv_flags);
 
-	/* Reverse the rail-flags (if needed) */
-	if (HasBit(flag1, GVF_GOINGUP_BIT)) {
-		SetBit(*swap_flag2, GVF_GOINGDOWN_BIT);
-	} else if (HasBit(flag1, GVF_GOINGDOWN_BIT)) {
-		SetBit(*swap_flag2, GVF_GOINGUP_BIT);
-	}
-	if (HasBit(flag2, GVF_GOINGUP_BIT)) {
-		SetBit(*swap_flag1, GVF_GOINGDOWN_BIT);
-	} else if (HasBit(flag2, GVF_GOINGDOWN_BIT)) {
-		SetBit(*swap_flag1, GVF_GOINGUP_BIT);
-	}
+	a->SetInclinationFlags(flags_a);
+	b->SetInclinationFlags(flags_b);
 }
 
 /**
@@ -1595,7 +1594,7 @@ void ReverseTrainSwapVeh(Train *v, int l, int r)
 		Swap(a->tile,  b->tile);
 		Swap(a->z_pos, b->z_pos);
 
-		SwapTrainFlags(&a->gv_flags, &b->gv_flags);
+		SwapTrainFlags(a, b);
 
 		UpdateStatusAfterSwap(a);
 		UpdateStatusAfterSwap(b);
@@ -1603,7 +1602,7 @@ void ReverseTrainSwapVeh(Train *v, int l, int r)
 		/* Swap GVF_GOINGUP_BIT/GVF_GOINGDOWN_BIT.
 		 * This is a little bit redundant way, a->gv_flags will
 		 * be (re)set twice, but it reduces code duplication */
-		SwapTrainFlags(&a->gv_flags, &a->gv_flags);
+		SwapTrainFlags(a, a);
 		UpdateStatusAfterSwap(a);
 	}
 }
@@ -1997,6 +1996,10 @@ static FindDepotData FindClosestTrainDepot(Train *v, int max_distance)
 	PBSTileInfo origin = FollowTrainReservation(v);
 	if (IsRailDepotTile(origin.tile)) return FindDepotData(origin.tile, 0);
 
+	/* The search may start at either end of the train, or at the end of its reservation. */
+	const TileIndex tiles[] = { v->tile, origin.tile, v->Last()->tile };
+	if (!IsDepotWithinPenalty(TRANSPORT_RAIL, tiles, lengthof(tiles), max_distance)) return FindDepotData();
+
 	switch (_settings_game.pf.pathfinder_for_trains) {
 		case VPF_NPF: return NPFTrainFindNearestDepot(v, max_distance);
 		case VPF_YAPF: return YapfTrainFindNearestDepot(v, max_distance);
@@ -2305,12 +2308,18 @@ static const byte _initial_tile_subcoord[6][4][3] = {
  */
 static Track DoTrainPathfind(const Train *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, bool do_track_reservation, PBSTileInfo *dest)
 {
+	PfTraceRequest trace(v, tile, enterdir);
+	Track track;
+
 	switch (_settings_game.pf.pathfinder_for_trains) {
-		case VPF_NPF: return NPFTrainChooseTrack(v, path_found, do_track_reservation, dest);
-		case VPF_YAPF: return YapfTrainChooseTrack(v, tile, enterdir, tracks, path_found, do_track_reservation, dest);
+		case VPF_NPF: track = NPFTrainChooseTrack(v, path_found, do_track_reservation, dest); break;
+		case VPF_YAPF: track = YapfTrainChooseTrack(v, tile, enterdir, tracks, path_found, do_track_reservation, dest); break;
 
 		default: NOT_REACHED();
 	}
+
+	trace.Finish(track, path_found);
+	return track;
 }
 
 /**
@@ -3894,7 +3903,7 @@ Money Train::GetRunningCost() const
  */
 bool Train::Tick()
 {
-	PerformanceAccumulator framerate(PFE_GL_TRAINS);
+	PerformanceAccumulator framerate(PFE_GL_TRAINS, this->index);
 
 	this->tick_counter++;
 
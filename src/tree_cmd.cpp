@@ -604,9 +604,10 @@ static void TileLoopTreesDesert(TileIndex tile)
 static void TileLoopTreesAlps(TileIndex tile)
 {
 	int k = GetTileZ(tile) - GetSnowLine() + 1;
+	TreeGround ground = GetTreeGround(tile);
 
 	if (k < 0) {
-		switch (GetTreeGround(tile)) {
+		switch (ground) {
 			case TREE_GROUND_SNOW_DESERT: SetTreeGroundDensity(tile, TREE_GROUND_GRASS, 3); break;
 			case TREE_GROUND_ROUGH_SNOW:  SetTreeGroundDensity(tile, TREE_GROUND_ROUGH, 3); break;
 			default: return;
@@ -614,13 +615,13 @@ static void TileLoopTreesAlps(TileIndex tile)
 	} else {
 		uint density = min<uint>(k, 3);
 
-		if (GetTreeGround(tile) != TREE_GROUND_SNOW_DESERT && GetTreeGround(tile) != TREE_GROUND_ROUGH_SNOW) {
-			TreeGround tg = GetTreeGround(tile) == TREE_GROUND_ROUGH ? TREE_GROUND_ROUGH_SNOW : TREE_GROUND_SNOW_DESERT;
+		if (ground != TREE_GROUND_SNOW_DESERT && ground != TREE_GROUND_ROUGH_SNOW) {
+			TreeGround tg = ground == TREE_GROUND_ROUGH ? TREE_GROUND_ROUGH_SNOW : TREE_GROUND_SNOW_DESERT;
 			SetTreeGroundDensity(tile, tg, density);
 		} else if (GetTreeDensity(tile) != density) {
-			SetTreeGroundDensity(tile, GetTreeGround(tile), density);
+			SetTreeGroundDensity(tile, ground, density);
 		} else {
-			if (GetTreeDensity(tile) == 3) {
+			if (density == 3) {
 				uint32 r = Random();
 				if (Chance16I(1, 200, r) && _settings_client.sound.ambient) {
 					SndPlayTileFx((r & 0x80000000) ? SND_39_HEAVY_WIND : SND_34_WIND, tile);
@@ -645,6 +646,7 @@ static void TileLoop_Trees(TileIndex tile)
 
 	AmbientSoundEffect(tile);
 
+	/* The counter is not changed by the ground handling above, nor by the grass growth below. */
 	uint treeCounter = GetTreeCounter(tile);
 
 	/* Handle growth of grass (under trees/on MP_TREES tiles) at every 8th processings, like it's done for grass on MP_CLEAR tiles. */
@@ -655,7 +657,9 @@ static void TileLoop_Trees(TileIndex tile)
 			MarkTileDirtyByTile(tile);
 		}
 	}
-	if (GetTreeCounter(tile) < 15) {
+
+	/* Most of the time only the counter advances; the trees only grow every 16th processing. */
+	if (treeCounter < 15) {
 		AddTreeCounter(tile, 1);
 		return;
 	}
@@ -812,4 +816,5 @@ extern const TileTypeProcs _tile_type_trees_procs = {
 	nullptr,                     // vehicle_enter_tile_proc
 	GetFoundation_Trees,      // get_foundation_proc
 	TerraformTile_Trees,      // terraform_tile_proc
+	nullptr,                  // tile_loop_local_proc
 };
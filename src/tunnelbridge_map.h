@@ -106,6 +106,7 @@ static inline void SetTunnelBridgeReservation(TileIndex t, bool b)
 	assert(IsTileType(t, MP_TUNNELBRIDGE));
 	assert(GetTunnelBridgeTransportType(t) == TRANSPORT_RAIL);
 	SB(_m[t].m5, 4, 1, b ? 1 : 0);
+	NotifyReservationChange();
 }
 
 /**
@@ -43,6 +43,7 @@
 #include "sound_func.h"
 #include "effectvehicle_func.h"
 #include "effectvehicle_base.h"
+#include "disaster_vehicle.h"
 #include "vehiclelist.h"
 #include "bridge_map.h"
 #include "tunnel_map.h"
@@ -51,6 +52,7 @@
 #include "linkgraph/linkgraph.h"
 #include "linkgraph/refresh.h"
 #include "framerate_type.h"
+#include "trace_zone.h"
 
 #include "table/strings.h"
 
@@ -352,6 +354,8 @@ Vehicle::Vehicle(VehicleType type)
 	this->cargo_age_counter  = 1;
 	this->last_station_visited = INVALID_STATION;
 	this->last_loading_station = INVALID_STATION;
+	this->counted_tile       = INVALID_TILE;
+	this->counted_tunnel_bridge = INVALID_TILE;
 }
 
 /**
@@ -363,25 +367,54 @@ byte VehicleRandomBits()
 	return GB(Random(), 0, 8);
 }
 
-/* Size of the hash, 6 = 64 x 64, 7 = 128 x 128. Larger sizes will (in theory) reduce hash
- * lookup times at the expense of memory usage. */
-const int HASH_BITS = 7;
-const int HASH_SIZE = 1 << HASH_BITS;
-const int HASH_MASK = HASH_SIZE - 1;
-const int TOTAL_HASH_SIZE = 1 << (HASH_BITS * 2);
-const int TOTAL_HASH_MASK = TOTAL_HASH_SIZE - 1;
+/* Size of the hash along each axis, 7 = 128 x 128. The size scales with the map, as larger
+ * sizes reduce hash lookup times at the expense of memory usage. At the maximum each bucket
+ * of a 4096 x 4096 map holds 16 tiles. */
+static const uint MIN_HASH_BITS = 7;
+static const uint MAX_HASH_BITS = 10;
 
 /* Resolution of the hash, 0 = 1*1 tile, 1 = 2*2 tiles, 2 = 4*4 tiles, etc.
  * Profiling results show that 0 is fastest. */
-const int HASH_RES = 0;
+static const uint HASH_RES = 0;
 
-static Vehicle *_vehicle_tile_hash[TOTAL_HASH_SIZE];
+static uint _vehicle_tile_hash_bits_x = MIN_HASH_BITS; ///< Size of the tile hash along the X axis.
+static uint _vehicle_tile_hash_bits_y = MIN_HASH_BITS; ///< Size of the tile hash along the Y axis.
+
+/**
+ * First vehicle of each bucket of the tile location hash. Looking up vehicles
+ * only reads the hash, so lookups may run concurrently as long as no vehicle
+ * is moved, added or removed at the same time.
+ */
+static std::vector<Vehicle *> _vehicle_tile_hash;
+
+/**
+ * Get the column of the tile location hash for a tile coordinate.
+ * @param x The X coordinate of the tile.
+ * @return The column.
+ */
+static inline int GetVehicleTileHashX(uint x)
+{
+	return GB(x, HASH_RES, _vehicle_tile_hash_bits_x);
+}
+
+/**
+ * Get the (shifted) row of the tile location hash for a tile coordinate.
+ * @param y The Y coordinate of the tile.
+ * @return The row, already multiplied by the number of columns.
+ */
+static inline int GetVehicleTileHashY(uint y)
+{
+	return GB(y, HASH_RES, _vehicle_tile_hash_bits_y) << _vehicle_tile_hash_bits_x;
+}
 
 static Vehicle *VehicleFromTileHash(int xl, int yl, int xu, int yu, void *data, VehicleFromPosProc *proc, bool find_first)
 {
-	for (int y = yl; ; y = (y + (1 << HASH_BITS)) & (HASH_MASK << HASH_BITS)) {
-		for (int x = xl; ; x = (x + 1) & HASH_MASK) {
-			Vehicle *v = _vehicle_tile_hash[(x + y) & TOTAL_HASH_MASK];
+	const int x_mask = (1 << _vehicle_tile_hash_bits_x) - 1;
+	const int y_mask = ((1 << _vehicle_tile_hash_bits_y) - 1) << _vehicle_tile_hash_bits_x;
+
+	for (int y = yl; ; y = (y + (1 << _vehicle_tile_hash_bits_x)) & y_mask) {
+		for (int x = xl; ; x = (x + 1) & x_mask) {
+			Vehicle *v = _vehicle_tile_hash[x + y];
 			for (; v != nullptr; v = v->hash_tile_next) {
 				Vehicle *a = proc(v, data);
 				if (find_first && a != nullptr) return a;
@@ -411,10 +444,10 @@ static Vehicle *VehicleFromPosXY(int x, int y, void *data, VehicleFromPosProc *p
 	const int COLL_DIST = 6;
 
 	/* Hash area to scan is from xl,yl to xu,yu */
-	int xl = GB((x - COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS);
-	int xu = GB((x + COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS);
-	int yl = GB((y - COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS) << HASH_BITS;
-	int yu = GB((y + COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS) << HASH_BITS;
+	int xl = GetVehicleTileHashX((x - COLL_DIST) / TILE_SIZE);
+	int xu = GetVehicleTileHashX((x + COLL_DIST) / TILE_SIZE);
+	int yl = GetVehicleTileHashY((y - COLL_DIST) / TILE_SIZE);
+	int yu = GetVehicleTileHashY((y + COLL_DIST) / TILE_SIZE);
 
 	return VehicleFromTileHash(xl, yl, xu, yu, data, proc, find_first);
 }
@@ -466,10 +499,10 @@ bool HasVehicleOnPosXY(int x, int y, void *data, VehicleFromPosProc *proc)
  */
 static Vehicle *VehicleFromPos(TileIndex tile, void *data, VehicleFromPosProc *proc, bool find_first)
 {
-	int x = GB(TileX(tile), HASH_RES, HASH_BITS);
-	int y = GB(TileY(tile), HASH_RES, HASH_BITS) << HASH_BITS;
+	int x = GetVehicleTileHashX(TileX(tile));
+	int y = GetVehicleTileHashY(TileY(tile));
 
-	Vehicle *v = _vehicle_tile_hash[(x + y) & TOTAL_HASH_MASK];
+	Vehicle *v = _vehicle_tile_hash[x + y];
 	for (; v != nullptr; v = v->hash_tile_next) {
 		if (v->tile != tile) continue;
 
@@ -547,6 +580,26 @@ CommandCost EnsureNoVehicleOnGround(TileIndex tile)
 	return CommandCost();
 }
 
+/**
+ * Number of trains, road vehicles and ships at each tunnel or bridge head,
+ * including the ones in the wormhole that starts at the head, so checking
+ * whether a tunnel or bridge is free does not need to look through the tile
+ * location hash.
+ */
+static std::map<TileIndex, uint> _tunnel_bridge_vehicle_count;
+
+/**
+ * Get the number of trains, road vehicles and ships at a tunnel or bridge
+ * head, including the ones in the wormhole that starts at the head.
+ * @param tile The tunnel or bridge head.
+ * @return The number of vehicles.
+ */
+static uint GetTunnelBridgeVehicleCount(TileIndex tile)
+{
+	auto it = _tunnel_bridge_vehicle_count.find(tile);
+	return it == _tunnel_bridge_vehicle_count.end() ? 0 : it->second;
+}
+
 /** Procedure called for every vehicle found in tunnel/bridge in the hash map */
 static Vehicle *GetVehicleTunnelBridgeProc(Vehicle *v, void *data)
 {
@@ -565,6 +618,11 @@ static Vehicle *GetVehicleTunnelBridgeProc(Vehicle *v, void *data)
  */
 CommandCost TunnelBridgeIsFree(TileIndex tile, TileIndex endtile, const Vehicle *ignore)
 {
+	/* Mostly the tunnel/bridge is free, which the counts tell without looking for the vehicles. */
+	uint count = GetTunnelBridgeVehicleCount(tile) + GetTunnelBridgeVehicleCount(endtile);
+	if (ignore != nullptr && (ignore->counted_tunnel_bridge == tile || ignore->counted_tunnel_bridge == endtile)) count--;
+	if (count == 0) return CommandCost();
+
 	/* Value v is not safe in MP games, however, it is used to generate a local
 	 * error message only (which may be different for different machines).
 	 * Such a message does not affect MP synchronisation.
@@ -607,17 +665,92 @@ CommandCost EnsureNoTrainOnTrackBits(TileIndex tile, TrackBits track_bits)
 	return CommandCost();
 }
 
+/**
+ * Number of train vehicles on each tile, so finding a train on a tile does
+ * not need to look through the tile location hash. The counts that do not
+ * fit in a byte continue in #_train_tile_count_overflow.
+ */
+static std::vector<byte> _train_tile_count;
+static std::map<TileIndex, uint> _train_tile_count_overflow; ///< Number of train vehicles above 255 on a tile.
+
+/**
+ * Check whether any train vehicle is on a tile, including trains in depots
+ * and the trains in a wormhole that starts at the tile.
+ * @param tile The tile to check.
+ * @return True if a train vehicle is on the tile.
+ */
+bool HasTrainOnTile(TileIndex tile)
+{
+	return _train_tile_count[tile] != 0;
+}
+
+/**
+ * Move a train vehicle to the tile it is at now in the train counts of the tiles.
+ * @param v The train vehicle.
+ * @param remove Whether to remove the vehicle from the counts.
+ */
+static void UpdateTrainTileCount(Vehicle *v, bool remove)
+{
+	TileIndex new_tile = remove ? INVALID_TILE : v->tile;
+	if (new_tile == v->counted_tile) return;
+
+	if (v->counted_tile != INVALID_TILE) {
+		auto it = _train_tile_count_overflow.find(v->counted_tile);
+		if (it == _train_tile_count_overflow.end()) {
+			_train_tile_count[v->counted_tile]--;
+		} else if (--it->second == 0) {
+			_train_tile_count_overflow.erase(it);
+		}
+	}
+
+	if (new_tile != INVALID_TILE) {
+		if (_train_tile_count[new_tile] != UINT8_MAX) {
+			_train_tile_count[new_tile]++;
+		} else {
+			_train_tile_count_overflow[new_tile]++;
+		}
+	}
+
+	v->counted_tile = new_tile;
+}
+
+/**
+ * Move a vehicle to the tile it is at now in the vehicle counts of the tunnels
+ * and bridges, if it is a train, road vehicle or ship at a tunnel or bridge head.
+ * @param v The vehicle.
+ * @param remove Whether to remove the vehicle from the counts.
+ */
+static void UpdateTunnelBridgeVehicleCount(Vehicle *v, bool remove)
+{
+	if (v->type != VEH_TRAIN && v->type != VEH_ROAD && v->type != VEH_SHIP) return;
+
+	TileIndex new_tile = (remove || !IsTileType(v->tile, MP_TUNNELBRIDGE)) ? INVALID_TILE : v->tile;
+	if (new_tile == v->counted_tunnel_bridge) return;
+
+	if (v->counted_tunnel_bridge != INVALID_TILE) {
+		auto it = _tunnel_bridge_vehicle_count.find(v->counted_tunnel_bridge);
+		if (--it->second == 0) _tunnel_bridge_vehicle_count.erase(it);
+	}
+
+	if (new_tile != INVALID_TILE) _tunnel_bridge_vehicle_count[new_tile]++;
+
+	v->counted_tunnel_bridge = new_tile;
+}
+
 static void UpdateVehicleTileHash(Vehicle *v, bool remove)
 {
+	if (v->type == VEH_TRAIN) UpdateTrainTileCount(v, remove);
+	UpdateTunnelBridgeVehicleCount(v, remove);
+
 	Vehicle **old_hash = v->hash_tile_current;
 	Vehicle **new_hash;
 
 	if (remove) {
 		new_hash = nullptr;
 	} else {
-		int x = GB(TileX(v->tile), HASH_RES, HASH_BITS);
-		int y = GB(TileY(v->tile), HASH_RES, HASH_BITS) << HASH_BITS;
-		new_hash = &_vehicle_tile_hash[(x + y) & TOTAL_HASH_MASK];
+		int x = GetVehicleTileHashX(TileX(v->tile));
+		int y = GetVehicleTileHashY(TileY(v->tile));
+		new_hash = &_vehicle_tile_hash[x + y];
 	}
 
 	if (old_hash == new_hash) return;
@@ -640,39 +773,124 @@ static void UpdateVehicleTileHash(Vehicle *v, bool remove)
 	v->hash_tile_current = new_hash;
 }
 
-static Vehicle *_vehicle_viewport_hash[1 << (GEN_HASHX_BITS + GEN_HASHY_BITS)];
+/**
+ * Data of the vehicles that is scanned when drawing viewports, stored per
+ * field and indexed by vehicle index. A viewport only draws a few of the
+ * vehicles in the hash buckets it scans, so this way the scan does not have
+ * to pull all the other (large) vehicles into the cache.
+ */
+struct VehicleViewportData {
+	VehicleID hash[1 << (GEN_HASHX_BITS + GEN_HASHY_BITS)]; ///< First vehicle of each visual location hash bucket.
+	uint64 occupied[1 << GEN_HASHY_BITS]; ///< Per row of hash buckets a bit for each bucket holding at least one vehicle.
+	std::vector<Rect> coord;          ///< Graphical bounding box of the vehicle; copy of Vehicle::coord.
+	std::vector<VehicleID> hash_next; ///< Next vehicle in the same visual location hash bucket.
+	std::vector<VehicleID> hash_prev; ///< Previous vehicle in the same visual location hash bucket, or #INVALID_VEHICLE for the first one.
+
+	VehicleViewportData()
+	{
+		this->ResetHash();
+	}
+
+	/** Empty all hash buckets. */
+	void ResetHash()
+	{
+		std::fill(std::begin(this->hash), std::end(this->hash), INVALID_VEHICLE);
+		std::fill(std::begin(this->occupied), std::end(this->occupied), 0);
+	}
+
+	/**
+	 * Update the occupancy bit of a hash bucket after a vehicle was added to or removed from it.
+	 * @param bucket The hash bucket.
+	 */
+	inline void UpdateOccupied(const VehicleID *bucket)
+	{
+		uint hash = bucket - this->hash;
+		uint64 &row = this->occupied[hash >> GEN_HASHX_BITS];
+		if (*bucket != INVALID_VEHICLE) {
+			SetBit(row, hash & GEN_HASHX_MASK);
+		} else {
+			ClrBit(row, hash & GEN_HASHX_MASK);
+		}
+	}
+
+	/**
+	 * Make sure there is room for the data of a vehicle.
+	 * @param index Index of the vehicle.
+	 */
+	inline void Reserve(VehicleID index)
+	{
+		if (index < this->coord.size()) return;
+
+		size_t size = max<size_t>(Vehicle::GetPoolSize(), index + 1);
+		this->coord.resize(size);
+		this->hash_next.resize(size, INVALID_VEHICLE);
+		this->hash_prev.resize(size, INVALID_VEHICLE);
+	}
+};
+
+assert_compile(GEN_HASHX_BITS <= 6); // The buckets of a row must fit in VehicleViewportData::occupied.
+
+static VehicleViewportData _vehicle_viewport_data;
 
 static void UpdateVehicleViewportHash(Vehicle *v, int x, int y)
 {
-	Vehicle **old_hash, **new_hash;
+	VehicleViewportData &data = _vehicle_viewport_data;
+	VehicleID *old_hash, *new_hash;
 	int old_x = v->coord.left;
 	int old_y = v->coord.top;
 
-	new_hash = (x == INVALID_COORD) ? nullptr : &_vehicle_viewport_hash[GEN_HASH(x, y)];
-	old_hash = (old_x == INVALID_COORD) ? nullptr : &_vehicle_viewport_hash[GEN_HASH(old_x, old_y)];
+	new_hash = (x == INVALID_COORD) ? nullptr : &data.hash[GEN_HASH(x, y)];
+	old_hash = (old_x == INVALID_COORD) ? nullptr : &data.hash[GEN_HASH(old_x, old_y)];
 
 	if (old_hash == new_hash) return;
 
+	VehicleID index = v->index;
+	data.Reserve(index);
+
 	/* remove from hash table? */
 	if (old_hash != nullptr) {
-		if (v->hash_viewport_next != nullptr) v->hash_viewport_next->hash_viewport_prev = v->hash_viewport_prev;
-		*v->hash_viewport_prev = v->hash_viewport_next;
+		VehicleID next = data.hash_next[index];
+		VehicleID prev = data.hash_prev[index];
+		if (next != INVALID_VEHICLE) data.hash_prev[next] = prev;
+		if (prev != INVALID_VEHICLE) {
+			data.hash_next[prev] = next;
+		} else {
+			*old_hash = next;
+			data.UpdateOccupied(old_hash);
+		}
 	}
 
 	/* insert into hash table? */
 	if (new_hash != nullptr) {
-		v->hash_viewport_next = *new_hash;
-		if (v->hash_viewport_next != nullptr) v->hash_viewport_next->hash_viewport_prev = &v->hash_viewport_next;
-		v->hash_viewport_prev = new_hash;
-		*new_hash = v;
+		data.hash_next[index] = *new_hash;
+		data.hash_prev[index] = INVALID_VEHICLE;
+		if (*new_hash != INVALID_VEHICLE) data.hash_prev[*new_hash] = index;
+		*new_hash = index;
+		data.UpdateOccupied(new_hash);
+	}
+}
+
+/** Allocate an empty tile location hash sized for the current map. */
+void AllocateVehicleTileHash()
+{
+	for (Vehicle *v : Vehicle::Iterate()) {
+		v->hash_tile_current = nullptr;
+		v->counted_tile = INVALID_TILE;
+		v->counted_tunnel_bridge = INVALID_TILE;
 	}
+	_train_tile_count.assign(MapSize(), 0);
+	_train_tile_count_overflow.clear();
+	_tunnel_bridge_vehicle_count.clear();
+
+	_vehicle_tile_hash_bits_x = Clamp(MapLogX() - 2, MIN_HASH_BITS, MAX_HASH_BITS);
+	_vehicle_tile_hash_bits_y = Clamp(MapLogY() - 2, MIN_HASH_BITS, MAX_HASH_BITS);
+	_vehicle_tile_hash.assign((size_t)1 << (_vehicle_tile_hash_bits_x + _vehicle_tile_hash_bits_y), nullptr);
 }
 
 void ResetVehicleHash()
 {
-	for (Vehicle *v : Vehicle::Iterate()) { v->hash_tile_current = nullptr; }
-	memset(_vehicle_viewport_hash, 0, sizeof(_vehicle_viewport_hash));
-	memset(_vehicle_tile_hash, 0, sizeof(_vehicle_tile_hash));
+	_vehicle_viewport_data.ResetHash();
+	AllocateVehicleTileHash();
 }
 
 void ResetVehicleColourMap()
@@ -687,6 +905,12 @@ void ResetVehicleColourMap()
 typedef SmallMap<Vehicle *, bool> AutoreplaceMap;
 static AutoreplaceMap _vehicles_to_autoreplace;
 
+/**
+ * Maximum number of vehicles per company per tick for which the autoreplace command is executed.
+ * Further vehicles wait in the depot, marked with #VF_AUTOREPLACE_PENDING, for the next tick.
+ */
+static const uint AUTOREPLACE_BUDGET_PER_COMPANY = 16;
+
 void InitializeVehicles()
 {
 	_vehicles_to_autoreplace.clear();
@@ -796,6 +1020,15 @@ void Vehicle::HandlePathfindingResult(bool path_found)
 	}
 }
 
+/**
+ * Get the size of the slots the vehicles are allocated in, which fit all types of vehicles.
+ * @return The size of the biggest type of vehicle.
+ */
+/* static */ size_t Vehicle::GetPoolSlotSize()
+{
+	return std::max({ sizeof(Train), sizeof(RoadVehicle), sizeof(Ship), sizeof(Aircraft), sizeof(EffectVehicle), sizeof(DisasterVehicle) });
+}
+
 /** Destroy all stuff that (still) needs the virtual functions to work properly */
 void Vehicle::PreDestructor()
 {
@@ -803,7 +1036,7 @@ void Vehicle::PreDestructor()
 
 	if (Station::IsValidID(this->last_station_visited)) {
 		Station *st = Station::Get(this->last_station_visited);
-		st->loading_vehicles.remove(this);
+		st->RemoveLoadingVehicle(this);
 
 		HideFillingPercent(&this->fill_percent_te_id);
 		this->CancelReservation(INVALID_STATION, st);
@@ -811,10 +1044,12 @@ void Vehicle::PreDestructor()
 		assert(this->cargo_payment == nullptr); // cleared by ~CargoPayment
 	}
 
+	CountVehicleAssetValue(this, -1);
+
 	if (this->IsEngineCountable()) {
 		GroupStatistics::CountEngine(this, -1);
 		if (this->IsPrimaryVehicle()) GroupStatistics::CountVehicle(this, -1);
-		GroupStatistics::UpdateAutoreplace(this->owner);
+		GroupStatistics::UpdateAutoreplace(this->owner, this->engine_type);
 
 		if (this->owner == _local_company) InvalidateAutoreplaceWindow(this->engine_type, this->group_id);
 		DeleteGroupHighlightOfVehicle(this);
@@ -914,10 +1149,13 @@ static void RunVehicleDayProc()
 	/* Run the day_proc for every DAY_TICKS vehicle starting at _date_fract. */
 	for (size_t i = _date_fract; i < Vehicle::GetPoolSize(); i += DAY_TICKS) {
 		Vehicle *v = Vehicle::Get(i);
-		if (v == nullptr) continue;
+
+		/* Effect vehicles, disasters and aircraft shadows and rotors have
+		 * neither callbacks nor anything to do at a new day. */
+		if (v == nullptr || !v->HasEngineType()) continue;
 
 		/* Call the 32-day callback if needed */
-		if ((v->day_counter & 0x1F) == 0 && v->HasEngineType()) {
+		if ((v->day_counter & 0x1F) == 0) {
 			uint16 callback = GetVehicleCallback(CBID_VEHICLE_32DAY_CALLBACK, 0, 0, v->engine_type, v);
 			if (callback != CALLBACK_FAILED) {
 				if (HasBit(callback, 0)) {
@@ -937,15 +1175,39 @@ static void RunVehicleDayProc()
 	}
 }
 
+/**
+ * Age the cargo of all vehicles whose cargo aging period has passed.
+ * Aging usually only advances the aging epoch of the cargo list, so it is
+ * cheap enough to do it right away.
+ */
+static void AgeVehicleCargo()
+{
+	for (Vehicle *v : Vehicle::Iterate()) {
+		if (v->type >= VEH_COMPANY_END || v->vcache.cached_cargo_age_period == 0) continue;
+
+		v->cargo_age_counter = min(v->cargo_age_counter, v->vcache.cached_cargo_age_period);
+		if (--v->cargo_age_counter == 0) {
+			v->cargo.AgeCargo();
+			v->cargo_age_counter = v->vcache.cached_cargo_age_period;
+		}
+	}
+}
+
 void CallVehicleTicks()
 {
+	TraceZone zone("CallVehicleTicks");
+
 	_vehicles_to_autoreplace.clear();
 
-	RunVehicleDayProc();
+	{
+		PerformanceAccumulator framerate(PFE_GL_DAYPROC);
+		RunVehicleDayProc();
+	}
 
 	{
 		PerformanceMeasurer framerate(PFE_GL_ECONOMY);
-		for (Station *st : Station::Iterate()) LoadUnloadStation(st);
+		/* Only stations with vehicles in them have anything to load or unload. */
+		for (StationID index : Station::loading_stations) LoadUnloadStation(Station::Get(index));
 	}
 	PerformanceAccumulator::Reset(PFE_GL_TRAINS);
 	PerformanceAccumulator::Reset(PFE_GL_ROADVEHS);
@@ -954,6 +1216,8 @@ void CallVehicleTicks()
 
 	for (Vehicle *v : Vehicle::Iterate()) {
 		size_t vehicle_index = v->index;
+		/* Only vehicles with orders are of interest in the trace; the parts of trains and articulated vehicles are part of the previous zone. */
+		TraceZone vehicle_zone(v->IsPrimaryVehicle() ? "Vehicle tick" : nullptr, v->index);
 		/* Vehicle could be deleted in this tick */
 		if (!v->Tick()) {
 			assert(Vehicle::Get(vehicle_index) == nullptr);
@@ -962,6 +1226,10 @@ void CallVehicleTicks()
 
 		assert(Vehicle::Get(vehicle_index) == v);
 
+		if (HasBit(v->vehicle_flags, VF_AUTOREPLACE_PENDING)) {
+			_vehicles_to_autoreplace[v] = HasBit(v->vehicle_flags, VF_AUTOREPLACE_RESTART);
+		}
+
 		switch (v->type) {
 			default: break;
 
@@ -971,14 +1239,6 @@ void CallVehicleTicks()
 			case VEH_SHIP: {
 				Vehicle *front = v->First();
 
-				if (v->vcache.cached_cargo_age_period != 0) {
-					v->cargo_age_counter = min(v->cargo_age_counter, v->vcache.cached_cargo_age_period);
-					if (--v->cargo_age_counter == 0) {
-						v->cargo.AgeCargo();
-						v->cargo_age_counter = v->vcache.cached_cargo_age_period;
-					}
-				}
-
 				/* Do not play any sound when crashed */
 				if (front->vehstatus & VS_CRASHED) continue;
 
@@ -1022,17 +1282,56 @@ void CallVehicleTicks()
 		}
 	}
 
+	HandleShipPathRequests();
+
+	AgeVehicleCargo();
+
+	/* Handle the vehicles per company, so the replacement decisions can be shared. Vehicles that
+	 * waited for the budget go first; the order only depends on saved state, so it is the same for
+	 * clients that joined in the meantime. */
+	std::sort(_vehicles_to_autoreplace.begin(), _vehicles_to_autoreplace.end(), [](const AutoreplaceMap::Pair &a, const AutoreplaceMap::Pair &b) {
+		if (a.first->owner != b.first->owner) return a.first->owner < b.first->owner;
+		bool a_pending = HasBit(a.first->vehicle_flags, VF_AUTOREPLACE_PENDING);
+		bool b_pending = HasBit(b.first->vehicle_flags, VF_AUTOREPLACE_PENDING);
+		if (a_pending != b_pending) return a_pending;
+		return a.first->index < b.first->index;
+	});
+
 	Backup<CompanyID> cur_company(_current_company, FILE_LINE);
+	CompanyID batch_company = INVALID_COMPANY;
+	uint budget = 0;
 	for (auto &it : _vehicles_to_autoreplace) {
 		Vehicle *v = it.first;
-		/* Autoreplace needs the current company set as the vehicle owner */
-		cur_company.Change(v->owner);
+		ClrBit(v->vehicle_flags, VF_AUTOREPLACE_PENDING);
+		ClrBit(v->vehicle_flags, VF_AUTOREPLACE_RESTART);
+
+		if (v->owner != batch_company) {
+			/* Autoreplace needs the current company set as the vehicle owner */
+			batch_company = v->owner;
+			cur_company.Change(batch_company);
+			StartAutoreplaceBatch(batch_company);
+			budget = AUTOREPLACE_BUDGET_PER_COMPANY;
+		}
+
+		bool has_work = AutoreplaceMayHaveWork(v);
+		if (has_work && budget == 0 && v->IsStoppedInDepot()) {
+			/* Keep the vehicle stopped until the next tick. */
+			SetBit(v->vehicle_flags, VF_AUTOREPLACE_PENDING);
+			if (it.second) SetBit(v->vehicle_flags, VF_AUTOREPLACE_RESTART);
+			continue;
+		}
 
 		/* Start vehicle if we stopped them in VehicleEnteredDepotThisTick()
 		 * We need to stop them between VehicleEnteredDepotThisTick() and here or we risk that
 		 * they are already leaving the depot again before being replaced. */
 		if (it.second) v->vehstatus &= ~VS_STOPPED;
 
+		/* The command would end with nothing to do. */
+		if (!has_work) continue;
+		if (budget > 0) budget--;
+
+		TraceZone zone("Autoreplace", v->index);
+
 		/* Store the position of the effect as the vehicle pointer will become invalid later */
 		int x = v->x_pos;
 		int y = v->y_pos;
@@ -1067,6 +1366,7 @@ void CallVehicleTicks()
 		AddVehicleAdviceNewsItem(message, v->index);
 	}
 
+	EndAutoreplaceBatch();
 	cur_company.Restore();
 }
 
@@ -1101,21 +1401,25 @@ static void DoDrawVehicle(const Vehicle *v)
 }
 
 /**
- * Add the vehicle sprites that should be drawn at a part of the screen.
- * @param dpi Rectangle being drawn.
+ * Call a function for all vehicles whose graphical bounding box intersects a rectangle.
+ * Only the visual location hash buckets covering the rectangle are scanned, and
+ * the vehicles themselves are only accessed when their bounding box matches.
+ * @param l    Left edge of the rectangle.
+ * @param t    Top edge of the rectangle.
+ * @param r    Right edge of the rectangle.
+ * @param b    Bottom edge of the rectangle.
+ * @param proc Function to call for every matching vehicle.
+ * @tparam Tproc Type of the function, taking a Vehicle pointer.
  */
-void ViewportAddVehicles(DrawPixelInfo *dpi)
+template <class Tproc>
+static void FindVehiclesInViewportRect(int l, int t, int r, int b, Tproc proc)
 {
-	/* The bounding rectangle */
-	const int l = dpi->left;
-	const int r = dpi->left + dpi->width;
-	const int t = dpi->top;
-	const int b = dpi->top + dpi->height;
+	const VehicleViewportData &data = _vehicle_viewport_data;
 
 	/* The hash area to scan */
 	int xl, xu, yl, yu;
 
-	if (dpi->width + (MAX_VEHICLE_PIXEL_X * ZOOM_LVL_BASE) < GEN_HASHX_SIZE) {
+	if (r - l + (MAX_VEHICLE_PIXEL_X * ZOOM_LVL_BASE) < GEN_HASHX_SIZE) {
 		xl = GEN_HASHX(l - MAX_VEHICLE_PIXEL_X * ZOOM_LVL_BASE);
 		xu = GEN_HASHX(r);
 	} else {
@@ -1124,7 +1428,7 @@ void ViewportAddVehicles(DrawPixelInfo *dpi)
 		xu = GEN_HASHX_MASK;
 	}
 
-	if (dpi->height + (MAX_VEHICLE_PIXEL_Y * ZOOM_LVL_BASE) < GEN_HASHY_SIZE) {
+	if (b - t + (MAX_VEHICLE_PIXEL_Y * ZOOM_LVL_BASE) < GEN_HASHY_SIZE) {
 		yl = GEN_HASHY(t - MAX_VEHICLE_PIXEL_Y * ZOOM_LVL_BASE);
 		yu = GEN_HASHY(b);
 	} else {
@@ -1133,28 +1437,43 @@ void ViewportAddVehicles(DrawPixelInfo *dpi)
 		yu = GEN_HASHY_MASK;
 	}
 
+	/* Buckets of each row to scan; empty buckets are skipped using the occupancy bits,
+	 * so zoomed out viewports that cover the whole hash do not walk all of it. */
+	uint64 from_xl = UINT64_MAX << xl;
+	uint64 upto_xu = UINT64_MAX >> (63 - xu);
+	uint64 xmask = (xl <= xu) ? (from_xl & upto_xu) : (from_xl | upto_xu);
+
 	for (int y = yl;; y = (y + GEN_HASHY_INC) & GEN_HASHY_MASK) {
-		for (int x = xl;; x = (x + GEN_HASHX_INC) & GEN_HASHX_MASK) {
-			const Vehicle *v = _vehicle_viewport_hash[x + y]; // already masked & 0xFFF
-
-			while (v != nullptr) {
-				if (!(v->vehstatus & VS_HIDDEN) &&
-						l <= v->coord.right &&
-						t <= v->coord.bottom &&
-						r >= v->coord.left &&
-						b >= v->coord.top) {
-					DoDrawVehicle(v);
+		for (uint64 buckets = data.occupied[y >> GEN_HASHX_BITS] & xmask; buckets != 0; buckets = KillFirstBit(buckets)) {
+			VehicleID index = data.hash[FindFirstBit64(buckets) + y]; // already masked & 0xFFF
+
+			while (index != INVALID_VEHICLE) {
+				const Rect &coord = data.coord[index];
+				if (l <= coord.right &&
+						t <= coord.bottom &&
+						r >= coord.left &&
+						b >= coord.top) {
+					proc(Vehicle::Get(index));
 				}
-				v = v->hash_viewport_next;
+				index = data.hash_next[index];
 			}
-
-			if (x == xu) break;
 		}
 
 		if (y == yu) break;
 	}
 }
 
+/**
+ * Add the vehicle sprites that should be drawn at a part of the screen.
+ * @param dpi Rectangle being drawn.
+ */
+void ViewportAddVehicles(DrawPixelInfo *dpi)
+{
+	FindVehiclesInViewportRect(dpi->left, dpi->top, dpi->left + dpi->width, dpi->top + dpi->height, [](const Vehicle *v) {
+		if (!(v->vehstatus & VS_HIDDEN)) DoDrawVehicle(v);
+	});
+}
+
 /**
  * Find the vehicle close to the clicked coordinates.
  * @param vp Viewport clicked in.
@@ -1165,29 +1484,26 @@ void ViewportAddVehicles(DrawPixelInfo *dpi)
 Vehicle *CheckClickOnVehicle(const ViewPort *vp, int x, int y)
 {
 	Vehicle *found = nullptr;
-	uint dist, best_dist = UINT_MAX;
+	uint best_dist = UINT_MAX;
 
 	if ((uint)(x -= vp->left) >= (uint)vp->width || (uint)(y -= vp->top) >= (uint)vp->height) return nullptr;
 
 	x = ScaleByZoom(x, vp->zoom) + vp->virtual_left;
 	y = ScaleByZoom(y, vp->zoom) + vp->virtual_top;
 
-	for (Vehicle *v : Vehicle::Iterate()) {
-		if ((v->vehstatus & (VS_HIDDEN | VS_UNCLICKABLE)) == 0 &&
-				x >= v->coord.left && x <= v->coord.right &&
-				y >= v->coord.top && y <= v->coord.bottom) {
-
-			dist = max(
-				abs(((v->coord.left + v->coord.right) >> 1) - x),
-				abs(((v->coord.top + v->coord.bottom) >> 1) - y)
-			);
-
-			if (dist < best_dist) {
-				found = v;
-				best_dist = dist;
-			}
+	FindVehiclesInViewportRect(x, y, x, y, [&](Vehicle *v) {
+		if ((v->vehstatus & (VS_HIDDEN | VS_UNCLICKABLE)) != 0) return;
+
+		uint dist = max(
+			abs(((v->coord.left + v->coord.right) >> 1) - x),
+			abs(((v->coord.top + v->coord.bottom) >> 1) - y)
+		);
+
+		if (dist < best_dist) {
+			found = v;
+			best_dist = dist;
 		}
-	}
+	});
 
 	return found;
 }
@@ -1198,8 +1514,56 @@ Vehicle *CheckClickOnVehicle(const ViewPort *vp, int x, int y)
  */
 void DecreaseVehicleValue(Vehicle *v)
 {
-	v->value -= v->value >> 8;
-	SetWindowDirty(WC_VEHICLE_DETAILS, v->index);
+	SetVehicleValue(v, v->value - (v->value >> 8));
+	/* Details windows only exist for primary vehicles, not for e.g. wagons. */
+	if (v->IsPrimaryVehicle()) SetWindowDirty(WC_VEHICLE_DETAILS, v->index);
+}
+
+/**
+ * Get the value a vehicle adds to the company value of its owner.
+ * @param v The vehicle.
+ * @return The value; 0 for vehicles that do not count, like the shadows of aircraft.
+ */
+Money GetVehicleAssetValue(const Vehicle *v)
+{
+	switch (v->type) {
+		case VEH_TRAIN:
+		case VEH_ROAD:
+		case VEH_SHIP:
+			break;
+
+		case VEH_AIRCRAFT:
+			if (!Aircraft::From(v)->IsNormalAircraft()) return 0;
+			break;
+
+		default:
+			return 0;
+	}
+	return v->value * 3 >> 1;
+}
+
+/**
+ * Add the value of a vehicle to, or remove it from, the assets of its owner.
+ * Has to be called whenever a vehicle that may have a value gets or loses its owner.
+ * @param v The vehicle.
+ * @param delta 1 to add the value, -1 to remove it.
+ */
+void CountVehicleAssetValue(const Vehicle *v, int delta)
+{
+	Company *c = Company::GetIfValid(v->owner);
+	if (c != nullptr) c->assets.vehicle_value += GetVehicleAssetValue(v) * delta;
+}
+
+/**
+ * Change the value of a vehicle, keeping the assets of its owner up to date.
+ * @param v The vehicle.
+ * @param value The new value.
+ */
+void SetVehicleValue(Vehicle *v, Money value)
+{
+	CountVehicleAssetValue(v, -1);
+	v->value = value;
+	CountVehicleAssetValue(v, 1);
 }
 
 static const byte _breakdown_chance[64] = {
@@ -1581,6 +1945,8 @@ void Vehicle::UpdateViewport(bool dirty)
 
 	Rect old_coord = this->coord;
 	this->coord = new_coord;
+	_vehicle_viewport_data.Reserve(this->index);
+	_vehicle_viewport_data.coord[this->index] = new_coord;
 
 	if (dirty) {
 		if (old_coord.left == INVALID_COORD) {
@@ -2208,7 +2574,7 @@ void Vehicle::LeaveStation()
 	this->current_order.MakeLeaveStation();
 	Station *st = Station::Get(this->last_station_visited);
 	this->CancelReservation(INVALID_STATION, st);
-	st->loading_vehicles.remove(this);
+	st->RemoveLoadingVehicle(this);
 
 	HideFillingPercent(&this->fill_percent_te_id);
 	trip_occupancy = CalcPercentVehicleFilled(this, nullptr);
@@ -2741,6 +3107,9 @@ void Vehicle::RemoveFromShared()
 
 void VehiclesYearlyLoop()
 {
+	/* Group profits are recounted while the vehicles roll over their profits. */
+	GroupStatistics::ClearAllProfits();
+
 	for (Vehicle *v : Vehicle::Iterate()) {
 		if (v->IsPrimaryVehicle()) {
 			/* show warning if vehicle is not generating enough income last 2 years (corresponds to a red icon in the vehicle list) */
@@ -2756,10 +3125,10 @@ void VehiclesYearlyLoop()
 
 			v->profit_last_year = v->profit_this_year;
 			v->profit_this_year = 0;
+			if (v->age > VEHICLE_PROFIT_MIN_AGE) GroupStatistics::VehicleReachedProfitAge(v);
 			SetWindowDirty(WC_VEHICLE_DETAILS, v->index);
 		}
 	}
-	GroupStatistics::UpdateProfits();
 	SetWindowClassesDirty(WC_TRAINS_LIST);
 	SetWindowClassesDirty(WC_SHIPS_LIST);
 	SetWindowClassesDirty(WC_ROADVEH_LIST);
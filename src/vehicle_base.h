@@ -49,6 +49,8 @@ enum VehicleFlags {
 	VF_PATHFINDER_LOST,         ///< Vehicle's pathfinder is lost.
 	VF_SERVINT_IS_CUSTOM,       ///< Service interval is custom.
 	VF_SERVINT_IS_PERCENT,      ///< Service interval is percent.
+	VF_AUTOREPLACE_PENDING,     ///< Vehicle waits stopped in a depot for its autoreplace, as the budget of its company was used up.
+	VF_AUTOREPLACE_RESTART,     ///< Vehicle with a pending autoreplace leaves the depot afterwards.
 };
 
 /** Bit numbers used to indicate which of the #NewGRFCache values are valid. */
@@ -181,6 +183,23 @@ struct VehicleSpriteSeq {
 	void Draw(int x, int y, PaletteID default_pal, bool force_pal) const;
 };
 
+/**
+ * NewGRF sprites of a vehicle on the map as they were last resolved, together with
+ * everything they depend on. Only used for chains that read no variables, see #IsObjectInvariant.
+ */
+struct VehicleSpriteCache {
+	uint64 generation;               ///< Generation of the NewGRF sprite groups the sprites were resolved in; 0 if there are none.
+	const struct SpriteGroup *root;  ///< Root sprite group that was resolved.
+	uint cargo_count;                ///< Amount of cargo in the vehicle at the time.
+	uint16 cargo_cap;                ///< Capacity of the vehicle at the time.
+	bool in_motion;                  ///< Whether the vehicle was not loading at the time.
+	byte random_bits;                ///< Random bits of the vehicle at the time.
+	uint8 count;                     ///< Number of used entries in the arrays below.
+	SpriteID result[4];              ///< First sprite of each resolved sprite set.
+	uint8 num_results[4];            ///< Number of sprites, i.e. directions, in each resolved sprite set.
+	PaletteID pal[4];                ///< Recolouring of each entry.
+};
+
 /** A vehicle pool for a little over 1 million vehicles. */
 typedef Pool<Vehicle, VehicleID, 512, 0xFF000> VehiclePool;
 extern VehiclePool _vehicle_pool;
@@ -242,12 +261,11 @@ public:
 
 	Rect coord;                         ///< NOSAVE: Graphical bounding box of the vehicle, i.e. what to redraw on moves.
 
-	Vehicle *hash_viewport_next;        ///< NOSAVE: Next vehicle in the visual location hash.
-	Vehicle **hash_viewport_prev;       ///< NOSAVE: Previous vehicle in the visual location hash.
-
 	Vehicle *hash_tile_next;            ///< NOSAVE: Next vehicle in the tile location hash.
 	Vehicle **hash_tile_prev;           ///< NOSAVE: Previous vehicle in the tile location hash.
 	Vehicle **hash_tile_current;        ///< NOSAVE: Cache of the current hash chain.
+	TileIndex counted_tile;             ///< NOSAVE: Tile at which a train vehicle is counted in the train counts of the tiles.
+	TileIndex counted_tunnel_bridge;    ///< NOSAVE: Tunnel or bridge head at which a train, road vehicle or ship is counted in the vehicle counts of the tunnels and bridges.
 
 	SpriteID colourmap;                 ///< NOSAVE: cached colour mapping
 
@@ -276,6 +294,7 @@ public:
 	 */
 	byte spritenum;
 	VehicleSpriteSeq sprite_seq;        ///< Vehicle appearance.
+	mutable VehicleSpriteCache sprite_cache; ///< NOSAVE: Cached NewGRF sprites of the vehicle on the map.
 	byte x_extent;                      ///< x-extent of vehicle bounding box
 	byte y_extent;                      ///< y-extent of vehicle bounding box
 	byte z_extent;                      ///< z-extent of vehicle bounding box
@@ -333,6 +352,8 @@ public:
 	/** We want to 'destruct' the right class. */
 	virtual ~Vehicle();
 
+	static size_t GetPoolSlotSize();
+
 	void BeginLoading();
 	void CancelReservation(StationID next, Station *st);
 	void LeaveStation();
@@ -147,7 +147,7 @@ CommandCost CmdBuildVehicle(TileIndex tile, DoCommandFlag flags, uint32 p1, uint
 	if (value.Succeeded()) {
 		if (refitting || (flags & DC_EXEC)) {
 			v->unitnumber = unit_num;
-			v->value      = value.GetCost();
+			SetVehicleValue(v, value.GetCost());
 		}
 
 		if (refitting) {
@@ -168,7 +168,7 @@ CommandCost CmdBuildVehicle(TileIndex tile, DoCommandFlag flags, uint32 p1, uint
 
 		if (refitting || (flags & DC_EXEC)) {
 			GroupStatistics::CountEngine(v, 1);
-			GroupStatistics::UpdateAutoreplace(_current_company);
+			GroupStatistics::UpdateAutoreplace(_current_company, v->engine_type);
 
 			if (v->IsPrimaryVehicle()) {
 				GroupStatistics::CountVehicle(v, 1);
@@ -616,6 +616,9 @@ CommandCost CmdStartStopVehicle(TileIndex tile, DoCommandFlag flags, uint32 p1,
 		if (v->IsStoppedInDepot() && (flags & DC_AUTOREPLACE) == 0) DeleteVehicleNews(p1, STR_NEWS_TRAIN_IS_WAITING + v->type);
 
 		v->vehstatus ^= VS_STOPPED;
+		/* Starting a vehicle waiting for its autoreplace gives up on the autoreplace. */
+		ClrBit(v->vehicle_flags, VF_AUTOREPLACE_PENDING);
+		ClrBit(v->vehicle_flags, VF_AUTOREPLACE_RESTART);
 		if (v->type != VEH_TRAIN) v->cur_speed = 0; // trains can stop 'slowly'
 		v->MarkDirty();
 		SetWindowWidgetDirty(WC_VEHICLE_VIEW, v->index, WID_VV_START_STOP);
@@ -50,6 +50,8 @@ uint8 CalcPercentVehicleFilled(const Vehicle *v, StringID *colour);
 void VehicleLengthChanged(const Vehicle *u);
 
 byte VehicleRandomBits();
+void AllocateVehicleTileHash();
+bool HasTrainOnTile(TileIndex tile);
 void ResetVehicleHash();
 void ResetVehicleColourMap();
 
@@ -61,6 +63,9 @@ void ShowNewGrfVehicleError(EngineID engine, StringID part1, StringID part2, GRF
 CommandCost TunnelBridgeIsFree(TileIndex tile, TileIndex endtile, const Vehicle *ignore = nullptr);
 
 void DecreaseVehicleValue(Vehicle *v);
+Money GetVehicleAssetValue(const Vehicle *v);
+void CountVehicleAssetValue(const Vehicle *v, int delta);
+void SetVehicleValue(Vehicle *v, Money value);
 void CheckVehicleBreakdown(Vehicle *v);
 void AgeVehicle(Vehicle *v);
 void VehicleEnteredDepotThisTick(Vehicle *v);
@@ -36,6 +36,7 @@
 #include "station_base.h"
 #include "tilehighlight_func.h"
 #include "zoom_func.h"
+#include <unordered_set>
 
 #include "safeguards.h"
 
@@ -120,17 +121,42 @@ uint GetUnitNumberDigits(VehicleList &vehicles)
 	return 2;
 }
 
+/**
+ * Put the vehicles of a rebuilt list that were already listed back in the order of the old list.
+ * The vehicles that are new to the list follow them, so a resort only has to move those
+ * and the vehicles whose sort value changed.
+ * @param list The rebuilt list.
+ * @param old_list The list before the rebuild. Its vehicles may have been deleted, so they are only compared, never dereferenced.
+ */
+static void KeepVehicleListOrder(VehicleList *list, const VehicleList &old_list)
+{
+	std::unordered_set<const Vehicle *> unplaced(list->begin(), list->end());
+
+	VehicleList ordered;
+	ordered.reserve(list->size());
+	for (const Vehicle *v : old_list) {
+		if (unplaced.erase(v) != 0) ordered.push_back(v);
+	}
+	for (const Vehicle *v : *list) {
+		if (unplaced.count(v) != 0) ordered.push_back(v);
+	}
+	list->swap(ordered);
+}
+
 void BaseVehicleListWindow::BuildVehicleList()
 {
 	if (!this->vehicles.NeedRebuild()) return;
 
 	DEBUG(misc, 3, "Building vehicle list type %d for company %d given index %d", this->vli.type, this->vli.company, this->vli.index);
 
+	VehicleList old_list;
+	old_list.swap(this->vehicles);
 	GenerateVehicleSortList(&this->vehicles, this->vli);
+	if (!old_list.empty()) KeepVehicleListOrder(&this->vehicles, old_list);
 
 	this->unitnumber_digits = GetUnitNumberDigits(this->vehicles);
 
-	this->vehicles.RebuildDone();
+	this->vehicles.RebuildDone(!old_list.empty());
 	this->vscroll->SetCount((uint)this->vehicles.size());
 }
 
@@ -22,6 +22,7 @@
 #include "../saveload/saveload.h"
 #include "../thread.h"
 #include "dedicated_v.h"
+#include <chrono>
 
 #ifdef __OS2__
 #	include <sys/time.h> /* gettimeofday */
@@ -244,10 +245,39 @@ static void DedicatedHandleKeyInput()
 	IConsoleCmdExec(input_line); // execute command
 }
 
+/** Statistics about how late the ticks of the dedicated server started. */
+struct TickLateness {
+	static const uint REPORT_INTERVAL = 1024; ///< Number of ticks after which the statistics are reported.
+
+	uint ticks = 0;   ///< Number of ticks so far.
+	uint64 total = 0; ///< Total lateness of the ticks so far, in microseconds.
+	uint64 worst = 0; ///< Largest lateness of a tick so far, in microseconds.
+
+	/**
+	 * Record the lateness of a tick, and report the statistics once enough ticks were recorded.
+	 * @param lateness How much later than planned the tick started.
+	 */
+	void Record(std::chrono::steady_clock::duration lateness)
+	{
+		uint64 us = (uint64)std::chrono::duration_cast<std::chrono::microseconds>(lateness).count();
+		this->total += us;
+		this->worst = max(this->worst, us);
+		if (++this->ticks < REPORT_INTERVAL) return;
+
+		DEBUG(net, 3, "Tick lateness over the last %u ticks: " OTTD_PRINTF64 " us on average, " OTTD_PRINTF64 " us at most",
+				this->ticks, (int64)(this->total / this->ticks), (int64)this->worst);
+		*this = TickLateness();
+	}
+};
+
 void VideoDriver_Dedicated::MainLoop()
 {
+	typedef std::chrono::steady_clock Clock;
+	const Clock::duration tick_length = std::chrono::milliseconds(MILLISECONDS_PER_TICK);
+
 	uint32 cur_ticks = GetTime();
-	uint32 next_tick = cur_ticks + MILLISECONDS_PER_TICK;
+	Clock::time_point next_tick = Clock::now() + tick_length;
+	TickLateness lateness;
 
 	/* Signal handlers */
 #if defined(UNIX)
@@ -288,29 +318,45 @@ void VideoDriver_Dedicated::MainLoop()
 	}
 
 	while (!_exit_game) {
-		uint32 prev_cur_ticks = cur_ticks; // to check for wrapping
+		uint32 prev_cur_ticks = cur_ticks;
 		InteractiveRandom(); // randomness
 
 		if (!_dedicated_forks) DedicatedHandleKeyInput();
 
 		cur_ticks = GetTime();
 		_realtime_tick += cur_ticks - prev_cur_ticks;
-		if (cur_ticks >= next_tick || cur_ticks < prev_cur_ticks || _ddc_fastforward) {
-			next_tick = cur_ticks + MILLISECONDS_PER_TICK;
+
+		Clock::time_point now = Clock::now();
+		if (now >= next_tick || _ddc_fastforward) {
+			/* When idling, ticks are late on purpose. */
+			if (!_ddc_fastforward && (_pause_mode == 0 || HasClients())) lateness.Record(now - next_tick);
+
+			/* Keep to the planned pace, unless we fell behind by more than a whole tick. */
+			next_tick += tick_length;
+			if (next_tick <= now) next_tick = now + tick_length;
 
 			GameLoop();
 			UpdateWindows();
+			continue;
 		}
 
 		/* Don't sleep when fast forwarding (for desync debugging) */
-		if (!_ddc_fastforward) {
-			/* Sleep longer on a dedicated server, if the game is paused and no clients connected.
-			 * That can allow the CPU to better use deep sleep states. */
-			if (_pause_mode != 0 && !HasClients()) {
-				CSleep(100);
-			} else {
-				CSleep(1);
-			}
+		if (_ddc_fastforward) continue;
+
+		/* Sleep longer on a dedicated server, if the game is paused and no clients connected.
+		 * That can allow the CPU to better use deep sleep states. */
+		if (_pause_mode != 0 && !HasClients()) {
+			NetworkServerWaitForPackets(100);
+			continue;
+		}
+
+		/* Wait for the clients until the next tick; the sockets can only be waited for
+		 * with millisecond precision, so sleep away the remainder afterwards. */
+		uint wait_ms = (uint)std::chrono::duration_cast<std::chrono::milliseconds>(next_tick - now).count();
+		if (wait_ms > 0) {
+			NetworkServerWaitForPackets(wait_ms);
+		} else {
+			std::this_thread::sleep_until(next_tick);
 		}
 	}
 }
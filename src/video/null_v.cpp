@@ -9,6 +9,7 @@
 
 #include "../stdafx.h"
 #include "../gfx_func.h"
+#include "../openttd.h"
 #include "../blitter/factory.hpp"
 #include "null_v.h"
 
@@ -47,6 +48,7 @@ void VideoDriver_Null::MainLoop()
 	for (i = 0; i < this->ticks; i++) {
 		GameLoop();
 		UpdateWindows();
+		if (_exit_game) return;
 	}
 }
 
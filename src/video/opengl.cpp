@@ -0,0 +1,440 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file opengl.cpp OpenGL video output, shared by the video drivers that support it. */
+
+#include "../stdafx.h"
+#include "../debug.h"
+#include "../blitter/factory.hpp"
+#include "../core/math_func.hpp"
+#include "opengl.h"
+
+#include "../safeguards.h"
+
+/*
+ * The few OpenGL 3.2 core profile types, constants and functions that are used.
+ * They are declared here, and loaded from the context, so no OpenGL headers nor
+ * libraries are needed to build.
+ */
+#if defined(_WIN32)
+#	define OTTD_GLAPI __stdcall
+#else
+#	define OTTD_GLAPI
+#endif
+
+typedef unsigned int GLenum;
+typedef unsigned int GLuint;
+typedef unsigned int GLbitfield;
+typedef int GLint;
+typedef int GLsizei;
+typedef unsigned char GLboolean;
+typedef unsigned char GLubyte;
+typedef char GLchar;
+typedef float GLfloat;
+
+static const GLenum GL_NO_ERROR                    = 0;
+static const GLenum GL_TRIANGLES                   = 0x0004;
+static const GLenum GL_DEPTH_TEST                  = 0x0B71;
+static const GLenum GL_BLEND                       = 0x0BE2;
+static const GLenum GL_UNPACK_ROW_LENGTH           = 0x0CF2;
+static const GLenum GL_UNPACK_ALIGNMENT            = 0x0CF5;
+static const GLenum GL_TEXTURE_2D                  = 0x0DE1;
+static const GLenum GL_UNSIGNED_BYTE               = 0x1401;
+static const GLenum GL_RED                         = 0x1903;
+static const GLenum GL_RENDERER                    = 0x1F01;
+static const GLenum GL_VERSION                     = 0x1F02;
+static const GLenum GL_NEAREST                     = 0x2600;
+static const GLenum GL_TEXTURE_MAG_FILTER          = 0x2800;
+static const GLenum GL_TEXTURE_MIN_FILTER          = 0x2801;
+static const GLenum GL_TEXTURE_WRAP_S              = 0x2802;
+static const GLenum GL_TEXTURE_WRAP_T              = 0x2803;
+static const GLenum GL_COLOR_BUFFER_BIT            = 0x4000;
+static const GLenum GL_RGBA8                       = 0x8058;
+static const GLenum GL_BGRA                        = 0x80E1;
+static const GLenum GL_CLAMP_TO_EDGE               = 0x812F;
+static const GLenum GL_TEXTURE_MAX_LEVEL           = 0x813D;
+static const GLenum GL_RG                          = 0x8227;
+static const GLenum GL_R8                          = 0x8229;
+static const GLenum GL_RG8                         = 0x822B;
+static const GLenum GL_UNSIGNED_INT_8_8_8_8_REV    = 0x8367;
+static const GLenum GL_TEXTURE0                    = 0x84C0;
+static const GLenum GL_FRAGMENT_SHADER             = 0x8B30;
+static const GLenum GL_VERTEX_SHADER               = 0x8B31;
+static const GLenum GL_COMPILE_STATUS              = 0x8B81;
+static const GLenum GL_LINK_STATUS                 = 0x8B82;
+
+/** Table of the OpenGL functions that are used, with their name and where to store their address. */
+#define OPENGL_FUNCTIONS(F) \
+	F(const GLubyte *, GetString, (GLenum name)) \
+	F(GLenum, GetError, (void)) \
+	F(void, Enable, (GLenum cap)) \
+	F(void, Disable, (GLenum cap)) \
+	F(void, Viewport, (GLint x, GLint y, GLsizei width, GLsizei height)) \
+	F(void, ClearColor, (GLfloat r, GLfloat g, GLfloat b, GLfloat a)) \
+	F(void, Clear, (GLbitfield mask)) \
+	F(void, PixelStorei, (GLenum pname, GLint param)) \
+	F(void, GenTextures, (GLsizei n, GLuint *textures)) \
+	F(void, DeleteTextures, (GLsizei n, const GLuint *textures)) \
+	F(void, BindTexture, (GLenum target, GLuint texture)) \
+	F(void, ActiveTexture, (GLenum texture)) \
+	F(void, TexParameteri, (GLenum target, GLenum pname, GLint param)) \
+	F(void, TexImage2D, (GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels)) \
+	F(void, TexSubImage2D, (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels)) \
+	F(GLuint, CreateShader, (GLenum type)) \
+	F(void, ShaderSource, (GLuint shader, GLsizei count, const GLchar * const *string, const GLint *length)) \
+	F(void, CompileShader, (GLuint shader)) \
+	F(void, GetShaderiv, (GLuint shader, GLenum pname, GLint *params)) \
+	F(void, GetShaderInfoLog, (GLuint shader, GLsizei bufsize, GLsizei *length, GLchar *log)) \
+	F(void, DeleteShader, (GLuint shader)) \
+	F(GLuint, CreateProgram, (void)) \
+	F(void, AttachShader, (GLuint program, GLuint shader)) \
+	F(void, LinkProgram, (GLuint program)) \
+	F(void, GetProgramiv, (GLuint program, GLenum pname, GLint *params)) \
+	F(void, GetProgramInfoLog, (GLuint program, GLsizei bufsize, GLsizei *length, GLchar *log)) \
+	F(void, DeleteProgram, (GLuint program)) \
+	F(void, UseProgram, (GLuint program)) \
+	F(GLint, GetUniformLocation, (GLuint program, const GLchar *name)) \
+	F(void, Uniform1i, (GLint location, GLint v0)) \
+	F(void, GenVertexArrays, (GLsizei n, GLuint *arrays)) \
+	F(void, DeleteVertexArrays, (GLsizei n, const GLuint *arrays)) \
+	F(void, BindVertexArray, (GLuint array)) \
+	F(void, DrawArrays, (GLenum mode, GLint first, GLsizei count))
+
+#define DECLARE_GL_FUNCTION(ret, name, args) typedef ret (OTTD_GLAPI *PFN_gl##name) args; static PFN_gl##name _gl##name = nullptr;
+OPENGL_FUNCTIONS(DECLARE_GL_FUNCTION)
+#undef DECLARE_GL_FUNCTION
+
+/** What the fragment shader has to do with the textures. */
+enum ShaderMode {
+	SM_COLOUR  = 0, ///< Show the colours of the screen.
+	SM_ANIM    = 1, ///< Show the colours of the screen, with the palette animated pixels looked up in the palette.
+	SM_PALETTE = 2, ///< Look up the palette indices of the 8bpp screen in the palette.
+};
+
+/** Vertex shader drawing a single triangle covering the whole viewport. */
+static const char *_vertex_shader_source =
+	"#version 150\n"
+	"out vec2 tex_coord;\n"
+	"void main() {\n"
+	"	vec2 pos = vec2(float((gl_VertexID & 1) * 4 - 1), float((gl_VertexID >> 1) * 4 - 1));\n"
+	"	tex_coord = vec2((pos.x + 1.0) / 2.0, (1.0 - pos.y) / 2.0);\n"
+	"	gl_Position = vec4(pos, 0.0, 1.0);\n"
+	"}\n";
+
+/**
+ * Fragment shader drawing the screen. The palette animation does the same as
+ * Blitter_32bppAnim::PaletteAnimate, including Blitter_32bppBase::AdjustBrightness.
+ */
+static const char *_fragment_shader_source =
+	"#version 150\n"
+	"uniform sampler2D video_tex;\n"
+	"uniform sampler2D anim_tex;\n"
+	"uniform sampler2D palette_tex;\n"
+	"uniform int mode;\n"
+	"in vec2 tex_coord;\n"
+	"out vec4 colour;\n"
+	"vec3 AdjustBrightness(vec3 c, float brightness) {\n"
+	"	if (brightness == 128.0) return c;\n"
+	"	vec3 rgb = floor(c * brightness / 128.0);\n"
+	"	vec3 over = max(rgb - 255.0, 0.0);\n"
+	"	float ob = floor((over.r + over.g + over.b) / 2.0);\n"
+	"	vec3 adjusted = min(rgb + floor(ob * (255.0 - rgb) / 256.0), 255.0);\n"
+	"	return mix(adjusted, vec3(255.0), step(255.0, rgb));\n"
+	"}\n"
+	"vec3 LookupPalette(float index) {\n"
+	"	return texelFetch(palette_tex, ivec2(int(index), 0), 0).rgb * 255.0;\n"
+	"}\n"
+	"void main() {\n"
+	"	vec4 video = texture(video_tex, tex_coord);\n"
+	"	if (mode == 2) {\n"
+	"		colour = vec4(LookupPalette(floor(video.r * 255.0 + 0.5)) / 255.0, 1.0);\n"
+	"		return;\n"
+	"	}\n"
+	"	colour = vec4(video.rgb, 1.0);\n"
+	"	if (mode == 1) {\n"
+	"		vec2 anim = floor(texture(anim_tex, tex_coord).ANIM_CHANNELS * 255.0 + 0.5);\n"
+	"		if (anim.x >= PALETTE_ANIM_START) colour.rgb = AdjustBrightness(LookupPalette(anim.x), anim.y) / 255.0;\n"
+	"	}\n"
+	"}\n";
+
+OpenGLBackend *OpenGLBackend::instance = nullptr;
+
+/**
+ * Create the backend for the current context.
+ * @param get_proc Function to get the address of OpenGL functions.
+ * @return nullptr on success, otherwise an error message.
+ */
+/* static */ const char *OpenGLBackend::Create(OpenGLGetProcAddressProc get_proc)
+{
+	OpenGLBackend::Destroy();
+
+	OpenGLBackend *backend = new OpenGLBackend();
+	const char *error = backend->Init(get_proc);
+	if (error != nullptr) {
+		delete backend;
+		return error;
+	}
+
+	OpenGLBackend::instance = backend;
+	return nullptr;
+}
+
+/** Free the backend of the current context. */
+/* static */ void OpenGLBackend::Destroy()
+{
+	delete OpenGLBackend::instance;
+	OpenGLBackend::instance = nullptr;
+}
+
+OpenGLBackend::OpenGLBackend() : width(0), height(0), bpp(0), program(0), vertex_array(0), video_texture(0), anim_texture(0), palette_texture(0), mode_location(-1)
+{
+}
+
+OpenGLBackend::~OpenGLBackend()
+{
+	/* Nothing was created when loading the functions failed. */
+	if (_glDeleteProgram == nullptr) return;
+
+	if (this->program != 0) _glDeleteProgram(this->program);
+	if (this->vertex_array != 0) _glDeleteVertexArrays(1, &this->vertex_array);
+	if (this->video_texture != 0) _glDeleteTextures(1, &this->video_texture);
+	if (this->anim_texture != 0) _glDeleteTextures(1, &this->anim_texture);
+	if (this->palette_texture != 0) _glDeleteTextures(1, &this->palette_texture);
+}
+
+/**
+ * Compile a shader.
+ * @param type The type of shader.
+ * @param source The source of the shader.
+ * @return The shader, or 0 when it failed to compile.
+ */
+static GLuint CompileShader(GLenum type, const char *source)
+{
+	/* The anim buffer is uint16, with the palette index in the lowest byte. */
+	const char *defines =
+#if TTD_ENDIAN == TTD_BIG_ENDIAN
+		"#define ANIM_CHANNELS gr\n"
+#else
+		"#define ANIM_CHANNELS rg\n"
+#endif
+		"#define PALETTE_ANIM_START 227.0\n";
+	assert_compile(PALETTE_ANIM_START == 227);
+
+	/* The #version line has to come first, so the defines go after it. */
+	const char *body = strchr(source, '\n') + 1;
+	std::string version(source, body - source);
+	const GLchar *sources[] = { version.c_str(), defines, body };
+
+	GLuint shader = _glCreateShader(type);
+	_glShaderSource(shader, lengthof(sources), sources, nullptr);
+	_glCompileShader(shader);
+
+	GLint status = 0;
+	_glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (status == 0) {
+		char log[1024];
+		_glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+		DEBUG(driver, 0, "OpenGL: shader failed to compile: %s", log);
+		_glDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
+
+/**
+ * Create a texture that is not filtered, nor repeated.
+ * @return The texture, which is bound.
+ */
+static GLuint CreateTexture()
+{
+	GLuint texture = 0;
+	_glGenTextures(1, &texture);
+	_glBindTexture(GL_TEXTURE_2D, texture);
+	_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	return texture;
+}
+
+/**
+ * Load the OpenGL functions, and create the shader and textures.
+ * @param get_proc Function to get the address of OpenGL functions.
+ * @return nullptr on success, otherwise an error message.
+ */
+const char *OpenGLBackend::Init(OpenGLGetProcAddressProc get_proc)
+{
+#define LOAD_GL_FUNCTION(ret, name, args) _gl##name = (PFN_gl##name)get_proc("gl" #name); if (_gl##name == nullptr) return "OpenGL function gl" #name " missing";
+	OPENGL_FUNCTIONS(LOAD_GL_FUNCTION)
+#undef LOAD_GL_FUNCTION
+
+	const char *version = (const char *)_glGetString(GL_VERSION);
+	if (version == nullptr || atoi(version) < 3) return "OpenGL 3.2 or newer is needed";
+	DEBUG(driver, 1, "OpenGL: using %s, version %s", (const char *)_glGetString(GL_RENDERER), version);
+
+	GLuint vertex_shader = CompileShader(GL_VERTEX_SHADER, _vertex_shader_source);
+	GLuint fragment_shader = CompileShader(GL_FRAGMENT_SHADER, _fragment_shader_source);
+	if (vertex_shader == 0 || fragment_shader == 0) {
+		if (vertex_shader != 0) _glDeleteShader(vertex_shader);
+		if (fragment_shader != 0) _glDeleteShader(fragment_shader);
+		return "OpenGL shader failed to compile";
+	}
+
+	this->program = _glCreateProgram();
+	_glAttachShader(this->program, vertex_shader);
+	_glAttachShader(this->program, fragment_shader);
+	_glLinkProgram(this->program);
+	_glDeleteShader(vertex_shader);
+	_glDeleteShader(fragment_shader);
+
+	GLint status = 0;
+	_glGetProgramiv(this->program, GL_LINK_STATUS, &status);
+	if (status == 0) {
+		char log[1024];
+		_glGetProgramInfoLog(this->program, sizeof(log), nullptr, log);
+		DEBUG(driver, 0, "OpenGL: shader failed to link: %s", log);
+		return "OpenGL shader failed to link";
+	}
+
+	_glUseProgram(this->program);
+	_glUniform1i(_glGetUniformLocation(this->program, "video_tex"), 0);
+	_glUniform1i(_glGetUniformLocation(this->program, "anim_tex"), 1);
+	_glUniform1i(_glGetUniformLocation(this->program, "palette_tex"), 2);
+	this->mode_location = _glGetUniformLocation(this->program, "mode");
+
+	/* A core profile can not draw without a vertex array, even though nothing is read from it. */
+	_glGenVertexArrays(1, &this->vertex_array);
+	_glBindVertexArray(this->vertex_array);
+
+	_glActiveTexture(GL_TEXTURE0);
+	this->video_texture = CreateTexture();
+	_glActiveTexture(GL_TEXTURE0 + 1);
+	this->anim_texture = CreateTexture();
+	_glActiveTexture(GL_TEXTURE0 + 2);
+	this->palette_texture = CreateTexture();
+	_glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 256, 1, 0, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, nullptr);
+
+	_glDisable(GL_DEPTH_TEST);
+	_glDisable(GL_BLEND);
+	_glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	if (_glGetError() != GL_NO_ERROR) return "OpenGL initialisation failed";
+	return nullptr;
+}
+
+/**
+ * Change the size or depth of the screen.
+ * The contents of the screen are lost; everything has to be drawn and uploaded again.
+ * @param width The new width of the screen.
+ * @param height The new height of the screen.
+ * @param bpp The screen depth of the blitter, 8 or 32.
+ * @return True if the textures could be created.
+ */
+bool OpenGLBackend::Resize(int width, int height, int bpp)
+{
+	assert(bpp == 8 || bpp == 32);
+
+	this->width = width;
+	this->height = height;
+	this->bpp = bpp;
+
+	/* Allocate in uint32 to get the alignment for 32bpp; 8bpp only uses a quarter. */
+	this->video_buffer.assign(bpp == 8 ? (width * height + 3) / 4 : width * height, 0);
+
+	_glActiveTexture(GL_TEXTURE0);
+	_glBindTexture(GL_TEXTURE_2D, this->video_texture);
+	if (bpp == 8) {
+		_glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+	} else {
+		_glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, nullptr);
+	}
+
+	_glActiveTexture(GL_TEXTURE0 + 1);
+	_glBindTexture(GL_TEXTURE_2D, this->anim_texture);
+	_glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, width, height, 0, GL_RG, GL_UNSIGNED_BYTE, nullptr);
+
+	return _glGetError() == GL_NO_ERROR;
+}
+
+/**
+ * Upload changed colours of the palette.
+ * @param palette The colours of the palette.
+ * @param first The first changed colour.
+ * @param count The number of changed colours.
+ */
+void OpenGLBackend::UpdatePalette(const Colour *palette, uint first, uint count)
+{
+	assert(first + count <= 256);
+	if (count == 0) return;
+
+	_glActiveTexture(GL_TEXTURE0 + 2);
+	_glBindTexture(GL_TEXTURE_2D, this->palette_texture);
+	_glTexSubImage2D(GL_TEXTURE_2D, 0, first, 0, count, 1, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, palette + first);
+}
+
+/**
+ * Upload a changed part of the screen, and of the animation buffer of the blitter.
+ * @param left The left of the changed part.
+ * @param top The top of the changed part.
+ * @param width The width of the changed part.
+ * @param height The height of the changed part.
+ */
+void OpenGLBackend::UploadRect(int left, int top, int width, int height)
+{
+	/* Dirty rectangles may reach beyond the screen. */
+	width = min(width, this->width - left);
+	height = min(height, this->height - top);
+	if (width <= 0 || height <= 0) return;
+
+	_glActiveTexture(GL_TEXTURE0);
+	_glBindTexture(GL_TEXTURE_2D, this->video_texture);
+	_glPixelStorei(GL_UNPACK_ROW_LENGTH, this->width);
+	if (this->bpp == 8) {
+		const uint8 *src = (const uint8 *)this->video_buffer.data() + top * this->width + left;
+		_glTexSubImage2D(GL_TEXTURE_2D, 0, left, top, width, height, GL_RED, GL_UNSIGNED_BYTE, src);
+	} else {
+		const uint32 *src = this->video_buffer.data() + top * this->width + left;
+		_glTexSubImage2D(GL_TEXTURE_2D, 0, left, top, width, height, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, src);
+	}
+
+	int anim_pitch;
+	const uint16 *anim = BlitterFactory::GetCurrentBlitter()->GetAnimationBuffer(&anim_pitch);
+	if (anim != nullptr) {
+		_glActiveTexture(GL_TEXTURE0 + 1);
+		_glBindTexture(GL_TEXTURE_2D, this->anim_texture);
+		_glPixelStorei(GL_UNPACK_ROW_LENGTH, anim_pitch);
+		_glTexSubImage2D(GL_TEXTURE_2D, 0, left, top, width, height, GL_RG, GL_UNSIGNED_BYTE, anim + top * anim_pitch + left);
+	}
+
+	_glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+/**
+ * Draw the uploaded screen to the window. After this the buffers of the window have to be swapped.
+ * @param window_width The width of the drawable area of the window, in pixels.
+ * @param window_height The height of the drawable area of the window, in pixels.
+ */
+void OpenGLBackend::Paint(int window_width, int window_height)
+{
+	int anim_pitch;
+	ShaderMode mode = SM_COLOUR;
+	if (this->bpp == 8) {
+		mode = SM_PALETTE;
+	} else if (BlitterFactory::GetCurrentBlitter()->GetAnimationBuffer(&anim_pitch) != nullptr) {
+		mode = SM_ANIM;
+	}
+
+	_glViewport(0, 0, window_width, window_height);
+	_glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	_glClear(GL_COLOR_BUFFER_BIT);
+
+	_glUseProgram(this->program);
+	_glUniform1i(this->mode_location, mode);
+	_glBindVertexArray(this->vertex_array);
+	_glDrawArrays(GL_TRIANGLES, 0, 3);
+}
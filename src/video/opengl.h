@@ -0,0 +1,78 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file opengl.h OpenGL video output, shared by the video drivers that support it. */
+
+#ifndef VIDEO_OPENGL_H
+#define VIDEO_OPENGL_H
+
+#include "../gfx_type.h"
+#include <vector>
+
+/** Function to get the address of an OpenGL function of the current context. */
+typedef void *(*OpenGLGetProcAddressProc)(const char *name);
+
+/**
+ * Output of the software rendered screen via OpenGL.
+ *
+ * The blitter draws into a buffer of this backend; the dirty parts of it are
+ * uploaded to a texture, which is then drawn to the window. With the 8bpp
+ * blitter the palette lookup, and with a blitter keeping an animation buffer
+ * the palette animation, are done by a shader. Changing the palette then only
+ * uploads the palette instead of redrawing and copying the whole screen.
+ *
+ * All methods have to be called with the OpenGL context current.
+ */
+class OpenGLBackend {
+	static OpenGLBackend *instance;  ///< The backend of the current context.
+
+	std::vector<uint32> video_buffer; ///< Buffer the blitter draws into; bytes for 8bpp, #Colour for 32bpp.
+	int width;                        ///< Width of the screen in pixels.
+	int height;                       ///< Height of the screen in pixels.
+	int bpp;                          ///< Screen depth of the blitter.
+
+	uint program;                     ///< Shader program drawing the screen.
+	uint vertex_array;                ///< (Empty) vertex array object; a full screen triangle is made by the vertex shader.
+	uint video_texture;               ///< Texture with the screen.
+	uint anim_texture;                ///< Texture with the palette indices and brightness of the palette animated pixels.
+	uint palette_texture;             ///< Texture with the 256 colours of the palette.
+	int mode_location;                ///< Location of the uniform with the #ShaderMode.
+
+	OpenGLBackend();
+	~OpenGLBackend();
+
+	const char *Init(OpenGLGetProcAddressProc get_proc);
+
+public:
+	static const char *Create(OpenGLGetProcAddressProc get_proc);
+	static void Destroy();
+
+	/**
+	 * Get the backend of the current context.
+	 * @return The backend, or \c nullptr when none is created.
+	 */
+	static inline OpenGLBackend *Get()
+	{
+		return OpenGLBackend::instance;
+	}
+
+	bool Resize(int width, int height, int bpp);
+	void UpdatePalette(const Colour *palette, uint first, uint count);
+	void UploadRect(int left, int top, int width, int height);
+	void Paint(int window_width, int window_height);
+
+	/**
+	 * Get the buffer the blitter has to draw into.
+	 * @return The buffer, which has a pitch of the width of the screen.
+	 */
+	inline void *GetVideoBuffer()
+	{
+		return this->video_buffer.data();
+	}
+};
+
+#endif /* VIDEO_OPENGL_H */
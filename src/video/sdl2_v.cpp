@@ -23,10 +23,12 @@
 #include "../framerate_type.h"
 #include "../window_func.h"
 #include "sdl2_v.h"
+#include "opengl.h"
 #include <SDL.h>
 #include <mutex>
 #include <condition_variable>
 #include <algorithm>
+#include <atomic>
 
 #include "../safeguards.h"
 
@@ -36,6 +38,13 @@ static SDL_Window *_sdl_window;
 static SDL_Surface *_sdl_surface;
 static SDL_Surface *_sdl_realscreen;
 
+/** Whether the screen should be shown via OpenGL. */
+static bool _use_opengl;
+/** The OpenGL context of the window, or \c nullptr when the screen is shown via the window surface. */
+static SDL_GLContext _gl_context = nullptr;
+/** Whether the screen has to be drawn again via OpenGL, even though nothing was uploaded. */
+static bool _gl_repaint;
+
 /** Whether the drawing is/may be done in a separate thread. */
 static bool _draw_threaded;
 /** Mutex to keep the access to the shared memory controlled. */
@@ -44,6 +53,16 @@ static std::recursive_mutex *_draw_mutex = nullptr;
 static std::condition_variable_any *_draw_signal = nullptr;
 /** Should we keep continue drawing? */
 static volatile bool _draw_continue;
+/** Whether the game loop runs on a separate thread, apart from the input handling and drawing. */
+static bool _game_threaded;
+/** Mutex guarding the game state; held by the game thread while ticking, and by the main thread while handling input and drawing. */
+static std::mutex _game_state_mutex;
+/** Whether the main thread is waiting for #_game_state_mutex; the game thread then lets it go first. */
+static std::atomic<bool> _game_state_wanted(false);
+/** Should the game thread keep ticking? */
+static std::atomic<bool> _game_thread_continue(false);
+/** Number of ticks the game thread may lag behind before it stops catching up. */
+static const uint GAME_THREAD_MAX_LAG = 5;
 static Palette _local_palette;
 static SDL_Palette *_sdl_palette;
 
@@ -68,6 +87,14 @@ void VideoDriver_SDL::MakeDirty(int left, int top, int width, int height)
 
 static void UpdatePalette(bool init = false)
 {
+	if (_gl_context != nullptr) {
+		/* The palette lookups are done by the shader, so the screen only has to be drawn again. */
+		OpenGLBackend::Get()->UpdatePalette(_local_palette.palette, _local_palette.first_dirty, _local_palette.count_dirty);
+		BlitterFactory::GetCurrentBlitter()->UpdatePalette(_local_palette);
+		_gl_repaint = true;
+		return;
+	}
+
 	SDL_Color pal[256];
 
 	for (int i = 0; i != _local_palette.count_dirty; i++) {
@@ -132,6 +159,7 @@ static void CheckPaletteAnim()
 {
 	if (_cur_palette.count_dirty != 0) {
 		Blitter *blitter = BlitterFactory::GetCurrentBlitter();
+		int anim_pitch;
 
 		switch (blitter->UsePaletteAnimation()) {
 			case Blitter::PALETTE_ANIMATION_VIDEO_BACKEND:
@@ -139,7 +167,12 @@ static void CheckPaletteAnim()
 				break;
 
 			case Blitter::PALETTE_ANIMATION_BLITTER:
-				blitter->PaletteAnimate(_local_palette);
+				if (_gl_context != nullptr && blitter->GetAnimationBuffer(&anim_pitch) != nullptr) {
+					/* The shader animates the palette from the animation buffer of the blitter. */
+					UpdatePalette();
+				} else {
+					blitter->PaletteAnimate(_local_palette);
+				}
 				break;
 
 			case Blitter::PALETTE_ANIMATION_NONE:
@@ -152,15 +185,43 @@ static void CheckPaletteAnim()
 	}
 }
 
+/**
+ * Upload the dirty parts of the screen to OpenGL, and show the screen.
+ * @param n The number of dirty rectangles.
+ */
+static void DrawOpenGLToScreen(int n)
+{
+	OpenGLBackend *backend = OpenGLBackend::Get();
+
+	if (n > MAX_DIRTY_RECTS) {
+		backend->UploadRect(0, 0, _screen.width, _screen.height);
+	} else {
+		for (int i = 0; i < n; i++) {
+			backend->UploadRect(_dirty_rects[i].x, _dirty_rects[i].y, _dirty_rects[i].w, _dirty_rects[i].h);
+		}
+	}
+
+	int w, h;
+	SDL_GL_GetDrawableSize(_sdl_window, &w, &h);
+	backend->Paint(w, h);
+	SDL_GL_SwapWindow(_sdl_window);
+	_gl_repaint = false;
+}
+
 static void DrawSurfaceToScreen()
 {
 	PerformanceMeasurer framerate(PFE_VIDEO);
 
 	int n = _num_dirty_rects;
-	if (n == 0) return;
+	if (n == 0 && !_gl_repaint) return;
 
 	_num_dirty_rects = 0;
 
+	if (_gl_context != nullptr) {
+		DrawOpenGLToScreen(n);
+		return;
+	}
+
 	if (n > MAX_DIRTY_RECTS) {
 		if (_sdl_surface != _sdl_realscreen) {
 			SDL_BlitSurface(_sdl_surface, nullptr, _sdl_realscreen, nullptr);
@@ -197,6 +258,86 @@ static void DrawSurfaceToScreenThread()
 	}
 }
 
+/** Run the game loop at its own pace, until the main loop ends. */
+static void GameThread()
+{
+	uint32 next_tick = SDL_GetTicks() + MILLISECONDS_PER_TICK;
+	bool fast_forward = false;
+
+	while (_game_thread_continue) {
+		uint32 cur_ticks = SDL_GetTicks();
+		if (!fast_forward && !SDL_TICKS_PASSED(cur_ticks, next_tick)) {
+			CSleep(1);
+			continue;
+		}
+
+		/* Keep a steady pace, but do not catch up on ticks that were missed long ago. */
+		next_tick += MILLISECONDS_PER_TICK;
+		if (SDL_TICKS_PASSED(cur_ticks, next_tick + GAME_THREAD_MAX_LAG * MILLISECONDS_PER_TICK)) next_tick = cur_ticks + MILLISECONDS_PER_TICK;
+
+		/* When fast forwarding, the main thread would not get the game state otherwise. */
+		while (_game_state_wanted) std::this_thread::yield();
+
+		std::lock_guard<std::mutex> lock(_game_state_mutex);
+		GameLoop();
+		fast_forward = _fast_forward && !_pause_mode;
+	}
+}
+
+/**
+ * Get the time between drawing two frames when the game loop runs on a separate thread.
+ * @return The refresh interval of the display of the window, in milliseconds.
+ */
+static uint32 GetDrawInterval()
+{
+	SDL_DisplayMode dm;
+	int display = max(SDL_GetWindowDisplayIndex(_sdl_window), 0);
+	if (SDL_GetCurrentDisplayMode(display, &dm) < 0 || dm.refresh_rate <= 0) return 1000 / 60;
+	return max(1000 / dm.refresh_rate, 1);
+}
+
+/**
+ * Check whether the fast forward key is held, and change the speed of the game accordingly.
+ * @param mod The state of the modifier keys.
+ * @param keys The state of the keyboard.
+ */
+static void CheckFastForwardKey(uint32 mod, const Uint8 *keys)
+{
+#if defined(_DEBUG)
+	if (_shift_pressed)
+#else
+	/* Speedup when pressing tab, except when using ALT+TAB
+	 * to switch to another application */
+	if (keys[SDL_SCANCODE_TAB] && (mod & KMOD_ALT) == 0)
+#endif /* defined(_DEBUG) */
+	{
+		if (!_networking && _game_mode != GM_MENU) _fast_forward |= 2;
+	} else if (_fast_forward & 2) {
+		_fast_forward = 0;
+	}
+}
+
+/**
+ * Update the state of the modifier and direction keys for the game.
+ * @param mod The state of the modifier keys.
+ * @param keys The state of the keyboard.
+ */
+static void UpdateModifierKeys(uint32 mod, const Uint8 *keys)
+{
+	bool old_ctrl_pressed = _ctrl_pressed;
+
+	_ctrl_pressed  = !!(mod & KMOD_CTRL);
+	_shift_pressed = !!(mod & KMOD_SHIFT);
+
+	/* determine which directional keys are down */
+	_dirkeys =
+		(keys[SDL_SCANCODE_LEFT]  ? 1 : 0) |
+		(keys[SDL_SCANCODE_UP]    ? 2 : 0) |
+		(keys[SDL_SCANCODE_RIGHT] ? 4 : 0) |
+		(keys[SDL_SCANCODE_DOWN]  ? 8 : 0);
+	if (old_ctrl_pressed != _ctrl_pressed) HandleCtrlChanged();
+}
+
 static void GetVideoModes()
 {
 	int modes = SDL_GetNumDisplayModes(0);
@@ -242,6 +383,42 @@ static void GetAvailableVideoMode(uint *w, uint *h)
 	*h = _resolutions[best].height;
 }
 
+/** Get the address of an OpenGL function for the #OpenGLBackend. */
+static void *GetOpenGLProcAddress(const char *name)
+{
+	return SDL_GL_GetProcAddress(name);
+}
+
+/**
+ * Create the OpenGL context of the window, and the #OpenGLBackend for it.
+ * @return nullptr on success, otherwise an error message.
+ */
+static const char *CreateOpenGLContext()
+{
+	_gl_context = SDL_GL_CreateContext(_sdl_window);
+	if (_gl_context == nullptr) return SDL_GetError();
+
+	/* Do not wait for the vertical blank; the main loop does its own timing. */
+	SDL_GL_SetSwapInterval(0);
+
+	const char *error = OpenGLBackend::Create(&GetOpenGLProcAddress);
+	if (error != nullptr) {
+		SDL_GL_DeleteContext(_gl_context);
+		_gl_context = nullptr;
+	}
+	return error;
+}
+
+/** Free the OpenGL context of the window, and the #OpenGLBackend for it. */
+static void DestroyOpenGLContext()
+{
+	if (_gl_context == nullptr) return;
+
+	OpenGLBackend::Destroy();
+	SDL_GL_DeleteContext(_gl_context);
+	_gl_context = nullptr;
+}
+
 bool VideoDriver_SDL::CreateMainSurface(uint w, uint h, bool resize)
 {
 	SDL_Surface *newscreen;
@@ -268,6 +445,14 @@ bool VideoDriver_SDL::CreateMainSurface(uint w, uint h, bool resize)
 			flags |= SDL_WINDOW_RESIZABLE;
 		}
 
+		if (_use_opengl) {
+			SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+			SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 2);
+			SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+			SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+			flags |= SDL_WINDOW_OPENGL;
+		}
+
 		_sdl_window = SDL_CreateWindow(
 			caption,
 			SDL_WINDOWPOS_UNDEFINED,
@@ -293,10 +478,49 @@ bool VideoDriver_SDL::CreateMainSurface(uint w, uint h, bool resize)
 				SDL_FreeSurface(icon);
 			}
 		}
+
+		if (_use_opengl) {
+			const char *error = CreateOpenGLContext();
+			if (error != nullptr) {
+				/* A window surface can not be used with an OpenGL window, so start over without. */
+				DEBUG(driver, 0, "SDL2: Couldn't use OpenGL, falling back to the window surface: %s", error);
+				_use_opengl = false;
+				SDL_DestroyWindow(_sdl_window);
+				_sdl_window = nullptr;
+				return CreateMainSurface(w, h, resize);
+			}
+		}
 	}
 
 	if (resize) SDL_SetWindowSize(_sdl_window, w, h);
 
+	if (_gl_context != nullptr) {
+		if (!OpenGLBackend::Get()->Resize(w, h, bpp)) {
+			DEBUG(driver, 0, "SDL2: Couldn't allocate OpenGL textures");
+			return false;
+		}
+
+		/* Delay drawing for this cycle; the next cycle will redraw the whole screen */
+		_num_dirty_rects = 0;
+
+		_screen.width = w;
+		_screen.height = h;
+		_screen.pitch = w;
+		_screen.dst_ptr = OpenGLBackend::Get()->GetVideoBuffer();
+		_sdl_surface = nullptr;
+		_sdl_realscreen = nullptr;
+
+		if (_fullscreen) _cursor.in_window = true;
+
+		BlitterFactory::GetCurrentBlitter()->PostResize();
+
+		InitPalette();
+
+		GameSizeChanged();
+
+		return true;
+	}
+
 	newscreen = SDL_GetWindowSurface(_sdl_window);
 	if (newscreen == NULL) {
 		DEBUG(driver, 0, "SDL2: Couldn't get window surface: %s", SDL_GetError());
@@ -643,6 +867,7 @@ const char *VideoDriver_SDL::Start(const char * const *parm)
 	if (ret_code < 0) return SDL_GetError();
 
 	GetVideoModes();
+	_use_opengl = GetDriverParamBool(parm, "opengl");
 	if (!CreateMainSurface(_cur_resolution.width, _cur_resolution.height, false)) {
 		return SDL_GetError();
 	}
@@ -653,6 +878,15 @@ const char *VideoDriver_SDL::Start(const char * const *parm)
 	MarkWholeScreenDirty();
 
 	_draw_threaded = GetDriverParam(parm, "no_threads") == nullptr && GetDriverParam(parm, "no_thread") == nullptr;
+	_game_threaded = GetDriverParamBool(parm, "game_thread");
+	/* The OpenGL context is current on this thread only, but the game loop may change the blitter. */
+	if (_gl_context != nullptr) {
+		if (_game_threaded) DEBUG(driver, 0, "SDL2: a game thread can not be used with OpenGL");
+		_draw_threaded = false;
+		_game_threaded = false;
+	}
+	/* With a game thread, drawing already happens while the game loop runs. */
+	if (_game_threaded) _draw_threaded = false;
 
 	SDL_StopTextInput();
 	this->edit_box_focused = false;
@@ -662,6 +896,7 @@ const char *VideoDriver_SDL::Start(const char * const *parm)
 
 void VideoDriver_SDL::Stop()
 {
+	DestroyOpenGLContext();
 	SDL_QuitSubSystem(SDL_INIT_VIDEO);
 	if (SDL_WasInit(SDL_INIT_EVERYTHING) == 0) {
 		SDL_Quit(); // If there's nothing left, quit SDL
@@ -677,6 +912,8 @@ void VideoDriver_SDL::MainLoop()
 	int numkeys;
 	const Uint8 *keys;
 
+	if (_game_threaded && this->MainLoopWithGameThread()) return;
+
 	CheckPaletteAnim();
 
 	std::thread draw_thread;
@@ -720,19 +957,7 @@ void VideoDriver_SDL::MainLoop()
 
 		mod = SDL_GetModState();
 		keys = SDL_GetKeyboardState(&numkeys);
-
-#if defined(_DEBUG)
-		if (_shift_pressed)
-#else
-		/* Speedup when pressing tab, except when using ALT+TAB
-		 * to switch to another application */
-		if (keys[SDL_SCANCODE_TAB] && (mod & KMOD_ALT) == 0)
-#endif /* defined(_DEBUG) */
-		{
-			if (!_networking && _game_mode != GM_MENU) _fast_forward |= 2;
-		} else if (_fast_forward & 2) {
-			_fast_forward = 0;
-		}
+		CheckFastForwardKey(mod, keys);
 
 		cur_ticks = SDL_GetTicks();
 		if (SDL_TICKS_PASSED(cur_ticks, next_tick) || (_fast_forward && !_pause_mode) || cur_ticks < prev_cur_ticks) {
@@ -740,18 +965,7 @@ void VideoDriver_SDL::MainLoop()
 			last_cur_ticks = cur_ticks;
 			next_tick = cur_ticks + MILLISECONDS_PER_TICK;
 
-			bool old_ctrl_pressed = _ctrl_pressed;
-
-			_ctrl_pressed  = !!(mod & KMOD_CTRL);
-			_shift_pressed = !!(mod & KMOD_SHIFT);
-
-			/* determine which directional keys are down */
-			_dirkeys =
-				(keys[SDL_SCANCODE_LEFT]  ? 1 : 0) |
-				(keys[SDL_SCANCODE_UP]    ? 2 : 0) |
-				(keys[SDL_SCANCODE_RIGHT] ? 4 : 0) |
-				(keys[SDL_SCANCODE_DOWN]  ? 8 : 0);
-			if (old_ctrl_pressed != _ctrl_pressed) HandleCtrlChanged();
+			UpdateModifierKeys(mod, keys);
 
 			/* The gameloop is the part that can run asynchronously. The rest
 			 * except sleeping can't. */
@@ -800,6 +1014,69 @@ void VideoDriver_SDL::MainLoop()
 	}
 }
 
+/**
+ * Main loop when the game loop runs on a separate thread. The game thread ticks
+ * at its own pace, while this thread handles the input and draws a frame every
+ * refresh of the display. Both take turns to have the game state.
+ * @return False if the game thread could not be started.
+ */
+bool VideoDriver_SDL::MainLoopWithGameThread()
+{
+	_game_thread_continue = true;
+	std::thread game_thread;
+	if (!StartNewThread(&game_thread, "ottd:game", &GameThread)) {
+		DEBUG(driver, 0, "SDL2: couldn't start the game thread");
+		_game_thread_continue = false;
+		return false;
+	}
+
+	const uint32 draw_interval = GetDrawInterval();
+	DEBUG(driver, 1, "SDL2: using a game thread, drawing every %u ms", draw_interval);
+
+	uint32 cur_ticks = SDL_GetTicks();
+	uint32 last_cur_ticks = cur_ticks;
+	uint32 next_draw = cur_ticks;
+
+	for (;;) {
+		_game_state_wanted = true;
+		std::unique_lock<std::mutex> lock(_game_state_mutex);
+		_game_state_wanted = false;
+
+		InteractiveRandom(); // randomness
+
+		while (PollEvent() == -1) {}
+		if (_exit_game) break;
+
+		int numkeys;
+		uint32 mod = SDL_GetModState();
+		const Uint8 *keys = SDL_GetKeyboardState(&numkeys);
+		CheckFastForwardKey(mod, keys);
+
+		cur_ticks = SDL_GetTicks();
+		if (SDL_TICKS_PASSED(cur_ticks, next_draw)) {
+			next_draw += draw_interval;
+			if (SDL_TICKS_PASSED(cur_ticks, next_draw)) next_draw = cur_ticks + draw_interval;
+
+			_realtime_tick += cur_ticks - last_cur_ticks;
+			last_cur_ticks = cur_ticks;
+
+			UpdateModifierKeys(mod, keys);
+			UpdateWindows();
+			_local_palette = _cur_palette;
+			CheckPaletteAnim();
+			DrawSurfaceToScreen();
+		}
+
+		/* Give the game thread the game state while sleeping. */
+		lock.unlock();
+		CSleep(1);
+	}
+
+	_game_thread_continue = false;
+	game_thread.join();
+	return true;
+}
+
 bool VideoDriver_SDL::ChangeResolution(int w, int h)
 {
 	std::unique_lock<std::recursive_mutex> lock;
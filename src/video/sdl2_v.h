@@ -42,6 +42,7 @@ public:
 	const char *GetName() const override { return "sdl"; }
 private:
 	int PollEvent();
+	bool MainLoopWithGameThread();
 	bool CreateMainSurface(uint w, uint h, bool resize);
 
 	/**
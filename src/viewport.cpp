@@ -88,8 +88,14 @@
 #include "command_func.h"
 #include "network/network_func.h"
 #include "framerate_type.h"
+#include "worker_pool.h"
+#include "newgrf_debug.h"
+#include "genworld.h"
+#include "smallmap_gui.h"
 
+#include <algorithm>
 #include <map>
+#include <unordered_map>
 
 #include "table/strings.h"
 #include "table/string_colours.h"
@@ -157,6 +163,35 @@ typedef std::vector<StringSpriteToDraw> StringSpriteToDrawVector;
 typedef std::vector<ParentSpriteToDraw> ParentSpriteToDrawVector;
 typedef std::vector<ChildScreenSpriteToDraw> ChildScreenSpriteToDrawVector;
 
+/** How a parent sprite in the tile sprite cache takes part in "sprite combining". */
+enum CachedSpriteCombine : byte {
+	CSC_NONE,     ///< Not part of a combined block.
+	CSC_FIRST,    ///< First sprite of a combined block.
+	CSC_COMBINED, ///< Later sprite of a combined block; it becomes a child sprite of the first sprite of the block that is not clipped.
+};
+
+/** Clipping information of a parent sprite in the tile sprite cache. */
+struct CachedParentSpriteInfo {
+	Rect extent;                 ///< Screen extent of the sprite (and its bounding box, when those are drawn); the sprite is clipped when this is outside the drawn area.
+	CachedSpriteCombine combine; ///< Whether the sprite is part of a combined block.
+};
+
+/**
+ * Sprites added by the draw proc of a tile, collected without clipping them
+ * to the drawn area. They are reused until the tile is marked dirty.
+ */
+struct TileSpriteCacheEntry {
+	ZoomLevel zoom = ZOOM_LVL_END;                      ///< Zoom level the sprites were collected for, or #ZOOM_LVL_END if nothing has been collected.
+	bool uncacheable = false;                           ///< The draw proc of the tile does something that cannot be replayed, so it has to be called every time.
+	TileSpriteToDrawVector tile_sprites;                ///< Tile sprites of the tile.
+	ParentSpriteToDrawVector parent_sprites;            ///< Parent sprites of the tile; \c first_child is an index into #child_sprites.
+	std::vector<CachedParentSpriteInfo> parent_info;    ///< Clipping information of #parent_sprites.
+	ChildScreenSpriteToDrawVector child_sprites;        ///< Child sprites of the parent sprites; \c next is an index into this vector.
+	FoundationPart foundation_part;                     ///< Foundation part that was active after the draw proc.
+	int foundation[FOUNDATION_PART_END];                ///< Foundation sprites (index into #parent_sprites), or -1.
+	Point foundation_offset[FOUNDATION_PART_END];       ///< Pixel offset for ground sprites on the foundations.
+};
+
 /** Data structure storing rendering information */
 struct ViewportDrawer {
 	DrawPixelInfo dpi;
@@ -175,6 +210,11 @@ struct ViewportDrawer {
 	FoundationPart foundation_part;                  ///< Currently active foundation for ground sprite drawing.
 	int *last_foundation_child[FOUNDATION_PART_END]; ///< Tail of ChildSprite list of the foundations. (index into child_screen_sprites_to_draw)
 	Point foundation_offset[FOUNDATION_PART_END];    ///< Pixel offset for ground sprites on the foundations.
+
+	bool fill_tile_cache;                            ///< Whether the sprites of the current tile are collected for the tile sprite cache; they are not clipped then.
+	bool tile_cache_failed;                          ///< Whether the current tile added sprites in a way the tile sprite cache cannot replay.
+	int *combined_child;                             ///< ChildSprite list of the last combined sprite added while filling the tile sprite cache.
+	std::vector<CachedParentSpriteInfo> parent_info; ///< Clipping information of the parent sprites added while filling the tile sprite cache.
 };
 
 static void MarkViewportDirty(const ViewPort *vp, int left, int top, int right, int bottom);
@@ -188,6 +228,15 @@ bool _draw_dirty_blocks = false;
 uint _dirty_block_colour = 0;
 static VpSpriteSorter _vp_sprite_sorter = nullptr;
 
+static const uint TILE_SPRITE_CACHE_MAX_TILES = 1 << 17;  ///< Maximum number of tiles in the tile sprite cache; it is emptied when it grows beyond this.
+static std::unordered_map<TileIndex, TileSpriteCacheEntry> _tile_sprite_cache; ///< Sprites of the tiles drawn recently, see #TileSpriteCacheEntry.
+static uint _tile_sprite_cache_generation = 0;            ///< Incremented when the whole tile sprite cache has to be emptied.
+
+static const int VIEWPORT_DRAW_PART_AREA = 256 * 256; ///< Maximum number of screen pixels of a part of a viewport that is drawn on its own, when drawing on multiple threads.
+
+static const ViewPort *_vp_prefetch_viewport = nullptr; ///< Viewport that scrolled since it was drawn the last time, see #ViewportPrefetchSprites.
+static std::vector<Rect> _vp_prefetch_areas;            ///< Areas just beyond the edges #_vp_prefetch_viewport is scrolling towards, in viewport coordinates.
+
 static Point MapXYZToViewport(const ViewPort *vp, int x, int y, int z)
 {
 	Point p = RemapCoords(x, y, z);
@@ -200,6 +249,7 @@ void DeleteWindowViewport(Window *w)
 {
 	if (w->viewport == nullptr) return;
 
+	if (_vp_prefetch_viewport == w->viewport) _vp_prefetch_viewport = nullptr;
 	delete w->viewport->overlay;
 	free(w->viewport);
 	w->viewport = nullptr;
@@ -329,6 +379,33 @@ static void DoSetViewportPosition(const Window *w, int left, int top, int width,
 	}
 }
 
+/**
+ * Remember the areas a viewport is scrolling towards, so their sprites can be loaded before they become visible.
+ * @param vp The viewport.
+ * @param dx Number of screen pixels the viewport moved to the right.
+ * @param dy Number of screen pixels the viewport moved down.
+ */
+static void ViewportSchedulePrefetch(const ViewPort *vp, int dx, int dy)
+{
+	if (GetWorkerThreadCount() <= 1) return;
+
+	_vp_prefetch_viewport = vp;
+	_vp_prefetch_areas.clear();
+
+	/* Look ahead twice the distance of this move, but not more than a quarter of the viewport. */
+	int ahead_x = ScaleByZoom(min(abs(dx) * 2, vp->width / 4), vp->zoom);
+	int ahead_y = ScaleByZoom(min(abs(dy) * 2, vp->height / 4), vp->zoom);
+	int left = vp->virtual_left;
+	int top = vp->virtual_top;
+	int right = left + vp->virtual_width;
+	int bottom = top + vp->virtual_height;
+
+	if (dx > 0) _vp_prefetch_areas.push_back({right, top, right + ahead_x, bottom});
+	if (dx < 0) _vp_prefetch_areas.push_back({left - ahead_x, top, left, bottom});
+	if (dy > 0) _vp_prefetch_areas.push_back({left, bottom, right, bottom + ahead_y});
+	if (dy < 0) _vp_prefetch_areas.push_back({left, top - ahead_y, right, top});
+}
+
 static void SetViewportPosition(Window *w, int x, int y)
 {
 	ViewPort *vp = w->viewport;
@@ -353,6 +430,8 @@ static void SetViewportPosition(Window *w, int x, int y)
 
 	if (old_top == 0 && old_left == 0) return;
 
+	ViewportSchedulePrefetch(vp, -old_left, -old_top);
+
 	_vp_move_offs.x = old_left;
 	_vp_move_offs.y = old_top;
 
@@ -668,7 +747,7 @@ void AddSortableSpriteToDraw(SpriteID image, PaletteID pal, int x, int y, int w,
 		pal = PALETTE_TO_TRANSPARENT;
 	}
 
-	if (_vd.combine_sprites == SPRITE_COMBINE_ACTIVE) {
+	if (_vd.combine_sprites == SPRITE_COMBINE_ACTIVE && !_vd.fill_tile_cache) {
 		AddCombinedSprite(image, pal, x, y, z, sub);
 		return;
 	}
@@ -700,11 +779,17 @@ void AddSortableSpriteToDraw(SpriteID image, PaletteID pal, int x, int y, int w,
 		bottom = max(bottom, RemapCoords(x + w          , y + h          , z + bb_offset_z).y + 1);
 	}
 
-	/* Do not add the sprite to the viewport, if it is outside */
-	if (left   >= _vd.dpi.left + _vd.dpi.width ||
-	    right  <= _vd.dpi.left                 ||
-	    top    >= _vd.dpi.top + _vd.dpi.height ||
-	    bottom <= _vd.dpi.top) {
+	if (_vd.fill_tile_cache) {
+		/* Clipping and combining are done when the sprites are taken from the cache. */
+		CachedSpriteCombine combine = CSC_NONE;
+		if (_vd.combine_sprites == SPRITE_COMBINE_PENDING) combine = CSC_FIRST;
+		if (_vd.combine_sprites == SPRITE_COMBINE_ACTIVE) combine = CSC_COMBINED;
+		_vd.parent_info.push_back({{left, top, right, bottom}, combine});
+	} else if (left   >= _vd.dpi.left + _vd.dpi.width ||
+	           right  <= _vd.dpi.left                 ||
+	           top    >= _vd.dpi.top + _vd.dpi.height ||
+	           bottom <= _vd.dpi.top) {
+		/* Do not add the sprite to the viewport, if it is outside */
 		return;
 	}
 
@@ -728,10 +813,10 @@ void AddSortableSpriteToDraw(SpriteID image, PaletteID pal, int x, int y, int w,
 	ps.zmin = z + bb_offset_z;
 	ps.zmax = z + max(bb_offset_z, dz) - 1;
 
-	ps.comparison_done = false;
 	ps.first_child = -1;
 
 	_vd.last_child = &ps.first_child;
+	if (_vd.fill_tile_cache && _vd.combine_sprites == SPRITE_COMBINE_ACTIVE) _vd.combined_child = _vd.last_child;
 
 	if (_vd.combine_sprites == SPRITE_COMBINE_PENDING) _vd.combine_sprites = SPRITE_COMBINE_ACTIVE;
 }
@@ -819,6 +904,9 @@ void AddChildSpriteScreen(SpriteID image, PaletteID pal, int x, int y, bool tran
 	/* If the ParentSprite was clipped by the viewport bounds, do not draw the ChildSprites either */
 	if (_vd.last_child == nullptr) return;
 
+	/* Combined sprites become child sprites themselves when taken from the tile sprite cache, so they cannot have children. */
+	if (_vd.last_child == _vd.combined_child) _vd.tile_cache_failed = true;
+
 	/* make the sprites transparent with the right palette */
 	if (transparent) {
 		SetBit(image, PALETTE_MODIFIER_TRANSPARENT);
@@ -1162,6 +1250,228 @@ static int GetViewportY(Point tile)
 	return (tile.y * (int)(TILE_PIXELS / 2) + tile.x * (int)(TILE_PIXELS / 2) - TilePixelHeightOutsideMap(tile.x, tile.y)) << ZOOM_LVL_SHIFT;
 }
 
+/**
+ * Check whether a screen extent intersects the area that is currently drawn.
+ * @param extent The screen extent, with exclusive right and bottom edges.
+ * @return True if (a part of) the extent is drawn.
+ */
+static inline bool IsInsideDrawArea(const Rect &extent)
+{
+	return extent.left < _vd.dpi.left + _vd.dpi.width && extent.right > _vd.dpi.left &&
+			extent.top < _vd.dpi.top + _vd.dpi.height && extent.bottom > _vd.dpi.top;
+}
+
+/**
+ * Run the draw proc of a tile, collecting its sprites for the tile sprite cache.
+ * @param tile_type Type of the tile.
+ * @param ti Tile that is being drawn.
+ * @param[out] entry Cache entry to fill.
+ * @return False if the sprites of the tile cannot be cached; #_vd is left unchanged then.
+ */
+static bool ViewportFillTileSpriteCache(TileType tile_type, TileInfo *ti, TileSpriteCacheEntry &entry)
+{
+	size_t first_tile_sprite = _vd.tile_sprites_to_draw.size();
+	size_t first_parent = _vd.parent_sprites_to_draw.size();
+	size_t first_child = _vd.child_screen_sprites_to_draw.size();
+	size_t first_string = _vd.string_sprites_to_draw.size();
+
+	_vd.fill_tile_cache = true;
+	_vd.tile_cache_failed = false;
+	_vd.parent_info.clear();
+
+	_tile_type_procs[tile_type]->draw_tile_proc(ti);
+
+	_vd.fill_tile_cache = false;
+	_vd.combined_child = nullptr;
+
+	/* Strings are not cached, and combined blocks must be closed. */
+	bool ok = !_vd.tile_cache_failed && _vd.string_sprites_to_draw.size() == first_string && _vd.combine_sprites == SPRITE_COMBINE_NONE;
+	if (ok) {
+		int child_offset = (int)first_child;
+		auto rebase = [child_offset](int index) { return index < 0 ? index : index - child_offset; };
+
+		entry.tile_sprites.assign(_vd.tile_sprites_to_draw.begin() + first_tile_sprite, _vd.tile_sprites_to_draw.end());
+		entry.parent_sprites.assign(_vd.parent_sprites_to_draw.begin() + first_parent, _vd.parent_sprites_to_draw.end());
+		for (ParentSpriteToDraw &ps : entry.parent_sprites) ps.first_child = rebase(ps.first_child);
+		entry.parent_info = _vd.parent_info;
+		entry.child_sprites.assign(_vd.child_screen_sprites_to_draw.begin() + first_child, _vd.child_screen_sprites_to_draw.end());
+		for (ChildScreenSpriteToDraw &cs : entry.child_sprites) cs.next = rebase(cs.next);
+
+		entry.foundation_part = _vd.foundation_part;
+		for (uint i = 0; i < FOUNDATION_PART_END; i++) {
+			entry.foundation[i] = _vd.foundation[i] < 0 ? -1 : _vd.foundation[i] - (int)first_parent;
+			entry.foundation_offset[i] = _vd.foundation_offset[i];
+		}
+	}
+
+	/* The unclipped sprites are replaced by the (clipped) cached ones. */
+	_vd.tile_sprites_to_draw.resize(first_tile_sprite);
+	_vd.parent_sprites_to_draw.resize(first_parent);
+	_vd.child_screen_sprites_to_draw.resize(first_child);
+	_vd.string_sprites_to_draw.resize(first_string);
+	_vd.combine_sprites = SPRITE_COMBINE_NONE;
+	_vd.last_child = nullptr;
+	_vd.parent_info.clear();
+	return ok;
+}
+
+/**
+ * Add the cached sprites of a tile to #_vd, with the same result as running the draw proc of the tile.
+ * @param entry Cache entry of the tile.
+ */
+static void ViewportAddCachedTileSprites(const TileSpriteCacheEntry &entry)
+{
+	_vd.tile_sprites_to_draw.insert(_vd.tile_sprites_to_draw.end(), entry.tile_sprites.begin(), entry.tile_sprites.end());
+
+	/* Append a child sprite to the ChildSprite list of a parent sprite in _vd; last_child is the index of its last child sprite, or -1. */
+	auto add_child = [](int parent, int &last_child, const ChildScreenSpriteToDraw &cs) {
+		int index = (int)_vd.child_screen_sprites_to_draw.size();
+		if (last_child < 0) {
+			_vd.parent_sprites_to_draw[parent].first_child = index;
+		} else {
+			_vd.child_screen_sprites_to_draw[last_child].next = index;
+		}
+		_vd.child_screen_sprites_to_draw.push_back(cs);
+		_vd.child_screen_sprites_to_draw.back().next = -1;
+		last_child = index;
+	};
+
+	static std::vector<int> parent_index; ///< Index in _vd of the cached parent sprites, or -1 when clipped or combined.
+	parent_index.assign(entry.parent_sprites.size(), -1);
+
+	/* Sprite combining as done by AddSortableSpriteToDraw and AddCombinedSprite: the first
+	 * sprite of a block that is not clipped gets the later ones as child sprites. */
+	bool in_block = false;
+	int block_parent = -1;
+	int block_last_child = -1;
+	for (size_t i = 0; i < entry.parent_sprites.size(); i++) {
+		const ParentSpriteToDraw &cps = entry.parent_sprites[i];
+		const CachedParentSpriteInfo &info = entry.parent_info[i];
+
+		if (info.combine != CSC_COMBINED) {
+			in_block = info.combine == CSC_FIRST;
+			block_parent = -1;
+		} else if (block_parent >= 0) {
+			const Sprite *spr = GetSprite(cps.image & SPRITE_MASK, ST_NORMAL);
+			Rect extent = {cps.x + spr->x_offs, cps.y + spr->y_offs, cps.x + spr->x_offs + spr->width, cps.y + spr->y_offs + spr->height};
+			if (IsInsideDrawArea(extent)) {
+				const ParentSpriteToDraw &parent = _vd.parent_sprites_to_draw[block_parent];
+				ChildScreenSpriteToDraw cs = {cps.image, cps.pal, cps.sub, cps.x - parent.left, cps.y - parent.top, -1};
+				add_child(block_parent, block_last_child, cs);
+			}
+			continue;
+		}
+
+		if (!IsInsideDrawArea(info.extent)) continue;
+
+		int index = (int)_vd.parent_sprites_to_draw.size();
+		parent_index[i] = index;
+		_vd.parent_sprites_to_draw.push_back(cps);
+		_vd.parent_sprites_to_draw.back().first_child = -1;
+
+		int last_child = -1;
+		for (int c = cps.first_child; c >= 0; c = entry.child_sprites[c].next) {
+			add_child(index, last_child, entry.child_sprites[c]);
+		}
+
+		if (in_block) {
+			block_parent = index;
+			block_last_child = last_child;
+		}
+	}
+
+	/* Restore the state of the foundations, so tile selections are drawn on top of them. */
+	_vd.foundation_part = entry.foundation_part;
+	for (uint i = 0; i < FOUNDATION_PART_END; i++) {
+		_vd.foundation[i] = entry.foundation[i] < 0 ? -1 : parent_index[entry.foundation[i]];
+		_vd.foundation_offset[i] = entry.foundation_offset[i];
+		_vd.last_foundation_child[i] = nullptr;
+		if (_vd.foundation[i] < 0) continue;
+
+		int *tail = &_vd.parent_sprites_to_draw[_vd.foundation[i]].first_child;
+		while (*tail >= 0) tail = &_vd.child_screen_sprites_to_draw[*tail].next;
+		_vd.last_foundation_child[i] = tail;
+	}
+	_vd.last_child = nullptr;
+}
+
+/**
+ * Add the sprites of a tile to the viewport, taking them from the tile sprite cache when possible.
+ * @param tile_type Type of the tile.
+ * @param ti Tile that is being drawn.
+ */
+static void ViewportAddTile(TileType tile_type, TileInfo *ti)
+{
+	/* While generating the world, tiles are changed on another thread. */
+	if (ti->tile == INVALID_TILE || _generating_world) {
+		_tile_type_procs[tile_type]->draw_tile_proc(ti);
+		return;
+	}
+
+	static uint generation = 0;
+	if (generation != _tile_sprite_cache_generation) {
+		generation = _tile_sprite_cache_generation;
+		_tile_sprite_cache.clear();
+	}
+
+	auto it = _tile_sprite_cache.find(ti->tile);
+	if (it == _tile_sprite_cache.end()) {
+		if (_tile_sprite_cache.size() >= TILE_SPRITE_CACHE_MAX_TILES) _tile_sprite_cache.clear();
+		it = _tile_sprite_cache.emplace(ti->tile, TileSpriteCacheEntry()).first;
+	}
+	TileSpriteCacheEntry &entry = it->second;
+
+	if (entry.zoom != _vd.dpi.zoom) {
+		entry.zoom = _vd.dpi.zoom;
+		entry.uncacheable = !ViewportFillTileSpriteCache(tile_type, ti, entry);
+		if (entry.uncacheable) {
+			entry.tile_sprites.clear();
+			entry.parent_sprites.clear();
+			entry.parent_info.clear();
+			entry.child_sprites.clear();
+		}
+	}
+
+	if (entry.uncacheable) {
+		_tile_type_procs[tile_type]->draw_tile_proc(ti);
+	} else {
+		ViewportAddCachedTileSprites(entry);
+	}
+}
+
+/**
+ * Forget the cached sprites of a tile and its neighbours, as their drawing can depend on the tile.
+ * The catenary of a rail tile depends on whether the tracks of its neighbours
+ * connect to their neighbours, so the tiles two steps away along the axes are
+ * forgotten as well.
+ * @param tile The tile that changed.
+ */
+static void InvalidateTileSpriteCache(TileIndex tile)
+{
+	if (_tile_sprite_cache.empty() || _generating_world) return;
+
+	uint x = TileX(tile);
+	uint y = TileY(tile);
+	for (uint dy = (y > 0 ? y - 1 : 0); dy <= min(y + 1, MapMaxY()); dy++) {
+		for (uint dx = (x > 0 ? x - 1 : 0); dx <= min(x + 1, MapMaxX()); dx++) {
+			_tile_sprite_cache.erase(TileXY(dx, dy));
+		}
+	}
+	if (x > 1) _tile_sprite_cache.erase(TileXY(x - 2, y));
+	if (x + 2 <= MapMaxX()) _tile_sprite_cache.erase(TileXY(x + 2, y));
+	if (y > 1) _tile_sprite_cache.erase(TileXY(x, y - 2));
+	if (y + 2 <= MapMaxY()) _tile_sprite_cache.erase(TileXY(x, y + 2));
+}
+
+/**
+ * Forget the cached sprites of all tiles.
+ * This is done when the whole screen is marked dirty, e.g. when transparency options or company colours change.
+ */
+void InvalidateAllTileSpriteCache()
+{
+	_tile_sprite_cache_generation++;
+}
+
 /**
  * Add the landscape to the viewport, i.e. all ground tiles and buildings.
  */
@@ -1271,8 +1581,11 @@ static void ViewportAddLandscape()
 				_vd.foundation[1] = -1;
 				_vd.last_foundation_child[0] = nullptr;
 				_vd.last_foundation_child[1] = nullptr;
+				/* Child sprites always belong to a parent sprite of the same tile. */
+				_vd.last_child = nullptr;
+				_vd.combined_child = nullptr;
 
-				_tile_type_procs[tile_type]->draw_tile_proc(&tile_info);
+				ViewportAddTile(tile_type, &tile_info);
 				if (tile_info.tile != INVALID_TILE) DrawTileSelection(&tile_info);
 			}
 		}
@@ -1502,62 +1815,168 @@ static bool ViewportSortParentSpritesChecker()
 	return true;
 }
 
-/** Sort parent sprites pointer array */
+/**
+ * Find the sprites that have to be drawn before a sprite, comparing one sprite at a time.
+ * @see VpPrecedingSpriteFinder
+ */
+static uint FindPrecedingParentSprites(const ParentSpriteSortBounds &bounds, const ParentSpriteToDraw *ps, uint first, uint last, uint *preceding)
+{
+	const int32 sum = ps->xmin + ps->xmax + ps->ymin + ps->ymax + ps->zmin + ps->zmax;
+	uint count = 0;
+	for (uint i = first; i < last; i++) {
+		/* We only change the order, if it is definite.
+		 * I.e. every single order of X, Y, Z says the other sprite is behind ps or they overlap.
+		 * That is: If one partial order says ps behind the other sprite, do not change the order.
+		 */
+		if (ps->xmax < bounds.xmin[i] || ps->ymax < bounds.ymin[i] || ps->zmax < bounds.zmin[i]) continue;
+
+		/* Use X+Y+Z as the sorting order of overlapping bounding boxes, so sprites closer to
+		 * the bottom of the screen and with higher Z elevation, are drawn in front.
+		 * Here X,Y,Z are the coordinates of the "center of mass" of the sprite,
+		 * i.e. X=(left+right)/2, etc.
+		 * However, since we only care about order, don't actually divide / 2
+		 */
+		if (ps->xmin <= bounds.xmax[i] && ps->ymin <= bounds.ymax[i] && ps->zmin <= bounds.zmax[i] && sum <= bounds.sum[i]) continue;
+
+		preceding[count++] = i;
+	}
+	return count;
+}
+
+/** Buffers of the sprite sorter, kept between sorts to not allocate them every time. */
+struct ParentSpriteSorterBuffers {
+	std::vector<ParentSpriteToDraw *> sprites; ///< The sprites in their original order.
+	std::vector<uint> sorted;                  ///< The sprites, ordered by their xmin + ymin.
+	std::vector<uint> position;                ///< Position of each sprite in #sorted.
+	std::vector<int32> keys;                   ///< The xmin + ymin of the sprites in #sorted.
+	std::vector<int32> bounds;                 ///< Storage of the bounding boxes in #ParentSpriteSortBounds.
+	std::vector<uint32> order;                 ///< Drawing order of each sprite, or the state of its sorting.
+	std::vector<uint> stack;                   ///< Sprites still to be output; the last one first.
+	std::vector<uint> preceding;               ///< Positions of the sprites preceding the current one.
+};
+
+/** Buffers of the sprite sorter of each thread, as parts of viewports are sorted on the worker threads. */
+static thread_local ParentSpriteSorterBuffers _sprite_sorter_buffers;
+
+/**
+ * Sort parent sprites pointer array replicating the way original sorter did it.
+ * Instead of comparing every pair of sprites, the sprites are ordered by their xmin + ymin.
+ * Only sprites with xmin <= xmax and ymin <= ymax of a sprite can be drawn before it,
+ * so only those with xmin + ymin <= xmax + ymax of the sprite have to be compared.
+ * @tparam Tfinder Function comparing these sprites with the sprite.
+ * @param psdv The sprites to sort.
+ */
+template <VpPrecedingSpriteFinder Tfinder>
 static void ViewportSortParentSprites(ParentSpriteToSortVector *psdv)
 {
-	auto psdvend = psdv->end();
-	auto psd = psdv->begin();
-	while (psd != psdvend) {
-		ParentSpriteToDraw *ps = *psd;
+	const uint count = (uint)psdv->size();
+	if (count < 2) return;
+
+	/* Special orders of sprites telling their state in the sorting. */
+	const uint32 ORDER_COMPARED = UINT32_MAX;     // Sprite was compared, but the sprites preceding it have to be output first.
+	const uint32 ORDER_RETURNED = UINT32_MAX - 1; // Sprite was output; it can still be on the stack.
+
+	ParentSpriteSorterBuffers &buf = _sprite_sorter_buffers;
+	buf.sprites.assign(psdv->begin(), psdv->end());
+	buf.sorted.resize(count);
+	buf.position.resize(count);
+	buf.keys.resize(count);
+	buf.order.resize(count);
+	buf.preceding.resize(count);
+	buf.stack.clear();
+
+	for (uint i = 0; i < count; i++) buf.sorted[i] = i;
+	std::sort(buf.sorted.begin(), buf.sorted.end(), [&buf](uint a, uint b) {
+		const int32 key_a = buf.sprites[a]->xmin + buf.sprites[a]->ymin;
+		const int32 key_b = buf.sprites[b]->xmin + buf.sprites[b]->ymin;
+		return key_a < key_b || (key_a == key_b && a < b);
+	});
 
-		if (ps->comparison_done) {
-			psd++;
+	/* Store the bounding boxes per coordinate; sorted sprites and the padding get an xmin of INT32_MAX. */
+	const uint stride = count + ParentSpriteSortBounds::PADDING;
+	buf.bounds.assign(stride * 7, 0);
+	int32 *xmin = &buf.bounds[0];
+	std::fill(xmin + count, xmin + stride, INT32_MAX);
+	ParentSpriteSortBounds bounds;
+	bounds.xmin = xmin;
+	bounds.ymin = xmin + stride;
+	bounds.zmin = xmin + stride * 2;
+	bounds.xmax = xmin + stride * 3;
+	bounds.ymax = xmin + stride * 4;
+	bounds.zmax = xmin + stride * 5;
+	bounds.sum  = xmin + stride * 6;
+	for (uint i = 0; i < count; i++) {
+		const ParentSpriteToDraw *ps = buf.sprites[buf.sorted[i]];
+		buf.position[buf.sorted[i]] = i;
+		buf.keys[i] = ps->xmin + ps->ymin;
+		xmin[i] = ps->xmin;
+		xmin[i + stride] = ps->ymin;
+		xmin[i + stride * 2] = ps->zmin;
+		xmin[i + stride * 3] = ps->xmax;
+		xmin[i + stride * 4] = ps->ymax;
+		xmin[i + stride * 5] = ps->zmax;
+		xmin[i + stride * 6] = ps->xmin + ps->xmax + ps->ymin + ps->ymax + ps->zmin + ps->zmax;
+	}
+
+	/* We rely on sprites being, for the most part, already ordered.
+	 * So we don't need to move many of them and can keep track of their
+	 * order efficiently by using a stack. We always move sprites to the front
+	 * of the current position, i.e. to the top of the stack.
+	 */
+	uint32 next_order = 0;
+	for (uint i = count; i-- > 0;) {
+		buf.stack.push_back(i);
+		buf.order[i] = next_order++;
+	}
+
+	/* First sprite in #sorted that is not sorted yet. */
+	uint first = 0;
+	auto out = psdv->begin();
+	while (!buf.stack.empty()) {
+		const uint s = buf.stack.back();
+		buf.stack.pop_back();
+		ParentSpriteToDraw *ps = buf.sprites[s];
+
+		/* Sprite is already sorted, ignore it. */
+		if (buf.order[s] == ORDER_RETURNED) continue;
+
+		/* Sprite was already compared, just need to output it. */
+		if (buf.order[s] == ORDER_COMPARED) {
+			*(out++) = ps;
+			buf.order[s] = ORDER_RETURNED;
 			continue;
 		}
 
-		ps->comparison_done = true;
-
-		for (auto psd2 = psd + 1; psd2 != psdvend; psd2++) {
-			ParentSpriteToDraw *ps2 = *psd2;
-
-			if (ps2->comparison_done) continue;
-
-			/* Decide which comparator to use, based on whether the bounding
-			 * boxes overlap
-			 */
-			if (ps->xmax >= ps2->xmin && ps->xmin <= ps2->xmax && // overlap in X?
-					ps->ymax >= ps2->ymin && ps->ymin <= ps2->ymax && // overlap in Y?
-					ps->zmax >= ps2->zmin && ps->zmin <= ps2->zmax) { // overlap in Z?
-				/* Use X+Y+Z as the sorting order, so sprites closer to the bottom of
-				 * the screen and with higher Z elevation, are drawn in front.
-				 * Here X,Y,Z are the coordinates of the "center of mass" of the sprite,
-				 * i.e. X=(left+right)/2, etc.
-				 * However, since we only care about order, don't actually divide / 2
-				 */
-				if (ps->xmin + ps->xmax + ps->ymin + ps->ymax + ps->zmin + ps->zmax <=
-						ps2->xmin + ps2->xmax + ps2->ymin + ps2->ymax + ps2->zmin + ps2->zmax) {
-					continue;
-				}
-			} else {
-				/* We only change the order, if it is definite.
-				 * I.e. every single order of X, Y, Z says ps2 is behind ps or they overlap.
-				 * That is: If one partial order says ps behind ps2, do not change the order.
-				 */
-				if (ps->xmax < ps2->xmin ||
-						ps->ymax < ps2->ymin ||
-						ps->zmax < ps2->zmin) {
-					continue;
-				}
-			}
+		/* The sprite will not be compared with other sprites anymore. */
+		xmin[buf.position[s]] = INT32_MAX;
+		while (first < count && xmin[first] == INT32_MAX) first++;
 
-			/* Move ps2 in front of ps */
-			ParentSpriteToDraw *temp = ps2;
-			for (auto psd3 = psd2; psd3 > psd; psd3--) {
-				*psd3 = *(psd3 - 1);
-			}
-			*psd = temp;
+		const uint last = std::upper_bound(buf.keys.begin() + first, buf.keys.end(), ps->xmax + ps->ymax) - buf.keys.begin();
+		const uint preceding = first < last ? Tfinder(bounds, ps, first, last, buf.preceding.data()) : 0;
+
+		if (preceding == 0) {
+			/* No preceding sprites, add current one to the output */
+			*(out++) = ps;
+			buf.order[s] = ORDER_RETURNED;
+			continue;
+		}
+
+		/* Sort all preceding sprites by order and assign new orders in reverse (as original sorter did). */
+		for (uint i = 0; i < preceding; i++) buf.preceding[i] = buf.sorted[buf.preceding[i]];
+		std::sort(buf.preceding.begin(), buf.preceding.begin() + preceding, [&buf](uint a, uint b) {
+			return buf.order[a] > buf.order[b];
+		});
+
+		buf.order[s] = ORDER_COMPARED;
+		buf.stack.push_back(s); // Still need to output so push it back for now
+
+		for (uint i = 0; i < preceding; i++) {
+			const uint p = buf.preceding[i];
+			buf.order[p] = next_order++;
+			buf.stack.push_back(p);
 		}
 	}
+	assert(out == psdv->end());
 }
 
 static void ViewportDrawParentSprites(const ParentSpriteToSortVector *psd, const ChildScreenSpriteToDrawVector *csstdv)
@@ -1651,7 +2070,15 @@ static void ViewportDrawStrings(ZoomLevel zoom, const StringSpriteToDrawVector *
 	}
 }
 
-void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom)
+/**
+ * Collect everything that has to be drawn in a part of a viewport into #_vd.
+ * @param vp The viewport.
+ * @param left Left edge of the part, in viewport coordinates.
+ * @param top Top edge of the part, in viewport coordinates.
+ * @param right Right edge of the part, in viewport coordinates.
+ * @param bottom Bottom edge of the part, in viewport coordinates.
+ */
+static void ViewportCollectSprites(const ViewPort *vp, int left, int top, int right, int bottom)
 {
 	DrawPixelInfo *old_dpi = _cur_dpi;
 	_cur_dpi = &_vd.dpi;
@@ -1680,20 +2107,81 @@ void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom
 
 	DrawTextEffects(&_vd.dpi);
 
-	if (_vd.tile_sprites_to_draw.size() != 0) ViewportDrawTileSprites(&_vd.tile_sprites_to_draw);
+	_cur_dpi = old_dpi;
+}
+
+/**
+ * Load the sprites of a part of a viewport into the sprite cache, so they can be drawn without loading anything.
+ * @param vd The collected sprites of the part.
+ */
+static void ViewportCacheSprites(const ViewportDrawer &vd)
+{
+	/* Same lookups as DrawSpriteViewport. */
+	auto cache_sprite = [&vd](SpriteID image, PaletteID pal) {
+		GetSprite(GB(image, 0, SPRITE_WIDTH), ST_NORMAL, vd.dpi.zoom);
+		if (HasBit(image, PALETTE_MODIFIER_TRANSPARENT) || (pal != PAL_NONE && !HasBit(pal, PALETTE_TEXT_RECOLOUR))) {
+			GetNonSprite(GB(pal, 0, PALETTE_WIDTH), ST_RECOLOUR);
+		}
+	};
+
+	for (const TileSpriteToDraw &ts : vd.tile_sprites_to_draw) cache_sprite(ts.image, ts.pal);
+	for (const ParentSpriteToDraw &ps : vd.parent_sprites_to_draw) {
+		if (ps.image != SPR_EMPTY_BOUNDING_BOX) cache_sprite(ps.image, ps.pal);
+	}
+	for (const ChildScreenSpriteToDraw &cs : vd.child_screen_sprites_to_draw) cache_sprite(cs.image, cs.pal);
+}
+
+/**
+ * List the normal sprites needed to draw the collected sprites of a part of a viewport.
+ * @param vd The collected sprites of the part.
+ * @param[out] sprites The list to add the sprites to.
+ */
+static void ViewportListSprites(const ViewportDrawer &vd, std::vector<SpriteID> &sprites)
+{
+	for (const TileSpriteToDraw &ts : vd.tile_sprites_to_draw) sprites.push_back(GB(ts.image, 0, SPRITE_WIDTH));
+	for (const ParentSpriteToDraw &ps : vd.parent_sprites_to_draw) {
+		if (ps.image != SPR_EMPTY_BOUNDING_BOX) sprites.push_back(GB(ps.image, 0, SPRITE_WIDTH));
+	}
+	for (const ChildScreenSpriteToDraw &cs : vd.child_screen_sprites_to_draw) sprites.push_back(GB(cs.image, 0, SPRITE_WIDTH));
+}
+
+/**
+ * Sort and draw the collected sprites of a part of a viewport.
+ * Besides reading the sprite cache this only uses \a vd, so different parts can be drawn at the same time.
+ * @param vd The collected sprites of the part.
+ */
+static void ViewportDrawSprites(ViewportDrawer &vd)
+{
+	DrawPixelInfo *old_dpi = _cur_dpi;
+	_cur_dpi = &vd.dpi;
+
+	if (vd.tile_sprites_to_draw.size() != 0) ViewportDrawTileSprites(&vd.tile_sprites_to_draw);
 
-	for (auto &psd : _vd.parent_sprites_to_draw) {
-		_vd.parent_sprites_to_sort.push_back(&psd);
+	for (auto &psd : vd.parent_sprites_to_draw) {
+		vd.parent_sprites_to_sort.push_back(&psd);
 	}
 
-	_vp_sprite_sorter(&_vd.parent_sprites_to_sort);
-	ViewportDrawParentSprites(&_vd.parent_sprites_to_sort, &_vd.child_screen_sprites_to_draw);
+	_vp_sprite_sorter(&vd.parent_sprites_to_sort);
+	ViewportDrawParentSprites(&vd.parent_sprites_to_sort, &vd.child_screen_sprites_to_draw);
 
-	if (_draw_bounding_boxes) ViewportDrawBoundingBoxes(&_vd.parent_sprites_to_sort);
+	_cur_dpi = old_dpi;
+}
+
+/**
+ * Draw everything on top of the sprites of a part of a viewport, and clear its collected sprites.
+ * @param vp The viewport.
+ * @param vd The collected sprites of the part.
+ */
+static void ViewportDrawOverlays(const ViewPort *vp, ViewportDrawer &vd)
+{
+	DrawPixelInfo *old_dpi = _cur_dpi;
+	_cur_dpi = &vd.dpi;
+
+	if (_draw_bounding_boxes) ViewportDrawBoundingBoxes(&vd.parent_sprites_to_sort);
 	if (_draw_dirty_blocks) ViewportDrawDirtyBlocks();
 
-	DrawPixelInfo dp = _vd.dpi;
-	ZoomLevel zoom = _vd.dpi.zoom;
+	DrawPixelInfo dp = vd.dpi;
+	ZoomLevel zoom = vd.dpi.zoom;
 	dp.zoom = ZOOM_LVL_NORMAL;
 	dp.width = UnScaleByZoom(dp.width, zoom);
 	dp.height = UnScaleByZoom(dp.height, zoom);
@@ -1701,54 +2189,144 @@ void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom
 
 	if (vp->overlay != nullptr && vp->overlay->GetCargoMask() != 0 && vp->overlay->GetCompanyMask() != 0) {
 		/* translate to window coordinates */
-		dp.left = x;
-		dp.top = y;
+		int mask = ScaleByZoom(-1, zoom);
+		dp.left = UnScaleByZoom(vd.dpi.left - (vp->virtual_left & mask), zoom) + vp->left;
+		dp.top = UnScaleByZoom(vd.dpi.top - (vp->virtual_top & mask), zoom) + vp->top;
 		vp->overlay->Draw(&dp);
 	}
 
-	if (_vd.string_sprites_to_draw.size() != 0) {
+	if (vd.string_sprites_to_draw.size() != 0) {
 		/* translate to world coordinates */
-		dp.left = UnScaleByZoom(_vd.dpi.left, zoom);
-		dp.top = UnScaleByZoom(_vd.dpi.top, zoom);
-		ViewportDrawStrings(zoom, &_vd.string_sprites_to_draw);
+		dp.left = UnScaleByZoom(vd.dpi.left, zoom);
+		dp.top = UnScaleByZoom(vd.dpi.top, zoom);
+		ViewportDrawStrings(zoom, &vd.string_sprites_to_draw);
 	}
 
 	_cur_dpi = old_dpi;
 
-	_vd.string_sprites_to_draw.clear();
-	_vd.tile_sprites_to_draw.clear();
-	_vd.parent_sprites_to_draw.clear();
-	_vd.parent_sprites_to_sort.clear();
-	_vd.child_screen_sprites_to_draw.clear();
+	vd.string_sprites_to_draw.clear();
+	vd.tile_sprites_to_draw.clear();
+	vd.parent_sprites_to_draw.clear();
+	vd.parent_sprites_to_sort.clear();
+	vd.child_screen_sprites_to_draw.clear();
+}
+
+void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom)
+{
+	ViewportCollectSprites(vp, left, top, right, bottom);
+	ViewportDrawSprites(_vd);
+	ViewportDrawOverlays(vp, _vd);
+}
+
+/**
+ * Draw parts of a viewport, sorting and drawing the sprites of the parts on the worker threads.
+ * The parts do not overlap, so every thread draws to its own part of the screen.
+ * @param vp The viewport.
+ * @param parts The parts to draw, in viewport coordinates.
+ */
+static void ViewportDoDrawParallel(const ViewPort *vp, const std::vector<Rect> &parts)
+{
+	static std::vector<ViewportDrawer> drawers;
+	if (drawers.size() < parts.size()) drawers.resize(parts.size());
+
+	/* Collecting the sprites calls into NewGRFs, and other code that must run on this thread. */
+	for (size_t i = 0; i < parts.size(); i++) {
+		ViewportCollectSprites(vp, parts[i].left, parts[i].top, parts[i].right, parts[i].bottom);
+		std::swap(_vd, drawers[i]);
+	}
+
+	/* The worker threads can only use sprites that are in the cache. When loading
+	 * them pushed other sprites out of the cache, it is too small to hold all
+	 * sprites at once; then draw everything on this thread instead. */
+	uint evictions = GetSpriteCacheEvictionCount();
+
+	/* Decode the sprites that are not in the cache on the worker threads first. */
+	static std::vector<SpriteID> sprites;
+	for (size_t i = 0; i < parts.size(); i++) ViewportListSprites(drawers[i], sprites);
+	PrefetchSprites(sprites, true, vp->zoom);
+	sprites.clear();
+
+	for (size_t i = 0; i < parts.size(); i++) ViewportCacheSprites(drawers[i]);
+
+	if (evictions == GetSpriteCacheEvictionCount()) {
+		RunParallelFor((uint)parts.size(), 1, [&](uint begin, uint end) {
+			for (uint i = begin; i < end; i++) ViewportDrawSprites(drawers[i]);
+		});
+	} else {
+		for (size_t i = 0; i < parts.size(); i++) ViewportDrawSprites(drawers[i]);
+	}
+
+	/* Strings and the other overlays are drawn on this thread; their parts of the screen do not overlap either. */
+	for (size_t i = 0; i < parts.size(); i++) ViewportDrawOverlays(vp, drawers[i]);
 }
 
 /**
- * Make sure we don't draw a too big area at a time.
- * If we do, the sprite memory will overflow.
+ * Decode the sprites just beyond the edges of a viewport it is scrolling towards on the worker threads,
+ * so they are in the sprite cache when they become visible. This never pushes other sprites out of the cache.
+ * @param vp The viewport.
  */
-static void ViewportDrawChk(const ViewPort *vp, int left, int top, int right, int bottom)
+static void ViewportPrefetchSprites(const ViewPort *vp)
 {
-	if ((int64)ScaleByZoom(bottom - top, vp->zoom) * (int64)ScaleByZoom(right - left, vp->zoom) > (int64)(180000 * ZOOM_LVL_BASE * ZOOM_LVL_BASE)) {
+	static std::vector<SpriteID> sprites;
+	for (const Rect &r : _vp_prefetch_areas) {
+		ViewportCollectSprites(vp, r.left, r.top, r.right, r.bottom);
+		ViewportListSprites(_vd, sprites);
+
+		_vd.string_sprites_to_draw.clear();
+		_vd.tile_sprites_to_draw.clear();
+		_vd.parent_sprites_to_draw.clear();
+		_vd.child_screen_sprites_to_draw.clear();
+	}
+	_vp_prefetch_viewport = nullptr;
+
+	PrefetchSprites(sprites, false, vp->zoom);
+	sprites.clear();
+}
+
+/**
+ * Split the area to draw into parts that are drawn on their own.
+ * We don't draw a too big area at a time, as the sprite memory would overflow.
+ * When drawing on multiple threads the parts are made smaller, so they can be spread over the threads.
+ * @param vp The viewport.
+ * @param left Left edge of the area, in screen coordinates.
+ * @param top Top edge of the area, in screen coordinates.
+ * @param right Right edge of the area, in screen coordinates.
+ * @param bottom Bottom edge of the area, in screen coordinates.
+ * @param parallel Whether the parts will be drawn on multiple threads.
+ * @param[out] parts The parts, in viewport coordinates.
+ */
+static void ViewportSplitDrawArea(const ViewPort *vp, int left, int top, int right, int bottom, bool parallel, std::vector<Rect> &parts)
+{
+	if ((int64)ScaleByZoom(bottom - top, vp->zoom) * (int64)ScaleByZoom(right - left, vp->zoom) > (int64)(180000 * ZOOM_LVL_BASE * ZOOM_LVL_BASE) ||
+			(parallel && (bottom - top) * (right - left) > VIEWPORT_DRAW_PART_AREA)) {
 		if ((bottom - top) > (right - left)) {
 			int t = (top + bottom) >> 1;
-			ViewportDrawChk(vp, left, top, right, t);
-			ViewportDrawChk(vp, left, t, right, bottom);
+			ViewportSplitDrawArea(vp, left, top, right, t, parallel, parts);
+			ViewportSplitDrawArea(vp, left, t, right, bottom, parallel, parts);
 		} else {
 			int t = (left + right) >> 1;
-			ViewportDrawChk(vp, left, top, t, bottom);
-			ViewportDrawChk(vp, t, top, right, bottom);
+			ViewportSplitDrawArea(vp, left, top, t, bottom, parallel, parts);
+			ViewportSplitDrawArea(vp, t, top, right, bottom, parallel, parts);
 		}
 	} else {
-		ViewportDoDraw(vp,
+		parts.push_back({
 			ScaleByZoom(left - vp->left, vp->zoom) + vp->virtual_left,
 			ScaleByZoom(top - vp->top, vp->zoom) + vp->virtual_top,
 			ScaleByZoom(right - vp->left, vp->zoom) + vp->virtual_left,
 			ScaleByZoom(bottom - vp->top, vp->zoom) + vp->virtual_top
-		);
+		});
 	}
 }
 
-static inline void ViewportDraw(const ViewPort *vp, int left, int top, int right, int bottom)
+/**
+ * Draw an area of a viewport to #_cur_dpi; on the worker threads when possible.
+ * @param vp The viewport.
+ * @param left Left edge of the area, in screen coordinates.
+ * @param top Top edge of the area, in screen coordinates.
+ * @param right Right edge of the area, in screen coordinates.
+ * @param bottom Bottom edge of the area, in screen coordinates.
+ */
+void ViewportDraw(const ViewPort *vp, int left, int top, int right, int bottom)
 {
 	if (right <= vp->left || bottom <= vp->top) return;
 
@@ -1762,7 +2340,20 @@ static inline void ViewportDraw(const ViewPort *vp, int left, int top, int right
 	if (top < vp->top) top = vp->top;
 	if (bottom > vp->top + vp->height) bottom = vp->top + vp->height;
 
-	ViewportDrawChk(vp, left, top, right, bottom);
+	/* The sprite picker records every sprite it draws, which cannot be done from multiple threads. */
+	bool parallel = GetWorkerThreadCount() > 1 && _newgrf_debug_sprite_picker.mode != SPM_REDRAW;
+
+	static std::vector<Rect> parts;
+	parts.clear();
+	ViewportSplitDrawArea(vp, left, top, right, bottom, parallel, parts);
+
+	if (parallel && parts.size() > 1) {
+		ViewportDoDrawParallel(vp, parts);
+	} else {
+		for (const Rect &r : parts) ViewportDoDraw(vp, r.left, r.top, r.right, r.bottom);
+	}
+
+	if (parallel && vp == _vp_prefetch_viewport) ViewportPrefetchSprites(vp);
 }
 
 /**
@@ -1937,6 +2528,9 @@ void ConstrainAllViewportsZoom()
  */
 void MarkTileDirtyByTile(TileIndex tile, int bridge_level_offset, int tile_height_override)
 {
+	InvalidateTileSpriteCache(tile);
+	MarkSmallMapTileDirty(tile);
+
 	Point pt = RemapCoords(TileX(tile) * TILE_SIZE, TileY(tile) * TILE_SIZE, tile_height_override * TILE_HEIGHT);
 	MarkAllViewportsDirty(
 			pt.x - MAX_TILE_EXTENT_LEFT,
@@ -2333,7 +2927,7 @@ void RebuildViewportOverlay(Window *w)
 	if (w->viewport->overlay != nullptr &&
 			w->viewport->overlay->GetCompanyMask() != 0 &&
 			w->viewport->overlay->GetCargoMask() != 0) {
-		w->viewport->overlay->SetDirty();
+		w->viewport->overlay->SetViewDirty();
 		w->SetDirty();
 	}
 }
@@ -3376,9 +3970,10 @@ struct ViewportSSCSS {
 /** List of sorters ordered from best to worst. */
 static ViewportSSCSS _vp_sprite_sorters[] = {
 #ifdef WITH_SSE
-	{ &ViewportSortParentSpritesSSE41Checker, &ViewportSortParentSpritesSSE41 },
+	{ &ViewportSortParentSpritesAVX2Checker, &ViewportSortParentSprites<&FindPrecedingParentSpritesAVX2> },
+	{ &ViewportSortParentSpritesSSE41Checker, &ViewportSortParentSprites<&FindPrecedingParentSpritesSSE41> },
 #endif
-	{ &ViewportSortParentSpritesChecker, &ViewportSortParentSprites }
+	{ &ViewportSortParentSpritesChecker, &ViewportSortParentSprites<&FindPrecedingParentSprites> }
 };
 
 /** Choose the "best" sprite sorter and set _vp_sprite_sorter. */
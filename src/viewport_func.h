@@ -64,6 +64,7 @@ void SetTileSelectSize(int w, int h);
 void SetTileSelectBigSize(int ox, int oy, int sx, int sy);
 
 void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom);
+void ViewportDraw(const ViewPort *vp, int left, int top, int right, int bottom);
 
 bool ScrollWindowToTile(TileIndex tile, Window *w, bool instant = false);
 bool ScrollWindowTo(int x, int y, int z, Window *w, bool instant = false);
@@ -75,6 +76,7 @@ bool ScrollMainWindowTo(int x, int y, int z = -1, bool instant = false);
 
 void UpdateAllVirtCoords();
 void ClearAllCachedNames();
+void InvalidateAllTileSpriteCache();
 
 extern Point _tile_fract_coords;
 
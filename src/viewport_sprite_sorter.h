@@ -36,19 +36,48 @@ struct ParentSpriteToDraw {
 	int32 top;                      ///< minimal screen Y coordinate of sprite (= y + sprite->y_offs), reference point for child sprites
 
 	int32 first_child;              ///< the first child to draw.
-	bool comparison_done;           ///< Used during sprite sorting: true if sprite has been compared with all other sprites
 };
 
 typedef std::vector<ParentSpriteToDraw*> ParentSpriteToSortVector;
 
+/**
+ * Bounding boxes of the parent sprites that are being sorted, one array per coordinate
+ * so blocks of sprites can be compared at once. The sprites are ordered by their xmin + ymin;
+ * sprites that have already been sorted have an xmin of INT32_MAX. Every array has
+ * #PADDING entries past the last sprite, so blocks may be read past the end.
+ */
+struct ParentSpriteSortBounds {
+	static const uint PADDING = 8; ///< Number of entries past the last sprite.
+
+	const int32 *xmin;              ///< minimal world X coordinates of the bounding boxes
+	const int32 *ymin;              ///< minimal world Y coordinates of the bounding boxes
+	const int32 *zmin;              ///< minimal world Z coordinates of the bounding boxes
+	const int32 *xmax;              ///< maximal world X coordinates of the bounding boxes
+	const int32 *ymax;              ///< maximal world Y coordinates of the bounding boxes
+	const int32 *zmax;              ///< maximal world Z coordinates of the bounding boxes
+	const int32 *sum;               ///< sums of all coordinates, i.e. twice the centres of the bounding boxes
+};
+
 /** Type for method for checking whether a viewport sprite sorter exists. */
 typedef bool (*VpSorterChecker)();
 /** Type for the actual viewport sprite sorter. */
 typedef void (*VpSpriteSorter)(ParentSpriteToSortVector *psd);
+/**
+ * Type for finding the sprites that have to be drawn before a sprite.
+ * @param bounds    The bounding boxes of the sprites that are not sorted yet.
+ * @param ps        The sprite to find the preceding sprites of.
+ * @param first     The first sprite of \a bounds to compare with.
+ * @param last      The sprite of \a bounds after the last one to compare with.
+ * @param preceding Array with space for \a last - \a first sprites that receives the preceding ones, in the order of \a bounds.
+ * @return The number of preceding sprites.
+ */
+typedef uint (*VpPrecedingSpriteFinder)(const ParentSpriteSortBounds &bounds, const ParentSpriteToDraw *ps, uint first, uint last, uint *preceding);
 
 #ifdef WITH_SSE
 bool ViewportSortParentSpritesSSE41Checker();
-void ViewportSortParentSpritesSSE41(ParentSpriteToSortVector *psdv);
+uint FindPrecedingParentSpritesSSE41(const ParentSpriteSortBounds &bounds, const ParentSpriteToDraw *ps, uint first, uint last, uint *preceding);
+bool ViewportSortParentSpritesAVX2Checker();
+uint FindPrecedingParentSpritesAVX2(const ParentSpriteSortBounds &bounds, const ParentSpriteToDraw *ps, uint first, uint last, uint *preceding);
 #endif
 
 void InitializeSpriteSorter();
@@ -0,0 +1,67 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file viewport_sprite_sorter_avx2.cpp Comparison of parent sprites for the sprite sorter that uses AVX2. */
+
+#ifdef WITH_SSE
+
+#include "stdafx.h"
+#include "cpu.h"
+#include <immintrin.h>
+#include "viewport_sprite_sorter.h"
+
+#include "safeguards.h"
+
+/**
+ * Find the sprites that have to be drawn before a sprite, comparing eight sprites at once.
+ * @see VpPrecedingSpriteFinder
+ */
+uint FindPrecedingParentSpritesAVX2(const ParentSpriteSortBounds &bounds, const ParentSpriteToDraw *ps, uint first, uint last, uint *preceding)
+{
+	const __m256i ps_xmin = _mm256_set1_epi32(ps->xmin);
+	const __m256i ps_ymin = _mm256_set1_epi32(ps->ymin);
+	const __m256i ps_zmin = _mm256_set1_epi32(ps->zmin);
+	const __m256i ps_xmax = _mm256_set1_epi32(ps->xmax);
+	const __m256i ps_ymax = _mm256_set1_epi32(ps->ymax);
+	const __m256i ps_zmax = _mm256_set1_epi32(ps->zmax);
+	const __m256i ps_sum = _mm256_set1_epi32(ps->xmin + ps->xmax + ps->ymin + ps->ymax + ps->zmin + ps->zmax);
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+	uint count = 0;
+	for (uint i = first; i < last; i += 8) {
+		/* Sprites that are in front of ps along one of the axes are never drawn before it. */
+		__m256i after = _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i *) &bounds.xmin[i]), ps_xmax);
+		after = _mm256_or_si256(after, _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i *) &bounds.ymin[i]), ps_ymax));
+		after = _mm256_or_si256(after, _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i *) &bounds.zmin[i]), ps_zmax));
+
+		/* Of the others, those that do not overlap ps, or that overlap it with their centre further to the back, precede it. */
+		__m256i apart = _mm256_cmpgt_epi32(ps_xmin, _mm256_loadu_si256((const __m256i *) &bounds.xmax[i]));
+		apart = _mm256_or_si256(apart, _mm256_cmpgt_epi32(ps_ymin, _mm256_loadu_si256((const __m256i *) &bounds.ymax[i])));
+		apart = _mm256_or_si256(apart, _mm256_cmpgt_epi32(ps_zmin, _mm256_loadu_si256((const __m256i *) &bounds.zmax[i])));
+		apart = _mm256_or_si256(apart, _mm256_cmpgt_epi32(ps_sum, _mm256_loadu_si256((const __m256i *) &bounds.sum[i])));
+
+		__m256i precedes = _mm256_andnot_si256(after, apart);
+		if (last - i < 8) precedes = _mm256_and_si256(precedes, _mm256_cmpgt_epi32(_mm256_set1_epi32(last - i), lanes));
+		if (_mm256_testz_si256(precedes, precedes)) continue;
+
+		for (uint bits = _mm256_movemask_ps(_mm256_castsi256_ps(precedes)), j = i; bits != 0; bits >>= 1, j++) {
+			if (bits & 1) preceding[count++] = j;
+		}
+	}
+	return count;
+}
+
+/**
+ * Check whether the current CPU and operating system support AVX2.
+ * @return True iff AVX2 can be used.
+ */
+bool ViewportSortParentSpritesAVX2Checker()
+{
+	return HasAVX2Support();
+}
+
+#endif /* WITH_SSE */
@@ -5,7 +5,7 @@
  * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
  */
 
-/** @file viewport_sprite_sorter_sse4.cpp Sprite sorter that uses SSE4.1. */
+/** @file viewport_sprite_sorter_sse4.cpp Comparison of parent sprites for the sprite sorter that uses SSE4.1. */
 
 #ifdef WITH_SSE
 
@@ -16,79 +16,43 @@
 
 #include "safeguards.h"
 
-#ifdef _SQ64
-	assert_compile((sizeof(ParentSpriteToDraw) % 16) == 0);
-	#define LOAD_128 _mm_load_si128
-#else
-	#define LOAD_128 _mm_loadu_si128
-#endif
-
-/** Sort parent sprites pointer array using SSE4.1 optimizations. */
-void ViewportSortParentSpritesSSE41(ParentSpriteToSortVector *psdv)
+/**
+ * Find the sprites that have to be drawn before a sprite, comparing four sprites at once.
+ * @see VpPrecedingSpriteFinder
+ */
+uint FindPrecedingParentSpritesSSE41(const ParentSpriteSortBounds &bounds, const ParentSpriteToDraw *ps, uint first, uint last, uint *preceding)
 {
-	const __m128i mask_ptest = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0,  0,  0);
-	auto const psdvend = psdv->end();
-	auto psd = psdv->begin();
-	while (psd != psdvend) {
-		ParentSpriteToDraw * const ps = *psd;
-
-		if (ps->comparison_done) {
-			psd++;
-			continue;
-		}
-
-		ps->comparison_done = true;
-
-		for (auto psd2 = psd + 1; psd2 != psdvend; psd2++) {
-			ParentSpriteToDraw * const ps2 = *psd2;
+	const __m128i ps_xmin = _mm_set1_epi32(ps->xmin);
+	const __m128i ps_ymin = _mm_set1_epi32(ps->ymin);
+	const __m128i ps_zmin = _mm_set1_epi32(ps->zmin);
+	const __m128i ps_xmax = _mm_set1_epi32(ps->xmax);
+	const __m128i ps_ymax = _mm_set1_epi32(ps->ymax);
+	const __m128i ps_zmax = _mm_set1_epi32(ps->zmax);
+	const __m128i ps_sum = _mm_set1_epi32(ps->xmin + ps->xmax + ps->ymin + ps->ymax + ps->zmin + ps->zmax);
+	const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
 
-			if (ps2->comparison_done) continue;
+	uint count = 0;
+	for (uint i = first; i < last; i += 4) {
+		/* Sprites that are in front of ps along one of the axes are never drawn before it. */
+		__m128i after = _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *) &bounds.xmin[i]), ps_xmax);
+		after = _mm_or_si128(after, _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *) &bounds.ymin[i]), ps_ymax));
+		after = _mm_or_si128(after, _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *) &bounds.zmin[i]), ps_zmax));
 
-			/*
-			 * Decide which comparator to use, based on whether the bounding boxes overlap
-			 *
-			 * Original code:
-			 * if (ps->xmax >= ps2->xmin && ps->xmin <= ps2->xmax && // overlap in X?
-			 *     ps->ymax >= ps2->ymin && ps->ymin <= ps2->ymax && // overlap in Y?
-			 *     ps->zmax >= ps2->zmin && ps->zmin <= ps2->zmax) { // overlap in Z?
-			 *
-			 * Above conditions are equivalent to:
-			 * 1/    !( (ps->xmax >= ps2->xmin) && (ps->ymax >= ps2->ymin) && (ps->zmax >= ps2->zmin)   &&    (ps->xmin <= ps2->xmax) && (ps->ymin <= ps2->ymax) && (ps->zmin <= ps2->zmax) )
-			 * 2/    !( (ps->xmax >= ps2->xmin) && (ps->ymax >= ps2->ymin) && (ps->zmax >= ps2->zmin)   &&    (ps2->xmax >= ps->xmin) && (ps2->ymax >= ps->ymin) && (ps2->zmax >= ps->zmin) )
-			 * 3/  !( ( (ps->xmax >= ps2->xmin) && (ps->ymax >= ps2->ymin) && (ps->zmax >= ps2->zmin) ) &&  ( (ps2->xmax >= ps->xmin) && (ps2->ymax >= ps->ymin) && (ps2->zmax >= ps->zmin) ) )
-			 * 4/ !( !( (ps->xmax <  ps2->xmin) || (ps->ymax <  ps2->ymin) || (ps->zmax <  ps2->zmin) ) && !( (ps2->xmax <  ps->xmin) || (ps2->ymax <  ps->ymin) || (ps2->zmax <  ps->zmin) ) )
-			 * 5/ PTEST <---------------------------------- rslt1 ---------------------------------->         <------------------------------ rslt2 -------------------------------------->
-			 */
-			__m128i ps1_max = LOAD_128((__m128i*) &ps->xmax);
-			__m128i ps2_min = LOAD_128((__m128i*) &ps2->xmin);
-			__m128i rslt1 = _mm_cmplt_epi32(ps1_max, ps2_min);
-			if (!_mm_testz_si128(mask_ptest, rslt1))
-				continue;
+		/* Of the others, those that do not overlap ps, or that overlap it with their centre further to the back, precede it. */
+		__m128i apart = _mm_cmpgt_epi32(ps_xmin, _mm_loadu_si128((const __m128i *) &bounds.xmax[i]));
+		apart = _mm_or_si128(apart, _mm_cmpgt_epi32(ps_ymin, _mm_loadu_si128((const __m128i *) &bounds.ymax[i])));
+		apart = _mm_or_si128(apart, _mm_cmpgt_epi32(ps_zmin, _mm_loadu_si128((const __m128i *) &bounds.zmax[i])));
+		apart = _mm_or_si128(apart, _mm_cmpgt_epi32(ps_sum, _mm_loadu_si128((const __m128i *) &bounds.sum[i])));
 
-			__m128i ps1_min = LOAD_128((__m128i*) &ps->xmin);
-			__m128i ps2_max = LOAD_128((__m128i*) &ps2->xmax);
-			__m128i rslt2 = _mm_cmplt_epi32(ps2_max, ps1_min);
-			if (_mm_testz_si128(mask_ptest, rslt2)) {
-				/* Use X+Y+Z as the sorting order, so sprites closer to the bottom of
-				 * the screen and with higher Z elevation, are drawn in front.
-				 * Here X,Y,Z are the coordinates of the "center of mass" of the sprite,
-				 * i.e. X=(left+right)/2, etc.
-				 * However, since we only care about order, don't actually divide / 2
-				 */
-				if (ps->xmin + ps->xmax + ps->ymin + ps->ymax + ps->zmin + ps->zmax <=
-						ps2->xmin + ps2->xmax + ps2->ymin + ps2->ymax + ps2->zmin + ps2->zmax) {
-					continue;
-				}
-			}
+		__m128i precedes = _mm_andnot_si128(after, apart);
+		if (last - i < 4) precedes = _mm_and_si128(precedes, _mm_cmpgt_epi32(_mm_set1_epi32(last - i), lanes));
+		if (_mm_testz_si128(precedes, precedes)) continue;
 
-			/* Move ps2 in front of ps */
-			ParentSpriteToDraw * const temp = ps2;
-			for (auto psd3 = psd2; psd3 > psd; psd3--) {
-				*psd3 = *(psd3 - 1);
-			}
-			*psd = temp;
+		for (uint bits = _mm_movemask_ps(_mm_castsi128_ps(precedes)), j = i; bits != 0; bits >>= 1, j++) {
+			if (bits & 1) preceding[count++] = j;
 		}
 	}
+	return count;
 }
 
 /**
@@ -3136,6 +3136,19 @@ void UpdateWindows()
 
 	if (delta_ms == 0) return;
 
+	Window *w;
+
+	if (_network_dedicated) {
+		/* Without a screen there is no GUI work to do; only keep the text
+		 * effects and the invalidation queues from piling up. */
+		if (!_pause_mode || _game_mode == GM_EDITOR || _settings_game.construction.command_pause_level > CMDPL_NO_CONSTRUCTION) MoveAllTextEffects(delta_ms);
+		FOR_ALL_WINDOWS_FROM_FRONT(w) {
+			w->ProcessScheduledInvalidations();
+			w->ProcessHighlightedInvalidations();
+		}
+		return;
+	}
+
 	PerformanceMeasurer framerate(PFE_DRAWING);
 	PerformanceAccumulator::Reset(PFE_DRAWWORLD);
 
@@ -3147,12 +3160,8 @@ void UpdateWindows()
 		NetworkChatMessageLoop();
 	}
 
-	Window *w;
-
 	static GUITimer window_timer = GUITimer(1);
 	if (window_timer.Elapsed(delta_ms)) {
-		if (_network_dedicated) window_timer.SetInterval(MILLISECONDS_PER_TICK);
-
 		extern int _caret_timer;
 		_caret_timer += 3;
 		CursorTick();
@@ -3175,10 +3184,6 @@ void UpdateWindows()
 		w->ProcessHighlightedInvalidations();
 	}
 
-	/* Skip the actual drawing on dedicated servers without screen.
-	 * But still empty the invalidation queues above. */
-	if (_network_dedicated) return;
-
 	static GUITimer hundredth_timer = GUITimer(1);
 	if (hundredth_timer.Elapsed(delta_ms)) {
 		hundredth_timer.SetInterval(3000); // Historical reason: 100 * MILLISECONDS_PER_TICK
@@ -3260,8 +3265,10 @@ void Window::InvalidateData(int data, bool gui_scope)
 {
 	this->SetDirty();
 	if (!gui_scope) {
-		/* Schedule GUI-scope invalidation for next redraw. */
-		this->scheduled_invalidation_data.push_back(data);
+		/* Schedule GUI-scope invalidation for next redraw; the same data
+		 * invalidated several times before then only needs handling once. */
+		std::vector<int> &scheduled = this->scheduled_invalidation_data;
+		if (std::find(scheduled.begin(), scheduled.end(), data) == scheduled.end()) scheduled.push_back(data);
 	}
 	this->OnInvalidateData(data, gui_scope);
 }
@@ -3302,7 +3309,8 @@ void Window::ProcessHighlightedInvalidations()
  *  - OnInvalidateData() may not rely on _current_company == _local_company.
  *    This implies that no NewGRF callbacks may be run.
  *
- * However, when invalidations are scheduled, then multiple calls may be scheduled before execution starts. Earlier scheduled
+ * However, when invalidations are scheduled, then multiple calls may be scheduled before execution starts. Scheduled calls
+ * with the same invalidation-data are merged, keeping the position of the first one. Earlier scheduled
  * invalidations may be called with invalidation-data, which is already invalid at the point of execution.
  * That means some stuff requires to be executed immediately in command scope, while not everything may be executed in command
  * scope. While GUI-scope calls have no restrictions on what they may do, they cannot assume the game to still be in the state
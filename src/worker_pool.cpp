@@ -0,0 +1,225 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file worker_pool.cpp Implementation of the shared pool of worker threads. */
+
+#include "stdafx.h"
+#include "thread.h"
+#include "settings_type.h"
+#include "worker_pool.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "safeguards.h"
+
+/** Whether the current thread is one of the worker threads. */
+static thread_local bool _is_worker_thread = false;
+
+/** Whether parallel loops have to run on the calling thread; see #DisableWorkerThreads. */
+static bool _worker_threads_disabled = false;
+
+/**
+ * Get the number of threads that should share the work of a parallel loop.
+ * @return The configured number of threads, including the thread starting the loop.
+ */
+static uint GetConfiguredThreadCount()
+{
+	uint threads = _settings_client.gui.worker_threads;
+	if (threads == 0) threads = std::thread::hardware_concurrency();
+	return max(threads, 1U);
+}
+
+/** All state of the pool of worker threads. */
+class WorkerPool {
+	std::vector<std::thread> threads;  ///< The worker threads.
+	std::mutex run_lock;               ///< Held while a parallel loop is running; only one can run at a time.
+	std::mutex lock;                   ///< Protects the job description and bookkeeping below.
+	std::condition_variable wake;      ///< Signalled when a new job is available or the workers have to exit.
+	std::condition_variable done;      ///< Signalled when the last busy worker finished its part of a job.
+
+	const ParallelForProc *proc = nullptr; ///< Loop body of the current job, or \c nullptr when there is no job.
+	uint count = 0;                    ///< Number of items of the current job.
+	uint batch = 1;                    ///< Number of items a thread takes at once.
+	std::atomic<uint> next;            ///< First item that has not been handed out yet.
+	uint busy = 0;                     ///< Number of workers that are processing the current job.
+	uint generation = 0;               ///< Incremented for every job, so workers can tell a new job from the one they already did.
+	bool exit = false;                 ///< Whether the workers have to stop.
+
+	/**
+	 * Take batches of items of the current job until none are left.
+	 * @param proc  Loop body of the job.
+	 * @param count Number of items of the job.
+	 * @param batch Number of items to take at once.
+	 */
+	void ProcessBatches(const ParallelForProc &proc, uint count, uint batch)
+	{
+		for (;;) {
+			uint begin = this->next.fetch_add(batch);
+			if (begin >= count) return;
+			proc(begin, min(begin + batch, count));
+		}
+	}
+
+	/** Main loop of a worker thread. */
+	void WorkerMain()
+	{
+		_is_worker_thread = true;
+
+		uint seen = 0;
+		std::unique_lock<std::mutex> lock(this->lock);
+		for (;;) {
+			this->wake.wait(lock, [&] { return this->exit || (this->proc != nullptr && this->generation != seen); });
+			if (this->exit) return;
+
+			seen = this->generation;
+			const ParallelForProc *proc = this->proc;
+			uint count = this->count;
+			uint batch = this->batch;
+			this->busy++;
+
+			lock.unlock();
+			this->ProcessBatches(*proc, count, batch);
+			lock.lock();
+
+			if (--this->busy == 0) this->done.notify_all();
+		}
+	}
+
+	/** Stop and join all worker threads. */
+	void Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->lock);
+			this->exit = true;
+		}
+		this->wake.notify_all();
+		for (std::thread &t : this->threads) t.join();
+		this->threads.clear();
+		this->exit = false;
+	}
+
+	/**
+	 * Make sure the number of running workers matches the configured number of threads.
+	 * @pre run_lock is held.
+	 */
+	void Resize()
+	{
+		/* The thread starting a job does its share of the work as well. */
+		uint wanted = GetConfiguredThreadCount() - 1;
+		if (wanted == this->threads.size()) return;
+
+		this->Stop();
+		for (uint i = 0; i < wanted; i++) {
+			std::thread t;
+			if (!StartNewThread(&t, "ottd:worker", [this]() { this->WorkerMain(); })) break;
+			this->threads.push_back(std::move(t));
+		}
+	}
+
+public:
+	WorkerPool() : next(0) {}
+
+	~WorkerPool()
+	{
+		this->Stop();
+	}
+
+	/**
+	 * Run a parallel loop; see #RunParallelFor.
+	 * @param count Number of items.
+	 * @param batch Number of items a thread takes at once.
+	 * @param proc  Loop body.
+	 */
+	void Run(uint count, uint batch, const ParallelForProc &proc)
+	{
+		if (count == 0) return;
+		if (batch == 0) batch = 1;
+
+		/* Nested loops, loops started while another thread is using the pool and
+		 * loops that would not be split anyway are run on the calling thread. */
+		std::unique_lock<std::mutex> run_lock(this->run_lock, std::defer_lock);
+		if (_is_worker_thread || _worker_threads_disabled || count <= batch || !run_lock.try_lock()) {
+			proc(0, count);
+			return;
+		}
+
+		this->Resize();
+		if (this->threads.empty()) {
+			proc(0, count);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(this->lock);
+			this->proc = &proc;
+			this->count = count;
+			this->batch = batch;
+			this->next = 0;
+			this->generation++;
+		}
+		this->wake.notify_all();
+
+		this->ProcessBatches(proc, count, batch);
+
+		/* All items are handed out; wait for the workers to finish theirs. */
+		std::unique_lock<std::mutex> lock(this->lock);
+		this->proc = nullptr;
+		this->done.wait(lock, [&] { return this->busy == 0; });
+	}
+};
+
+/** The pool of worker threads. */
+static WorkerPool _worker_pool;
+
+/**
+ * Process \a count independent items, spreading them over the worker threads.
+ * The calling thread takes part in the processing and this function returns
+ * once all items are processed. As items may be processed in any order and at
+ * the same time, the result must not depend on the order of processing; this
+ * keeps the game state the same regardless of the number of threads.
+ * @param count Number of items to process.
+ * @param batch Number of consecutive items a thread takes at once; choose it such that a batch is worth the synchronisation.
+ * @param proc  Loop body called for ranges of items.
+ */
+void RunParallelFor(uint count, uint batch, const ParallelForProc &proc)
+{
+	_worker_pool.Run(count, batch, proc);
+}
+
+/**
+ * Get the number of threads that share the work of #RunParallelFor.
+ * @return The number of threads, including the calling thread.
+ */
+uint GetWorkerThreadCount()
+{
+#ifdef NO_THREADS
+	return 1;
+#else
+	return GetConfiguredThreadCount();
+#endif
+}
+
+/**
+ * Check whether the current thread is one of the worker threads.
+ * @return True when called from within the loop body of #RunParallelFor on a worker thread.
+ */
+bool IsWorkerThread()
+{
+	return _is_worker_thread;
+}
+
+/**
+ * Run all further parallel loops on the calling thread. This is meant for a
+ * forked copy of the process, which does not have the worker threads of the
+ * original, while it still thinks it has them, and for after a crash.
+ */
+void DisableWorkerThreads()
+{
+	_worker_threads_disabled = true;
+}
@@ -0,0 +1,28 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file worker_pool.h Shared pool of worker threads for splitting independent work over multiple cores. */
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <functional>
+
+/**
+ * Loop body of a parallel loop.
+ * It is called with a range [begin, end) of item indices that it has to process.
+ * Different ranges may be processed at the same time on different threads, so
+ * the processing of one item must not depend on, or change, the state of any other item.
+ */
+typedef std::function<void(uint begin, uint end)> ParallelForProc;
+
+void RunParallelFor(uint count, uint batch, const ParallelForProc &proc);
+uint GetWorkerThreadCount();
+bool IsWorkerThread();
+void DisableWorkerThreads();
+
+#endif /* WORKER_POOL_H */